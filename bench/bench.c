@@ -0,0 +1,267 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#include "common.h"
+#include "log.h"
+#include "zbxalgo.h"
+#include "zbxjson.h"
+#include "version.h"
+
+#include "bench.h"
+
+const char	*progname = NULL;
+const char	title_message[] = "zabbix_bench";
+const char	syslog_app_name[] = "zabbix_bench";
+const char	*usage_message[] = {NULL};
+const char	*help_message[] = {NULL};
+
+unsigned char	program_type = ZBX_PROGRAM_TYPE_SERVER;
+
+/* referenced by shared memory allocator */
+int	CONFIG_HUGE_PAGES = 0;
+
+#define ZBX_BENCH_RUNS		5
+#define ZBX_BENCH_MIN_TIME	0.2
+
+static const char	*bench_suite;
+static const char	*bench_filter = NULL;
+static double		bench_min_time = ZBX_BENCH_MIN_TIME;
+static int		bench_runs = ZBX_BENCH_RUNS;
+static int		bench_num = 0;
+
+static zbx_uint64_t	bench_seed = __UINT64_C(0x9e3779b97f4a7c15);
+
+static void	bench_usage(void)
+{
+	printf("usage: %s [-t seconds] [-r runs] [-f filter]\n", progname);
+	printf("  -t seconds  minimum duration of a single timed run (default %.1f)\n", ZBX_BENCH_MIN_TIME);
+	printf("  -r runs     number of timed runs (default %d)\n", ZBX_BENCH_RUNS);
+	printf("  -f filter   run only benchmarks containing filter in their name\n");
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_bench_init                                                   *
+ *                                                                            *
+ * Purpose: parse benchmark command line options                              *
+ *                                                                            *
+ * Parameters: argc  - [IN] the number of arguments                           *
+ *             argv  - [IN] the arguments                                     *
+ *             suite - [IN] the benchmark suite name used in results          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_bench_init(int argc, char **argv, const char *suite)
+{
+	int	ch;
+
+	progname = argv[0];
+	bench_suite = suite;
+
+	while (-1 != (ch = getopt(argc, argv, "t:r:f:h")))
+	{
+		switch (ch)
+		{
+			case 't':
+				if (0 >= (bench_min_time = atof(optarg)))
+				{
+					bench_usage();
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'r':
+				if (0 >= (bench_runs = atoi(optarg)))
+				{
+					bench_usage();
+					exit(EXIT_FAILURE);
+				}
+				break;
+			case 'f':
+				bench_filter = optarg;
+				break;
+			default:
+				bench_usage();
+				exit('h' == ch ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_bench_rand                                                   *
+ *                                                                            *
+ * Purpose: return pseudo random number                                       *
+ *                                                                            *
+ * Comments: xorshift generator with fixed seed, so every run of benchmarks   *
+ *           uses the same input data                                         *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_bench_rand(void)
+{
+	bench_seed ^= bench_seed << 13;
+	bench_seed ^= bench_seed >> 7;
+	bench_seed ^= bench_seed << 17;
+
+	return bench_seed;
+}
+
+static double	bench_time(const zbx_bench_t *bench, void *data, int loops)
+{
+	double	start, elapsed;
+
+	if (NULL != bench->prepare)
+		bench->prepare(data);
+
+	start = zbx_time();
+	bench->func(data, loops);
+	elapsed = zbx_time() - start;
+
+	if (NULL != bench->cleanup)
+		bench->cleanup(data);
+
+	return elapsed;
+}
+
+static int	bench_compare_double(const void *d1, const void *d2)
+{
+	const double	*v1 = (const double *)d1;
+	const double	*v2 = (const double *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(*v1, *v2);
+
+	return 0;
+}
+
+static void	bench_add_double(struct zbx_json *j, const char *name, double value)
+{
+	char	buffer[MAX_STRING_LEN];
+
+	zbx_snprintf(buffer, sizeof(buffer), "%.3f", value);
+	zbx_json_addstring(j, name, buffer, ZBX_JSON_TYPE_INT);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_bench_run                                                    *
+ *                                                                            *
+ * Purpose: measure benchmark and print its results                           *
+ *                                                                            *
+ * Parameters: bench - [IN] the benchmark                                     *
+ *             data  - [IN] the benchmark data passed to its functions        *
+ *                                                                            *
+ * Comments: The number of loops is doubled until a single run takes at least *
+ *           the minimum run time, then the configured number of runs is      *
+ *           timed. The results are printed as one JSON object per line with  *
+ *           the best and median time per operation.                          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_bench_run(const zbx_bench_t *bench, void *data)
+{
+	int		loops = 1, i;
+	double		*times, ops;
+	struct zbx_json	j;
+
+	if (NULL != bench_filter && NULL == strstr(bench->name, bench_filter))
+		return;
+
+	while (bench_min_time > bench_time(bench, data, loops))
+		loops *= 2;
+
+	ops = (double)loops * bench->ops_per_loop;
+	times = (double *)zbx_malloc(NULL, bench_runs * sizeof(double));
+
+	for (i = 0; i < bench_runs; i++)
+		times[i] = bench_time(bench, data, loops) * 1e9 / ops;
+
+	qsort(times, bench_runs, sizeof(double), bench_compare_double);
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(&j, "suite", bench_suite, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&j, "name", bench->name, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&j, "version", ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
+	zbx_json_adduint64(&j, "clock", (zbx_uint64_t)time(NULL));
+	zbx_json_adduint64(&j, "runs", bench_runs);
+	zbx_json_adduint64(&j, "ops", (zbx_uint64_t)ops);
+	bench_add_double(&j, "ns_per_op_best", times[0]);
+	bench_add_double(&j, "ns_per_op_median", times[bench_runs / 2]);
+	bench_add_double(&j, "ops_per_sec", 0 != times[0] ? 1e9 / times[0] : 0);
+
+	printf("%s\n", j.buffer);
+	fflush(stdout);
+
+	zbx_json_free(&j);
+	zbx_free(times);
+
+	bench_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_bench_report_size                                            *
+ *                                                                            *
+ * Purpose: print memory footprint result                                     *
+ *                                                                            *
+ * Parameters: name  - [IN] the measurement name                              *
+ *             count - [IN] the number of stored objects                      *
+ *             bytes - [IN] the memory used to store the objects              *
+ *                                                                            *
+ * Comments: The result is printed as JSON object in the same stream as the   *
+ *           timing results, filtered by the same name filter.                *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_bench_report_size(const char *name, zbx_uint64_t count, zbx_uint64_t bytes)
+{
+	struct zbx_json	j;
+
+	if (NULL != bench_filter && NULL == strstr(name, bench_filter))
+		return;
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(&j, "suite", bench_suite, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&j, "name", name, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&j, "version", ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
+	zbx_json_adduint64(&j, "clock", (zbx_uint64_t)time(NULL));
+	zbx_json_adduint64(&j, "count", count);
+	zbx_json_adduint64(&j, "bytes", bytes);
+	bench_add_double(&j, "bytes_per_object", 0 != count ? (double)bytes / count : 0);
+
+	printf("%s\n", j.buffer);
+	fflush(stdout);
+
+	zbx_json_free(&j);
+
+	bench_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_bench_done                                                   *
+ *                                                                            *
+ * Purpose: finish benchmark suite                                            *
+ *                                                                            *
+ * Return value: exit code for the benchmark program                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_bench_done(void)
+{
+	if (0 == bench_num && NULL != bench_filter)
+		fprintf(stderr, "%s: no benchmarks match \"%s\"\n", progname, bench_filter);
+
+	return EXIT_SUCCESS;
+}
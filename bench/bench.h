@@ -0,0 +1,48 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#ifndef ZABBIX_BENCH_H
+#define ZABBIX_BENCH_H
+
+/* benchmark function, must perform loops iterations of the measured operation set */
+typedef void	(*zbx_bench_func_t)(void *data, int loops);
+
+/* optional setup/cleanup functions called around each timed run */
+typedef void	(*zbx_bench_prepare_func_t)(void *data);
+
+typedef struct
+{
+	const char			*name;
+	zbx_bench_func_t		func;
+	zbx_bench_prepare_func_t	prepare;
+	zbx_bench_prepare_func_t	cleanup;
+	/* the number of measured operations performed in one loop */
+	int				ops_per_loop;
+}
+zbx_bench_t;
+
+void	zbx_bench_init(int argc, char **argv, const char *suite);
+void	zbx_bench_run(const zbx_bench_t *bench, void *data);
+void	zbx_bench_report_size(const char *name, zbx_uint64_t count, zbx_uint64_t bytes);
+int	zbx_bench_done(void);
+
+zbx_uint64_t	zbx_bench_rand(void);
+
+#endif
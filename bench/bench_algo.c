@@ -0,0 +1,499 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#include "common.h"
+#include "zbxalgo.h"
+#include "memalloc.h"
+
+#include "bench.h"
+
+/* the number of elements, close to the item count of a medium size installation */
+#define ALGO_ELEMENTS_NUM	100000
+
+/* shared memory segment for footprint measurements, large enough for any of the measured hashsets */
+#define ALGO_SEGMENT_SIZE	(64 * ZBX_MEBIBYTE)
+
+#define ALGO_HASHSET		0
+#define ALGO_OHASHSET		1
+
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	int		nextcheck;
+	int		status;
+	int		delay;
+	int		flags;
+}
+algo_entry_t;
+
+typedef struct
+{
+	zbx_uint64_t		keys[ALGO_ELEMENTS_NUM];
+	zbx_uint64_t		missing[ALGO_ELEMENTS_NUM];
+	zbx_hashset_t		hashset;
+	zbx_ohashset_t		ohashset;
+	zbx_vector_uint64_t	vector;
+}
+algo_data_t;
+
+static zbx_mem_info_t	*algo_mem;
+
+ZBX_MEM_FUNC_IMPL(__algo, algo_mem)
+
+static void	algo_hashset_create(algo_data_t *data)
+{
+	zbx_hashset_create(&data->hashset, 100, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+}
+
+static void	algo_hashset_fill(algo_data_t *data)
+{
+	algo_entry_t	entry = {0};
+	int		i;
+
+	for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+	{
+		entry.itemid = data->keys[i];
+		zbx_hashset_insert(&data->hashset, &entry, sizeof(entry));
+	}
+}
+
+static void	algo_hashset_prepare(void *d)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+
+	algo_hashset_create(data);
+	algo_hashset_fill(data);
+}
+
+static void	algo_hashset_cleanup(void *d)
+{
+	zbx_hashset_destroy(&((algo_data_t *)d)->hashset);
+}
+
+static void	bench_hashset_insert(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+
+	while (0 < loops--)
+	{
+		algo_hashset_create(data);
+		algo_hashset_fill(data);
+		zbx_hashset_destroy(&data->hashset);
+	}
+}
+
+static void	bench_hashset_search_hit(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			if (NULL == zbx_hashset_search(&data->hashset, &data->keys[i]))
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void	bench_hashset_search_miss(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			if (NULL != zbx_hashset_search(&data->hashset, &data->missing[i]))
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void	bench_hashset_remove_insert(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+			zbx_hashset_remove(&data->hashset, &data->keys[i]);
+
+		algo_hashset_fill(data);
+	}
+}
+
+static void	algo_ohashset_create(algo_data_t *data)
+{
+	zbx_ohashset_create(&data->ohashset, 100, sizeof(algo_entry_t), ZBX_DEFAULT_UINT64_HASH_FUNC,
+			ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+}
+
+static void	algo_ohashset_fill(algo_data_t *data)
+{
+	algo_entry_t	entry = {0};
+	int		i;
+
+	for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+	{
+		entry.itemid = data->keys[i];
+		zbx_ohashset_insert(&data->ohashset, &entry);
+	}
+}
+
+static void	algo_ohashset_prepare(void *d)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+
+	algo_ohashset_create(data);
+	algo_ohashset_fill(data);
+}
+
+static void	algo_ohashset_cleanup(void *d)
+{
+	zbx_ohashset_destroy(&((algo_data_t *)d)->ohashset);
+}
+
+static void	bench_ohashset_insert(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+
+	while (0 < loops--)
+	{
+		algo_ohashset_create(data);
+		algo_ohashset_fill(data);
+		zbx_ohashset_destroy(&data->ohashset);
+	}
+}
+
+static void	bench_ohashset_search_hit(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			if (NULL == zbx_ohashset_search(&data->ohashset, &data->keys[i]))
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void	bench_ohashset_search_miss(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			if (NULL != zbx_ohashset_search(&data->ohashset, &data->missing[i]))
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static void	bench_ohashset_remove_insert(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+			zbx_ohashset_remove(&data->ohashset, &data->keys[i]);
+
+		algo_ohashset_fill(data);
+	}
+}
+
+static int	algo_heap_compare(const void *d1, const void *d2)
+{
+	const zbx_binary_heap_elem_t	*e1 = (const zbx_binary_heap_elem_t *)d1;
+	const zbx_binary_heap_elem_t	*e2 = (const zbx_binary_heap_elem_t *)d2;
+	const algo_entry_t		*i1 = (const algo_entry_t *)e1->data;
+	const algo_entry_t		*i2 = (const algo_entry_t *)e2->data;
+
+	ZBX_RETURN_IF_NOT_EQUAL(i1->nextcheck, i2->nextcheck);
+
+	return 0;
+}
+
+/* the binary heap is used as item queue, the items are scheduled by nextcheck */
+static void	bench_binary_heap_insert_pop(void *d, int loops)
+{
+	algo_data_t		*data = (algo_data_t *)d;
+	zbx_binary_heap_t	heap;
+	zbx_binary_heap_elem_t	elem;
+	algo_entry_t		*entries;
+	int			i;
+
+	entries = (algo_entry_t *)zbx_malloc(NULL, ALGO_ELEMENTS_NUM * sizeof(algo_entry_t));
+
+	for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+	{
+		entries[i].itemid = data->keys[i];
+		entries[i].nextcheck = (int)(data->missing[i] % 3600);
+	}
+
+	while (0 < loops--)
+	{
+		zbx_binary_heap_create(&heap, algo_heap_compare, ZBX_BINARY_HEAP_OPTION_DIRECT);
+
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			elem.key = entries[i].itemid;
+			elem.data = &entries[i];
+			zbx_binary_heap_insert(&heap, &elem);
+		}
+
+		while (SUCCEED != zbx_binary_heap_empty(&heap))
+			zbx_binary_heap_remove_min(&heap);
+
+		zbx_binary_heap_destroy(&heap);
+	}
+
+	zbx_free(entries);
+}
+
+static void	bench_binary_heap_update(void *d, int loops)
+{
+	algo_data_t		*data = (algo_data_t *)d;
+	zbx_binary_heap_t	heap;
+	zbx_binary_heap_elem_t	elem;
+	algo_entry_t		*entries;
+	int			i;
+
+	entries = (algo_entry_t *)zbx_malloc(NULL, ALGO_ELEMENTS_NUM * sizeof(algo_entry_t));
+	zbx_binary_heap_create(&heap, algo_heap_compare, ZBX_BINARY_HEAP_OPTION_DIRECT);
+
+	for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+	{
+		entries[i].itemid = data->keys[i];
+		entries[i].nextcheck = (int)(data->missing[i] % 3600);
+
+		elem.key = entries[i].itemid;
+		elem.data = &entries[i];
+		zbx_binary_heap_insert(&heap, &elem);
+	}
+
+	/* reschedule the items that were polled like pollers do */
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			zbx_binary_heap_elem_t	*min;
+			algo_entry_t		*entry;
+
+			min = zbx_binary_heap_find_min(&heap);
+			entry = (algo_entry_t *)min->data;
+			entry->nextcheck += 30 + (int)(entry->itemid % 300);
+
+			elem.key = entry->itemid;
+			elem.data = entry;
+			zbx_binary_heap_update_direct(&heap, &elem);
+		}
+	}
+
+	zbx_binary_heap_destroy(&heap);
+	zbx_free(entries);
+}
+
+static void	bench_vector_uint64_append(void *d, int loops)
+{
+	algo_data_t		*data = (algo_data_t *)d;
+	zbx_vector_uint64_t	vector;
+	int			i;
+
+	while (0 < loops--)
+	{
+		zbx_vector_uint64_create(&vector);
+
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+			zbx_vector_uint64_append(&vector, data->keys[i]);
+
+		zbx_vector_uint64_destroy(&vector);
+	}
+}
+
+static void	bench_vector_uint64_sort_uniq(void *d, int loops)
+{
+	algo_data_t		*data = (algo_data_t *)d;
+	zbx_vector_uint64_t	vector;
+
+	zbx_vector_uint64_create(&vector);
+
+	while (0 < loops--)
+	{
+		zbx_vector_uint64_clear(&vector);
+
+		/* duplicated identifiers, like itemids collected from triggers */
+		zbx_vector_uint64_append_array(&vector, data->keys, ALGO_ELEMENTS_NUM / 2);
+		zbx_vector_uint64_append_array(&vector, data->keys, ALGO_ELEMENTS_NUM / 2);
+
+		zbx_vector_uint64_sort(&vector, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+		zbx_vector_uint64_uniq(&vector, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	}
+
+	zbx_vector_uint64_destroy(&vector);
+}
+
+static void	algo_vector_prepare(void *d)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+
+	zbx_vector_uint64_create(&data->vector);
+	zbx_vector_uint64_append_array(&data->vector, data->keys, ALGO_ELEMENTS_NUM);
+	zbx_vector_uint64_sort(&data->vector, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+}
+
+static void	algo_vector_cleanup(void *d)
+{
+	zbx_vector_uint64_destroy(&((algo_data_t *)d)->vector);
+}
+
+static void	bench_vector_uint64_bsearch(void *d, int loops)
+{
+	algo_data_t	*data = (algo_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+		{
+			if (FAIL == zbx_vector_uint64_bsearch(&data->vector, data->keys[i],
+					ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: algo_report_footprint                                            *
+ *                                                                            *
+ * Purpose: report shared memory used by a hashset holding the benchmark      *
+ *          entries                                                           *
+ *                                                                            *
+ * Parameters: data  - [IN] the benchmark data                                *
+ *             name  - [IN] the measurement name                              *
+ *             type  - [IN] the hashset type (ALGO_HASHSET, ALGO_OHASHSET)    *
+ *             slabs - [IN] 1 - allocate from slabs like configuration cache  *
+ *                      0 - use the plain shared memory allocator             *
+ *                                                                            *
+ * Comments: Every hashset is filled with the same entries, so the reported   *
+ *           bytes per entry are compared at the same number of entries.      *
+ *           The measured size includes the slot arrays and the allocator     *
+ *           overhead, like the configuration cache memory report.            *
+ *                                                                            *
+ ******************************************************************************/
+static void	algo_report_footprint(algo_data_t *data, const char *name, int type, int slabs)
+{
+	zbx_uint64_t	used;
+
+	zbx_mem_create(&algo_mem, IPC_PRIVATE, ZBX_NO_MUTEX, ALGO_SEGMENT_SIZE, "benchmark", "none", 0);
+
+	if (0 != slabs)
+		zbx_mem_enable_slabs(algo_mem);
+
+	used = zbx_mem_used_size(algo_mem);
+
+	if (ALGO_HASHSET == type)
+	{
+		zbx_hashset_create_ext(&data->hashset, 100, ZBX_DEFAULT_UINT64_HASH_FUNC,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL, __algo_mem_malloc_func, __algo_mem_realloc_func,
+				__algo_mem_free_func);
+		algo_hashset_fill(data);
+		zbx_bench_report_size(name, data->hashset.num_data, zbx_mem_used_size(algo_mem) - used);
+		zbx_hashset_destroy(&data->hashset);
+	}
+	else
+	{
+		zbx_ohashset_create_ext(&data->ohashset, 100, sizeof(algo_entry_t), ZBX_DEFAULT_UINT64_HASH_FUNC,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL, __algo_mem_malloc_func, __algo_mem_realloc_func,
+				__algo_mem_free_func);
+		algo_ohashset_fill(data);
+		zbx_bench_report_size(name, data->ohashset.num_data, zbx_mem_used_size(algo_mem) - used);
+		zbx_ohashset_destroy(&data->ohashset);
+	}
+
+	zbx_mem_destroy(algo_mem);
+	algo_mem = NULL;
+}
+
+int	main(int argc, char **argv)
+{
+	const zbx_bench_t	benches[] = {
+		{"hashset_insert", bench_hashset_insert, NULL, NULL, ALGO_ELEMENTS_NUM},
+		{"hashset_search_hit", bench_hashset_search_hit, algo_hashset_prepare, algo_hashset_cleanup,
+				ALGO_ELEMENTS_NUM},
+		{"hashset_search_miss", bench_hashset_search_miss, algo_hashset_prepare, algo_hashset_cleanup,
+				ALGO_ELEMENTS_NUM},
+		{"hashset_remove_insert", bench_hashset_remove_insert, algo_hashset_prepare, algo_hashset_cleanup,
+				ALGO_ELEMENTS_NUM * 2},
+		{"ohashset_insert", bench_ohashset_insert, NULL, NULL, ALGO_ELEMENTS_NUM},
+		{"ohashset_search_hit", bench_ohashset_search_hit, algo_ohashset_prepare, algo_ohashset_cleanup,
+				ALGO_ELEMENTS_NUM},
+		{"ohashset_search_miss", bench_ohashset_search_miss, algo_ohashset_prepare, algo_ohashset_cleanup,
+				ALGO_ELEMENTS_NUM},
+		{"ohashset_remove_insert", bench_ohashset_remove_insert, algo_ohashset_prepare,
+				algo_ohashset_cleanup, ALGO_ELEMENTS_NUM * 2},
+		{"binary_heap_insert_pop", bench_binary_heap_insert_pop, NULL, NULL, ALGO_ELEMENTS_NUM * 2},
+		{"binary_heap_update", bench_binary_heap_update, NULL, NULL, ALGO_ELEMENTS_NUM},
+		{"vector_uint64_append", bench_vector_uint64_append, NULL, NULL, ALGO_ELEMENTS_NUM},
+		{"vector_uint64_sort_uniq", bench_vector_uint64_sort_uniq, NULL, NULL, ALGO_ELEMENTS_NUM},
+		{"vector_uint64_bsearch", bench_vector_uint64_bsearch, algo_vector_prepare, algo_vector_cleanup,
+				ALGO_ELEMENTS_NUM},
+	};
+	algo_data_t		*data;
+	int			i;
+
+	zbx_bench_init(argc, argv, "algo");
+
+	data = (algo_data_t *)zbx_malloc(NULL, sizeof(algo_data_t));
+
+	/* item identifiers are allocated in ranges, with random gaps between them */
+	for (i = 0; i < ALGO_ELEMENTS_NUM; i++)
+	{
+		data->keys[i] = 10000 + i * 4 + zbx_bench_rand() % 3;
+		data->missing[i] = data->keys[i] + 1000000000;
+	}
+
+	for (i = 0; i < (int)ARRSIZE(benches); i++)
+		zbx_bench_run(&benches[i], data);
+
+	/* memory footprint of the same entries in chained and open addressing hashsets */
+	algo_report_footprint(data, "hashset_footprint", ALGO_HASHSET, 0);
+	algo_report_footprint(data, "hashset_footprint_slabs", ALGO_HASHSET, 1);
+	algo_report_footprint(data, "ohashset_footprint", ALGO_OHASHSET, 0);
+	algo_report_footprint(data, "ohashset_footprint_slabs", ALGO_OHASHSET, 1);
+
+	zbx_free(data);
+
+	return zbx_bench_done();
+}
@@ -0,0 +1,138 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+#include "threads.h"
+#include "zbxexec.h"
+
+#include "bench.h"
+
+/* script execution latency depending on the resident set size of the calling process          */
+/*                                                                                             */
+/* zbx_execute() is measured as built (posix_spawn() where available) against the fork() and   */
+/* exec() sequence it used before. The cost of fork() grows with the number of mapped pages,   */
+/* so the process grows its resident set between the measurements.                            */
+
+#define EXEC_COMMAND	"exit 0"
+#define EXEC_TIMEOUT	30
+
+static const int	exec_rss_mb[] = {0, 256, 1024};
+
+static void	bench_execute(void *d, int loops)
+{
+	char	*buffer = NULL, error[MAX_STRING_LEN];
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		if (SUCCEED != zbx_execute(EXEC_COMMAND, &buffer, error, sizeof(error), EXEC_TIMEOUT))
+		{
+			fprintf(stderr, "cannot execute command: %s\n", error);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	zbx_free(buffer);
+}
+
+/* the way zbx_execute() started scripts before posix_spawn() support */
+static void	bench_fork_execute(void *d, int loops)
+{
+	int	fd[2];
+	pid_t	pid;
+	char	buffer[MAX_STRING_LEN];
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		if (-1 == pipe(fd) || -1 == (pid = zbx_fork()))
+		{
+			fprintf(stderr, "cannot start command: %s\n", zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		if (0 == pid)
+		{
+			close(fd[0]);
+			setpgid(0, 0);
+			dup2(fd[1], STDOUT_FILENO);
+			dup2(fd[1], STDERR_FILENO);
+			close(fd[1]);
+			execl("/bin/sh", "sh", "-c", EXEC_COMMAND, NULL);
+			exit(EXIT_FAILURE);
+		}
+
+		close(fd[1]);
+
+		while (0 < read(fd[0], buffer, sizeof(buffer)))
+			;
+
+		close(fd[0]);
+		waitpid(pid, NULL, 0);
+	}
+}
+
+int	main(int argc, char **argv)
+{
+	zbx_bench_t	benches[2];
+	char		*rss = NULL, *names[2];
+	size_t		rss_size = 0, size;
+	int		i;
+
+	zbx_bench_init(argc, argv, "exec");
+
+	benches[0].func = bench_execute;
+	benches[1].func = bench_fork_execute;
+
+	for (i = 0; i < 2; i++)
+	{
+		benches[i].prepare = NULL;
+		benches[i].cleanup = NULL;
+		benches[i].ops_per_loop = 1;
+	}
+
+	for (i = 0; i < (int)ARRSIZE(exec_rss_mb); i++)
+	{
+		size = (size_t)exec_rss_mb[i] * ZBX_MEBIBYTE;
+
+		/* touch every page, so the memory is mapped like the caches of a running server */
+		if (rss_size < size)
+		{
+			rss = (char *)zbx_realloc(rss, size);
+			memset(rss + rss_size, 1, size - rss_size);
+			rss_size = size;
+		}
+
+		benches[0].name = names[0] = zbx_dsprintf(NULL, "execute_rss_%dmb", exec_rss_mb[i]);
+		benches[1].name = names[1] = zbx_dsprintf(NULL, "fork_execute_rss_%dmb", exec_rss_mb[i]);
+
+		zbx_bench_run(&benches[0], NULL);
+		zbx_bench_run(&benches[1], NULL);
+
+		zbx_free(names[0]);
+		zbx_free(names[1]);
+	}
+
+	zbx_free(rss);
+
+	return zbx_bench_done();
+}
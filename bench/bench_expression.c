@@ -0,0 +1,262 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#include "common.h"
+#include "zbxalgo.h"
+
+#include "bench.h"
+
+static const char	*expression_keys[] = {
+	"system.cpu.util[,user,avg1]",
+	"vfs.fs.size[{$MOUNT},pfree]",
+	"net.if.in[\"{#IFNAME}\",bytes]",
+	"proc.num[httpd,apache,,\"-DFOREGROUND\"]",
+	"log[/var/log/messages,\"error|fail\",,100,skip]",
+	"web.page.regexp[{$WEB.HOST},/status,{$WEB.PORT},\"uptime: ([0-9]+)\",,\\1]",
+	"jmx[\"java.lang:type=GarbageCollector,name=PS MarkSweep\",CollectionCount]",
+	"agent.ping"
+};
+
+/* trigger expressions with functionids and user macros as stored in database */
+static const char	*expression_triggers[] = {
+	"{13475}>{$CPU.UTIL.CRIT}",
+	"{13476}<{$FS.PFREE.MIN:\"/var/lib/mysql\"} and {13477}<>0",
+	"({13478}>1.5*{13479} or {13480}>90) and {13481}=0",
+	"{13482}=0 or ({13483}>{$LOAD.MAX} and {13484}>5m)",
+	"({13485}-{13486})/{13487}*100>{$DIFF.PCT}"
+};
+
+typedef struct
+{
+	const char	*name;
+	const char	*value;
+}
+expression_macro_t;
+
+static const expression_macro_t	expression_macros[] = {
+	{"{$MOUNT}", "/var/lib/mysql"},
+	{"{#IFNAME}", "eth0"},
+	{"{$WEB.HOST}", "www.example.com"},
+	{"{$WEB.PORT}", "8080"},
+	{"{$CPU.UTIL.CRIT}", "90"},
+	{"{$FS.PFREE.MIN:\"/var/lib/mysql\"}", "10"},
+	{"{$LOAD.MAX}", "4"},
+	{"{$DIFF.PCT}", "20"}
+};
+
+static const char	*expression_macro_value(const char *macro, size_t len)
+{
+	int	i;
+
+	for (i = 0; i < (int)ARRSIZE(expression_macros); i++)
+	{
+		if (0 == strncmp(expression_macros[i].name, macro, len) && '\0' == expression_macros[i].name[len])
+			return expression_macros[i].value;
+	}
+
+	return NULL;
+}
+
+static void	bench_parse_key(void *d, int loops)
+{
+	int	i;
+	char	*ptr;
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < (int)ARRSIZE(expression_keys); i++)
+		{
+			ptr = (char *)expression_keys[i];
+
+			if (SUCCEED != parse_key(&ptr))
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+
+static int	expression_replace_key_param(const char *data, int key_type, int level, int num, int quoted,
+		void *cb_data, char **param)
+{
+	const char	*value;
+
+	ZBX_UNUSED(key_type);
+	ZBX_UNUSED(num);
+	ZBX_UNUSED(quoted);
+	ZBX_UNUSED(cb_data);
+
+	if (0 == level || NULL == strchr(data, '{'))
+		return SUCCEED;
+
+	if (NULL != (value = expression_macro_value(data, strlen(data))))
+		*param = zbx_strdup(NULL, value);
+
+	return SUCCEED;
+}
+
+/* the parameter parsing and macro replacement part of item key macro substitution */
+static void	bench_replace_key_params(void *d, int loops)
+{
+	int	i;
+	char	*key, error[MAX_STRING_LEN];
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < (int)ARRSIZE(expression_keys); i++)
+		{
+			key = zbx_strdup(NULL, expression_keys[i]);
+
+			if (SUCCEED != replace_key_params_dyn(&key, ZBX_KEY_TYPE_ITEM, expression_replace_key_param, NULL,
+					error, sizeof(error)))
+			{
+				exit(EXIT_FAILURE);
+			}
+
+			zbx_free(key);
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: expression_substitute                                            *
+ *                                                                            *
+ * Purpose: replace functionids with their values and user macros with their  *
+ *          values, like trigger expression is prepared for evaluation        *
+ *                                                                            *
+ ******************************************************************************/
+static char	*expression_substitute(const char *expression)
+{
+	zbx_token_t	token;
+	char		*out = NULL;
+	const char	*value;
+	size_t		out_alloc = 0, out_offset = 0;
+	int		pos = 0;
+
+	while (SUCCEED == zbx_token_find(expression, pos, &token))
+	{
+		zbx_strncpy_alloc(&out, &out_alloc, &out_offset, expression + pos, token.token.l - pos);
+
+		switch (token.type)
+		{
+			case ZBX_TOKEN_OBJECTID:
+				/* function values are derived from functionid to keep them stable */
+				value = (0 == atoi(expression + token.token.l + 1) % 2 ? "95.5" : "3");
+				break;
+			case ZBX_TOKEN_USER_MACRO:
+				value = expression_macro_value(expression + token.token.l,
+						token.token.r - token.token.l + 1);
+				break;
+			default:
+				value = NULL;
+		}
+
+		if (NULL == value)
+			exit(EXIT_FAILURE);
+
+		zbx_strcpy_alloc(&out, &out_alloc, &out_offset, value);
+		pos = token.token.r + 1;
+	}
+
+	zbx_strcpy_alloc(&out, &out_alloc, &out_offset, expression + pos);
+
+	return out;
+}
+
+static void	bench_substitute_trigger(void *d, int loops)
+{
+	int	i;
+	char	*expression;
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < (int)ARRSIZE(expression_triggers); i++)
+		{
+			expression = expression_substitute(expression_triggers[i]);
+			zbx_free(expression);
+		}
+	}
+}
+
+typedef struct
+{
+	char	*expressions[ARRSIZE(expression_triggers)];
+}
+expression_data_t;
+
+static void	expression_evaluate_prepare(void *d)
+{
+	expression_data_t	*data = (expression_data_t *)d;
+	int			i;
+
+	for (i = 0; i < (int)ARRSIZE(expression_triggers); i++)
+		data->expressions[i] = expression_substitute(expression_triggers[i]);
+}
+
+static void	expression_evaluate_cleanup(void *d)
+{
+	expression_data_t	*data = (expression_data_t *)d;
+	int			i;
+
+	for (i = 0; i < (int)ARRSIZE(expression_triggers); i++)
+		zbx_free(data->expressions[i]);
+}
+
+static void	bench_evaluate(void *d, int loops)
+{
+	expression_data_t	*data = (expression_data_t *)d;
+	int			i;
+	double			value;
+	char			error[MAX_STRING_LEN];
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < (int)ARRSIZE(expression_triggers); i++)
+		{
+			if (SUCCEED != evaluate(&value, data->expressions[i], error, sizeof(error), NULL))
+				exit(EXIT_FAILURE);
+		}
+	}
+}
+
+int	main(int argc, char **argv)
+{
+	const zbx_bench_t	benches[] = {
+		{"parse_key", bench_parse_key, NULL, NULL, ARRSIZE(expression_keys)},
+		{"replace_key_params", bench_replace_key_params, NULL, NULL, ARRSIZE(expression_keys)},
+		{"substitute_trigger_macros", bench_substitute_trigger, NULL, NULL, ARRSIZE(expression_triggers)},
+		{"evaluate_trigger", bench_evaluate, expression_evaluate_prepare, expression_evaluate_cleanup,
+				ARRSIZE(expression_triggers)},
+	};
+	expression_data_t	data;
+	int			i;
+
+	zbx_bench_init(argc, argv, "expression");
+
+	for (i = 0; i < (int)ARRSIZE(benches); i++)
+		zbx_bench_run(&benches[i], &data);
+
+	return zbx_bench_done();
+}
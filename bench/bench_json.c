@@ -0,0 +1,174 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#include "common.h"
+#include "zbxjson.h"
+
+#include "bench.h"
+
+/* the number of values in a proxy history data batch, matches ZBX_MAX_HRECORDS */
+#define JSON_BATCH_VALUES	1000
+#define JSON_BATCH_HOSTS	50
+
+typedef struct
+{
+	char	*batch;
+}
+json_data_t;
+
+static const char	*json_keys[] = {
+	"system.cpu.util[,user,avg1]",
+	"vfs.fs.size[/var/lib/mysql,pfree]",
+	"net.if.in[eth0,bytes]",
+	"proc.num[httpd,apache,,\"-DFOREGROUND\"]",
+	"log[/var/log/messages,\"error|fail\",,100,skip]",
+	"web.page.regexp[www.example.com,/status,80,\"uptime: ([0-9]+)\",,\\1]"
+};
+
+static const char	*json_values[] = {
+	"12.500000",
+	"1457825",
+	"0",
+	"Mar 12 10:22:01 web01 kernel: [123456.789] eth0: link up, 1000Mbps, full-duplex, lpa 0x45E1",
+	"{\"status\":\"ok\",\"connections\":12,\"path\":\"C:\\\\Program Files\\\\Zabbix\"}"
+};
+
+/* build proxy history data batch like the proxy does before sending it to server */
+static void	json_build_batch(struct zbx_json *j, int offset)
+{
+	char	host[MAX_STRING_LEN];
+	int	i;
+
+	zbx_json_init(j, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_HISTORY_DATA, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(j, ZBX_PROTO_TAG_HOST, "proxy-eu-west-1", ZBX_JSON_TYPE_STRING);
+	zbx_json_addarray(j, ZBX_PROTO_TAG_DATA);
+
+	for (i = 0; i < JSON_BATCH_VALUES; i++)
+	{
+		int	n = offset + i;
+
+		zbx_snprintf(host, sizeof(host), "app-server-%03d.example.com", n % JSON_BATCH_HOSTS);
+
+		zbx_json_addobject(j, NULL);
+		zbx_json_addstring(j, ZBX_PROTO_TAG_HOST, host, ZBX_JSON_TYPE_STRING);
+		zbx_json_addstring(j, ZBX_PROTO_TAG_KEY, json_keys[n % ARRSIZE(json_keys)], ZBX_JSON_TYPE_STRING);
+		zbx_json_adduint64(j, ZBX_PROTO_TAG_CLOCK, 1500000000 + n / 10);
+		zbx_json_adduint64(j, ZBX_PROTO_TAG_NS, (n * 7919) % 1000000000);
+		zbx_json_addstring(j, ZBX_PROTO_TAG_VALUE, json_values[n % ARRSIZE(json_values)],
+				ZBX_JSON_TYPE_STRING);
+		zbx_json_close(j);
+	}
+
+	zbx_json_close(j);
+}
+
+static void	bench_json_build(void *d, int loops)
+{
+	struct zbx_json	j;
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		json_build_batch(&j, loops);
+		zbx_json_free(&j);
+	}
+}
+
+/* parse batch the same way as server parses proxy history data */
+static void	bench_json_parse(void *d, int loops)
+{
+	json_data_t		*data = (json_data_t *)d;
+	struct zbx_json_parse	jp, jp_data, jp_row;
+	const char		*p;
+	char			host[MAX_STRING_LEN], key[MAX_STRING_LEN], tmp[MAX_STRING_LEN], *value = NULL;
+	size_t			value_alloc = 0;
+	int			values;
+
+	while (0 < loops--)
+	{
+		if (SUCCEED != zbx_json_open(data->batch, &jp) ||
+				SUCCEED != zbx_json_brackets_by_name(&jp, ZBX_PROTO_TAG_DATA, &jp_data))
+		{
+			exit(EXIT_FAILURE);
+		}
+
+		for (p = NULL, values = 0; NULL != (p = zbx_json_next(&jp_data, p)); values++)
+		{
+			if (SUCCEED != zbx_json_brackets_open(p, &jp_row) ||
+					SUCCEED != zbx_json_value_by_name(&jp_row, ZBX_PROTO_TAG_HOST, host,
+							sizeof(host)) ||
+					SUCCEED != zbx_json_value_by_name(&jp_row, ZBX_PROTO_TAG_KEY, key,
+							sizeof(key)) ||
+					SUCCEED != zbx_json_value_by_name(&jp_row, ZBX_PROTO_TAG_CLOCK, tmp,
+							sizeof(tmp)) ||
+					SUCCEED != zbx_json_value_by_name(&jp_row, ZBX_PROTO_TAG_NS, tmp,
+							sizeof(tmp)) ||
+					SUCCEED != zbx_json_value_by_name_dyn(&jp_row, ZBX_PROTO_TAG_VALUE, &value,
+							&value_alloc))
+			{
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		if (JSON_BATCH_VALUES != values)
+			exit(EXIT_FAILURE);
+	}
+
+	zbx_free(value);
+}
+
+static void	bench_json_validate(void *d, int loops)
+{
+	json_data_t		*data = (json_data_t *)d;
+	struct zbx_json_parse	jp;
+
+	while (0 < loops--)
+	{
+		if (SUCCEED != zbx_json_open(data->batch, &jp))
+			exit(EXIT_FAILURE);
+	}
+}
+
+int	main(int argc, char **argv)
+{
+	const zbx_bench_t	benches[] = {
+		{"json_build_history_batch", bench_json_build, NULL, NULL, JSON_BATCH_VALUES},
+		{"json_open_history_batch", bench_json_validate, NULL, NULL, JSON_BATCH_VALUES},
+		{"json_parse_history_batch", bench_json_parse, NULL, NULL, JSON_BATCH_VALUES},
+	};
+	json_data_t		data;
+	struct zbx_json		j;
+	int			i;
+
+	zbx_bench_init(argc, argv, "json");
+
+	json_build_batch(&j, 0);
+	data.batch = zbx_strdup(NULL, j.buffer);
+	zbx_json_free(&j);
+
+	for (i = 0; i < (int)ARRSIZE(benches); i++)
+		zbx_bench_run(&benches[i], &data);
+
+	zbx_free(data.batch);
+
+	return zbx_bench_done();
+}
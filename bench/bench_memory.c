@@ -0,0 +1,171 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#include "common.h"
+#include "memalloc.h"
+
+#include "bench.h"
+
+/* shared memory allocator trace replay                                             */
+/*                                                                                  */
+/* The trace mimics configuration and history cache workload - mostly small hashset */
+/* entries and strings with occasional larger values and slot array reallocations.  */
+
+#define MEM_SEGMENT_SIZE	(64 * ZBX_MEBIBYTE)
+#define MEM_TRACE_SLOTS		50000
+#define MEM_TRACE_OPS		200000
+
+#define MEM_OP_MALLOC		0
+#define MEM_OP_REALLOC		1
+#define MEM_OP_FREE		2
+
+typedef struct
+{
+	int		slot;
+	int		op;
+	size_t		size;
+}
+mem_trace_op_t;
+
+typedef struct
+{
+	zbx_mem_info_t	*info;
+	mem_trace_op_t	*ops;
+	void		**slots;
+}
+mem_data_t;
+
+static size_t	mem_trace_size(void)
+{
+	int	r = (int)(zbx_bench_rand() % 100);
+
+	if (60 > r)
+		return 16 + zbx_bench_rand() % 48;
+
+	if (85 > r)
+		return 64 + zbx_bench_rand() % 192;
+
+	if (99 > r)
+		return 256 + zbx_bench_rand() % 1792;
+
+	return 2048 + zbx_bench_rand() % (14 * ZBX_KIBIBYTE);
+}
+
+static void	mem_trace_create(mem_data_t *data)
+{
+	int	i;
+	char	*used;
+
+	data->ops = (mem_trace_op_t *)zbx_malloc(NULL, MEM_TRACE_OPS * sizeof(mem_trace_op_t));
+	used = (char *)zbx_calloc(NULL, MEM_TRACE_SLOTS, 1);
+
+	for (i = 0; i < MEM_TRACE_OPS; i++)
+	{
+		mem_trace_op_t	*op = &data->ops[i];
+
+		op->slot = (int)(zbx_bench_rand() % MEM_TRACE_SLOTS);
+		op->size = mem_trace_size();
+
+		if (0 == used[op->slot])
+		{
+			op->op = MEM_OP_MALLOC;
+			used[op->slot] = 1;
+		}
+		else if (0 == zbx_bench_rand() % 4)
+		{
+			op->op = MEM_OP_REALLOC;
+		}
+		else
+		{
+			op->op = MEM_OP_FREE;
+			used[op->slot] = 0;
+		}
+	}
+
+	zbx_free(used);
+}
+
+static void	mem_prepare(void *d)
+{
+	mem_data_t	*data = (mem_data_t *)d;
+
+	zbx_mem_clear(data->info);
+	memset(data->slots, 0, MEM_TRACE_SLOTS * sizeof(void *));
+}
+
+static void	bench_mem_trace(void *d, int loops)
+{
+	mem_data_t	*data = (mem_data_t *)d;
+	int		i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < MEM_TRACE_OPS; i++)
+		{
+			const mem_trace_op_t	*op = &data->ops[i];
+
+			switch (op->op)
+			{
+				case MEM_OP_MALLOC:
+					data->slots[op->slot] = zbx_mem_malloc(data->info, NULL, op->size);
+					break;
+				case MEM_OP_REALLOC:
+					data->slots[op->slot] = zbx_mem_realloc(data->info, data->slots[op->slot],
+							op->size);
+					break;
+				case MEM_OP_FREE:
+					zbx_mem_free(data->info, data->slots[op->slot]);
+					break;
+			}
+		}
+
+		for (i = 0; i < MEM_TRACE_SLOTS; i++)
+		{
+			if (NULL != data->slots[i])
+				zbx_mem_free(data->info, data->slots[i]);
+		}
+	}
+}
+
+int	main(int argc, char **argv)
+{
+	const zbx_bench_t	bench_plain = {"mem_trace", bench_mem_trace, mem_prepare, NULL, MEM_TRACE_OPS};
+	const zbx_bench_t	bench_slabs = {"mem_trace_slabs", bench_mem_trace, mem_prepare, NULL, MEM_TRACE_OPS};
+	mem_data_t		data;
+
+	zbx_bench_init(argc, argv, "memory");
+
+	mem_trace_create(&data);
+	data.slots = (void **)zbx_malloc(NULL, MEM_TRACE_SLOTS * sizeof(void *));
+
+	zbx_mem_create(&data.info, IPC_PRIVATE, ZBX_NO_MUTEX, MEM_SEGMENT_SIZE, "benchmark", "none", 0);
+	zbx_bench_run(&bench_plain, &data);
+	zbx_mem_destroy(data.info);
+
+	zbx_mem_create(&data.info, IPC_PRIVATE, ZBX_NO_MUTEX, MEM_SEGMENT_SIZE, "benchmark", "none", 0);
+	zbx_mem_enable_slabs(data.info);
+	zbx_bench_run(&bench_slabs, &data);
+	zbx_mem_destroy(data.info);
+
+	zbx_free(data.slots);
+	zbx_free(data.ops);
+
+	return zbx_bench_done();
+}
@@ -0,0 +1,133 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+
+#include "common.h"
+#include "zbxregexp.h"
+
+#include "bench.h"
+
+/* log lines like the ones matched by log[] items and log filtering global regular expressions */
+static const char	*regexp_lines[] = {
+	"Mar 12 10:22:01 web01 kernel: [123456.789] eth0: link up, 1000Mbps, full-duplex, lpa 0x45E1",
+	"Mar 12 10:22:03 web01 sshd[2211]: Failed password for invalid user admin from 10.1.2.3 port 52214 ssh2",
+	"Mar 12 10:22:04 db02 mysqld[991]: [ERROR] InnoDB: Unable to lock ./ibdata1 error: 11",
+	"2017-03-12 10:22:05,123 INFO  [main] org.example.App - request completed in 125 ms",
+	"Mar 12 10:22:07 web01 CRON[3312]: (root) CMD (/usr/lib/zabbix/externalscripts/backup.sh)",
+	"127.0.0.1 - - [12/Mar/2017:10:22:08 +0000] \"GET /index.php?page=2 HTTP/1.1\" 500 1532"
+};
+
+#define REGEXP_LINES_NUM	((int)ARRSIZE(regexp_lines))
+
+static void	bench_regexp_match(void *d, int loops)
+{
+	int	i, len;
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < REGEXP_LINES_NUM; i++)
+			zbx_regexp_match(regexp_lines[i], "(error|fail|critical)", &len);
+	}
+}
+
+static void	bench_iregexp_match(void *d, int loops)
+{
+	int	i, len;
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < REGEXP_LINES_NUM; i++)
+			zbx_iregexp_match(regexp_lines[i], "(error|fail|critical)", &len);
+	}
+}
+
+/* value extraction with output template like log[] and web.page.regexp[] items do */
+static void	bench_regexp_sub(void *d, int loops)
+{
+	int	i;
+	char	*out = NULL;
+
+	ZBX_UNUSED(d);
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < REGEXP_LINES_NUM; i++)
+		{
+			zbx_regexp_sub(regexp_lines[i], "([0-9]+) (ms|Mbps|error)", "\\1", &out);
+			zbx_free(out);
+		}
+	}
+}
+
+static void	regexp_global_prepare(void *d)
+{
+	zbx_vector_ptr_t	*regexps = (zbx_vector_ptr_t *)d;
+
+	add_regexp_ex(regexps, "Log errors", "error|fail", EXPRESSION_TYPE_TRUE, ',', ZBX_IGNORE_CASE);
+	add_regexp_ex(regexps, "Log errors", "CRON,sshd", EXPRESSION_TYPE_ANY_INCLUDED, ',', ZBX_CASE_SENSITIVE);
+	add_regexp_ex(regexps, "Log errors", "DEBUG", EXPRESSION_TYPE_NOT_INCLUDED, ',', ZBX_CASE_SENSITIVE);
+	add_regexp_ex(regexps, "Mounted filesystems", "^(ext3|ext4|xfs|btrfs)$", EXPRESSION_TYPE_TRUE, ',',
+			ZBX_CASE_SENSITIVE);
+}
+
+static void	regexp_global_cleanup(void *d)
+{
+	zbx_regexp_clean_expressions((zbx_vector_ptr_t *)d);
+}
+
+/* global regular expression with several expressions, like used in log item filters */
+static void	bench_regexp_match_global(void *d, int loops)
+{
+	const zbx_vector_ptr_t	*regexps = (const zbx_vector_ptr_t *)d;
+	int			i;
+
+	while (0 < loops--)
+	{
+		for (i = 0; i < REGEXP_LINES_NUM; i++)
+			regexp_match_ex(regexps, regexp_lines[i], "@Log errors", ZBX_CASE_SENSITIVE);
+	}
+}
+
+int	main(int argc, char **argv)
+{
+	const zbx_bench_t	benches[] = {
+		{"regexp_match", bench_regexp_match, NULL, NULL, REGEXP_LINES_NUM},
+		{"iregexp_match", bench_iregexp_match, NULL, NULL, REGEXP_LINES_NUM},
+		{"regexp_sub", bench_regexp_sub, NULL, NULL, REGEXP_LINES_NUM},
+		{"regexp_match_global", bench_regexp_match_global, regexp_global_prepare, regexp_global_cleanup,
+				REGEXP_LINES_NUM},
+	};
+	zbx_vector_ptr_t	regexps;
+	int			i;
+
+	zbx_bench_init(argc, argv, "regexp");
+
+	zbx_vector_ptr_create(&regexps);
+
+	for (i = 0; i < (int)ARRSIZE(benches); i++)
+		zbx_bench_run(&benches[i], &regexps);
+
+	zbx_vector_ptr_destroy(&regexps);
+
+	return zbx_bench_done();
+}
@@ -0,0 +1,1056 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+
+#include "threads.h"
+#include "comms.h"
+#include "cfg.h"
+#include "log.h"
+#include "zbxgetopt.h"
+#include "zbxjson.h"
+#include "zbxdb.h"
+#include "version.h"
+
+const char	*progname = NULL;
+const char	title_message[] = "zabbix_loadgen";
+const char	syslog_app_name[] = "zabbix_loadgen";
+
+const char	*usage_message[] = {
+	"[-z server]", "[-p port]", "[-c config-file]", "[-n nvps]", "[-C connections]", "[-b batch]",
+	"[-d duration]", "[-H hosts]", "[-i items]", "[-P host-prefix]", "[-l probe-interval]", NULL,
+	"-c config-file", "-S", "[-H hosts]", "[-i items]", "[-P host-prefix]", NULL,
+	"-h", NULL,
+	"-V", NULL,
+	NULL	/* end of text */
+};
+
+unsigned char	program_type	= ZBX_PROGRAM_TYPE_SENDER;
+
+const char	*help_message[] = {
+	"Utility for sending synthetic load to Zabbix server or proxy trapper and",
+	"measuring ingestion latency.",
+	"",
+	"Values are sent with \"sender data\" requests without timestamps, so they are",
+	"stamped with the receive time by the trapper. When configuration file is",
+	"given, probe values are sent to a separate item and the history and event",
+	"tables are polled to measure latency from receive to database commit and to",
+	"trigger evaluation.",
+	"",
+	"Options:",
+	"  -z --zabbix-server server  Hostname or IP address of Zabbix server or proxy",
+	"                             (default: 127.0.0.1)",
+	"  -p --port port             Trapper port (default: ListenPort from",
+	"                             configuration file or " ZBX_DEFAULT_SERVER_PORT_STR ")",
+	"  -c --config config-file    Absolute path to Zabbix server configuration file,",
+	"                             used for database connection",
+	"  -n --nvps nvps             Target number of values per second (default: 1000)",
+	"  -C --connections count     Number of concurrent sender connections",
+	"                             (default: 4)",
+	"  -b --batch count           Number of values per request (default: 250)",
+	"  -d --duration seconds      Test duration (default: 60)",
+	"  -H --hosts count           Number of synthetic hosts (default: 100)",
+	"  -i --items count           Number of items per host (default: 10)",
+	"  -P --host-prefix prefix    Synthetic host name prefix (default: loadgen-)",
+	"  -l --probe-interval ms     Interval between latency probes in milliseconds",
+	"                             (default: 100)",
+	"  -S --setup                 Create synthetic hosts, items and probe trigger",
+	"                             in the database and exit",
+	"  -h --help                  Display this help message",
+	"  -V --version               Display version number",
+	"",
+	"Synthetic hosts are named <host-prefix>1 .. <host-prefix>N, items have keys",
+	"loadgen.item[1] .. loadgen.item[M]. The first host also has loadgen.probe item",
+	"with trigger generating an event for every received value. Configuration",
+	"cache must be reloaded after setup (zabbix_server -R config_cache_reload).",
+	"",
+	"Results are printed as a single JSON object, latencies are in milliseconds.",
+	"",
+	"Example(s):",
+	"  zabbix_loadgen -c /etc/zabbix/zabbix_server.conf -S -H 1000 -i 20",
+	"  zabbix_loadgen -c /etc/zabbix/zabbix_server.conf -H 1000 -i 20 -n 20000 -C 16",
+	NULL	/* end of text */
+};
+
+/* TLS parameters, not used in zabbix_loadgen, just for linking with tls.c */
+unsigned int	configured_tls_connect_mode = ZBX_TCP_SEC_UNENCRYPTED;
+unsigned int	configured_tls_accept_modes = ZBX_TCP_SEC_UNENCRYPTED;
+
+char	*CONFIG_TLS_CONNECT		= NULL;
+char	*CONFIG_TLS_ACCEPT		= NULL;
+char	*CONFIG_TLS_CA_FILE		= NULL;
+char	*CONFIG_TLS_CRL_FILE		= NULL;
+char	*CONFIG_TLS_SERVER_CERT_ISSUER	= NULL;
+char	*CONFIG_TLS_SERVER_CERT_SUBJECT	= NULL;
+char	*CONFIG_TLS_CERT_FILE		= NULL;
+char	*CONFIG_TLS_KEY_FILE		= NULL;
+char	*CONFIG_TLS_PSK_IDENTITY	= NULL;
+char	*CONFIG_TLS_PSK_FILE		= NULL;
+
+int	CONFIG_PASSIVE_FORKS		= 0;
+int	CONFIG_ACTIVE_FORKS		= 0;
+
+/* referenced by database library */
+int	CONFIG_LOG_SLOW_QUERIES		= 0;
+
+/* COMMAND LINE OPTIONS */
+
+/* long options */
+static struct zbx_option	longopts[] =
+{
+	{"zabbix-server",	1,	NULL,	'z'},
+	{"port",		1,	NULL,	'p'},
+	{"config",		1,	NULL,	'c'},
+	{"nvps",		1,	NULL,	'n'},
+	{"connections",		1,	NULL,	'C'},
+	{"batch",		1,	NULL,	'b'},
+	{"duration",		1,	NULL,	'd'},
+	{"hosts",		1,	NULL,	'H'},
+	{"items",		1,	NULL,	'i'},
+	{"host-prefix",		1,	NULL,	'P'},
+	{"probe-interval",	1,	NULL,	'l'},
+	{"setup",		0,	NULL,	'S'},
+	{"help",		0,	NULL,	'h'},
+	{"version",		0,	NULL,	'V'},
+	{NULL}
+};
+
+/* short options */
+static char	shortopts[] = "z:p:c:n:C:b:d:H:i:P:l:ShV";
+
+/* end of COMMAND LINE OPTIONS */
+
+#define LOADGEN_PROBE_KEY	"loadgen.probe"
+#define LOADGEN_ITEM_KEY	"loadgen.item"
+
+#define LOADGEN_PROBE_TIMEOUT	30	/* seconds to wait for a probe value to appear in database */
+#define LOADGEN_POLL_INTERVAL	1000000	/* nanoseconds between database polls */
+
+/* latency histogram with logarithmic buckets from 1 microsecond to 100 seconds */
+#define LOADGEN_HIST_DECADES	8
+#define LOADGEN_HIST_STEPS	50	/* buckets per decade, ~4.7% resolution */
+#define LOADGEN_HIST_BUCKETS	(LOADGEN_HIST_DECADES * LOADGEN_HIST_STEPS)
+
+typedef struct
+{
+	zbx_uint64_t	count;
+	double		min;
+	double		max;
+	double		sum;
+	zbx_uint64_t	buckets[LOADGEN_HIST_BUCKETS];
+}
+zbx_loadgen_hist_t;
+
+/* sender process statistics, passed to the parent process through a pipe */
+typedef struct
+{
+	zbx_uint64_t		values_sent;
+	zbx_uint64_t		values_processed;
+	zbx_uint64_t		values_failed;
+	zbx_uint64_t		requests;
+	zbx_uint64_t		requests_failed;
+	zbx_loadgen_hist_t	ack;
+}
+zbx_loadgen_stats_t;
+
+static char		*CONFIG_SERVER = NULL;
+static unsigned short	CONFIG_SERVER_PORT = 0;
+static char		*CONFIG_HOST_PREFIX = NULL;
+static int		CONFIG_NVPS = 1000;
+static int		CONFIG_CONNECTIONS = 4;
+static int		CONFIG_BATCH = 250;
+static int		CONFIG_DURATION = 60;
+static int		CONFIG_HOSTS = 100;
+static int		CONFIG_ITEMS = 10;
+static int		CONFIG_PROBE_INTERVAL = 100;
+
+static char	*CONFIG_DBHOST = NULL;
+static char	*CONFIG_DBNAME = NULL;
+static char	*CONFIG_DBSCHEMA = NULL;
+static char	*CONFIG_DBUSER = NULL;
+static char	*CONFIG_DBPASSWORD = NULL;
+static char	*CONFIG_DBSOCKET = NULL;
+static int	CONFIG_DBPORT = 0;
+static int	CONFIG_LISTEN_PORT = ZBX_DEFAULT_SERVER_PORT;
+
+static void	loadgen_hist_add(zbx_loadgen_hist_t *hist, double seconds)
+{
+	double	us = seconds * 1000000;
+	int	index = 0;
+
+	if (1 < us)
+	{
+		index = (int)(log10(us) * LOADGEN_HIST_STEPS);
+
+		if (LOADGEN_HIST_BUCKETS <= index)
+			index = LOADGEN_HIST_BUCKETS - 1;
+	}
+
+	if (0 == hist->count || seconds < hist->min)
+		hist->min = seconds;
+
+	if (0 == hist->count || seconds > hist->max)
+		hist->max = seconds;
+
+	hist->sum += seconds;
+	hist->count++;
+	hist->buckets[index]++;
+}
+
+static void	loadgen_hist_merge(zbx_loadgen_hist_t *dst, const zbx_loadgen_hist_t *src)
+{
+	int	i;
+
+	if (0 == src->count)
+		return;
+
+	if (0 == dst->count || src->min < dst->min)
+		dst->min = src->min;
+
+	if (0 == dst->count || src->max > dst->max)
+		dst->max = src->max;
+
+	dst->sum += src->sum;
+	dst->count += src->count;
+
+	for (i = 0; i < LOADGEN_HIST_BUCKETS; i++)
+		dst->buckets[i] += src->buckets[i];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_hist_percentile                                          *
+ *                                                                            *
+ * Purpose: get the latency percentile from histogram                         *
+ *                                                                            *
+ * Parameters: hist    - [IN] the histogram                                   *
+ *             percent - [IN] the percentile (0-100)                          *
+ *                                                                            *
+ * Return value: The upper bound of the bucket containing the percentile in   *
+ *               seconds, limited by the maximum measured latency.            *
+ *                                                                            *
+ ******************************************************************************/
+static double	loadgen_hist_percentile(const zbx_loadgen_hist_t *hist, double percent)
+{
+	zbx_uint64_t	rank, count = 0;
+	double		value;
+	int		i;
+
+	if (0 == hist->count)
+		return 0;
+
+	if (0 == (rank = (zbx_uint64_t)ceil(hist->count * percent / 100)))
+		rank = 1;
+
+	for (i = 0; i < LOADGEN_HIST_BUCKETS - 1; i++)
+	{
+		if (rank <= (count += hist->buckets[i]))
+			break;
+	}
+
+	value = pow(10, (double)(i + 1) / LOADGEN_HIST_STEPS) / 1000000;
+
+	return MIN(value, hist->max);
+}
+
+static void	loadgen_add_double(struct zbx_json *j, const char *name, double value)
+{
+	char	buffer[MAX_STRING_LEN];
+
+	zbx_snprintf(buffer, sizeof(buffer), "%.3f", value);
+	zbx_json_addstring(j, name, buffer, ZBX_JSON_TYPE_INT);
+}
+
+static void	loadgen_add_hist(struct zbx_json *j, const char *name, const zbx_loadgen_hist_t *hist)
+{
+	zbx_json_addobject(j, name);
+	zbx_json_adduint64(j, "count", hist->count);
+
+	if (0 != hist->count)
+	{
+		loadgen_add_double(j, "min", hist->min * 1000);
+		loadgen_add_double(j, "avg", hist->sum / hist->count * 1000);
+		loadgen_add_double(j, "p50", loadgen_hist_percentile(hist, 50) * 1000);
+		loadgen_add_double(j, "p90", loadgen_hist_percentile(hist, 90) * 1000);
+		loadgen_add_double(j, "p99", loadgen_hist_percentile(hist, 99) * 1000);
+		loadgen_add_double(j, "max", hist->max * 1000);
+	}
+
+	zbx_json_close(j);
+}
+
+static void	loadgen_sleep_until(double time)
+{
+	struct timespec	ts;
+	double		now;
+
+	if ((now = zbx_time()) >= time)
+		return;
+
+	ts.tv_sec = (time_t)(time - now);
+	ts.tv_nsec = (long)((time - now - ts.tv_sec) * 1000000000);
+
+	nanosleep(&ts, NULL);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_send                                                     *
+ *                                                                            *
+ * Purpose: send request to trapper and parse the processed/failed counts     *
+ *          from the response                                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the request was accepted                           *
+ *               FAIL - network error or the request was rejected             *
+ *                                                                            *
+ ******************************************************************************/
+static int	loadgen_send(const char *data, int *processed, int *failed)
+{
+	zbx_socket_t		sock;
+	struct zbx_json_parse	jp;
+	char			value[MAX_STRING_LEN];
+	int			ret = FAIL;
+
+	if (SUCCEED != zbx_tcp_connect(&sock, NULL, CONFIG_SERVER, CONFIG_SERVER_PORT, GET_SENDER_TIMEOUT,
+			ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot connect to [[%s]:%hu]: %s", CONFIG_SERVER, CONFIG_SERVER_PORT,
+				zbx_socket_strerror());
+		return FAIL;
+	}
+
+	if (SUCCEED != zbx_tcp_send(&sock, data) || SUCCEED != zbx_tcp_recv(&sock))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot send data to [[%s]:%hu]: %s", CONFIG_SERVER,
+				CONFIG_SERVER_PORT, zbx_socket_strerror());
+		goto out;
+	}
+
+	if (SUCCEED != zbx_json_open(sock.buffer, &jp) ||
+			SUCCEED != zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_RESPONSE, value, sizeof(value)) ||
+			0 != strcmp(value, ZBX_PROTO_VALUE_SUCCESS))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "incorrect answer from server [%s]", sock.buffer);
+		goto out;
+	}
+
+	if (SUCCEED != zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_INFO, value, sizeof(value)) ||
+			2 != sscanf(value, "processed: %d; failed: %d", processed, failed))
+	{
+		*processed = 0;
+		*failed = 0;
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_tcp_close(&sock);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_sender                                                   *
+ *                                                                            *
+ * Purpose: send values at a fixed rate until the test ends                   *
+ *                                                                            *
+ * Parameters: index - [IN] the sender index                                  *
+ *             end   - [IN] the test end time                                 *
+ *             stats - [OUT] the sender statistics                            *
+ *                                                                            *
+ * Comments: Senders split the value stream, the sender with index N sends    *
+ *           every N-th value of a round robin over all hosts and items.      *
+ *           Requests are scheduled at fixed intervals from the start time,   *
+ *           so a sender falling behind sends without delay until it catches  *
+ *           up and the achieved rate shows the ingestion limit.              *
+ *                                                                            *
+ ******************************************************************************/
+static void	loadgen_sender(int index, double end, zbx_loadgen_stats_t *stats)
+{
+	struct zbx_json	j;
+	double		interval, next, start;
+	zbx_uint64_t	value_index = index, items_num;
+	char		host[MAX_STRING_LEN], key[MAX_STRING_LEN];
+	int		i, processed, failed;
+
+	items_num = (zbx_uint64_t)CONFIG_HOSTS * CONFIG_ITEMS;
+	interval = (double)CONFIG_BATCH * CONFIG_CONNECTIONS / CONFIG_NVPS;
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+
+	/* spread the senders over the request interval */
+	next = start = zbx_time() + interval * index / CONFIG_CONNECTIONS;
+
+	while (next < end)
+	{
+		loadgen_sleep_until(next);
+
+		zbx_json_clean(&j);
+		zbx_json_addstring(&j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_SENDER_DATA, ZBX_JSON_TYPE_STRING);
+		zbx_json_addarray(&j, ZBX_PROTO_TAG_DATA);
+
+		for (i = 0; i < CONFIG_BATCH; i++)
+		{
+			zbx_uint64_t	n = value_index % items_num;
+
+			zbx_snprintf(host, sizeof(host), "%s" ZBX_FS_UI64, CONFIG_HOST_PREFIX, n / CONFIG_ITEMS + 1);
+			zbx_snprintf(key, sizeof(key), LOADGEN_ITEM_KEY "[" ZBX_FS_UI64 "]", n % CONFIG_ITEMS + 1);
+
+			zbx_json_addobject(&j, NULL);
+			zbx_json_addstring(&j, ZBX_PROTO_TAG_HOST, host, ZBX_JSON_TYPE_STRING);
+			zbx_json_addstring(&j, ZBX_PROTO_TAG_KEY, key, ZBX_JSON_TYPE_STRING);
+			zbx_json_adduint64(&j, ZBX_PROTO_TAG_VALUE, value_index);
+			zbx_json_close(&j);
+
+			value_index += CONFIG_CONNECTIONS;
+		}
+
+		zbx_json_close(&j);
+
+		start = zbx_time();
+
+		if (SUCCEED == loadgen_send(j.buffer, &processed, &failed))
+		{
+			loadgen_hist_add(&stats->ack, zbx_time() - start);
+			stats->values_processed += processed;
+			stats->values_failed += failed;
+		}
+		else
+			stats->requests_failed++;
+
+		stats->requests++;
+		stats->values_sent += CONFIG_BATCH;
+
+		next += interval;
+	}
+
+	zbx_json_free(&j);
+}
+
+static DB_RESULT	loadgen_db_select(const char *fmt, ...)
+{
+	va_list		args;
+	DB_RESULT	result;
+
+	va_start(args, fmt);
+	result = zbx_db_vselect(fmt, args);
+	va_end(args);
+
+	return result;
+}
+
+static int	loadgen_db_execute(const char *fmt, ...)
+{
+	va_list	args;
+	int	ret;
+
+	va_start(args, fmt);
+	ret = zbx_db_vexecute(fmt, args);
+	va_end(args);
+
+	return ret;
+}
+
+static zbx_uint64_t	loadgen_db_get_uint64(const char *sql)
+{
+	DB_RESULT	result;
+	DB_ROW		row;
+	zbx_uint64_t	value = 0;
+
+	if (NULL == (result = loadgen_db_select("%s", sql)) || (DB_RESULT)ZBX_DB_DOWN == result)
+		return 0;
+
+	if (NULL != (row = zbx_db_fetch(result)) && SUCCEED != zbx_db_is_null(row[0]))
+		ZBX_STR2UINT64(value, row[0]);
+
+	DBfree_result(result);
+
+	return value;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_db_reserve_ids                                           *
+ *                                                                            *
+ * Purpose: get the first free identifier of a table and keep the server id   *
+ *          generator in sync after the identifiers have been used            *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	loadgen_db_reserve_ids(const char *table, const char *field, int num)
+{
+	char		sql[MAX_STRING_LEN];
+	zbx_uint64_t	maxid;
+
+	zbx_snprintf(sql, sizeof(sql), "select max(%s) from %s", field, table);
+	maxid = loadgen_db_get_uint64(sql);
+
+	loadgen_db_execute("update ids set nextid=" ZBX_FS_UI64 " where table_name='%s' and field_name='%s'"
+			" and nextid<" ZBX_FS_UI64, maxid + num, table, field, maxid + num);
+
+	return maxid + 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_setup                                                    *
+ *                                                                            *
+ * Purpose: create synthetic hosts, trapper items and the probe trigger       *
+ *                                                                            *
+ ******************************************************************************/
+static int	loadgen_setup(void)
+{
+	zbx_uint64_t	hostid, itemid, hostgroupid, groupid, triggerid, functionid, probe_itemid;
+	char		sql[MAX_STRING_LEN];
+	int		h, i, ret = FAIL;
+
+	zbx_snprintf(sql, sizeof(sql), "select hostid from hosts where host='%s1'", CONFIG_HOST_PREFIX);
+
+	if (0 != loadgen_db_get_uint64(sql))
+	{
+		zbx_error("host \"%s1\" already exists", CONFIG_HOST_PREFIX);
+		return FAIL;
+	}
+
+	if (0 == (groupid = loadgen_db_get_uint64("select min(groupid) from groups")))
+	{
+		zbx_error("cannot find host group for synthetic hosts");
+		return FAIL;
+	}
+
+	zbx_db_begin();
+
+	hostid = loadgen_db_reserve_ids("hosts", "hostid", CONFIG_HOSTS);
+	hostgroupid = loadgen_db_reserve_ids("hosts_groups", "hostgroupid", CONFIG_HOSTS);
+	itemid = loadgen_db_reserve_ids("items", "itemid", CONFIG_HOSTS * CONFIG_ITEMS + 1);
+	triggerid = loadgen_db_reserve_ids("triggers", "triggerid", 1);
+	functionid = loadgen_db_reserve_ids("functions", "functionid", 1);
+	probe_itemid = itemid + (zbx_uint64_t)CONFIG_HOSTS * CONFIG_ITEMS;
+
+	for (h = 1; h <= CONFIG_HOSTS; h++, hostid++, hostgroupid++)
+	{
+		if (ZBX_DB_OK > loadgen_db_execute("insert into hosts (hostid,host,name,status) values"
+				" (" ZBX_FS_UI64 ",'%s%d','%s%d',%d)", hostid, CONFIG_HOST_PREFIX, h,
+				CONFIG_HOST_PREFIX, h, HOST_STATUS_MONITORED))
+		{
+			goto out;
+		}
+
+		if (ZBX_DB_OK > loadgen_db_execute("insert into hosts_groups (hostgroupid,hostid,groupid) values"
+				" (" ZBX_FS_UI64 "," ZBX_FS_UI64 "," ZBX_FS_UI64 ")", hostgroupid, hostid, groupid))
+		{
+			goto out;
+		}
+
+		for (i = 1; i <= CONFIG_ITEMS; i++, itemid++)
+		{
+			if (ZBX_DB_OK > loadgen_db_execute("insert into items (itemid,hostid,type,value_type,name,key_)"
+					" values (" ZBX_FS_UI64 "," ZBX_FS_UI64 ",%d,%d,'Load item %d',"
+					"'" LOADGEN_ITEM_KEY "[%d]')", itemid, hostid, ITEM_TYPE_TRAPPER,
+					ITEM_VALUE_TYPE_UINT64, i, i))
+			{
+				goto out;
+			}
+		}
+
+		if (1 != h)
+			continue;
+
+		/* the probe trigger generates an event for every received value */
+		if (ZBX_DB_OK > loadgen_db_execute("insert into items (itemid,hostid,type,value_type,name,key_)"
+				" values (" ZBX_FS_UI64 "," ZBX_FS_UI64 ",%d,%d,'Load probe','" LOADGEN_PROBE_KEY "')",
+				probe_itemid, hostid, ITEM_TYPE_TRAPPER, ITEM_VALUE_TYPE_UINT64) ||
+				ZBX_DB_OK > loadgen_db_execute("insert into triggers (triggerid,expression,description,"
+				"type,priority) values (" ZBX_FS_UI64 ",'{" ZBX_FS_UI64 "}>=0','Load probe',%d,%d)",
+				triggerid, functionid, TRIGGER_TYPE_MULTIPLE_TRUE, TRIGGER_SEVERITY_NOT_CLASSIFIED) ||
+				ZBX_DB_OK > loadgen_db_execute("insert into functions (functionid,itemid,triggerid,"
+				"function,parameter) values (" ZBX_FS_UI64 "," ZBX_FS_UI64 "," ZBX_FS_UI64 ","
+				"'last','0')", functionid, probe_itemid, triggerid))
+		{
+			goto out;
+		}
+	}
+
+	ret = SUCCEED;
+out:
+	if (SUCCEED == ret)
+	{
+		zbx_db_commit();
+		printf("created %d hosts with %d items each, reload configuration cache before running the test\n",
+				CONFIG_HOSTS, CONFIG_ITEMS);
+	}
+	else
+	{
+		zbx_db_rollback();
+		zbx_error("cannot create synthetic hosts");
+	}
+
+	return ret;
+}
+
+static int	loadgen_get_probe(zbx_uint64_t *itemid, zbx_uint64_t *triggerid)
+{
+	DB_RESULT	result;
+	DB_ROW		row;
+	int		ret = FAIL;
+
+	result = loadgen_db_select(
+			"select i.itemid,f.triggerid"
+			" from hosts h,items i,functions f"
+			" where h.hostid=i.hostid"
+				" and i.itemid=f.itemid"
+				" and h.host='%s1'"
+				" and i.key_='" LOADGEN_PROBE_KEY "'",
+			CONFIG_HOST_PREFIX);
+
+	if (NULL == result || (DB_RESULT)ZBX_DB_DOWN == result)
+		return FAIL;
+
+	if (NULL != (row = zbx_db_fetch(result)))
+	{
+		ZBX_STR2UINT64(*itemid, row[0]);
+		ZBX_STR2UINT64(*triggerid, row[1]);
+		ret = SUCCEED;
+	}
+
+	DBfree_result(result);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_db_wait                                                  *
+ *                                                                            *
+ * Purpose: poll database until the query returns a row                       *
+ *                                                                            *
+ * Parameters: sql      - [IN] the query                                      *
+ *             deadline - [IN] the time to stop polling                       *
+ *             ts       - [OUT] the clock and ns columns of the row, optional *
+ *                                                                            *
+ * Return value: the time the row was seen or 0 on timeout                    *
+ *                                                                            *
+ ******************************************************************************/
+static double	loadgen_db_wait(const char *sql, double deadline, zbx_timespec_t *ts)
+{
+	struct timespec	poll = {0, LOADGEN_POLL_INTERVAL};
+	DB_RESULT	result;
+	DB_ROW		row;
+	double		now;
+
+	while ((now = zbx_time()) < deadline)
+	{
+		if (NULL != (result = loadgen_db_select("%s", sql)) && (DB_RESULT)ZBX_DB_DOWN != result)
+		{
+			if (NULL != (row = zbx_db_fetch(result)))
+			{
+				if (NULL != ts)
+				{
+					ts->sec = atoi(row[0]);
+					ts->ns = atoi(row[1]);
+				}
+
+				DBfree_result(result);
+				return now;
+			}
+
+			DBfree_result(result);
+		}
+
+		nanosleep(&poll, NULL);
+	}
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: loadgen_probe                                                    *
+ *                                                                            *
+ * Purpose: send probe value and measure the time it takes to be written to   *
+ *          database and to generate trigger event                            *
+ *                                                                            *
+ * Parameters: seq           - [IN] the probe sequence number used as value   *
+ *             itemid        - [IN] the probe item                            *
+ *             triggerid     - [IN] the probe trigger                         *
+ *             hist_commit   - [OUT] receive to database commit latency       *
+ *             hist_trigger  - [OUT] receive to trigger event latency         *
+ *                                                                            *
+ * Return value: SUCCEED - the probe was seen in history and events           *
+ *               FAIL - the probe was not sent or timed out                   *
+ *                                                                            *
+ * Comments: The probe is sent without timestamp, so its history timestamp is *
+ *           the time the trapper received it and the event has the same      *
+ *           timestamp. Latency is measured from that timestamp to the time   *
+ *           the row becomes visible, so the resolution is limited by the     *
+ *           polling interval.                                                *
+ *                                                                            *
+ ******************************************************************************/
+static int	loadgen_probe(zbx_uint64_t seq, zbx_uint64_t itemid, zbx_uint64_t triggerid,
+		zbx_loadgen_hist_t *hist_commit, zbx_loadgen_hist_t *hist_trigger)
+{
+	struct zbx_json	j;
+	char		host[MAX_STRING_LEN], sql[MAX_STRING_LEN];
+	int		processed, failed, ret = FAIL, sent;
+	double		seen, received, deadline;
+	zbx_timespec_t	ts;
+
+	zbx_snprintf(host, sizeof(host), "%s1", CONFIG_HOST_PREFIX);
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(&j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_SENDER_DATA, ZBX_JSON_TYPE_STRING);
+	zbx_json_addarray(&j, ZBX_PROTO_TAG_DATA);
+	zbx_json_addobject(&j, NULL);
+	zbx_json_addstring(&j, ZBX_PROTO_TAG_HOST, host, ZBX_JSON_TYPE_STRING);
+	zbx_json_addstring(&j, ZBX_PROTO_TAG_KEY, LOADGEN_PROBE_KEY, ZBX_JSON_TYPE_STRING);
+	zbx_json_adduint64(&j, ZBX_PROTO_TAG_VALUE, seq);
+	zbx_json_close(&j);
+	zbx_json_close(&j);
+
+	sent = (int)time(NULL);
+
+	if (SUCCEED != loadgen_send(j.buffer, &processed, &failed) || 1 != processed)
+		goto out;
+
+	deadline = zbx_time() + LOADGEN_PROBE_TIMEOUT;
+
+	zbx_snprintf(sql, sizeof(sql), "select clock,ns from history_uint where itemid=" ZBX_FS_UI64
+			" and clock>=%d and value=" ZBX_FS_UI64, itemid, sent - 1, seq);
+
+	if (0 == (seen = loadgen_db_wait(sql, deadline, &ts)))
+		goto out;
+
+	received = ts.sec + ts.ns / 1e9;
+	loadgen_hist_add(hist_commit, seen - received);
+
+	zbx_snprintf(sql, sizeof(sql), "select eventid from events where source=%d and object=%d and objectid="
+			ZBX_FS_UI64 " and clock=%d and ns=%d", EVENT_SOURCE_TRIGGERS, EVENT_OBJECT_TRIGGER,
+			triggerid, ts.sec, ts.ns);
+
+	if (0 == (seen = loadgen_db_wait(sql, deadline, NULL)))
+		goto out;
+
+	loadgen_hist_add(hist_trigger, seen - received);
+
+	ret = SUCCEED;
+out:
+	zbx_json_free(&j);
+
+	return ret;
+}
+
+static void	loadgen_load_config(void)
+{
+	struct cfg_line	cfg[] =
+	{
+		/* PARAMETER,			VAR,					TYPE,
+			MANDATORY,	MIN,			MAX */
+		{"DBHost",			&CONFIG_DBHOST,				TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"DBName",			&CONFIG_DBNAME,				TYPE_STRING,
+			PARM_MAND,	0,			0},
+		{"DBSchema",			&CONFIG_DBSCHEMA,			TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"DBUser",			&CONFIG_DBUSER,				TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"DBPassword",			&CONFIG_DBPASSWORD,			TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"DBSocket",			&CONFIG_DBSOCKET,			TYPE_STRING,
+			PARM_OPT,	0,			0},
+		{"DBPort",			&CONFIG_DBPORT,				TYPE_INT,
+			PARM_OPT,	1024,			65535},
+		{"ListenPort",			&CONFIG_LISTEN_PORT,			TYPE_INT,
+			PARM_OPT,	1024,			32767},
+		{NULL}
+	};
+
+	parse_cfg_file(CONFIG_FILE, cfg, ZBX_CFG_FILE_REQUIRED, ZBX_CFG_NOT_STRICT);
+}
+
+static int	loadgen_check_int(const char *name, int *value, int min)
+{
+	if (min > (*value = atoi(zbx_optarg)))
+	{
+		zbx_error("invalid %s \"%s\"", name, zbx_optarg);
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+int	main(int argc, char **argv)
+{
+	int			ret = SUCCEED, setup = 0, i, connected = 0, *fds = NULL, status;
+	char			ch, *error = NULL;
+	pid_t			*pids = NULL;
+	double			start, end, next_probe;
+	zbx_uint64_t		seq = 0, probe_itemid = 0, probe_triggerid = 0, probes_lost = 0;
+	zbx_loadgen_stats_t	total, stats;
+	zbx_loadgen_hist_t	hist_commit, hist_trigger;
+	struct zbx_json		j;
+
+	progname = get_program_name(argv[0]);
+
+	while ((char)EOF != (ch = (char)zbx_getopt_long(argc, argv, shortopts, longopts, NULL)))
+	{
+		switch (ch)
+		{
+			case 'z':
+				CONFIG_SERVER = zbx_strdup(CONFIG_SERVER, zbx_optarg);
+				break;
+			case 'p':
+				CONFIG_SERVER_PORT = (unsigned short)atoi(zbx_optarg);
+				break;
+			case 'c':
+				CONFIG_FILE = zbx_strdup(CONFIG_FILE, zbx_optarg);
+				break;
+			case 'n':
+				ret = loadgen_check_int("number of values per second", &CONFIG_NVPS, 1);
+				break;
+			case 'C':
+				ret = loadgen_check_int("number of connections", &CONFIG_CONNECTIONS, 1);
+				break;
+			case 'b':
+				ret = loadgen_check_int("batch size", &CONFIG_BATCH, 1);
+				break;
+			case 'd':
+				ret = loadgen_check_int("duration", &CONFIG_DURATION, 1);
+				break;
+			case 'H':
+				ret = loadgen_check_int("number of hosts", &CONFIG_HOSTS, 1);
+				break;
+			case 'i':
+				ret = loadgen_check_int("number of items", &CONFIG_ITEMS, 1);
+				break;
+			case 'P':
+				CONFIG_HOST_PREFIX = zbx_strdup(CONFIG_HOST_PREFIX, zbx_optarg);
+				break;
+			case 'l':
+				ret = loadgen_check_int("probe interval", &CONFIG_PROBE_INTERVAL, 1);
+				break;
+			case 'S':
+				setup = 1;
+				break;
+			case 'h':
+				help();
+				exit(EXIT_SUCCESS);
+				break;
+			case 'V':
+				version();
+				exit(EXIT_SUCCESS);
+				break;
+			default:
+				usage();
+				exit(EXIT_FAILURE);
+				break;
+		}
+
+		if (SUCCEED != ret)
+			exit(EXIT_FAILURE);
+	}
+
+	if (argc > zbx_optind || (1 == setup && NULL == CONFIG_FILE))
+	{
+		usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if (NULL == CONFIG_SERVER)
+		CONFIG_SERVER = zbx_strdup(CONFIG_SERVER, "127.0.0.1");
+
+	if (NULL == CONFIG_HOST_PREFIX)
+		CONFIG_HOST_PREFIX = zbx_strdup(CONFIG_HOST_PREFIX, "loadgen-");
+
+	/* host prefix is used in SQL statements unescaped, only host name characters are allowed */
+	if (FAIL == zbx_check_hostname(CONFIG_HOST_PREFIX, &error))
+	{
+		zbx_error("invalid host prefix: %s", error);
+		zbx_free(error);
+		exit(EXIT_FAILURE);
+	}
+
+	zabbix_open_log(LOG_TYPE_UNDEFINED, LOG_LEVEL_WARNING, NULL);
+
+	if (NULL != CONFIG_FILE)
+	{
+		loadgen_load_config();
+
+		if (ZBX_DB_OK != zbx_db_connect(CONFIG_DBHOST, CONFIG_DBUSER, CONFIG_DBPASSWORD, CONFIG_DBNAME,
+				CONFIG_DBSCHEMA, CONFIG_DBSOCKET, CONFIG_DBPORT))
+		{
+			zbx_error("cannot connect to database");
+			ret = FAIL;
+			goto out;
+		}
+
+		connected = 1;
+	}
+
+	if (0 == CONFIG_SERVER_PORT)
+		CONFIG_SERVER_PORT = (unsigned short)CONFIG_LISTEN_PORT;
+
+	if (1 == setup)
+	{
+		ret = loadgen_setup();
+		goto out;
+	}
+
+	if (1 == connected && SUCCEED != loadgen_get_probe(&probe_itemid, &probe_triggerid))
+	{
+		zbx_error("cannot find \"" LOADGEN_PROBE_KEY "\" item with trigger on host \"%s1\","
+				" create synthetic hosts with -S option", CONFIG_HOST_PREFIX);
+		ret = FAIL;
+		goto out;
+	}
+
+	start = zbx_time();
+	end = start + CONFIG_DURATION;
+
+	pids = (pid_t *)zbx_malloc(pids, CONFIG_CONNECTIONS * sizeof(pid_t));
+	fds = (int *)zbx_malloc(fds, CONFIG_CONNECTIONS * sizeof(int));
+
+	for (i = 0; i < CONFIG_CONNECTIONS; i++)
+	{
+		int	pipefd[2];
+
+		if (-1 == pipe(pipefd))
+		{
+			zbx_error("cannot create pipe: %s", zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		if (-1 == (pids[i] = zbx_fork()))
+		{
+			zbx_error("cannot fork: %s", zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		if (0 == pids[i])
+		{
+			const char	*data = (const char *)&stats;
+			ssize_t		n;
+			size_t		offset = 0;
+
+			close(pipefd[0]);
+			memset(&stats, 0, sizeof(stats));
+
+			loadgen_sender(i, end, &stats);
+
+			while (offset < sizeof(stats) && 0 < (n = write(pipefd[1], data + offset,
+					sizeof(stats) - offset)))
+			{
+				offset += n;
+			}
+
+			_exit(offset == sizeof(stats) ? EXIT_SUCCESS : EXIT_FAILURE);
+		}
+
+		close(pipefd[1]);
+		fds[i] = pipefd[0];
+	}
+
+	memset(&total, 0, sizeof(total));
+	memset(&hist_commit, 0, sizeof(hist_commit));
+	memset(&hist_trigger, 0, sizeof(hist_trigger));
+
+	if (1 == connected)
+	{
+		for (next_probe = start; next_probe < end; next_probe += CONFIG_PROBE_INTERVAL / 1000.0)
+		{
+			loadgen_sleep_until(next_probe);
+
+			if (SUCCEED != loadgen_probe(++seq, probe_itemid, probe_triggerid, &hist_commit,
+					&hist_trigger))
+			{
+				probes_lost++;
+			}
+
+			/* do not queue probes if the previous one took longer than the interval */
+			if (next_probe < zbx_time() - CONFIG_PROBE_INTERVAL / 1000.0)
+				next_probe = zbx_time();
+		}
+	}
+
+	for (i = 0; i < CONFIG_CONNECTIONS; i++)
+	{
+		char	*data = (char *)&stats;
+		ssize_t	n;
+		size_t	offset = 0;
+
+		while (offset < sizeof(stats) && 0 < (n = read(fds[i], data + offset, sizeof(stats) - offset)))
+			offset += n;
+
+		close(fds[i]);
+		waitpid(pids[i], &status, 0);
+
+		if (offset != sizeof(stats))
+		{
+			zbx_error("cannot read statistics of sender #%d", i + 1);
+			ret = FAIL;
+			continue;
+		}
+
+		total.values_sent += stats.values_sent;
+		total.values_processed += stats.values_processed;
+		total.values_failed += stats.values_failed;
+		total.requests += stats.requests;
+		total.requests_failed += stats.requests_failed;
+		loadgen_hist_merge(&total.ack, &stats.ack);
+	}
+
+	end = zbx_time();
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+	zbx_json_addstring(&j, "version", ZABBIX_VERSION, ZBX_JSON_TYPE_STRING);
+	zbx_json_adduint64(&j, "clock", (zbx_uint64_t)time(NULL));
+	zbx_json_adduint64(&j, "duration", CONFIG_DURATION);
+	zbx_json_adduint64(&j, "connections", CONFIG_CONNECTIONS);
+	zbx_json_adduint64(&j, "hosts", CONFIG_HOSTS);
+	zbx_json_adduint64(&j, "items", (zbx_uint64_t)CONFIG_HOSTS * CONFIG_ITEMS);
+	zbx_json_adduint64(&j, "batch", CONFIG_BATCH);
+	zbx_json_adduint64(&j, "nvps_target", CONFIG_NVPS);
+	loadgen_add_double(&j, "nvps_sent", total.values_sent / (end - start));
+	loadgen_add_double(&j, "nvps_processed", total.values_processed / (end - start));
+	zbx_json_adduint64(&j, "values_sent", total.values_sent);
+	zbx_json_adduint64(&j, "values_processed", total.values_processed);
+	zbx_json_adduint64(&j, "values_failed", total.values_failed);
+	zbx_json_adduint64(&j, "requests", total.requests);
+	zbx_json_adduint64(&j, "requests_failed", total.requests_failed);
+	loadgen_add_hist(&j, "ack_latency", &total.ack);
+
+	if (1 == connected)
+	{
+		zbx_json_adduint64(&j, "probes", seq);
+		zbx_json_adduint64(&j, "probes_lost", probes_lost);
+		loadgen_add_hist(&j, "commit_latency", &hist_commit);
+		loadgen_add_hist(&j, "trigger_latency", &hist_trigger);
+	}
+
+	printf("%s\n", j.buffer);
+
+	zbx_json_free(&j);
+	zbx_free(fds);
+	zbx_free(pids);
+out:
+	if (1 == connected)
+		zbx_db_close();
+
+	zabbix_close_log();
+
+	return SUCCEED == ret ? EXIT_SUCCESS : EXIT_FAILURE;
+}
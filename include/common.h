@@ -407,6 +407,9 @@ zbx_graph_yaxis_types_t;
 /* runtime control options */
 #define ZBX_CONFIG_CACHE_RELOAD	"config_cache_reload"
 #define ZBX_HOUSEKEEPER_EXECUTE	"housekeeper_execute"
+#define ZBX_MEMORY_REPORT	"memory_report"
+#define ZBX_LATENCY_REPORT	"latency_report"
+#define ZBX_LOCK_REPORT		"lock_report"
 #define ZBX_LOG_LEVEL_INCREASE	"log_level_increase"
 #define ZBX_LOG_LEVEL_DECREASE	"log_level_decrease"
 
@@ -819,6 +822,12 @@ zbx_task_t;
 #define ZBX_RTC_LOG_LEVEL_DECREASE	2
 #define ZBX_RTC_HOUSEKEEPER_EXECUTE	3
 #define ZBX_RTC_CONFIG_CACHE_RELOAD	8
+#define ZBX_RTC_MEMORY_REPORT		9
+#define ZBX_RTC_LATENCY_REPORT		10
+#define ZBX_RTC_LOCK_REPORT		11
+
+/* bit of a runtime control command in the mask returned by zbx_rtc_get_pending() */
+#define ZBX_RTC_PENDING(msg)	(1 << (msg))
 
 typedef enum
 {
@@ -32,6 +32,7 @@ int	daemon_start(int allow_root, const char *user, unsigned int flags);
 void	daemon_stop(void);
 
 int	zbx_sigusr_send(int flags);
+int	zbx_rtc_get_pending(void);
 
 #define ZBX_IS_RUNNING()	1
 #define ZBX_DO_EXIT()
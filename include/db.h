@@ -106,6 +106,8 @@ struct	_DC_TRIGGER;
 #define ITEM_NAME_LEN			255
 #define ITEM_KEY_LEN			255
 #define ITEM_UNITS_LEN			255
+#define ITEM_FORMULA_LEN		255
+#define ITEM_FORMULA_LEN_MAX		(ITEM_FORMULA_LEN + 1)
 #define ITEM_SNMP_COMMUNITY_LEN		64
 #define ITEM_SNMP_COMMUNITY_LEN_MAX	(ITEM_SNMP_COMMUNITY_LEN + 1)
 #define ITEM_SNMP_OID_LEN		255
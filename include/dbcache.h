@@ -67,6 +67,7 @@ extern int	CONFIG_UNAVAILABLE_DELAY;
 extern int	CONFIG_UNREACHABLE_PERIOD;
 extern int	CONFIG_UNREACHABLE_DELAY;
 extern int	CONFIG_HISTSYNCER_FORKS;
+extern int	CONFIG_PREPROCESSOR_FORKS;
 extern int	CONFIG_PROXYCONFIG_FREQUENCY;
 extern int	CONFIG_PROXYDATA_FREQUENCY;
 
@@ -176,6 +177,17 @@ typedef struct
 }
 DC_ITEM;
 
+/* item properties used by preprocessing workers for value conversion */
+typedef struct
+{
+	zbx_uint64_t	itemid;
+	unsigned char	value_type;
+	unsigned char	delta;
+	unsigned char	multiplier;
+	char		formula[ITEM_FORMULA_LEN_MAX];
+}
+zbx_preproc_item_t;
+
 typedef struct
 {
 	zbx_uint64_t	functionid;
@@ -420,6 +432,8 @@ void	dc_add_history(zbx_uint64_t itemid, unsigned char value_type, unsigned char
 		const zbx_timespec_t *ts, unsigned char state, const char *error);
 void	dc_flush_history(void);
 int	DCsync_history(int sync_type, int *sync_num);
+int	DCpreprocess_history(int queue_num, int *values_num);
+void	DCpreprocess_wait(int queue_num, int timeout);
 void	init_database_cache(void);
 void	free_database_cache(void);
 
@@ -443,10 +457,15 @@ void	free_database_cache(void);
 #define ZBX_STATS_HISTORY_INDEX_FREE	17
 #define ZBX_STATS_HISTORY_INDEX_PFREE	18
 void	*DCget_stats(int request);
+void	DCget_memory_usage(zbx_vector_ptr_t *usage);
+void	DClog_memory_stats(void);
 
 zbx_uint64_t	DCget_nextid(const char *table_name, int num);
 
 void	DCsync_configuration(void);
+int	DCconfig_snapshot_save(const char *filename);
+int	DCconfig_snapshot_load(const char *filename);
+int	DCconfig_snapshot_loaded(void);
 void	init_configuration_cache(void);
 void	free_configuration_cache(void);
 void	DCload_config(void);
@@ -457,6 +476,8 @@ void	DCconfig_clean_items(DC_ITEM *items, int *errcodes, size_t num);
 int	DCget_host_by_hostid(DC_HOST *host, zbx_uint64_t hostid);
 void	DCconfig_get_items_by_keys(DC_ITEM *items, zbx_host_key_t *keys, int *errcodes, size_t num);
 void	DCconfig_get_items_by_itemids(DC_ITEM *items, const zbx_uint64_t *itemids, int *errcodes, size_t num);
+void	DCconfig_get_preprocessable_items(zbx_preproc_item_t *items, const zbx_uint64_t *itemids, int *errcodes,
+		size_t num);
 void	DCconfig_set_item_db_state(zbx_uint64_t itemid, unsigned char state, const char *error);
 void	DCconfig_get_functions_by_functionids(DC_FUNCTION *functions,
 		zbx_uint64_t *functionids, int *errcodes, size_t num);
@@ -504,12 +525,15 @@ void	DCconfig_set_maintenance(const zbx_uint64_t *hostids, int hostids_num, int
 #define ZBX_CONFSTATS_BUFFER_FREE	3
 #define ZBX_CONFSTATS_BUFFER_PFREE	4
 void	*DCconfig_get_stats(int request);
+void	DCconfig_get_memory_usage(zbx_vector_ptr_t *usage);
+void	DCconfig_log_memory_usage(void);
 
 int	DCconfig_get_proxypoller_hosts(DC_PROXY *proxies, int max_hosts);
 int	DCconfig_get_proxypoller_nextcheck(void);
 
 #define ZBX_PROXY_CONFIG_NEXTCHECK	0x01
 #define ZBX_PROXY_DATA_NEXTCHECK	0x02
+#define ZBX_PROXY_DATA_BACKLOG		0x04
 void	DCrequeue_proxy(zbx_uint64_t hostid, unsigned char update_nextcheck);
 void	DCconfig_set_proxy_timediff(zbx_uint64_t hostid, const zbx_timespec_t *timediff);
 int	DCcheck_proxy_permissions(const char *host, const zbx_socket_t *sock, zbx_uint64_t *hostid, char **error);
@@ -527,9 +551,6 @@ int	DChost_activate(zbx_uint64_t hostid, unsigned char agent_type, const zbx_tim
 int	DChost_deactivate(zbx_uint64_t hostid, unsigned char agent, const zbx_timespec_t *ts,
 		zbx_agent_availability_t *in, zbx_agent_availability_t *out, const char *error);
 
-void	DCget_delta_items(zbx_hashset_t *items, const zbx_vector_uint64_t *ids);
-void	DCset_delta_items(zbx_hashset_t *items);
-
 #define ZBX_QUEUE_FROM_DEFAULT	6	/* default lower limit for delay (in seconds) */
 #define ZBX_QUEUE_TO_INFINITY	-1	/* no upper limit for delay */
 void	DCfree_item_queue(zbx_vector_ptr_t *queue);
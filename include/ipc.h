@@ -39,9 +39,12 @@
 #define ZBX_IPC_VALUECACHE_ID		'v'
 #define ZBX_IPC_VMWARE_ID		'w'
 #define ZBX_IPC_COLLECTOR_PROC_ID	'p'
+#define ZBX_IPC_SNMPIDX_ID		'n'
 
 key_t	zbx_ftok(char *path, int id);
 int	zbx_shmget(key_t key, size_t size);
+int	zbx_shmget_huge(key_t key, size_t size);
+size_t	zbx_shm_huge_page_size(void);
 
 /* data copying callback function prototype */
 typedef void (*zbx_shm_copy_func_t)(void *dst, size_t size_dst, const void *src);
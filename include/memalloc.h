@@ -22,6 +22,17 @@
 
 #include "common.h"
 #include "mutexs.h"
+#include "zbxalgo.h"
+
+/* slab allocator size class, see zbx_mem_enable_slabs() */
+typedef struct
+{
+	void		*pages;		/* the pages having free objects */
+	zbx_uint64_t	pages_num;
+	zbx_uint64_t	used_num;
+	zbx_uint64_t	requested_size;	/* the memory requested by allocations served from this class */
+}
+zbx_mem_slab_class_t;
 
 typedef struct
 {
@@ -40,6 +51,12 @@ typedef struct
 	/* Set this flag to 1 to allow execution in out of memory situations.     */
 	char		allow_oom;
 
+	/* the segment is backed by huge pages, see HugePages configuration parameter */
+	char		huge_pages;
+
+	/* size classes of small allocations, NULL if slabs are not enabled */
+	zbx_mem_slab_class_t	*slabs;
+
 	ZBX_MUTEX	mem_lock;
 	const char	*mem_descr;
 	const char	*mem_param;
@@ -49,6 +66,7 @@ zbx_mem_info_t;
 void	zbx_mem_create(zbx_mem_info_t **info, key_t shm_key, int lock_name, zbx_uint64_t size,
 		const char *descr, const char *param, int allow_oom);
 void	zbx_mem_destroy(zbx_mem_info_t *info);
+void	zbx_mem_enable_slabs(zbx_mem_info_t *info);
 
 #define	zbx_mem_malloc(info, old, size) __zbx_mem_malloc(__FILE__, __LINE__, info, old, size)
 #define	zbx_mem_realloc(info, old, size) __zbx_mem_realloc(__FILE__, __LINE__, info, old, size)
@@ -68,9 +86,30 @@ void	__zbx_mem_free(const char *file, int line, zbx_mem_info_t *info, void *ptr)
 void	zbx_mem_clear(zbx_mem_info_t *info);
 
 void	zbx_mem_dump_stats(zbx_mem_info_t *info);
+void	zbx_mem_log_stats(zbx_mem_info_t *info);
 
 size_t	zbx_mem_required_size(int chunks_num, const char *descr, const char *param);
 
+/* memory used by a cache structure, see zbx_mem_usage_*() functions */
+typedef struct
+{
+	const char	*name;
+	zbx_uint64_t	count;
+	zbx_uint64_t	bytes;
+}
+zbx_mem_usage_t;
+
+zbx_uint64_t	zbx_mem_chunk_size(const zbx_mem_info_t *info, zbx_uint64_t size);
+zbx_uint64_t	zbx_mem_used_size(const zbx_mem_info_t *info);
+zbx_uint64_t	zbx_mem_hashset_size(const zbx_mem_info_t *info, const zbx_hashset_t *hashset, size_t data_size);
+zbx_uint64_t	zbx_mem_binary_heap_size(const zbx_mem_info_t *info, const zbx_binary_heap_t *heap);
+
+void			zbx_mem_usage_add(zbx_vector_ptr_t *usage, const char *name, zbx_uint64_t count,
+				zbx_uint64_t bytes);
+void			zbx_mem_usage_add_other(zbx_vector_ptr_t *usage, zbx_uint64_t used_size);
+const zbx_mem_usage_t	*zbx_mem_usage_search(const zbx_vector_ptr_t *usage, const char *name);
+void			zbx_mem_usage_log(const char *descr, const zbx_vector_ptr_t *usage);
+
 #define ZBX_MEM_FUNC1_DECL_MALLOC(__prefix)				\
 static void	*__prefix ## _mem_malloc_func(void *old, size_t size)
 #define ZBX_MEM_FUNC1_DECL_REALLOC(__prefix)				\
@@ -44,6 +44,7 @@
 #define CF_HAVEPARAMS		0x01	/* item accepts either optional or mandatory parameters */
 #define CF_MODULE		0x02	/* item is defined in a loadable module */
 #define CF_USERPARAMETER	0x04	/* item is defined as user parameter */
+#define CF_PERSISTENT		0x08	/* user parameter is served by a persistent script */
 
 typedef struct
 {
@@ -42,20 +42,40 @@
 #	define ZBX_MUTEX_CACHE		1
 #	define ZBX_MUTEX_TRENDS		2
 #	define ZBX_MUTEX_CACHE_IDS	3
-#	define ZBX_MUTEX_CONFIG		4
-#	define ZBX_MUTEX_SELFMON	5
-#	define ZBX_MUTEX_CPUSTATS	6
-#	define ZBX_MUTEX_DISKSTATS	7
-#	define ZBX_MUTEX_ITSERVICES	8
-#	define ZBX_MUTEX_VALUECACHE	9
-#	define ZBX_MUTEX_VMWARE		10
-#	define ZBX_MUTEX_SQLITE3	11
-#	define ZBX_MUTEX_PROCSTAT	12
-#	define ZBX_MUTEX_PROXY_HISTORY	13
+#	define ZBX_MUTEX_SELFMON	4
+#	define ZBX_MUTEX_CPUSTATS	5
+#	define ZBX_MUTEX_DISKSTATS	6
+#	define ZBX_MUTEX_ITSERVICES	7
+#	define ZBX_MUTEX_VALUECACHE	8
+#	define ZBX_MUTEX_VMWARE		9
+#	define ZBX_MUTEX_SQLITE3	10
+#	define ZBX_MUTEX_PROCSTAT	11
+#	define ZBX_MUTEX_PROXY_HISTORY	12
+#	define ZBX_MUTEX_SNMPIDX	13
 #	define ZBX_MUTEX_COUNT		14
 
 #	define ZBX_MUTEX_MAX_TRIES	20	/* seconds */
 
+/* reader/writer locks share the semaphore set with mutexes, each lock uses two */
+/* semaphores placed after the mutex semaphores: writer flag and reader count   */
+#	define ZBX_RWLOCK		int
+#	define ZBX_RWLOCK_NULL		-1
+
+#	define ZBX_RWLOCK_NAME		int
+
+#	define ZBX_RWLOCK_CONFIG	0
+#	define ZBX_RWLOCK_COUNT		1
+
+/* lock contention statistics, kept in shared memory for mutexes and reader/writer locks */
+typedef struct
+{
+	zbx_uint64_t	locks;		/* number of acquisitions */
+	zbx_uint64_t	contended;	/* number of acquisitions that had to wait */
+	zbx_uint64_t	wait_time;	/* total time spent waiting, in microseconds */
+	zbx_uint64_t	hold_max;	/* maximum exclusive hold time, in microseconds */
+}
+zbx_mutex_stats_t;
+
 #endif	/* _WINDOWS */
 
 #define zbx_mutex_create(mutex, name)		zbx_mutex_create_ext(mutex, name, 0)
@@ -70,6 +90,20 @@ int	zbx_mutex_destroy(ZBX_MUTEX *mutex);
 
 #ifdef _WINDOWS
 ZBX_MUTEX_NAME	zbx_mutex_create_per_process_name(const ZBX_MUTEX_NAME prefix);
+#else
+#define zbx_rwlock_wrlock(rwlock)		__zbx_rwlock_wrlock(__FILE__, __LINE__, rwlock)
+#define zbx_rwlock_rdlock(rwlock)		__zbx_rwlock_rdlock(__FILE__, __LINE__, rwlock)
+#define zbx_rwlock_unlock(rwlock)		__zbx_rwlock_unlock(__FILE__, __LINE__, rwlock)
+
+int	zbx_rwlock_create(ZBX_RWLOCK *rwlock, ZBX_RWLOCK_NAME name);
+void	__zbx_rwlock_wrlock(const char *filename, int line, ZBX_RWLOCK *rwlock);
+void	__zbx_rwlock_rdlock(const char *filename, int line, ZBX_RWLOCK *rwlock);
+void	__zbx_rwlock_unlock(const char *filename, int line, ZBX_RWLOCK *rwlock);
+void	zbx_rwlock_destroy(ZBX_RWLOCK *rwlock);
+
+int	zbx_mutex_stats_init(void);
+int	zbx_mutex_stats_get(const char *name, zbx_mutex_stats_t *stats);
+void	zbx_mutex_stats_log(void);
 #endif
 
 #endif	/* ZABBIX_MUTEXS_H */
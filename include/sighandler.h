@@ -22,5 +22,6 @@
 
 void	zbx_set_common_signal_handlers();
 void	zbx_set_child_signal_handler();
+int	zbx_sig_child_died(void);
 
 #endif
@@ -41,5 +41,8 @@ void		zbx_strpool_release(const char *str);
 void		zbx_strpool_clear();
 
 const zbx_strpool_t	*zbx_strpool_info();
+void		zbx_strpool_get_counts(int *num_data, int *num_slots);
+
+void		zbx_strpool_log_top(int top_num);
 
 #endif
@@ -196,6 +196,10 @@
 #	include <sys/wait.h>
 #endif
 
+#ifdef HAVE_SPAWN_H
+#	include <spawn.h>
+#endif
+
 #ifdef HAVE_NETINET_IN_H
 #	include <netinet/in.h>
 #endif
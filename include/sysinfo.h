@@ -195,7 +195,7 @@ void	free_metrics();
 
 int	process(const char *in_command, unsigned flags, AGENT_RESULT *result);
 
-int	add_user_parameter(const char *key, char *command, char *error, size_t max_error_len);
+int	add_user_parameter(const char *key, char *command, unsigned flags, char *error, size_t max_error_len);
 int	add_user_module(const char *key, int (*function)());
 void	test_parameters();
 void	test_parameter(const char *key);
@@ -34,7 +34,9 @@
 #define OPT_SGA		3
 
 int	telnet_test_login(ZBX_SOCKET socket_fd);
-int	telnet_login(ZBX_SOCKET socket_fd, const char *username, const char *password, AGENT_RESULT *result);
-int	telnet_execute(ZBX_SOCKET socket_fd, const char *command, AGENT_RESULT *result, const char *encoding);
+int	telnet_login(ZBX_SOCKET socket_fd, const char *username, const char *password, char *prompt_char,
+		AGENT_RESULT *result);
+int	telnet_execute(ZBX_SOCKET socket_fd, const char *command, char prompt_char, AGENT_RESULT *result,
+		const char *encoding);
 
 #endif
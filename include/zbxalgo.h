@@ -164,6 +164,56 @@ void	zbx_hashset_iter_reset(zbx_hashset_t *hs, zbx_hashset_iter_t *iter);
 void	*zbx_hashset_iter_next(zbx_hashset_iter_t *iter);
 void	zbx_hashset_iter_remove(zbx_hashset_iter_t *iter);
 
+/* open addressing hashset */
+
+typedef struct
+{
+	void			*slots;		/* allocated memory holding control bytes and entries */
+	unsigned char		*ctrl;
+	char			*entries;
+	int			num_slots;
+	int			num_data;
+	int			num_deleted;
+	size_t			entry_size;
+	zbx_hash_func_t		hash_func;
+	zbx_compare_func_t	compare_func;
+	zbx_clean_func_t	clean_func;
+	zbx_mem_malloc_func_t	mem_malloc_func;
+	zbx_mem_realloc_func_t	mem_realloc_func;
+	zbx_mem_free_func_t	mem_free_func;
+}
+zbx_ohashset_t;
+
+void	zbx_ohashset_create(zbx_ohashset_t *hs, size_t init_size, size_t entry_size,
+				zbx_hash_func_t hash_func,
+				zbx_compare_func_t compare_func);
+void	zbx_ohashset_create_ext(zbx_ohashset_t *hs, size_t init_size, size_t entry_size,
+				zbx_hash_func_t hash_func,
+				zbx_compare_func_t compare_func,
+				zbx_clean_func_t clean_func,
+				zbx_mem_malloc_func_t mem_malloc_func,
+				zbx_mem_realloc_func_t mem_realloc_func,
+				zbx_mem_free_func_t mem_free_func);
+void	zbx_ohashset_destroy(zbx_ohashset_t *hs);
+
+void	*zbx_ohashset_insert(zbx_ohashset_t *hs, const void *data);
+void	*zbx_ohashset_search(zbx_ohashset_t *hs, const void *data);
+void	zbx_ohashset_remove(zbx_ohashset_t *hs, const void *data);
+void	zbx_ohashset_remove_direct(zbx_ohashset_t *hs, const void *data);
+
+void	zbx_ohashset_clear(zbx_ohashset_t *hs);
+
+typedef struct
+{
+	zbx_ohashset_t	*hashset;
+	int		slot;
+}
+zbx_ohashset_iter_t;
+
+void	zbx_ohashset_iter_reset(zbx_ohashset_t *hs, zbx_ohashset_iter_t *iter);
+void	*zbx_ohashset_iter_next(zbx_ohashset_iter_t *iter);
+void	zbx_ohashset_iter_remove(zbx_ohashset_iter_t *iter);
+
 /* hashmap */
 
 /* currently, we only have a very specialized hashmap */
@@ -104,6 +104,10 @@ DB_RESULT	zbx_db_select_n(const char *query, int n);
 
 DB_ROW		zbx_db_fetch(DB_RESULT result);
 void		DBfree_result(DB_RESULT result);
+int		zbx_db_result_fields_num(DB_RESULT result);
+
+DB_RESULT	zbx_db_mem_result_create(int fields_num);
+void		zbx_db_mem_result_add_row(DB_RESULT result, const DB_ROW row);
 int		zbx_db_is_null(const char *field);
 
 typedef enum
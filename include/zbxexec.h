@@ -22,5 +22,7 @@
 
 int	zbx_execute(const char *command, char **buffer, char *error, size_t max_error_len, int timeout);
 int	zbx_execute_nowait(const char *command);
+int	zbx_execute_persistent(const char *command, const char **params, int params_num, char **buffer, char *error,
+		size_t max_error_len, int timeout);
 
 #endif
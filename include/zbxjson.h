@@ -66,12 +66,16 @@
 #define ZBX_PROTO_TAG_USERNAME		"username"
 #define ZBX_PROTO_TAG_PASSWORD		"password"
 #define ZBX_PROTO_TAG_SID		"sid"
+#define ZBX_PROTO_TAG_CONFIG_DIGEST	"config_digest"
+#define ZBX_PROTO_TAG_BUCKET_COUNT	"bucket_count"
+#define ZBX_PROTO_TAG_BUCKETS		"buckets"
 
 #define ZBX_PROTO_VALUE_FAILED		"failed"
 #define ZBX_PROTO_VALUE_SUCCESS		"success"
 
 #define ZBX_PROTO_VALUE_GET_ACTIVE_CHECKS	"active checks"
 #define ZBX_PROTO_VALUE_PROXY_CONFIG		"proxy config"
+#define ZBX_PROTO_VALUE_PROXY_CONFIG_DIGEST	"proxy config digest"
 #define ZBX_PROTO_VALUE_PROXY_HEARTBEAT		"proxy heartbeat"
 #define ZBX_PROTO_VALUE_DISCOVERY_DATA		"discovery data"
 #define ZBX_PROTO_VALUE_HOST_AVAILABILITY	"host availability"
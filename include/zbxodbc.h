@@ -44,6 +44,9 @@ void		odbc_DBclose(ZBX_ODBC_DBH *pdbh);
 ZBX_ODBC_RESULT odbc_DBselect(ZBX_ODBC_DBH *pdbh, char *query);
 ZBX_ODBC_ROW    odbc_DBfetch(ZBX_ODBC_RESULT pdbh);
 
+int		odbc_DBconnection_alive(ZBX_ODBC_DBH *pdbh);
+int		odbc_DBconnection_lost(void);
+
 const char	*get_last_odbc_strerror(void);
 
 #endif
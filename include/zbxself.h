@@ -49,7 +49,8 @@
 #define ZBX_PROCESS_TYPE_LISTENER	22
 #define ZBX_PROCESS_TYPE_ACTIVE_CHECKS	23
 #define ZBX_PROCESS_TYPE_TASKMANAGER	24
-#define ZBX_PROCESS_TYPE_COUNT		25	/* number of process types */
+#define ZBX_PROCESS_TYPE_PREPROCESSOR	25
+#define ZBX_PROCESS_TYPE_COUNT		26	/* number of process types */
 #define ZBX_PROCESS_TYPE_UNKNOWN	255
 
 #define ZBX_RTC_LOG_SCOPE_FLAG		0x80
@@ -61,9 +62,26 @@
 #define ZBX_AGGR_FUNC_MAX		2
 #define ZBX_AGGR_FUNC_MIN		3
 
+/* value processing pipeline stages for latency statistics */
+#define ZBX_LATENCY_STAGE_COLLECT	0	/* from value timestamp until it is added to history cache */
+#define ZBX_LATENCY_STAGE_CACHE		1	/* waiting in history cache until popped by history syncer */
+#define ZBX_LATENCY_STAGE_SYNC		2	/* history syncer batch preparation and item updates */
+#define ZBX_LATENCY_STAGE_DB		3	/* writing history and committing transaction */
+#define ZBX_LATENCY_STAGE_TRIGGER	4	/* trigger evaluation */
+#define ZBX_LATENCY_STAGE_TOTAL		5	/* from value timestamp until the transaction is committed */
+#define ZBX_LATENCY_STAGE_COUNT		6	/* number of latency stages */
+#define ZBX_LATENCY_STAGE_UNKNOWN	255
+
+#define ZBX_LATENCY_MODE_AVG		0
+#define ZBX_LATENCY_MODE_MAX		1
+#define ZBX_LATENCY_MODE_COUNT		2
+#define ZBX_LATENCY_MODE_PERCENTILE	3
+
 int		get_process_type_by_name(const char *proc_type_str);
 int		get_process_type_forks(unsigned char process_type);
 const char	*get_process_type_string(unsigned char process_type);
+int		get_latency_stage_by_name(const char *stage_str);
+const char	*get_latency_stage_string(unsigned char stage);
 
 #ifndef _WINDOWS
 void		init_selfmon_collector(void);
@@ -72,6 +90,10 @@ void		update_selfmon_counter(unsigned char state);
 void		collect_selfmon_stats(void);
 void		get_selfmon_stats(unsigned char process_type, unsigned char aggr_func, int process_num,
 			unsigned char state, double *value);
+void		zbx_latency_add(unsigned char stage, double latency, int count);
+void		zbx_latency_flush(void);
+void		get_latency_stats(unsigned char stage, unsigned char mode, double percentile, double *value);
+void		log_latency_stats(void);
 void		zbx_sleep_loop(int sleeptime);
 void		zbx_sleep_forever(void);
 void		zbx_wakeup(void);
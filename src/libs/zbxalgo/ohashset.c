@@ -0,0 +1,505 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+
+#include "zbxalgo.h"
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Open addressing hashset                                                    *
+ *                                                                            *
+ * Entries are stored in place in a single array of slots. Each slot has a    *
+ * control byte in a separate array:                                          *
+ *                                                                            *
+ *   OHS_CTRL_EMPTY   - the slot was never used since the last rehash         *
+ *   OHS_CTRL_DELETED - the slot entry was removed (tombstone)                *
+ *   0..127           - the slot is used, the value is the 7 lowest bits of   *
+ *                      the entry hash                                        *
+ *                                                                            *
+ * Slots are probed by groups of OHS_GROUP_WIDTH control bytes, matching all  *
+ * group control bytes against the hash bits at once (with SSE2 if it is     *
+ * available), so the entries are compared only for likely matches. The      *
+ * groups are aligned and probed quadratically starting with the group       *
+ * selected by the remaining hash bits. Probing stops at the first group     *
+ * having an empty slot.                                                      *
+ *                                                                            *
+ * A removed entry slot can be marked empty only if its group already has an *
+ * empty slot - such group was never full, so no probe sequence passes it.   *
+ *                                                                            *
+ ******************************************************************************/
+
+#define OHS_CTRL_EMPTY		((unsigned char)0x80)
+#define OHS_CTRL_DELETED	((unsigned char)0xfe)
+
+#define OHS_H1(hash)		((hash) >> 7)
+#define OHS_H2(hash)		((unsigned char)((hash) & 0x7f))
+
+#if defined(__SSE2__)
+#	define OHS_GROUP_WIDTH	16
+#else
+#	define OHS_GROUP_WIDTH	8
+#endif
+
+/* maximum load factor including deleted slots, 7/8 */
+#define OHS_MAX_LOAD(num_slots)	((num_slots) - (num_slots) / 8)
+
+#define OHS_SLOT_DATA(hs, slot)	((hs)->entries + (size_t)(slot) * (hs)->entry_size)
+
+/* private open addressing hashset functions */
+
+#if defined(__SSE2__)
+static unsigned int	ohashset_group_match(const unsigned char *ctrl, unsigned char value)
+{
+	__m128i	group = _mm_load_si128((const __m128i *)ctrl);
+
+	return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+}
+
+static unsigned int	ohashset_group_match_free(const unsigned char *ctrl)
+{
+	/* both empty and deleted control bytes have the highest bit set */
+	return (unsigned int)_mm_movemask_epi8(_mm_load_si128((const __m128i *)ctrl));
+}
+#else
+static unsigned int	ohashset_group_match(const unsigned char *ctrl, unsigned char value)
+{
+	unsigned int	i, mask = 0;
+
+	for (i = 0; i < OHS_GROUP_WIDTH; i++)
+		mask |= (unsigned int)(ctrl[i] == value) << i;
+
+	return mask;
+}
+
+static unsigned int	ohashset_group_match_free(const unsigned char *ctrl)
+{
+	unsigned int	i, mask = 0;
+
+	for (i = 0; i < OHS_GROUP_WIDTH; i++)
+		mask |= (unsigned int)(ctrl[i] >> 7) << i;
+
+	return mask;
+}
+#endif
+
+/* return the index of the lowest set bit in a non-zero match mask and clear it */
+static int	ohashset_mask_next(unsigned int *mask)
+{
+	int	index;
+#if defined(__GNUC__)
+	index = __builtin_ctz(*mask);
+#else
+	for (index = 0; 0 == (*mask & (1u << index)); index++)
+		;
+#endif
+	*mask &= *mask - 1;
+
+	return index;
+}
+
+static void	ohashset_free_entry(zbx_ohashset_t *hs, int slot)
+{
+	if (NULL != hs->clean_func)
+		hs->clean_func(OHS_SLOT_DATA(hs, slot));
+}
+
+static int	ohashset_alloc_slots(zbx_ohashset_t *hs, int num_slots)
+{
+	size_t	ctrl_size;
+	char	*slots;
+
+	/* control bytes are followed by entries, keep entries aligned to 8 bytes */
+	ctrl_size = (num_slots + 7) & ~7;
+
+	/* allocate extra OHS_GROUP_WIDTH bytes to align control byte groups */
+	if (NULL == (slots = (char *)hs->mem_malloc_func(NULL, OHS_GROUP_WIDTH + ctrl_size +
+			(size_t)num_slots * hs->entry_size)))
+	{
+		return FAIL;
+	}
+
+	hs->slots = slots;
+	hs->ctrl = (unsigned char *)((uintptr_t)(slots + OHS_GROUP_WIDTH - 1) & ~(uintptr_t)(OHS_GROUP_WIDTH - 1));
+	hs->entries = (char *)hs->ctrl + ctrl_size;
+	hs->num_slots = num_slots;
+	hs->num_data = 0;
+	hs->num_deleted = 0;
+
+	memset(hs->ctrl, OHS_CTRL_EMPTY, num_slots);
+
+	return SUCCEED;
+}
+
+static int	ohashset_num_slots(size_t size)
+{
+	int	num_slots = OHS_GROUP_WIDTH;
+
+	while ((size_t)OHS_MAX_LOAD(num_slots) < size)
+		num_slots *= 2;
+
+	return num_slots;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ohashset_find_free_slot                                          *
+ *                                                                            *
+ * Purpose: find empty or deleted slot for a new entry with the given hash    *
+ *                                                                            *
+ ******************************************************************************/
+static int	ohashset_find_free_slot(const zbx_ohashset_t *hs, zbx_hash_t hash)
+{
+	int		group, step = 0, group_mask = hs->num_slots - 1;
+	unsigned int	mask;
+
+	group = (OHS_H1(hash) * OHS_GROUP_WIDTH) & group_mask;
+
+	while (0 == (mask = ohashset_group_match_free(hs->ctrl + group)))
+	{
+		step += OHS_GROUP_WIDTH;
+		group = (group + step) & group_mask;
+	}
+
+	return group + ohashset_mask_next(&mask);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ohashset_find_slot                                               *
+ *                                                                            *
+ * Purpose: find slot of entry matching the data                              *
+ *                                                                            *
+ * Return value: the slot index or -1 if the entry was not found              *
+ *                                                                            *
+ ******************************************************************************/
+static int	ohashset_find_slot(const zbx_ohashset_t *hs, const void *data, zbx_hash_t hash)
+{
+	int		group, step = 0, group_mask = hs->num_slots - 1, slot;
+	unsigned char	h2 = OHS_H2(hash);
+	unsigned int	mask;
+
+	group = (OHS_H1(hash) * OHS_GROUP_WIDTH) & group_mask;
+
+	while (1)
+	{
+		mask = ohashset_group_match(hs->ctrl + group, h2);
+
+		while (0 != mask)
+		{
+			slot = group + ohashset_mask_next(&mask);
+
+			if (0 == hs->compare_func(OHS_SLOT_DATA(hs, slot), data))
+				return slot;
+		}
+
+		if (0 != ohashset_group_match(hs->ctrl + group, OHS_CTRL_EMPTY))
+			return -1;
+
+		/* all slots were probed - possible only with tombstones filling the remaining slots */
+		if ((step += OHS_GROUP_WIDTH) >= hs->num_slots)
+			return -1;
+
+		group = (group + step) & group_mask;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ohashset_rehash                                                  *
+ *                                                                            *
+ * Purpose: move all entries into new slots array of the specified size,      *
+ *          dropping tombstones                                               *
+ *                                                                            *
+ ******************************************************************************/
+static int	ohashset_rehash(zbx_ohashset_t *hs, int num_slots)
+{
+	zbx_ohashset_t	old = *hs;
+	int		slot, new_slot;
+	zbx_hash_t	hash;
+
+	if (SUCCEED != ohashset_alloc_slots(hs, num_slots))
+	{
+		*hs = old;
+		return FAIL;
+	}
+
+	for (slot = 0; slot < old.num_slots; slot++)
+	{
+		if (0 != (old.ctrl[slot] & 0x80))
+			continue;
+
+		hash = hs->hash_func(OHS_SLOT_DATA(&old, slot));
+		new_slot = ohashset_find_free_slot(hs, hash);
+		hs->ctrl[new_slot] = OHS_H2(hash);
+		memcpy(OHS_SLOT_DATA(hs, new_slot), OHS_SLOT_DATA(&old, slot), hs->entry_size);
+	}
+
+	hs->num_data = old.num_data;
+
+	if (NULL != old.slots)
+		hs->mem_free_func(old.slots);
+
+	return SUCCEED;
+}
+
+static void	ohashset_remove_slot(zbx_ohashset_t *hs, int slot)
+{
+	const unsigned char	*group;
+
+	ohashset_free_entry(hs, slot);
+
+	group = hs->ctrl + (slot & ~(OHS_GROUP_WIDTH - 1));
+
+	if (0 != ohashset_group_match(group, OHS_CTRL_EMPTY))
+	{
+		hs->ctrl[slot] = OHS_CTRL_EMPTY;
+	}
+	else
+	{
+		hs->ctrl[slot] = OHS_CTRL_DELETED;
+		hs->num_deleted++;
+	}
+
+	hs->num_data--;
+}
+
+/* public open addressing hashset interface */
+
+void	zbx_ohashset_create(zbx_ohashset_t *hs, size_t init_size, size_t entry_size,
+				zbx_hash_func_t hash_func,
+				zbx_compare_func_t compare_func)
+{
+	zbx_ohashset_create_ext(hs, init_size, entry_size, hash_func, compare_func, NULL,
+					ZBX_DEFAULT_MEM_MALLOC_FUNC,
+					ZBX_DEFAULT_MEM_REALLOC_FUNC,
+					ZBX_DEFAULT_MEM_FREE_FUNC);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ohashset_create_ext                                          *
+ *                                                                            *
+ * Purpose: create open addressing hashset of fixed size entries              *
+ *                                                                            *
+ * Parameters: hs         - [IN] the hashset                                  *
+ *             init_size  - [IN] the number of entries to reserve space for   *
+ *             entry_size - [IN] the entry size                               *
+ *             ...                                                            *
+ *                                                                            *
+ * Comments: Unlike zbx_hashset_t the entries are stored in place, so the     *
+ *           pointers returned by insert and search functions are valid only *
+ *           until the next insert operation.                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ohashset_create_ext(zbx_ohashset_t *hs, size_t init_size, size_t entry_size,
+				zbx_hash_func_t hash_func,
+				zbx_compare_func_t compare_func,
+				zbx_clean_func_t clean_func,
+				zbx_mem_malloc_func_t mem_malloc_func,
+				zbx_mem_realloc_func_t mem_realloc_func,
+				zbx_mem_free_func_t mem_free_func)
+{
+	hs->hash_func = hash_func;
+	hs->compare_func = compare_func;
+	hs->clean_func = clean_func;
+	hs->mem_malloc_func = mem_malloc_func;
+	hs->mem_realloc_func = mem_realloc_func;
+	hs->mem_free_func = mem_free_func;
+	hs->entry_size = (entry_size + 7) & ~(size_t)7;
+
+	hs->slots = NULL;
+	hs->ctrl = NULL;
+	hs->entries = NULL;
+	hs->num_slots = 0;
+	hs->num_data = 0;
+	hs->num_deleted = 0;
+
+	if (0 < init_size)
+		ohashset_alloc_slots(hs, ohashset_num_slots(init_size));
+}
+
+void	zbx_ohashset_destroy(zbx_ohashset_t *hs)
+{
+	zbx_ohashset_clear(hs);
+
+	if (NULL != hs->slots)
+	{
+		hs->mem_free_func(hs->slots);
+		hs->slots = NULL;
+	}
+
+	hs->ctrl = NULL;
+	hs->entries = NULL;
+	hs->num_slots = 0;
+
+	hs->hash_func = NULL;
+	hs->compare_func = NULL;
+	hs->mem_malloc_func = NULL;
+	hs->mem_realloc_func = NULL;
+	hs->mem_free_func = NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ohashset_insert                                              *
+ *                                                                            *
+ * Purpose: insert entry into hashset if it does not exist                    *
+ *                                                                            *
+ * Parameters: hs   - [IN] the hashset                                        *
+ *             data - [IN] the entry data, entry_size bytes are copied        *
+ *                                                                            *
+ * Return value: the inserted or existing entry or NULL if memory allocation  *
+ *               failed                                                       *
+ *                                                                            *
+ ******************************************************************************/
+void	*zbx_ohashset_insert(zbx_ohashset_t *hs, const void *data)
+{
+	int		slot;
+	zbx_hash_t	hash;
+
+	if (0 == hs->num_slots && SUCCEED != ohashset_alloc_slots(hs, OHS_GROUP_WIDTH))
+		return NULL;
+
+	hash = hs->hash_func(data);
+
+	if (-1 != (slot = ohashset_find_slot(hs, data, hash)))
+		return OHS_SLOT_DATA(hs, slot);
+
+	if (hs->num_data + hs->num_deleted + 1 > OHS_MAX_LOAD(hs->num_slots))
+	{
+		/* grow only if tombstones are not taking a significant part of slots */
+		int	num_slots = hs->num_slots;
+
+		if (hs->num_deleted < hs->num_slots / 4)
+			num_slots *= 2;
+
+		if (SUCCEED != ohashset_rehash(hs, num_slots))
+			return NULL;
+	}
+
+	slot = ohashset_find_free_slot(hs, hash);
+
+	if (OHS_CTRL_DELETED == hs->ctrl[slot])
+		hs->num_deleted--;
+
+	hs->ctrl[slot] = OHS_H2(hash);
+	memcpy(OHS_SLOT_DATA(hs, slot), data, hs->entry_size);
+	hs->num_data++;
+
+	return OHS_SLOT_DATA(hs, slot);
+}
+
+void	*zbx_ohashset_search(zbx_ohashset_t *hs, const void *data)
+{
+	int	slot;
+
+	if (0 == hs->num_data)
+		return NULL;
+
+	if (-1 == (slot = ohashset_find_slot(hs, data, hs->hash_func(data))))
+		return NULL;
+
+	return OHS_SLOT_DATA(hs, slot);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: remove a hashset entry using comparison with the given data       *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ohashset_remove(zbx_ohashset_t *hs, const void *data)
+{
+	int	slot;
+
+	if (0 == hs->num_data)
+		return;
+
+	if (-1 != (slot = ohashset_find_slot(hs, data, hs->hash_func(data))))
+		ohashset_remove_slot(hs, slot);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Purpose: remove a hashset entry using a data pointer returned to the user  *
+ *          by zbx_ohashset_insert() and zbx_ohashset_search() functions      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ohashset_remove_direct(zbx_ohashset_t *hs, const void *data)
+{
+	ohashset_remove_slot(hs, (int)(((const char *)data - hs->entries) / hs->entry_size));
+}
+
+void	zbx_ohashset_clear(zbx_ohashset_t *hs)
+{
+	int	slot;
+
+	if (0 == hs->num_slots)
+		return;
+
+	if (NULL != hs->clean_func)
+	{
+		for (slot = 0; slot < hs->num_slots; slot++)
+		{
+			if (0 == (hs->ctrl[slot] & 0x80))
+				ohashset_free_entry(hs, slot);
+		}
+	}
+
+	memset(hs->ctrl, OHS_CTRL_EMPTY, hs->num_slots);
+	hs->num_data = 0;
+	hs->num_deleted = 0;
+}
+
+void	zbx_ohashset_iter_reset(zbx_ohashset_t *hs, zbx_ohashset_iter_t *iter)
+{
+	iter->hashset = hs;
+	iter->slot = -1;
+}
+
+void	*zbx_ohashset_iter_next(zbx_ohashset_iter_t *iter)
+{
+	const zbx_ohashset_t	*hs = iter->hashset;
+
+	while (++iter->slot < hs->num_slots)
+	{
+		if (0 == (hs->ctrl[iter->slot] & 0x80))
+			return OHS_SLOT_DATA(hs, iter->slot);
+	}
+
+	iter->slot = hs->num_slots;
+
+	return NULL;
+}
+
+void	zbx_ohashset_iter_remove(zbx_ohashset_iter_t *iter)
+{
+	if (0 > iter->slot || iter->slot >= iter->hashset->num_slots || 0 != (iter->hashset->ctrl[iter->slot] & 0x80))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "removing an open addressing hashset entry through a bad iterator");
+		exit(EXIT_FAILURE);
+	}
+
+	ohashset_remove_slot(iter->hashset, iter->slot);
+}
@@ -22,8 +22,6 @@
 #include "telnet.h"
 #include "log.h"
 
-static char	prompt_char = '\0';
-
 static int	telnet_waitsocket(ZBX_SOCKET socket_fd, int mode)
 {
 	const char	*__function_name = "telnet_waitsocket";
@@ -295,7 +293,7 @@ static int	telnet_rm_echo(char *buf, size_t *offset, const char *echo, size_t le
 	return FAIL;
 }
 
-static void	telnet_rm_prompt(const char *buf, size_t *offset)
+static void	telnet_rm_prompt(const char *buf, size_t *offset, char prompt_char)
 {
 	unsigned char	state = 0;	/* 0 - init, 1 - prompt */
 
@@ -337,7 +335,8 @@ int	telnet_test_login(ZBX_SOCKET socket_fd)
 	return ret;
 }
 
-int	telnet_login(ZBX_SOCKET socket_fd, const char *username, const char *password, AGENT_RESULT *result)
+int	telnet_login(ZBX_SOCKET socket_fd, const char *username, const char *password, char *prompt_char,
+		AGENT_RESULT *result)
 {
 	const char	*__function_name = "telnet_login";
 	char		buf[MAX_BUFFER_LEN], c;
@@ -392,7 +391,7 @@ int	telnet_login(ZBX_SOCKET socket_fd, const char *username, const char *passwor
 	{
 		if ('$' == (c = telnet_lastchar(buf, offset)) || '#' == c || '>' == c || '%' == c)
 		{
-			prompt_char = c;
+			*prompt_char = c;
 			break;
 		}
 	}
@@ -413,7 +412,8 @@ fail:
 	return ret;
 }
 
-int	telnet_execute(ZBX_SOCKET socket_fd, const char *command, AGENT_RESULT *result, const char *encoding)
+int	telnet_execute(ZBX_SOCKET socket_fd, const char *command, char prompt_char, AGENT_RESULT *result,
+		const char *encoding)
 {
 	const char	*__function_name = "telnet_execute";
 	char		buf[MAX_BUFFER_LEN];
@@ -478,7 +478,7 @@ int	telnet_execute(ZBX_SOCKET socket_fd, const char *command, AGENT_RESULT *resu
 	}
 
 	telnet_rm_echo(buf, &offset, "\n", 1);
-	telnet_rm_prompt(buf, &offset);
+	telnet_rm_prompt(buf, &offset, prompt_char);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() stripped command output:'%.*s'", __function_name, (int)offset, buf);
 
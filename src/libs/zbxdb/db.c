@@ -41,8 +41,20 @@
 #	include "mutexs.h"
 #endif
 
+/* result data kept in memory instead of database client library structures */
+typedef struct
+{
+	char	**data;		/* fields_num values per row */
+	int	fields_num;
+	int	rows_num;
+	int	rows_alloc;
+	int	cursor;
+}
+zbx_db_mem_result_t;
+
 struct zbx_db_result
 {
+	zbx_db_mem_result_t	*mem;	/* NULL for database query results */
 #if defined(HAVE_IBM_DB2)
 	SQLHANDLE	hstmt;
 	SQLSMALLINT	nalloc;
@@ -1517,6 +1529,7 @@ error:
 	}
 #elif defined(HAVE_MYSQL)
 	result = zbx_malloc(NULL, sizeof(struct zbx_db_result));
+	result->mem = NULL;
 	result->result = NULL;
 
 	if (NULL == conn)
@@ -1684,6 +1697,7 @@ error:
 	}
 #elif defined(HAVE_POSTGRESQL)
 	result = zbx_malloc(NULL, sizeof(struct zbx_db_result));
+	result->mem = NULL;
 	result->pg_result = PQexec(conn, sql);
 	result->values = NULL;
 	result->cursor = 0;
@@ -1710,6 +1724,7 @@ error:
 		zbx_mutex_lock(&sqlite_access);
 
 	result = zbx_malloc(NULL, sizeof(struct zbx_db_result));
+	result->mem = NULL;
 	result->curow = 0;
 
 lbl_get_table:
@@ -1843,6 +1858,14 @@ DB_ROW	zbx_db_fetch(DB_RESULT result)
 	if (NULL == result)
 		return NULL;
 
+	if (NULL != result->mem)
+	{
+		if (result->mem->cursor == result->mem->rows_num)
+			return NULL;
+
+		return &result->mem->data[result->mem->cursor++ * result->mem->fields_num];
+	}
+
 #if defined(HAVE_IBM_DB2)
 	if (SUCCEED != zbx_ibm_db2_success(SQLFetch(result->hstmt)))	/* e.g., SQL_NO_DATA_FOUND */
 		return NULL;
@@ -2027,7 +2050,7 @@ static void	OCI_DBclean_result(DB_RESULT result)
 }
 #endif
 
-void	DBfree_result(DB_RESULT result)
+static void	zbx_db_free_query_result(DB_RESULT result)
 {
 #if defined(HAVE_IBM_DB2)
 	if (NULL == result)
@@ -2101,6 +2124,117 @@ void	DBfree_result(DB_RESULT result)
 #endif	/* HAVE_SQLITE3 */
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: DBfree_result                                                    *
+ *                                                                            *
+ * Purpose: free database query or in-memory result                           *
+ *                                                                            *
+ ******************************************************************************/
+void	DBfree_result(DB_RESULT result)
+{
+	int	i;
+
+	if (NULL == result)
+		return;
+
+	if (NULL == result->mem)
+	{
+		zbx_db_free_query_result(result);
+		return;
+	}
+
+	for (i = 0; i < result->mem->rows_num * result->mem->fields_num; i++)
+		zbx_free(result->mem->data[i]);
+
+	zbx_free(result->mem->data);
+	zbx_free(result->mem);
+	zbx_free(result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_db_mem_result_create                                         *
+ *                                                                            *
+ * Purpose: create an empty result kept in memory                             *
+ *                                                                            *
+ * Parameters: fields_num - [IN] the number of fields in result rows          *
+ *                                                                            *
+ * Return value: the created result                                           *
+ *                                                                            *
+ * Comments: The rows are added with zbx_db_mem_result_add_row() function,    *
+ *           the result is fetched with DBfetch() and freed with              *
+ *           DBfree_result() as any other database result.                    *
+ *                                                                            *
+ ******************************************************************************/
+DB_RESULT	zbx_db_mem_result_create(int fields_num)
+{
+	DB_RESULT	result;
+
+	result = zbx_malloc(NULL, sizeof(struct zbx_db_result));
+	memset(result, 0, sizeof(struct zbx_db_result));
+
+	result->mem = zbx_malloc(NULL, sizeof(zbx_db_mem_result_t));
+	memset(result->mem, 0, sizeof(zbx_db_mem_result_t));
+	result->mem->fields_num = fields_num;
+
+	return result;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_db_mem_result_add_row                                        *
+ *                                                                            *
+ * Purpose: append a copy of row to the in-memory result                      *
+ *                                                                            *
+ * Parameters: result - [IN] the result created by zbx_db_mem_result_create() *
+ *             row    - [IN] the row with fields_num values (can be NULL)     *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_db_mem_result_add_row(DB_RESULT result, const DB_ROW row)
+{
+	zbx_db_mem_result_t	*mem = result->mem;
+	int			i;
+	char			**values;
+
+	if (mem->rows_num == mem->rows_alloc)
+	{
+		mem->rows_alloc = (0 == mem->rows_alloc ? 16 : mem->rows_alloc * 3 / 2);
+		mem->data = zbx_realloc(mem->data, sizeof(char *) * mem->rows_alloc * mem->fields_num);
+	}
+
+	values = &mem->data[mem->rows_num++ * mem->fields_num];
+
+	for (i = 0; i < mem->fields_num; i++)
+		values[i] = (NULL == row[i] ? NULL : zbx_strdup(NULL, row[i]));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_db_result_fields_num                                         *
+ *                                                                            *
+ * Purpose: get the number of fields in result rows                           *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_db_result_fields_num(DB_RESULT result)
+{
+	if (NULL == result)
+		return 0;
+
+	if (NULL != result->mem)
+		return result->mem->fields_num;
+
+#if defined(HAVE_IBM_DB2) || defined(HAVE_ORACLE) || defined(HAVE_SQLITE3)
+	return result->ncolumn;
+#elif defined(HAVE_MYSQL)
+	return (NULL == result->result ? 0 : (int)mysql_num_fields(result->result));
+#elif defined(HAVE_POSTGRESQL)
+	return PQnfields(result->pg_result);
+#else
+	return 0;
+#endif
+}
+
 #if defined(HAVE_IBM_DB2)
 /* server status: SQL_CD_TRUE or SQL_CD_FALSE */
 static int	IBM_DB2server_status()
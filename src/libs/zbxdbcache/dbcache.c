@@ -33,6 +33,9 @@
 #include "valuecache.h"
 #include "zbxmodules.h"
 #include "module.h"
+#include "zbxself.h"
+
+#include <poll.h>
 
 static zbx_mem_info_t	*hc_index_mem = NULL;
 static zbx_mem_info_t	*hc_mem = NULL;
@@ -160,6 +163,32 @@ typedef struct
 }
 ZBX_DC_STATS;
 
+/* value waiting in preprocessing queue for delta and multiplier calculation */
+typedef struct zbx_hc_preproc_value
+{
+	zbx_uint64_t			itemid;
+	zbx_hc_data_t			*data;
+	struct zbx_hc_preproc_value	*next;
+}
+zbx_hc_preproc_value_t;
+
+typedef struct
+{
+	zbx_hc_preproc_value_t	*head;
+	zbx_hc_preproc_value_t	*tail;
+	int			values_num;
+
+	/* the last raw values of delta items routed to this queue, updated under the cache lock */
+	/* by the worker owning the queue or by the main process after the workers have exited  */
+	zbx_hashset_t		delta_history;
+
+	/* the worker waits for values on the read end of the pipe, see DCpreprocess_wait(), */
+	/* the pipe is created before forking so the descriptors are valid in all processes  */
+	int			fd_wakeup[2];
+	unsigned char		waiting;
+}
+zbx_hc_preproc_queue_t;
+
 typedef struct
 {
 	zbx_hashset_t		trends;
@@ -168,6 +197,14 @@ typedef struct
 	zbx_hashset_t		history_items;
 	zbx_binary_heap_t	history_queue;
 
+	/* the reference counted string, text and log values, see hc_mem_value_str_dup() */
+	zbx_hashset_t		history_strpool;
+
+	/* numeric values are routed by itemid to preprocessing worker queues before */
+	/* being added to history queue, NULL when values are not preprocessed       */
+	zbx_hc_preproc_queue_t	*preproc_queues;
+	int			preproc_queues_num;
+
 	int			history_num;
 	int			trends_num;
 	int			trends_last_cleanup_hour;
@@ -218,9 +255,9 @@ static size_t		string_values_alloc = 0, string_values_offset = 0;
 static dc_item_value_t	*item_values = NULL;
 static size_t		item_values_alloc = 0, item_values_num = 0;
 
-static void	hc_add_item_values(dc_item_value_t *values, int values_num);
+static int	hc_add_item_values(dc_item_value_t *values, int values_num, double cached);
 static void	hc_pop_items(zbx_vector_ptr_t *history_items);
-static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items);
+static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items, double popped);
 static void	hc_push_busy_items(zbx_vector_ptr_t *history_items);
 static int	hc_push_processed_items(zbx_vector_ptr_t *history_items);
 static void	hc_free_item_values(ZBX_DC_HISTORY *history, int history_num);
@@ -910,258 +947,33 @@ clean_items:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
-static int	DBchk_double(double value)
-{
-	/* field with precision 16, scale 4 [NUMERIC(16,4)] */
-	const double	pg_min_numeric = -1e12;
-	const double	pg_max_numeric = 1e12;
-
-	if (value <= pg_min_numeric || value >= pg_max_numeric)
-		return FAIL;
-
-	return SUCCEED;
-}
-
-static double	multiply_item_value_float(DC_ITEM *item, double value)
-{
-	double	value_double;
-
-	if (ITEM_MULTIPLIER_USE != item->multiplier)
-		return value;
-
-	value_double = value * atof(item->formula);
-
-	zabbix_log(LOG_LEVEL_DEBUG, "multiply_item_value_float() " ZBX_FS_DBL ",%s " ZBX_FS_DBL,
-			value, item->formula, value_double);
-
-	return value_double;
-}
-
-static zbx_uint64_t	multiply_item_value_uint64(DC_ITEM *item, zbx_uint64_t value)
-{
-	zbx_uint64_t	formula_uint64, value_uint64;
-
-	if (ITEM_MULTIPLIER_USE != item->multiplier)
-		return value;
-
-	if (SUCCEED == is_uint64(item->formula, &formula_uint64))
-		value_uint64 = value * formula_uint64;
-	else
-		value_uint64 = (zbx_uint64_t)((double)value * atof(item->formula));
-
-	zabbix_log(LOG_LEVEL_DEBUG, "multiply_item_value_uint64() " ZBX_FS_UI64 ",%s " ZBX_FS_UI64,
-			value, item->formula, value_uint64);
-
-	return value_uint64;
-}
-
-/******************************************************************************
- *                                                                            *
- * Function: DCcalculate_item_delta_float                                     *
- *                                                                            *
- * Purpose: calculate delta value for items of float value type               *
- *                                                                            *
- * Parameters: item      - [IN] item reference                                *
- *             h         - [IN/OUT] a reference to history cache value        *
- *             deltaitem - [IN] a reference to the last raw history value     *
- *                         (value + timestamp)                                *
- *                                                                            *
- ******************************************************************************/
-static void	DCcalculate_item_delta_float(DC_ITEM *item, ZBX_DC_HISTORY *h, zbx_item_history_value_t *deltaitem)
-{
-	switch (item->delta)
-	{
-		case ITEM_STORE_AS_IS:
-			h->value.dbl = multiply_item_value_float(item, h->value_orig.dbl);
-
-			if (SUCCEED != DBchk_double(h->value.dbl))
-			{
-				h->state = ITEM_STATE_NOTSUPPORTED;
-				h->flags |= ZBX_DC_FLAG_UNDEF;
-			}
-
-			break;
-		case ITEM_STORE_SPEED_PER_SECOND:
-			if (0 != deltaitem->timestamp.sec && deltaitem->value.dbl <= h->value_orig.dbl &&
-					0 > zbx_timespec_compare(&deltaitem->timestamp, &h->ts))
-			{
-				h->value.dbl = (h->value_orig.dbl - deltaitem->value.dbl) /
-						((h->ts.sec - deltaitem->timestamp.sec) +
-							(double)(h->ts.ns - deltaitem->timestamp.ns) / 1000000000);
-				h->value.dbl = multiply_item_value_float(item, h->value.dbl);
-
-				if (SUCCEED != DBchk_double(h->value.dbl))
-				{
-					h->state = ITEM_STATE_NOTSUPPORTED;
-					h->flags |= ZBX_DC_FLAG_UNDEF;
-				}
-			}
-			else
-				h->flags |= ZBX_DC_FLAG_UNDEF;
-
-			break;
-		case ITEM_STORE_SIMPLE_CHANGE:
-			if (0 != deltaitem->timestamp.sec && deltaitem->value.dbl <= h->value_orig.dbl)
-			{
-				h->value.dbl = h->value_orig.dbl - deltaitem->value.dbl;
-				h->value.dbl = multiply_item_value_float(item, h->value.dbl);
-
-				if (SUCCEED != DBchk_double(h->value.dbl))
-				{
-					h->state = ITEM_STATE_NOTSUPPORTED;
-					h->flags |= ZBX_DC_FLAG_UNDEF;
-				}
-			}
-			else
-				h->flags |= ZBX_DC_FLAG_UNDEF;
-
-			break;
-	}
-
-	if (ITEM_STATE_NOTSUPPORTED == h->state)
-	{
-		int	errcode = SUCCEED;
-
-		h->value_orig.err = zbx_dsprintf(NULL, "Type of received value"
-				" [" ZBX_FS_DBL "] is not suitable for value type [%s]",
-				h->value.dbl, zbx_item_value_type_string(item->value_type));
-
-		DCrequeue_items(&h->itemid, &h->state, &h->ts.sec, NULL, NULL, &errcode, 1);
-	}
-}
-
-/******************************************************************************
- *                                                                            *
- * Function: DCcalculate_item_delta_uint64                                    *
- *                                                                            *
- * Purpose: calculate delta value for items of uint64 value type              *
- *                                                                            *
- * Parameters: item      - [IN] item reference                                *
- *             h         - [IN/OUT] a reference to history cache value        *
- *             deltaitem - [IN] a reference to the last raw history value     *
- *                         (value + timestamp)                                *
- *                                                                            *
- ******************************************************************************/
-static void	DCcalculate_item_delta_uint64(DC_ITEM *item, ZBX_DC_HISTORY *h, zbx_item_history_value_t *deltaitem)
-{
-	switch (item->delta)
-	{
-		case ITEM_STORE_AS_IS:
-			h->value.ui64 = multiply_item_value_uint64(item, h->value_orig.ui64);
-
-			break;
-		case ITEM_STORE_SPEED_PER_SECOND:
-			if (0 != deltaitem->timestamp.sec && deltaitem->value.ui64 <= h->value_orig.ui64 &&
-					0 > zbx_timespec_compare(&deltaitem->timestamp, &h->ts))
-			{
-				h->value.ui64 = (h->value_orig.ui64 - deltaitem->value.ui64) /
-						((h->ts.sec - deltaitem->timestamp.sec) +
-							(double)(h->ts.ns - deltaitem->timestamp.ns) / 1000000000);
-				h->value.ui64 = multiply_item_value_uint64(item, h->value.ui64);
-			}
-			else
-				h->flags |= ZBX_DC_FLAG_UNDEF;
-
-			break;
-		case ITEM_STORE_SIMPLE_CHANGE:
-			if (0 != deltaitem->timestamp.sec && deltaitem->value.ui64 <= h->value_orig.ui64)
-			{
-				h->value.ui64 = h->value_orig.ui64 - deltaitem->value.ui64;
-				h->value.ui64 = multiply_item_value_uint64(item, h->value.ui64);
-			}
-			else
-				h->flags |= ZBX_DC_FLAG_UNDEF;
-
-			break;
-	}
-}
-
-static zbx_item_history_value_t	*DCget_deltaitem(zbx_hashset_t *delta_history, DC_ITEM *item, ZBX_DC_HISTORY *h)
-{
-	zbx_item_history_value_t	*deltaitem;
-
-	if (ITEM_VALUE_TYPE_FLOAT != item->value_type && ITEM_VALUE_TYPE_UINT64 != item->value_type)
-		return NULL;
-
-	if (ITEM_STORE_AS_IS == item->delta)
-		return NULL;
-
-	deltaitem = zbx_hashset_search(delta_history, &item->itemid);
-
-	if (ITEM_STATE_NOTSUPPORTED == h->state)
-		return deltaitem;
-
-	if (NULL == deltaitem)
-	{
-		zbx_item_history_value_t	value = {item->itemid};
-
-		deltaitem = zbx_hashset_insert(delta_history, &value, sizeof(value));
-	}
-
-	return deltaitem;
-}
-
 /******************************************************************************
  *                                                                            *
  * Function: DCadd_update_item_sql                                            *
  *                                                                            *
  * Purpose: 1) generate sql for updating item in database                     *
- *          2) calculate item delta value                                     *
- *          3) add events (item supported/not supported)                      *
- *          4) update cache (requeue item)                                    *
+ *          2) add events (item supported/not supported)                      *
+ *          3) update cache (requeue item)                                    *
  *                                                                            *
  * Parameters: item - [IN/OUT] item reference                                 *
- *             h    - [IN/OUT] a reference to history cache value             *
+ *             h    - [IN] a reference to history cache value                 *
+ *                                                                            *
+ * Comments: delta and multiplier are already applied to the value by         *
+ *           preprocessing workers, see DCpreprocess_history()                *
  *                                                                            *
  ******************************************************************************/
-static void	DCadd_update_item_sql(size_t *sql_offset, DC_ITEM *item, ZBX_DC_HISTORY *h,
-		zbx_hashset_t *delta_history)
+static void	DCadd_update_item_sql(size_t *sql_offset, DC_ITEM *item, ZBX_DC_HISTORY *h)
 {
-	char				*value_esc;
-	const char			*sql_start = "update items set ", *sql_continue = ",";
-	zbx_item_history_value_t	*deltaitem;
-
-	deltaitem = DCget_deltaitem(delta_history, item, h);
-
-	if (ITEM_STATE_NOTSUPPORTED == h->state)
-		goto notsupported;
-
-	if (0 == (ZBX_DC_FLAG_NOVALUE & h->flags))
-	{
-		switch (item->value_type)
-		{
-			case ITEM_VALUE_TYPE_FLOAT:
-				DCcalculate_item_delta_float(item, h, deltaitem);
-				break;
-			case ITEM_VALUE_TYPE_UINT64:
-				DCcalculate_item_delta_uint64(item, h, deltaitem);
-				break;
-		}
-	}
+	char		*value_esc;
+	const char	*sql_start = "update items set ", *sql_continue = ",";
 
-	if (0 != (ZBX_DC_FLAG_META & h->flags))
+	if (ITEM_STATE_NORMAL == h->state && 0 != (ZBX_DC_FLAG_META & h->flags))
 	{
 		zbx_snprintf_alloc(&sql, &sql_alloc, sql_offset, "%slastlogsize=" ZBX_FS_UI64 ",mtime=%d",
 				sql_start, h->lastlogsize, h->mtime);
 		sql_start = sql_continue;
 	}
 
-notsupported:
-	/* update the last value (raw) of the delta items */
-	if (NULL != deltaitem)
-	{
-		/* set timestamp.sec to zero to remove this record from delta items later */
-		if (ITEM_STATE_NOTSUPPORTED == h->state || ITEM_STORE_AS_IS == item->delta)
-		{
-			deltaitem->timestamp.sec = 0;
-		}
-		else
-		{
-			deltaitem->timestamp = h->ts;
-			deltaitem->value = h->value_orig;
-		}
-	}
-
 	if (ITEM_STATE_NOTSUPPORTED == h->state)
 	{
 		int	update_cache = 0;
@@ -1317,14 +1129,12 @@ static void	DCmass_update_items(ZBX_DC_HISTORY *history, int history_num)
 	zbx_vector_uint64_t	itemids;
 	DC_ITEM			*items = NULL;
 	int			i, *errcodes = NULL;
-	zbx_hashset_t		delta_history = {NULL};
 	zbx_vector_ptr_t	inventory_values;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
 	items = zbx_malloc(items, sizeof(DC_ITEM) * (size_t)history_num);
 	errcodes = zbx_malloc(errcodes, sizeof(int) * (size_t)history_num);
-	zbx_hashset_create(&delta_history, 1000, ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	zbx_vector_ptr_create(&inventory_values);
 	zbx_vector_uint64_create(&itemids);
@@ -1336,7 +1146,6 @@ static void	DCmass_update_items(ZBX_DC_HISTORY *history, int history_num)
 	zbx_vector_uint64_sort(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
 
 	DCconfig_get_items_by_itemids(items, itemids.values, errcodes, history_num);
-	DCget_delta_items(&delta_history, &itemids);
 
 	zbx_vector_uint64_clear(&itemids);	/* item ids that are not disabled and not deleted in DB */
 
@@ -1382,7 +1191,7 @@ static void	DCmass_update_items(ZBX_DC_HISTORY *history, int history_num)
 			h->flags |= ZBX_DC_FLAG_NOTRENDS;
 		}
 
-		DCadd_update_item_sql(&sql_offset, &items[i], h, &delta_history);
+		DCadd_update_item_sql(&sql_offset, &items[i], h);
 		DBexecute_overflowed_sql(&sql, &sql_alloc, &sql_offset);
 
 		DCinventory_value_add(&inventory_values, &items[i], h);
@@ -1406,11 +1215,8 @@ static void	DCmass_update_items(ZBX_DC_HISTORY *history, int history_num)
 
 	zbx_vector_uint64_destroy(&itemids);
 
-	DCset_delta_items(&delta_history);
-
 	DCconfig_clean_items(items, errcodes, history_num);
 
-	zbx_hashset_destroy(&delta_history);
 	zbx_free(errcodes);
 	zbx_free(items);
 
@@ -2140,6 +1946,45 @@ static void	DCmodule_prepare_history(ZBX_DC_HISTORY *history, int history_num, Z
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_history_add_latency                                           *
+ *                                                                            *
+ * Purpose: account latency of history syncer stages for synced values        *
+ *                                                                            *
+ * Parameters: history      - [IN] the synced history values                  *
+ *             history_num  - [IN] the number of values                       *
+ *             committed    - [IN] the time when transaction was committed    *
+ *             time_sync    - [IN] the time spent preparing batch and         *
+ *                                 updating items                             *
+ *             time_db      - [IN] the time spent writing history and         *
+ *                                 committing transaction                     *
+ *             time_trigger - [IN] the time spent evaluating triggers         *
+ *                                                                            *
+ * Comments: Syncer stages are processed per batch, so every value in batch   *
+ *           is accounted with the same stage latency.                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_history_add_latency(const ZBX_DC_HISTORY *history, int history_num, double committed,
+		double time_sync, double time_db, double time_trigger)
+{
+	int	i;
+
+	zbx_latency_add(ZBX_LATENCY_STAGE_SYNC, time_sync, history_num);
+	zbx_latency_add(ZBX_LATENCY_STAGE_DB, time_db, history_num);
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+		zbx_latency_add(ZBX_LATENCY_STAGE_TRIGGER, time_trigger, history_num);
+
+	for (i = 0; i < history_num; i++)
+	{
+		zbx_latency_add(ZBX_LATENCY_STAGE_TOTAL, committed - history[i].ts.sec - history[i].ts.ns / 1000000000.0,
+				1);
+	}
+
+	zbx_latency_flush();
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: DCsync_history                                                   *
@@ -2168,6 +2013,7 @@ int	DCsync_history(int sync_type, int *total_num)
 	int				history_num, candidate_num, next_sync = 0, history_float_num,
 					history_integer_num, history_string_num, history_text_num, history_log_num;
 	time_t				sync_start, now;
+	double				time_pop, time_start, now_commit, time_sync, time_db, time_trigger;
 	zbx_vector_uint64_t		triggerids;
 	zbx_vector_ptr_t		history_items, trigger_diff;
 	zbx_binary_heap_t		tmp_history_queue;
@@ -2275,15 +2121,24 @@ int	DCsync_history(int sync_type, int *total_num)
 		if (0 == history_num)
 			break;
 
-		hc_get_item_values(history, &history_items);	/* copy item data from history cache */
+		time_pop = zbx_time();
+
+		hc_get_item_values(history, &history_items, time_pop);	/* copy item data from history cache */
 
 		DBbegin();
 
 		if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 		{
 			DCmass_update_items(history, history_num);
+			time_sync = (time_start = zbx_time()) - time_pop;
+
 			DCmass_add_history(history, history_num);
+			time_db = zbx_time() - time_start;
+
+			time_start = zbx_time();
 			DCmass_update_triggers(history, history_num, &trigger_diff);
+			time_trigger = zbx_time() - time_start;
+
 			DCmass_update_trends(history, history_num);
 
 			/* processing of events, generated in functions: */
@@ -2297,11 +2152,21 @@ int	DCsync_history(int sync_type, int *total_num)
 		}
 		else
 		{
+			time_start = zbx_time();
 			DCmass_proxy_add_history(history, history_num);
+			time_db = zbx_time() - time_start;
+
 			DCmass_proxy_update_items(history, history_num);
+			time_sync = zbx_time() - time_pop - time_db;
+			time_trigger = 0;
 		}
 
+		time_start = zbx_time();
 		DBcommit();
+		now_commit = zbx_time();
+		time_db += now_commit - time_start;
+
+		dc_history_add_latency(history, history_num, now_commit, time_sync, time_db, time_trigger);
 
 		if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 		{
@@ -2659,13 +2524,15 @@ static void	dc_local_add_history_log(zbx_uint64_t itemid, const zbx_timespec_t *
 	}
 }
 
-static void	dc_local_add_history_notsupported(zbx_uint64_t itemid, const zbx_timespec_t *ts, const char *error)
+static void	dc_local_add_history_notsupported(zbx_uint64_t itemid, unsigned char value_type,
+		const zbx_timespec_t *ts, const char *error)
 {
 	dc_item_value_t	*item_value;
 
 	item_value = dc_local_get_history_slot();
 
 	item_value->itemid = itemid;
+	item_value->value_type = value_type;
 	item_value->ts = *ts;
 	item_value->state = ITEM_STATE_NOTSUPPORTED;
 	item_value->value.value_str.len = zbx_db_strlen_n(error, ITEM_ERROR_LEN) + 1;
@@ -2717,7 +2584,7 @@ void	dc_add_history(zbx_uint64_t itemid, unsigned char value_type, unsigned char
 
 	if (ITEM_STATE_NOTSUPPORTED == state)
 	{
-		dc_local_add_history_notsupported(itemid, ts, error);
+		dc_local_add_history_notsupported(itemid, value_type, ts, error);
 		return;
 	}
 
@@ -2795,17 +2662,28 @@ void	dc_add_history(zbx_uint64_t itemid, unsigned char value_type, unsigned char
 
 void	dc_flush_history(void)
 {
+	double	now;
+	size_t	i;
+
 	if (0 == item_values_num)
 		return;
 
-	LOCK_CACHE;
+	now = zbx_time();
 
-	hc_add_item_values(item_values, item_values_num);
+	LOCK_CACHE;
 
-	cache->history_num += item_values_num;
+	cache->history_num += hc_add_item_values(item_values, item_values_num, now);
 
 	UNLOCK_CACHE;
 
+	for (i = 0; i < item_values_num; i++)
+	{
+		zbx_latency_add(ZBX_LATENCY_STAGE_COLLECT, now - item_values[i].ts.sec -
+				item_values[i].ts.ns / 1000000000.0, 1);
+	}
+
+	zbx_latency_flush();
+
 	item_values_num = 0;
 	string_values_offset = 0;
 }
@@ -2818,11 +2696,80 @@ void	dc_flush_history(void)
 ZBX_MEM_FUNC_IMPL(__hc_index, hc_index_mem)
 ZBX_MEM_FUNC_IMPL(__hc, hc_mem)
 
+#define REFCOUNT_FIELD_SIZE	sizeof(zbx_uint32_t)
+
+static zbx_hash_t	hc_strpool_hash_func(const void *data)
+{
+	return ZBX_DEFAULT_STRING_HASH_FUNC((char *)data + REFCOUNT_FIELD_SIZE);
+}
+
+static int	hc_strpool_compare_func(const void *d1, const void *d2)
+{
+	return strcmp((char *)d1 + REFCOUNT_FIELD_SIZE, (char *)d2 + REFCOUNT_FIELD_SIZE);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_mem_value_str_dup                                             *
+ *                                                                            *
+ * Purpose: copies string value to history cache                              *
+ *                                                                            *
+ * Parameters: str - [IN] the string value                                    *
+ *                                                                            *
+ * Return value: the copied string or NULL if there was not enough memory     *
+ *                                                                            *
+ * Comments: The strings are pooled - if the cache already contains matching  *
+ *           string its reference counter is incremented instead of copying.  *
+ *           The returned string must be freed with hc_mem_value_str_free().  *
+ *                                                                            *
+ ******************************************************************************/
+static char	*hc_mem_value_str_dup(const dc_value_str_t *str)
+{
+	void	*ptr;
+	char	*value = &string_values[str->pvalue];
+
+	/* the value can be truncated in local buffer, terminate it for lookup */
+	value[str->len - 1] = '\0';
+
+	if (NULL == (ptr = zbx_hashset_search(&cache->history_strpool, value - REFCOUNT_FIELD_SIZE)))
+	{
+		if (NULL == (ptr = zbx_hashset_insert_ext(&cache->history_strpool, value - REFCOUNT_FIELD_SIZE,
+				REFCOUNT_FIELD_SIZE + str->len, REFCOUNT_FIELD_SIZE)))
+		{
+			return NULL;
+		}
+
+		*(zbx_uint32_t *)ptr = 0;
+	}
+
+	(*(zbx_uint32_t *)ptr)++;
+
+	return (char *)ptr + REFCOUNT_FIELD_SIZE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_mem_value_str_free                                            *
+ *                                                                            *
+ * Purpose: releases string value copied with hc_mem_value_str_dup()          *
+ *                                                                            *
+ * Parameters: str - [IN] the string value                                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_mem_value_str_free(char *str)
+{
+	void	*ptr = str - REFCOUNT_FIELD_SIZE;
+
+	if (0 == --(*(zbx_uint32_t *)ptr))
+		zbx_hashset_remove_direct(&cache->history_strpool, ptr);
+}
+
 struct zbx_hc_data
 {
 	history_value_t	value;
 	zbx_uint64_t	lastlogsize;
 	zbx_timespec_t	ts;
+	double		cached;		/* time when the value was added to history cache */
 	int		mtime;
 	unsigned char	value_type;
 	unsigned char	flags;
@@ -2863,7 +2810,7 @@ static void	hc_free_data(zbx_hc_data_t *data)
 {
 	if (ITEM_STATE_NOTSUPPORTED == data->state)
 	{
-		__hc_mem_free_func(data->value.str);
+		hc_mem_value_str_free(data->value.str);
 	}
 	else
 	{
@@ -2873,13 +2820,13 @@ static void	hc_free_data(zbx_hc_data_t *data)
 			{
 				case ITEM_VALUE_TYPE_STR:
 				case ITEM_VALUE_TYPE_TEXT:
-					__hc_mem_free_func(data->value.str);
+					hc_mem_value_str_free(data->value.str);
 					break;
 				case ITEM_VALUE_TYPE_LOG:
-					__hc_mem_free_func(data->value.log->value);
+					hc_mem_value_str_free(data->value.log->value);
 
 					if (NULL != data->value.log->source)
-						__hc_mem_free_func(data->value.log->source);
+						hc_mem_value_str_free(data->value.log->source);
 
 					__hc_mem_free_func(data->value.log);
 					break;
@@ -2942,30 +2889,6 @@ static zbx_hc_item_t	*hc_add_item(zbx_uint64_t itemid, zbx_hc_data_t *data)
 	return (zbx_hc_item_t *)zbx_hashset_insert(&cache->history_items, &item_local, sizeof(item_local));
 }
 
-/******************************************************************************
- *                                                                            *
- * Function: hc_mem_value_str_dup                                             *
- *                                                                            *
- * Purpose: copies string value to history cache                              *
- *                                                                            *
- * Parameters: str - [IN] the string value                                    *
- *                                                                            *
- * Return value: the copied string or NULL if there was not enough memory     *
- *                                                                            *
- ******************************************************************************/
-static char	*hc_mem_value_str_dup(const dc_value_str_t *str)
-{
-	char	*ptr;
-
-	if (NULL == (ptr = (char *)__hc_mem_malloc_func(NULL, str->len)))
-		return NULL;
-
-	memcpy(ptr, &string_values[str->pvalue], str->len - 1);
-	ptr[str->len - 1] = '\0';
-
-	return ptr;
-}
-
 /******************************************************************************
  *                                                                            *
  * Function: hc_clone_history_str_data                                        *
@@ -3046,6 +2969,7 @@ static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_
  *                                                                            *
  * Parameters: data       - [IN/OUT] a reference to the cloned value          *
  *             item_value - [IN] the item value                               *
+ *             cached     - [IN] the time when value is added to cache        *
  *                                                                            *
  * Return value: SUCCESS - the item value was cloned successfully             *
  *               FAIL    - not enough memory                                  *
@@ -3054,7 +2978,7 @@ static int	hc_clone_history_log_data(zbx_log_value_t **dst, const dc_item_value_
  *           until it finishes cloning item value.                            *
  *                                                                            *
  ******************************************************************************/
-static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *item_value)
+static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *item_value, double cached)
 {
 	if (NULL == *data)
 	{
@@ -3066,6 +2990,7 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 		(*data)->state = item_value->state;
 		(*data)->ts = item_value->ts;
 		(*data)->flags = item_value->flags;
+		(*data)->cached = cached;
 	}
 
 	if (ITEM_STATE_NOTSUPPORTED == item_value->state)
@@ -3139,23 +3064,130 @@ static int	hc_clone_history_data(zbx_hc_data_t **data, const dc_item_value_t *it
 
 /******************************************************************************
  *                                                                            *
- * Function: hc_add_item_values                                               *
+ * Function: hc_add_item_data                                                 *
+ *                                                                            *
+ * Purpose: appends value to the item history in history cache                *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *             data   - [IN] the history data to add                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_add_item_data(zbx_uint64_t itemid, zbx_hc_data_t *data)
+{
+	zbx_hc_item_t	*item;
+
+	if (NULL == (item = hc_get_item(itemid)))
+	{
+		item = hc_add_item(itemid, data);
+		hc_queue_item(item);
+	}
+	else
+	{
+		item->head->next = data;
+		item->head = data;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_preproc_required                                              *
+ *                                                                            *
+ * Purpose: checks if value must pass preprocessing queue before being added  *
+ *          to history queue                                                  *
+ *                                                                            *
+ * Parameters: item_value - [IN] the item value                               *
+ *                                                                            *
+ * Return value: SUCCEED - the value must be preprocessed                     *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: All values of numeric items, including not supported ones, are   *
+ *           routed to preprocessing so that the worker owning the item sees  *
+ *           them in the same order as they are added to history cache.       *
+ *                                                                            *
+ ******************************************************************************/
+static int	hc_preproc_required(const dc_item_value_t *item_value)
+{
+	if (NULL == cache->preproc_queues || 0 != (ZBX_DC_FLAG_LLD & item_value->flags))
+		return FAIL;
+
+	if (ITEM_VALUE_TYPE_FLOAT != item_value->value_type && ITEM_VALUE_TYPE_UINT64 != item_value->value_type)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_preproc_queue_value                                           *
+ *                                                                            *
+ * Purpose: adds value to the preprocessing queue of the worker owning the    *
+ *          item                                                              *
+ *                                                                            *
+ * Parameters: itemid - [IN] the item identifier                              *
+ *             data   - [IN] the history data to preprocess                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_preproc_queue_value(zbx_uint64_t itemid, zbx_hc_data_t *data)
+{
+	zbx_hc_preproc_queue_t	*queue;
+	zbx_hc_preproc_value_t	*value;
+
+	while (NULL == (value = (zbx_hc_preproc_value_t *)__hc_mem_malloc_func(NULL, sizeof(zbx_hc_preproc_value_t))))
+	{
+		UNLOCK_CACHE;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "History buffer is full. Sleeping for 1 second.");
+		sleep(1);
+
+		LOCK_CACHE;
+	}
+
+	value->itemid = itemid;
+	value->data = data;
+	value->next = NULL;
+
+	queue = &cache->preproc_queues[itemid % cache->preproc_queues_num];
+
+	if (NULL == queue->tail)
+		queue->head = value;
+	else
+		queue->tail->next = value;
+
+	queue->tail = value;
+	queue->values_num++;
+
+	if (0 != queue->waiting)
+	{
+		/* the pipe is non-blocking, if it is full the worker has not read the previous wakeup yet */
+		if (1 != write(queue->fd_wakeup[1], "", 1) && EAGAIN != errno)
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot wake up preprocessing worker: %s", zbx_strerror(errno));
+
+		queue->waiting = 0;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_add_item_values                                               *
  *                                                                            *
  * Purpose: adds item values to the history cache                             *
  *                                                                            *
  * Parameters: values     - [IN] the item values to add                       *
  *             values_num - [IN] the number of item values to add             *
+ *             cached     - [IN] the time when values are added to cache      *
+ *                                                                            *
+ * Return value: the number of values added to history queue, the rest are    *
+ *               waiting in preprocessing queues                              *
  *                                                                            *
  * Comments: If the history cache is full this function will wait until       *
  *           history syncers processes values freeing enough space to store   *
  *           the new value.                                                   *
  *                                                                            *
  ******************************************************************************/
-static void	hc_add_item_values(dc_item_value_t *values, int values_num)
+static int	hc_add_item_values(dc_item_value_t *values, int values_num, double cached)
 {
 	dc_item_value_t	*item_value;
-	int		i;
-	zbx_hc_item_t	*item;
+	int		i, history_num = 0;
 
 	for (i = 0; i < values_num; i++)
 	{
@@ -3163,7 +3195,7 @@ static void	hc_add_item_values(dc_item_value_t *values, int values_num)
 
 		item_value = &values[i];
 
-		while (SUCCEED != hc_clone_history_data(&data, item_value))
+		while (SUCCEED != hc_clone_history_data(&data, item_value, cached))
 		{
 			UNLOCK_CACHE;
 
@@ -3173,17 +3205,17 @@ static void	hc_add_item_values(dc_item_value_t *values, int values_num)
 			LOCK_CACHE;
 		}
 
-		if (NULL == (item = hc_get_item(item_value->itemid)))
+		if (SUCCEED == hc_preproc_required(item_value))
 		{
-			item = hc_add_item(item_value->itemid, data);
-			hc_queue_item(item);
-		}
-		else
-		{
-			item->head->next = data;
-			item->head = data;
+			hc_preproc_queue_value(item_value->itemid, data);
+			continue;
 		}
+
+		hc_add_item_data(item_value->itemid, data);
+		history_num++;
 	}
+
+	return history_num;
 }
 
 /******************************************************************************
@@ -3222,13 +3254,14 @@ static void	hc_copy_history_data(ZBX_DC_HISTORY *history, zbx_uint64_t itemid, z
 	{
 		switch (data->value_type)
 		{
+			/* numeric values are converted by preprocessing workers on server */
 			case ITEM_VALUE_TYPE_FLOAT:
 				history->value_orig.dbl = data->value.dbl;
-				history->value.dbl = 0;
+				history->value.dbl = data->value.dbl;
 				break;
 			case ITEM_VALUE_TYPE_UINT64:
 				history->value_orig.ui64 = data->value.ui64;
-				history->value.ui64 = 0;
+				history->value.ui64 = data->value.ui64;
 				break;
 			case ITEM_VALUE_TYPE_STR:
 			case ITEM_VALUE_TYPE_TEXT:
@@ -3285,9 +3318,11 @@ static void	hc_pop_items(zbx_vector_ptr_t *history_items)
  *                                                                            *
  * Parameters: history       - [OUT] the history valeus                       *
  *             history_items - [IN] the history items                         *
+ *             popped        - [IN] the time when items were popped from      *
+ *                                  history queue                             *
  *                                                                            *
  ******************************************************************************/
-static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items)
+static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *history_items, double popped)
 {
 	int		i, history_num = 0;
 	zbx_hc_item_t	*item;
@@ -3301,6 +3336,7 @@ static void	hc_get_item_values(ZBX_DC_HISTORY *history, zbx_vector_ptr_t *histor
 			continue;
 
 		hc_copy_history_data(&history[history_num++], item->itemid, item->tail);
+		zbx_latency_add(ZBX_LATENCY_STAGE_CACHE, popped - item->tail->cached, 1);
 	}
 }
 
@@ -3430,6 +3466,586 @@ static void	hc_free_item_values(ZBX_DC_HISTORY *history, int history_num)
 	}
 }
 
+/******************************************************************************
+ *                                                                            *
+ * history value preprocessing                                                *
+ *                                                                            *
+ ******************************************************************************/
+
+/* the maximum number of values converted in one preprocessing batch */
+#define ZBX_HC_PREPROC_MAX		1000
+
+/* how often delta history of removed items and items without delta is dropped */
+#define ZBX_HC_PREPROC_CLEANUP_PERIOD	SEC_PER_HOUR
+
+static time_t		preproc_cleanup_time = 0;
+
+static int	DBchk_double(double value)
+{
+	/* field with precision 16, scale 4 [NUMERIC(16,4)] */
+	const double	pg_min_numeric = -1e12;
+	const double	pg_max_numeric = 1e12;
+
+	if (value <= pg_min_numeric || value >= pg_max_numeric)
+		return FAIL;
+
+	return SUCCEED;
+}
+
+static double	multiply_item_value_float(const zbx_preproc_item_t *item, double value)
+{
+	double	value_double;
+
+	if (ITEM_MULTIPLIER_USE != item->multiplier)
+		return value;
+
+	value_double = value * atof(item->formula);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "multiply_item_value_float() " ZBX_FS_DBL ",%s " ZBX_FS_DBL,
+			value, item->formula, value_double);
+
+	return value_double;
+}
+
+static zbx_uint64_t	multiply_item_value_uint64(const zbx_preproc_item_t *item, zbx_uint64_t value)
+{
+	zbx_uint64_t	formula_uint64, value_uint64;
+
+	if (ITEM_MULTIPLIER_USE != item->multiplier)
+		return value;
+
+	if (SUCCEED == is_uint64(item->formula, &formula_uint64))
+		value_uint64 = value * formula_uint64;
+	else
+		value_uint64 = (zbx_uint64_t)((double)value * atof(item->formula));
+
+	zabbix_log(LOG_LEVEL_DEBUG, "multiply_item_value_uint64() " ZBX_FS_UI64 ",%s " ZBX_FS_UI64,
+			value, item->formula, value_uint64);
+
+	return value_uint64;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCcalculate_item_delta_float                                     *
+ *                                                                            *
+ * Purpose: calculate delta value for items of float value type               *
+ *                                                                            *
+ * Parameters: item      - [IN] the item properties                           *
+ *             data      - [IN/OUT] the raw value, replaced with calculated   *
+ *             deltaitem - [IN] a reference to the last raw history value     *
+ *                         (value + timestamp), NULL for items without delta  *
+ *                                                                            *
+ * Return value: SUCCEED - the value was calculated or is undefined           *
+ *               FAIL    - the calculated value does not fit in database      *
+ *                                                                            *
+ ******************************************************************************/
+static int	DCcalculate_item_delta_float(const zbx_preproc_item_t *item, zbx_hc_data_t *data,
+		const zbx_item_history_value_t *deltaitem)
+{
+	double	value_orig = data->value.dbl;
+
+	switch (item->delta)
+	{
+		case ITEM_STORE_AS_IS:
+			data->value.dbl = multiply_item_value_float(item, value_orig);
+
+			break;
+		case ITEM_STORE_SPEED_PER_SECOND:
+			if (0 != deltaitem->timestamp.sec && deltaitem->value.dbl <= value_orig &&
+					0 > zbx_timespec_compare(&deltaitem->timestamp, &data->ts))
+			{
+				data->value.dbl = (value_orig - deltaitem->value.dbl) /
+						((data->ts.sec - deltaitem->timestamp.sec) +
+							(double)(data->ts.ns - deltaitem->timestamp.ns) / 1000000000);
+				data->value.dbl = multiply_item_value_float(item, data->value.dbl);
+			}
+			else
+				data->flags |= ZBX_DC_FLAG_UNDEF;
+
+			break;
+		case ITEM_STORE_SIMPLE_CHANGE:
+			if (0 != deltaitem->timestamp.sec && deltaitem->value.dbl <= value_orig)
+			{
+				data->value.dbl = value_orig - deltaitem->value.dbl;
+				data->value.dbl = multiply_item_value_float(item, data->value.dbl);
+			}
+			else
+				data->flags |= ZBX_DC_FLAG_UNDEF;
+
+			break;
+	}
+
+	if (0 != (ZBX_DC_FLAG_UNDEF & data->flags))
+		return SUCCEED;
+
+	return DBchk_double(data->value.dbl);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCcalculate_item_delta_uint64                                    *
+ *                                                                            *
+ * Purpose: calculate delta value for items of uint64 value type              *
+ *                                                                            *
+ * Parameters: item      - [IN] the item properties                           *
+ *             data      - [IN/OUT] the raw value, replaced with calculated   *
+ *             deltaitem - [IN] a reference to the last raw history value     *
+ *                         (value + timestamp), NULL for items without delta  *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCcalculate_item_delta_uint64(const zbx_preproc_item_t *item, zbx_hc_data_t *data,
+		const zbx_item_history_value_t *deltaitem)
+{
+	zbx_uint64_t	value_orig = data->value.ui64;
+
+	switch (item->delta)
+	{
+		case ITEM_STORE_AS_IS:
+			data->value.ui64 = multiply_item_value_uint64(item, value_orig);
+
+			break;
+		case ITEM_STORE_SPEED_PER_SECOND:
+			if (0 != deltaitem->timestamp.sec && deltaitem->value.ui64 <= value_orig &&
+					0 > zbx_timespec_compare(&deltaitem->timestamp, &data->ts))
+			{
+				data->value.ui64 = (value_orig - deltaitem->value.ui64) /
+						((data->ts.sec - deltaitem->timestamp.sec) +
+							(double)(data->ts.ns - deltaitem->timestamp.ns) / 1000000000);
+				data->value.ui64 = multiply_item_value_uint64(item, data->value.ui64);
+			}
+			else
+				data->flags |= ZBX_DC_FLAG_UNDEF;
+
+			break;
+		case ITEM_STORE_SIMPLE_CHANGE:
+			if (0 != deltaitem->timestamp.sec && deltaitem->value.ui64 <= value_orig)
+			{
+				data->value.ui64 = value_orig - deltaitem->value.ui64;
+				data->value.ui64 = multiply_item_value_uint64(item, data->value.ui64);
+			}
+			else
+				data->flags |= ZBX_DC_FLAG_UNDEF;
+
+			break;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCpreprocess_value                                               *
+ *                                                                            *
+ * Purpose: applies delta and multiplier to the raw value and updates delta   *
+ *          history of the item                                               *
+ *                                                                            *
+ * Parameters: delta_history - [IN/OUT] the delta history of the queue        *
+ *             item          - [IN] the item properties, NULL if item was     *
+ *                                  removed                                   *
+ *             itemid        - [IN] the item identifier                       *
+ *             data          - [IN/OUT] the value to convert                  *
+ *             error         - [OUT] the error message in local string buffer *
+ *                                   if the converted value is not supported, *
+ *                                   zero length otherwise                    *
+ *                                                                            *
+ * Comments: The history cache must be locked.                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCpreprocess_value(zbx_hashset_t *delta_history, const zbx_preproc_item_t *item, zbx_uint64_t itemid,
+		zbx_hc_data_t *data, dc_value_str_t *error)
+{
+	zbx_item_history_value_t	*deltaitem;
+	history_value_t			value_orig;
+	char				buffer[MAX_STRING_LEN];
+
+	error->len = 0;
+
+	deltaitem = (zbx_item_history_value_t *)zbx_hashset_search(delta_history, &itemid);
+
+	/* removed items, not supported values and value type changes restart delta calculation, */
+	/* values of the wrong type are left for history syncers to discard                      */
+	if (NULL == item || ITEM_STATE_NOTSUPPORTED == data->state || item->value_type != data->value_type)
+	{
+		if (NULL != deltaitem)
+			zbx_hashset_remove_direct(delta_history, deltaitem);
+
+		return;
+	}
+
+	if (0 != (ZBX_DC_FLAG_NOVALUE & data->flags))
+		return;
+
+	if (ITEM_STORE_AS_IS == item->delta)
+	{
+		if (NULL != deltaitem)
+		{
+			zbx_hashset_remove_direct(delta_history, deltaitem);
+			deltaitem = NULL;
+		}
+	}
+	else if (NULL == deltaitem)
+	{
+		zbx_item_history_value_t	value = {itemid};
+
+		deltaitem = (zbx_item_history_value_t *)zbx_hashset_insert(delta_history, &value,
+				sizeof(value));
+	}
+
+	value_orig = data->value;
+
+	switch (item->value_type)
+	{
+		case ITEM_VALUE_TYPE_FLOAT:
+			if (SUCCEED != DCcalculate_item_delta_float(item, data, deltaitem))
+			{
+				zbx_snprintf(buffer, sizeof(buffer), "Type of received value [" ZBX_FS_DBL "] is not"
+						" suitable for value type [%s]", data->value.dbl,
+						zbx_item_value_type_string(item->value_type));
+
+				error->len = strlen(buffer) + 1;
+				dc_string_buffer_realloc(error->len);
+				error->pvalue = string_values_offset;
+				memcpy(&string_values[string_values_offset], buffer, error->len);
+				string_values_offset += error->len;
+			}
+			break;
+		case ITEM_VALUE_TYPE_UINT64:
+			DCcalculate_item_delta_uint64(item, data, deltaitem);
+			break;
+	}
+
+	/* update the last value (raw) of the delta item */
+	if (NULL != deltaitem)
+	{
+		if (0 != error->len)
+		{
+			zbx_hashset_remove_direct(delta_history, deltaitem);
+		}
+		else
+		{
+			deltaitem->timestamp = data->ts;
+			deltaitem->value = value_orig;
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCpreprocess_cleanup                                             *
+ *                                                                            *
+ * Purpose: drops delta history of removed items and items without delta      *
+ *                                                                            *
+ * Parameters: queue - [IN] the preprocessing queue                           *
+ *                                                                            *
+ ******************************************************************************/
+static void	DCpreprocess_cleanup(zbx_hc_preproc_queue_t *queue)
+{
+	const char			*__function_name = "DCpreprocess_cleanup";
+
+	zbx_hashset_iter_t		iter;
+	zbx_item_history_value_t	*deltaitem;
+	zbx_vector_uint64_t		itemids;
+	zbx_preproc_item_t		*items;
+	int				i, *errcodes;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	zbx_vector_uint64_create(&itemids);
+
+	LOCK_CACHE;
+
+	zbx_vector_uint64_reserve(&itemids, queue->delta_history.num_data);
+
+	zbx_hashset_iter_reset(&queue->delta_history, &iter);
+
+	while (NULL != (deltaitem = (zbx_item_history_value_t *)zbx_hashset_iter_next(&iter)))
+		zbx_vector_uint64_append(&itemids, deltaitem->itemid);
+
+	UNLOCK_CACHE;
+
+	if (0 == itemids.values_num)
+		goto out;
+
+	items = (zbx_preproc_item_t *)zbx_malloc(NULL, sizeof(zbx_preproc_item_t) * itemids.values_num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * itemids.values_num);
+
+	DCconfig_get_preprocessable_items(items, itemids.values, errcodes, itemids.values_num);
+
+	LOCK_CACHE;
+
+	for (i = 0; i < itemids.values_num; i++)
+	{
+		if (SUCCEED == errcodes[i] && ITEM_STORE_AS_IS != items[i].delta)
+			continue;
+
+		zbx_hashset_remove(&queue->delta_history, &itemids.values[i]);
+	}
+
+	UNLOCK_CACHE;
+
+	zbx_free(errcodes);
+	zbx_free(items);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() items:%d", __function_name, itemids.values_num);
+
+	zbx_vector_uint64_destroy(&itemids);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_preproc_set_notsupported                                      *
+ *                                                                            *
+ * Purpose: replaces the value with not supported state and error message     *
+ *                                                                            *
+ * Parameters: data  - [IN/OUT] the history data                              *
+ *             error - [IN] the error message in local string buffer          *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_preproc_set_notsupported(zbx_hc_data_t *data, const dc_value_str_t *error)
+{
+	char	*str;
+
+	while (NULL == (str = hc_mem_value_str_dup(error)))
+	{
+		UNLOCK_CACHE;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "History buffer is full. Sleeping for 1 second.");
+		sleep(1);
+
+		LOCK_CACHE;
+	}
+
+	data->state = ITEM_STATE_NOTSUPPORTED;
+	data->value.str = str;
+
+	cache->stats.notsupported_counter++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCpreprocess_history                                             *
+ *                                                                            *
+ * Purpose: applies delta and multiplier to the next batch of values from the *
+ *          preprocessing queue and moves them to history queue               *
+ *                                                                            *
+ * Parameters: queue_num  - [IN] the preprocessing queue (worker) index       *
+ *             values_num - [OUT] the number of processed values              *
+ *                                                                            *
+ * Return value: the number of values left in the queue                       *
+ *                                                                            *
+ * Comments: Only the owning worker takes values from its queue and returns   *
+ *           them in the same order, so values of an item keep their order    *
+ *           without locking items. The main process converts the values left *
+ *           in queues at shutdown with the same delta history.               *
+ *                                                                            *
+ ******************************************************************************/
+int	DCpreprocess_history(int queue_num, int *values_num)
+{
+	const char		*__function_name = "DCpreprocess_history";
+
+	zbx_hc_preproc_queue_t	*queue;
+	zbx_hc_preproc_value_t	*head, *tail = NULL, *value, *next;
+	zbx_vector_uint64_t	itemids;
+	zbx_preproc_item_t	*items;
+	dc_value_str_t		*errors;
+	int			i, j, left_num, *errcodes, *lastclocks, *requeue_errcodes, requeue_num = 0;
+	unsigned char		*states;
+	zbx_uint64_t		*requeue_itemids;
+	size_t			string_offset;
+	time_t			now;
+
+	*values_num = 0;
+
+	if (NULL == cache->preproc_queues)
+		return 0;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() queue:%d", __function_name, queue_num);
+
+	queue = &cache->preproc_queues[queue_num];
+
+	LOCK_CACHE;
+
+	head = queue->head;
+
+	for (value = head; NULL != value && ZBX_HC_PREPROC_MAX > *values_num; value = value->next)
+	{
+		tail = value;
+		(*values_num)++;
+	}
+
+	if (NULL == (queue->head = value))
+		queue->tail = NULL;
+
+	queue->values_num -= *values_num;
+	left_num = queue->values_num;
+
+	UNLOCK_CACHE;
+
+	if (0 == *values_num)
+		goto out;
+
+	/* the detached values are private to this process until they are added to history queue */
+	tail->next = NULL;
+
+	zbx_vector_uint64_create(&itemids);
+	zbx_vector_uint64_reserve(&itemids, *values_num);
+
+	for (value = head; NULL != value; value = value->next)
+		zbx_vector_uint64_append(&itemids, value->itemid);
+
+	zbx_vector_uint64_sort(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	zbx_vector_uint64_uniq(&itemids, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+	items = (zbx_preproc_item_t *)zbx_malloc(NULL, sizeof(zbx_preproc_item_t) * itemids.values_num);
+	errcodes = (int *)zbx_malloc(NULL, sizeof(int) * itemids.values_num);
+	errors = (dc_value_str_t *)zbx_malloc(NULL, sizeof(dc_value_str_t) * *values_num);
+	requeue_itemids = (zbx_uint64_t *)zbx_malloc(NULL, sizeof(zbx_uint64_t) * *values_num);
+	lastclocks = (int *)zbx_malloc(NULL, sizeof(int) * *values_num);
+
+	DCconfig_get_preprocessable_items(items, itemids.values, errcodes, itemids.values_num);
+
+	string_offset = string_values_offset;
+
+	/* delta history is shared with the main process which converts the values left at shutdown */
+	LOCK_CACHE;
+
+	for (value = head, j = 0; NULL != value; value = next, j++)
+	{
+		next = value->next;
+
+		i = zbx_vector_uint64_bsearch(&itemids, value->itemid, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+
+		DCpreprocess_value(&queue->delta_history, SUCCEED == errcodes[i] ? &items[i] : NULL, value->itemid,
+				value->data, &errors[j]);
+
+		if (0 != errors[j].len)
+		{
+			requeue_itemids[requeue_num] = value->itemid;
+			lastclocks[requeue_num++] = value->data->ts.sec;
+
+			hc_preproc_set_notsupported(value->data, &errors[j]);
+		}
+
+		hc_add_item_data(value->itemid, value->data);
+		__hc_mem_free_func(value);
+	}
+
+	cache->history_num += *values_num;
+
+	UNLOCK_CACHE;
+
+	string_values_offset = string_offset;
+
+	/* the items that failed preprocessing become not supported, reschedule them at once */
+	if (0 != requeue_num)
+	{
+		states = (unsigned char *)zbx_malloc(NULL, sizeof(unsigned char) * requeue_num);
+		requeue_errcodes = (int *)zbx_malloc(NULL, sizeof(int) * requeue_num);
+
+		memset(states, ITEM_STATE_NOTSUPPORTED, sizeof(unsigned char) * requeue_num);
+
+		for (i = 0; i < requeue_num; i++)
+			requeue_errcodes[i] = SUCCEED;
+
+		DCrequeue_items(requeue_itemids, states, lastclocks, NULL, NULL, requeue_errcodes, requeue_num);
+
+		zbx_free(requeue_errcodes);
+		zbx_free(states);
+	}
+
+	zbx_free(lastclocks);
+	zbx_free(requeue_itemids);
+	zbx_free(errors);
+	zbx_free(errcodes);
+	zbx_free(items);
+	zbx_vector_uint64_destroy(&itemids);
+out:
+	if (ZBX_HC_PREPROC_CLEANUP_PERIOD <= (now = time(NULL)) - preproc_cleanup_time)
+	{
+		DCpreprocess_cleanup(queue);
+		preproc_cleanup_time = now;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() values:%d left:%d", __function_name, *values_num, left_num);
+
+	return left_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCpreprocess_wait                                                *
+ *                                                                            *
+ * Purpose: waits until values are added to the preprocessing queue           *
+ *                                                                            *
+ * Parameters: queue_num - [IN] the preprocessing queue (worker) index        *
+ *             timeout   - [IN] the maximum time to wait in seconds           *
+ *                                                                            *
+ * Comments: The first value added to the empty queue writes a byte to the    *
+ *           wakeup pipe of the queue. A wakeup sent before the worker starts *
+ *           waiting stays in the pipe, so it is not lost.                    *
+ *                                                                            *
+ ******************************************************************************/
+void	DCpreprocess_wait(int queue_num, int timeout)
+{
+	zbx_hc_preproc_queue_t	*queue;
+	struct pollfd		pfd;
+	char			buf[16];
+
+	if (NULL == cache->preproc_queues)
+		return;
+
+	queue = &cache->preproc_queues[queue_num];
+
+	LOCK_CACHE;
+
+	if (0 != queue->values_num)
+	{
+		UNLOCK_CACHE;
+		return;
+	}
+
+	queue->waiting = 1;
+
+	UNLOCK_CACHE;
+
+	pfd.fd = queue->fd_wakeup[0];
+	pfd.events = POLLIN;
+
+	if (0 < poll(&pfd, 1, timeout * 1000))
+	{
+		while (0 < read(queue->fd_wakeup[0], buf, sizeof(buf)))
+			;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: hc_preproc_queue_init                                            *
+ *                                                                            *
+ * Purpose: creates the delta history and wakeup pipe of the preprocessing    *
+ *          queue                                                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	hc_preproc_queue_init(zbx_hc_preproc_queue_t *queue)
+{
+	int	i;
+
+	zbx_hashset_create_ext(&queue->delta_history, ZBX_HC_ITEMS_INIT_SIZE,
+			ZBX_DEFAULT_UINT64_HASH_FUNC, ZBX_DEFAULT_UINT64_COMPARE_FUNC, NULL,
+			__hc_index_mem_malloc_func, __hc_index_mem_realloc_func, __hc_index_mem_free_func);
+
+	if (-1 == pipe(queue->fd_wakeup))
+	{
+		zbx_error("cannot create wakeup pipe for preprocessing worker: %s", zbx_strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < 2; i++)
+	{
+		fcntl(queue->fd_wakeup[i], F_SETFD, FD_CLOEXEC);
+		fcntl(queue->fd_wakeup[i], F_SETFL, O_NONBLOCK | fcntl(queue->fd_wakeup[i], F_GETFL));
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: init_trend_cache                                                 *
@@ -3485,6 +4101,76 @@ static void	init_trend_cache(void)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: DCget_memory_usage                                               *
+ *                                                                            *
+ * Purpose: get memory used by history and trend cache structures             *
+ *                                                                            *
+ * Parameters: usage - [OUT] the memory usage vector                          *
+ *                                                                            *
+ * Comments: The memory used by string, text and log values is reported as    *
+ *           "strings".                                                       *
+ *                                                                            *
+ ******************************************************************************/
+void	DCget_memory_usage(zbx_vector_ptr_t *usage)
+{
+	zbx_uint64_t	values_size, hc_size;
+
+	LOCK_CACHE;
+
+	zbx_mem_usage_add(usage, "items", cache->history_items.num_data,
+			zbx_mem_hashset_size(hc_index_mem, &cache->history_items, sizeof(zbx_hc_item_t)));
+	zbx_mem_usage_add(usage, "queue", cache->history_queue.elems_num,
+			zbx_mem_binary_heap_size(hc_index_mem, &cache->history_queue));
+
+	values_size = cache->history_num * zbx_mem_chunk_size(hc_mem, sizeof(zbx_hc_data_t));
+	hc_size = zbx_mem_used_size(hc_mem);
+
+	zbx_mem_usage_add(usage, "values", cache->history_num, values_size);
+	zbx_mem_usage_add(usage, "strings", cache->history_strpool.num_data,
+			(hc_size > values_size ? hc_size - values_size : 0));
+	zbx_mem_usage_add_other(usage, hc_size + zbx_mem_used_size(hc_index_mem));
+
+	UNLOCK_CACHE;
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+	{
+		LOCK_TRENDS;
+
+		zbx_mem_usage_add(usage, "trends", cache->trends.num_data,
+				zbx_mem_hashset_size(trend_mem, &cache->trends, sizeof(ZBX_DC_TREND)));
+
+		UNLOCK_TRENDS;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DClog_memory_stats                                               *
+ *                                                                            *
+ * Purpose: write history and trend cache allocator statistics to log        *
+ *                                                                            *
+ ******************************************************************************/
+void	DClog_memory_stats(void)
+{
+	LOCK_CACHE;
+
+	zbx_mem_log_stats(hc_mem);
+	zbx_mem_log_stats(hc_index_mem);
+
+	UNLOCK_CACHE;
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+	{
+		LOCK_TRENDS;
+
+		zbx_mem_log_stats(trend_mem);
+
+		UNLOCK_TRENDS;
+	}
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: init_database_cache                                              *
@@ -3498,6 +4184,7 @@ void	init_database_cache(void)
 {
 	const char	*__function_name = "init_database_cache";
 	key_t		hc_shm_key, hc_index_shm_key;
+	int		i;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
@@ -3523,10 +4210,12 @@ void	init_database_cache(void)
 	/* history cache */
 	zbx_mem_create(&hc_mem, hc_shm_key, ZBX_NO_MUTEX, CONFIG_HISTORY_CACHE_SIZE, "history cache",
 			"HistoryCacheSize", 1);
+	zbx_mem_enable_slabs(hc_mem);
 
 	/* history index cache */
 	zbx_mem_create(&hc_index_mem, hc_index_shm_key, ZBX_NO_MUTEX, CONFIG_HISTORY_INDEX_CACHE_SIZE,
 			"history index cache", "HistoryIndexCacheSize", 0);
+	zbx_mem_enable_slabs(hc_index_mem);
 
 	cache = (ZBX_DC_CACHE *)__hc_index_mem_malloc_func(NULL, sizeof(ZBX_DC_CACHE));
 	memset(cache, 0, sizeof(ZBX_DC_CACHE));
@@ -3541,6 +4230,22 @@ void	init_database_cache(void)
 	zbx_binary_heap_create_ext(&cache->history_queue, hc_queue_elem_compare_func, ZBX_BINARY_HEAP_OPTION_EMPTY,
 			__hc_index_mem_malloc_func, __hc_index_mem_realloc_func, __hc_index_mem_free_func);
 
+	zbx_hashset_create_ext(&cache->history_strpool, ZBX_HC_ITEMS_INIT_SIZE,
+			hc_strpool_hash_func, hc_strpool_compare_func, NULL,
+			__hc_mem_malloc_func, __hc_mem_realloc_func, __hc_mem_free_func);
+
+	/* preprocessing queues, one per worker */
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && 0 != CONFIG_PREPROCESSOR_FORKS)
+	{
+		cache->preproc_queues_num = CONFIG_PREPROCESSOR_FORKS;
+		cache->preproc_queues = (zbx_hc_preproc_queue_t *)__hc_index_mem_malloc_func(NULL,
+				sizeof(zbx_hc_preproc_queue_t) * CONFIG_PREPROCESSOR_FORKS);
+		memset(cache->preproc_queues, 0, sizeof(zbx_hc_preproc_queue_t) * CONFIG_PREPROCESSOR_FORKS);
+
+		for (i = 0; i < CONFIG_PREPROCESSOR_FORKS; i++)
+			hc_preproc_queue_init(&cache->preproc_queues[i]);
+	}
+
 	/* trend cache */
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 		init_trend_cache();
@@ -3562,10 +4267,17 @@ void	init_database_cache(void)
  ******************************************************************************/
 static void	DCsync_all(void)
 {
-	int	sync_num;
+	int	sync_num, values_num, i;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In DCsync_all()");
 
+	/* preprocessing workers have exited, convert the values left in their queues */
+	for (i = 0; i < cache->preproc_queues_num; i++)
+	{
+		while (0 != DCpreprocess_history(i, &values_num))
+			;
+	}
+
 	DCsync_history(ZBX_SYNC_FULL, &sync_num);
 	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
 		DCsync_trends();
@@ -36,9 +36,11 @@
 
 static int	sync_in_progress = 0;
 
-#define	LOCK_CACHE	if (0 == sync_in_progress) zbx_mutex_lock(&config_lock)
-#define	UNLOCK_CACHE	if (0 == sync_in_progress) zbx_mutex_unlock(&config_lock)
-#define START_SYNC	LOCK_CACHE; sync_in_progress = 1
+/* read only accessors take shared lock, cache modifications require exclusive lock */
+#define	RDLOCK_CACHE	if (0 == sync_in_progress) zbx_rwlock_rdlock(&config_lock)
+#define	WRLOCK_CACHE	if (0 == sync_in_progress) zbx_rwlock_wrlock(&config_lock)
+#define	UNLOCK_CACHE	if (0 == sync_in_progress) zbx_rwlock_unlock(&config_lock)
+#define START_SYNC	WRLOCK_CACHE; sync_in_progress = 1
 #define FINISH_SYNC	sync_in_progress = 0; UNLOCK_CACHE
 
 #define ZBX_LOC_NOWHERE	0
@@ -123,35 +125,41 @@ typedef struct
 }
 ZBX_DC_FUNCTION;
 
+/* The fields used by poller queue operations (item scheduling, requeueing and queue ordering) are grouped */
+/* at the beginning of the structure so they share the same cache lines. Keep the rest of the fields, which */
+/* are used only during configuration sync or when item data is copied, after them.                         */
 typedef struct
 {
+	/* scheduling fields */
 	zbx_uint64_t	itemid;
 	zbx_uint64_t	hostid;
 	zbx_uint64_t	interfaceid;
-	zbx_uint64_t	lastlogsize;
-	zbx_uint64_t	valuemapid;
 	const char	*key;
-	const char	*port;
-	const char	*units;
-	const char	*db_error;
-	ZBX_DC_TRIGGER	**triggers;
-	int		delay;
 	int		nextcheck;
+	int		delay;
 	int		lastclock;
-	int		mtime;
-	int		data_expected_from;
-	int		history;
 	unsigned char	type;
-	unsigned char	data_type;
-	unsigned char	value_type;
 	unsigned char	poller_type;
-	unsigned char	state;
-	unsigned char	db_state;
-	unsigned char	inventory_link;
 	unsigned char	location;
-	unsigned char	flags;
+	unsigned char	state;
 	unsigned char	status;
+	unsigned char	flags;
 	unsigned char	unreachable;
+
+	/* configuration fields */
+	unsigned char	data_type;
+	unsigned char	value_type;
+	unsigned char	db_state;
+	unsigned char	inventory_link;
+	int		data_expected_from;
+	int		mtime;
+	int		history;
+	zbx_uint64_t	lastlogsize;
+	zbx_uint64_t	valuemapid;
+	const char	*port;
+	const char	*units;
+	const char	*db_error;
+	ZBX_DC_TRIGGER	**triggers;
 }
 ZBX_DC_ITEM;
 
@@ -271,8 +279,6 @@ typedef struct
 }
 ZBX_DC_CALCITEM;
 
-typedef zbx_item_history_value_t	ZBX_DC_DELTAITEM;
-
 #if defined(HAVE_POLARSSL) || defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
 typedef struct
 {
@@ -602,7 +608,6 @@ typedef struct
 	zbx_hashset_t		simpleitems;
 	zbx_hashset_t		jmxitems;
 	zbx_hashset_t		calcitems;
-	zbx_hashset_t		deltaitems;		/* history data for delta value calculations */
 	zbx_hashset_t		functions;
 	zbx_hashset_t		triggers;
 	zbx_hashset_t		trigdeps;
@@ -644,7 +649,7 @@ typedef struct
 ZBX_DC_CONFIG;
 
 static ZBX_DC_CONFIG	*config = NULL;
-static ZBX_MUTEX	config_lock = ZBX_MUTEX_NULL;
+static ZBX_RWLOCK	config_lock = ZBX_RWLOCK_NULL;
 static zbx_mem_info_t	*config_mem;
 
 extern unsigned char	program_type;
@@ -653,7 +658,8 @@ extern int		CONFIG_TIMER_FORKS;
 ZBX_MEM_FUNC_IMPL(__config, config_mem)
 
 static void	dc_get_hostids_by_functionids(zbx_vector_uint64_t *functionids, zbx_vector_uint64_t *hostids);
-static char	*dc_cache_expanded_expression(const char *expression, const char **expression_ex, char **error);
+static char	*dc_get_expanded_expression(const char *expression, const char *expression_ex, char **error);
+static void	dc_trigger_cache_expanded_expressions(ZBX_DC_TRIGGER *dc_trigger, const DC_TRIGGER *trigger);
 
 /******************************************************************************
  *                                                                            *
@@ -2445,7 +2451,6 @@ static void	DCsync_items(DB_RESULT result, int refresh_unsupported_changed)
 	ZBX_DC_CALCITEM		*calcitem;
 	ZBX_DC_INTERFACE_ITEM	*interface_snmpitem;
 	ZBX_DC_ITEM_HK		*item_hk, item_hk_local;
-	ZBX_DC_DELTAITEM	*deltaitem;
 
 	time_t			now;
 	unsigned char		old_poller_type, status, type;
@@ -3091,11 +3096,6 @@ static void	DCsync_items(DB_RESULT result, int refresh_unsupported_changed)
 			zbx_hashset_remove_direct(&config->calcitems, calcitem);
 		}
 
-		/* delta items */
-
-		if (NULL != (deltaitem = zbx_hashset_search(&config->deltaitems, &itemid)))
-			zbx_hashset_remove_direct(&config->deltaitems, deltaitem);
-
 		/* items */
 
 		item_hk_local.hostid = item->hostid;
@@ -4343,6 +4343,483 @@ static void	DCsync_trigger_tags(DB_RESULT result)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
+/* configuration cache snapshot file format:                                  */
+/*   header  - magic, int size, byte order tag, format version, Zabbix        */
+/*             version, database version, time                                */
+/*   results - SQL statement, fields number and rows of each configuration    */
+/*             sync select statement in the order they are executed           */
+/* The integers are written in the native byte order, the int size and byte   */
+/* order tag make sure the snapshot is loaded on the same architecture only.  */
+#define ZBX_DC_SNAPSHOT_MAGIC		"ZBXCSNAP"
+#define ZBX_DC_SNAPSHOT_MAGIC_LEN	(sizeof(ZBX_DC_SNAPSHOT_MAGIC) - 1)
+#define ZBX_DC_SNAPSHOT_BYTE_ORDER	0x01020304
+#define ZBX_DC_SNAPSHOT_VERSION		2
+
+#define ZBX_DC_SNAPSHOT_NONE		0
+#define ZBX_DC_SNAPSHOT_LOAD		1
+
+#define ZBX_DC_SNAPSHOT_ROW		1
+#define ZBX_DC_SNAPSHOT_END		0
+
+#define ZBX_DC_SNAPSHOT_MAX_FIELDS	1000
+
+/* configuration sync select statements, in the order they are executed */
+#define ZBX_DC_SYNC_CONFIG		0
+#define ZBX_DC_SYNC_HOSTS		1
+#define ZBX_DC_SYNC_HOST_INVENTORY	2
+#define ZBX_DC_SYNC_HTMPLS		3
+#define ZBX_DC_SYNC_GMACROS		4
+#define ZBX_DC_SYNC_HMACROS		5
+#define ZBX_DC_SYNC_INTERFACES		6
+#define ZBX_DC_SYNC_ITEMS		7
+#define ZBX_DC_SYNC_TRIGGERS		8
+#define ZBX_DC_SYNC_TRIGDEPS		9
+#define ZBX_DC_SYNC_FUNCTIONS		10
+#define ZBX_DC_SYNC_EXPRESSIONS		11
+#define ZBX_DC_SYNC_ACTIONS		12
+#define ZBX_DC_SYNC_ACTION_CONDITIONS	13
+#define ZBX_DC_SYNC_TRIGGER_TAGS	14
+#define ZBX_DC_SYNC_CORRELATIONS	15
+#define ZBX_DC_SYNC_CORR_CONDITIONS	16
+#define ZBX_DC_SYNC_CORR_OPERATIONS	17
+#define ZBX_DC_SYNC_HOSTGROUPS		18
+
+static unsigned char	snapshot_mode = ZBX_DC_SNAPSHOT_NONE;
+static FILE		*snapshot_file = NULL;
+static int		snapshot_error = 0;
+static int		snapshot_loaded = 0;
+static int		snapshot_fields_num, snapshot_field;
+static int		snapshot_db_mandatory = -1, snapshot_db_optional = -1;
+
+static void	dc_snapshot_write(const void *data, size_t size)
+{
+	if (0 == snapshot_error && 1 != fwrite(data, size, 1, snapshot_file))
+		snapshot_error = 1;
+}
+
+static void	dc_snapshot_write_int(int value)
+{
+	dc_snapshot_write(&value, sizeof(value));
+}
+
+static void	dc_snapshot_write_str(const char *str)
+{
+	int	len = (NULL == str ? -1 : (int)strlen(str));
+
+	dc_snapshot_write_int(len);
+
+	if (0 < len)
+		dc_snapshot_write(str, len);
+}
+
+static int	dc_snapshot_read(void *data, size_t size)
+{
+	if (0 == snapshot_error && 1 != fread(data, size, 1, snapshot_file))
+		snapshot_error = 1;
+
+	return (0 == snapshot_error ? SUCCEED : FAIL);
+}
+
+static int	dc_snapshot_read_int(int *value)
+{
+	return dc_snapshot_read(value, sizeof(*value));
+}
+
+static int	dc_snapshot_read_str(char **str)
+{
+	int	len;
+
+	if (SUCCEED != dc_snapshot_read_int(&len))
+		return FAIL;
+
+	if (-1 == len)
+	{
+		*str = NULL;
+		return SUCCEED;
+	}
+
+	if (0 > len || ZBX_MAX_RECV_DATA_SIZE < len)
+	{
+		snapshot_error = 1;
+		return FAIL;
+	}
+
+	*str = zbx_malloc(NULL, len + 1);
+	(*str)[len] = '\0';
+
+	if (0 != len && SUCCEED != dc_snapshot_read(*str, len))
+	{
+		zbx_free(*str);
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
+static char	*DCsync_sql(int select);
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_result                                         *
+ *                                                                            *
+ * Purpose: start writing select statement result to configuration cache      *
+ *          snapshot                                                          *
+ *                                                                            *
+ * Parameters: select     - [IN] the select statement (ZBX_DC_SYNC_* defines) *
+ *             fields_num - [IN] the number of fields in result rows          *
+ *                                                                            *
+ * Comments: The rows are written with dc_snapshot_write_row() followed by    *
+ *           dc_snapshot_write_field*() calls for each field and the result   *
+ *           is finished with dc_snapshot_write_result_end().                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_result(int select, int fields_num)
+{
+	char	*sql;
+
+	sql = DCsync_sql(select);
+	dc_snapshot_write_str(sql);
+	dc_snapshot_write_int(fields_num);
+	zbx_free(sql);
+
+	snapshot_fields_num = fields_num;
+	snapshot_field = fields_num;
+}
+
+static void	dc_snapshot_check_row(void)
+{
+	if (snapshot_field != snapshot_fields_num)
+	{
+		THIS_SHOULD_NEVER_HAPPEN;
+		snapshot_error = 1;
+	}
+}
+
+static void	dc_snapshot_write_row(void)
+{
+	dc_snapshot_check_row();
+	dc_snapshot_write_int(ZBX_DC_SNAPSHOT_ROW);
+	snapshot_field = 0;
+}
+
+static void	dc_snapshot_write_result_end(void)
+{
+	dc_snapshot_check_row();
+	dc_snapshot_write_int(ZBX_DC_SNAPSHOT_END);
+}
+
+static void	dc_snapshot_write_field(const char *value)
+{
+	dc_snapshot_write_str(value);
+	snapshot_field++;
+}
+
+static void	dc_snapshot_write_field_int(int value)
+{
+	char	buffer[MAX_ID_LEN + 1];
+
+	zbx_snprintf(buffer, sizeof(buffer), "%d", value);
+	dc_snapshot_write_field(buffer);
+}
+
+static void	dc_snapshot_write_field_uint64(zbx_uint64_t value)
+{
+	char	buffer[MAX_ID_LEN + 1];
+
+	zbx_snprintf(buffer, sizeof(buffer), ZBX_FS_UI64, value);
+	dc_snapshot_write_field(buffer);
+}
+
+/* writes NULL for zero identifier, as stored in database for optional references */
+static void	dc_snapshot_write_field_id(zbx_uint64_t id)
+{
+	if (0 == id)
+		dc_snapshot_write_field(NULL);
+	else
+		dc_snapshot_write_field_uint64(id);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_load_result                                          *
+ *                                                                            *
+ * Purpose: read select statement result from configuration cache snapshot    *
+ *                                                                            *
+ * Parameters: sql - [IN] the select statement                                *
+ *                                                                            *
+ * Return value: in-memory result or NULL if the snapshot does not contain    *
+ *               the expected statement result or is corrupted                *
+ *                                                                            *
+ ******************************************************************************/
+static DB_RESULT	dc_snapshot_load_result(const char *sql)
+{
+	DB_RESULT	result = NULL;
+	char		*snapshot_sql = NULL, **row = NULL;
+	int		i, fields_num, marker;
+
+	if (SUCCEED != dc_snapshot_read_str(&snapshot_sql) || SUCCEED != dc_snapshot_read_int(&fields_num))
+		goto out;
+
+	if (NULL == snapshot_sql || 0 != strcmp(sql, snapshot_sql))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "configuration cache snapshot does not match current database queries");
+		snapshot_error = 1;
+		goto out;
+	}
+
+	if (0 > fields_num || ZBX_DC_SNAPSHOT_MAX_FIELDS < fields_num)
+	{
+		snapshot_error = 1;
+		goto out;
+	}
+
+	result = zbx_db_mem_result_create(fields_num);
+	row = zbx_calloc(NULL, fields_num + 1, sizeof(char *));
+
+	while (SUCCEED == dc_snapshot_read_int(&marker) && ZBX_DC_SNAPSHOT_ROW == marker)
+	{
+		for (i = 0; i < fields_num; i++)
+		{
+			if (SUCCEED != dc_snapshot_read_str(&row[i]))
+				break;
+		}
+
+		if (i == fields_num)
+			zbx_db_mem_result_add_row(result, row);
+
+		while (0 < i--)
+			zbx_free(row[i]);
+
+		if (0 != snapshot_error)
+			break;
+	}
+
+	if (0 != snapshot_error || ZBX_DC_SNAPSHOT_END != marker)
+	{
+		snapshot_error = 1;
+		DBfree_result(result);
+		result = NULL;
+	}
+
+	zbx_free(row);
+out:
+	zbx_free(snapshot_sql);
+
+	return result;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCsync_sql                                                       *
+ *                                                                            *
+ * Purpose: get configuration sync select statement                           *
+ *                                                                            *
+ * Parameters: select - [IN] the select statement (ZBX_DC_SYNC_* defines)     *
+ *                                                                            *
+ * Return value: the select statement, must be freed by caller                *
+ *                                                                            *
+ ******************************************************************************/
+static char	*DCsync_sql(int select)
+{
+	switch (select)
+	{
+		case ZBX_DC_SYNC_CONFIG:
+			return zbx_strdup(NULL,
+					"select refresh_unsupported,discovery_groupid,snmptrap_logging,"
+						"severity_name_0,severity_name_1,severity_name_2,"
+						"severity_name_3,severity_name_4,severity_name_5,"
+						"hk_events_mode,hk_events_trigger,hk_events_internal,"
+						"hk_events_discovery,hk_events_autoreg,hk_services_mode,"
+						"hk_services,hk_audit_mode,hk_audit,hk_sessions_mode,hk_sessions,"
+						"hk_history_mode,hk_history_global,hk_history,hk_trends_mode,"
+						"hk_trends_global,hk_trends,default_inventory_mode"
+					" from config");
+#if defined(HAVE_POLARSSL) || defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+		case ZBX_DC_SYNC_HOSTS:
+			return zbx_dsprintf(NULL,
+					"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
+						"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
+						"errors_from,available,disable_until,snmp_errors_from,"
+						"snmp_available,snmp_disable_until,ipmi_errors_from,ipmi_available,"
+						"ipmi_disable_until,jmx_errors_from,jmx_available,jmx_disable_until,"
+						"status,name,lastaccess,error,snmp_error,ipmi_error,jmx_error,tls_connect,tls_accept"
+						",tls_issuer,tls_subject,tls_psk_identity,tls_psk"
+					" from hosts"
+					" where status in (%d,%d,%d,%d)"
+						" and flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+#else
+		case ZBX_DC_SYNC_HOSTS:
+			return zbx_dsprintf(NULL,
+					"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
+						"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
+						"errors_from,available,disable_until,snmp_errors_from,"
+						"snmp_available,snmp_disable_until,ipmi_errors_from,ipmi_available,"
+						"ipmi_disable_until,jmx_errors_from,jmx_available,jmx_disable_until,"
+						"status,name,lastaccess,error,snmp_error,ipmi_error,jmx_error,tls_connect,tls_accept"
+					" from hosts"
+					" where status in (%d,%d,%d,%d)"
+						" and flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+#endif
+		case ZBX_DC_SYNC_HOST_INVENTORY:
+			return zbx_strdup(NULL,
+					"select hostid,inventory_mode"
+					" from host_inventory");
+		case ZBX_DC_SYNC_HTMPLS:
+			return zbx_strdup(NULL,
+					"select hostid,templateid"
+					" from hosts_templates"
+					" order by hostid,templateid");
+		case ZBX_DC_SYNC_GMACROS:
+			return zbx_strdup(NULL,
+					"select globalmacroid,macro,value"
+					" from globalmacro");
+		case ZBX_DC_SYNC_HMACROS:
+			return zbx_strdup(NULL,
+					"select hostmacroid,hostid,macro,value"
+					" from hostmacro");
+		case ZBX_DC_SYNC_INTERFACES:
+			return zbx_strdup(NULL,
+					"select interfaceid,hostid,type,main,useip,ip,dns,port,bulk"
+					" from interface");
+		case ZBX_DC_SYNC_ITEMS:
+			return zbx_dsprintf(NULL,
+					"select i.itemid,i.hostid,i.status,i.type,i.data_type,i.value_type,i.key_,"
+						"i.snmp_community,i.snmp_oid,i.port,i.snmpv3_securityname,i.snmpv3_securitylevel,"
+						"i.snmpv3_authpassphrase,i.snmpv3_privpassphrase,i.ipmi_sensor,i.delay,i.delay_flex,"
+						"i.trapper_hosts,i.logtimefmt,i.params,i.state,i.authtype,i.username,i.password,"
+						"i.publickey,i.privatekey,i.flags,i.interfaceid,i.snmpv3_authprotocol,"
+						"i.snmpv3_privprotocol,i.snmpv3_contextname,i.lastlogsize,i.mtime,i.delta,i.multiplier,"
+						"i.formula,i.history,i.trends,i.inventory_link,i.valuemapid,i.units,i.error"
+					" from items i,hosts h"
+					" where i.hostid=h.hostid"
+						" and h.status in (%d,%d)"
+						" and i.flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+		case ZBX_DC_SYNC_TRIGGERS:
+			return zbx_dsprintf(NULL,
+					"select distinct t.triggerid,t.description,t.expression,t.error,t.priority,t.type,t.value,"
+						"t.state,t.lastchange,t.status,t.recovery_mode,t.recovery_expression,"
+						"t.correlation_mode,t.correlation_tag"
+					" from hosts h,items i,functions f,triggers t"
+					" where h.hostid=i.hostid"
+						" and i.itemid=f.itemid"
+						" and f.triggerid=t.triggerid"
+						" and h.status in (%d,%d)"
+						" and t.flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+		case ZBX_DC_SYNC_TRIGDEPS:
+			return zbx_strdup(NULL,
+					"select d.triggerid_down,d.triggerid_up"
+					" from trigger_depends d"
+					" order by d.triggerid_down");
+		case ZBX_DC_SYNC_FUNCTIONS:
+			return zbx_dsprintf(NULL,
+					"select i.itemid,f.functionid,f.function,f.parameter,t.triggerid"
+					" from hosts h,items i,functions f,triggers t"
+					" where h.hostid=i.hostid"
+						" and i.itemid=f.itemid"
+						" and f.triggerid=t.triggerid"
+						" and h.status in (%d,%d)"
+						" and t.flags<>%d",
+					HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
+					ZBX_FLAG_DISCOVERY_PROTOTYPE);
+		case ZBX_DC_SYNC_EXPRESSIONS:
+			return zbx_strdup(NULL,
+					"select r.name,e.expressionid,e.expression,e.expression_type,e.exp_delimiter,e.case_sensitive"
+					" from regexps r,expressions e"
+					" where r.regexpid=e.regexpid");
+		case ZBX_DC_SYNC_ACTIONS:
+			return zbx_dsprintf(NULL,
+					"select actionid,eventsource,evaltype,formula"
+					" from actions"
+					" where status=%d",
+					ACTION_STATUS_ACTIVE);
+		case ZBX_DC_SYNC_ACTION_CONDITIONS:
+			return zbx_dsprintf(NULL,
+					"select c.conditionid,c.actionid,c.conditiontype,c.operator,c.value,c.value2"
+					" from conditions c,actions a"
+					" where c.actionid=a.actionid"
+						" and a.status=%d",
+					ACTION_STATUS_ACTIVE);
+		case ZBX_DC_SYNC_TRIGGER_TAGS:
+			return zbx_strdup(NULL,
+					"select triggertagid,triggerid,tag,value"
+					" from trigger_tag");
+		case ZBX_DC_SYNC_CORRELATIONS:
+			return zbx_dsprintf(NULL,
+					"select correlationid,name,evaltype,formula"
+					" from correlation"
+					" where status=%d",
+					ZBX_CORRELATION_ENABLED);
+		case ZBX_DC_SYNC_CORR_CONDITIONS:
+			return zbx_dsprintf(NULL,
+					"select cc.corr_conditionid,cc.correlationid,cc.type,cct.tag,cctv.tag,cctv.value,cctv.operator,"
+						" ccg.groupid,ccg.operator,cctp.oldtag,cctp.newtag"
+					" from correlation c,corr_condition cc"
+					" left join corr_condition_tag cct"
+						" on cct.corr_conditionid=cc.corr_conditionid"
+					" left join corr_condition_tagvalue cctv"
+						" on cctv.corr_conditionid=cc.corr_conditionid"
+					" left join corr_condition_group ccg"
+						" on ccg.corr_conditionid=cc.corr_conditionid"
+					" left join corr_condition_tagpair cctp"
+						" on cctp.corr_conditionid=cc.corr_conditionid"
+					" where c.correlationid=cc.correlationid"
+						" and c.status=%d",
+					ZBX_CORRELATION_ENABLED);
+		case ZBX_DC_SYNC_CORR_OPERATIONS:
+			return zbx_dsprintf(NULL,
+					"select co.corr_operationid,co.correlationid,co.type"
+					" from correlation c,corr_operation co"
+					" where c.correlationid=co.correlationid"
+						" and c.status=%d",
+					ZBX_CORRELATION_ENABLED);
+		case ZBX_DC_SYNC_HOSTGROUPS:
+			return zbx_strdup(NULL,
+					"select groupid,name from groups");
+	}
+
+	THIS_SHOULD_NEVER_HAPPEN;
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCsync_select                                                    *
+ *                                                                            *
+ * Purpose: execute configuration sync select statement                       *
+ *                                                                            *
+ * Parameters: select - [IN] the select statement (ZBX_DC_SYNC_* defines)     *
+ *                                                                            *
+ * Comments: When configuration cache snapshot is being loaded the result is  *
+ *           taken from the snapshot instead of the database.                 *
+ *                                                                            *
+ ******************************************************************************/
+static DB_RESULT	DCsync_select(int select)
+{
+	char		*sql;
+	DB_RESULT	result;
+
+	sql = DCsync_sql(select);
+
+	if (ZBX_DC_SNAPSHOT_LOAD == snapshot_mode)
+		result = dc_snapshot_load_result(sql);
+	else
+		result = DBselect("%s", sql);
+
+	zbx_free(sql);
+
+	return result;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: DCsync_config_select                                             *
@@ -4353,16 +4830,7 @@ static void	DCsync_trigger_tags(DB_RESULT result)
  ******************************************************************************/
 static DB_RESULT	DCsync_config_select(void)
 {
-	return DBselect(
-			"select refresh_unsupported,discovery_groupid,snmptrap_logging,"
-				"severity_name_0,severity_name_1,severity_name_2,"
-				"severity_name_3,severity_name_4,severity_name_5,"
-				"hk_events_mode,hk_events_trigger,hk_events_internal,"
-				"hk_events_discovery,hk_events_autoreg,hk_services_mode,"
-				"hk_services,hk_audit_mode,hk_audit,hk_sessions_mode,hk_sessions,"
-				"hk_history_mode,hk_history_global,hk_history,hk_trends_mode,"
-				"hk_trends_global,hk_trends,default_inventory_mode"
-			" from config");
+	return DCsync_select(ZBX_DC_SYNC_CONFIG);
 }
 
 /******************************************************************************
@@ -4407,6 +4875,7 @@ void	DCsync_configuration(void)
 				hgroups_sec, hgroups_sec2,
 				total, total2;
 	const zbx_strpool_t	*strpool;
+	int			strings_num, strings_slots;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
@@ -4416,239 +4885,92 @@ void	DCsync_configuration(void)
 	csec = zbx_time() - sec;
 
 	sec = zbx_time();
-#if defined(HAVE_POLARSSL) || defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
-	if (NULL == (host_result = DBselect(
-			"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
-				"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
-				"errors_from,available,disable_until,snmp_errors_from,"
-				"snmp_available,snmp_disable_until,ipmi_errors_from,ipmi_available,"
-				"ipmi_disable_until,jmx_errors_from,jmx_available,jmx_disable_until,"
-				"status,name,lastaccess,error,snmp_error,ipmi_error,jmx_error,tls_connect,tls_accept"
-				",tls_issuer,tls_subject,tls_psk_identity,tls_psk"
-			" from hosts"
-			" where status in (%d,%d,%d,%d)"
-				" and flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
-#else
-	if (NULL == (host_result = DBselect(
-			"select hostid,proxy_hostid,host,ipmi_authtype,ipmi_privilege,ipmi_username,"
-				"ipmi_password,maintenance_status,maintenance_type,maintenance_from,"
-				"errors_from,available,disable_until,snmp_errors_from,"
-				"snmp_available,snmp_disable_until,ipmi_errors_from,ipmi_available,"
-				"ipmi_disable_until,jmx_errors_from,jmx_available,jmx_disable_until,"
-				"status,name,lastaccess,error,snmp_error,ipmi_error,jmx_error,tls_connect,tls_accept"
-			" from hosts"
-			" where status in (%d,%d,%d,%d)"
-				" and flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			HOST_STATUS_PROXY_ACTIVE, HOST_STATUS_PROXY_PASSIVE,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
-#endif
-	{
+	if (NULL == (host_result = DCsync_select(ZBX_DC_SYNC_HOSTS)))
 		goto out;
-	}
 	hsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (hi_result = DBselect(
-			"select hostid,inventory_mode"
-			" from host_inventory")))
-	{
+	if (NULL == (hi_result = DCsync_select(ZBX_DC_SYNC_HOST_INVENTORY)))
 		goto out;
-	}
 	hisec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (htmpl_result = DBselect(
-			"select hostid,templateid"
-			" from hosts_templates"
-			" order by hostid,templateid")))
-	{
+	if (NULL == (htmpl_result = DCsync_select(ZBX_DC_SYNC_HTMPLS)))
 		goto out;
-	}
 	htsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (gmacro_result = DBselect(
-			"select globalmacroid,macro,value"
-			" from globalmacro")))
-	{
+	if (NULL == (gmacro_result = DCsync_select(ZBX_DC_SYNC_GMACROS)))
 		goto out;
-	}
 	gmsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (hmacro_result = DBselect(
-			"select hostmacroid,hostid,macro,value"
-			" from hostmacro")))
-	{
+	if (NULL == (hmacro_result = DCsync_select(ZBX_DC_SYNC_HMACROS)))
 		goto out;
-	}
 	hmsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (if_result = DBselect(
-			"select interfaceid,hostid,type,main,useip,ip,dns,port,bulk"
-			" from interface")))
-	{
+	if (NULL == (if_result = DCsync_select(ZBX_DC_SYNC_INTERFACES)))
 		goto out;
-	}
 	ifsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (item_result = DBselect(
-			"select i.itemid,i.hostid,i.status,i.type,i.data_type,i.value_type,i.key_,"
-				"i.snmp_community,i.snmp_oid,i.port,i.snmpv3_securityname,i.snmpv3_securitylevel,"
-				"i.snmpv3_authpassphrase,i.snmpv3_privpassphrase,i.ipmi_sensor,i.delay,i.delay_flex,"
-				"i.trapper_hosts,i.logtimefmt,i.params,i.state,i.authtype,i.username,i.password,"
-				"i.publickey,i.privatekey,i.flags,i.interfaceid,i.snmpv3_authprotocol,"
-				"i.snmpv3_privprotocol,i.snmpv3_contextname,i.lastlogsize,i.mtime,i.delta,i.multiplier,"
-				"i.formula,i.history,i.trends,i.inventory_link,i.valuemapid,i.units,i.error"
-			" from items i,hosts h"
-			" where i.hostid=h.hostid"
-				" and h.status in (%d,%d)"
-				" and i.flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
-	{
+	if (NULL == (item_result = DCsync_select(ZBX_DC_SYNC_ITEMS)))
 		goto out;
-	}
 	isec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (trig_result = DBselect(
-			"select distinct t.triggerid,t.description,t.expression,t.error,t.priority,t.type,t.value,"
-				"t.state,t.lastchange,t.status,t.recovery_mode,t.recovery_expression,"
-				"t.correlation_mode,t.correlation_tag"
-			" from hosts h,items i,functions f,triggers t"
-			" where h.hostid=i.hostid"
-				" and i.itemid=f.itemid"
-				" and f.triggerid=t.triggerid"
-				" and h.status in (%d,%d)"
-				" and t.flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
-	{
+	if (NULL == (trig_result = DCsync_select(ZBX_DC_SYNC_TRIGGERS)))
 		goto out;
-	}
 	tsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (tdep_result = DBselect(
-			"select d.triggerid_down,d.triggerid_up"
-			" from trigger_depends d"
-			" order by d.triggerid_down")))
-	{
+	if (NULL == (tdep_result = DCsync_select(ZBX_DC_SYNC_TRIGDEPS)))
 		goto out;
-	}
 	dsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (func_result = DBselect(
-			"select i.itemid,f.functionid,f.function,f.parameter,t.triggerid"
-			" from hosts h,items i,functions f,triggers t"
-			" where h.hostid=i.hostid"
-				" and i.itemid=f.itemid"
-				" and f.triggerid=t.triggerid"
-				" and h.status in (%d,%d)"
-				" and t.flags<>%d",
-			HOST_STATUS_MONITORED, HOST_STATUS_NOT_MONITORED,
-			ZBX_FLAG_DISCOVERY_PROTOTYPE)))
-	{
+	if (NULL == (func_result = DCsync_select(ZBX_DC_SYNC_FUNCTIONS)))
 		goto out;
-	}
 	fsec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (expr_result = DBselect(
-			"select r.name,e.expressionid,e.expression,e.expression_type,e.exp_delimiter,e.case_sensitive"
-			" from regexps r,expressions e"
-			" where r.regexpid=e.regexpid")))
-	{
+	if (NULL == (expr_result = DCsync_select(ZBX_DC_SYNC_EXPRESSIONS)))
 		goto out;
-	}
 	expr_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (action_result = DBselect(
-			"select actionid,eventsource,evaltype,formula"
-			" from actions"
-			" where status=%d",
-			ACTION_STATUS_ACTIVE)))
-	{
+	if (NULL == (action_result = DCsync_select(ZBX_DC_SYNC_ACTIONS)))
 		goto out;
-	}
 	action_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (action_condition_result = DBselect(
-			"select c.conditionid,c.actionid,c.conditiontype,c.operator,c.value,c.value2"
-			" from conditions c,actions a"
-			" where c.actionid=a.actionid"
-				" and a.status=%d",
-			ACTION_STATUS_ACTIVE)))
-	{
+	if (NULL == (action_condition_result = DCsync_select(ZBX_DC_SYNC_ACTION_CONDITIONS)))
 		goto out;
-	}
 	action_condition_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (trigger_tag_result = DBselect(
-			"select triggertagid,triggerid,tag,value"
-			" from trigger_tag")))
-	{
+	if (NULL == (trigger_tag_result = DCsync_select(ZBX_DC_SYNC_TRIGGER_TAGS)))
 		goto out;
-	}
 	trigger_tag_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (correlation_result = DBselect(
-			"select correlationid,name,evaltype,formula"
-			" from correlation"
-			" where status=%d",
-			ZBX_CORRELATION_ENABLED)))
-	{
+	if (NULL == (correlation_result = DCsync_select(ZBX_DC_SYNC_CORRELATIONS)))
 		goto out;
-	}
 	correlation_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (corr_condition_result = DBselect(
-			"select cc.corr_conditionid,cc.correlationid,cc.type,cct.tag,cctv.tag,cctv.value,cctv.operator,"
-				" ccg.groupid,ccg.operator,cctp.oldtag,cctp.newtag"
-			" from correlation c,corr_condition cc"
-			" left join corr_condition_tag cct"
-				" on cct.corr_conditionid=cc.corr_conditionid"
-			" left join corr_condition_tagvalue cctv"
-				" on cctv.corr_conditionid=cc.corr_conditionid"
-			" left join corr_condition_group ccg"
-				" on ccg.corr_conditionid=cc.corr_conditionid"
-			" left join corr_condition_tagpair cctp"
-				" on cctp.corr_conditionid=cc.corr_conditionid"
-			" where c.correlationid=cc.correlationid"
-				" and c.status=%d",
-			ZBX_CORRELATION_ENABLED)))
-	{
+	if (NULL == (corr_condition_result = DCsync_select(ZBX_DC_SYNC_CORR_CONDITIONS)))
 		goto out;
-	}
 	corr_condition_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (corr_operation_result = DBselect(
-			"select co.corr_operationid,co.correlationid,co.type"
-			" from correlation c,corr_operation co"
-			" where c.correlationid=co.correlationid"
-				" and c.status=%d",
-			ZBX_CORRELATION_ENABLED)))
-	{
+	if (NULL == (corr_operation_result = DCsync_select(ZBX_DC_SYNC_CORR_OPERATIONS)))
 		goto out;
-	}
 	corr_operation_sec = zbx_time() - sec;
 
 	sec = zbx_time();
-	if (NULL == (hgroups_result = DBselect("select groupid,name from groups")))
+	if (NULL == (hgroups_result = DCsync_select(ZBX_DC_SYNC_HOSTGROUPS)))
 		goto out;
 	hgroups_sec = zbx_time() - sec;
 
@@ -4845,8 +5167,6 @@ void	DCsync_configuration(void)
 			config->jmxitems.num_data, config->jmxitems.num_slots);
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() calcitems  : %d (%d slots)", __function_name,
 			config->calcitems.num_data, config->calcitems.num_slots);
-	zabbix_log(LOG_LEVEL_DEBUG, "%s() deltaitems : %d (%d slots)", __function_name,
-			config->deltaitems.num_data, config->deltaitems.num_slots);
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() functions  : %d (%d slots)", __function_name,
 			config->functions.num_data, config->functions.num_slots);
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() triggers   : %d (%d slots)", __function_name,
@@ -4889,8 +5209,9 @@ void	DCsync_configuration(void)
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() configfree : " ZBX_FS_DBL "%%", __function_name,
 			100 * ((double)config_mem->free_size / config_mem->orig_size));
 
+	zbx_strpool_get_counts(&strings_num, &strings_slots);
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() strings    : %d (%d slots)", __function_name,
-			strpool->hashset->num_data, strpool->hashset->num_slots);
+			strings_num, strings_slots);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "%s() strpoolfree: " ZBX_FS_DBL "%%", __function_name,
 			100 * ((double)strpool->mem_info->free_size / strpool->mem_info->orig_size));
@@ -4927,33 +5248,1147 @@ out:
 
 /******************************************************************************
  *                                                                            *
- * Helper functions for configuration cache data structure element comparison *
- * and hash value calculation.                                                *
+ * Function: dc_snapshot_get_dbversion                                        *
  *                                                                            *
- * The __config_mem_XXX_func(), __config_XXX_hash and __config_XXX_compare    *
- * functions are used only inside init_configuration_cache() function to      *
- * initialize internal data structures.                                       *
+ * Purpose: get database version to validate configuration cache snapshot     *
  *                                                                            *
  ******************************************************************************/
-
-static zbx_hash_t	__config_item_hk_hash(const void *data)
+static int	dc_snapshot_get_dbversion(int *mandatory, int *optional)
 {
-	const ZBX_DC_ITEM_HK	*item_hk = (const ZBX_DC_ITEM_HK *)data;
+	DB_RESULT	result;
+	DB_ROW		row;
+	int		ret = FAIL;
 
-	zbx_hash_t		hash;
+	result = DBselect("select mandatory,optional from dbversion");
 
-	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&item_hk->hostid);
-	hash = ZBX_DEFAULT_STRING_HASH_ALGO(item_hk->key, strlen(item_hk->key), hash);
+	if (NULL != (row = DBfetch(result)))
+	{
+		*mandatory = atoi(row[0]);
+		*optional = atoi(row[1]);
+		ret = SUCCEED;
+	}
+	DBfree_result(result);
 
-	return hash;
+	return ret;
 }
 
-static int	__config_item_hk_compare(const void *d1, const void *d2)
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_config                                         *
+ *                                                                            *
+ * Purpose: write cached config table data to snapshot, see DCsync_config()   *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_config(void)
 {
-	const ZBX_DC_ITEM_HK	*item_hk_1 = (const ZBX_DC_ITEM_HK *)d1;
-	const ZBX_DC_ITEM_HK	*item_hk_2 = (const ZBX_DC_ITEM_HK *)d2;
+	const ZBX_DC_CONFIG_TABLE	*table = config->config;
+	int				i;
 
-	ZBX_RETURN_IF_NOT_EQUAL(item_hk_1->hostid, item_hk_2->hostid);
+	dc_snapshot_write_result(ZBX_DC_SYNC_CONFIG, 27);
+
+	dc_snapshot_write_row();
+	dc_snapshot_write_field_int(table->refresh_unsupported);
+	dc_snapshot_write_field_uint64(table->discovery_groupid);
+	dc_snapshot_write_field_int(table->snmptrap_logging);
+
+	for (i = 0; TRIGGER_SEVERITY_COUNT > i; i++)
+		dc_snapshot_write_field(table->severity_name[i]);
+
+	dc_snapshot_write_field_int(table->hk.events_mode);
+	dc_snapshot_write_field_int(table->hk.events_trigger);
+	dc_snapshot_write_field_int(table->hk.events_internal);
+	dc_snapshot_write_field_int(table->hk.events_discovery);
+	dc_snapshot_write_field_int(table->hk.events_autoreg);
+	dc_snapshot_write_field_int(table->hk.services_mode);
+	dc_snapshot_write_field_int(table->hk.services);
+	dc_snapshot_write_field_int(table->hk.audit_mode);
+	dc_snapshot_write_field_int(table->hk.audit);
+	dc_snapshot_write_field_int(table->hk.sessions_mode);
+	dc_snapshot_write_field_int(table->hk.sessions);
+	dc_snapshot_write_field_int(table->hk.history_mode);
+	dc_snapshot_write_field_int(table->hk.history_global);
+	dc_snapshot_write_field_int(table->hk.history);
+	dc_snapshot_write_field_int(table->hk.trends_mode);
+	dc_snapshot_write_field_int(table->hk.trends_global);
+	dc_snapshot_write_field_int(table->hk.trends);
+	dc_snapshot_write_field_int(table->default_inventory_mode);
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_hosts                                          *
+ *                                                                            *
+ * Purpose: write cached hosts and proxies to snapshot, see DCsync_hosts()    *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_hosts(void)
+{
+	const ZBX_DC_HOST	*host;
+	const ZBX_DC_IPMIHOST	*ipmihost;
+	const ZBX_DC_PROXY	*proxy;
+	zbx_hashset_iter_t	iter;
+
+#if defined(HAVE_POLARSSL) || defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	dc_snapshot_write_result(ZBX_DC_SYNC_HOSTS, 35);
+#else
+	dc_snapshot_write_result(ZBX_DC_SYNC_HOSTS, 31);
+#endif
+	zbx_hashset_iter_reset(&config->hosts, &iter);
+
+	while (NULL != (host = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(host->hostid);
+		dc_snapshot_write_field_id(host->proxy_hostid);
+		dc_snapshot_write_field(host->host);
+
+		if (NULL != (ipmihost = zbx_hashset_search(&config->ipmihosts, &host->hostid)))
+		{
+			dc_snapshot_write_field_int(ipmihost->ipmi_authtype);
+			dc_snapshot_write_field_int(ipmihost->ipmi_privilege);
+			dc_snapshot_write_field(ipmihost->ipmi_username);
+			dc_snapshot_write_field(ipmihost->ipmi_password);
+		}
+		else
+		{
+			/* the values considered as not using IPMI */
+			dc_snapshot_write_field_int(0);
+			dc_snapshot_write_field_int(2);
+			dc_snapshot_write_field("");
+			dc_snapshot_write_field("");
+		}
+
+		dc_snapshot_write_field_int(host->maintenance_status);
+		dc_snapshot_write_field_int(host->maintenance_type);
+		dc_snapshot_write_field_int(host->maintenance_from);
+		dc_snapshot_write_field_int(host->errors_from);
+		dc_snapshot_write_field_int(host->available);
+		dc_snapshot_write_field_int(host->disable_until);
+		dc_snapshot_write_field_int(host->snmp_errors_from);
+		dc_snapshot_write_field_int(host->snmp_available);
+		dc_snapshot_write_field_int(host->snmp_disable_until);
+		dc_snapshot_write_field_int(host->ipmi_errors_from);
+		dc_snapshot_write_field_int(host->ipmi_available);
+		dc_snapshot_write_field_int(host->ipmi_disable_until);
+		dc_snapshot_write_field_int(host->jmx_errors_from);
+		dc_snapshot_write_field_int(host->jmx_available);
+		dc_snapshot_write_field_int(host->jmx_disable_until);
+		dc_snapshot_write_field_int(host->status);
+		dc_snapshot_write_field(host->name);
+
+		proxy = zbx_hashset_search(&config->proxies, &host->hostid);
+		dc_snapshot_write_field_int(NULL != proxy ? proxy->lastaccess : 0);
+
+		dc_snapshot_write_field(host->error);
+		dc_snapshot_write_field(host->snmp_error);
+		dc_snapshot_write_field(host->ipmi_error);
+		dc_snapshot_write_field(host->jmx_error);
+		dc_snapshot_write_field_int(host->tls_connect);
+		dc_snapshot_write_field_int(host->tls_accept);
+#if defined(HAVE_POLARSSL) || defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+		dc_snapshot_write_field(host->tls_issuer);
+		dc_snapshot_write_field(host->tls_subject);
+		dc_snapshot_write_field(NULL != host->tls_dc_psk ? host->tls_dc_psk->tls_psk_identity : "");
+		dc_snapshot_write_field(NULL != host->tls_dc_psk ? host->tls_dc_psk->tls_psk : "");
+#endif
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_host_inventory                                 *
+ *                                                                            *
+ * Purpose: write cached host inventory modes to snapshot                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_host_inventory(void)
+{
+	const ZBX_DC_HOST_INVENTORY	*host_inventory;
+	zbx_hashset_iter_t		iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_HOST_INVENTORY, 2);
+
+	zbx_hashset_iter_reset(&config->host_inventories, &iter);
+
+	while (NULL != (host_inventory = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(host_inventory->hostid);
+		dc_snapshot_write_field_int(host_inventory->inventory_mode);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_htmpls                                         *
+ *                                                                            *
+ * Purpose: write cached host templates to snapshot                           *
+ *                                                                            *
+ * Comments: DCsync_htmpls() expects the rows to be sorted by host.           *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_htmpls(void)
+{
+	const ZBX_DC_HTMPL	*htmpl;
+	zbx_vector_ptr_t	htmpls;
+	zbx_hashset_iter_t	iter;
+	int			i, j;
+
+	zbx_vector_ptr_create(&htmpls);
+	zbx_vector_ptr_reserve(&htmpls, config->htmpls.num_data);
+
+	zbx_hashset_iter_reset(&config->htmpls, &iter);
+
+	while (NULL != (htmpl = zbx_hashset_iter_next(&iter)))
+		zbx_vector_ptr_append(&htmpls, (void *)htmpl);
+
+	zbx_vector_ptr_sort(&htmpls, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_HTMPLS, 2);
+
+	for (i = 0; i < htmpls.values_num; i++)
+	{
+		htmpl = (const ZBX_DC_HTMPL *)htmpls.values[i];
+
+		for (j = 0; j < htmpl->templateids.values_num; j++)
+		{
+			dc_snapshot_write_row();
+			dc_snapshot_write_field_uint64(htmpl->hostid);
+			dc_snapshot_write_field_uint64(htmpl->templateids.values[j]);
+		}
+	}
+
+	dc_snapshot_write_result_end();
+
+	zbx_vector_ptr_destroy(&htmpls);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_macro                                          *
+ *                                                                            *
+ * Purpose: write user macro with context as it is stored in database         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_macro(const char *macro, const char *context)
+{
+	char	*context_esc, *buffer;
+
+	if (NULL == context)
+	{
+		dc_snapshot_write_field(macro);
+		return;
+	}
+
+	/* cached macro name is "{$MACRO}", the context is inserted before the closing brace */
+	context_esc = zbx_user_macro_quote_context_dyn(context, 1);
+	buffer = zbx_dsprintf(NULL, "%.*s:%s}", (int)strlen(macro) - 1, macro, context_esc);
+	dc_snapshot_write_field(buffer);
+
+	zbx_free(buffer);
+	zbx_free(context_esc);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_gmacros                                        *
+ *                                                                            *
+ * Purpose: write cached global macros to snapshot                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_gmacros(void)
+{
+	const ZBX_DC_GMACRO	*gmacro;
+	zbx_hashset_iter_t	iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_GMACROS, 3);
+
+	zbx_hashset_iter_reset(&config->gmacros, &iter);
+
+	while (NULL != (gmacro = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(gmacro->globalmacroid);
+		dc_snapshot_write_macro(gmacro->macro, gmacro->context);
+		dc_snapshot_write_field(gmacro->value);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_hmacros                                        *
+ *                                                                            *
+ * Purpose: write cached host macros to snapshot                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_hmacros(void)
+{
+	const ZBX_DC_HMACRO	*hmacro;
+	zbx_hashset_iter_t	iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_HMACROS, 4);
+
+	zbx_hashset_iter_reset(&config->hmacros, &iter);
+
+	while (NULL != (hmacro = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(hmacro->hostmacroid);
+		dc_snapshot_write_field_uint64(hmacro->hostid);
+		dc_snapshot_write_macro(hmacro->macro, hmacro->context);
+		dc_snapshot_write_field(hmacro->value);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_interfaces                                     *
+ *                                                                            *
+ * Purpose: write cached host interfaces to snapshot                          *
+ *                                                                            *
+ * Comments: The cached ip and dns fields have {HOST.IP} and {HOST.DNS}       *
+ *           macros already resolved, resolving them again does not change    *
+ *           the values.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_interfaces(void)
+{
+	const ZBX_DC_INTERFACE	*interface;
+	zbx_hashset_iter_t	iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_INTERFACES, 9);
+
+	zbx_hashset_iter_reset(&config->interfaces, &iter);
+
+	while (NULL != (interface = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(interface->interfaceid);
+		dc_snapshot_write_field_uint64(interface->hostid);
+		dc_snapshot_write_field_int(interface->type);
+		dc_snapshot_write_field_int(interface->main);
+		dc_snapshot_write_field_int(interface->useip);
+		dc_snapshot_write_field(interface->ip);
+		dc_snapshot_write_field(interface->dns);
+		dc_snapshot_write_field(interface->port);
+		dc_snapshot_write_field_int(interface->bulk);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_items                                          *
+ *                                                                            *
+ * Purpose: write cached items to snapshot, see DCsync_items()                *
+ *                                                                            *
+ * Comments: The fields not used by the item type are written empty. Item     *
+ *           state and error are written as they are stored in database.      *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_items(void)
+{
+	const ZBX_DC_ITEM	*item;
+	const ZBX_DC_NUMITEM	*numitem;
+	const ZBX_DC_SNMPITEM	*snmpitem;
+	const ZBX_DC_IPMIITEM	*ipmiitem;
+	const ZBX_DC_FLEXITEM	*flexitem;
+	const ZBX_DC_TRAPITEM	*trapitem;
+	const ZBX_DC_LOGITEM	*logitem;
+	const ZBX_DC_DBITEM	*dbitem;
+	const ZBX_DC_SSHITEM	*sshitem;
+	const ZBX_DC_TELNETITEM	*telnetitem;
+	const ZBX_DC_SIMPLEITEM	*simpleitem;
+	const ZBX_DC_JMXITEM	*jmxitem;
+	const ZBX_DC_CALCITEM	*calcitem;
+	const char		*params, *username, *password, *publickey, *privatekey;
+	int			authtype;
+	zbx_hashset_iter_t	iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_ITEMS, 42);
+
+	zbx_hashset_iter_reset(&config->items, &iter);
+
+	while (NULL != (item = zbx_hashset_iter_next(&iter)))
+	{
+		params = username = password = publickey = privatekey = "";
+		authtype = 0;
+
+		switch (item->type)
+		{
+			case ITEM_TYPE_DB_MONITOR:
+				if (NULL != (dbitem = zbx_hashset_search(&config->dbitems, &item->itemid)))
+				{
+					params = dbitem->params;
+					username = dbitem->username;
+					password = dbitem->password;
+				}
+				break;
+			case ITEM_TYPE_SSH:
+				if (NULL != (sshitem = zbx_hashset_search(&config->sshitems, &item->itemid)))
+				{
+					params = sshitem->params;
+					username = sshitem->username;
+					password = sshitem->password;
+					publickey = sshitem->publickey;
+					privatekey = sshitem->privatekey;
+					authtype = sshitem->authtype;
+				}
+				break;
+			case ITEM_TYPE_TELNET:
+				if (NULL != (telnetitem = zbx_hashset_search(&config->telnetitems, &item->itemid)))
+				{
+					params = telnetitem->params;
+					username = telnetitem->username;
+					password = telnetitem->password;
+				}
+				break;
+			case ITEM_TYPE_SIMPLE:
+				if (NULL != (simpleitem = zbx_hashset_search(&config->simpleitems, &item->itemid)))
+				{
+					username = simpleitem->username;
+					password = simpleitem->password;
+				}
+				break;
+			case ITEM_TYPE_JMX:
+				if (NULL != (jmxitem = zbx_hashset_search(&config->jmxitems, &item->itemid)))
+				{
+					username = jmxitem->username;
+					password = jmxitem->password;
+				}
+				break;
+			case ITEM_TYPE_CALCULATED:
+				if (NULL != (calcitem = zbx_hashset_search(&config->calcitems, &item->itemid)))
+					params = calcitem->params;
+				break;
+		}
+
+		snmpitem = zbx_hashset_search(&config->snmpitems, &item->itemid);
+		numitem = zbx_hashset_search(&config->numitems, &item->itemid);
+		ipmiitem = zbx_hashset_search(&config->ipmiitems, &item->itemid);
+		flexitem = zbx_hashset_search(&config->flexitems, &item->itemid);
+		trapitem = zbx_hashset_search(&config->trapitems, &item->itemid);
+		logitem = zbx_hashset_search(&config->logitems, &item->itemid);
+
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(item->itemid);
+		dc_snapshot_write_field_uint64(item->hostid);
+		dc_snapshot_write_field_int(item->status);
+		dc_snapshot_write_field_int(item->type);
+		dc_snapshot_write_field_int(item->data_type);
+		dc_snapshot_write_field_int(item->value_type);
+		dc_snapshot_write_field(item->key);
+		dc_snapshot_write_field(NULL != snmpitem ? snmpitem->snmp_community : "");
+		dc_snapshot_write_field(NULL != snmpitem ? snmpitem->snmp_oid : "");
+		dc_snapshot_write_field(item->port);
+		dc_snapshot_write_field(NULL != snmpitem ? snmpitem->snmpv3_securityname : "");
+		dc_snapshot_write_field_int(NULL != snmpitem ? snmpitem->snmpv3_securitylevel : 0);
+		dc_snapshot_write_field(NULL != snmpitem ? snmpitem->snmpv3_authpassphrase : "");
+		dc_snapshot_write_field(NULL != snmpitem ? snmpitem->snmpv3_privpassphrase : "");
+		dc_snapshot_write_field(NULL != ipmiitem ? ipmiitem->ipmi_sensor : "");
+		dc_snapshot_write_field_int(item->delay);
+		dc_snapshot_write_field(NULL != flexitem ? flexitem->delay_flex : "");
+		dc_snapshot_write_field(NULL != trapitem ? trapitem->trapper_hosts : "");
+		dc_snapshot_write_field(NULL != logitem ? logitem->logtimefmt : "");
+		dc_snapshot_write_field(params);
+		dc_snapshot_write_field_int(item->db_state);
+		dc_snapshot_write_field_int(authtype);
+		dc_snapshot_write_field(username);
+		dc_snapshot_write_field(password);
+		dc_snapshot_write_field(publickey);
+		dc_snapshot_write_field(privatekey);
+		dc_snapshot_write_field_int(item->flags);
+		dc_snapshot_write_field_id(item->interfaceid);
+		dc_snapshot_write_field_int(NULL != snmpitem ? snmpitem->snmpv3_authprotocol : 0);
+		dc_snapshot_write_field_int(NULL != snmpitem ? snmpitem->snmpv3_privprotocol : 0);
+		dc_snapshot_write_field(NULL != snmpitem ? snmpitem->snmpv3_contextname : "");
+		dc_snapshot_write_field_uint64(item->lastlogsize);
+		dc_snapshot_write_field_int(item->mtime);
+		dc_snapshot_write_field_int(NULL != numitem ? numitem->delta : 0);
+		dc_snapshot_write_field_int(NULL != numitem ? numitem->multiplier : 0);
+		dc_snapshot_write_field(NULL != numitem ? numitem->formula : "");
+		dc_snapshot_write_field_int(item->history);
+		dc_snapshot_write_field_int(NULL != numitem ? numitem->trends : 0);
+		dc_snapshot_write_field_int(item->inventory_link);
+		dc_snapshot_write_field_id(item->valuemapid);
+		dc_snapshot_write_field(NULL != numitem ? numitem->units : "");
+		dc_snapshot_write_field(item->db_error);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_triggers                                       *
+ *                                                                            *
+ * Purpose: write cached triggers to snapshot                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_triggers(void)
+{
+	const ZBX_DC_TRIGGER	*trigger;
+	zbx_hashset_iter_t	iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_TRIGGERS, 14);
+
+	zbx_hashset_iter_reset(&config->triggers, &iter);
+
+	while (NULL != (trigger = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(trigger->triggerid);
+		dc_snapshot_write_field(trigger->description);
+		dc_snapshot_write_field(trigger->expression);
+		dc_snapshot_write_field(trigger->error);
+		dc_snapshot_write_field_int(trigger->priority);
+		dc_snapshot_write_field_int(trigger->type);
+		dc_snapshot_write_field_int(trigger->value);
+		dc_snapshot_write_field_int(trigger->state);
+		dc_snapshot_write_field_int(trigger->lastchange);
+		dc_snapshot_write_field_int(trigger->status);
+		dc_snapshot_write_field_int(trigger->recovery_mode);
+		dc_snapshot_write_field(trigger->recovery_expression);
+		dc_snapshot_write_field_int(trigger->correlation_mode);
+		dc_snapshot_write_field(trigger->correlation_tag);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_trigdeps                                       *
+ *                                                                            *
+ * Purpose: write cached trigger dependencies to snapshot                     *
+ *                                                                            *
+ * Comments: DCsync_trigdeps() expects the rows to be sorted by dependent     *
+ *           trigger.                                                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_trigdeps(void)
+{
+	const ZBX_DC_TRIGGER_DEPLIST	*trigdep;
+	zbx_vector_ptr_t		trigdeps;
+	zbx_hashset_iter_t		iter;
+	int				i, j;
+
+	zbx_vector_ptr_create(&trigdeps);
+
+	zbx_hashset_iter_reset(&config->trigdeps, &iter);
+
+	while (NULL != (trigdep = zbx_hashset_iter_next(&iter)))
+	{
+		if (NULL != trigdep->dependencies)
+			zbx_vector_ptr_append(&trigdeps, (void *)trigdep);
+	}
+
+	zbx_vector_ptr_sort(&trigdeps, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_TRIGDEPS, 2);
+
+	for (i = 0; i < trigdeps.values_num; i++)
+	{
+		trigdep = (const ZBX_DC_TRIGGER_DEPLIST *)trigdeps.values[i];
+
+		for (j = 0; NULL != trigdep->dependencies[j]; j++)
+		{
+			dc_snapshot_write_row();
+			dc_snapshot_write_field_uint64(trigdep->triggerid);
+			dc_snapshot_write_field_uint64(trigdep->dependencies[j]->triggerid);
+		}
+	}
+
+	dc_snapshot_write_result_end();
+
+	zbx_vector_ptr_destroy(&trigdeps);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_functions                                      *
+ *                                                                            *
+ * Purpose: write cached trigger functions to snapshot                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_functions(void)
+{
+	const ZBX_DC_FUNCTION	*function;
+	zbx_hashset_iter_t	iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_FUNCTIONS, 5);
+
+	zbx_hashset_iter_reset(&config->functions, &iter);
+
+	while (NULL != (function = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(function->itemid);
+		dc_snapshot_write_field_uint64(function->functionid);
+		dc_snapshot_write_field(function->function);
+		dc_snapshot_write_field(function->parameter);
+		dc_snapshot_write_field_uint64(function->triggerid);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_expressions                                    *
+ *                                                                            *
+ * Purpose: write cached global regular expressions to snapshot               *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_expressions(void)
+{
+	const ZBX_DC_REGEXP	*regexp;
+	const ZBX_DC_EXPRESSION	*expression;
+	zbx_hashset_iter_t	iter;
+	char			delimiter[2];
+	int			i;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_EXPRESSIONS, 6);
+
+	zbx_hashset_iter_reset(&config->regexps, &iter);
+
+	while (NULL != (regexp = zbx_hashset_iter_next(&iter)))
+	{
+		for (i = 0; i < regexp->expressionids.values_num; i++)
+		{
+			if (NULL == (expression = zbx_hashset_search(&config->expressions,
+					&regexp->expressionids.values[i])))
+			{
+				continue;
+			}
+
+			delimiter[0] = expression->delimiter;
+			delimiter[1] = '\0';
+
+			dc_snapshot_write_row();
+			dc_snapshot_write_field(regexp->name);
+			dc_snapshot_write_field_uint64(expression->expressionid);
+			dc_snapshot_write_field(expression->expression);
+			dc_snapshot_write_field_int(expression->type);
+			dc_snapshot_write_field(delimiter);
+			dc_snapshot_write_field_int(expression->case_sensitive);
+		}
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_actions                                        *
+ *                                                                            *
+ * Purpose: write cached actions and their conditions to snapshot             *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_actions(void)
+{
+	const zbx_dc_action_t			*action;
+	const zbx_dc_action_condition_t		*condition;
+	zbx_hashset_iter_t			iter;
+	int					i;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_ACTIONS, 4);
+
+	zbx_hashset_iter_reset(&config->actions, &iter);
+
+	while (NULL != (action = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(action->actionid);
+		dc_snapshot_write_field_int(action->eventsource);
+		dc_snapshot_write_field_int(action->evaltype);
+		dc_snapshot_write_field(action->formula);
+	}
+
+	dc_snapshot_write_result_end();
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_ACTION_CONDITIONS, 6);
+
+	zbx_hashset_iter_reset(&config->actions, &iter);
+
+	while (NULL != (action = zbx_hashset_iter_next(&iter)))
+	{
+		for (i = 0; i < action->conditions.values_num; i++)
+		{
+			condition = (const zbx_dc_action_condition_t *)action->conditions.values[i];
+
+			dc_snapshot_write_row();
+			dc_snapshot_write_field_uint64(condition->conditionid);
+			dc_snapshot_write_field_uint64(action->actionid);
+			dc_snapshot_write_field_int(condition->conditiontype);
+			dc_snapshot_write_field_int(condition->op);
+			dc_snapshot_write_field(condition->value);
+			dc_snapshot_write_field(condition->value2);
+		}
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_trigger_tags                                   *
+ *                                                                            *
+ * Purpose: write cached trigger tags to snapshot                             *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_trigger_tags(void)
+{
+	const ZBX_DC_TRIGGER		*trigger;
+	const zbx_dc_trigger_tag_t	*trigger_tag;
+	zbx_hashset_iter_t		iter;
+	int				i;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_TRIGGER_TAGS, 4);
+
+	zbx_hashset_iter_reset(&config->triggers, &iter);
+
+	while (NULL != (trigger = zbx_hashset_iter_next(&iter)))
+	{
+		for (i = 0; i < trigger->tags.values_num; i++)
+		{
+			trigger_tag = (const zbx_dc_trigger_tag_t *)trigger->tags.values[i];
+
+			dc_snapshot_write_row();
+			dc_snapshot_write_field_uint64(trigger_tag->triggertagid);
+			dc_snapshot_write_field_uint64(trigger->triggerid);
+			dc_snapshot_write_field(trigger_tag->tag);
+			dc_snapshot_write_field(trigger_tag->value);
+		}
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_correlations                                   *
+ *                                                                            *
+ * Purpose: write cached correlations, their conditions and operations to     *
+ *          snapshot                                                          *
+ *                                                                            *
+ * Comments: The correlation condition data fields not used by the condition  *
+ *           type are written as NULL, like the outer joins in                *
+ *           DCsync_configuration() return them.                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_correlations(void)
+{
+	const zbx_dc_correlation_t	*correlation;
+	const zbx_dc_corr_condition_t	*condition;
+	const zbx_dc_corr_operation_t	*operation;
+	zbx_hashset_iter_t		iter;
+	int				i;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_CORRELATIONS, 4);
+
+	zbx_hashset_iter_reset(&config->correlations, &iter);
+
+	while (NULL != (correlation = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(correlation->correlationid);
+		dc_snapshot_write_field(correlation->name);
+		dc_snapshot_write_field_int(correlation->evaltype);
+		dc_snapshot_write_field(correlation->formula);
+	}
+
+	dc_snapshot_write_result_end();
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_CORR_CONDITIONS, 11);
+
+	zbx_hashset_iter_reset(&config->corr_conditions, &iter);
+
+	while (NULL != (condition = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(condition->corr_conditionid);
+		dc_snapshot_write_field_uint64(condition->correlationid);
+		dc_snapshot_write_field_int(condition->type);
+
+		if (ZBX_CORR_CONDITION_OLD_EVENT_TAG == condition->type ||
+				ZBX_CORR_CONDITION_NEW_EVENT_TAG == condition->type)
+		{
+			dc_snapshot_write_field(condition->data.tag.tag);
+		}
+		else
+			dc_snapshot_write_field(NULL);
+
+		if (ZBX_CORR_CONDITION_OLD_EVENT_TAG_VALUE == condition->type ||
+				ZBX_CORR_CONDITION_NEW_EVENT_TAG_VALUE == condition->type)
+		{
+			dc_snapshot_write_field(condition->data.tag_value.tag);
+			dc_snapshot_write_field(condition->data.tag_value.value);
+			dc_snapshot_write_field_int(condition->data.tag_value.op);
+		}
+		else
+		{
+			for (i = 0; i < 3; i++)
+				dc_snapshot_write_field(NULL);
+		}
+
+		if (ZBX_CORR_CONDITION_NEW_EVENT_HOSTGROUP == condition->type)
+		{
+			dc_snapshot_write_field_uint64(condition->data.group.groupid);
+			dc_snapshot_write_field_int(condition->data.group.op);
+		}
+		else
+		{
+			for (i = 0; i < 2; i++)
+				dc_snapshot_write_field(NULL);
+		}
+
+		if (ZBX_CORR_CONDITION_EVENT_TAG_PAIR == condition->type)
+		{
+			dc_snapshot_write_field(condition->data.tag_pair.oldtag);
+			dc_snapshot_write_field(condition->data.tag_pair.newtag);
+		}
+		else
+		{
+			for (i = 0; i < 2; i++)
+				dc_snapshot_write_field(NULL);
+		}
+	}
+
+	dc_snapshot_write_result_end();
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_CORR_OPERATIONS, 3);
+
+	zbx_hashset_iter_reset(&config->corr_operations, &iter);
+
+	while (NULL != (operation = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(operation->corr_operationid);
+		dc_snapshot_write_field_uint64(operation->correlationid);
+		dc_snapshot_write_field_int(operation->type);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_snapshot_write_hostgroups                                     *
+ *                                                                            *
+ * Purpose: write cached host groups to snapshot                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_snapshot_write_hostgroups(void)
+{
+	const zbx_dc_hostgroup_t	*group;
+	zbx_hashset_iter_t		iter;
+
+	dc_snapshot_write_result(ZBX_DC_SYNC_HOSTGROUPS, 2);
+
+	zbx_hashset_iter_reset(&config->hostgroups, &iter);
+
+	while (NULL != (group = zbx_hashset_iter_next(&iter)))
+	{
+		dc_snapshot_write_row();
+		dc_snapshot_write_field_uint64(group->groupid);
+		dc_snapshot_write_field(group->name);
+	}
+
+	dc_snapshot_write_result_end();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCconfig_snapshot_save                                           *
+ *                                                                            *
+ * Purpose: save configuration cache data to snapshot file                    *
+ *                                                                            *
+ * Parameters: filename - [IN] the snapshot file name                         *
+ *                                                                            *
+ * Return value: SUCCEED - the snapshot was saved                             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The cached data is written under configuration cache read lock   *
+ *           in the form of configuration sync select statement results, so   *
+ *           it can be loaded with DCsync_configuration(). Database is not    *
+ *           accessed, the database version is remembered when checking for   *
+ *           snapshot at startup.                                             *
+ *           The snapshot is written to temporary file which is renamed to    *
+ *           the target file name only when all data was written, so the      *
+ *           previous snapshot is never replaced with incomplete one.         *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_snapshot_save(const char *filename)
+{
+	const char	*__function_name = "DCconfig_snapshot_save";
+	char		*tmpname;
+	unsigned char	int_size = sizeof(int);
+	int		ret = FAIL, fd = -1;
+	double		sec;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() filename:'%s'", __function_name, filename);
+
+	/* the cache must be initialized and synced at least once */
+	if (NULL == config || 0 == config->sync_ts)
+		goto out;
+
+	if (-1 == snapshot_db_mandatory)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot save configuration cache snapshot: unknown database version");
+		goto out;
+	}
+
+	tmpname = zbx_dsprintf(NULL, "%s.tmp", filename);
+
+	/* the snapshot contains passwords and PSKs, create it readable by the owner only; */
+	/* the temporary file left by an interrupted save is removed first                 */
+	unlink(tmpname);
+
+	if (-1 == (fd = open(tmpname, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR)) ||
+			NULL == (snapshot_file = fdopen(fd, "wb")))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot save configuration cache snapshot: cannot open file \"%s\": %s",
+				tmpname, zbx_strerror(errno));
+
+		if (-1 != fd)
+		{
+			close(fd);
+			unlink(tmpname);
+		}
+
+		zbx_free(tmpname);
+		goto out;
+	}
+
+	sec = zbx_time();
+	snapshot_error = 0;
+
+	dc_snapshot_write(ZBX_DC_SNAPSHOT_MAGIC, ZBX_DC_SNAPSHOT_MAGIC_LEN);
+	dc_snapshot_write(&int_size, sizeof(int_size));
+	dc_snapshot_write_int(ZBX_DC_SNAPSHOT_BYTE_ORDER);
+	dc_snapshot_write_int(ZBX_DC_SNAPSHOT_VERSION);
+	dc_snapshot_write_str(ZABBIX_VERSION);
+	dc_snapshot_write_int(snapshot_db_mandatory);
+	dc_snapshot_write_int(snapshot_db_optional);
+	dc_snapshot_write_int((int)time(NULL));
+
+	RDLOCK_CACHE;
+
+	/* the order must match the order of select statements in DCsync_configuration() */
+	dc_snapshot_write_config();
+	dc_snapshot_write_hosts();
+	dc_snapshot_write_host_inventory();
+	dc_snapshot_write_htmpls();
+	dc_snapshot_write_gmacros();
+	dc_snapshot_write_hmacros();
+	dc_snapshot_write_interfaces();
+	dc_snapshot_write_items();
+	dc_snapshot_write_triggers();
+	dc_snapshot_write_trigdeps();
+	dc_snapshot_write_functions();
+	dc_snapshot_write_expressions();
+	dc_snapshot_write_actions();
+	dc_snapshot_write_trigger_tags();
+	dc_snapshot_write_correlations();
+	dc_snapshot_write_hostgroups();
+
+	UNLOCK_CACHE;
+
+	if (0 != fclose(snapshot_file))
+		snapshot_error = 1;
+
+	snapshot_file = NULL;
+
+	if (0 != snapshot_error || 0 != rename(tmpname, filename))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot save configuration cache snapshot to file \"%s\"", filename);
+		unlink(tmpname);
+	}
+	else
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "configuration cache snapshot saved to file \"%s\" in " ZBX_FS_DBL
+				" sec", filename, zbx_time() - sec);
+		ret = SUCCEED;
+	}
+
+	zbx_free(tmpname);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCconfig_snapshot_load                                           *
+ *                                                                            *
+ * Purpose: make initial configuration cache sync from snapshot file          *
+ *                                                                            *
+ * Parameters: filename - [IN] the snapshot file name                         *
+ *                                                                            *
+ * Return value: SUCCEED - configuration cache was loaded from snapshot       *
+ *               FAIL    - snapshot does not exist or cannot be used,         *
+ *                         configuration must be synced from database         *
+ *                                                                            *
+ * Comments: The snapshot is removed after loading attempt. It reflects the   *
+ *           configuration cache state at the moment of the server shutdown   *
+ *           and must not be used again if the server crashes later. The      *
+ *           snapshot is rejected if it was created on a different            *
+ *           architecture or by different Zabbix or database version.         *
+ *           The database version is remembered for DCconfig_snapshot_save(). *
+ *           Database connection must be established by caller.               *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_snapshot_load(const char *filename)
+{
+	const char	*__function_name = "DCconfig_snapshot_load";
+	char		magic[ZBX_DC_SNAPSHOT_MAGIC_LEN], *version = NULL;
+	unsigned char	int_size;
+	int		ret = FAIL, byte_order, format, mandatory, optional, ts;
+	double		sec;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() filename:'%s'", __function_name, filename);
+
+	if (SUCCEED != dc_snapshot_get_dbversion(&snapshot_db_mandatory, &snapshot_db_optional))
+		snapshot_db_mandatory = snapshot_db_optional = -1;
+
+	if (NULL == (snapshot_file = fopen(filename, "rb")))
+	{
+		if (ENOENT != errno)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot open configuration cache snapshot file \"%s\": %s",
+					filename, zbx_strerror(errno));
+		}
+		goto out;
+	}
+
+	sec = zbx_time();
+	snapshot_error = 0;
+
+	if (SUCCEED != dc_snapshot_read(magic, sizeof(magic)) || 0 != memcmp(magic, ZBX_DC_SNAPSHOT_MAGIC, sizeof(magic))
+			|| SUCCEED != dc_snapshot_read(&int_size, sizeof(int_size)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "unsupported configuration cache snapshot file \"%s\" format", filename);
+		goto close;
+	}
+
+	if (sizeof(int) != int_size || SUCCEED != dc_snapshot_read_int(&byte_order) ||
+			ZBX_DC_SNAPSHOT_BYTE_ORDER != byte_order)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "configuration cache snapshot file \"%s\" was created on different"
+				" architecture", filename);
+		goto close;
+	}
+
+	if (SUCCEED != dc_snapshot_read_int(&format) || ZBX_DC_SNAPSHOT_VERSION != format)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "unsupported configuration cache snapshot file \"%s\" format", filename);
+		goto close;
+	}
+
+	if (SUCCEED != dc_snapshot_read_str(&version) || SUCCEED != dc_snapshot_read_int(&mandatory) ||
+			SUCCEED != dc_snapshot_read_int(&optional) || SUCCEED != dc_snapshot_read_int(&ts))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "corrupted configuration cache snapshot file \"%s\"", filename);
+		goto close;
+	}
+
+	if (NULL == version || 0 != strcmp(version, ZABBIX_VERSION) ||
+			mandatory != snapshot_db_mandatory || optional != snapshot_db_optional)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "configuration cache snapshot file \"%s\" was created by different"
+				" Zabbix or database version", filename);
+		goto close;
+	}
+
+	snapshot_mode = ZBX_DC_SNAPSHOT_LOAD;
+	DCsync_configuration();
+	snapshot_mode = ZBX_DC_SNAPSHOT_NONE;
+
+	if (0 != snapshot_error || 0 == config->sync_ts)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot load configuration cache snapshot file \"%s\"", filename);
+		goto close;
+	}
+
+	zabbix_log(LOG_LEVEL_WARNING, "configuration cache loaded from snapshot file \"%s\" created %d seconds ago"
+			" in " ZBX_FS_DBL " sec", filename, (int)time(NULL) - ts, zbx_time() - sec);
+
+	snapshot_loaded = 1;
+	ret = SUCCEED;
+close:
+	zbx_fclose(snapshot_file);
+
+	if (0 != unlink(filename))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot remove configuration cache snapshot file \"%s\": %s",
+				filename, zbx_strerror(errno));
+	}
+
+	zbx_free(version);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCconfig_snapshot_loaded                                         *
+ *                                                                            *
+ * Purpose: check if initial configuration sync was made from snapshot        *
+ *                                                                            *
+ * Return value: SUCCEED - configuration was loaded from snapshot and must be *
+ *                         synced with database as soon as possible           *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	DCconfig_snapshot_loaded(void)
+{
+	return 1 == snapshot_loaded ? SUCCEED : FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Helper functions for configuration cache data structure element comparison *
+ * and hash value calculation.                                                *
+ *                                                                            *
+ * The __config_mem_XXX_func(), __config_XXX_hash and __config_XXX_compare    *
+ * functions are used only inside init_configuration_cache() function to      *
+ * initialize internal data structures.                                       *
+ *                                                                            *
+ ******************************************************************************/
+
+static zbx_hash_t	__config_item_hk_hash(const void *data)
+{
+	const ZBX_DC_ITEM_HK	*item_hk = (const ZBX_DC_ITEM_HK *)data;
+
+	zbx_hash_t		hash;
+
+	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&item_hk->hostid);
+	hash = ZBX_DEFAULT_STRING_HASH_ALGO(item_hk->key, strlen(item_hk->key), hash);
+
+	return hash;
+}
+
+static int	__config_item_hk_compare(const void *d1, const void *d2)
+{
+	const ZBX_DC_ITEM_HK	*item_hk_1 = (const ZBX_DC_ITEM_HK *)d1;
+	const ZBX_DC_ITEM_HK	*item_hk_2 = (const ZBX_DC_ITEM_HK *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(item_hk_1->hostid, item_hk_2->hostid);
 
 	return item_hk_1->key == item_hk_2->key ? 0 : strcmp(item_hk_1->key, item_hk_2->key);
 }
@@ -5242,13 +6677,14 @@ void	init_configuration_cache(void)
 		exit(EXIT_FAILURE);
 	}
 
-	if (FAIL == zbx_mutex_create_force(&config_lock, ZBX_MUTEX_CONFIG))
+	if (FAIL == zbx_rwlock_create(&config_lock, ZBX_RWLOCK_CONFIG))
 	{
-		zbx_error("Unable to create mutex for configuration cache");
+		zbx_error("Unable to create lock for configuration cache");
 		exit(EXIT_FAILURE);
 	}
 
 	zbx_mem_create(&config_mem, shm_key, ZBX_NO_MUTEX, config_size, "configuration cache", "CacheSize", 0);
+	zbx_mem_enable_slabs(config_mem);
 
 	config = __config_mem_malloc_func(NULL, sizeof(ZBX_DC_CONFIG) +
 			CONFIG_TIMER_FORKS * sizeof(zbx_vector_ptr_t));
@@ -5276,7 +6712,6 @@ void	init_configuration_cache(void)
 	CREATE_HASHSET(config->simpleitems, 0);
 	CREATE_HASHSET(config->jmxitems, 0);
 	CREATE_HASHSET(config->calcitems, 0);
-	CREATE_HASHSET(config->deltaitems, 0);
 	CREATE_HASHSET(config->functions, 100);
 	CREATE_HASHSET(config->triggers, 100);
 	CREATE_HASHSET(config->trigdeps, 0);
@@ -5391,7 +6826,7 @@ void	free_configuration_cache(void)
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	config = NULL;
 	zbx_mem_destroy(config_mem);
@@ -5400,7 +6835,7 @@ void	free_configuration_cache(void)
 
 	UNLOCK_CACHE;
 
-	zbx_mutex_destroy(&config_lock);
+	zbx_rwlock_destroy(&config_lock);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
@@ -5427,7 +6862,7 @@ void	DCload_config(void)
 
 	result = DCsync_config_select();
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	DCsync_config(result, &refresh_unsupported_changed);
 
@@ -5554,7 +6989,7 @@ int	DCget_host_by_hostid(DC_HOST *host, zbx_uint64_t hostid)
 	int			ret = FAIL;
 	const ZBX_DC_HOST	*dc_host;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (NULL != (dc_host = zbx_hashset_search(&config->hosts, &hostid)))
 	{
@@ -5619,7 +7054,7 @@ int	DCcheck_proxy_permissions(const char *host, const zbx_socket_t *sock, zbx_ui
 		return FAIL;
 	}
 #endif
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (NULL == (dc_host = DCfind_proxy(host)))
 	{
@@ -5721,7 +7156,7 @@ size_t	DCget_psk_by_identity(const unsigned char *psk_identity, unsigned char *p
 	ZBX_DC_PSK		psk_i_local;
 	size_t			psk_len = 0;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	psk_i_local.tls_psk_identity = (const char *)psk_identity;
 
@@ -6047,14 +7482,14 @@ static void	DCget_trigger(DC_TRIGGER *dst_trigger, ZBX_DC_TRIGGER *src_trigger,
 
 	if (ZBX_EXPAND_MACROS == expand)
 	{
-		dst_trigger->expression = dc_cache_expanded_expression(src_trigger->expression,
-				&src_trigger->expression_ex, &dst_trigger->new_error);
+		dst_trigger->expression = dc_get_expanded_expression(src_trigger->expression,
+				src_trigger->expression_ex, &dst_trigger->new_error);
 
 		if (TRIGGER_RECOVERY_MODE_RECOVERY_EXPRESSION == dst_trigger->recovery_mode &&
 				NULL == dst_trigger->new_error)
 		{
-			dst_trigger->recovery_expression = dc_cache_expanded_expression(src_trigger->recovery_expression,
-					&src_trigger->recovery_expression_ex, &dst_trigger->new_error);
+			dst_trigger->recovery_expression = dc_get_expanded_expression(src_trigger->recovery_expression,
+					src_trigger->recovery_expression_ex, &dst_trigger->new_error);
 		}
 	}
 
@@ -6120,7 +7555,7 @@ void	DCconfig_get_items_by_keys(DC_ITEM *items, zbx_host_key_t *keys, int *errco
 	const ZBX_DC_ITEM	*dc_item;
 	const ZBX_DC_HOST	*dc_host;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	for (i = 0; i < num; i++)
 	{
@@ -6159,7 +7594,7 @@ void	DCconfig_get_items_by_itemids(DC_ITEM *items, const zbx_uint64_t *itemids,
 	const ZBX_DC_ITEM	*dc_item;
 	const ZBX_DC_HOST	*dc_host;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	for (i = 0; i < num; i++)
 	{
@@ -6178,13 +7613,68 @@ void	DCconfig_get_items_by_itemids(DC_ITEM *items, const zbx_uint64_t *itemids,
 	UNLOCK_CACHE;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: DCconfig_get_preprocessable_items                                *
+ *                                                                            *
+ * Purpose: get item properties required for value conversion                 *
+ *                                                                            *
+ * Parameters: items    - [OUT] the item properties                           *
+ *             itemids  - [IN] the item identifiers                           *
+ *             errcodes - [OUT] SUCCEED if item was found, FAIL otherwise     *
+ *             num      - [IN] the number of items                            *
+ *                                                                            *
+ * Comments: Unlike DCconfig_get_items_by_itemids() host data and strings     *
+ *           unrelated to delta and multiplier calculation are not copied.    *
+ *                                                                            *
+ ******************************************************************************/
+void	DCconfig_get_preprocessable_items(zbx_preproc_item_t *items, const zbx_uint64_t *itemids, int *errcodes,
+		size_t num)
+{
+	size_t			i;
+	const ZBX_DC_ITEM	*dc_item;
+	const ZBX_DC_NUMITEM	*numitem;
+
+	RDLOCK_CACHE;
+
+	for (i = 0; i < num; i++)
+	{
+		if (NULL == (dc_item = zbx_hashset_search(&config->items, &itemids[i])))
+		{
+			errcodes[i] = FAIL;
+			continue;
+		}
+
+		items[i].itemid = dc_item->itemid;
+		items[i].value_type = dc_item->value_type;
+
+		if ((ITEM_VALUE_TYPE_FLOAT == dc_item->value_type || ITEM_VALUE_TYPE_UINT64 == dc_item->value_type) &&
+				NULL != (numitem = zbx_hashset_search(&config->numitems, &dc_item->itemid)))
+		{
+			items[i].delta = numitem->delta;
+			items[i].multiplier = numitem->multiplier;
+			strscpy(items[i].formula, numitem->formula);
+		}
+		else
+		{
+			items[i].delta = ITEM_STORE_AS_IS;
+			items[i].multiplier = ITEM_MULTIPLIER_DO_NOT_USE;
+			*items[i].formula = '\0';
+		}
+
+		errcodes[i] = SUCCEED;
+	}
+
+	UNLOCK_CACHE;
+}
+
 void	DCconfig_get_triggers_by_triggerids(DC_TRIGGER *triggers, const zbx_uint64_t *triggerids, int *errcode,
 		size_t num)
 {
 	size_t		i;
 	ZBX_DC_TRIGGER	*dc_trigger;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	for (i = 0; i < num; i++)
 	{
@@ -6212,7 +7702,7 @@ void	DCconfig_set_item_db_state(zbx_uint64_t itemid, unsigned char state, const
 {
 	ZBX_DC_ITEM	*dc_item;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (NULL != (dc_item = zbx_hashset_search(&config->items, &itemid)))
 	{
@@ -6243,7 +7733,7 @@ void	DCconfig_get_functions_by_functionids(DC_FUNCTION *functions, zbx_uint64_t
 	size_t			i;
 	const ZBX_DC_FUNCTION	*dc_function;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	for (i = 0; i < num; i++)
 	{
@@ -6339,7 +7829,7 @@ int	DCconfig_lock_triggers_by_history_items(zbx_vector_ptr_t *history_items, zbx
 	ZBX_DC_TRIGGER		*dc_trigger;
 	zbx_hc_item_t		*history_item;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < history_items->values_num; i++)
 	{
@@ -6399,7 +7889,7 @@ void	DCconfig_lock_triggers_by_triggerids(zbx_vector_uint64_t *triggerids_in, zb
 	if (0 == triggerids_in->values_num)
 		return;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < triggerids_in->values_num; i++)
 	{
@@ -6428,7 +7918,7 @@ void	DCconfig_unlock_triggers(const zbx_vector_uint64_t *triggerids)
 	int		i;
 	ZBX_DC_TRIGGER	*dc_trigger;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < triggerids->values_num; i++)
 	{
@@ -6454,7 +7944,7 @@ void	DCconfig_unlock_all_triggers(void)
 	ZBX_DC_TRIGGER		*dc_trigger;
 	zbx_hashset_iter_t	iter;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->triggers, &iter);
 
@@ -6480,7 +7970,7 @@ int	DCconfig_lock_lld_rule(zbx_uint64_t lld_ruleid)
 {
 	int	ret = FAIL;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (FAIL == zbx_vector_uint64_search(&config->locked_lld_ruleids, lld_ruleid, ZBX_DEFAULT_UINT64_COMPARE_FUNC))
 	{
@@ -6506,7 +7996,7 @@ void	DCconfig_unlock_lld_rule(zbx_uint64_t lld_ruleid)
 {
 	int	i;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (FAIL != (i = zbx_vector_uint64_search(&config->locked_lld_ruleids, lld_ruleid,
 			ZBX_DEFAULT_UINT64_COMPARE_FUNC)))
@@ -6532,12 +8022,17 @@ void	DCconfig_get_triggers_by_itemids(zbx_hashset_t *trigger_info, zbx_vector_pt
 		const zbx_uint64_t *itemids, const zbx_timespec_t *timespecs, char **errors, int itemids_num,
 		unsigned char expand)
 {
-	int			i, j, found;
+	int			i, j, found, sync_ts;
 	const ZBX_DC_ITEM	*dc_item;
 	ZBX_DC_TRIGGER		*dc_trigger;
 	DC_TRIGGER		*trigger;
+	zbx_vector_ptr_t	uncached;
+
+	zbx_vector_ptr_create(&uncached);
+
+	RDLOCK_CACHE;
 
-	LOCK_CACHE;
+	sync_ts = config->sync_ts;
 
 	for (i = 0; i < itemids_num; i++)
 	{
@@ -6560,6 +8055,14 @@ void	DCconfig_get_triggers_by_itemids(zbx_hashset_t *trigger_info, zbx_vector_pt
 			{
 				DCget_trigger(trigger, dc_trigger, expand);
 				zbx_vector_ptr_append(trigger_order, trigger);
+
+				/* remember triggers with expressions expanded outside cache */
+				if (ZBX_EXPAND_MACROS == expand && (NULL == dc_trigger->expression_ex ||
+						(TRIGGER_RECOVERY_MODE_RECOVERY_EXPRESSION == dc_trigger->recovery_mode &&
+						NULL == dc_trigger->recovery_expression_ex)))
+				{
+					zbx_vector_ptr_append(&uncached, trigger);
+				}
 			}
 
 			/* copy latest change timestamp and error message */
@@ -6578,6 +8081,29 @@ void	DCconfig_get_triggers_by_itemids(zbx_hashset_t *trigger_info, zbx_vector_pt
 
 	UNLOCK_CACHE;
 
+	/* Cache the expanded expressions so that the following calls can copy them under read lock. */
+	/* The expressions are cached only if configuration was not synced meanwhile, otherwise they */
+	/* could have been expanded with outdated user macro values.                                  */
+	if (0 != uncached.values_num)
+	{
+		WRLOCK_CACHE;
+
+		if (sync_ts == config->sync_ts)
+		{
+			for (i = 0; i < uncached.values_num; i++)
+			{
+				trigger = (DC_TRIGGER *)uncached.values[i];
+
+				if (NULL != (dc_trigger = zbx_hashset_search(&config->triggers, &trigger->triggerid)))
+					dc_trigger_cache_expanded_expressions(dc_trigger, trigger);
+			}
+		}
+
+		UNLOCK_CACHE;
+	}
+
+	zbx_vector_ptr_destroy(&uncached);
+
 	zbx_vector_ptr_sort(trigger_order, ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
 }
 
@@ -6652,7 +8178,7 @@ int	DCconfig_get_time_based_triggers(DC_TRIGGER *trigger_info, zbx_vector_ptr_t
 	ZBX_DC_TRIGGER		*dc_trigger;
 	DC_TRIGGER		*trigger;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	start = zbx_vector_ptr_nearestindex(&config->time_triggers[process_num - 1], &start_triggerid,
 			ZBX_DEFAULT_UINT64_PTR_COMPARE_FUNC);
@@ -6689,6 +8215,7 @@ int	DCconfig_get_time_based_triggers(DC_TRIGGER *trigger_info, zbx_vector_ptr_t
 		trigger = &trigger_info[trigger_order->values_num];
 
 		DCget_trigger(trigger, dc_trigger, ZBX_EXPAND_MACROS);
+		dc_trigger_cache_expanded_expressions(dc_trigger, trigger);
 		zbx_timespec(&trigger->timespec);
 		trigger->flags = flags;
 
@@ -6717,7 +8244,7 @@ void	DCconfig_update_interface_snmp_stats(zbx_uint64_t interfaceid, int max_snmp
 {
 	ZBX_DC_INTERFACE	*dc_interface;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (NULL != (dc_interface = zbx_hashset_search(&config->interfaces, &interfaceid)) &&
 			SNMP_BULK_ENABLED == dc_interface->bulk)
@@ -6770,7 +8297,7 @@ int	DCconfig_get_suggested_snmp_vars(zbx_uint64_t interfaceid, int *bulk)
 {
 	int	ret;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	ret = DCconfig_get_suggested_snmp_vars_nolock(interfaceid, bulk);
 
@@ -6815,7 +8342,7 @@ int	DCconfig_get_interface_by_type(DC_INTERFACE *interface, zbx_uint64_t hostid,
 {
 	int	res;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	res = dc_get_interface_by_type(interface, hostid, type);
 
@@ -6844,7 +8371,7 @@ int	DCconfig_get_interface(DC_INTERFACE *interface, zbx_uint64_t hostid, zbx_uin
 	ZBX_DC_ITEM		*dc_item;
 	const ZBX_DC_INTERFACE	*dc_interface;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (0 != itemid)
 	{
@@ -6933,7 +8460,7 @@ int	DCconfig_get_poller_nextcheck(unsigned char poller_type)
 
 	queue = &config->queues[poller_type];
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	nextcheck = dc_config_get_queue_nextcheck(queue);
 
@@ -6991,7 +8518,7 @@ int	DCconfig_get_poller_items(unsigned char poller_type, DC_ITEM *items)
 			max_items = 1;
 	}
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	while (num < max_items && FAIL == zbx_binary_heap_empty(queue))
 	{
@@ -7137,7 +8664,7 @@ int	DCconfig_get_snmp_interfaceids_by_addr(const char *addr, zbx_uint64_t **inte
 
 	dc_interface_snmpaddr_local.addr = addr;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (NULL == (dc_interface_snmpaddr = zbx_hashset_search(&config->interface_snmpaddrs, &dc_interface_snmpaddr_local)))
 		goto unlock;
@@ -7180,7 +8707,7 @@ size_t	DCconfig_get_snmp_items_by_interfaceid(zbx_uint64_t interfaceid, DC_ITEM
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() interfaceid:" ZBX_FS_UI64, __function_name, interfaceid);
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (NULL == (dc_interface = zbx_hashset_search(&config->interfaces, &interfaceid)))
 		goto unlock;
@@ -7333,7 +8860,7 @@ static void	dc_requeue_items(zbx_uint64_t *itemids, unsigned char *states, int *
 void	DCrequeue_items(zbx_uint64_t *itemids, unsigned char *states, int *lastclocks, zbx_uint64_t *lastlogsizes,
 		int *mtimes, int *errcodes, size_t num)
 {
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	dc_requeue_items(itemids, states, lastclocks, lastlogsizes, mtimes, errcodes, num);
 
@@ -7343,7 +8870,7 @@ void	DCrequeue_items(zbx_uint64_t *itemids, unsigned char *states, int *lastcloc
 void	DCpoller_requeue_items(zbx_uint64_t *itemids, unsigned char *states, int *lastclocks, zbx_uint64_t *lastlogsizes,
 		int *mtimes, int *errcodes, size_t num, unsigned char poller_type, int *nextcheck)
 {
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	dc_requeue_items(itemids, states, lastclocks, lastlogsizes, mtimes, errcodes, num);
 	*nextcheck = dc_config_get_queue_nextcheck(&config->queues[poller_type]);
@@ -7693,7 +9220,7 @@ int	DChost_activate(zbx_uint64_t hostid, unsigned char agent_type, const zbx_tim
 	if (0 == in->errors_from && HOST_AVAILABLE_TRUE == in->available)
 		goto out;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (NULL == (dc_host = zbx_hashset_search(&config->hosts, &hostid)))
 		goto unlock;
@@ -7755,7 +9282,7 @@ int	DChost_deactivate(zbx_uint64_t hostid, unsigned char agent_type, const zbx_t
 	if (CONFIG_UNREACHABLE_DELAY > ts->sec - in->errors_from)
 		goto out;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (NULL == (dc_host = zbx_hashset_search(&config->hosts, &hostid)))
 		goto unlock;
@@ -7839,7 +9366,7 @@ int	DCset_hosts_availability(zbx_vector_ptr_t *availabilities)
 
 	now = time(NULL);
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < availabilities->values_num; i++)
 	{
@@ -7952,7 +9479,7 @@ int	DCconfig_check_trigger_dependencies(zbx_uint64_t triggerid)
 	int				ret = SUCCEED;
 	const ZBX_DC_TRIGGER_DEPLIST	*trigdep;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (NULL != (trigdep = zbx_hashset_search(&config->trigdeps, &triggerid)))
 		ret = DCconfig_check_trigger_dependencies_rec(trigdep, 0, NULL, NULL);
@@ -8056,7 +9583,7 @@ void	DCconfig_triggers_apply_changes(zbx_vector_ptr_t *trigger_diff)
 	zbx_trigger_diff_t	*diff;
 	ZBX_DC_TRIGGER		*dc_trigger;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < trigger_diff->values_num; i++)
 	{
@@ -8098,7 +9625,7 @@ void	DCconfig_set_maintenance(const zbx_uint64_t *hostids, int hostids_num, int
 
 	now = time(NULL);
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < hostids_num; i++)
 	{
@@ -8165,6 +9692,138 @@ void	*DCconfig_get_stats(int request)
 	}
 }
 
+#define ZBX_DC_STRPOOL_REPORT_TOP	10
+
+#define DC_HASHSET_USAGE(usage, hashset, type)							\
+	zbx_mem_usage_add(usage, #hashset, config->hashset.num_data,				\
+			zbx_mem_hashset_size(config_mem, &config->hashset, sizeof(type)))
+
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_get_memory_usage                                              *
+ *                                                                            *
+ * Purpose: get memory used by configuration cache structures                 *
+ *                                                                            *
+ * Parameters: usage - [OUT] the memory usage vector                          *
+ *                                                                            *
+ * Comments: The structure sizes are estimated from the number of objects and *
+ *           shared memory allocator overhead. The memory used by object      *
+ *           vectors and other dynamic data is reported as "other". The       *
+ *           strings are kept in separate string pool memory segment.         *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_get_memory_usage(zbx_vector_ptr_t *usage)
+{
+	zbx_uint64_t		queue_bytes, queue_num;
+	int			i, strings_num, strings_slots;
+
+	DC_HASHSET_USAGE(usage, items, ZBX_DC_ITEM);
+	DC_HASHSET_USAGE(usage, items_hk, ZBX_DC_ITEM_HK);
+	DC_HASHSET_USAGE(usage, numitems, ZBX_DC_NUMITEM);
+	DC_HASHSET_USAGE(usage, snmpitems, ZBX_DC_SNMPITEM);
+	DC_HASHSET_USAGE(usage, ipmiitems, ZBX_DC_IPMIITEM);
+	DC_HASHSET_USAGE(usage, flexitems, ZBX_DC_FLEXITEM);
+	DC_HASHSET_USAGE(usage, trapitems, ZBX_DC_TRAPITEM);
+	DC_HASHSET_USAGE(usage, logitems, ZBX_DC_LOGITEM);
+	DC_HASHSET_USAGE(usage, dbitems, ZBX_DC_DBITEM);
+	DC_HASHSET_USAGE(usage, sshitems, ZBX_DC_SSHITEM);
+	DC_HASHSET_USAGE(usage, telnetitems, ZBX_DC_TELNETITEM);
+	DC_HASHSET_USAGE(usage, simpleitems, ZBX_DC_SIMPLEITEM);
+	DC_HASHSET_USAGE(usage, jmxitems, ZBX_DC_JMXITEM);
+	DC_HASHSET_USAGE(usage, calcitems, ZBX_DC_CALCITEM);
+	DC_HASHSET_USAGE(usage, functions, ZBX_DC_FUNCTION);
+	DC_HASHSET_USAGE(usage, triggers, ZBX_DC_TRIGGER);
+	DC_HASHSET_USAGE(usage, trigdeps, ZBX_DC_TRIGGER_DEPLIST);
+	DC_HASHSET_USAGE(usage, hosts, ZBX_DC_HOST);
+	DC_HASHSET_USAGE(usage, hosts_h, ZBX_DC_HOST_H);
+	DC_HASHSET_USAGE(usage, hosts_p, ZBX_DC_HOST_H);
+	DC_HASHSET_USAGE(usage, proxies, ZBX_DC_PROXY);
+	DC_HASHSET_USAGE(usage, host_inventories, ZBX_DC_HOST_INVENTORY);
+	DC_HASHSET_USAGE(usage, ipmihosts, ZBX_DC_IPMIHOST);
+	DC_HASHSET_USAGE(usage, htmpls, ZBX_DC_HTMPL);
+	DC_HASHSET_USAGE(usage, gmacros, ZBX_DC_GMACRO);
+	DC_HASHSET_USAGE(usage, gmacros_m, ZBX_DC_GMACRO_M);
+	DC_HASHSET_USAGE(usage, hmacros, ZBX_DC_HMACRO);
+	DC_HASHSET_USAGE(usage, hmacros_hm, ZBX_DC_HMACRO_HM);
+	DC_HASHSET_USAGE(usage, interfaces, ZBX_DC_INTERFACE);
+	DC_HASHSET_USAGE(usage, interfaces_ht, ZBX_DC_INTERFACE_HT);
+	DC_HASHSET_USAGE(usage, interface_snmpaddrs, ZBX_DC_INTERFACE_ADDR);
+	DC_HASHSET_USAGE(usage, interface_snmpitems, ZBX_DC_INTERFACE_ITEM);
+	DC_HASHSET_USAGE(usage, regexps, ZBX_DC_REGEXP);
+	DC_HASHSET_USAGE(usage, expressions, ZBX_DC_EXPRESSION);
+	DC_HASHSET_USAGE(usage, actions, zbx_dc_action_t);
+	DC_HASHSET_USAGE(usage, action_conditions, zbx_dc_action_condition_t);
+	DC_HASHSET_USAGE(usage, trigger_tags, zbx_dc_trigger_tag_t);
+	DC_HASHSET_USAGE(usage, correlations, zbx_dc_correlation_t);
+	DC_HASHSET_USAGE(usage, corr_conditions, zbx_dc_corr_condition_t);
+	DC_HASHSET_USAGE(usage, corr_operations, zbx_dc_corr_operation_t);
+	DC_HASHSET_USAGE(usage, hostgroups, zbx_dc_hostgroup_t);
+#if defined(HAVE_POLARSSL) || defined(HAVE_GNUTLS) || defined(HAVE_OPENSSL)
+	DC_HASHSET_USAGE(usage, psks, ZBX_DC_PSK);
+#endif
+	queue_bytes = zbx_mem_binary_heap_size(config_mem, &config->pqueue);
+	queue_num = config->pqueue.elems_num;
+
+	for (i = 0; i < ZBX_POLLER_TYPE_COUNT; i++)
+	{
+		queue_bytes += zbx_mem_binary_heap_size(config_mem, &config->queues[i]);
+		queue_num += config->queues[i].elems_num;
+	}
+
+	zbx_mem_usage_add(usage, "queues", queue_num, queue_bytes);
+	zbx_mem_usage_add_other(usage, zbx_mem_used_size(config_mem));
+
+	zbx_strpool_get_counts(&strings_num, &strings_slots);
+	zbx_mem_usage_add(usage, "strings", strings_num, zbx_mem_used_size(zbx_strpool_info()->mem_info));
+}
+
+#undef DC_HASHSET_USAGE
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCconfig_get_memory_usage                                        *
+ *                                                                            *
+ * Purpose: get memory used by configuration cache structures                 *
+ *                                                                            *
+ * Parameters: usage - [OUT] the memory usage vector                          *
+ *                                                                            *
+ ******************************************************************************/
+void	DCconfig_get_memory_usage(zbx_vector_ptr_t *usage)
+{
+	RDLOCK_CACHE;
+
+	dc_get_memory_usage(usage);
+
+	UNLOCK_CACHE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: DCconfig_log_memory_usage                                        *
+ *                                                                            *
+ * Purpose: write configuration cache memory usage report to log              *
+ *                                                                            *
+ ******************************************************************************/
+void	DCconfig_log_memory_usage(void)
+{
+	zbx_vector_ptr_t	usage;
+
+	zbx_vector_ptr_create(&usage);
+
+	RDLOCK_CACHE;
+
+	dc_get_memory_usage(&usage);
+	zbx_mem_usage_log("configuration cache", &usage);
+	zbx_strpool_log_top(ZBX_DC_STRPOOL_REPORT_TOP);
+	zbx_mem_log_stats(config_mem);
+	zbx_mem_log_stats(zbx_strpool_info()->mem_info);
+
+	UNLOCK_CACHE;
+
+	zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	zbx_vector_ptr_destroy(&usage);
+}
+
 static void	DCget_proxy(DC_PROXY *dst_proxy, ZBX_DC_PROXY *src_proxy)
 {
 	ZBX_DC_HOST		*host;
@@ -8259,7 +9918,7 @@ int	DCconfig_get_proxypoller_hosts(DC_PROXY *proxies, int max_hosts)
 
 	queue = &config->pqueue;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	while (num < max_hosts && FAIL == zbx_binary_heap_empty(queue))
 	{
@@ -8308,7 +9967,7 @@ int	DCconfig_get_proxypoller_nextcheck(void)
 
 	queue = &config->pqueue;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (FAIL == zbx_binary_heap_empty(queue))
 	{
@@ -8343,7 +10002,7 @@ void	DCrequeue_proxy(zbx_uint64_t hostid, unsigned char update_nextcheck)
 
 	now = time(NULL);
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (NULL != (dc_host = zbx_hashset_search(&config->hosts, &hostid)) &&
 			NULL != (dc_proxy = zbx_hashset_search(&config->proxies, &hostid)))
@@ -8363,6 +10022,11 @@ void	DCrequeue_proxy(zbx_uint64_t hostid, unsigned char update_nextcheck)
 				dc_proxy->proxy_data_nextcheck = (int)calculate_proxy_nextcheck(
 						hostid, CONFIG_PROXYDATA_FREQUENCY, now);
 			}
+			else if (0 != (update_nextcheck & ZBX_PROXY_DATA_BACKLOG))
+			{
+				/* the proxy has more data, poll it again after the proxies that are already due */
+				dc_proxy->proxy_data_nextcheck = (int)now;
+			}
 
 			DCupdate_proxy_queue(dc_proxy);
 		}
@@ -8437,7 +10101,7 @@ void	DCconfig_set_proxy_timediff(zbx_uint64_t hostid, const zbx_timespec_t *time
 {
 	ZBX_DC_PROXY	*dc_proxy;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	if (NULL != (dc_proxy = zbx_hashset_search(&config->proxies, &hostid)))
 		dc_proxy->timediff = timediff->sec;
@@ -8579,7 +10243,7 @@ void	DCget_user_macro(zbx_uint64_t *hostids, int hostids_num, const char *macro,
 	if (SUCCEED != zbx_user_macro_parse_dyn(macro, &name, &context, NULL))
 		goto out;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	dc_get_user_macro(hostids, hostids_num, name, context, replace_to);
 
@@ -8732,34 +10396,51 @@ static char	*dc_expression_expand_user_macros(const char *expression, char **err
 
 /******************************************************************************
  *                                                                            *
- * Function: dc_cache_expanded_expression                                     *
+ * Function: dc_get_expanded_expression                                       *
  *                                                                            *
- * Purpose: return expanded trigger expression, caching it if necessary       *
+ * Purpose: return expanded trigger expression                                *
  *                                                                            *
  * Parameters: expression    - [IN] the expression to expand                  *
- *             expression_ex - [IN/OUT] the cached expression                 *
+ *             expression_ex - [IN] the cached expression, can be NULL        *
  *             error         - [OUT] the error message                        *
  *                                                                            *
  * Return value: The expanded expression, NULL in the case of error           *
  *                                                                            *
  * Comments: This function will first try to return a copy of cached          *
  *           expression. If the expression has not been expanded, it will     *
- *           expand the expression, cache it and return the copy of it.       *
+ *           expand the expression without caching it, because configuration  *
+ *           cache might be locked only for reading.                          *
+ *           See dc_trigger_cache_expanded_expressions() function.            *
  *                                                                            *
  ******************************************************************************/
-static char	*dc_cache_expanded_expression(const char *expression, const char **expression_ex, char **error)
+static char	*dc_get_expanded_expression(const char *expression, const char *expression_ex, char **error)
 {
-	char	*out;
-
 	/* expression has already been cached, a copy */
-	if (NULL != *expression_ex)
-		return zbx_strdup(NULL, *expression_ex);
+	if (NULL != expression_ex)
+		return zbx_strdup(NULL, expression_ex);
 
-	/* expand expression and cache it if successful */
-	if (NULL != (out = dc_expression_expand_user_macros(expression, error)))
-		DCstrpool_replace(0, expression_ex, out);
+	return dc_expression_expand_user_macros(expression, error);
+}
 
-	return out;
+/******************************************************************************
+ *                                                                            *
+ * Function: dc_trigger_cache_expanded_expressions                            *
+ *                                                                            *
+ * Purpose: cache trigger expressions expanded by DCget_trigger() function    *
+ *                                                                            *
+ * Parameters: dc_trigger - [IN/OUT] the configuration cache trigger          *
+ *             trigger    - [IN] the trigger with expanded expressions        *
+ *                                                                            *
+ * Comments: Configuration cache must be locked for writing.                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	dc_trigger_cache_expanded_expressions(ZBX_DC_TRIGGER *dc_trigger, const DC_TRIGGER *trigger)
+{
+	if (NULL == dc_trigger->expression_ex && NULL != trigger->expression)
+		DCstrpool_replace(0, &dc_trigger->expression_ex, trigger->expression);
+
+	if (NULL == dc_trigger->recovery_expression_ex && NULL != trigger->recovery_expression)
+		DCstrpool_replace(0, &dc_trigger->recovery_expression_ex, trigger->recovery_expression);
 }
 
 /******************************************************************************
@@ -8783,7 +10464,7 @@ char	*DCexpression_expand_user_macros(const char *expression, char **error)
 {
 	char	*expression_ex;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	expression_ex = dc_expression_expand_user_macros(expression, error);
 
@@ -8792,83 +10473,6 @@ char	*DCexpression_expand_user_macros(const char *expression, char **error)
 	return expression_ex;
 }
 
-/******************************************************************************
- *                                                                            *
- * Function: DCget_delta_items                                                *
- *                                                                            *
- * Purpose: Get a copy of delta item history stored in configuration cache    *
- *                                                                            *
- * Parameters: items - [OUT] the copy of item history                         *
- *             ids   - [IN] a vector of item ids to get the history for       *
- *                                                                            *
- * Comments: The hashset must be created by the caller like:                  *
- *            zbx_hashset_create(items, 1000, ZBX_DEFAULT_UINT64_HASH_FUNC,   *
- *                               ZBX_DEFAULT_UINT64_COMPARE_FUNC)             *
- *                                                                            *
- ******************************************************************************/
-void	DCget_delta_items(zbx_hashset_t *items, const zbx_vector_uint64_t *ids)
-{
-	ZBX_DC_DELTAITEM	*deltaitem;
-	int			i;
-
-	LOCK_CACHE;
-
-	/* only FLOAT and UINT64 value types can be used for delta calculations, */
-	/* so just copying data is safe                                          */
-	for (i = 0; i < ids->values_num; i++)
-	{
-		if (NULL != (deltaitem = zbx_hashset_search(&config->deltaitems, &ids->values[i])))
-			zbx_hashset_insert(items, deltaitem, sizeof(ZBX_DC_DELTAITEM));
-	}
-
-	UNLOCK_CACHE;
-}
-
-/******************************************************************************
- *                                                                            *
- * Function: DCset_delta_items                                                *
- *                                                                            *
- * Purpose: Updates delta item history data in cache                          *
- *                                                                            *
- * Parameters: items - [IN] the new delta item history data. If the timestamp *
- *                          seconds is set to 0 then item history data is     *
- *                          removed from cache.                               *
- *                                                                            *
- ******************************************************************************/
-void	DCset_delta_items(zbx_hashset_t *items)
-{
-	zbx_hashset_iter_t	iter;
-	ZBX_DC_DELTAITEM	*deltaitem, *item;
-
-	zbx_hashset_iter_reset(items, &iter);
-
-	LOCK_CACHE;
-
-	while (NULL != (item = zbx_hashset_iter_next(&iter)))
-	{
-		if (NULL == (deltaitem = zbx_hashset_search(&config->deltaitems, &item->itemid)))
-		{
-			if (0 != item->timestamp.sec)
-				zbx_hashset_insert(&config->deltaitems, item, sizeof(ZBX_DC_DELTAITEM));
-		}
-		else
-		{
-			if (0 != item->timestamp.sec)
-			{
-				if (0 < zbx_timespec_compare(&item->timestamp, &deltaitem->timestamp))
-				{
-					deltaitem->timestamp = item->timestamp;
-					deltaitem->value = item->value;
-				}
-			}
-			else
-				zbx_hashset_remove_direct(&config->deltaitems, deltaitem);
-		}
-	}
-
-	UNLOCK_CACHE;
-}
-
 /******************************************************************************
  *                                                                            *
  * Function: DCfree_item_queue                                                *
@@ -8909,7 +10513,7 @@ int	DCget_item_queue(zbx_vector_ptr_t *queue, int from, int to)
 
 	now = time(NULL);
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->items, &iter);
 
@@ -8998,7 +10602,7 @@ int	DCget_item_count(zbx_uint64_t hostid)
 	zbx_hashset_iter_t	iter;
 	const ZBX_DC_ITEM	*dc_item;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->items, &iter);
 
@@ -9046,7 +10650,7 @@ int	DCget_item_unsupported_count(zbx_uint64_t hostid)
 	zbx_hashset_iter_t	iter;
 	const ZBX_DC_ITEM	*dc_item;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->items, &iter);
 
@@ -9097,7 +10701,7 @@ int	DCget_trigger_count(void)
 	const char		*p, *q;
 	int			count = 0;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->triggers, &iter);
 
@@ -9165,7 +10769,7 @@ int	DCget_host_count(void)
 	zbx_hashset_iter_t	iter;
 	const ZBX_DC_HOST	*dc_host;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->hosts, &iter);
 
@@ -9195,7 +10799,7 @@ double	DCget_required_performance(void)
 	zbx_hashset_iter_t	iter;
 	const ZBX_DC_ITEM	*dc_item;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->items, &iter);
 
@@ -9240,7 +10844,7 @@ void	DCget_expressions_by_names(zbx_vector_ptr_t *expressions, const char * cons
 	ZBX_DC_EXPRESSION	*expression;
 	ZBX_DC_REGEXP		*regexp, search_regexp;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	for (iname = 0; iname < names_num; iname++)
 	{
@@ -9307,7 +10911,7 @@ int	DCget_data_expected_from(zbx_uint64_t itemid, int *seconds)
 	ZBX_DC_HOST	*dc_host;
 	int		ret = FAIL;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (NULL == (dc_item = zbx_hashset_search(&config->items, &itemid)))
 		goto unlock;
@@ -9375,7 +10979,7 @@ void	DCget_hostids_by_functionids(zbx_vector_uint64_t *functionids, zbx_vector_u
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	dc_get_hostids_by_functionids(functionids, hostids);
 
@@ -9400,7 +11004,7 @@ void	DCget_hostids_by_functionids(zbx_vector_uint64_t *functionids, zbx_vector_u
  ******************************************************************************/
 void	zbx_config_get(zbx_config_t *cfg, zbx_uint64_t flags)
 {
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	if (0 != (flags & ZBX_CONFIG_FLAGS_SEVERITY_NAME))
 	{
@@ -9485,7 +11089,7 @@ int	DCreset_hosts_availability(zbx_vector_ptr_t *hosts)
 
 	now = time(NULL);
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->hosts, &iter);
 
@@ -9587,7 +11191,7 @@ int	DCget_hosts_availability(zbx_vector_ptr_t *hosts, int *ts)
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	*ts = time(NULL);
 
@@ -9744,7 +11348,7 @@ void	zbx_dc_get_actions_eval(zbx_vector_ptr_t *actions)
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	zbx_hashset_iter_reset(&config->actions, &iter);
 
@@ -10029,7 +11633,7 @@ void	zbx_dc_correlation_rules_get(zbx_correlation_rules_t *rules)
 	zbx_correlation_t	*correlation;
 	zbx_corr_condition_t	*condition, condition_local;
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	/* The correlation rules are refreshed only if the sync timestamp   */
 	/* does not match current configuration cache sync timestamp. This  */
@@ -10143,7 +11747,7 @@ void	zbx_dc_get_nested_hostgroupids(zbx_uint64_t *groupids, int groupids_num, zb
 {
 	int	i;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < groupids_num; i++)
 		dc_get_nested_hostgroupids(groupids[i], nested_groupids);
@@ -10169,7 +11773,7 @@ void	zbx_dc_get_nested_hostgroupids_by_names(char **names, int names_num, zbx_ve
 {
 	int	i, index;
 
-	LOCK_CACHE;
+	WRLOCK_CACHE;
 
 	for (i = 0; i < names_num; i++)
 	{
@@ -10221,7 +11825,7 @@ void	zbx_dc_get_trigger_dependencies(const zbx_vector_uint64_t *triggerids, zbx_
 	zbx_vector_uint64_create(&masterids);
 	zbx_vector_uint64_reserve(&masterids, 64);
 
-	LOCK_CACHE;
+	RDLOCK_CACHE;
 
 	for (i = 0; i < triggerids->values_num; i++)
 	{
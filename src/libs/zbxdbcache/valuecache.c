@@ -3163,6 +3163,66 @@ int	zbx_vc_get_statistics(zbx_vc_stats_t *stats)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_vc_get_memory_usage                                          *
+ *                                                                            *
+ * Purpose: get memory used by value cache structures                         *
+ *                                                                            *
+ * Parameters: usage - [OUT] the memory usage vector                          *
+ *                                                                            *
+ * Return value: SUCCEED - the memory usage was retrieved                     *
+ *               FAIL    - the value cache is disabled                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vc_get_memory_usage(zbx_vector_ptr_t *usage)
+{
+	zbx_hashset_iter_t	iter;
+	zbx_vc_item_t		*item;
+	const zbx_vc_chunk_t	*chunk;
+	const char		*record;
+	zbx_uint64_t		chunks_num = 0, chunks_size = 0, strings_size;
+
+	if (NULL == vc_cache)
+		return FAIL;
+
+	vc_try_lock();
+
+	zbx_mem_usage_add(usage, "items", vc_cache->items.num_data,
+			zbx_mem_hashset_size(vc_mem, &vc_cache->items, sizeof(zbx_vc_item_t)));
+
+	zbx_hashset_iter_reset(&vc_cache->items, &iter);
+
+	while (NULL != (item = (zbx_vc_item_t *)zbx_hashset_iter_next(&iter)))
+	{
+		for (chunk = item->tail; NULL != chunk; chunk = chunk->next)
+		{
+			chunks_num++;
+			chunks_size += zbx_mem_chunk_size(vc_mem, sizeof(zbx_vc_chunk_t) +
+					sizeof(zbx_history_record_t) * (chunk->slots_num - 1));
+		}
+	}
+
+	zbx_mem_usage_add(usage, "chunks", chunks_num, chunks_size);
+
+	strings_size = zbx_mem_chunk_size(vc_mem, vc_cache->strpool.num_slots * sizeof(ZBX_HASHSET_ENTRY_T *));
+
+	zbx_hashset_iter_reset(&vc_cache->strpool, &iter);
+
+	while (NULL != (record = (const char *)zbx_hashset_iter_next(&iter)))
+	{
+		strings_size += zbx_mem_chunk_size(vc_mem, offsetof(ZBX_HASHSET_ENTRY_T, data) + REFCOUNT_FIELD_SIZE +
+				strlen(record + REFCOUNT_FIELD_SIZE) + 1);
+	}
+
+	zbx_mem_usage_add(usage, "strings", vc_cache->strpool.num_data, strings_size);
+	zbx_mem_usage_add_other(usage, zbx_mem_used_size(vc_mem));
+
+	vc_try_unlock();
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_history_record_vector_destroy                                *
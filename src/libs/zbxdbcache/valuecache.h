@@ -99,6 +99,7 @@ int	zbx_vc_get_value(zbx_uint64_t itemid, int value_type, const zbx_timespec_t *
 int	zbx_vc_add_value(zbx_uint64_t itemid, int value_type, const zbx_timespec_t *timestamp, history_value_t *value);
 
 int	zbx_vc_get_statistics(zbx_vc_stats_t *stats);
+int	zbx_vc_get_memory_usage(zbx_vector_ptr_t *usage);
 
 void	zbx_history_record_vector_destroy(zbx_vector_history_record_t *vector, int value_type);
 
@@ -29,6 +29,7 @@
 #define ODBC_ERR_MSG_LEN	255
 
 static char	zbx_last_odbc_strerror[ODBC_ERR_MSG_LEN];
+static char	zbx_last_odbc_sqlstate[SQL_SQLSTATE_SIZE + 1];
 
 const char	*get_last_odbc_strerror(void)
 {
@@ -51,7 +52,7 @@ static void	__zbx_set_last_odbc_strerror(const char *fmt, ...)
 	va_end(args);
 }
 
-#define clean_odbc_strerror()	zbx_last_odbc_strerror[0] = '\0'
+#define clean_odbc_strerror()	zbx_last_odbc_strerror[0] = zbx_last_odbc_sqlstate[0] = '\0'
 
 static void	odbc_free_row_data(ZBX_ODBC_DBH *pdbh)
 {
@@ -117,6 +118,10 @@ static int	odbc_Diag(SQLSMALLINT h_type, SQLHANDLE h, SQLRETURN sql_rc, const ch
 			zabbix_log(LOG_LEVEL_DEBUG, "%s(): rc_msg:'%s' rec_nr:%d sql_state:'%s' native_err_code:%ld "
 					"err_msg:'%s'", __function_name, rc_msg, rec_nr, sql_state,
 					(long)native_err_code, err_msg);
+
+			if (1 == rec_nr)
+				zbx_strlcpy(zbx_last_odbc_sqlstate, (const char *)sql_state, sizeof(zbx_last_odbc_sqlstate));
+
 			if (sizeof(diag_msg) > offset)
 			{
 				offset += zbx_snprintf(diag_msg + offset, sizeof(diag_msg) - offset, "[%s][%ld][%s]|",
@@ -357,6 +362,9 @@ ZBX_ODBC_RESULT	odbc_DBselect(ZBX_ODBC_DBH *pdbh, char *query)
 
 	odbc_free_row_data(pdbh);
 
+	/* close the cursor left open by the previous query on a reused connection */
+	SQLFreeStmt(pdbh->hstmt, SQL_CLOSE);
+
 	if (0 != CALLODBC(SQLExecDirect(pdbh->hstmt, (SQLCHAR *)query, SQL_NTS), rc, SQL_HANDLE_STMT, pdbh->hstmt,
 			"Cannot execute ODBC query"))
 	{
@@ -381,4 +389,53 @@ end:
 	return result;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: odbc_DBconnection_alive                                          *
+ *                                                                            *
+ * Purpose: check whether an idle connection can still be used                *
+ *                                                                            *
+ * Parameters: pdbh - [IN] the connection                                     *
+ *                                                                            *
+ * Return value: SUCCEED - the connection is alive or the driver cannot tell  *
+ *               FAIL    - the driver reports the connection as dead          *
+ *                                                                            *
+ * Comments: SQL_ATTR_CONNECTION_DEAD is checked by the driver without a      *
+ *           round trip to the database.                                      *
+ *                                                                            *
+ ******************************************************************************/
+int	odbc_DBconnection_alive(ZBX_ODBC_DBH *pdbh)
+{
+#ifdef SQL_ATTR_CONNECTION_DEAD
+	SQLUINTEGER	dead = SQL_CD_FALSE;
+
+	if (0 != SQL_SUCCEEDED(SQLGetConnectAttr(pdbh->hdbc, SQL_ATTR_CONNECTION_DEAD, &dead, 0, NULL)) &&
+			SQL_CD_TRUE == dead)
+	{
+		return FAIL;
+	}
+#endif
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: odbc_DBconnection_lost                                           *
+ *                                                                            *
+ * Purpose: check whether the last ODBC call failed because the connection to *
+ *          the database was lost                                             *
+ *                                                                            *
+ * Return value: SUCCEED - the last error is a connection exception (SQLSTATE *
+ *                         class 08) or a connection timeout                  *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	odbc_DBconnection_lost(void)
+{
+	if (0 == strncmp(zbx_last_odbc_sqlstate, "08", 2) || 0 == strcmp(zbx_last_odbc_sqlstate, "HYT01"))
+		return SUCCEED;
+
+	return FAIL;
+}
+
 #endif	/* HAVE_UNIXODBC */
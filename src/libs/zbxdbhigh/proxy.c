@@ -27,10 +27,41 @@
 #include "dbcache.h"
 #include "discovery.h"
 #include "zbxalgo.h"
+#include "md5.h"
 #include "../zbxcrypto/tls_tcp_active.h"
 
 extern unsigned int	configured_tls_accept_modes;
 
+/* Configuration tables are split into buckets by record identifiers. Proxy reports digests of the buckets of its */
+/* configuration copy and server sends only the records of the buckets that differ.                               */
+#define ZBX_PROXYCONFIG_BUCKET_ROWS	32
+#define ZBX_PROXYCONFIG_BUCKETS_MAX	4096
+#define ZBX_PROXYCONFIG_DIGEST_SIZE	8	/* the reported part of bucket MD5 digest, in bytes */
+
+static const char	*proxytable[] =
+{
+	"globalmacro",
+	"hosts",
+	"interface",
+	"hosts_templates",
+	"hostmacro",
+	"items",
+	"drules",
+	"dchecks",
+	"regexps",
+	"expressions",
+	"groups",
+	"config",
+	"httptest",
+	"httptestitem",
+	"httpstep",
+	"httpstepitem",
+	NULL
+};
+
+/* the last update of local configuration copy failed, the whole configuration must be requested */
+static int	proxyconfig_resync = 0;
+
 typedef struct
 {
 	const char		*field;
@@ -202,23 +233,229 @@ void	update_proxy_lastaccess(const zbx_uint64_t hostid, time_t last_access)
 	DBexecute("update hosts set lastaccess=%d where hostid=" ZBX_FS_UI64, last_access, hostid);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_field_local                                          *
+ *                                                                            *
+ * Purpose: checks whether proxy keeps its own value of configuration field   *
+ *                                                                            *
+ * Comments: such fields are not updated from server and are left out of     *
+ *           configuration digests                                            *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxyconfig_field_local(const ZBX_TABLE *table, const ZBX_FIELD *field)
+{
+	if (0 != strcmp(table->table, "items"))
+		return FAIL;
+
+	if (0 != strcmp(field->name, "lastlogsize") && 0 != strcmp(field->name, "mtime"))
+		return FAIL;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxyconfig_hash_record                                          *
+ *                                                                            *
+ * Purpose: adds configuration record to the digest of its bucket             *
+ *                                                                            *
+ * Parameters: state - [IN/OUT] the bucket digest                             *
+ *             table - [IN] the configuration table                           *
+ *             row   - [IN] the record identifier followed by the fields      *
+ *                          sent to proxies                                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxyconfig_hash_record(md5_state_t *state, const ZBX_TABLE *table, DB_ROW row)
+{
+	int	f, fld;
+
+	zbx_md5_append(state, (const md5_byte_t *)row[0], (int)strlen(row[0]) + 1);
+
+	for (f = 0, fld = 1; 0 != table->fields[f].name; f++)
+	{
+		if (0 == (table->fields[f].flags & ZBX_PROXY))
+			continue;
+
+		if (SUCCEED != proxyconfig_field_local(table, &table->fields[f]))
+		{
+			if (SUCCEED == DBis_null(row[fld]))
+				zbx_md5_append(state, (const md5_byte_t *)"\1", 1);
+			else
+				zbx_md5_append(state, (const md5_byte_t *)row[fld], (int)strlen(row[fld]) + 1);
+		}
+
+		fld++;
+	}
+}
+
+static void	proxyconfig_digest_string(md5_state_t *state, char *digest_str)
+{
+	md5_byte_t	digest[MD5_DIGEST_SIZE];
+	int		i;
+
+	zbx_md5_finish(state, digest);
+
+	for (i = 0; i < ZBX_PROXYCONFIG_DIGEST_SIZE; i++)
+		zbx_snprintf(digest_str + i * 2, 3, "%02x", digest[i]);
+}
+
+static int	proxyconfig_item_skipped(DB_ROW row, int fld_type, int fld_key)
+{
+	unsigned char	type;
+
+	ZBX_STR2UCHAR(type, row[fld_type]);
+
+	return is_item_processed_by_server(type, row[fld_key]);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_proxyconfig_changes                                          *
+ *                                                                            *
+ * Purpose: find buckets of configuration table that differ from the proxy    *
+ *          copy                                                              *
+ *                                                                            *
+ * Parameters: table     - [IN] the configuration table                       *
+ *             jp_digest - [IN] the bucket digests reported by proxy          *
+ *             sql       - [IN] the query of table records sent to proxy,     *
+ *                              NULL if there are none                        *
+ *             fld_type  - [IN] the item type field number (items table)     *
+ *             fld_key   - [IN] the item key field number (items table)      *
+ *             buckets   - [OUT] the buckets that differ                      *
+ *             recids    - [OUT] the records in the buckets that differ       *
+ *                                                                            *
+ * Return value: The number of buckets the table is split into or 0 if the    *
+ *               whole table must be sent.                                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_proxyconfig_changes(const ZBX_TABLE *table, const struct zbx_json_parse *jp_digest,
+		const char *sql, int fld_type, int fld_key, zbx_vector_uint64_t *buckets, zbx_vector_uint64_t *recids)
+{
+	const char		*__function_name = "get_proxyconfig_changes";
+
+	struct zbx_json_parse	jp_table;
+	const char		*p = NULL;
+	char			digest[ZBX_PROXYCONFIG_DIGEST_SIZE * 2 + 1], (*digests)[sizeof(digest)];
+	md5_state_t		*states;
+	int			i, buckets_num;
+	zbx_uint64_t		recid;
+	zbx_vector_uint64_t	ids;
+	DB_RESULT		result;
+	DB_ROW			row;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() table:'%s'", __function_name, table->table);
+
+	if (SUCCEED != zbx_json_brackets_by_name(jp_digest, table->table, &jp_table))
+	{
+		buckets_num = 0;
+		goto out;
+	}
+
+	if (0 == (buckets_num = zbx_json_count(&jp_table)) || ZBX_PROXYCONFIG_BUCKETS_MAX < buckets_num)
+	{
+		buckets_num = 0;
+		goto out;
+	}
+
+	digests = zbx_malloc(NULL, sizeof(*digests) * buckets_num);
+	states = zbx_malloc(NULL, sizeof(md5_state_t) * buckets_num);
+
+	for (i = 0; i < buckets_num && NULL != (p = zbx_json_next_value(&jp_table, p, digests[i],
+			sizeof(digests[i]), NULL)); i++)
+	{
+		zbx_md5_init(&states[i]);
+	}
+
+	zbx_vector_uint64_create(&ids);
+
+	if (i != buckets_num || (NULL != sql && NULL == (result = DBselect("%s", sql))))
+	{
+		buckets_num = 0;
+		goto clean;
+	}
+
+	if (NULL != sql)
+	{
+		while (NULL != (row = DBfetch(result)))
+		{
+			if (-1 != fld_type && SUCCEED == proxyconfig_item_skipped(row, fld_type, fld_key))
+				continue;
+
+			ZBX_STR2UINT64(recid, row[0]);
+
+			proxyconfig_hash_record(&states[recid % (zbx_uint64_t)buckets_num], table, row);
+			zbx_vector_uint64_append(&ids, recid);
+		}
+		DBfree_result(result);
+	}
+
+	for (i = 0; i < buckets_num; i++)
+	{
+		proxyconfig_digest_string(&states[i], digest);
+
+		if (0 != strcmp(digest, digests[i]))
+			zbx_vector_uint64_append(buckets, (zbx_uint64_t)i);
+	}
+
+	/* it is cheaper to send the whole table than to select most of its records by identifiers */
+	if (buckets->values_num * 2 > buckets_num)
+	{
+		zbx_vector_uint64_clear(buckets);
+		buckets_num = 0;
+		goto clean;
+	}
+
+	for (i = 0; i < ids.values_num; i++)
+	{
+		if (FAIL != zbx_vector_uint64_bsearch(buckets, ids.values[i] % (zbx_uint64_t)buckets_num,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+		{
+			zbx_vector_uint64_append(recids, ids.values[i]);
+		}
+	}
+clean:
+	zbx_vector_uint64_destroy(&ids);
+	zbx_free(states);
+	zbx_free(digests);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() buckets:%d changed:%d records:%d", __function_name, buckets_num,
+			buckets->values_num, recids->values_num);
+
+	return buckets_num;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: get_proxyconfig_table                                            *
  *                                                                            *
  * Purpose: prepare proxy configuration data                                  *
  *                                                                            *
+ * Parameters: proxy_hostid - [IN] the proxy                                  *
+ *             jp_digest    - [IN] the digests of proxy configuration copy,   *
+ *                                 NULL to send the whole table               *
+ *             j            - [OUT] the configuration data                    *
+ *             table        - [IN] the configuration table                    *
+ *             hosts        - [IN] the hosts monitored by proxy               *
+ *             httptests    - [IN] the web scenarios monitored by proxy       *
+ *                                                                            *
+ * Comments: When proxy reported the digests of the table, only the records   *
+ *           of the buckets that differ are sent, followed by the list of     *
+ *           these buckets. The table is left out if nothing differs.         *
+ *                                                                            *
  ******************************************************************************/
-static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j, const ZBX_TABLE *table,
-		zbx_vector_uint64_t *hosts, zbx_vector_uint64_t *httptests)
+static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, const struct zbx_json_parse *jp_digest,
+		struct zbx_json *j, const ZBX_TABLE *table, zbx_vector_uint64_t *hosts, zbx_vector_uint64_t *httptests)
 {
 	const char		*__function_name = "get_proxyconfig_table";
 
-	char			*sql = NULL;
-	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0;
-	int			f, fld, fld_type = -1, fld_key = -1, ret = SUCCEED;
+	char			*sql = NULL, *recid_field;
+	const char		*sql_cond = " where";
+	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset = 0, select_offset;
+	int			f, fld, fld_type = -1, fld_key = -1, buckets_num = 0, no_data = 0, i, ret = SUCCEED;
 	DB_RESULT		result;
 	DB_ROW			row;
+	zbx_vector_uint64_t	buckets, recids;
 	static const ZBX_TABLE	*table_items = NULL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() proxy_hostid:" ZBX_FS_UI64 " table:'%s'",
@@ -227,15 +464,13 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 	if (NULL == table_items)
 		table_items = DBget_table("items");
 
-	zbx_json_addobject(j, table->table);
-	zbx_json_addarray(j, "fields");
+	zbx_vector_uint64_create(&buckets);
+	zbx_vector_uint64_create(&recids);
 
 	sql = zbx_malloc(sql, sql_alloc);
 
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, "select t.%s", table->recid);
 
-	zbx_json_addstring(j, NULL, table->recid, ZBX_JSON_TYPE_STRING);
-
 	for (f = 0, fld = 1; 0 != table->fields[f].name; f++)
 	{
 		if (0 == (table->fields[f].flags & ZBX_PROXY))
@@ -244,17 +479,15 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, ",t.");
 		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, table->fields[f].name);
 
-		zbx_json_addstring(j, NULL, table->fields[f].name, ZBX_JSON_TYPE_STRING);
-
 		if (table == table_items)
 		{
 			if (0 == strcmp(table->fields[f].name, "type"))
 				fld_type = fld;
 			else if (0 == strcmp(table->fields[f].name, "key_"))
 				fld_key = fld;
-
-			fld++;
 		}
+
+		fld++;
 	}
 
 	if (table == table_items && (-1 == fld_type || -1 == fld_key))
@@ -263,19 +496,21 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 		exit(EXIT_FAILURE);
 	}
 
-	zbx_json_close(j);	/* fields */
-
-	zbx_json_addarray(j, "data");
-
 	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " from %s t", table->table);
 
 	if (SUCCEED == str_in_list("hosts,interface,hosts_templates,hostmacro", table->table, ','))
 	{
 		if (0 == hosts->values_num)
-			goto skip_data;
-
-		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
-		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "t.hostid", hosts->values, hosts->values_num);
+		{
+			no_data = 1;
+		}
+		else
+		{
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
+			DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "t.hostid", hosts->values,
+					hosts->values_num);
+		}
+		sql_cond = " and";
 	}
 	else if (table == table_items)
 	{
@@ -290,6 +525,7 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 				ITEM_TYPE_SNMPv3, ITEM_TYPE_IPMI, ITEM_TYPE_TRAPPER, ITEM_TYPE_SIMPLE,
 				ITEM_TYPE_HTTPTEST, ITEM_TYPE_EXTERNAL, ITEM_TYPE_DB_MONITOR, ITEM_TYPE_SSH,
 				ITEM_TYPE_TELNET, ITEM_TYPE_JMX, ITEM_TYPE_SNMPTRAP, ITEM_TYPE_INTERNAL);
+		sql_cond = " and";
 	}
 	else if (0 == strcmp(table->table, "drules"))
 	{
@@ -297,6 +533,7 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 				" where t.proxy_hostid=" ZBX_FS_UI64
 					" and t.status=%d",
 				proxy_hostid, DRULE_STATUS_MONITORED);
+		sql_cond = " and";
 	}
 	else if (0 == strcmp(table->table, "dchecks"))
 	{
@@ -305,35 +542,93 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 					" and r.proxy_hostid=" ZBX_FS_UI64
 					" and r.status=%d",
 				proxy_hostid, DRULE_STATUS_MONITORED);
+		sql_cond = " and";
 	}
 	else if (0 == strcmp(table->table, "groups"))
 	{
 		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, ",config r where t.groupid=r.discovery_groupid");
+		sql_cond = " and";
 	}
 	else if (SUCCEED == str_in_list("httptest,httptestitem,httpstep", table->table, ','))
 	{
 		if (0 == httptests->values_num)
-			goto skip_data;
-
-		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
-		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "t.httptestid",
-				httptests->values, httptests->values_num);
+		{
+			no_data = 1;
+		}
+		else
+		{
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " where");
+			DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "t.httptestid",
+					httptests->values, httptests->values_num);
+		}
+		sql_cond = " and";
 	}
 	else if (0 == strcmp(table->table, "httpstepitem"))
 	{
 		if (0 == httptests->values_num)
-			goto skip_data;
-
-		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
-				",httpstep r where t.httpstepid=r.httpstepid"
-					" and");
-		DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "r.httptestid",
-				httptests->values, httptests->values_num);
+		{
+			no_data = 1;
+		}
+		else
+		{
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset,
+					",httpstep r where t.httpstepid=r.httpstepid"
+						" and");
+			DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, "r.httptestid",
+					httptests->values, httptests->values_num);
+		}
+		sql_cond = " and";
 	}
 
+	select_offset = sql_offset;
+
 	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " order by t.");
 	zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, table->recid);
 
+	if (NULL != jp_digest && 0 != (buckets_num = get_proxyconfig_changes(table, jp_digest,
+			0 == no_data ? sql : NULL, fld_type, fld_key, &buckets, &recids)))
+	{
+		if (0 == buckets.values_num)
+			goto out;
+
+		if (0 == recids.values_num)
+		{
+			/* the records of these buckets were removed */
+			no_data = 1;
+		}
+		else
+		{
+			sql_offset = select_offset;
+
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, sql_cond);
+			recid_field = zbx_dsprintf(NULL, "t.%s", table->recid);
+			DBadd_condition_alloc(&sql, &sql_alloc, &sql_offset, recid_field, recids.values,
+					recids.values_num);
+			zbx_free(recid_field);
+
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, " order by t.");
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, table->recid);
+		}
+	}
+
+	zbx_json_addobject(j, table->table);
+	zbx_json_addarray(j, "fields");
+
+	zbx_json_addstring(j, NULL, table->recid, ZBX_JSON_TYPE_STRING);
+
+	for (f = 0; 0 != table->fields[f].name; f++)
+	{
+		if (0 != (table->fields[f].flags & ZBX_PROXY))
+			zbx_json_addstring(j, NULL, table->fields[f].name, ZBX_JSON_TYPE_STRING);
+	}
+
+	zbx_json_close(j);	/* fields */
+
+	zbx_json_addarray(j, "data");
+
+	if (0 != no_data)
+		goto skip_data;
+
 	if (NULL == (result = DBselect("%s", sql)))
 	{
 		ret = FAIL;
@@ -342,15 +637,8 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 
 	while (NULL != (row = DBfetch(result)))
 	{
-		if (table == table_items)
-		{
-			unsigned char	type;
-
-			ZBX_STR2UCHAR(type, row[fld_type]);
-
-			if (SUCCEED == is_item_processed_by_server(type, row[fld_key]))
-				continue;
-		}
+		if (table == table_items && SUCCEED == proxyconfig_item_skipped(row, fld_type, fld_key))
+			continue;
 
 		fld = 0;
 		zbx_json_addarray(j, NULL);
@@ -382,10 +670,24 @@ static int	get_proxyconfig_table(zbx_uint64_t proxy_hostid, struct zbx_json *j,
 	}
 	DBfree_result(result);
 skip_data:
-	zbx_free(sql);
-
 	zbx_json_close(j);	/* data */
+
+	if (0 != buckets_num)
+	{
+		zbx_json_adduint64(j, ZBX_PROTO_TAG_BUCKET_COUNT, (zbx_uint64_t)buckets_num);
+		zbx_json_addarray(j, ZBX_PROTO_TAG_BUCKETS);
+
+		for (i = 0; i < buckets.values_num; i++)
+			zbx_json_adduint64(j, NULL, buckets.values[i]);
+
+		zbx_json_close(j);	/* buckets */
+	}
+
 	zbx_json_close(j);	/* table->table */
+out:
+	zbx_free(sql);
+	zbx_vector_uint64_destroy(&recids);
+	zbx_vector_uint64_destroy(&buckets);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
 
@@ -481,30 +783,17 @@ static void	get_proxy_monitored_httptests(zbx_uint64_t proxy_hostid, zbx_vector_
  *                                                                            *
  * Purpose: prepare proxy configuration data                                  *
  *                                                                            *
+ * Parameters: proxy_hostid - [IN] the proxy                                  *
+ *             jp_digest    - [IN] the digests of proxy configuration copy    *
+ *                                 (see get_proxyconfig_digest()), NULL to    *
+ *                                 send the whole configuration               *
+ *             j            - [OUT] the configuration data                    *
+ *             error        - [OUT] the error message                         *
+ *                                                                            *
  ******************************************************************************/
-int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, char **error)
+int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, const struct zbx_json_parse *jp_digest, struct zbx_json *j,
+		char **error)
 {
-	static const char	*proxytable[] =
-	{
-		"globalmacro",
-		"hosts",
-		"interface",
-		"hosts_templates",
-		"hostmacro",
-		"items",
-		"drules",
-		"dchecks",
-		"regexps",
-		"expressions",
-		"groups",
-		"config",
-		"httptest",
-		"httptestitem",
-		"httpstep",
-		"httpstepitem",
-		NULL
-	};
-
 	const char		*__function_name = "get_proxyconfig_data";
 
 	int			i, ret = FAIL;
@@ -526,7 +815,7 @@ int	get_proxyconfig_data(zbx_uint64_t proxy_hostid, struct zbx_json *j, char **e
 		table = DBget_table(proxytable[i]);
 		assert(NULL != table);
 
-		if (SUCCEED != get_proxyconfig_table(proxy_hostid, j, table, &hosts, &httptests))
+		if (SUCCEED != get_proxyconfig_table(proxy_hostid, jp_digest, j, table, &hosts, &httptests))
 		{
 			*error = zbx_dsprintf(*error, "failed to get data from table \"%s\"", table->table);
 			goto out;
@@ -543,6 +832,109 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: get_proxyconfig_digest                                           *
+ *                                                                            *
+ * Purpose: prepare digests of local configuration copy, so that server can   *
+ *          send only the records that differ                                 *
+ *                                                                            *
+ * Parameters: j - [OUT] the request to server or the response to it          *
+ *                                                                            *
+ * Comments: Each table is split into power of two buckets by record          *
+ *           identifiers and the digest of every bucket is reported. Nothing  *
+ *           is added after the last update of the local copy failed, the     *
+ *           whole configuration is requested then.                           *
+ *                                                                            *
+ ******************************************************************************/
+void	get_proxyconfig_digest(struct zbx_json *j)
+{
+	const char		*__function_name = "get_proxyconfig_digest";
+
+	const ZBX_TABLE		*table;
+	char			*sql = NULL, digest[ZBX_PROXYCONFIG_DIGEST_SIZE * 2 + 1];
+	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset;
+	int			i, f, records, buckets_num;
+	zbx_uint64_t		recid;
+	md5_state_t		*states = NULL;
+	DB_RESULT		result;
+	DB_ROW			row;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() resync:%d", __function_name, proxyconfig_resync);
+
+	if (0 != proxyconfig_resync)
+		goto out;
+
+	sql = zbx_malloc(sql, sql_alloc);
+	states = zbx_malloc(states, sizeof(md5_state_t) * ZBX_PROXYCONFIG_BUCKETS_MAX);
+
+	zbx_json_addobject(j, ZBX_PROTO_TAG_CONFIG_DIGEST);
+
+	for (i = 0; NULL != proxytable[i]; i++)
+	{
+		table = DBget_table(proxytable[i]);
+
+		if (NULL == (result = DBselect("select count(*) from %s", table->table)))
+			continue;
+
+		if (NULL == (row = DBfetch(result)) || SUCCEED == DBis_null(row[0]))
+			records = 0;
+		else
+			records = atoi(row[0]);
+		DBfree_result(result);
+
+		for (buckets_num = 1; ZBX_PROXYCONFIG_BUCKETS_MAX > buckets_num &&
+				buckets_num * ZBX_PROXYCONFIG_BUCKET_ROWS < records; buckets_num *= 2)
+			;
+
+		sql_offset = 0;
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, "select ");
+		zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, table->recid);
+
+		for (f = 0; 0 != table->fields[f].name; f++)
+		{
+			if (0 == (table->fields[f].flags & ZBX_PROXY))
+				continue;
+
+			zbx_chrcpy_alloc(&sql, &sql_alloc, &sql_offset, ',');
+			zbx_strcpy_alloc(&sql, &sql_alloc, &sql_offset, table->fields[f].name);
+		}
+
+		zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset, " from %s order by %s", table->table,
+				table->recid);
+
+		if (NULL == (result = DBselect("%s", sql)))
+			continue;
+
+		for (f = 0; f < buckets_num; f++)
+			zbx_md5_init(&states[f]);
+
+		while (NULL != (row = DBfetch(result)))
+		{
+			ZBX_STR2UINT64(recid, row[0]);
+			proxyconfig_hash_record(&states[recid % (zbx_uint64_t)buckets_num], table, row);
+		}
+		DBfree_result(result);
+
+		zbx_json_addarray(j, table->table);
+
+		for (f = 0; f < buckets_num; f++)
+		{
+			proxyconfig_digest_string(&states[f], digest);
+			zbx_json_addstring(j, NULL, digest, ZBX_JSON_TYPE_STRING);
+		}
+
+		zbx_json_close(j);
+	}
+
+	zbx_json_close(j);
+
+	zbx_free(states);
+	zbx_free(sql);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: remember_record                                                  *
@@ -724,8 +1116,8 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 	const ZBX_FIELD		*fields[ZBX_MAX_FIELDS];
 	struct zbx_json_parse	jp_data, jp_row;
 	const char		*p, *pf;
-	zbx_uint64_t		recid, *p_recid = NULL;
-	zbx_vector_uint64_t	ins, moves;
+	zbx_uint64_t		recid, *p_recid = NULL, buckets_num = 0;
+	zbx_vector_uint64_t	ins, moves, buckets;
 	char			*buf = NULL, *esc, *sql = NULL, *recs = NULL;
 	size_t			sql_alloc = 4 * ZBX_KIBIBYTE, sql_offset,
 				recs_alloc = 20 * ZBX_KIBIBYTE, recs_offset = 0,
@@ -742,6 +1134,8 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() table:'%s'", __function_name, table->table);
 
+	zbx_vector_uint64_create(&buckets);
+
 	/************************************************************************************/
 	/* T1. RECEIVED JSON (jp_obj) DATA FORMAT                                           */
 	/************************************************************************************/
@@ -774,6 +1168,9 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 	/*  25  |         ...                               | ...tables                     */
 	/*  26  | }                                         |                               */
 	/************************************************************************************/
+	/* A table can also have "bucket_count" and "buckets" tags after the data. Then     */
+	/* only the records of the listed buckets were sent (see get_proxyconfig_table()).  */
+	/************************************************************************************/
 
 	if (NULL == table_items)
 	{
@@ -811,6 +1208,32 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 		}
 	}
 
+	/* only the records of the listed buckets are updated when the table was sent partially */
+	if (SUCCEED == zbx_json_value_by_name_dyn(jp_obj, ZBX_PROTO_TAG_BUCKET_COUNT, &buf, &buf_alloc))
+	{
+		if (SUCCEED != is_uint64(buf, &buckets_num) || 0 == buckets_num ||
+				SUCCEED != zbx_json_brackets_by_name(jp_obj, ZBX_PROTO_TAG_BUCKETS, &jp_data))
+		{
+			*error = zbx_dsprintf(*error, "invalid buckets of table \"%s\"", table->table);
+			goto out;
+		}
+
+		p = NULL;
+		while (NULL != (p = zbx_json_next_value_dyn(&jp_data, p, &buf, &buf_alloc, NULL)))
+		{
+			if (SUCCEED != is_uint64(buf, &recid))
+			{
+				*error = zbx_dsprintf(*error, "invalid bucket \"%s\" of table \"%s\"", buf,
+						table->table);
+				goto out;
+			}
+
+			zbx_vector_uint64_append(&buckets, recid);
+		}
+
+		zbx_vector_uint64_sort(&buckets, ZBX_DEFAULT_UINT64_COMPARE_FUNC);
+	}
+
 	/* get the entries (line 8 in T1) */
 	if (FAIL == zbx_json_brackets_by_name(jp_obj, ZBX_PROTO_TAG_DATA, &jp_data))
 	{
@@ -853,6 +1276,12 @@ static int	process_proxyconfig_table(const ZBX_TABLE *table, struct zbx_json_par
 	{
 		ZBX_STR2UINT64(recid, row[id_field_nr]);
 
+		if (0 != buckets_num && FAIL == zbx_vector_uint64_bsearch(&buckets, recid % buckets_num,
+				ZBX_DEFAULT_UINT64_COMPARE_FUNC))
+		{
+			continue;	/* the server has the same record */
+		}
+
 		id_offset.id = recid;
 		id_offset.offset = recs_offset;
 
@@ -1270,6 +1699,7 @@ clean2:
 	zbx_free(sql);
 	zbx_free(recs);
 out:
+	zbx_vector_uint64_destroy(&buckets);
 	zbx_free(buf);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
@@ -1283,8 +1713,14 @@ out:
  *                                                                            *
  * Purpose: update configuration                                              *
  *                                                                            *
+ * Return value: SUCCEED - processed successfully                             *
+ *               FAIL - an error occurred                                     *
+ *                                                                            *
+ * Comments: The tables that are not present in configuration data are left  *
+ *           unchanged.                                                       *
+ *                                                                            *
  ******************************************************************************/
-void	process_proxyconfig(struct zbx_json_parse *jp_data)
+int	process_proxyconfig(struct zbx_json_parse *jp_data)
 {
 	typedef struct
 	{
@@ -1384,16 +1820,20 @@ void	process_proxyconfig(struct zbx_json_parse *jp_data)
 	{
 		zabbix_log(LOG_LEVEL_ERR, "failed to update local proxy configuration copy: %s",
 				(NULL == error ? "database error" : error));
+		proxyconfig_resync = 1;
 	}
 	else
 	{
 		DCsync_configuration();
 		DCupdate_hosts_availability();
+		proxyconfig_resync = 0;
 	}
 
 	zbx_free(error);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return ret;
 }
 
 /******************************************************************************
@@ -24,6 +24,9 @@
 /* the size of temporary buffer used to read from output stream */
 #define PIPE_BUFFER_SIZE	4096
 
+/* the maximum number of persistent scripts kept running by a process */
+#define ZBX_PERSISTENT_WORKERS_MAX	32
+
 #ifdef _WINDOWS
 
 /******************************************************************************
@@ -118,6 +121,73 @@ static int	zbx_read_from_pipe(HANDLE hRead, char **buf, size_t *buf_size, size_t
 
 #else	/* not _WINDOWS */
 
+#ifdef HAVE_POSIX_SPAWN
+extern char	**environ;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_spawn                                                        *
+ *                                                                            *
+ * Purpose: starts the shell without duplicating the address space of the     *
+ *          calling process                                                   *
+ *                                                                            *
+ * Parameters: pid       - [OUT] child process PID                            *
+ *             argv      - [IN] the shell arguments                           *
+ *             fds       - [IN] descriptors to become the child's stdin,      *
+ *                              stdout and stderr, -1 to inherit the parent's *
+ *             new_group - [IN] 1 - make the child a process group leader     *
+ *                                                                            *
+ * Return value: SUCCEED - the shell was started                              *
+ *               FAIL    - otherwise, errno is set appropriately              *
+ *                                                                            *
+ * Comments: Unlike fork() the cost of posix_spawn() does not grow with the   *
+ *           size of the calling process. The child inherits the environment, *
+ *           the signal mask and ignored signals like it does with fork() and *
+ *           exec(). Descriptors not listed in fds are inherited unless they  *
+ *           have FD_CLOEXEC flag set.                                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_spawn(pid_t *pid, char *const argv[], const int *fds, int new_group)
+{
+	posix_spawn_file_actions_t	actions;
+	posix_spawnattr_t		attr;
+	int				i, rc;
+
+	if (0 != (rc = posix_spawn_file_actions_init(&actions)))
+		goto out;
+
+	if (0 != (rc = posix_spawnattr_init(&attr)))
+	{
+		posix_spawn_file_actions_destroy(&actions);
+		goto out;
+	}
+
+	for (i = 0; i < 3 && 0 == rc; i++)
+	{
+		if (-1 != fds[i])
+			rc = posix_spawn_file_actions_adddup2(&actions, fds[i], i);
+	}
+
+	/* set the child as the process group leader, otherwise orphans may be left after timeout */
+	if (0 == rc && 0 != new_group && 0 == (rc = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP)))
+		rc = posix_spawnattr_setpgroup(&attr, 0);
+
+	if (0 == rc)
+		rc = posix_spawn(pid, "/bin/sh", &actions, &attr, argv, environ);
+
+	posix_spawnattr_destroy(&attr);
+	posix_spawn_file_actions_destroy(&actions);
+out:
+	if (0 != rc)
+	{
+		errno = rc;
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+#endif
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_popen                                                        *
@@ -138,13 +208,41 @@ static int	zbx_read_from_pipe(HANDLE hRead, char **buf, size_t *buf_size, size_t
 static int	zbx_popen(pid_t *pid, const char *command)
 {
 	const char	*__function_name = "zbx_popen";
+#ifdef HAVE_POSIX_SPAWN
+	int		fd[2], fds[3];
+	char		*argv[] = {"sh", "-c", NULL, NULL};
+#else
 	int		fd[2], stdout_orig, stderr_orig;
+#endif
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() command:'%s'", __function_name, command);
 
 	if (-1 == pipe(fd))
 		return -1;
 
+#ifdef HAVE_POSIX_SPAWN
+	/* the child gets the writing end as stdout and stderr, other copies of the pipe must not leak into it */
+	fcntl(fd[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fd[1], F_SETFD, FD_CLOEXEC);
+
+	fds[0] = -1;
+	fds[1] = fd[1];
+	fds[2] = fd[1];
+	argv[2] = (char *)command;
+
+	if (SUCCEED != zbx_spawn(pid, argv, fds, 1))
+	{
+		close(fd[0]);
+		close(fd[1]);
+		return -1;
+	}
+
+	close(fd[1]);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%d", __function_name, fd[0]);
+
+	return fd[0];
+#else
 	if (-1 == (*pid = zbx_fork()))
 	{
 		close(fd[0]);
@@ -202,6 +300,7 @@ static int	zbx_popen(pid_t *pid, const char *command)
 
 	/* execl() returns only when an error occurs, let parent process know about it */
 	exit(EXIT_FAILURE);
+#endif
 }
 
 /******************************************************************************
@@ -263,6 +362,338 @@ exit:
 	return rc;
 }
 
+/* persistent script worker, started once and reused for subsequent requests */
+typedef struct
+{
+	char	*command;
+	pid_t	pid;
+	int	fd_request;	/* writing end of the worker's stdin */
+	int	fd_response;	/* reading end of the worker's stdout */
+	time_t	lastaccess;
+}
+zbx_persistent_worker_t;
+
+static zbx_persistent_worker_t	persistent_workers[ZBX_PERSISTENT_WORKERS_MAX];
+static int			persistent_workers_num = 0;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_persistent_worker_start                                      *
+ *                                                                            *
+ * Purpose: starts a persistent script with its stdin and stdout connected    *
+ *          to pipes, stderr is inherited from the parent                     *
+ *                                                                            *
+ * Parameters: worker  - [OUT] the started worker                             *
+ *             command - [IN] shell command starting the script               *
+ *             error   - [OUT] error message                                  *
+ *             max_error_len - [IN] length of error buffer                    *
+ *                                                                            *
+ * Return value: SUCCEED - the worker was started                             *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_persistent_worker_start(zbx_persistent_worker_t *worker, const char *command, char *error,
+		size_t max_error_len)
+{
+	const char	*__function_name = "zbx_persistent_worker_start";
+	int		fd_in[2], fd_out[2], i, ret = FAIL;
+#ifdef HAVE_POSIX_SPAWN
+	int		fds[3];
+	char		*argv[] = {"sh", "-c", NULL, NULL};
+#endif
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() command:'%s'", __function_name, command);
+
+	if (-1 == pipe(fd_in))
+	{
+		zbx_snprintf(error, max_error_len, "cannot create a pipe: %s", zbx_strerror(errno));
+		goto out;
+	}
+
+	if (-1 == pipe(fd_out))
+	{
+		zbx_snprintf(error, max_error_len, "cannot create a pipe: %s", zbx_strerror(errno));
+		close(fd_in[0]);
+		close(fd_in[1]);
+		goto out;
+	}
+
+	/* workers started later or scripts executed with zbx_execute() must not inherit the pipes, */
+	/* otherwise the worker would not see the end of its input when the parent closes it         */
+	for (i = 0; i < 2; i++)
+	{
+		fcntl(fd_in[i], F_SETFD, FD_CLOEXEC);
+		fcntl(fd_out[i], F_SETFD, FD_CLOEXEC);
+	}
+
+#ifdef HAVE_POSIX_SPAWN
+	fds[0] = fd_in[0];
+	fds[1] = fd_out[1];
+	fds[2] = -1;
+	argv[2] = (char *)command;
+
+	if (SUCCEED != zbx_spawn(&worker->pid, argv, fds, 1))
+	{
+		zbx_snprintf(error, max_error_len, "cannot execute [%s]: %s", command, zbx_strerror(errno));
+		close(fd_in[0]);
+		close(fd_in[1]);
+		close(fd_out[0]);
+		close(fd_out[1]);
+		goto out;
+	}
+#else
+	if (-1 == (worker->pid = zbx_fork()))
+	{
+		zbx_snprintf(error, max_error_len, "cannot fork: %s", zbx_strerror(errno));
+		close(fd_in[0]);
+		close(fd_in[1]);
+		close(fd_out[0]);
+		close(fd_out[1]);
+		goto out;
+	}
+
+	if (0 == worker->pid)
+	{
+		/* child process */
+
+		if (-1 == setpgid(0, 0))
+		{
+			zabbix_log(LOG_LEVEL_ERR, "%s(): failed to create a process group: %s",
+					__function_name, zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+
+		dup2(fd_in[0], STDIN_FILENO);
+		dup2(fd_out[1], STDOUT_FILENO);
+
+		execl("/bin/sh", "sh", "-c", command, NULL);
+
+		zabbix_log(LOG_LEVEL_WARNING, "execl() failed for [%s]: %s", command, zbx_strerror(errno));
+
+		exit(EXIT_FAILURE);
+	}
+#endif
+
+	close(fd_in[0]);
+	close(fd_out[1]);
+
+	worker->command = zbx_strdup(NULL, command);
+	worker->fd_request = fd_in[1];
+	worker->fd_response = fd_out[0];
+	worker->lastaccess = time(NULL);
+
+	ret = SUCCEED;
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s pid:%d", __function_name, zbx_result_string(ret),
+			SUCCEED == ret ? (int)worker->pid : -1);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_persistent_worker_stop                                       *
+ *                                                                            *
+ * Purpose: stops a persistent script and removes it from the worker list     *
+ *                                                                            *
+ * Parameters: index - [IN] the worker index in persistent_workers array      *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_persistent_worker_stop(int index)
+{
+	zbx_persistent_worker_t	*worker = &persistent_workers[index];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "stopping persistent script [%s] pid:%d", worker->command, (int)worker->pid);
+
+	close(worker->fd_request);
+	close(worker->fd_response);
+
+	/* kill the whole process group, pid must be the leader */
+	if (-1 == kill(-worker->pid, SIGTERM) && ESRCH != errno)
+		zabbix_log(LOG_LEVEL_ERR, "failed to kill [%s]: %s", worker->command, zbx_strerror(errno));
+
+	zbx_waitpid(worker->pid);
+	zbx_free(worker->command);
+
+	if (index != --persistent_workers_num)
+		persistent_workers[index] = persistent_workers[persistent_workers_num];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_persistent_worker_get                                        *
+ *                                                                            *
+ * Purpose: finds a running worker for the command or starts a new one,       *
+ *          stopping the least recently used worker if the list is full       *
+ *                                                                            *
+ * Parameters: command       - [IN] shell command starting the script         *
+ *             reused        - [OUT] SUCCEED if the worker was already        *
+ *                                   running, FAIL if it was just started     *
+ *             error         - [OUT] error message                            *
+ *             max_error_len - [IN] length of error buffer                    *
+ *                                                                            *
+ * Return value: index of the worker or -1 if it cannot be started            *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_persistent_worker_get(const char *command, int *reused, char *error, size_t max_error_len)
+{
+	int	i, lru = 0;
+
+	for (i = 0; i < persistent_workers_num; i++)
+	{
+		if (0 == strcmp(persistent_workers[i].command, command))
+		{
+			*reused = SUCCEED;
+			return i;
+		}
+
+		if (persistent_workers[i].lastaccess < persistent_workers[lru].lastaccess)
+			lru = i;
+	}
+
+	*reused = FAIL;
+
+	if (ZBX_PERSISTENT_WORKERS_MAX == persistent_workers_num)
+		zbx_persistent_worker_stop(lru);
+
+	if (SUCCEED != zbx_persistent_worker_start(&persistent_workers[persistent_workers_num], command, error,
+			max_error_len))
+	{
+		return -1;
+	}
+
+	return persistent_workers_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_persistent_request_create                                    *
+ *                                                                            *
+ * Purpose: formats a persistent script request line                          *
+ *                                                                            *
+ * Parameters: params     - [IN] request parameters                           *
+ *             params_num - [IN] number of request parameters                 *
+ *             request    - [OUT] the request line, terminated by newline     *
+ *             offset     - [OUT] the request line length                     *
+ *                                                                            *
+ * Comments: parameters are separated by tabs, backslashes, tabs and          *
+ *           newlines inside parameters are escaped as \\, \t and \n          *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_persistent_request_create(const char **params, int params_num, char **request, size_t *offset)
+{
+	size_t		alloc = 0;
+	const char	*p;
+	int		i;
+
+	*offset = 0;
+
+	for (i = 0; i < params_num; i++)
+	{
+		if (0 != i)
+			zbx_chrcpy_alloc(request, &alloc, offset, '\t');
+
+		for (p = params[i]; '\0' != *p; p++)
+		{
+			switch (*p)
+			{
+				case '\\':
+					zbx_strcpy_alloc(request, &alloc, offset, "\\\\");
+					break;
+				case '\t':
+					zbx_strcpy_alloc(request, &alloc, offset, "\\t");
+					break;
+				case '\n':
+					zbx_strcpy_alloc(request, &alloc, offset, "\\n");
+					break;
+				default:
+					zbx_chrcpy_alloc(request, &alloc, offset, *p);
+			}
+		}
+	}
+
+	zbx_chrcpy_alloc(request, &alloc, offset, '\n');
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_persistent_response_read                                     *
+ *                                                                            *
+ * Purpose: reads a persistent script response                                *
+ *                                                                            *
+ * Parameters: fd     - [IN] the worker's stdout                              *
+ *             buffer - [OUT] the response with terminating line removed and  *
+ *                            leading dots unstuffed                          *
+ *             error         - [OUT] error message                            *
+ *             max_error_len - [IN] length of error buffer                    *
+ *                                                                            *
+ * Return value: SUCCEED       - the response was read                        *
+ *               TIMEOUT_ERROR - the timeout alarm interrupted reading        *
+ *               FAIL          - the worker closed its output or the response *
+ *                               is invalid                                   *
+ *                                                                            *
+ * Comments: the response is a sequence of lines terminated by a line         *
+ *           containing a single dot, lines starting with a dot are sent with *
+ *           an extra dot prepended                                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_persistent_response_read(int fd, char **buffer, char *error, size_t max_error_len)
+{
+	char	tmp_buf[PIPE_BUFFER_SIZE], *data = NULL, *line, *end;
+	size_t	data_alloc = 0, data_offset = 0, buf_alloc = 0, buf_offset = 0;
+	ssize_t	rc;
+	int	ret = FAIL;
+
+	while (2 > data_offset || '\n' != data[data_offset - 1] || '.' != data[data_offset - 2] ||
+			(2 < data_offset && '\n' != data[data_offset - 3]))
+	{
+		if (0 >= (rc = read(fd, tmp_buf, sizeof(tmp_buf))))
+		{
+			if (-1 == rc && EINTR == errno)
+				ret = TIMEOUT_ERROR;
+			else if (-1 == rc)
+				zbx_snprintf(error, max_error_len, "cannot read script response: %s", zbx_strerror(errno));
+			else
+				zbx_strlcpy(error, "Script closed its output before completing the response.", max_error_len);
+
+			goto out;
+		}
+
+		if (MAX_EXECUTE_OUTPUT_LEN <= data_offset + rc)
+		{
+			zbx_snprintf(error, max_error_len, "command output exceeded limit of %d KB",
+					MAX_EXECUTE_OUTPUT_LEN / ZBX_KIBIBYTE);
+			goto out;
+		}
+
+		zbx_strncpy_alloc(&data, &data_alloc, &data_offset, tmp_buf, rc);
+	}
+
+	/* drop the terminating line and unstuff the dots */
+
+	data[data_offset - 2] = '\0';
+	zbx_strcpy_alloc(buffer, &buf_alloc, &buf_offset, "");
+
+	for (line = data; '\0' != *line; line = end)
+	{
+		if ('.' == *line)
+			line++;
+
+		if (NULL == (end = strchr(line, '\n')))
+			end = line + strlen(line);
+		else
+			end++;
+
+		zbx_strncpy_alloc(buffer, &buf_alloc, &buf_offset, line, end - line);
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_free(data);
+
+	return ret;
+}
+
 #endif	/* _WINDOWS */
 
 /******************************************************************************
@@ -524,6 +955,41 @@ int	zbx_execute_nowait(const char *command)
 
 	return SUCCEED;
 
+#elif defined(HAVE_POSIX_SPAWN)
+	pid_t	pid;
+	int	fd, fds[3], ret = FAIL;
+	char	*argv[] = {"sh", "-c", "/bin/sh -c \"$1\" &", "sh", NULL, NULL};
+
+	/* suppress the output of the executed script, otherwise */
+	/* the output might get written to a logfile or elsewhere */
+	if (-1 == (fd = open("/dev/null", O_RDWR)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot open /dev/null for executing [%s]: %s",
+				command, zbx_strerror(errno));
+		return FAIL;
+	}
+
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	fds[0] = fd;
+	fds[1] = fd;
+	fds[2] = fd;
+	argv[4] = (char *)command;
+
+	/* the intermediate shell starts the command in background and exits, like the first child of double fork */
+	if (SUCCEED != zbx_spawn(&pid, argv, fds, 0))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot execute [%s]: %s", command, zbx_strerror(errno));
+	}
+	else
+	{
+		waitpid(pid, NULL, 0);
+		ret = SUCCEED;
+	}
+
+	close(fd);
+
+	return ret;
 #else	/* not _WINDOWS */
 	pid_t		pid;
 
@@ -575,3 +1041,115 @@ int	zbx_execute_nowait(const char *command)
 	exit(EXIT_SUCCESS);
 #endif
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_execute_persistent                                           *
+ *                                                                            *
+ * Purpose: this function passes a request to a persistent script and returns *
+ *          its response                                                      *
+ *                                                                            *
+ * Parameters: command       - [IN] command starting the script               *
+ *             params        - [IN] request parameters                        *
+ *             params_num    - [IN] number of request parameters              *
+ *             buffer        - [OUT] the response                             *
+ *             error         - [OUT] error string if function fails           *
+ *             max_error_len - [IN] length of error buffer                    *
+ *             timeout       - [IN] timeout in seconds                        *
+ *                                                                            *
+ * Return value: SUCCEED if processed successfully, TIMEOUT_ERROR if          *
+ *               timeout occurred or FAIL otherwise                           *
+ *                                                                            *
+ * Comments: The script is started on the first request and is kept running  *
+ *           for the next requests with the same command. It reads requests   *
+ *           from stdin, one per line, with the parameters separated by tabs, *
+ *           and writes each response to stdout followed by a line containing *
+ *           a single dot. Response lines starting with a dot must have an    *
+ *           extra dot prepended. The script must exit when its stdin is      *
+ *           closed. On timeout or protocol error the script is killed and    *
+ *           started again on the next request.                               *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_execute_persistent(const char *command, const char **params, int params_num, char **buffer, char *error,
+		size_t max_error_len, int timeout)
+{
+#ifdef _WINDOWS
+	zbx_strlcpy(error, "Persistent scripts are not supported on Windows.", max_error_len);
+
+	return FAIL;
+#else
+	const char		*__function_name = "zbx_execute_persistent";
+
+	zbx_persistent_worker_t	*worker;
+	char			*request = NULL;
+	size_t			request_len, written;
+	ssize_t			rc;
+	int			index, reused, ret = FAIL;
+	struct sigaction	sa_ignore, sa_orig;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() command:'%s'", __function_name, command);
+
+	*error = '\0';
+	zbx_free(*buffer);
+
+	zbx_persistent_request_create(params, params_num, &request, &request_len);
+
+	/* writing to a script that has exited must fail with EPIPE instead of terminating the process, */
+	/* not every process calling this function has SIGPIPE ignored (e.g. agent started with -t or -p) */
+	memset(&sa_ignore, 0, sizeof(sa_ignore));
+	sa_ignore.sa_handler = SIG_IGN;
+	sigemptyset(&sa_ignore.sa_mask);
+	sigaction(SIGPIPE, &sa_ignore, &sa_orig);
+
+	zbx_alarm_on(timeout);
+
+	while (-1 != (index = zbx_persistent_worker_get(command, &reused, error, max_error_len)))
+	{
+		worker = &persistent_workers[index];
+
+		for (written = 0; written < request_len; written += rc)
+		{
+			if (-1 == (rc = write(worker->fd_request, request + written, request_len - written)))
+				break;
+		}
+
+		if (written == request_len)
+			ret = zbx_persistent_response_read(worker->fd_response, buffer, error, max_error_len);
+		else if (EINTR == errno)
+			ret = TIMEOUT_ERROR;
+		else
+			zbx_snprintf(error, max_error_len, "cannot write script request: %s", zbx_strerror(errno));
+
+		if (SUCCEED == ret)
+		{
+			worker->lastaccess = time(NULL);
+			break;
+		}
+
+		zbx_persistent_worker_stop(index);
+		zbx_free(*buffer);
+
+		/* a reused script might have exited since the previous request (the request write fails with */
+		/* EPIPE or the response is not complete), restart it once */
+		if (TIMEOUT_ERROR == ret || SUCCEED != reused)
+			break;
+
+		*error = '\0';
+	}
+
+	zbx_alarm_off();
+
+	sigaction(SIGPIPE, &sa_orig, NULL);
+
+	zbx_free(request);
+
+	if (TIMEOUT_ERROR == ret)
+		zbx_strlcpy(error, "Timeout while executing a shell script.", max_error_len);
+	else if ('\0' != *error)
+		zabbix_log(LOG_LEVEL_WARNING, "%s", error);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return ret;
+#endif
+}
@@ -18,6 +18,7 @@
 **/
 
 #include "zbxicmpping.h"
+#include "icmpsocket.h"
 #include "threads.h"
 #include "comms.h"
 #include "log.h"
@@ -383,20 +384,36 @@ static int	process_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int i
  *                                                                            *
  * Author: Alexei Vladishev                                                   *
  *                                                                            *
- * Comments: use external binary 'fping' to avoid superuser privileges        *
+ * Comments: The hosts are pinged from ICMP sockets in the current process.   *
+ *           If neither raw nor unprivileged datagram ICMP sockets can be     *
+ *           opened, external binary 'fping' is used to avoid superuser       *
+ *           privileges.                                                      *
  *                                                                            *
  ******************************************************************************/
 int	do_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int interval, int size, int timeout, char *error, int max_error_len)
 {
-	const char	*__function_name = "do_ping";
+	const char		*__function_name = "do_ping";
 
-	int	res;
+	static unsigned char	fping_fallback_logged = 0;
+	int			res;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hosts_count:%d", __function_name, hosts_count);
 
+	if (SUCCEED == (res = zbx_icmp_ping(hosts, hosts_count, count, interval, size, timeout, error,
+			max_error_len)))
+	{
+		goto out;
+	}
+
+	if (0 == fping_fallback_logged)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "%s, using fping instead", error);
+		fping_fallback_logged = 1;
+	}
+
 	if (NOTSUPPORTED == (res = process_ping(hosts, hosts_count, count, interval, size, timeout, error, max_error_len)))
 		zabbix_log(LOG_LEVEL_ERR, "%s", error);
-
+out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(res));
 
 	return res;
@@ -0,0 +1,716 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+#include "log.h"
+#include "zbxicmpping.h"
+#include "icmpsocket.h"
+
+/* In-process ICMP echo engine. Probes are sent from one raw socket (or unprivileged */
+/* datagram ICMP socket where raw sockets are not permitted) per address family to  */
+/* all targets in rounds, the replies are matched by the payload carrying target    */
+/* and probe indexes. The fping defaults are used for unspecified parameters.       */
+
+extern char	*CONFIG_SOURCE_IP;
+
+#define ZBX_ICMP_ECHO_REQUEST		8
+#define ZBX_ICMP_ECHO_REPLY		0
+#define ZBX_ICMPV6_ECHO_REQUEST		128
+#define ZBX_ICMPV6_ECHO_REPLY		129
+
+#define ZBX_ICMP_DEFAULT_INTERVAL	1000	/* fping -p default, ms */
+#define ZBX_ICMP_DEFAULT_SIZE		56	/* fping -b default, bytes */
+#define ZBX_ICMP_DEFAULT_TIMEOUT	500	/* fping -t default, ms */
+
+#define ZBX_ICMP_SEND_GAP		0.01	/* fping -i default, minimum time between two sent packets */
+#define ZBX_ICMP_SEND_RETRIES		10	/* times to retry sending when socket buffer is full */
+#define ZBX_ICMP_RCVBUF_SIZE		(1024 * 1024)
+#define ZBX_ICMP_PACKET_MAX		(ZBX_KIBIBYTE * 64)
+
+typedef struct
+{
+	unsigned char	type;
+	unsigned char	code;
+	unsigned short	checksum;
+	unsigned short	id;
+	unsigned short	seq;
+}
+zbx_icmp_header_t;
+
+/* the start of echo request data, the rest is padding up to the requested size */
+typedef struct
+{
+	zbx_uint32_t	pid;
+	zbx_uint32_t	session;
+	zbx_uint32_t	target;
+	zbx_uint32_t	probe;
+}
+zbx_icmp_payload_t;
+
+typedef struct
+{
+	ZBX_FPING_HOST		*host;
+	struct sockaddr_storage	addr;
+	socklen_t		addr_len;
+	int			family;
+	double			*sent;		/* send time of each probe, 0 - not sent */
+}
+zbx_icmp_target_t;
+
+typedef struct
+{
+	int		fd;
+	unsigned char	raw;		/* 1 - raw socket (replies include IPv4 header), 0 - datagram socket */
+	unsigned char	failed;		/* socket cannot be opened, do not retry */
+}
+zbx_icmp_socket_t;
+
+typedef struct
+{
+	zbx_icmp_target_t	*targets;
+	int			targets_num;
+	int			count;
+	double			timeout;
+	zbx_uint32_t		pid;
+	zbx_uint32_t		session;
+	int			outstanding;	/* number of sent probes without reply */
+}
+zbx_icmp_batch_t;
+
+static zbx_icmp_socket_t	icmp_sock = {-1, 0, 0};
+#ifdef HAVE_IPV6
+static zbx_icmp_socket_t	icmp6_sock = {-1, 0, 0};
+#endif
+static zbx_uint32_t		icmp_session = 0;
+static unsigned short		icmp_seq = 0;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_checksum                                                    *
+ *                                                                            *
+ * Purpose: calculate internet checksum (RFC 1071) of ICMP packet             *
+ *                                                                            *
+ ******************************************************************************/
+static unsigned short	icmp_checksum(const unsigned char *data, size_t len)
+{
+	zbx_uint32_t	sum = 0;
+
+	for (; 1 < len; len -= 2, data += 2)
+		sum += (data[0] << 8) | data[1];
+
+	if (1 == len)
+		sum += data[0] << 8;
+
+	while (0 != (sum >> 16))
+		sum = (sum & 0xffff) + (sum >> 16);
+
+	return htons((unsigned short)~sum);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_socket_open                                                 *
+ *                                                                            *
+ * Purpose: open ICMP socket for the specified address family                 *
+ *                                                                            *
+ * Parameters: sock   - [IN/OUT] the socket                                   *
+ *             family - [IN] the address family                               *
+ *             error  - [OUT] the error message                               *
+ *             max_error_len - [IN] the error message buffer size             *
+ *                                                                            *
+ * Return value: SUCCEED - the socket is open                                 *
+ *               FAIL    - neither raw nor datagram ICMP socket can be opened *
+ *                                                                            *
+ * Comments: The socket is kept open for the lifetime of the process. Raw     *
+ *           socket requires privileges, datagram ICMP socket must be allowed *
+ *           for the process group (net.ipv4.ping_group_range on Linux).      *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_socket_open(zbx_icmp_socket_t *sock, int family, char *error, int max_error_len)
+{
+	int			proto, size = ZBX_ICMP_RCVBUF_SIZE;
+#ifdef HAVE_IPV6
+	struct addrinfo		hints, *ai = NULL;
+#else
+	struct sockaddr_in	source_addr;
+#endif
+
+	if (-1 != sock->fd)
+		return SUCCEED;
+
+	if (1 == sock->failed)
+	{
+		zbx_snprintf(error, max_error_len, "cannot open ICMP%s socket", AF_INET == family ? "" : "v6");
+		return FAIL;
+	}
+
+#ifdef HAVE_IPV6
+	proto = (AF_INET == family ? IPPROTO_ICMP : IPPROTO_ICMPV6);
+#else
+	proto = IPPROTO_ICMP;
+#endif
+
+	if (-1 != (sock->fd = socket(family, SOCK_RAW, proto)))
+		sock->raw = 1;
+	else if (-1 != (sock->fd = socket(family, SOCK_DGRAM, proto)))
+		sock->raw = 0;
+	else
+	{
+		zbx_snprintf(error, max_error_len, "cannot open ICMP%s socket: %s", AF_INET == family ? "" : "v6",
+				zbx_strerror(errno));
+		goto fail;
+	}
+
+	fcntl(sock->fd, F_SETFD, FD_CLOEXEC);
+
+	if (-1 == fcntl(sock->fd, F_SETFL, O_NONBLOCK | fcntl(sock->fd, F_GETFL)))
+	{
+		zbx_snprintf(error, max_error_len, "cannot set ICMP socket to non-blocking mode: %s",
+				zbx_strerror(errno));
+		goto fail;
+	}
+
+	/* replies to thousands of targets can arrive in bursts */
+	if (-1 == setsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)))
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot set ICMP socket receive buffer size: %s", zbx_strerror(errno));
+
+	if (NULL != CONFIG_SOURCE_IP)
+	{
+#ifdef HAVE_IPV6
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = family;
+		hints.ai_flags = AI_NUMERICHOST;
+
+		if (0 == getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai) &&
+				-1 == bind(sock->fd, ai->ai_addr, ai->ai_addrlen))
+		{
+			zbx_snprintf(error, max_error_len, "cannot bind ICMP socket to \"%s\": %s", CONFIG_SOURCE_IP,
+					zbx_strerror(errno));
+			freeaddrinfo(ai);
+			goto fail;
+		}
+
+		if (NULL != ai)
+			freeaddrinfo(ai);
+#else
+		memset(&source_addr, 0, sizeof(source_addr));
+		source_addr.sin_family = AF_INET;
+		source_addr.sin_addr.s_addr = inet_addr(CONFIG_SOURCE_IP);
+
+		if (-1 == bind(sock->fd, (struct sockaddr *)&source_addr, sizeof(source_addr)))
+		{
+			zbx_snprintf(error, max_error_len, "cannot bind ICMP socket to \"%s\": %s", CONFIG_SOURCE_IP,
+					zbx_strerror(errno));
+			goto fail;
+		}
+#endif
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "opened %s ICMP%s socket", 1 == sock->raw ? "raw" : "datagram",
+			AF_INET == family ? "" : "v6");
+
+	return SUCCEED;
+fail:
+	if (-1 != sock->fd)
+	{
+		close(sock->fd);
+		sock->fd = -1;
+	}
+
+	sock->failed = 1;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_get_socket                                                  *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_icmp_socket_t	*icmp_get_socket(int family)
+{
+#ifdef HAVE_IPV6
+	if (AF_INET6 == family)
+		return &icmp6_sock;
+#endif
+	return &icmp_sock;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_resolve_target                                              *
+ *                                                                            *
+ * Purpose: resolve target host address                                       *
+ *                                                                            *
+ * Parameters: target - [IN/OUT] the target                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the address was resolved                           *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: Only the first resolved address is pinged. When source IP is     *
+ *           configured only the addresses of its family are used.            *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_resolve_target(zbx_icmp_target_t *target)
+{
+#ifdef HAVE_IPV6
+	struct addrinfo	hints, *ai = NULL;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_socktype = SOCK_RAW;
+
+	if (NULL == CONFIG_SOURCE_IP)
+		hints.ai_family = PF_UNSPEC;
+	else
+		hints.ai_family = (SUCCEED == is_ip4(CONFIG_SOURCE_IP) ? PF_INET : PF_INET6);
+
+	if (0 != getaddrinfo(target->host->addr, NULL, &hints, &ai))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot resolve ICMP ping target \"%s\"", target->host->addr);
+		return FAIL;
+	}
+
+	memcpy(&target->addr, ai->ai_addr, ai->ai_addrlen);
+	target->addr_len = ai->ai_addrlen;
+	target->family = ai->ai_family;
+
+	freeaddrinfo(ai);
+#else
+	struct hostent		*hp;
+	struct sockaddr_in	*addr = (struct sockaddr_in *)&target->addr;
+
+	if (NULL == (hp = gethostbyname(target->host->addr)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot resolve ICMP ping target \"%s\"", target->host->addr);
+		return FAIL;
+	}
+
+	memset(addr, 0, sizeof(struct sockaddr_in));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = ((struct in_addr *)(hp->h_addr))->s_addr;
+	target->addr_len = sizeof(struct sockaddr_in);
+	target->family = AF_INET;
+#endif
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_addr_equal                                                  *
+ *                                                                            *
+ * Purpose: check if reply came from the target address                       *
+ *                                                                            *
+ ******************************************************************************/
+static int	icmp_addr_equal(const zbx_icmp_target_t *target, const struct sockaddr_storage *from)
+{
+	if (target->family != from->ss_family)
+		return FAIL;
+
+	if (AF_INET == from->ss_family)
+	{
+		if (((const struct sockaddr_in *)&target->addr)->sin_addr.s_addr !=
+				((const struct sockaddr_in *)from)->sin_addr.s_addr)
+		{
+			return FAIL;
+		}
+
+		return SUCCEED;
+	}
+#ifdef HAVE_IPV6
+	if (0 != memcmp(&((const struct sockaddr_in6 *)&target->addr)->sin6_addr,
+			&((const struct sockaddr_in6 *)from)->sin6_addr, sizeof(struct in6_addr)))
+	{
+		return FAIL;
+	}
+
+	return SUCCEED;
+#else
+	return FAIL;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_process_reply                                               *
+ *                                                                            *
+ * Purpose: match echo reply to the sent probe and account its round trip     *
+ *          time                                                              *
+ *                                                                            *
+ * Parameters: batch  - [IN/OUT] the ping batch                               *
+ *             sock   - [IN] the socket the reply was received from           *
+ *             buf    - [IN] the received packet                              *
+ *             len    - [IN] the received packet length                       *
+ *             from   - [IN] the reply source address                         *
+ *             now    - [IN] the reply receive time                           *
+ *                                                                            *
+ * Comments: Replies from other addresses than the target (for example, when  *
+ *           pinging broadcast address), duplicate and late replies are       *
+ *           ignored like in the fping output processing.                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_process_reply(zbx_icmp_batch_t *batch, const zbx_icmp_socket_t *sock, const unsigned char *buf,
+		ssize_t len, const struct sockaddr_storage *from, double now)
+{
+	const zbx_icmp_header_t		*header;
+	zbx_icmp_payload_t		payload;
+	zbx_icmp_target_t		*target;
+	ZBX_FPING_HOST			*host;
+	double				sec;
+
+	/* IPv4 raw sockets receive the IP header too */
+	if (AF_INET == from->ss_family && 1 == sock->raw)
+	{
+		size_t	ip_header_len;
+
+		if (1 > len || len < (ssize_t)(ip_header_len = (buf[0] & 0x0f) * 4))
+			return;
+
+		buf += ip_header_len;
+		len -= ip_header_len;
+	}
+
+	if (len < (ssize_t)(sizeof(zbx_icmp_header_t) + sizeof(zbx_icmp_payload_t)))
+		return;
+
+	header = (const zbx_icmp_header_t *)buf;
+
+	if ((AF_INET == from->ss_family ? ZBX_ICMP_ECHO_REPLY : ZBX_ICMPV6_ECHO_REPLY) != header->type)
+		return;
+
+	/* datagram socket identifier is assigned by kernel, only our replies are delivered there */
+	if (1 == sock->raw && htons((unsigned short)batch->pid) != header->id)
+		return;
+
+	memcpy(&payload, buf + sizeof(zbx_icmp_header_t), sizeof(payload));
+
+	if (batch->pid != payload.pid || batch->session != payload.session ||
+			(zbx_uint32_t)batch->targets_num <= payload.target ||
+			(zbx_uint32_t)batch->count <= payload.probe)
+	{
+		return;
+	}
+
+	target = &batch->targets[payload.target];
+	host = target->host;
+
+	if (SUCCEED != icmp_addr_equal(target, from))
+		return;
+
+	if (0 == target->sent[payload.probe] || 1 == host->status[payload.probe])
+		return;
+
+	if (batch->timeout < (sec = now - target->sent[payload.probe]))
+		return;
+
+	if (0 > sec)
+		sec = 0;
+
+	host->status[payload.probe] = 1;
+	batch->outstanding--;
+
+	if (0 == host->rcv || host->min > sec)
+		host->min = sec;
+	if (0 == host->rcv || host->max < sec)
+		host->max = sec;
+	host->sum += sec;
+	host->rcv++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_read_socket                                                 *
+ *                                                                            *
+ * Purpose: read all pending packets from ICMP socket                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_read_socket(zbx_icmp_batch_t *batch, const zbx_icmp_socket_t *sock)
+{
+	static unsigned char	*buf = NULL;
+	struct sockaddr_storage	from;
+	socklen_t		from_len;
+	ssize_t			len;
+
+	if (NULL == buf)
+		buf = zbx_malloc(buf, ZBX_ICMP_PACKET_MAX);
+
+	for (;;)
+	{
+		from_len = sizeof(from);
+
+		if (-1 == (len = recvfrom(sock->fd, buf, ZBX_ICMP_PACKET_MAX, 0, (struct sockaddr *)&from, &from_len)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			if (EAGAIN != errno && EWOULDBLOCK != errno)
+				zabbix_log(LOG_LEVEL_DEBUG, "cannot receive ICMP packet: %s", zbx_strerror(errno));
+
+			return;
+		}
+
+		icmp_process_reply(batch, sock, buf, len, &from, zbx_time());
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_receive                                                     *
+ *                                                                            *
+ * Purpose: receive replies until the specified time                          *
+ *                                                                            *
+ * Parameters: batch - [IN/OUT] the ping batch                                *
+ *             until - [IN] the time to stop waiting                          *
+ *             all   - [IN] 1 - stop also when all sent probes are answered   *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_receive(zbx_icmp_batch_t *batch, double until, int all)
+{
+	fd_set		fds;
+	struct timeval	tv;
+	double		now, wait;
+	int		max_fd, rc;
+
+	while (1 != all || 0 < batch->outstanding)
+	{
+		if (0 > (wait = until - (now = zbx_time())))
+			wait = 0;
+
+		FD_ZERO(&fds);
+		max_fd = -1;
+
+		if (-1 != icmp_sock.fd)
+		{
+			FD_SET(icmp_sock.fd, &fds);
+			max_fd = icmp_sock.fd;
+		}
+#ifdef HAVE_IPV6
+		if (-1 != icmp6_sock.fd)
+		{
+			FD_SET(icmp6_sock.fd, &fds);
+			max_fd = MAX(max_fd, icmp6_sock.fd);
+		}
+#endif
+		tv.tv_sec = (time_t)wait;
+		tv.tv_usec = (suseconds_t)((wait - tv.tv_sec) * 1000000);
+
+		if (-1 == (rc = select(max_fd + 1, &fds, NULL, NULL, &tv)))
+		{
+			if (EINTR != errno)
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "select() failed on ICMP socket: %s", zbx_strerror(errno));
+				return;
+			}
+
+			continue;
+		}
+
+		if (0 < rc)
+		{
+			if (-1 != icmp_sock.fd && FD_ISSET(icmp_sock.fd, &fds))
+				icmp_read_socket(batch, &icmp_sock);
+#ifdef HAVE_IPV6
+			if (-1 != icmp6_sock.fd && FD_ISSET(icmp6_sock.fd, &fds))
+				icmp_read_socket(batch, &icmp6_sock);
+#endif
+		}
+
+		if (0 == wait)
+			return;
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: icmp_send_probe                                                  *
+ *                                                                            *
+ * Purpose: send echo request to the target                                   *
+ *                                                                            *
+ * Parameters: batch  - [IN/OUT] the ping batch                               *
+ *             index  - [IN] the target index                                 *
+ *             probe  - [IN] the probe index                                  *
+ *             packet - [IN/OUT] the packet buffer, header and padded payload *
+ *             len    - [IN] the packet length                                *
+ *                                                                            *
+ * Comments: A probe that cannot be sent is counted as lost like unanswered   *
+ *           probes are.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	icmp_send_probe(zbx_icmp_batch_t *batch, int index, int probe, unsigned char *packet, size_t len)
+{
+	zbx_icmp_target_t	*target = &batch->targets[index];
+	zbx_icmp_socket_t	*sock = icmp_get_socket(target->family);
+	zbx_icmp_header_t	*header = (zbx_icmp_header_t *)packet;
+	zbx_icmp_payload_t	payload;
+	int			retries;
+
+	header->type = (AF_INET == target->family ? ZBX_ICMP_ECHO_REQUEST : ZBX_ICMPV6_ECHO_REQUEST);
+	header->code = 0;
+	header->checksum = 0;
+	header->id = htons((unsigned short)batch->pid);
+	header->seq = htons(icmp_seq++);
+
+	payload.pid = batch->pid;
+	payload.session = batch->session;
+	payload.target = (zbx_uint32_t)index;
+	payload.probe = (zbx_uint32_t)probe;
+	memcpy(packet + sizeof(zbx_icmp_header_t), &payload, sizeof(payload));
+
+	/* ICMPv6 checksum includes pseudo header and is calculated by kernel */
+	if (AF_INET == target->family)
+		header->checksum = icmp_checksum(packet, len);
+
+	target->sent[probe] = zbx_time();
+
+	for (retries = 0; -1 == sendto(sock->fd, packet, len, 0, (struct sockaddr *)&target->addr, target->addr_len);
+			retries++)
+	{
+		if (EINTR == errno)
+			continue;
+
+		if ((EAGAIN != errno && EWOULDBLOCK != errno && ENOBUFS != errno) || ZBX_ICMP_SEND_RETRIES <= retries)
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "cannot send ICMP echo request to \"%s\": %s", target->host->addr,
+					zbx_strerror(errno));
+			return;
+		}
+
+		/* socket buffer is full, let the replies in while waiting */
+		icmp_receive(batch, zbx_time() + 0.001, 0);
+		target->sent[probe] = zbx_time();
+	}
+
+	batch->outstanding++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_icmp_ping                                                    *
+ *                                                                            *
+ * Purpose: ping hosts with the in-process ICMP engine                        *
+ *                                                                            *
+ * Parameters: hosts         - [IN/OUT] the hosts to ping                     *
+ *             hosts_count   - [IN] the number of hosts                       *
+ *             count         - [IN] the number of probes to send to each host *
+ *             interval      - [IN] the time between probes to the same host  *
+ *                                  in milliseconds, 0 - the default          *
+ *             size          - [IN] the echo request data size, 0 - default   *
+ *             timeout       - [IN] the probe timeout in milliseconds,        *
+ *                                  0 - the default                           *
+ *             error         - [OUT] the error message                        *
+ *             max_error_len - [IN] the error message buffer size             *
+ *                                                                            *
+ * Return value: SUCCEED      - the hosts were pinged                         *
+ *               FAIL         - ICMP sockets are not available, fping must be *
+ *                              used instead                                  *
+ *                                                                            *
+ * Comments: Each round sends one probe to every target, the next round       *
+ *           starts not earlier than interval after the previous one. The     *
+ *           results are accumulated in hosts the same way as with fping.     *
+ *           Hosts that cannot be resolved are left with zero probe count.    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_icmp_ping(ZBX_FPING_HOST *hosts, int hosts_count, int count, int interval, int size, int timeout,
+		char *error, int max_error_len)
+{
+	const char		*__function_name = "zbx_icmp_ping";
+	zbx_icmp_batch_t	batch;
+	zbx_icmp_target_t	*target;
+	unsigned char		*packet;
+	size_t			len;
+	double			round_start, next_send, last_send = 0;
+	int			i, probe, ret = FAIL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hosts_count:%d", __function_name, hosts_count);
+
+	batch.targets = zbx_malloc(NULL, sizeof(zbx_icmp_target_t) * hosts_count);
+	batch.targets_num = 0;
+	batch.count = count;
+	batch.timeout = (0 != timeout ? timeout : ZBX_ICMP_DEFAULT_TIMEOUT) / 1000.0;
+	batch.pid = (zbx_uint32_t)getpid();
+	batch.session = ++icmp_session;
+	batch.outstanding = 0;
+
+	for (i = 0; i < hosts_count; i++)
+	{
+		target = &batch.targets[batch.targets_num];
+		target->host = &hosts[i];
+
+		if (SUCCEED != icmp_resolve_target(target))
+			continue;
+
+		if (SUCCEED != icmp_socket_open(icmp_get_socket(target->family), target->family, error,
+				max_error_len))
+		{
+			goto out;
+		}
+
+		target->sent = zbx_malloc(NULL, sizeof(double) * count);
+		memset(target->sent, 0, sizeof(double) * count);
+
+		hosts[i].status = zbx_malloc(NULL, count);
+		memset(hosts[i].status, 0, count);
+
+		batch.targets_num++;
+	}
+
+	len = sizeof(zbx_icmp_header_t) + MAX((size_t)(0 != size ? size : ZBX_ICMP_DEFAULT_SIZE),
+			sizeof(zbx_icmp_payload_t));
+	packet = zbx_malloc(NULL, len);
+	memset(packet, 0, len);
+
+	for (probe = 0, round_start = 0; probe < count && 0 != batch.targets_num; probe++)
+	{
+		/* keep the interval between probes to the same target */
+		if (0 != probe)
+			icmp_receive(&batch, round_start + (0 != interval ? interval : ZBX_ICMP_DEFAULT_INTERVAL) /
+					1000.0, 0);
+
+		next_send = round_start = zbx_time();
+
+		for (i = 0; i < batch.targets_num; i++)
+		{
+			icmp_receive(&batch, next_send, 0);
+			icmp_send_probe(&batch, i, probe, packet, len);
+			next_send = (last_send = zbx_time()) + ZBX_ICMP_SEND_GAP;
+		}
+	}
+
+	/* wait for the replies to the last probes */
+	if (0 != batch.targets_num)
+		icmp_receive(&batch, last_send + batch.timeout, 1);
+
+	zbx_free(packet);
+
+	for (i = 0; i < batch.targets_num; i++)
+		batch.targets[i].host->cnt += count;
+
+	ret = SUCCEED;
+out:
+	for (i = 0; i < batch.targets_num; i++)
+	{
+		zbx_free(batch.targets[i].sent);
+		zbx_free(batch.targets[i].host->status);
+	}
+
+	zbx_free(batch.targets);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return ret;
+}
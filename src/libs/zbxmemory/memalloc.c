@@ -89,8 +89,30 @@
  *  lo_bound             `size' fields in chunk B                   hi_bound  *
  *  (aligned)            have MEM_FLG_USED bit set                 (aligned)  *
  *                                                                            *
+ *                                                                            *
+ * (*) when slabs are enabled, small allocations are served from slab pages  *
+ *                                                                            *
+ *     a slab page is a used chunk of MEM_SLAB_PAGE_SIZE bytes split into     *
+ *     objects of the same size class (multiples of 8 up to MEM_SLAB_MAX_SIZE)*
+ *                                                                            *
+ *            page header   object        object        object                *
+ *     |----|-----------|----|-------|----|-------|----|-------|...|----|     *
+ *                        ^                                                   *
+ *                        |                                                   *
+ *           8-byte object header with MEM_FLG_SLAB bit set, the offset       *
+ *           of the object in its page and the requested size                 *
+ *                                                                            *
+ *     pages with free objects are kept in doubly-linked lists per size       *
+ *     class, free objects are kept in a singly-linked list per page, so      *
+ *     both allocation and freeing take constant time                         *
+ *                                                                            *
+ *     a page is returned to the chunk allocator when all its objects are     *
+ *     freed, unless it is the only page of its class with free objects       *
+ *                                                                            *
  ******************************************************************************/
 
+extern int	CONFIG_HUGE_PAGES;
+
 #define LOCK_INFO	if (1 == info->use_lock) zbx_mutex_lock(&info->mem_lock)
 #define UNLOCK_INFO	if (1 == info->use_lock) zbx_mutex_unlock(&info->mem_lock)
 
@@ -118,9 +140,14 @@ static void	*__mem_malloc(zbx_mem_info_t *info, zbx_uint64_t size);
 static void	*__mem_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size);
 static void	__mem_free(zbx_mem_info_t *info, void *ptr);
 
+static void	*mem_slab_malloc(zbx_mem_info_t *info, zbx_uint64_t size);
+static void	*mem_slab_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size);
+static void	mem_slab_free(zbx_mem_info_t *info, void *ptr);
+
 #define MEM_SIZE_FIELD		sizeof(zbx_uint64_t)
 
 #define MEM_FLG_USED		((__UINT64_C(1))<<63)
+#define MEM_FLG_SLAB		((__UINT64_C(1))<<62)
 
 #define FREE_CHUNK(ptr)		(((*(zbx_uint64_t *)(ptr)) & MEM_FLG_USED) == 0)
 #define CHUNK_SIZE(ptr)		((*(zbx_uint64_t *)(ptr)) & ~MEM_FLG_USED)
@@ -134,6 +161,30 @@ static void	__mem_free(zbx_mem_info_t *info, void *ptr);
 #define MEM_MAX_BUCKET_SIZE	256 /* starting from this size all free chunks are put into the same bucket */
 #define MEM_BUCKET_COUNT	((MEM_MAX_BUCKET_SIZE - MEM_MIN_BUCKET_SIZE) / 8 + 1)
 
+#define MEM_SLAB_MAX_SIZE	256	/* allocations up to this size are served from slabs, multiple of 8 */
+#define MEM_SLAB_CLASS_COUNT	(MEM_SLAB_MAX_SIZE / 8)
+#define MEM_SLAB_PAGE_SIZE	8192
+
+#define SLAB_OBJECT(ptr)	(((*(zbx_uint64_t *)(ptr)) & MEM_FLG_SLAB) != 0)
+#define SLAB_OBJECT_OFFSET(ptr)	(((*(zbx_uint64_t *)(ptr)) >> 32) & 0xffff)
+#define SLAB_OBJECT_SIZE(ptr)	((*(zbx_uint64_t *)(ptr)) & 0xffffffff)
+
+#define MEM_SLAB_CLASS_SIZE(index)	(((index) + 1) << 3)
+
+typedef struct zbx_mem_slab_page
+{
+	struct zbx_mem_slab_page	*prev;
+	struct zbx_mem_slab_page	*next;
+	void				*free_list;
+	unsigned int			objects_num;
+	unsigned int			used_num;
+	unsigned int			unused_index;	/* objects starting with this index were never allocated */
+	int				class_index;
+}
+zbx_mem_slab_page_t;
+
+#define MEM_SLAB_PAGE_HEADER	((sizeof(zbx_mem_slab_page_t) + 7) & ~(size_t)7)
+
 /* helper functions */
 
 static void	*ALIGN4(void *ptr)
@@ -538,6 +589,281 @@ static void	__mem_free(zbx_mem_info_t *info, void *ptr)
 	}
 }
 
+/* slab functions */
+
+static int	mem_slab_class_by_size(zbx_uint64_t size)
+{
+	return (int)((size - 1) >> 3);
+}
+
+static zbx_uint64_t	mem_slab_object_size(int index)
+{
+	return MEM_SIZE_FIELD + MEM_SLAB_CLASS_SIZE(index);
+}
+
+static void	mem_slab_link_page(zbx_mem_slab_class_t *slab, zbx_mem_slab_page_t *page)
+{
+	page->prev = NULL;
+	page->next = slab->pages;
+
+	if (NULL != page->next)
+		page->next->prev = page;
+
+	slab->pages = page;
+}
+
+static void	mem_slab_unlink_page(zbx_mem_slab_class_t *slab, zbx_mem_slab_page_t *page)
+{
+	if (NULL != page->prev)
+		page->prev->next = page->next;
+	else
+		slab->pages = page->next;
+
+	if (NULL != page->next)
+		page->next->prev = page->prev;
+}
+
+static zbx_mem_slab_page_t	*mem_slab_create_page(zbx_mem_info_t *info, int index)
+{
+	void			*chunk;
+	zbx_mem_slab_page_t	*page;
+	zbx_uint64_t		objects_size;
+	char			allow_oom;
+
+	/* failing to allocate a page is not fatal, the allocation will fall back to chunk allocator */
+	allow_oom = info->allow_oom;
+	info->allow_oom = 1;
+	chunk = __mem_malloc(info, MEM_SLAB_PAGE_SIZE);
+	info->allow_oom = allow_oom;
+
+	if (NULL == chunk)
+		return NULL;
+
+	page = (zbx_mem_slab_page_t *)((char *)chunk + MEM_SIZE_FIELD);
+	page->free_list = NULL;
+	page->objects_num = (MEM_SLAB_PAGE_SIZE - MEM_SLAB_PAGE_HEADER) / mem_slab_object_size(index);
+	page->used_num = 0;
+	page->unused_index = 0;
+	page->class_index = index;
+
+	mem_slab_link_page(&info->slabs[index], page);
+	info->slabs[index].pages_num++;
+
+	/* account unallocated objects as free memory */
+	objects_size = page->objects_num * mem_slab_object_size(index);
+	info->used_size -= objects_size;
+	info->free_size += objects_size;
+
+	return page;
+}
+
+static void	mem_slab_release_page(zbx_mem_info_t *info, zbx_mem_slab_page_t *page)
+{
+	zbx_mem_slab_class_t	*slab = &info->slabs[page->class_index];
+	zbx_uint64_t		objects_size;
+
+	mem_slab_unlink_page(slab, page);
+	slab->pages_num--;
+
+	objects_size = page->objects_num * mem_slab_object_size(page->class_index);
+	info->used_size += objects_size;
+	info->free_size -= objects_size;
+
+	__mem_free(info, page);
+}
+
+static void	*mem_slab_malloc(zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	int			index;
+	void			*object;
+	zbx_mem_slab_class_t	*slab;
+	zbx_mem_slab_page_t	*page;
+	zbx_uint64_t		object_size;
+
+	index = mem_slab_class_by_size(size);
+	slab = &info->slabs[index];
+	object_size = mem_slab_object_size(index);
+
+	if (NULL == (page = slab->pages) && NULL == (page = mem_slab_create_page(info, index)))
+		return NULL;
+
+	if (NULL != page->free_list)
+	{
+		object = page->free_list;
+		page->free_list = *(void **)((char *)object + MEM_SIZE_FIELD);
+	}
+	else
+		object = (char *)page + MEM_SLAB_PAGE_HEADER + page->unused_index++ * object_size;
+
+	if (++page->used_num == page->objects_num)
+		mem_slab_unlink_page(slab, page);
+
+	*(zbx_uint64_t *)object = MEM_FLG_USED | MEM_FLG_SLAB |
+			((zbx_uint64_t)((char *)object - (char *)page) << 32) | size;
+
+	slab->used_num++;
+	slab->requested_size += size;
+
+	info->used_size += object_size;
+	info->free_size -= object_size;
+
+	return object;
+}
+
+static void	mem_slab_free(zbx_mem_info_t *info, void *ptr)
+{
+	void			*object;
+	zbx_mem_slab_class_t	*slab;
+	zbx_mem_slab_page_t	*page;
+	zbx_uint64_t		object_size;
+
+	object = (void *)((char *)ptr - MEM_SIZE_FIELD);
+	page = (zbx_mem_slab_page_t *)((char *)object - SLAB_OBJECT_OFFSET(object));
+	slab = &info->slabs[page->class_index];
+	object_size = mem_slab_object_size(page->class_index);
+
+	slab->used_num--;
+	slab->requested_size -= SLAB_OBJECT_SIZE(object);
+
+	info->used_size -= object_size;
+	info->free_size += object_size;
+
+	*(zbx_uint64_t *)object &= ~MEM_FLG_USED;
+	*(void **)ptr = page->free_list;
+	page->free_list = object;
+
+	if (page->used_num-- == page->objects_num)
+	{
+		mem_slab_link_page(slab, page);
+		return;
+	}
+
+	/* keep the last page with free objects to avoid page allocation on every other malloc */
+	if (0 == page->used_num && (NULL != page->prev || NULL != page->next))
+		mem_slab_release_page(info, page);
+}
+
+static void	*mem_slab_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size)
+{
+	void			*object, *chunk;
+	zbx_mem_slab_page_t	*page;
+	zbx_uint64_t		class_size;
+
+	object = (void *)((char *)old - MEM_SIZE_FIELD);
+	page = (zbx_mem_slab_page_t *)((char *)object - SLAB_OBJECT_OFFSET(object));
+	class_size = MEM_SLAB_CLASS_SIZE(page->class_index);
+
+	/* do not reallocate if not much is freed, like the chunk allocator does */
+	if (size <= class_size && size > class_size / 4)
+	{
+		info->slabs[page->class_index].requested_size += size - SLAB_OBJECT_SIZE(object);
+		*(zbx_uint64_t *)object = (*(zbx_uint64_t *)object & ~(zbx_uint64_t)0xffffffff) | size;
+
+		return object;
+	}
+
+	if (MEM_SLAB_MAX_SIZE < size || NULL == (chunk = mem_slab_malloc(info, size)))
+	{
+		if (NULL == (chunk = __mem_malloc(info, size)))
+			return NULL;
+	}
+
+	memcpy((char *)chunk + MEM_SIZE_FIELD, old, MIN(size, class_size));
+
+	mem_slab_free(info, old);
+
+	return chunk;
+}
+
+static void	*mem_malloc(zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	void	*chunk;
+
+	if (NULL != info->slabs && MEM_SLAB_MAX_SIZE >= size && NULL != (chunk = mem_slab_malloc(info, size)))
+		return chunk;
+
+	return __mem_malloc(info, size);
+}
+
+static void	*mem_realloc(zbx_mem_info_t *info, void *old, zbx_uint64_t size)
+{
+	if (SLAB_OBJECT((char *)old - MEM_SIZE_FIELD))
+		return mem_slab_realloc(info, old, size);
+
+	return __mem_realloc(info, old, size);
+}
+
+static void	mem_free(zbx_mem_info_t *info, void *ptr)
+{
+	if (SLAB_OBJECT((char *)ptr - MEM_SIZE_FIELD))
+		mem_slab_free(info, ptr);
+	else
+		__mem_free(info, ptr);
+}
+
+static void	mem_slab_init(zbx_mem_info_t *info)
+{
+	void	*chunk;
+
+	if (NULL == (chunk = __mem_malloc(info, MEM_SLAB_CLASS_COUNT * sizeof(zbx_mem_slab_class_t))))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot allocate slab classes for %s", info->mem_descr);
+		exit(EXIT_FAILURE);
+	}
+
+	info->slabs = (zbx_mem_slab_class_t *)((char *)chunk + MEM_SIZE_FIELD);
+	memset(info->slabs, 0, MEM_SLAB_CLASS_COUNT * sizeof(zbx_mem_slab_class_t));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: mem_shmget_huge                                                  *
+ *                                                                            *
+ * Purpose: create shared memory segment backed by huge pages                 *
+ *                                                                            *
+ * Parameters: shm_key - [IN] the IPC key                                     *
+ *             size    - [IN] the requested segment size                      *
+ *             descr   - [IN] the segment description                         *
+ *                                                                            *
+ * Return value: the shared memory identifier or -1 if huge pages cannot be   *
+ *               used                                                         *
+ *                                                                            *
+ * Comments: The segment size is rounded up to huge page size. Segments       *
+ *           smaller than a huge page are left to regular pages.              *
+ *                                                                            *
+ ******************************************************************************/
+static int	mem_shmget_huge(key_t shm_key, zbx_uint64_t size, const char *descr)
+{
+	size_t	page_size;
+	int	shm_id;
+
+	if (0 == (page_size = zbx_shm_huge_page_size()))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "huge pages are not supported, %s will use regular pages", descr);
+		return -1;
+	}
+
+	if (size < page_size)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "%s is smaller than huge page, using regular pages", descr);
+		return -1;
+	}
+
+	size = (size + page_size - 1) / page_size * page_size;
+
+	if (-1 == (shm_id = zbx_shmget_huge(shm_key, size)))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot allocate " ZBX_FS_UI64 " bytes of huge pages for %s: %s,"
+				" using regular pages", size, descr, zbx_strerror(errno));
+		return -1;
+	}
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s: allocated " ZBX_FS_UI64 " bytes in " ZBX_FS_SIZE_T " kB huge pages",
+			descr, size, (zbx_fs_size_t)(page_size / ZBX_KIBIBYTE));
+
+	return shm_id;
+}
+
 /* public memory interface */
 
 void	zbx_mem_create(zbx_mem_info_t **info, key_t shm_key, int lock_name, zbx_uint64_t size,
@@ -547,6 +873,7 @@ void	zbx_mem_create(zbx_mem_info_t **info, key_t shm_key, int lock_name, zbx_uin
 
 	int		shm_id, index;
 	void		*base;
+	char		huge_pages = 0;
 
 	descr = ZBX_NULL2STR(descr);
 	param = ZBX_NULL2STR(param);
@@ -570,7 +897,9 @@ void	zbx_mem_create(zbx_mem_info_t **info, key_t shm_key, int lock_name, zbx_uin
 		exit(EXIT_FAILURE);
 	}
 
-	if (-1 == (shm_id = zbx_shmget(shm_key, size)))
+	if (0 != CONFIG_HUGE_PAGES && -1 != (shm_id = mem_shmget_huge(shm_key, size, descr)))
+		huge_pages = 1;
+	else if (-1 == (shm_id = zbx_shmget(shm_key, size)))
 	{
 		zabbix_log(LOG_LEVEL_CRIT, "cannot allocate shared memory for %s", descr);
 		exit(EXIT_FAILURE);
@@ -587,6 +916,7 @@ void	zbx_mem_create(zbx_mem_info_t **info, key_t shm_key, int lock_name, zbx_uin
 	*info = ALIGN8(base);
 	(*info)->shm_id = shm_id;
 	(*info)->orig_size = size;
+	(*info)->huge_pages = huge_pages;
 	size -= (char *)(*info + 1) - (char *)base;
 
 	base = (void *)(*info + 1);
@@ -607,6 +937,7 @@ void	zbx_mem_create(zbx_mem_info_t **info, key_t shm_key, int lock_name, zbx_uin
 	base = (void *)((char *)base + strlen(param) + 1);
 
 	(*info)->allow_oom = allow_oom;
+	(*info)->slabs = NULL;
 
 	/* allocate mutex */
 
@@ -665,6 +996,31 @@ void	zbx_mem_destroy(zbx_mem_info_t *info)
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_enable_slabs                                             *
+ *                                                                            *
+ * Purpose: serve small allocations from per size class slab pages           *
+ *                                                                            *
+ * Parameters: info - [IN] the shared memory                                  *
+ *                                                                            *
+ * Comments: Slabs make allocation and freeing of small objects constant time *
+ *           and reduce per object overhead from 16 to 8 bytes, at the cost   *
+ *           of keeping up to MEM_SLAB_PAGE_SIZE bytes of partially used      *
+ *           pages per size class.                                            *
+ *           Must be called right after zbx_mem_create(), before allocating  *
+ *           any memory.                                                      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_enable_slabs(zbx_mem_info_t *info)
+{
+	LOCK_INFO;
+
+	mem_slab_init(info);
+
+	UNLOCK_INFO;
+}
+
 void	*__zbx_mem_malloc(const char *file, int line, zbx_mem_info_t *info, const void *old, size_t size)
 {
 	const char	*__function_name = "zbx_mem_malloc";
@@ -687,7 +1043,7 @@ void	*__zbx_mem_malloc(const char *file, int line, zbx_mem_info_t *info, const v
 
 	LOCK_INFO;
 
-	chunk = __mem_malloc(info, size);
+	chunk = mem_malloc(info, size);
 
 	UNLOCK_INFO;
 
@@ -722,9 +1078,9 @@ void	*__zbx_mem_realloc(const char *file, int line, zbx_mem_info_t *info, void *
 	LOCK_INFO;
 
 	if (NULL == old)
-		chunk = __mem_malloc(info, size);
+		chunk = mem_malloc(info, size);
 	else
-		chunk = __mem_realloc(info, old, size);
+		chunk = mem_realloc(info, old, size);
 
 	UNLOCK_INFO;
 
@@ -756,7 +1112,7 @@ void	__zbx_mem_free(const char *file, int line, zbx_mem_info_t *info, void *ptr)
 
 	LOCK_INFO;
 
-	__mem_free(info, ptr);
+	mem_free(info, ptr);
 
 	UNLOCK_INFO;
 }
@@ -780,6 +1136,9 @@ void	zbx_mem_clear(zbx_mem_info_t *info)
 	info->used_size = 0;
 	info->free_size = info->total_size;
 
+	if (NULL != info->slabs)
+		mem_slab_init(info);
+
 	UNLOCK_INFO;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
@@ -831,6 +1190,67 @@ void	zbx_mem_dump_stats(zbx_mem_info_t *info)
 	UNLOCK_INFO;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_log_stats                                                *
+ *                                                                            *
+ * Purpose: write shared memory fragmentation statistics to log               *
+ *                                                                            *
+ * Parameters: info - [IN] the shared memory                                  *
+ *                                                                            *
+ * Comments: External fragmentation is the part of free chunk memory that    *
+ *           cannot be allocated with a single request, slab waste is the    *
+ *           part of slab object memory not requested by allocations.         *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_log_stats(zbx_mem_info_t *info)
+{
+	void		*chunk;
+	int		index;
+	zbx_uint64_t	chunks_num = 0, chunks_size = 0, max_size = 0, objects_num, objects_size;
+
+	LOCK_INFO;
+
+	for (index = 0; index < MEM_BUCKET_COUNT; index++)
+	{
+		for (chunk = info->buckets[index]; NULL != chunk; chunk = mem_get_next_chunk(chunk))
+		{
+			chunks_num++;
+			chunks_size += CHUNK_SIZE(chunk);
+			max_size = MAX(max_size, CHUNK_SIZE(chunk));
+		}
+	}
+
+	zabbix_log(LOG_LEVEL_WARNING, "== %s allocator statistics ==", info->mem_descr);
+	zabbix_log(LOG_LEVEL_WARNING, "  total:" ZBX_FS_UI64 " used:" ZBX_FS_UI64 " free:" ZBX_FS_UI64
+			" huge pages:%s", info->total_size, info->used_size, info->free_size,
+			(1 == info->huge_pages ? "yes" : "no"));
+	zabbix_log(LOG_LEVEL_WARNING, "  free chunks:" ZBX_FS_UI64 " bytes:" ZBX_FS_UI64 " largest:" ZBX_FS_UI64
+			" fragmentation:%.2f%%", chunks_num, chunks_size, max_size,
+			0 == chunks_size ? 0.0 : 100.0 * (double)(chunks_size - max_size) / (double)chunks_size);
+
+	for (index = 0; NULL != info->slabs && index < MEM_SLAB_CLASS_COUNT; index++)
+	{
+		const zbx_mem_slab_class_t	*slab = &info->slabs[index];
+
+		if (0 == slab->pages_num)
+			continue;
+
+		objects_num = slab->pages_num * ((MEM_SLAB_PAGE_SIZE - MEM_SLAB_PAGE_HEADER) /
+				mem_slab_object_size(index));
+		objects_size = slab->used_num * MEM_SLAB_CLASS_SIZE(index);
+
+		zabbix_log(LOG_LEVEL_WARNING, "  slab %3d bytes pages:" ZBX_FS_UI64 " objects:" ZBX_FS_UI64 "/"
+				ZBX_FS_UI64 " utilization:%.2f%% waste:%.2f%%", MEM_SLAB_CLASS_SIZE(index),
+				slab->pages_num, slab->used_num, objects_num,
+				100.0 * (double)slab->used_num / (double)objects_num,
+				0 == objects_size ? 0.0 :
+				100.0 * (double)(objects_size - slab->requested_size) / (double)objects_size);
+	}
+
+	UNLOCK_INFO;
+}
+
 size_t	zbx_mem_required_size(int chunks_num, const char *descr, const char *param)
 {
 	const char	*__function_name = "zbx_mem_required_size";
@@ -860,3 +1280,184 @@ size_t	zbx_mem_required_size(int chunks_num, const char *descr, const char *para
 
 	return size;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_chunk_size                                               *
+ *                                                                            *
+ * Purpose: get the shared memory consumed by allocation of the specified     *
+ *          size, including chunk or slab object overhead                     *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_mem_chunk_size(const zbx_mem_info_t *info, zbx_uint64_t size)
+{
+	if (NULL != info->slabs && MEM_SLAB_MAX_SIZE >= size)
+		return mem_slab_object_size(mem_slab_class_by_size(size));
+
+	return mem_proper_alloc_size(size) + 2 * MEM_SIZE_FIELD;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_used_size                                                *
+ *                                                                            *
+ * Purpose: get the shared memory consumed by allocated chunks, including     *
+ *          chunk overhead                                                    *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_mem_used_size(const zbx_mem_info_t *info)
+{
+	return info->total_size - info->free_size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_hashset_size                                             *
+ *                                                                            *
+ * Purpose: estimate the shared memory consumed by hashset                    *
+ *                                                                            *
+ * Parameters: info      - [IN] the shared memory the hashset is allocated in *
+ *             hashset   - [IN] the hashset                                   *
+ *             data_size - [IN] the size of data stored in hashset entries    *
+ *                                                                            *
+ * Comments: Memory referenced by the hashset data (strings, vectors, etc) is *
+ *           not included.                                                    *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_mem_hashset_size(const zbx_mem_info_t *info, const zbx_hashset_t *hashset, size_t data_size)
+{
+	zbx_uint64_t	size;
+
+	size = zbx_mem_chunk_size(info, hashset->num_slots * sizeof(ZBX_HASHSET_ENTRY_T *));
+	size += hashset->num_data * zbx_mem_chunk_size(info, offsetof(ZBX_HASHSET_ENTRY_T, data) + data_size);
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_binary_heap_size                                         *
+ *                                                                            *
+ * Purpose: estimate the shared memory consumed by binary heap                *
+ *                                                                            *
+ ******************************************************************************/
+zbx_uint64_t	zbx_mem_binary_heap_size(const zbx_mem_info_t *info, const zbx_binary_heap_t *heap)
+{
+	zbx_uint64_t	size = 0;
+
+	if (0 != heap->elems_alloc)
+		size += zbx_mem_chunk_size(info, heap->elems_alloc * sizeof(zbx_binary_heap_elem_t));
+
+	if (NULL != heap->key_index)
+	{
+		size += zbx_mem_chunk_size(info, sizeof(zbx_hashmap_t));
+		size += zbx_mem_chunk_size(info, heap->key_index->num_slots * sizeof(ZBX_HASHMAP_SLOT_T));
+		size += heap->key_index->num_data * sizeof(ZBX_HASHMAP_ENTRY_T);
+	}
+
+	return size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_usage_add                                                *
+ *                                                                            *
+ * Purpose: add cache structure memory usage to the usage vector              *
+ *                                                                            *
+ * Parameters: usage - [IN/OUT] the memory usage vector                       *
+ *             name  - [IN] the structure name, must be static string         *
+ *             count - [IN] the number of objects                             *
+ *             bytes - [IN] the memory used by objects                        *
+ *                                                                            *
+ * Comments: The usage vector must be cleared with zbx_ptr_free() function.   *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_usage_add(zbx_vector_ptr_t *usage, const char *name, zbx_uint64_t count, zbx_uint64_t bytes)
+{
+	zbx_mem_usage_t	*mem_usage;
+
+	mem_usage = zbx_malloc(NULL, sizeof(zbx_mem_usage_t));
+	mem_usage->name = name;
+	mem_usage->count = count;
+	mem_usage->bytes = bytes;
+
+	zbx_vector_ptr_append(usage, mem_usage);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_usage_add_other                                          *
+ *                                                                            *
+ * Purpose: add the memory not accounted by other usage vector entries        *
+ *                                                                            *
+ * Parameters: usage     - [IN/OUT] the memory usage vector                   *
+ *             used_size - [IN] the total used memory of the cache            *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_usage_add_other(zbx_vector_ptr_t *usage, zbx_uint64_t used_size)
+{
+	zbx_uint64_t	bytes = 0;
+	int		i;
+
+	for (i = 0; i < usage->values_num; i++)
+		bytes += ((const zbx_mem_usage_t *)usage->values[i])->bytes;
+
+	zbx_mem_usage_add(usage, "other", 0, (used_size > bytes ? used_size - bytes : 0));
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_usage_search                                             *
+ *                                                                            *
+ * Purpose: find cache structure memory usage by structure name               *
+ *                                                                            *
+ ******************************************************************************/
+const zbx_mem_usage_t	*zbx_mem_usage_search(const zbx_vector_ptr_t *usage, const char *name)
+{
+	int	i;
+
+	for (i = 0; i < usage->values_num; i++)
+	{
+		const zbx_mem_usage_t	*mem_usage = (const zbx_mem_usage_t *)usage->values[i];
+
+		if (0 == strcmp(mem_usage->name, name))
+			return mem_usage;
+	}
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mem_usage_log                                                *
+ *                                                                            *
+ * Purpose: write cache structure memory usage to log                         *
+ *                                                                            *
+ * Parameters: descr - [IN] the cache description                             *
+ *             usage - [IN] the memory usage vector                           *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mem_usage_log(const char *descr, const zbx_vector_ptr_t *usage)
+{
+	zbx_uint64_t	bytes = 0;
+	int		i;
+
+	for (i = 0; i < usage->values_num; i++)
+		bytes += ((const zbx_mem_usage_t *)usage->values[i])->bytes;
+
+	zabbix_log(LOG_LEVEL_WARNING, "== %s memory usage: " ZBX_FS_UI64 " bytes ==", descr, bytes);
+
+	for (i = 0; i < usage->values_num; i++)
+	{
+		const zbx_mem_usage_t	*mem_usage = (const zbx_mem_usage_t *)usage->values[i];
+
+		if (0 == mem_usage->count)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "  %-20s bytes:" ZBX_FS_UI64, mem_usage->name, mem_usage->bytes);
+			continue;
+		}
+
+		zabbix_log(LOG_LEVEL_WARNING, "  %-20s bytes:" ZBX_FS_UI64 " count:" ZBX_FS_UI64 " avg:" ZBX_FS_UI64,
+				mem_usage->name, mem_usage->bytes, mem_usage->count, mem_usage->bytes / mem_usage->count);
+	}
+}
@@ -54,6 +54,20 @@ ZBX_MEM_FUNC_IMPL(__strpool, strpool.mem_info);
 
 /* public strpool interface */
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_strpool_create                                               *
+ *                                                                            *
+ * Purpose: create string pool in shared memory                               *
+ *                                                                            *
+ * Parameters: size - [IN] the string pool memory size                        *
+ *                                                                            *
+ * Comments: The pool has no locks of its own, it is used only by             *
+ *           configuration cache and is protected by its lock: strings are    *
+ *           added and released under the write lock, the read lock is enough *
+ *           for statistics.                                                  *
+ *                                                                            *
+ ******************************************************************************/
 void	zbx_strpool_create(size_t size)
 {
 	const char	*__function_name = "zbx_strpool_create";
@@ -69,6 +83,7 @@ void	zbx_strpool_create(size_t size)
 	}
 
 	zbx_mem_create(&strpool.mem_info, shm_key, ZBX_NO_MUTEX, size, "string pool", "CacheSize", 0);
+	zbx_mem_enable_slabs(strpool.mem_info);
 
 	strpool.hashset = __strpool_mem_malloc_func(NULL, sizeof(zbx_hashset_t));
 	zbx_hashset_create_ext(strpool.hashset, INIT_HASHSET_SIZE,
@@ -89,6 +104,17 @@ void	zbx_strpool_destroy()
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_strpool_intern                                               *
+ *                                                                            *
+ * Purpose: get a reference to pooled copy of the string                      *
+ *                                                                            *
+ * Parameters: str - [IN] the string                                          *
+ *                                                                            *
+ * Return value: the pooled string                                            *
+ *                                                                            *
+ ******************************************************************************/
 const char	*zbx_strpool_intern(const char *str)
 {
 	void		*record;
@@ -148,3 +174,109 @@ const zbx_strpool_t	*zbx_strpool_info()
 {
 	return &strpool;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_strpool_get_counts                                           *
+ *                                                                            *
+ * Purpose: get the number of pooled strings and allocated hashset slots      *
+ *                                                                            *
+ * Parameters: num_data  - [OUT] the number of strings                        *
+ *             num_slots - [OUT] the number of hashset slots                  *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_strpool_get_counts(int *num_data, int *num_slots)
+{
+	*num_data = strpool.hashset->num_data;
+	*num_slots = strpool.hashset->num_slots;
+}
+
+typedef struct
+{
+	const char	*str;
+	zbx_uint32_t	refcount;
+	zbx_uint64_t	size;		/* the memory the string would use without pooling */
+}
+zbx_strpool_top_t;
+
+static int	strpool_top_compare(const void *d1, const void *d2)
+{
+	const zbx_strpool_top_t	*t1 = (const zbx_strpool_top_t *)d1;
+	const zbx_strpool_top_t	*t2 = (const zbx_strpool_top_t *)d2;
+
+	ZBX_RETURN_IF_NOT_EQUAL(t2->size, t1->size);
+
+	return 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_strpool_log_top                                              *
+ *                                                                            *
+ * Purpose: write the strings using most of the string pool memory to log     *
+ *                                                                            *
+ * Parameters: top_num - [IN] the number of strings to report                 *
+ *                                                                            *
+ * Comments: The strings are ordered by the memory they would use without     *
+ *           pooling (number of references multiplied by size) and reported   *
+ *           with the memory saved by deduplication.                          *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_strpool_log_top(int top_num)
+{
+	zbx_hashset_iter_t	iter;
+	void			*record;
+	zbx_strpool_top_t	*top;
+	int			top_size = 0, i;
+	zbx_uint64_t		total_size = 0, pooled_size = 0;
+	char			buffer[64];
+	const char		*src;
+	size_t			len;
+
+	top = zbx_malloc(NULL, (top_num + 1) * sizeof(zbx_strpool_top_t));
+
+	zbx_hashset_iter_reset(strpool.hashset, &iter);
+
+	while (NULL != (record = zbx_hashset_iter_next(&iter)))
+	{
+		zbx_strpool_top_t	item;
+
+		item.str = (const char *)record + REFCOUNT_FIELD_SIZE;
+		item.refcount = *(zbx_uint32_t *)record;
+		len = strlen(item.str) + 1;
+		item.size = (zbx_uint64_t)item.refcount * len;
+
+		total_size += item.size;
+		pooled_size += len;
+
+		if (top_size == top_num && (0 == top_num || 0 >= strpool_top_compare(&top[top_size - 1], &item)))
+			continue;
+
+		/* insert the string into sorted top list, the last element is dropped when the list is full */
+		for (i = top_size; 0 < i && 0 < strpool_top_compare(&top[i - 1], &item); i--)
+			top[i] = top[i - 1];
+
+		top[i] = item;
+
+		if (top_size < top_num)
+			top_size++;
+	}
+
+	zabbix_log(LOG_LEVEL_WARNING, "== string pool: %d strings, " ZBX_FS_UI64 " bytes referenced, " ZBX_FS_UI64
+			" bytes stored ==", strpool.hashset->num_data, total_size, pooled_size);
+
+	for (i = 0; i < top_size; i++)
+	{
+		/* show only beginning of the string with non-printable characters replaced */
+		for (src = top[i].str, len = 0; '\0' != *src && len < sizeof(buffer) - 1; src++)
+			buffer[len++] = (0 != isprint((unsigned char)*src) ? *src : '?');
+
+		buffer[len] = '\0';
+
+		zabbix_log(LOG_LEVEL_WARNING, "  refs:%u size:" ZBX_FS_SIZE_T " total:" ZBX_FS_UI64 " saved:" ZBX_FS_UI64
+				" \"%s%s\"", top[i].refcount, (zbx_fs_size_t)strlen(top[i].str) + 1, top[i].size,
+				top[i].size - top[i].size / top[i].refcount, buffer, '\0' != *src ? "..." : "");
+	}
+
+	zbx_free(top);
+}
@@ -152,6 +152,27 @@ int	parse_rtc_options(const char *opt, unsigned char program_type, int *message)
 		scope = 0;
 		data = 0;
 	}
+	else if (0 != (program_type & (ZBX_PROGRAM_TYPE_SERVER | ZBX_PROGRAM_TYPE_PROXY)) &&
+			0 == strcmp(opt, ZBX_MEMORY_REPORT))
+	{
+		command = ZBX_RTC_MEMORY_REPORT;
+		scope = 0;
+		data = 0;
+	}
+	else if (0 != (program_type & (ZBX_PROGRAM_TYPE_SERVER | ZBX_PROGRAM_TYPE_PROXY)) &&
+			0 == strcmp(opt, ZBX_LATENCY_REPORT))
+	{
+		command = ZBX_RTC_LATENCY_REPORT;
+		scope = 0;
+		data = 0;
+	}
+	else if (0 != (program_type & (ZBX_PROGRAM_TYPE_SERVER | ZBX_PROGRAM_TYPE_PROXY)) &&
+			0 == strcmp(opt, ZBX_LOCK_REPORT))
+	{
+		command = ZBX_RTC_LOCK_REPORT;
+		scope = 0;
+		data = 0;
+	}
 	else
 	{
 		zbx_error("invalid runtime control option: %s", opt);
@@ -44,6 +44,9 @@ extern int	get_process_info_by_thread(int local_server_num, unsigned char *local
 
 static void	(*zbx_sigusr_handler)(int flags);
 
+/* runtime control commands deferred to main process, see ZBX_RTC_PENDING() */
+static volatile sig_atomic_t	rtc_pending = 0;
+
 #ifdef HAVE_SIGQUEUE
 /******************************************************************************
  *                                                                            *
@@ -227,6 +230,12 @@ static void	user1_signal_handler(int sig, siginfo_t *siginfo, void *context)
 		case ZBX_RTC_HOUSEKEEPER_EXECUTE:
 			zbx_signal_process_by_type(ZBX_PROCESS_TYPE_HOUSEKEEPER, 1, flags);
 			break;
+		case ZBX_RTC_MEMORY_REPORT:
+		case ZBX_RTC_LATENCY_REPORT:
+		case ZBX_RTC_LOCK_REPORT:
+			/* reports are written by main process which has access to all caches */
+			rtc_pending |= ZBX_RTC_PENDING(ZBX_RTC_GET_MSG(flags));
+			break;
 		case ZBX_RTC_LOG_LEVEL_INCREASE:
 		case ZBX_RTC_LOG_LEVEL_DECREASE:
 			if ((ZBX_RTC_LOG_SCOPE_FLAG | ZBX_RTC_LOG_SCOPE_PID) == ZBX_RTC_GET_SCOPE(flags))
@@ -435,3 +444,34 @@ int	zbx_sigusr_send(int flags)
 
 	return ret;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_rtc_get_pending                                              *
+ *                                                                            *
+ * Purpose: get runtime control commands deferred to main process and reset   *
+ *          them                                                              *
+ *                                                                            *
+ * Return value: mask of pending commands, check with ZBX_RTC_PENDING()       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_rtc_get_pending(void)
+{
+	sigset_t	mask, orig_mask;
+	int		pending;
+
+	if (0 == rtc_pending)
+		return 0;
+
+	/* block the user signal so that commands received meanwhile are not lost */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGUSR1);
+	sigprocmask(SIG_BLOCK, &mask, &orig_mask);
+
+	pending = rtc_pending;
+	rtc_pending = 0;
+
+	sigprocmask(SIG_SETMASK, &orig_mask, NULL);
+
+	return pending;
+}
@@ -51,6 +51,36 @@ key_t	zbx_ftok(char *path, int id)
 	return ipc_key;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: ipc_shm_remove                                                   *
+ *                                                                            *
+ * Purpose: mark existing shared memory block with the specified key for      *
+ *          deletion, so a new block can be created with the same key         *
+ *                                                                            *
+ ******************************************************************************/
+static int	ipc_shm_remove(key_t key)
+{
+	int	shm_id;
+
+	/* get ID of existing memory */
+	if (-1 == (shm_id = shmget(key, 0 /* get reference */, 0600)))
+	{
+		zbx_error("cannot attach to existing shared memory: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "zbx_shmget() removing existing shm_id:%d", shm_id);
+
+	if (-1 == shmctl(shm_id, IPC_RMID, 0))
+	{
+		zbx_error("cannot remove existing shared memory: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	return SUCCEED;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: zbx_shmget                                                       *
@@ -78,20 +108,7 @@ int	zbx_shmget(key_t key, size_t size)
 	/* if shared memory block exists, try to remove and re-create it */
 	if (EEXIST == errno)
 	{
-		/* get ID of existing memory */
-		if (-1 == (shm_id = shmget(key, 0 /* get reference */, 0600)))
-		{
-			zbx_error("cannot attach to existing shared memory: %s", zbx_strerror(errno));
-			ret = FAIL;
-		}
-
-		zabbix_log(LOG_LEVEL_DEBUG, "zbx_shmget() removing existing shm_id:%d", shm_id);
-
-		if (SUCCEED == ret && -1 == shmctl(shm_id, IPC_RMID, 0))
-		{
-			zbx_error("cannot remove existing shared memory: %s", zbx_strerror(errno));
-			ret = FAIL;
-		}
+		ret = ipc_shm_remove(key);
 
 		if (SUCCEED == ret && -1 == (shm_id = shmget(key, size, IPC_CREAT | IPC_EXCL | 0600)))
 		{
@@ -109,3 +126,76 @@ int	zbx_shmget(key_t key, size_t size)
 
 	return (ret == SUCCEED) ? shm_id : -1;
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_shm_huge_page_size                                           *
+ *                                                                            *
+ * Purpose: get the default huge page size of the system                      *
+ *                                                                            *
+ * Return value: The huge page size in bytes or 0 if huge pages are not       *
+ *               supported.                                                   *
+ *                                                                            *
+ ******************************************************************************/
+size_t	zbx_shm_huge_page_size(void)
+{
+	size_t	page_size = 0;
+#if defined(SHM_HUGETLB)
+	FILE		*f;
+	char		line[MAX_STRING_LEN];
+	zbx_uint64_t	value;
+
+	if (NULL == (f = fopen("/proc/meminfo", "r")))
+		return 0;
+
+	while (NULL != fgets(line, sizeof(line), f))
+	{
+		if (1 == sscanf(line, "Hugepagesize: " ZBX_FS_UI64 " kB", &value))
+		{
+			page_size = (size_t)value * ZBX_KIBIBYTE;
+			break;
+		}
+	}
+
+	zbx_fclose(f);
+#endif
+	return page_size;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_shmget_huge                                                  *
+ *                                                                            *
+ * Purpose: create block of shared memory backed by huge pages                *
+ *                                                                            *
+ * Parameters:  key  - [IN] IPC key                                           *
+ *              size - [IN] size, must be a multiple of huge page size        *
+ *                                                                            *
+ * Return value: If the function succeeds, then return SHM ID                 *
+ *               -1 on an error, errno is set                                 *
+ *                                                                            *
+ * Comments: Failures are not logged, the caller is expected to fall back to  *
+ *           zbx_shmget().                                                    *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_shmget_huge(key_t key, size_t size)
+{
+#if defined(SHM_HUGETLB)
+	int	shm_id;
+
+	if (-1 != (shm_id = shmget(key, size, IPC_CREAT | IPC_EXCL | SHM_HUGETLB | 0600)))
+		return shm_id;
+
+	if (EEXIST != errno || SUCCEED != ipc_shm_remove(key))
+		return -1;
+
+	return shmget(key, size, IPC_CREAT | IPC_EXCL | SHM_HUGETLB | 0600);
+#else
+	ZBX_UNUSED(key);
+	ZBX_UNUSED(size);
+
+	errno = ENOSYS;
+
+	return -1;
+#endif
+}
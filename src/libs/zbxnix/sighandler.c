@@ -28,6 +28,8 @@
 int	sig_parent_pid = -1;
 int	sig_exiting = 0;
 
+static int	sig_child_died = 0;
+
 /******************************************************************************
  *                                                                            *
  * Function: fatal_signal_handler                                             *
@@ -142,6 +144,7 @@ static void	child_signal_handler(int sig, siginfo_t *siginfo, void *context)
 	if (0 == sig_exiting)
 	{
 		sig_exiting = 1;
+		sig_child_died = 1;
 		zabbix_log(LOG_LEVEL_CRIT, "One child process died (PID:%d,exitcode/signal:%d). Exiting ...",
 				SIG_CHECKED_FIELD(siginfo, si_pid), SIG_CHECKED_FIELD(siginfo, si_status));
 
@@ -202,3 +205,19 @@ void 	zbx_set_child_signal_handler()
 	phan.sa_sigaction = child_signal_handler;
 	sigaction(SIGCHLD, &phan, NULL);
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_sig_child_died                                               *
+ *                                                                            *
+ * Purpose: check if the parent process is exiting because a child process    *
+ *          died                                                              *
+ *                                                                            *
+ * Return value: SUCCEED - a child process died, the exit is not graceful     *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_sig_child_died(void)
+{
+	return 0 != sig_child_died ? SUCCEED : FAIL;
+}
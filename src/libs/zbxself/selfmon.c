@@ -36,14 +36,52 @@ typedef struct
 }
 zbx_stat_process_t;
 
+/* upper bounds of latency histogram buckets in seconds, the last bucket has no upper bound */
+static const double	latency_bounds[] = {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10,
+				25, 50, 100, 250, 500, 1000};
+
+#	define ZBX_LATENCY_BUCKETS	(int)(ARRSIZE(latency_bounds) + 1)
+
+typedef struct
+{
+	zbx_uint64_t	buckets[ZBX_LATENCY_BUCKETS];
+	zbx_uint64_t	count;
+	double		sum;
+	double		max;	/* maximum latency since the last statistics collection */
+	zbx_uint64_t	h_buckets[MAX_HISTORY][ZBX_LATENCY_BUCKETS];
+	zbx_uint64_t	h_count[MAX_HISTORY];
+	double		h_sum[MAX_HISTORY];
+	double		h_max[MAX_HISTORY];
+}
+zbx_stat_latency_t;
+
 typedef struct
 {
 	zbx_stat_process_t	**process;
 	int			first;
 	int			count;
+	zbx_stat_latency_t	latency[ZBX_LATENCY_STAGE_COUNT];
 }
 zbx_selfmon_collector_t;
 
+/* latency statistics of the current process, published to collector at most once per */
+/* ZBX_LATENCY_FLUSH_PERIOD or together with process state counters                   */
+typedef struct
+{
+	zbx_uint64_t	buckets[ZBX_LATENCY_BUCKETS];
+	zbx_uint64_t	count;
+	double		sum;
+	double		max;
+}
+zbx_latency_local_t;
+
+static zbx_latency_local_t	latency_local[ZBX_LATENCY_STAGE_COUNT];
+static int			latency_local_num = 0;
+static time_t			latency_flushed = 0;
+
+/* the collector samples statistics every second, publishing more often gives no better data */
+#	define ZBX_LATENCY_FLUSH_PERIOD	1
+
 static zbx_selfmon_collector_t	*collector = NULL;
 static int			shm_id;
 
@@ -51,6 +89,8 @@ static int			shm_id;
 #	define UNLOCK_SM	zbx_mutex_unlock(&sm_lock)
 
 static ZBX_MUTEX	sm_lock = ZBX_MUTEX_NULL;
+
+static void	latency_publish(void);
 #endif
 
 extern char	*CONFIG_FILE;
@@ -79,6 +119,7 @@ extern int	CONFIG_COLLECTOR_FORKS;
 extern int	CONFIG_PASSIVE_FORKS;
 extern int	CONFIG_ACTIVE_FORKS;
 extern int	CONFIG_TASKMANAGER_FORKS;
+extern int	CONFIG_PREPROCESSOR_FORKS;
 
 extern unsigned char	process_type;
 extern int		process_num;
@@ -150,6 +191,8 @@ int	get_process_type_forks(unsigned char proc_type)
 			return CONFIG_ACTIVE_FORKS;
 		case ZBX_PROCESS_TYPE_TASKMANAGER:
 			return CONFIG_TASKMANAGER_FORKS;
+		case ZBX_PROCESS_TYPE_PREPROCESSOR:
+			return CONFIG_PREPROCESSOR_FORKS;
 	}
 
 	THIS_SHOULD_NEVER_HAPPEN;
@@ -224,6 +267,8 @@ const char	*get_process_type_string(unsigned char proc_type)
 			return "active checks";
 		case ZBX_PROCESS_TYPE_TASKMANAGER:
 			return "task manager";
+		case ZBX_PROCESS_TYPE_PREPROCESSOR:
+			return "preprocessing worker";
 	}
 
 	THIS_SHOULD_NEVER_HAPPEN;
@@ -243,6 +288,52 @@ int	get_process_type_by_name(const char *proc_type_str)
 	return ZBX_PROCESS_TYPE_UNKNOWN;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: get_latency_stage_string                                         *
+ *                                                                            *
+ * Purpose: returns value processing stage name                               *
+ *                                                                            *
+ * Parameters: stage - [IN] the stage; ZBX_LATENCY_STAGE_*                    *
+ *                                                                            *
+ * Comments: used in internal checks zabbix[latency,...] and latency report   *
+ *                                                                            *
+ ******************************************************************************/
+const char	*get_latency_stage_string(unsigned char stage)
+{
+	switch (stage)
+	{
+		case ZBX_LATENCY_STAGE_COLLECT:
+			return "collection";
+		case ZBX_LATENCY_STAGE_CACHE:
+			return "cache";
+		case ZBX_LATENCY_STAGE_SYNC:
+			return "sync";
+		case ZBX_LATENCY_STAGE_DB:
+			return "db";
+		case ZBX_LATENCY_STAGE_TRIGGER:
+			return "trigger";
+		case ZBX_LATENCY_STAGE_TOTAL:
+			return "total";
+	}
+
+	THIS_SHOULD_NEVER_HAPPEN;
+	exit(EXIT_FAILURE);
+}
+
+int	get_latency_stage_by_name(const char *stage_str)
+{
+	int	i;
+
+	for (i = 0; i < ZBX_LATENCY_STAGE_COUNT; i++)
+	{
+		if (0 == strcmp(stage_str, get_latency_stage_string(i)))
+			return i;
+	}
+
+	return ZBX_LATENCY_STAGE_UNKNOWN;
+}
+
 #ifndef _WINDOWS
 /******************************************************************************
  *                                                                            *
@@ -318,6 +409,8 @@ void	init_selfmon_collector(void)
 		}
 	}
 
+	memset(collector->latency, 0, sizeof(collector->latency));
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() collector:%p", __function_name, collector);
 }
 
@@ -384,6 +477,10 @@ void	update_selfmon_counter(unsigned char state)
 	process->last_ticks = ticks;
 	process->last_state = state;
 
+	/* the lock is already held, publish the latency accumulated so far */
+	if (0 != latency_local_num)
+		latency_publish();
+
 	UNLOCK_SM;
 }
 
@@ -398,9 +495,10 @@ void	collect_selfmon_stats(void)
 {
 	const char		*__function_name = "collect_selfmon_stats";
 	zbx_stat_process_t	*process;
+	zbx_stat_latency_t	*latency;
 	clock_t			ticks;
 	struct tms		buf;
-	unsigned char		proc_type, state;
+	unsigned char		proc_type, state, stage;
 	int			proc_num, process_forks, index;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
@@ -430,6 +528,17 @@ void	collect_selfmon_stats(void)
 		}
 	}
 
+	for (stage = 0; stage < ZBX_LATENCY_STAGE_COUNT; stage++)
+	{
+		latency = &collector->latency[stage];
+
+		memcpy(latency->h_buckets[index], latency->buckets, sizeof(latency->buckets));
+		latency->h_count[index] = latency->count;
+		latency->h_sum[index] = latency->sum;
+		latency->h_max[index] = latency->max;
+		latency->max = 0;
+	}
+
 	UNLOCK_SM;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
@@ -531,6 +640,290 @@ unlock:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_add                                                  *
+ *                                                                            *
+ * Purpose: account latency of values passing value processing stage          *
+ *                                                                            *
+ * Parameters: stage   - [IN] the stage; ZBX_LATENCY_STAGE_*                  *
+ *             latency - [IN] the latency in seconds                          *
+ *             count   - [IN] the number of values with this latency          *
+ *                                                                            *
+ * Comments: Latency is accumulated locally and written to self-monitoring    *
+ *           collector by zbx_latency_flush() to avoid locking per value.     *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_latency_add(unsigned char stage, double latency, int count)
+{
+	zbx_latency_local_t	*local = &latency_local[stage];
+	int			i;
+
+	if (0 > latency)
+		latency = 0;
+
+	for (i = 0; i < ZBX_LATENCY_BUCKETS - 1 && latency > latency_bounds[i]; i++)
+		;
+
+	local->buckets[i] += count;
+	local->count += count;
+	local->sum += latency * count;
+
+	if (latency > local->max)
+		local->max = latency;
+
+	latency_local_num++;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: latency_publish                                                  *
+ *                                                                            *
+ * Purpose: write latency accumulated by the current process to               *
+ *          self-monitoring collector                                         *
+ *                                                                            *
+ * Comments: The self-monitoring collector must be locked by the caller.      *
+ *                                                                            *
+ ******************************************************************************/
+static void	latency_publish(void)
+{
+	zbx_latency_local_t	*local;
+	zbx_stat_latency_t	*latency;
+	unsigned char		stage;
+	int			i;
+
+	for (stage = 0; stage < ZBX_LATENCY_STAGE_COUNT; stage++)
+	{
+		local = &latency_local[stage];
+
+		if (0 == local->count)
+			continue;
+
+		latency = &collector->latency[stage];
+
+		for (i = 0; i < ZBX_LATENCY_BUCKETS; i++)
+			latency->buckets[i] += local->buckets[i];
+
+		latency->count += local->count;
+		latency->sum += local->sum;
+
+		if (local->max > latency->max)
+			latency->max = local->max;
+	}
+
+	memset(latency_local, 0, sizeof(latency_local));
+	latency_local_num = 0;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_latency_flush                                                *
+ *                                                                            *
+ * Purpose: publish latency accumulated by the current process if it was not  *
+ *          published during the last ZBX_LATENCY_FLUSH_PERIOD                *
+ *                                                                            *
+ * Comments: Called after every batch of values. The collector is locked at   *
+ *           most once per period, in between the latency stays local.        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_latency_flush(void)
+{
+	time_t	now;
+
+	if (0 == latency_local_num || NULL == collector)
+		return;
+
+	if (latency_flushed + ZBX_LATENCY_FLUSH_PERIOD > (now = time(NULL)))
+		return;
+
+	LOCK_SM;
+	latency_publish();
+	UNLOCK_SM;
+
+	latency_flushed = now;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: latency_get_percentile                                           *
+ *                                                                            *
+ * Purpose: estimate latency percentile from histogram buckets                *
+ *                                                                            *
+ * Parameters: buckets    - [IN] the histogram bucket counts                  *
+ *             count      - [IN] the total number of values                   *
+ *             max        - [IN] the maximum latency                          *
+ *             percentile - [IN] the percentile (0-100)                       *
+ *                                                                            *
+ * Return value: the latency in seconds                                       *
+ *                                                                            *
+ * Comments: the latency is interpolated linearly inside the bucket           *
+ *                                                                            *
+ ******************************************************************************/
+static double	latency_get_percentile(const zbx_uint64_t *buckets, zbx_uint64_t count, double max,
+		double percentile)
+{
+	double		rank, lower = 0, upper;
+	zbx_uint64_t	total = 0;
+	int		i;
+
+	if (0 == count)
+		return 0;
+
+	rank = count * percentile / 100;
+
+	for (i = 0; i < ZBX_LATENCY_BUCKETS - 1; i++)
+	{
+		if (rank <= total + buckets[i] && 0 != buckets[i])
+			break;
+
+		total += buckets[i];
+		lower = latency_bounds[i];
+	}
+
+	if (ZBX_LATENCY_BUCKETS - 1 == i || (upper = latency_bounds[i]) > max)
+		upper = max;
+
+	if (upper < lower || 0 == buckets[i])
+		return upper;
+
+	return lower + (upper - lower) * (rank - total) / buckets[i];
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_latency_stats                                                *
+ *                                                                            *
+ * Purpose: calculate latency statistics of value processing stage            *
+ *                                                                            *
+ * Parameters: stage      - [IN] the stage; ZBX_LATENCY_STAGE_*               *
+ *             mode       - [IN] one of ZBX_LATENCY_MODE_*                    *
+ *             percentile - [IN] the percentile, used with                    *
+ *                               ZBX_LATENCY_MODE_PERCENTILE                  *
+ *             value      - [OUT] the statistics value                        *
+ *                                                                            *
+ * Comments: The count is the total number of values since start, other       *
+ *           statistics are calculated over the self-monitoring history       *
+ *           period (the last minute).                                        *
+ *                                                                            *
+ ******************************************************************************/
+void	get_latency_stats(unsigned char stage, unsigned char mode, double percentile, double *value)
+{
+	const char		*__function_name = "get_latency_stats";
+	zbx_stat_latency_t	*latency;
+	zbx_uint64_t		buckets[ZBX_LATENCY_BUCKETS], count;
+	double			max = 0;
+	int			current, i;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	*value = 0;
+	latency = &collector->latency[stage];
+
+	LOCK_SM;
+
+	if (ZBX_LATENCY_MODE_COUNT == mode)
+	{
+		*value = (double)latency->count;
+		goto unlock;
+	}
+
+	if (1 >= collector->count)
+		goto unlock;
+
+	if (MAX_HISTORY <= (current = (collector->first + collector->count - 1)))
+		current -= MAX_HISTORY;
+
+	if (0 == (count = latency->h_count[current] - latency->h_count[collector->first]))
+		goto unlock;
+
+	for (i = collector->first; i != current;)
+	{
+		if (MAX_HISTORY == ++i)
+			i = 0;
+
+		if (latency->h_max[i] > max)
+			max = latency->h_max[i];
+	}
+
+	switch (mode)
+	{
+		case ZBX_LATENCY_MODE_AVG:
+			*value = (latency->h_sum[current] - latency->h_sum[collector->first]) / count;
+			break;
+		case ZBX_LATENCY_MODE_MAX:
+			*value = max;
+			break;
+		case ZBX_LATENCY_MODE_PERCENTILE:
+			for (i = 0; i < ZBX_LATENCY_BUCKETS; i++)
+				buckets[i] = latency->h_buckets[current][i] - latency->h_buckets[collector->first][i];
+
+			*value = latency_get_percentile(buckets, count, max, percentile);
+			break;
+	}
+unlock:
+	UNLOCK_SM;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: log_latency_stats                                                *
+ *                                                                            *
+ * Purpose: write latency histograms of value processing stages to log file   *
+ *                                                                            *
+ * Comments: the histogram bucket counts are cumulative since start           *
+ *                                                                            *
+ ******************************************************************************/
+void	log_latency_stats(void)
+{
+	zbx_stat_latency_t	latency;
+	unsigned char		stage;
+	double			avg, max, p50, p90, p99;
+	char			*buckets = NULL;
+	size_t			buckets_alloc = 0, buckets_offset;
+	int			i;
+
+	if (NULL == collector)
+		return;
+
+	zabbix_log(LOG_LEVEL_WARNING, "== value processing latency statistics, the last minute and buckets since"
+			" start ==");
+
+	for (stage = 0; stage < ZBX_LATENCY_STAGE_COUNT; stage++)
+	{
+		get_latency_stats(stage, ZBX_LATENCY_MODE_AVG, 0, &avg);
+		get_latency_stats(stage, ZBX_LATENCY_MODE_MAX, 0, &max);
+		get_latency_stats(stage, ZBX_LATENCY_MODE_PERCENTILE, 50, &p50);
+		get_latency_stats(stage, ZBX_LATENCY_MODE_PERCENTILE, 90, &p90);
+		get_latency_stats(stage, ZBX_LATENCY_MODE_PERCENTILE, 99, &p99);
+
+		LOCK_SM;
+		latency = collector->latency[stage];
+		UNLOCK_SM;
+
+		buckets_offset = 0;
+
+		for (i = 0; i < ZBX_LATENCY_BUCKETS; i++)
+		{
+			if (ZBX_LATENCY_BUCKETS - 1 == i)
+				zbx_strcpy_alloc(&buckets, &buckets_alloc, &buckets_offset, " +Inf:");
+			else
+				zbx_snprintf_alloc(&buckets, &buckets_alloc, &buckets_offset, " %g:", latency_bounds[i]);
+
+			zbx_snprintf_alloc(&buckets, &buckets_alloc, &buckets_offset, ZBX_FS_UI64, latency.buckets[i]);
+		}
+
+		zabbix_log(LOG_LEVEL_WARNING, "%s: values:" ZBX_FS_UI64 " avg:" ZBX_FS_DBL " max:" ZBX_FS_DBL
+				" p50:" ZBX_FS_DBL " p90:" ZBX_FS_DBL " p99:" ZBX_FS_DBL " buckets:%s",
+				get_latency_stage_string(stage), latency.count, avg, max, p50, p90, p99, buckets);
+	}
+
+	zabbix_log(LOG_LEVEL_WARNING, "==");
+
+	zbx_free(buckets);
+}
+
 static int	sleep_remains;
 
 /******************************************************************************
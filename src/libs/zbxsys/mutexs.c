@@ -42,36 +42,54 @@
 	static unsigned char	mutexes = 0;
 #endif
 
+#ifndef _WINDOWS
+#define ZBX_SEM_COUNT			(ZBX_MUTEX_COUNT + 2 * ZBX_RWLOCK_COUNT)
+#define ZBX_RWLOCK_SEM_WRITER(name)	(ZBX_MUTEX_COUNT + 2 * (name))
+#define ZBX_RWLOCK_SEM_READERS(name)	(ZBX_MUTEX_COUNT + 2 * (name) + 1)
+
+/* write lock state of the reader/writer locks held by the current process */
+static unsigned char	rwlock_wrlocked[ZBX_RWLOCK_COUNT];
+
+/* lock statistics slots - mutexes followed by reader/writer locks */
+#define ZBX_MUTEX_STATS_COUNT		(ZBX_MUTEX_COUNT + ZBX_RWLOCK_COUNT)
+#define ZBX_RWLOCK_STATS(name)		(ZBX_MUTEX_COUNT + (name))
+
+/* Statistics of mutexes and write locks are updated while holding the lock, so only */
+/* the concurrent readers of reader/writer locks need atomic updates. Without         */
+/* compiler atomics read lock acquisitions are not accounted.                        */
+#if defined(__GNUC__) && (4 < __GNUC__ || (4 == __GNUC__ && 1 <= __GNUC_MINOR__))
+#	define MUTEX_STATS_ATOMICS
+#	define MUTEX_STATS_ADD(p, v)	__sync_add_and_fetch(p, v)
+#endif
+
+static zbx_mutex_stats_t	*mutex_stats = NULL;
+
+/* the time when locks held by the current process were acquired, in microseconds */
+static zbx_uint64_t	mutex_locked_at[ZBX_MUTEX_STATS_COUNT];
+
+static const char	*mutex_names[ZBX_MUTEX_COUNT] = {"log", "cache", "trends", "cache_ids", "selfmon", "cpustats",
+				"diskstats", "itservices", "valuecache", "vmware", "sqlite3", "procstat",
+				"proxy_history", "snmpidx"};
+
 /******************************************************************************
  *                                                                            *
- * Function: zbx_mutex_create_ext                                             *
+ * Function: zbx_sem_list_create                                              *
  *                                                                            *
- * Purpose: Create the mutex                                                  *
+ * Purpose: create and initialize semaphore set used by mutexes and           *
+ *          reader/writer locks                                               *
  *                                                                            *
- * Parameters:  mutex - handle of mutex                                       *
- *              name - name of mutex (index for nix system)                   *
- *              forced - remove mutex if exists (only for nix)                *
+ * Parameters:  name - name of mutex or lock being created (for logging)      *
+ *              forced - remove semaphore set if exists                       *
  *                                                                            *
  * Return value: If the function succeeds, then return SUCCEED,               *
  *               FAIL on an error                                             *
  *                                                                            *
- * Author: Eugene Grigorjev                                                   *
- *                                                                            *
- * Comments: use alias 'zbx_mutex_create' and 'zbx_mutex_create_force'        *
+ * Comments: mutex semaphores and writer semaphores of the reader/writer      *
+ *           locks are initialized to 1, reader count semaphores to 0         *
  *                                                                            *
  ******************************************************************************/
-int zbx_mutex_create_ext(ZBX_MUTEX *mutex, ZBX_MUTEX_NAME name, unsigned char forced)
+static int	zbx_sem_list_create(int name, unsigned char forced)
 {
-#ifdef _WINDOWS
-
-	if (NULL == (*mutex = CreateMutex(NULL, FALSE, name)))
-	{
-		zbx_error("error on mutex creating: %s", strerror_from_system(GetLastError()));
-		return FAIL;
-	}
-
-#else
-
 #define ZBX_MAX_ATTEMPTS	10
 	int		attempts = 0, i;
 	key_t		sem_key;
@@ -90,13 +108,14 @@ int zbx_mutex_create_ext(ZBX_MUTEX *mutex, ZBX_MUTEX_NAME name, unsigned char fo
 		}
 	}
 lbl_create:
-	if (-1 != ZBX_SEM_LIST_ID || -1 != (ZBX_SEM_LIST_ID = semget(sem_key, ZBX_MUTEX_COUNT, IPC_CREAT | IPC_EXCL | 0600 /* 0022 */)))
+	if (-1 != ZBX_SEM_LIST_ID || -1 != (ZBX_SEM_LIST_ID = semget(sem_key, ZBX_SEM_COUNT, IPC_CREAT | IPC_EXCL | 0600 /* 0022 */)))
 	{
 		/* set default semaphore value */
 
-		semopts.val = 1;
-		for (i = 0; ZBX_MUTEX_COUNT > i; i++)
+		for (i = 0; ZBX_SEM_COUNT > i; i++)
 		{
+			semopts.val = (ZBX_MUTEX_COUNT <= i && 1 == (i - ZBX_MUTEX_COUNT) % 2 ? 0 : 1);
+
 			if (-1 == semctl(ZBX_SEM_LIST_ID, i, SETVAL, semopts))
 			{
 				zbx_error("semaphore [%i] error in semctl(SETVAL): %s", name, zbx_strerror(errno));
@@ -104,6 +123,9 @@ lbl_create:
 
 			}
 
+			if (ZBX_MUTEX_COUNT <= i)
+				continue;
+
 			zbx_mutex_lock(&i);	/* call semop to update sem_otime */
 			zbx_mutex_unlock(&i);	/* release semaphore */
 		}
@@ -149,7 +171,7 @@ lbl_create:
 			}
 
 			if (0 != semopts.buf->sem_otime)
-				goto lbl_return;
+				return SUCCEED;
 
 			zbx_sleep(1);
 		}
@@ -162,7 +184,188 @@ lbl_create:
 		zbx_error("cannot create Semaphore: %s", zbx_strerror(errno));
 		return FAIL;
 	}
-lbl_return:
+
+	return SUCCEED;
+#undef ZBX_MAX_ATTEMPTS
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_sem_op                                                       *
+ *                                                                            *
+ * Purpose: perform semaphore operations, restarting interrupted calls        *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_sem_op(const char *filename, int line, struct sembuf *ops, size_t ops_num, const char *action)
+{
+	while (-1 == semop(ZBX_SEM_LIST_ID, ops, ops_num))
+	{
+		if (EINTR != errno)
+		{
+			zbx_error("[file:'%s',line:%d] %s failed: %s", filename, line, action, zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: mutex_time                                                       *
+ *                                                                            *
+ * Purpose: get current time in microseconds for lock statistics              *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_uint64_t	mutex_time(void)
+{
+	struct timeval	tv;
+
+	gettimeofday(&tv, NULL);
+
+	return (zbx_uint64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_sem_op_timed                                                 *
+ *                                                                            *
+ * Purpose: perform semaphore operations measuring the time spent waiting     *
+ *                                                                            *
+ * Parameters: filename - [IN] the caller source file (for logging)           *
+ *             line     - [IN] the caller source line (for logging)           *
+ *             ops      - [IN] the semaphore operations                       *
+ *             ops_num  - [IN] the number of semaphore operations             *
+ *             action   - [IN] the action description (for logging)           *
+ *             wait     - [OUT] the time spent waiting in microseconds        *
+ *                                                                            *
+ * Return value: SUCCEED - the operations were performed without waiting      *
+ *               FAIL    - the operations had to wait                         *
+ *                                                                            *
+ * Comments: The operations are first tried without blocking, so uncontended  *
+ *           locking costs a single semop() call like before.                 *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_sem_op_timed(const char *filename, int line, struct sembuf *ops, size_t ops_num,
+		const char *action, zbx_uint64_t *wait)
+{
+	zbx_uint64_t	start;
+	size_t		i;
+
+	for (i = 0; i < ops_num; i++)
+		ops[i].sem_flg |= IPC_NOWAIT;
+
+	while (-1 == semop(ZBX_SEM_LIST_ID, ops, ops_num))
+	{
+		if (EAGAIN == errno)
+		{
+			for (i = 0; i < ops_num; i++)
+				ops[i].sem_flg &= ~IPC_NOWAIT;
+
+			start = mutex_time();
+			zbx_sem_op(filename, line, ops, ops_num, action);
+			*wait = mutex_time() - start;
+
+			return FAIL;
+		}
+
+		if (EINTR != errno)
+		{
+			zbx_error("[file:'%s',line:%d] %s failed: %s", filename, line, action, zbx_strerror(errno));
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	*wait = 0;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: mutex_stats_locked                                               *
+ *                                                                            *
+ * Purpose: account exclusive lock acquisition                                *
+ *                                                                            *
+ * Parameters: index     - [IN] the lock statistics slot                      *
+ *             contended - [IN] FAIL if the lock had to wait, SUCCEED         *
+ *                              otherwise                                     *
+ *             wait      - [IN] the time spent waiting in microseconds        *
+ *                                                                            *
+ * Comments: must be called while holding the lock                            *
+ *                                                                            *
+ ******************************************************************************/
+static void	mutex_stats_locked(int index, int contended, zbx_uint64_t wait)
+{
+	zbx_mutex_stats_t	*stats = &mutex_stats[index];
+
+	stats->locks++;
+
+	if (FAIL == contended)
+	{
+		stats->contended++;
+		stats->wait_time += wait;
+	}
+
+	mutex_locked_at[index] = mutex_time();
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: mutex_stats_unlocking                                            *
+ *                                                                            *
+ * Purpose: account exclusive lock hold time                                  *
+ *                                                                            *
+ * Parameters: index - [IN] the lock statistics slot                          *
+ *                                                                            *
+ * Comments: must be called before releasing the lock                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	mutex_stats_unlocking(int index)
+{
+	zbx_mutex_stats_t	*stats = &mutex_stats[index];
+	zbx_uint64_t		now;
+
+	if (0 == mutex_locked_at[index])
+		return;
+
+	if ((now = mutex_time()) > mutex_locked_at[index] && now - mutex_locked_at[index] > stats->hold_max)
+		stats->hold_max = now - mutex_locked_at[index];
+
+	mutex_locked_at[index] = 0;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mutex_create_ext                                             *
+ *                                                                            *
+ * Purpose: Create the mutex                                                  *
+ *                                                                            *
+ * Parameters:  mutex - handle of mutex                                       *
+ *              name - name of mutex (index for nix system)                   *
+ *              forced - remove mutex if exists (only for nix)                *
+ *                                                                            *
+ * Return value: If the function succeeds, then return SUCCEED,               *
+ *               FAIL on an error                                             *
+ *                                                                            *
+ * Author: Eugene Grigorjev                                                   *
+ *                                                                            *
+ * Comments: use alias 'zbx_mutex_create' and 'zbx_mutex_create_force'        *
+ *                                                                            *
+ ******************************************************************************/
+int zbx_mutex_create_ext(ZBX_MUTEX *mutex, ZBX_MUTEX_NAME name, unsigned char forced)
+{
+#ifdef _WINDOWS
+
+	if (NULL == (*mutex = CreateMutex(NULL, FALSE, name)))
+	{
+		zbx_error("error on mutex creating: %s", strerror_from_system(GetLastError()));
+		return FAIL;
+	}
+
+#else
+	if (SUCCEED != zbx_sem_list_create(name, forced))
+		return FAIL;
+
 	*mutex = name;
 	mutexes++;
 
@@ -213,13 +416,17 @@ void	__zbx_mutex_lock(const char *filename, int line, ZBX_MUTEX *mutex)
 	sem_lock.sem_op = -1;
 	sem_lock.sem_flg = SEM_UNDO;
 
-	while (-1 == semop(ZBX_SEM_LIST_ID, &sem_lock, 1))
+	if (NULL == mutex_stats)
 	{
-		if (EINTR != errno)
-		{
-			zbx_error("[file:'%s',line:%d] lock failed: %s", filename, line, zbx_strerror(errno));
-			exit(EXIT_FAILURE);
-		}
+		zbx_sem_op(filename, line, &sem_lock, 1, "lock");
+	}
+	else
+	{
+		zbx_uint64_t	wait;
+		int		contended;
+
+		contended = zbx_sem_op_timed(filename, line, &sem_lock, 1, "lock", &wait);
+		mutex_stats_locked(*mutex, contended, wait);
 	}
 #endif
 }
@@ -252,18 +459,14 @@ void	__zbx_mutex_unlock(const char *filename, int line, ZBX_MUTEX *mutex)
 		exit(EXIT_FAILURE);
 	}
 #else
+	if (NULL != mutex_stats)
+		mutex_stats_unlocking(*mutex);
+
 	sem_unlock.sem_num = *mutex;
 	sem_unlock.sem_op = 1;
 	sem_unlock.sem_flg = SEM_UNDO;
 
-	while (-1 == semop(ZBX_SEM_LIST_ID, &sem_unlock, 1))
-	{
-		if (EINTR != errno)
-		{
-			zbx_error("[file:'%s',line:%d] unlock failed: %s", filename, line, zbx_strerror(errno));
-			exit(EXIT_FAILURE);
-		}
-	}
+	zbx_sem_op(filename, line, &sem_unlock, 1, "unlock");
 #endif
 }
 
@@ -301,6 +504,349 @@ int	zbx_mutex_destroy(ZBX_MUTEX *mutex)
 	return SUCCEED;
 }
 
+#ifndef _WINDOWS
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_rwlock_create                                                *
+ *                                                                            *
+ * Purpose: create reader/writer lock shared between processes                *
+ *                                                                            *
+ * Parameters: rwlock - [OUT] handle of the lock                              *
+ *             name   - [IN] name of the lock (ZBX_RWLOCK_* define)           *
+ *                                                                            *
+ * Return value: SUCCEED - the lock was created successfully                  *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ * Comments: The lock is built on two semaphores - writer flag and reader     *
+ *           count. A writer first takes the writer flag, which blocks new    *
+ *           readers, and then waits for the active readers to leave. The     *
+ *           existing semaphore set is recreated like with                    *
+ *           zbx_mutex_create_force().                                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_rwlock_create(ZBX_RWLOCK *rwlock, ZBX_RWLOCK_NAME name)
+{
+	if (SUCCEED != zbx_sem_list_create(name, 1))
+		return FAIL;
+
+	*rwlock = name;
+	rwlock_wrlocked[name] = 0;
+	mutexes++;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_rwlock_wrlock                                                *
+ *                                                                            *
+ * Purpose: acquire exclusive (write) access                                  *
+ *                                                                            *
+ * Parameters: rwlock - handle of the lock                                    *
+ *                                                                            *
+ ******************************************************************************/
+void	__zbx_rwlock_wrlock(const char *filename, int line, ZBX_RWLOCK *rwlock)
+{
+	struct sembuf	sem_lock;
+
+	if (ZBX_RWLOCK_NULL == *rwlock)
+		return;
+
+	/* take the writer flag, new readers will wait until it's released */
+	sem_lock.sem_num = ZBX_RWLOCK_SEM_WRITER(*rwlock);
+	sem_lock.sem_op = -1;
+	sem_lock.sem_flg = SEM_UNDO;
+
+	if (NULL == mutex_stats)
+	{
+		zbx_sem_op(filename, line, &sem_lock, 1, "write lock");
+
+		/* wait for the active readers to finish */
+		sem_lock.sem_num = ZBX_RWLOCK_SEM_READERS(*rwlock);
+		sem_lock.sem_op = 0;
+		sem_lock.sem_flg = 0;
+
+		zbx_sem_op(filename, line, &sem_lock, 1, "write lock");
+	}
+	else
+	{
+		zbx_uint64_t	wait_writer, wait_readers;
+		int		contended;
+
+		contended = zbx_sem_op_timed(filename, line, &sem_lock, 1, "write lock", &wait_writer);
+
+		sem_lock.sem_num = ZBX_RWLOCK_SEM_READERS(*rwlock);
+		sem_lock.sem_op = 0;
+		sem_lock.sem_flg = 0;
+
+		if (FAIL == zbx_sem_op_timed(filename, line, &sem_lock, 1, "write lock", &wait_readers))
+			contended = FAIL;
+
+		mutex_stats_locked(ZBX_RWLOCK_STATS(*rwlock), contended, wait_writer + wait_readers);
+	}
+
+	rwlock_wrlocked[*rwlock] = 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_rwlock_rdlock                                                *
+ *                                                                            *
+ * Purpose: acquire shared (read) access                                      *
+ *                                                                            *
+ * Parameters: rwlock - handle of the lock                                    *
+ *                                                                            *
+ * Comments: the writer flag check and reader count increment are performed   *
+ *           atomically in a single semop() call                              *
+ *                                                                            *
+ ******************************************************************************/
+void	__zbx_rwlock_rdlock(const char *filename, int line, ZBX_RWLOCK *rwlock)
+{
+	struct sembuf	sem_lock[3];
+
+	if (ZBX_RWLOCK_NULL == *rwlock)
+		return;
+
+	/* wait until the writer flag is free ... */
+	sem_lock[0].sem_num = ZBX_RWLOCK_SEM_WRITER(*rwlock);
+	sem_lock[0].sem_op = -1;
+	sem_lock[0].sem_flg = 0;
+
+	/* ... leave it free ... */
+	sem_lock[1].sem_num = ZBX_RWLOCK_SEM_WRITER(*rwlock);
+	sem_lock[1].sem_op = 1;
+	sem_lock[1].sem_flg = 0;
+
+	/* ... and register as an active reader */
+	sem_lock[2].sem_num = ZBX_RWLOCK_SEM_READERS(*rwlock);
+	sem_lock[2].sem_op = 1;
+	sem_lock[2].sem_flg = SEM_UNDO;
+
+#ifdef MUTEX_STATS_ATOMICS
+	if (NULL != mutex_stats)
+	{
+		zbx_mutex_stats_t	*stats = &mutex_stats[ZBX_RWLOCK_STATS(*rwlock)];
+		zbx_uint64_t		wait;
+
+		if (FAIL == zbx_sem_op_timed(filename, line, sem_lock, 3, "read lock", &wait))
+		{
+			MUTEX_STATS_ADD(&stats->contended, 1);
+			MUTEX_STATS_ADD(&stats->wait_time, wait);
+		}
+
+		MUTEX_STATS_ADD(&stats->locks, 1);
+
+		return;
+	}
+#endif
+	zbx_sem_op(filename, line, sem_lock, 3, "read lock");
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_rwlock_unlock                                                *
+ *                                                                            *
+ * Purpose: release read or write access acquired by the current process      *
+ *                                                                            *
+ * Parameters: rwlock - handle of the lock                                    *
+ *                                                                            *
+ ******************************************************************************/
+void	__zbx_rwlock_unlock(const char *filename, int line, ZBX_RWLOCK *rwlock)
+{
+	struct sembuf	sem_unlock;
+
+	if (ZBX_RWLOCK_NULL == *rwlock)
+		return;
+
+	if (1 == rwlock_wrlocked[*rwlock])
+	{
+		rwlock_wrlocked[*rwlock] = 0;
+
+		if (NULL != mutex_stats)
+			mutex_stats_unlocking(ZBX_RWLOCK_STATS(*rwlock));
+
+		sem_unlock.sem_num = ZBX_RWLOCK_SEM_WRITER(*rwlock);
+		sem_unlock.sem_op = 1;
+		sem_unlock.sem_flg = SEM_UNDO;
+
+		zbx_sem_op(filename, line, &sem_unlock, 1, "write unlock");
+	}
+	else
+	{
+		sem_unlock.sem_num = ZBX_RWLOCK_SEM_READERS(*rwlock);
+		sem_unlock.sem_op = -1;
+		sem_unlock.sem_flg = SEM_UNDO;
+
+		zbx_sem_op(filename, line, &sem_unlock, 1, "read unlock");
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_rwlock_destroy                                               *
+ *                                                                            *
+ * Purpose: destroy reader/writer lock                                        *
+ *                                                                            *
+ * Parameters: rwlock - handle of the lock                                    *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_rwlock_destroy(ZBX_RWLOCK *rwlock)
+{
+	if (0 == --mutexes)
+		semctl(ZBX_SEM_LIST_ID, 0, IPC_RMID, 0);
+
+	*rwlock = ZBX_RWLOCK_NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mutex_stats_init                                             *
+ *                                                                            *
+ * Purpose: enable lock contention statistics                                 *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were enabled                        *
+ *               FAIL    - failed to allocate shared memory                   *
+ *                                                                            *
+ * Comments: Must be called by the parent process before forking, the child   *
+ *           processes inherit the statistics segment. The segment is marked  *
+ *           for removal right after attaching, so it's released when the     *
+ *           last process detaches it.                                        *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_mutex_stats_init(void)
+{
+	int	shm_id;
+	void	*ptr;
+	size_t	size = sizeof(zbx_mutex_stats_t) * ZBX_MUTEX_STATS_COUNT;
+
+	if (-1 == (shm_id = shmget(IPC_PRIVATE, size, IPC_CREAT | 0600)))
+	{
+		zbx_error("cannot allocate shared memory for lock statistics: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	ptr = shmat(shm_id, NULL, 0);
+
+	if (-1 == shmctl(shm_id, IPC_RMID, 0))
+		zbx_error("cannot mark shared memory %d for destruction: %s", shm_id, zbx_strerror(errno));
+
+	if ((void *)(-1) == ptr)
+	{
+		zbx_error("cannot attach shared memory for lock statistics: %s", zbx_strerror(errno));
+		return FAIL;
+	}
+
+	memset(ptr, 0, size);
+	mutex_stats = (zbx_mutex_stats_t *)ptr;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mutex_stats_get                                              *
+ *                                                                            *
+ * Purpose: get lock contention statistics by lock name                       *
+ *                                                                            *
+ * Parameters: name  - [IN] the lock name, the lower case mutex name without  *
+ *                          ZBX_MUTEX_ prefix or "config" for configuration   *
+ *                          cache lock                                        *
+ *             stats - [OUT] the statistics                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were returned                       *
+ *               FAIL    - unknown lock name or statistics are not enabled    *
+ *                                                                            *
+ * Comments: The counters are read without locking, the values of different  *
+ *           counters can be slightly out of sync.                            *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_mutex_stats_get(const char *name, zbx_mutex_stats_t *stats)
+{
+	int	i, first, last;
+
+	if (NULL == mutex_stats)
+		return FAIL;
+
+	if (0 == strcmp(name, "config"))
+	{
+		first = last = ZBX_RWLOCK_STATS(ZBX_RWLOCK_CONFIG);
+	}
+	else
+	{
+		for (i = 0; i < ZBX_MUTEX_COUNT; i++)
+		{
+			if (0 == strcmp(name, mutex_names[i]))
+				break;
+		}
+
+		if (ZBX_MUTEX_COUNT == i)
+			return FAIL;
+
+		first = last = i;
+	}
+
+	memset(stats, 0, sizeof(zbx_mutex_stats_t));
+
+	for (i = first; i <= last; i++)
+	{
+		stats->locks += mutex_stats[i].locks;
+		stats->contended += mutex_stats[i].contended;
+		stats->wait_time += mutex_stats[i].wait_time;
+
+		if (mutex_stats[i].hold_max > stats->hold_max)
+			stats->hold_max = mutex_stats[i].hold_max;
+	}
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: mutex_stats_log                                                  *
+ *                                                                            *
+ * Purpose: write statistics of a single lock to log file                     *
+ *                                                                            *
+ ******************************************************************************/
+static void	mutex_stats_log(const char *name)
+{
+	zbx_mutex_stats_t	stats;
+
+	if (SUCCEED != zbx_mutex_stats_get(name, &stats) || 0 == stats.locks)
+		return;
+
+	zabbix_log(LOG_LEVEL_WARNING, "%s: locks:" ZBX_FS_UI64 " contended:" ZBX_FS_UI64 " (%.2f%%)"
+			" wait:" ZBX_FS_DBL " sec, avg wait:" ZBX_FS_DBL " sec, max hold:" ZBX_FS_DBL " sec",
+			name, stats.locks, stats.contended, (double)stats.contended / stats.locks * 100,
+			(double)stats.wait_time / 1000000,
+			0 == stats.contended ? 0 : (double)stats.wait_time / stats.contended / 1000000,
+			(double)stats.hold_max / 1000000);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_mutex_stats_log                                              *
+ *                                                                            *
+ * Purpose: write lock contention statistics to log file                      *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_mutex_stats_log(void)
+{
+	int	i;
+
+	if (NULL == mutex_stats)
+		return;
+
+	zabbix_log(LOG_LEVEL_WARNING, "== lock statistics since start ==");
+
+	for (i = 0; i < ZBX_MUTEX_COUNT; i++)
+		mutex_stats_log(mutex_names[i]);
+
+	mutex_stats_log("config");
+
+	zabbix_log(LOG_LEVEL_WARNING, "==");
+}
+#endif
+
 #ifdef _WINDOWS
 /******************************************************************************
  *                                                                            *
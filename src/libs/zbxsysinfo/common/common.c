@@ -101,6 +101,38 @@ int	EXECUTE_USER_PARAMETER(AGENT_REQUEST *request, AGENT_RESULT *result)
 	return EXECUTE_STR(command, result);
 }
 
+int	EXECUTE_PERSISTENT_USER_PARAMETER(AGENT_REQUEST *request, AGENT_RESULT *result)
+{
+	const char	*__function_name = "EXECUTE_PERSISTENT_USER_PARAMETER";
+
+	int		ret = SYSINFO_RET_FAIL;
+	char		*cmd_result = NULL, error[MAX_STRING_LEN];
+	const char	*command;
+
+	/* the script command follows the item key parameters */
+	command = get_rparam(request, request->nparam - 1);
+
+	if (SUCCEED != zbx_execute_persistent(command, (const char **)request->params, request->nparam - 1,
+			&cmd_result, error, sizeof(error), CONFIG_TIMEOUT))
+	{
+		SET_MSG_RESULT(result, zbx_strdup(NULL, error));
+		goto out;
+	}
+
+	zbx_rtrim(cmd_result, ZBX_WHITESPACE);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() command:'%s' len:" ZBX_FS_SIZE_T " cmd_result:'%.20s'",
+			__function_name, command, (zbx_fs_size_t)strlen(cmd_result), cmd_result);
+
+	SET_TEXT_RESULT(result, zbx_strdup(NULL, cmd_result));
+
+	ret = SYSINFO_RET_OK;
+out:
+	zbx_free(cmd_result);
+
+	return ret;
+}
+
 int	EXECUTE_STR(const char *command, AGENT_RESULT *result)
 {
 	const char	*__function_name = "EXECUTE_STR";
@@ -25,6 +25,7 @@
 extern ZBX_METRIC	parameters_common[];
 
 int	EXECUTE_USER_PARAMETER(AGENT_REQUEST *request, AGENT_RESULT *result);
+int	EXECUTE_PERSISTENT_USER_PARAMETER(AGENT_REQUEST *request, AGENT_RESULT *result);
 int	EXECUTE_STR(const char *command, AGENT_RESULT *result);
 int	EXECUTE_DBL(const char *command, AGENT_RESULT *result);
 int	EXECUTE_INT(const char *command, AGENT_RESULT *result);
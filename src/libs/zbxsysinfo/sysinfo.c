@@ -128,13 +128,14 @@ int	add_metric(ZBX_METRIC *metric, char *error, size_t max_error_len)
 	return SUCCEED;
 }
 
-int	add_user_parameter(const char *itemkey, char *command, char *error, size_t max_error_len)
+int	add_user_parameter(const char *itemkey, char *command, unsigned flags, char *error, size_t max_error_len)
 {
 	int		ret;
-	unsigned	flags = CF_USERPARAMETER;
 	ZBX_METRIC	metric;
 	AGENT_REQUEST	request;
 
+	flags |= CF_USERPARAMETER;
+
 	init_request(&request);
 
 	if (SUCCEED == (ret = parse_item_key(itemkey, &request)))
@@ -149,7 +150,8 @@ int	add_user_parameter(const char *itemkey, char *command, char *error, size_t m
 	{
 		metric.key = get_rkey(&request);
 		metric.flags = flags;
-		metric.function = &EXECUTE_USER_PARAMETER;
+		metric.function = (0 != (flags & CF_PERSISTENT) ? &EXECUTE_PERSISTENT_USER_PARAMETER :
+				&EXECUTE_USER_PARAMETER);
 		metric.test_param = command;
 
 		ret = add_metric(&metric, error, max_error_len);
@@ -618,7 +620,24 @@ int	process(const char *in_command, unsigned flags, AGENT_RESULT *result)
 		goto notsupported;
 	}
 
-	if (0 != (command->flags & CF_USERPARAMETER))
+	if (0 != (command->flags & CF_PERSISTENT))
+	{
+		char	error[MAX_STRING_LEN];
+		int	i;
+
+		/* parameters are passed to persistent scripts as they are, followed by the script command */
+		for (i = 0; i < request.nparam; i++)
+		{
+			if (SUCCEED != zbx_check_user_parameter(request.params[i], error, sizeof(error)))
+			{
+				SET_MSG_RESULT(result, zbx_strdup(NULL, error));
+				goto notsupported;
+			}
+		}
+
+		add_request_param(&request, zbx_strdup(NULL, command->test_param));
+	}
+	else if (0 != (command->flags & CF_USERPARAMETER))
 	{
 		if (0 != (command->flags & CF_HAVEPARAMS))
 		{
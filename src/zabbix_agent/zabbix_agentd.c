@@ -219,6 +219,7 @@ int	CONFIG_COLLECTOR_FORKS		= 1;
 int	CONFIG_PASSIVE_FORKS		= 3;	/* number of listeners for processing passive checks */
 int	CONFIG_ACTIVE_FORKS		= 0;
 int	CONFIG_TASKMANAGER_FORKS	= 0;
+int	CONFIG_PREPROCESSOR_FORKS	= 0;
 
 char	*opt = NULL;
 
@@ -738,6 +739,8 @@ static void	zbx_load_config(int requirement, ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"UserParameter",		&CONFIG_USER_PARAMETERS,		TYPE_MULTISTRING,
 			PARM_OPT,	0,			0},
+		{"PersistentUserParameter",	&CONFIG_PERSISTENT_USER_PARAMETERS,	TYPE_MULTISTRING,
+			PARM_OPT,	0,			0},
 #ifndef _WINDOWS
 		{"LoadModulePath",		&CONFIG_LOAD_MODULE_PATH,		TYPE_STRING,
 			PARM_OPT,	0,			0},
@@ -778,6 +781,7 @@ static void	zbx_load_config(int requirement, ZBX_TASK_EX *task)
 	/* initialize multistrings */
 	zbx_strarr_init(&CONFIG_ALIASES);
 	zbx_strarr_init(&CONFIG_USER_PARAMETERS);
+	zbx_strarr_init(&CONFIG_PERSISTENT_USER_PARAMETERS);
 #ifndef _WINDOWS
 	zbx_strarr_init(&CONFIG_LOAD_MODULE);
 #endif
@@ -817,6 +821,7 @@ static void	zbx_free_config(void)
 {
 	zbx_strarr_free(CONFIG_ALIASES);
 	zbx_strarr_free(CONFIG_USER_PARAMETERS);
+	zbx_strarr_free(CONFIG_PERSISTENT_USER_PARAMETERS);
 #ifndef _WINDOWS
 	zbx_strarr_free(CONFIG_LOAD_MODULE);
 #endif
@@ -1164,7 +1169,8 @@ int	main(int argc, char **argv)
 				exit(EXIT_FAILURE);
 			}
 #endif
-			load_user_parameters(CONFIG_USER_PARAMETERS);
+			load_user_parameters(CONFIG_USER_PARAMETERS, 0);
+			load_user_parameters(CONFIG_PERSISTENT_USER_PARAMETERS, CF_PERSISTENT);
 			load_aliases(CONFIG_ALIASES);
 			zbx_free_config();
 			if (ZBX_TASK_TEST_METRIC == t.task)
@@ -1195,7 +1201,8 @@ int	main(int argc, char **argv)
 			break;
 		default:
 			zbx_load_config(ZBX_CFG_FILE_REQUIRED, &t);
-			load_user_parameters(CONFIG_USER_PARAMETERS);
+			load_user_parameters(CONFIG_USER_PARAMETERS, 0);
+			load_user_parameters(CONFIG_PERSISTENT_USER_PARAMETERS, CF_PERSISTENT);
 			load_aliases(CONFIG_ALIASES);
 			break;
 	}
@@ -54,6 +54,7 @@ char	*CONFIG_LOAD_MODULE_PATH	= NULL;
 char	**CONFIG_ALIASES		= NULL;
 char	**CONFIG_LOAD_MODULE		= NULL;
 char	**CONFIG_USER_PARAMETERS	= NULL;
+char	**CONFIG_PERSISTENT_USER_PARAMETERS	= NULL;
 #if defined(_WINDOWS)
 char	**CONFIG_PERF_COUNTERS		= NULL;
 #endif
@@ -125,13 +126,14 @@ void	load_aliases(char **lines)
  * Purpose: load user parameters from configuration                           *
  *                                                                            *
  * Parameters: lines - user parameter entries from configuration file         *
+ *             flags - CF_PERSISTENT for persistent script entries or 0       *
  *                                                                            *
  * Author: Vladimir Levijev                                                   *
  *                                                                            *
  * Comments: calls add_user_parameter() for each entry                        *
  *                                                                            *
  ******************************************************************************/
-void	load_user_parameters(char **lines)
+void	load_user_parameters(char **lines, unsigned flags)
 {
 	char	*p, **pline, error[MAX_STRING_LEN];
 
@@ -144,7 +146,7 @@ void	load_user_parameters(char **lines)
 		}
 		*p = '\0';
 
-		if (FAIL == add_user_parameter(*pline, p + 1, error, sizeof(error)))
+		if (FAIL == add_user_parameter(*pline, p + 1, flags, error, sizeof(error)))
 		{
 			*p = ',';
 			zabbix_log(LOG_LEVEL_CRIT, "cannot add user parameter \"%s\": %s", *pline, error);
@@ -34,6 +34,7 @@ extern int	CONFIG_LOG_LEVEL;
 extern int	CONFIG_MAX_LINES_PER_SECOND;
 extern char	**CONFIG_ALIASES;
 extern char	**CONFIG_USER_PARAMETERS;
+extern char	**CONFIG_PERSISTENT_USER_PARAMETERS;
 extern char	*CONFIG_LOAD_MODULE_PATH;
 extern char	**CONFIG_LOAD_MODULE;
 #ifdef _WINDOWS
@@ -56,7 +57,7 @@ extern char	*CONFIG_TLS_PSK_IDENTITY;
 extern char	*CONFIG_TLS_PSK_FILE;
 
 void	load_aliases(char **lines);
-void	load_user_parameters(char **lines);
+void	load_user_parameters(char **lines, unsigned flags);
 #ifdef _WINDOWS
 void	load_perf_counters(const char **lines);
 #endif
@@ -41,3 +41,20 @@ PID_FILE="/tmp/zabbix_java.pid"
 # Range: 1-30
 # Default:
 # TIMEOUT=3
+
+### Option: zabbix.connectionPoolSize
+#	Maximum number of idle connections to JMX agents kept open for reuse.
+#	0 - connections are closed after each request.
+#
+# Mandatory: no
+# Range: 0-10000
+# Default:
+# CONNECTION_POOL_SIZE=100
+
+### Option: zabbix.connectionIdleTimeout
+#	How long (in seconds) an idle connection to JMX agent is kept open.
+#
+# Mandatory: no
+# Range: 1-3600
+# Default:
+# CONNECTION_IDLE_TIMEOUT=60
@@ -34,6 +34,8 @@ class ConfigurationManager
 	public static final String LISTEN_PORT = "listenPort";
 	public static final String START_POLLERS = "startPollers";
 	public static final String TIMEOUT = "timeout";
+	public static final String CONNECTION_POOL_SIZE = "connectionPoolSize";
+	public static final String CONNECTION_IDLE_TIMEOUT = "connectionIdleTimeout";
 
 	private static ConfigurationParameter[] parameters =
 	{
@@ -72,6 +74,12 @@ class ConfigurationManager
 				null),
 		new ConfigurationParameter(TIMEOUT, ConfigurationParameter.TYPE_INTEGER, 3,
 				new IntegerValidator(1, 30),
+				null),
+		new ConfigurationParameter(CONNECTION_POOL_SIZE, ConfigurationParameter.TYPE_INTEGER, 100,
+				new IntegerValidator(0, 10000),
+				null),
+		new ConfigurationParameter(CONNECTION_IDLE_TIMEOUT, ConfigurationParameter.TYPE_INTEGER, 60,
+				new IntegerValidator(1, 3600),
 				null)
 	};
 
@@ -0,0 +1,224 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package com.zabbix.gateway;
+
+import java.io.IOException;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.Iterator;
+import java.util.LinkedList;
+import java.util.Map;
+import java.util.Timer;
+import java.util.TimerTask;
+
+import javax.management.MBeanServerConnection;
+import javax.management.remote.JMXConnector;
+import javax.management.remote.JMXServiceURL;
+
+import org.slf4j.Logger;
+import org.slf4j.LoggerFactory;
+
+class JMXConnectionPool
+{
+	private static final Logger logger = LoggerFactory.getLogger(JMXConnectionPool.class);
+
+	private static final long EXPIRE_PERIOD = 5000; // milliseconds
+
+	// idle connections by URL and credentials, the most recently used connection is the first
+	private static final HashMap<String, LinkedList<Connection>> idle = new HashMap<String, LinkedList<Connection>>();
+	private static int idleCount = 0;
+
+	static
+	{
+		Timer timer = new Timer("JMX connection pool", true);
+
+		timer.schedule(new TimerTask()
+		{
+			@Override
+			public void run()
+			{
+				expire();
+			}
+		}, EXPIRE_PERIOD, EXPIRE_PERIOD);
+	}
+
+	static class Connection
+	{
+		private final String poolKey;
+		private final JMXConnector connector;
+		private final MBeanServerConnection mbsc;
+		private boolean reused = false;
+		private long lastUsed;
+
+		private Connection(String poolKey, JMXConnector connector) throws IOException
+		{
+			this.poolKey = poolKey;
+			this.connector = connector;
+			this.mbsc = connector.getMBeanServerConnection();
+		}
+
+		public MBeanServerConnection getMBeanServerConnection()
+		{
+			return mbsc;
+		}
+
+		public boolean isReused()
+		{
+			return reused;
+		}
+
+		private void close()
+		{
+			try { connector.close(); } catch (IOException exception) { }
+		}
+	}
+
+	static Connection borrow(JMXServiceURL url, String username, String password) throws IOException
+	{
+		String poolKey = url + "\0" + username + "\0" + password;
+
+		synchronized (JMXConnectionPool.class)
+		{
+			LinkedList<Connection> list = idle.get(poolKey);
+
+			if (null != list)
+			{
+				Connection connection = list.removeFirst();
+
+				if (list.isEmpty())
+					idle.remove(poolKey);
+
+				idleCount--;
+				connection.reused = true;
+
+				logger.debug("reusing pooled connection to JMX agent at '{}'", url);
+
+				return connection;
+			}
+		}
+
+		HashMap<String, String[]> env = null;
+
+		if (null != username && null != password)
+		{
+			env = new HashMap<String, String[]>();
+			env.put(JMXConnector.CREDENTIALS, new String[] {username, password});
+		}
+
+		JMXConnector jmxc = ZabbixJMXConnectorFactory.connect(url, env);
+
+		try
+		{
+			return new Connection(poolKey, jmxc);
+		}
+		catch (IOException e)
+		{
+			try { jmxc.close(); } catch (IOException exception) { }
+
+			throw e;
+		}
+	}
+
+	static void release(Connection connection)
+	{
+		int poolSize = ConfigurationManager.getIntegerParameterValue(ConfigurationManager.CONNECTION_POOL_SIZE);
+
+		synchronized (JMXConnectionPool.class)
+		{
+			if (idleCount < poolSize)
+			{
+				LinkedList<Connection> list = idle.get(connection.poolKey);
+
+				if (null == list)
+				{
+					list = new LinkedList<Connection>();
+					idle.put(connection.poolKey, list);
+				}
+
+				connection.lastUsed = System.currentTimeMillis();
+				list.addFirst(connection);
+				idleCount++;
+
+				return;
+			}
+		}
+
+		logger.trace("connection pool is full, closing connection");
+
+		connection.close();
+	}
+
+	// closes the connection together with the idle connections to the same agent, they are likely broken too
+	static void invalidate(Connection connection)
+	{
+		LinkedList<Connection> list;
+
+		synchronized (JMXConnectionPool.class)
+		{
+			if (null != (list = idle.remove(connection.poolKey)))
+				idleCount -= list.size();
+		}
+
+		connection.close();
+
+		if (null != list)
+		{
+			for (Connection c : list)
+				c.close();
+		}
+	}
+
+	static synchronized int getIdleCount()
+	{
+		return idleCount;
+	}
+
+	static void expire()
+	{
+		ArrayList<Connection> expired = new ArrayList<Connection>();
+		long timeout = 1000L * ConfigurationManager.getIntegerParameterValue(ConfigurationManager.CONNECTION_IDLE_TIMEOUT);
+		long now = System.currentTimeMillis();
+
+		synchronized (JMXConnectionPool.class)
+		{
+			Iterator<Map.Entry<String, LinkedList<Connection>>> it = idle.entrySet().iterator();
+
+			while (it.hasNext())
+			{
+				LinkedList<Connection> list = it.next().getValue();
+
+				while (!list.isEmpty() && now - list.getLast().lastUsed >= timeout)
+				{
+					expired.add(list.removeLast());
+					idleCount--;
+				}
+
+				if (list.isEmpty())
+					it.remove();
+			}
+		}
+
+		if (!expired.isEmpty())
+			logger.debug("closing {} idle JMX connections", expired.size());
+
+		for (Connection connection : expired)
+			connection.close();
+	}
+}
@@ -19,15 +19,18 @@
 
 package com.zabbix.gateway;
 
+import java.io.IOException;
+import java.util.ArrayList;
 import java.util.HashMap;
+import java.util.LinkedHashSet;
 
+import javax.management.Attribute;
 import javax.management.MBeanAttributeInfo;
 import javax.management.MBeanInfo;
 import javax.management.MBeanServerConnection;
 import javax.management.ObjectName;
 import javax.management.openmbean.CompositeData;
 import javax.management.openmbean.TabularDataSupport;
-import javax.management.remote.JMXConnector;
 import javax.management.remote.JMXServiceURL;
 
 import org.json.*;
@@ -40,8 +43,12 @@ class JMXItemChecker extends ItemChecker
 	private static final Logger logger = LoggerFactory.getLogger(JMXItemChecker.class);
 
 	private JMXServiceURL url;
-	private JMXConnector jmxc;
 	private MBeanServerConnection mbsc;
+	private boolean connectionBroken;
+
+	// attribute values of the requested MBeans retrieved in batches, an exception if the batch failed
+	private HashMap<ObjectName, HashMap<String, Object>> attributes;
+	private HashMap<ObjectName, Exception> attributeErrors;
 
 	private String username;
 	private String password;
@@ -56,7 +63,6 @@ class JMXItemChecker extends ItemChecker
 			int port = request.getInt(JSON_TAG_PORT);
 
 			url = new JMXServiceURL("service:jmx:rmi:///jndi/rmi://[" + conn + "]:" + port + "/jmxrmi");
-			jmxc = null;
 			mbsc = null;
 
 			username = request.optString(JSON_TAG_USERNAME, null);
@@ -74,41 +80,159 @@ class JMXItemChecker extends ItemChecker
 	@Override
 	public JSONArray getValues() throws ZabbixException
 	{
-		JSONArray values = new JSONArray();
+		JMXConnectionPool.Connection connection = null;
 
 		try
 		{
-			HashMap<String, String[]> env = null;
-
-			if (null != username && null != password)
+			while (true)
 			{
-				env = new HashMap<String, String[]>();
-				env.put(JMXConnector.CREDENTIALS, new String[] {username, password});
-			}
+				connection = JMXConnectionPool.borrow(url, username, password);
+				mbsc = connection.getMBeanServerConnection();
+				connectionBroken = false;
+
+				JSONArray values = new JSONArray();
+
+				getAttributes();
+
+				for (String key : keys)
+					values.put(getJSONValue(key));
 
-			jmxc = ZabbixJMXConnectorFactory.connect(url, env);
-			mbsc = jmxc.getMBeanServerConnection();
+				if (!connectionBroken)
+				{
+					JMXConnectionPool.release(connection);
+					return values;
+				}
+
+				JMXConnectionPool.invalidate(connection);
 
-			for (String key : keys)
-				values.put(getJSONValue(key));
+				if (!connection.isReused())
+					return values;
+
+				// the pooled connection went stale while idle, retry with a new one
+				logger.debug("pooled connection to JMX agent at '{}' is broken, reconnecting", url);
+				connection = null;
+			}
 		}
 		catch (Exception e)
 		{
+			if (null != connection)
+				JMXConnectionPool.invalidate(connection);
+
 			throw new ZabbixException(e);
 		}
 		finally
 		{
-			try { if (null != jmxc) jmxc.close(); } catch (java.io.IOException exception) { }
-
-			jmxc = null;
 			mbsc = null;
+			attributes = null;
+			attributeErrors = null;
+		}
+	}
+
+	// retrieves attributes requested by jmx[] keys with one call per MBean
+	private void getAttributes()
+	{
+		HashMap<ObjectName, LinkedHashSet<String>> requested = new HashMap<ObjectName, LinkedHashSet<String>>();
+
+		for (String key : keys)
+		{
+			try
+			{
+				ZabbixItem item = new ZabbixItem(key);
+
+				if (!item.getKeyId().equals("jmx") || 2 != item.getArgumentCount())
+					continue;
+
+				ObjectName objectName = new ObjectName(item.getArgument(1));
+				LinkedHashSet<String> names = requested.get(objectName);
+
+				if (null == names)
+				{
+					names = new LinkedHashSet<String>();
+					requested.put(objectName, names);
+				}
+
+				names.add(splitAttributeName(item.getArgument(2))[0]);
+			}
+			catch (Exception e)
+			{
+				// the error is reported when the item value is retrieved
+			}
 		}
 
-		return values;
+		attributes = new HashMap<ObjectName, HashMap<String, Object>>();
+		attributeErrors = new HashMap<ObjectName, Exception>();
+
+		for (ObjectName objectName : requested.keySet())
+		{
+			HashMap<String, Object> values = new HashMap<String, Object>();
+
+			try
+			{
+				String[] names = requested.get(objectName).toArray(new String[0]);
+
+				logger.trace("getting {} attributes of '{}'", names.length, objectName);
+
+				for (Object attribute : mbsc.getAttributes(objectName, names))
+					values.put(((Attribute)attribute).getName(), ((Attribute)attribute).getValue());
+			}
+			catch (IOException e)
+			{
+				connectionBroken = true;
+				attributeErrors.put(objectName, e);
+			}
+			catch (Exception e)
+			{
+				attributeErrors.put(objectName, e);
+			}
+
+			attributes.put(objectName, values);
+		}
+	}
+
+	// splits attribute name into the real attribute name and composite data field names
+	private String[] splitAttributeName(String attributeName)
+	{
+		String realAttributeName;
+		String fieldNames = "";
+
+		// Attribute name and composite data field names are separated by dots. On the other hand the
+		// name may contain a dot too. In this case user needs to escape it with a backslash. Also the
+		// backslash symbols in the name must be escaped. So a real separator is unescaped dot and
+		// separatorIndex() is used to locate it.
+
+		int sep = HelperFunctionChest.separatorIndex(attributeName);
+
+		if (-1 != sep)
+		{
+			logger.trace("'{}' contains composite data", attributeName);
+
+			realAttributeName = attributeName.substring(0, sep);
+			fieldNames = attributeName.substring(sep + 1);
+		}
+		else
+			realAttributeName = attributeName;
+
+		// unescape possible dots or backslashes that were escaped by user
+		realAttributeName = HelperFunctionChest.unescapeUserInput(realAttributeName);
+
+		return new String[] {realAttributeName, fieldNames};
 	}
 
 	@Override
 	protected String getStringValue(String key) throws Exception
+	{
+		try
+		{
+			return getItemValue(key);
+		}
+		catch (IOException e)
+		{
+			connectionBroken = true;
+			throw e;
+		}
+	}
+
+	private String getItemValue(String key) throws Exception
 	{
 		ZabbixItem item = new ZabbixItem(key);
 
@@ -118,32 +242,21 @@ class JMXItemChecker extends ItemChecker
 				throw new ZabbixException("required key format: jmx[<object name>,<attribute name>]");
 
 			ObjectName objectName = new ObjectName(item.getArgument(1));
-			String attributeName = item.getArgument(2);
-			String realAttributeName;
-			String fieldNames = "";
+			String[] names = splitAttributeName(item.getArgument(2));
+			String realAttributeName = names[0];
+			String fieldNames = names[1];
 
-			// Attribute name and composite data field names are separated by dots. On the other hand the
-			// name may contain a dot too. In this case user needs to escape it with a backslash. Also the
-			// backslash symbols in the name must be escaped. So a real separator is unescaped dot and
-			// separatorIndex() is used to locate it.
+			logger.trace("attributeName:'{}'", realAttributeName);
+			logger.trace("fieldNames:'{}'", fieldNames);
 
-			int sep = HelperFunctionChest.separatorIndex(attributeName);
+			if (attributeErrors.containsKey(objectName))
+				throw attributeErrors.get(objectName);
 
-			if (-1 != sep)
-			{
-				logger.trace("'{}' contains composite data", attributeName);
+			HashMap<String, Object> values = attributes.get(objectName);
 
-				realAttributeName = attributeName.substring(0, sep);
-				fieldNames = attributeName.substring(sep + 1);
-			}
-			else
-				realAttributeName = attributeName;
-
-			// unescape possible dots or backslashes that were escaped by user
-			realAttributeName = HelperFunctionChest.unescapeUserInput(realAttributeName);
-
-			logger.trace("attributeName:'{}'", realAttributeName);
-			logger.trace("fieldNames:'{}'", fieldNames);
+			// getAttributes() silently skips attributes it could not retrieve, get them one by one for the error
+			if (null != values && values.containsKey(realAttributeName))
+				return getPrimitiveAttributeValue(values.get(realAttributeName), fieldNames);
 
 			return getPrimitiveAttributeValue(mbsc.getAttribute(objectName, realAttributeName), fieldNames);
 		}
@@ -158,6 +271,8 @@ class JMXItemChecker extends ItemChecker
 			{
 				logger.trace("discovered object '{}'", name);
 
+				ArrayList<MBeanAttributeInfo> attrInfos = new ArrayList<MBeanAttributeInfo>();
+
 				for (MBeanAttributeInfo attrInfo : mbsc.getMBeanInfo(name).getAttributes())
 				{
 					logger.trace("discovered attribute '{}'", attrInfo.getName());
@@ -168,11 +283,52 @@ class JMXItemChecker extends ItemChecker
 						continue;
 					}
 
+					attrInfos.add(attrInfo);
+				}
+
+				HashMap<String, Object> values = null;
+
+				try
+				{
+					String[] attrNames = new String[attrInfos.size()];
+
+					for (int i = 0; i < attrNames.length; i++)
+						attrNames[i] = attrInfos.get(i).getName();
+
+					values = new HashMap<String, Object>();
+
+					for (Object attribute : mbsc.getAttributes(name, attrNames))
+						values.put(((Attribute)attribute).getName(), ((Attribute)attribute).getValue());
+				}
+				catch (IOException e)
+				{
+					throw e;
+				}
+				catch (Exception e)
+				{
+					logger.trace("getting attributes of '{}' failed, getting them one by one", name);
+					values = null;
+				}
+
+				for (MBeanAttributeInfo attrInfo : attrInfos)
+				{
 					try
 					{
 						logger.trace("looking for attributes of primitive types");
 						String descr = (attrInfo.getName().equals(attrInfo.getDescription()) ? null : attrInfo.getDescription());
-						findPrimitiveAttributes(counters, name, descr, attrInfo.getName(), mbsc.getAttribute(name, attrInfo.getName()));
+						Object attribute;
+
+						if (null != values)
+						{
+							if (!values.containsKey(attrInfo.getName()))
+								throw new ZabbixException("attribute was not returned");
+
+							attribute = values.get(attrInfo.getName());
+						}
+						else
+							attribute = mbsc.getAttribute(name, attrInfo.getName());
+
+						findPrimitiveAttributes(counters, name, descr, attrInfo.getName(), attribute);
 					}
 					catch (Exception e)
 					{
@@ -40,6 +40,12 @@ fi
 if [ -n "$TIMEOUT" ]; then
 	ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dzabbix.timeout=$TIMEOUT -Dsun.rmi.transport.tcp.responseTimeout=${TIMEOUT}000"
 fi
+if [ -n "$CONNECTION_POOL_SIZE" ]; then
+	ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dzabbix.connectionPoolSize=$CONNECTION_POOL_SIZE"
+fi
+if [ -n "$CONNECTION_IDLE_TIMEOUT" ]; then
+	ZABBIX_OPTIONS="$ZABBIX_OPTIONS -Dzabbix.connectionIdleTimeout=$CONNECTION_IDLE_TIMEOUT"
+fi
 
 # uncomment to enable remote monitoring of the standard JMX objects on the Zabbix Java Gateway itself
 # JAVA_OPTIONS="$JAVA_OPTIONS -Dcom.sun.management.jmxremote -Dcom.sun.management.jmxremote.port=12345
@@ -0,0 +1,41 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package com.zabbix.gateway;
+
+import org.junit.runner.JUnitCore;
+import org.junit.runner.Result;
+import org.junit.runner.notification.Failure;
+
+public class AllTestRunner
+{
+	public static void main(String[] args)
+	{
+		Result result = JUnitCore.runClasses(
+				JMXConnectionPoolTest.class
+		);
+
+		for (Failure failure : result.getFailures())
+			System.out.println(failure.toString());
+
+		System.out.println("tests run: " + result.getRunCount() + ", failed: " + result.getFailureCount());
+
+		System.exit(result.wasSuccessful() ? 0 : 1);
+	}
+}
@@ -0,0 +1,190 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+package com.zabbix.gateway;
+
+import java.io.IOException;
+import java.lang.management.ManagementFactory;
+
+import javax.management.remote.JMXConnectorServer;
+import javax.management.remote.JMXConnectorServerFactory;
+import javax.management.remote.JMXServiceURL;
+
+import org.junit.After;
+import org.junit.Before;
+import org.junit.Test;
+
+import static org.junit.Assert.assertEquals;
+import static org.junit.Assert.assertFalse;
+import static org.junit.Assert.assertNotSame;
+import static org.junit.Assert.assertSame;
+import static org.junit.Assert.assertTrue;
+import static org.junit.Assert.fail;
+
+public class JMXConnectionPoolTest
+{
+	private JMXConnectorServer server;
+	private JMXServiceURL url;
+
+	@Before
+	public void setUp() throws IOException
+	{
+		// every test gets its own in-process JMX agent, so pool keys of different tests do not overlap
+		server = JMXConnectorServerFactory.newJMXConnectorServer(new JMXServiceURL("service:jmx:rmi://localhost"),
+				null, ManagementFactory.getPlatformMBeanServer());
+		server.start();
+		url = server.getAddress();
+
+		ConfigurationManager.getParameter(ConfigurationManager.CONNECTION_POOL_SIZE).setValue("100");
+		ConfigurationManager.getParameter(ConfigurationManager.CONNECTION_IDLE_TIMEOUT).setValue("60");
+	}
+
+	@After
+	public void tearDown() throws IOException
+	{
+		if (server.isActive())
+			server.stop();
+	}
+
+	@Test
+	public void testReuse() throws IOException
+	{
+		JMXConnectionPool.Connection first = JMXConnectionPool.borrow(url, null, null);
+
+		assertFalse(first.isReused());
+
+		JMXConnectionPool.release(first);
+		assertEquals(1, JMXConnectionPool.getIdleCount());
+
+		JMXConnectionPool.Connection second = JMXConnectionPool.borrow(url, null, null);
+
+		assertSame(first, second);
+		assertTrue(second.isReused());
+		assertEquals(0, JMXConnectionPool.getIdleCount());
+		assertTrue(0 < second.getMBeanServerConnection().getMBeanCount());
+
+		JMXConnectionPool.invalidate(second);
+	}
+
+	@Test
+	public void testNoReuseWithOtherCredentials() throws IOException
+	{
+		JMXConnectionPool.Connection first = JMXConnectionPool.borrow(url, null, null);
+
+		JMXConnectionPool.release(first);
+
+		// the agent does not check credentials, but the pool must not mix connections of different users
+		JMXConnectionPool.Connection second = JMXConnectionPool.borrow(url, "user", "password");
+
+		assertNotSame(first, second);
+		assertFalse(second.isReused());
+		assertEquals(1, JMXConnectionPool.getIdleCount());
+
+		JMXConnectionPool.invalidate(second);
+		JMXConnectionPool.invalidate(JMXConnectionPool.borrow(url, null, null));
+		assertEquals(0, JMXConnectionPool.getIdleCount());
+	}
+
+	@Test
+	public void testPoolSizeLimit() throws IOException
+	{
+		ConfigurationManager.getParameter(ConfigurationManager.CONNECTION_POOL_SIZE).setValue("0");
+
+		JMXConnectionPool.release(JMXConnectionPool.borrow(url, null, null));
+		assertEquals(0, JMXConnectionPool.getIdleCount());
+
+		JMXConnectionPool.Connection connection = JMXConnectionPool.borrow(url, null, null);
+
+		assertFalse(connection.isReused());
+
+		JMXConnectionPool.invalidate(connection);
+	}
+
+	@Test
+	public void testDeadConnectionEviction() throws IOException
+	{
+		JMXConnectionPool.Connection first = JMXConnectionPool.borrow(url, null, null);
+		JMXConnectionPool.Connection second = JMXConnectionPool.borrow(url, null, null);
+
+		JMXConnectionPool.release(first);
+		JMXConnectionPool.release(second);
+		assertEquals(2, JMXConnectionPool.getIdleCount());
+
+		server.stop();
+
+		JMXConnectionPool.Connection connection = JMXConnectionPool.borrow(url, null, null);
+
+		assertTrue(connection.isReused());
+
+		try
+		{
+			connection.getMBeanServerConnection().getMBeanCount();
+			fail("connection to stopped JMX agent must fail");
+		}
+		catch (IOException e)
+		{
+			JMXConnectionPool.invalidate(connection);
+		}
+
+		// the other idle connection to the same agent is dropped too, so the next request connects again
+		assertEquals(0, JMXConnectionPool.getIdleCount());
+
+		try
+		{
+			JMXConnectionPool.borrow(url, null, null);
+			fail("new connection to stopped JMX agent must fail");
+		}
+		catch (IOException e)
+		{
+		}
+	}
+
+	@Test
+	public void testIdleExpiry() throws IOException, InterruptedException
+	{
+		ConfigurationManager.getParameter(ConfigurationManager.CONNECTION_IDLE_TIMEOUT).setValue("1");
+
+		JMXConnectionPool.Connection old = JMXConnectionPool.borrow(url, null, null);
+		JMXConnectionPool.Connection recent = JMXConnectionPool.borrow(url, null, null);
+
+		JMXConnectionPool.release(old);
+		Thread.sleep(1500);
+		JMXConnectionPool.release(recent);
+
+		JMXConnectionPool.expire();
+		assertEquals(1, JMXConnectionPool.getIdleCount());
+
+		JMXConnectionPool.Connection connection = JMXConnectionPool.borrow(url, null, null);
+
+		assertSame(recent, connection);
+
+		Thread.sleep(1500);
+		JMXConnectionPool.release(connection);
+		Thread.sleep(1500);
+
+		JMXConnectionPool.expire();
+		assertEquals(0, JMXConnectionPool.getIdleCount());
+
+		connection = JMXConnectionPool.borrow(url, null, null);
+
+		assertFalse(connection.isReused());
+
+		JMXConnectionPool.invalidate(connection);
+	}
+}
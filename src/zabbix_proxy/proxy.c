@@ -27,6 +27,7 @@
 #include "log.h"
 #include "zbxgetopt.h"
 #include "mutexs.h"
+#include "memalloc.h"
 #include "proxy.h"
 
 #include "sysinfo.h"
@@ -45,6 +46,7 @@
 #include "../zabbix_server/pinger/pinger.h"
 #include "../zabbix_server/poller/poller.h"
 #include "../zabbix_server/poller/checks_ipmi.h"
+#include "../zabbix_server/poller/checks_snmp.h"
 #include "../zabbix_server/trapper/trapper.h"
 #include "../zabbix_server/snmptrapper/snmptrapper.h"
 #include "proxyconfig/proxyconfig.h"
@@ -81,6 +83,10 @@ const char	*help_message[] = {
 	"    Runtime control options:",
 	"      " ZBX_CONFIG_CACHE_RELOAD "        Reload configuration cache",
 	"      " ZBX_HOUSEKEEPER_EXECUTE "        Execute the housekeeper",
+	"      " ZBX_MEMORY_REPORT "              Write cache memory usage report to log file",
+	"      " ZBX_LATENCY_REPORT "             Write value processing latency report to log",
+	"                                 file",
+	"      " ZBX_LOCK_REPORT "                Write lock contention report to log file",
 	"      " ZBX_LOG_LEVEL_INCREASE "=target  Increase log level, affects all processes if",
 	"                                 target is not specified",
 	"      " ZBX_LOG_LEVEL_DECREASE "=target  Decrease log level, affects all processes if",
@@ -126,11 +132,17 @@ int		server_num		= 0;
 int	CONFIG_PROXYMODE		= ZBX_PROXYMODE_ACTIVE;
 int	CONFIG_DATASENDER_FORKS		= 1;
 int	CONFIG_DISCOVERER_FORKS		= 1;
+int	CONFIG_DISCOVERER_CONCURRENCY	= 256;
+int	CONFIG_ODBC_POOL_IDLE_TIMEOUT	= 60;
+int	CONFIG_ODBC_POOL_MAX_PER_DSN	= 4;
+int	CONFIG_REMOTE_SESSION_IDLE_TIMEOUT	= 60;
+int	CONFIG_TELNET_SESSION_REUSE	= 0;
 int	CONFIG_HOUSEKEEPER_FORKS	= 1;
 int	CONFIG_PINGER_FORKS		= 1;
 int	CONFIG_POLLER_FORKS		= 5;
 int	CONFIG_UNREACHABLE_POLLER_FORKS	= 1;
 int	CONFIG_HTTPPOLLER_FORKS		= 1;
+int	CONFIG_HTTPPOLLER_CONCURRENCY	= 16;
 int	CONFIG_IPMIPOLLER_FORKS		= 0;
 int	CONFIG_TRAPPER_FORKS		= 5;
 int	CONFIG_SNMPTRAPPER_FORKS	= 0;
@@ -146,6 +158,7 @@ int	CONFIG_COLLECTOR_FORKS		= 0;
 int	CONFIG_PASSIVE_FORKS		= 0;
 int	CONFIG_ACTIVE_FORKS		= 0;
 int	CONFIG_TASKMANAGER_FORKS	= 0;
+int	CONFIG_PREPROCESSOR_FORKS	= 0;
 
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_SERVER_PORT;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -177,6 +190,11 @@ zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 0;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 0;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * ZBX_MEBIBYTE;
+zbx_uint64_t	CONFIG_SNMP_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
+
+int	CONFIG_HUGE_PAGES		= 0;
+
+int	CONFIG_SNMP_ASYNC_HOSTS		= 0;
 
 int	CONFIG_UNREACHABLE_PERIOD	= 45;
 int	CONFIG_UNREACHABLE_DELAY	= 15;
@@ -184,6 +202,7 @@ int	CONFIG_UNAVAILABLE_DELAY	= 60;
 int	CONFIG_LOG_LEVEL		= LOG_LEVEL_WARNING;
 char	*CONFIG_ALERT_SCRIPTS_PATH	= NULL;
 char	*CONFIG_EXTERNALSCRIPTS		= NULL;
+char	*CONFIG_EXTERNALSCRIPTS_PERSISTENT	= NULL;
 char	*CONFIG_TMPDIR			= NULL;
 char	*CONFIG_FPING_LOCATION		= NULL;
 char	*CONFIG_FPING6_LOCATION		= NULL;
@@ -544,14 +563,22 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	1,			100},
 		{"StartDiscoverers",		&CONFIG_DISCOVERER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			250},
+		{"DiscovererConcurrency",	&CONFIG_DISCOVERER_CONCURRENCY,		TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{"StartHTTPPollers",		&CONFIG_HTTPPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"HTTPPollerConcurrency",	&CONFIG_HTTPPOLLER_CONCURRENCY,		TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{"StartPingers",		&CONFIG_PINGER_FORKS,			TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"StartPollers",		&CONFIG_POLLER_FORKS,			TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"StartPollersUnreachable",	&CONFIG_UNREACHABLE_POLLER_FORKS,	TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"SNMPAsyncHosts",		&CONFIG_SNMP_ASYNC_HOSTS,		TYPE_INT,
+			PARM_OPT,	0,			256},
+		{"SNMPIndexCacheSize",		&CONFIG_SNMP_INDEX_CACHE_SIZE,		TYPE_UINT64,
+			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"StartIPMIPollers",		&CONFIG_IPMIPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"StartTrappers",		&CONFIG_TRAPPER_FORKS,			TYPE_INT,
@@ -572,6 +599,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"HistoryIndexCacheSize",	&CONFIG_HISTORY_INDEX_CACHE_SIZE,	TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"HugePages",			&CONFIG_HUGE_PAGES,			TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"HousekeepingFrequency",	&CONFIG_HOUSEKEEPING_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	0,			24},
 		{"ProxyLocalBuffer",		&CONFIG_PROXY_LOCAL_BUFFER,		TYPE_INT,
@@ -592,6 +621,14 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"Timeout",			&CONFIG_TIMEOUT,			TYPE_INT,
 			PARM_OPT,	1,			30},
+		{"ODBCPoolIdleTimeout",		&CONFIG_ODBC_POOL_IDLE_TIMEOUT,		TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR},
+		{"ODBCPoolMaxPerDSN",		&CONFIG_ODBC_POOL_MAX_PER_DSN,		TYPE_INT,
+			PARM_OPT,	1,			100},
+		{"RemoteSessionIdleTimeout",	&CONFIG_REMOTE_SESSION_IDLE_TIMEOUT,	TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR},
+		{"TelnetSessionReuse",		&CONFIG_TELNET_SESSION_REUSE,		TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"TrapperTimeout",		&CONFIG_TRAPPER_TIMEOUT,		TYPE_INT,
 			PARM_OPT,	1,			300},
 		{"UnreachablePeriod",		&CONFIG_UNREACHABLE_PERIOD,		TYPE_INT,
@@ -618,6 +655,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			1024},
 		{"ExternalScripts",		&CONFIG_EXTERNALSCRIPTS,		TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"PersistentExternalScripts",	&CONFIG_EXTERNALSCRIPTS_PERSISTENT,	TYPE_STRING_LIST,
+			PARM_OPT,	0,			0},
 		{"DBHost",			&CONFIG_DBHOST,				TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"DBName",			&CONFIG_DBNAME,				TYPE_STRING,
@@ -805,10 +844,39 @@ int	main(int argc, char **argv)
 	return daemon_start(CONFIG_ALLOW_ROOT, CONFIG_USER, t.flags);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_memory_report                                                *
+ *                                                                            *
+ * Purpose: write cache memory usage report to log file                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_memory_report(void)
+{
+	zbx_vector_ptr_t	usage;
+
+	zbx_vector_ptr_create(&usage);
+
+	DCconfig_log_memory_usage();
+
+	DCget_memory_usage(&usage);
+	zbx_mem_usage_log("history cache", &usage);
+	zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	DClog_memory_stats();
+
+	if (SUCCEED == zbx_vmware_get_memory_usage(&usage))
+	{
+		zbx_mem_usage_log("vmware cache", &usage);
+		zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	}
+
+	zbx_vector_ptr_destroy(&usage);
+}
+
 int	MAIN_ZABBIX_ENTRY(int flags)
 {
 	zbx_socket_t	listen_sock;
-	int		i, db_type;
+	int		i, db_type, rtc_pending;
 
 	if (0 != (flags & ZBX_TASK_FLAG_FOREGROUND))
 	{
@@ -892,6 +960,12 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 
 	zbx_free_config();
 
+	if (SUCCEED != zbx_mutex_stats_init())
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize lock statistics, exiting...");
+		exit(EXIT_FAILURE);
+	}
+
 	init_database_cache();
 	init_configuration_cache();
 	init_selfmon_collector();
@@ -901,6 +975,11 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 	if (0 != CONFIG_VMWARE_FORKS)
 		zbx_vmware_init();
 
+#ifdef HAVE_NETSNMP
+	/* initialize SNMP dynamic index cache */
+	zbx_snmpidx_init();
+#endif
+
 	DBinit();
 
 	if (ZBX_DB_UNKNOWN == (db_type = zbx_db_get_database_type()))
@@ -1028,6 +1107,17 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 			zabbix_log(LOG_LEVEL_ERR, "failed to wait on child processes: %s", zbx_strerror(errno));
 			break;
 		}
+
+		rtc_pending = zbx_rtc_get_pending();
+
+		if (0 != (rtc_pending & ZBX_RTC_PENDING(ZBX_RTC_MEMORY_REPORT)))
+			zbx_memory_report();
+
+		if (0 != (rtc_pending & ZBX_RTC_PENDING(ZBX_RTC_LATENCY_REPORT)))
+			log_latency_stats();
+
+		if (0 != (rtc_pending & ZBX_RTC_PENDING(ZBX_RTC_LOCK_REPORT)))
+			zbx_mutex_stats_log();
 	}
 
 	/* all exiting child processes should be caught by signal handlers */
@@ -1085,6 +1175,11 @@ void	zbx_on_exit(void)
 	if (0 != CONFIG_VMWARE_FORKS)
 		zbx_vmware_destroy();
 
+#ifdef HAVE_NETSNMP
+	/* free SNMP dynamic index cache */
+	zbx_snmpidx_destroy();
+#endif
+
 	free_selfmon_collector();
 	free_proxy_history_lock();
 
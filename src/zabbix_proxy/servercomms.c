@@ -23,6 +23,7 @@
 #include "db.h"
 #include "log.h"
 #include "zbxjson.h"
+#include "proxy.h"
 
 #include "comms.h"
 #include "servercomms.h"
@@ -129,6 +130,10 @@ int	get_data_from_server(zbx_socket_t *sock, const char *request, char **error)
 	zbx_json_addstring(&j, "request", request, ZBX_JSON_TYPE_STRING);
 	zbx_json_addstring(&j, "host", CONFIG_HOSTNAME, ZBX_JSON_TYPE_STRING);
 
+	/* let server send only the configuration changes */
+	if (0 == strcmp(request, ZBX_PROTO_VALUE_PROXY_CONFIG))
+		get_proxyconfig_digest(&j);
+
 	if (SUCCEED != zbx_tcp_send(sock, j.buffer))
 	{
 		*error = zbx_strdup(*error, zbx_socket_strerror());
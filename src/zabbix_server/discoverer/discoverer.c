@@ -33,11 +33,54 @@
 #include "../poller/checks_snmp.h"
 #include "../../libs/zbxcrypto/tls.h"
 
+#include <poll.h>
+
 extern int		CONFIG_DISCOVERER_FORKS;
+extern int		CONFIG_DISCOVERER_CONCURRENCY;
 extern unsigned char	process_type, program_type;
 extern int		server_num, process_num;
 
 #define ZBX_DISCOVERER_IPRANGE_LIMIT	(1 << 16)
+#define ZBX_DISCOVERER_SNMP_HOSTS	256	/* the maximum number of concurrent SNMP sessions */
+
+/* discovery check of the rule being processed */
+typedef struct
+{
+	DB_DCHECK	dcheck;
+	int		*ports;		/* expanded list of ports */
+	int		ports_num;
+	int		deleted;	/* the check was deleted during processing */
+}
+zbx_discovery_check_t;
+
+/* address being discovered */
+typedef struct
+{
+	char	ip[INTERFACE_IP_LEN_MAX];
+	char	dns[INTERFACE_DNS_LEN_MAX];
+	int	status;		/* the host status, -1 if there are no checks */
+	int	known;		/* the address has services discovered earlier */
+}
+zbx_discovery_ip_t;
+
+#define ZBX_DISCOVERY_PROBE_NEW		0
+#define ZBX_DISCOVERY_PROBE_CONNECTED	1	/* the service accepts TCP connections */
+#define ZBX_DISCOVERY_PROBE_DONE	2
+
+/* a check of a single port of an address */
+typedef struct
+{
+	int		ip_index;
+	int		check_index;
+	int		port;
+	int		state;
+	int		status;
+	char		*value;
+}
+zbx_discovery_probe_t;
+
+#define DISCOVERY_PROBE_DCHECK(probe, checks)	\
+		(&((zbx_discovery_check_t *)(checks)->values[(probe)->check_index])->dcheck)
 
 /******************************************************************************
  *                                                                            *
@@ -93,6 +136,77 @@ static void	proxy_update_host(DB_DRULE *drule, const char *ip, const char *dns,
 	zbx_free(ip_esc);
 }
 
+#ifdef HAVE_NETSNMP
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_snmp_item_init                                         *
+ *                                                                            *
+ * Purpose: set SNMP fields of the item used to perform discovery check       *
+ *                                                                            *
+ * Parameters: item   - [IN/OUT] the item with set type and interface         *
+ *             dcheck - [IN] the discovery check                              *
+ *                                                                            *
+ ******************************************************************************/
+static void	discovery_snmp_item_init(DC_ITEM *item, const DB_DCHECK *dcheck)
+{
+	item->snmp_community = strdup(dcheck->snmp_community);
+	item->snmp_oid = strdup(dcheck->key_);
+
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+			&item->snmp_community, MACRO_TYPE_COMMON, NULL, 0);
+	substitute_key_macros(&item->snmp_oid, NULL, NULL, NULL,
+			MACRO_TYPE_SNMP_OID, NULL, 0);
+
+	if (ITEM_TYPE_SNMPv3 == item->type)
+	{
+		item->snmpv3_securityname =
+				zbx_strdup(NULL, dcheck->snmpv3_securityname);
+		item->snmpv3_securitylevel = dcheck->snmpv3_securitylevel;
+		item->snmpv3_authpassphrase =
+				zbx_strdup(NULL, dcheck->snmpv3_authpassphrase);
+		item->snmpv3_privpassphrase =
+				zbx_strdup(NULL, dcheck->snmpv3_privpassphrase);
+		item->snmpv3_authprotocol = dcheck->snmpv3_authprotocol;
+		item->snmpv3_privprotocol = dcheck->snmpv3_privprotocol;
+		item->snmpv3_contextname = zbx_strdup(NULL, dcheck->snmpv3_contextname);
+
+		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+				&item->snmpv3_securityname, MACRO_TYPE_COMMON,
+				NULL, 0);
+		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+				&item->snmpv3_authpassphrase, MACRO_TYPE_COMMON,
+				NULL, 0);
+		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+				&item->snmpv3_privpassphrase, MACRO_TYPE_COMMON,
+				NULL, 0);
+		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+				&item->snmpv3_contextname, MACRO_TYPE_COMMON,
+				NULL, 0);
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_snmp_item_clean                                        *
+ *                                                                            *
+ * Purpose: free SNMP fields set by discovery_snmp_item_init()                *
+ *                                                                            *
+ ******************************************************************************/
+static void	discovery_snmp_item_clean(DC_ITEM *item)
+{
+	zbx_free(item->snmp_community);
+	zbx_free(item->snmp_oid);
+
+	if (ITEM_TYPE_SNMPv3 == item->type)
+	{
+		zbx_free(item->snmpv3_securityname);
+		zbx_free(item->snmpv3_authpassphrase);
+		zbx_free(item->snmpv3_privpassphrase);
+		zbx_free(item->snmpv3_contextname);
+	}
+}
+#endif	/* HAVE_NETSNMP */
+
 /******************************************************************************
  *                                                                            *
  * Function: discover_service                                                 *
@@ -235,56 +349,14 @@ static int	discover_service(DB_DCHECK *dcheck, char *ip, int port, char **value,
 				else
 #ifdef HAVE_NETSNMP
 				{
-					item.snmp_community = strdup(dcheck->snmp_community);
-					item.snmp_oid = strdup(dcheck->key_);
-
-					substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-							&item.snmp_community, MACRO_TYPE_COMMON, NULL, 0);
-					substitute_key_macros(&item.snmp_oid, NULL, NULL, NULL,
-							MACRO_TYPE_SNMP_OID, NULL, 0);
-
-					if (ITEM_TYPE_SNMPv3 == item.type)
-					{
-						item.snmpv3_securityname =
-								zbx_strdup(NULL, dcheck->snmpv3_securityname);
-						item.snmpv3_securitylevel = dcheck->snmpv3_securitylevel;
-						item.snmpv3_authpassphrase =
-								zbx_strdup(NULL, dcheck->snmpv3_authpassphrase);
-						item.snmpv3_privpassphrase =
-								zbx_strdup(NULL, dcheck->snmpv3_privpassphrase);
-						item.snmpv3_authprotocol = dcheck->snmpv3_authprotocol;
-						item.snmpv3_privprotocol = dcheck->snmpv3_privprotocol;
-						item.snmpv3_contextname = zbx_strdup(NULL, dcheck->snmpv3_contextname);
-
-						substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-								&item.snmpv3_securityname, MACRO_TYPE_COMMON,
-								NULL, 0);
-						substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-								&item.snmpv3_authpassphrase, MACRO_TYPE_COMMON,
-								NULL, 0);
-						substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-								&item.snmpv3_privpassphrase, MACRO_TYPE_COMMON,
-								NULL, 0);
-						substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-								&item.snmpv3_contextname, MACRO_TYPE_COMMON,
-								NULL, 0);
-					}
+					discovery_snmp_item_init(&item, dcheck);
 
 					if (SUCCEED == get_value_snmp(&item, &result) && NULL != GET_STR_RESULT(&result))
 						zbx_strcpy_alloc(value, value_alloc, &value_offset, result.str);
 					else
 						ret = FAIL;
 
-					zbx_free(item.snmp_community);
-					zbx_free(item.snmp_oid);
-
-					if (ITEM_TYPE_SNMPv3 == item.type)
-					{
-						zbx_free(item.snmpv3_securityname);
-						zbx_free(item.snmpv3_authpassphrase);
-						zbx_free(item.snmpv3_privpassphrase);
-						zbx_free(item.snmpv3_contextname);
-					}
+					discovery_snmp_item_clean(&item);
 				}
 #else
 					ret = FAIL;
@@ -320,28 +392,35 @@ static int	discover_service(DB_DCHECK *dcheck, char *ip, int port, char **value,
 
 /******************************************************************************
  *                                                                            *
- * Function: process_check                                                    *
+ * Function: discovery_check_free                                             *
  *                                                                            *
- * Purpose: check if service is available and update database                 *
+ ******************************************************************************/
+static void	discovery_check_free(zbx_discovery_check_t *check)
+{
+	zbx_free(check->dcheck.key_);
+	zbx_free(check->dcheck.snmp_community);
+	zbx_free(check->dcheck.snmpv3_securityname);
+	zbx_free(check->dcheck.snmpv3_authpassphrase);
+	zbx_free(check->dcheck.snmpv3_privpassphrase);
+	zbx_free(check->dcheck.snmpv3_contextname);
+	zbx_free(check->dcheck.ports);
+	zbx_free(check->ports);
+	zbx_free(check);
+}
+
+/******************************************************************************
  *                                                                            *
- * Parameters: service - service info                                         *
+ * Function: discovery_check_parse_ports                                      *
+ *                                                                            *
+ * Purpose: expand the port list of discovery check, like "21,22,8080-8090"   *
  *                                                                            *
  ******************************************************************************/
-static void	process_check(DB_DRULE *drule, DB_DCHECK *dcheck, DB_DHOST *dhost, int *host_status, char *ip,
-		const char *dns, int now)
+static void	discovery_check_parse_ports(zbx_discovery_check_t *check)
 {
-	const char	*__function_name = "process_check";
-	int		port, first, last;
-	char		*start, *comma, *last_port;
-	int		status;
-	char		*value = NULL;
-	size_t		value_alloc = 128;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+	int	port, first, last, ports_alloc = 0;
+	char	*start, *comma, *last_port;
 
-	value = zbx_malloc(value, value_alloc);
-
-	for (start = dcheck->ports; '\0' != *start;)
+	for (start = check->dcheck.ports; '\0' != *start;)
 	{
 		if (NULL != (comma = strchr(start, ',')))
 			*comma = '\0';
@@ -358,32 +437,13 @@ static void	process_check(DB_DRULE *drule, DB_DCHECK *dcheck, DB_DHOST *dhost, i
 
 		for (port = first; port <= last; port++)
 		{
-			zabbix_log(LOG_LEVEL_DEBUG, "%s() port:%d", __function_name, port);
-
-			status = (SUCCEED == discover_service(dcheck, ip, port, &value, &value_alloc) ?
-					DOBJECT_STATUS_UP : DOBJECT_STATUS_DOWN);
-
-			/* update host status */
-			if (-1 == *host_status || DOBJECT_STATUS_UP == status)
-				*host_status = status;
-
-			DBbegin();
-
-			if (SUCCEED != DBlock_dcheckid(dcheck->dcheckid, drule->druleid))
+			if (check->ports_num == ports_alloc)
 			{
-				DBrollback();
-
-				zabbix_log(LOG_LEVEL_DEBUG, "discovery check was deleted during processing, stopping");
-
-				goto out;
+				ports_alloc += 16;
+				check->ports = zbx_realloc(check->ports, sizeof(int) * ports_alloc);
 			}
 
-			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
-				discovery_update_service(drule, dcheck, dhost, ip, dns, port, status, value, now);
-			else if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY))
-				proxy_update_service(drule, dcheck, ip, dns, port, status, value, now);
-
-			DBcommit();
+			check->ports[check->ports_num++] = port;
 		}
 
 		if (NULL != comma)
@@ -394,64 +454,660 @@ static void	process_check(DB_DRULE *drule, DB_DCHECK *dcheck, DB_DHOST *dhost, i
 		else
 			break;
 	}
-out:
-	zbx_free(value);
-
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: process_checks                                                   *
+ * Function: discovery_load_checks                                            *
+ *                                                                            *
+ * Purpose: load checks of discovery rule                                     *
+ *                                                                            *
+ * Parameters: drule  - [IN] the discovery rule                               *
+ *             checks - [OUT] the checks, the unique check goes first, so     *
+ *                            that it identifies the discovered host          *
+ *                                                                            *
+ * Return value: the number of probes per address                             *
  *                                                                            *
  ******************************************************************************/
-static void	process_checks(DB_DRULE *drule, DB_DHOST *dhost, int *host_status,
-		char *ip, const char *dns, int unique, int now)
+static int	discovery_load_checks(const DB_DRULE *drule, zbx_vector_ptr_t *checks)
 {
-	DB_RESULT	result;
-	DB_ROW		row;
-	DB_DCHECK	dcheck;
-	char		sql[MAX_STRING_LEN];
-	size_t		offset = 0;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_discovery_check_t	*check;
+	int			probes_num = 0;
 
-	offset += zbx_snprintf(sql + offset, sizeof(sql) - offset,
+	result = DBselect(
 			"select dcheckid,type,key_,snmp_community,snmpv3_securityname,snmpv3_securitylevel,"
 				"snmpv3_authpassphrase,snmpv3_privpassphrase,snmpv3_authprotocol,snmpv3_privprotocol,"
 				"ports,snmpv3_contextname"
 			" from dchecks"
-			" where druleid=" ZBX_FS_UI64,
+			" where druleid=" ZBX_FS_UI64
+			" order by dcheckid",
 			drule->druleid);
 
-	if (0 != drule->unique_dcheckid)
+	while (NULL != (row = DBfetch(result)))
+	{
+		check = zbx_malloc(NULL, sizeof(zbx_discovery_check_t));
+		memset(check, 0, sizeof(zbx_discovery_check_t));
+
+		ZBX_STR2UINT64(check->dcheck.dcheckid, row[0]);
+		check->dcheck.type = atoi(row[1]);
+		check->dcheck.key_ = zbx_strdup(NULL, row[2]);
+		check->dcheck.snmp_community = zbx_strdup(NULL, row[3]);
+		check->dcheck.snmpv3_securityname = zbx_strdup(NULL, row[4]);
+		check->dcheck.snmpv3_securitylevel = (unsigned char)atoi(row[5]);
+		check->dcheck.snmpv3_authpassphrase = zbx_strdup(NULL, row[6]);
+		check->dcheck.snmpv3_privpassphrase = zbx_strdup(NULL, row[7]);
+		check->dcheck.snmpv3_authprotocol = (unsigned char)atoi(row[8]);
+		check->dcheck.snmpv3_privprotocol = (unsigned char)atoi(row[9]);
+		check->dcheck.ports = zbx_strdup(NULL, row[10]);
+		check->dcheck.snmpv3_contextname = zbx_strdup(NULL, row[11]);
+
+		discovery_check_parse_ports(check);
+		probes_num += check->ports_num;
+
+		if (check->dcheck.dcheckid == drule->unique_dcheckid && 0 != checks->values_num)
+		{
+			/* move the unique check to the front keeping the order of the other checks */
+			zbx_vector_ptr_append(checks, NULL);
+			memmove(&checks->values[1], &checks->values[0], sizeof(void *) * (checks->values_num - 1));
+			checks->values[0] = check;
+		}
+		else
+			zbx_vector_ptr_append(checks, check);
+	}
+	DBfree_result(result);
+
+	return probes_num;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_probes_ping                                            *
+ *                                                                            *
+ * Purpose: perform ICMP checks of all addresses with a single ping run       *
+ *                                                                            *
+ ******************************************************************************/
+static void	discovery_probes_ping(zbx_discovery_probe_t *probes, int probes_num, const zbx_vector_ptr_t *checks,
+		zbx_discovery_ip_t *ips, int ips_num)
+{
+	ZBX_FPING_HOST	*hosts;
+	int		i, *index, hosts_num = 0;
+	char		error[ITEM_ERROR_LEN_MAX];
+
+	hosts = zbx_malloc(NULL, sizeof(ZBX_FPING_HOST) * ips_num);
+	index = zbx_malloc(NULL, sizeof(int) * ips_num);
+
+	for (i = 0; i < ips_num; i++)
+		index[i] = -1;
+
+	for (i = 0; i < probes_num; i++)
+	{
+		if (SVC_ICMPPING != DISCOVERY_PROBE_DCHECK(&probes[i], checks)->type || -1 != index[probes[i].ip_index])
+			continue;
+
+		index[probes[i].ip_index] = hosts_num;
+
+		memset(&hosts[hosts_num], 0, sizeof(ZBX_FPING_HOST));
+		hosts[hosts_num++].addr = ips[probes[i].ip_index].ip;
+	}
+
+	if (0 != hosts_num && SUCCEED != do_ping(hosts, hosts_num, 3, 0, 0, 0, error, sizeof(error)))
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "discovery: cannot ping %d addresses: %s", hosts_num, error);
+
+		for (i = 0; i < hosts_num; i++)
+			hosts[i].rcv = 0;
+	}
+
+	for (i = 0; i < probes_num; i++)
+	{
+		if (SVC_ICMPPING != DISCOVERY_PROBE_DCHECK(&probes[i], checks)->type)
+			continue;
+
+		if (0 != hosts[index[probes[i].ip_index]].rcv)
+			probes[i].status = DOBJECT_STATUS_UP;
+
+		probes[i].state = ZBX_DISCOVERY_PROBE_DONE;
+	}
+
+	zbx_free(index);
+	zbx_free(hosts);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_probe_connect                                          *
+ *                                                                            *
+ * Purpose: start non-blocking TCP connection to the probed service           *
+ *                                                                            *
+ * Return value: the socket of connection in progress or -1 if the probe      *
+ *               is finished                                                  *
+ *                                                                            *
+ ******************************************************************************/
+static int	discovery_probe_connect(zbx_discovery_probe_t *probe, const char *ip)
+{
+	struct addrinfo	hints, *ai = NULL, *ai_bind = NULL;
+	char		service[8];
+	int		fd = -1;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = PF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICHOST;
+
+	zbx_snprintf(service, sizeof(service), "%d", probe->port);
+
+	if (0 != getaddrinfo(ip, service, &hints, &ai))
+		goto out;
+
+	if (-1 == (fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)))
+		goto out;
+
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	if (-1 == fcntl(fd, F_SETFL, O_NONBLOCK | fcntl(fd, F_GETFL)))
+		goto fail;
+
+	if (NULL != CONFIG_SOURCE_IP)
 	{
-		offset += zbx_snprintf(sql + offset, sizeof(sql) - offset, " and dcheckid%s" ZBX_FS_UI64,
-				unique ? "=" : "<>", drule->unique_dcheckid);
+		hints.ai_family = ai->ai_family;
+
+		if (0 != getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai_bind) ||
+				0 != bind(fd, ai_bind->ai_addr, ai_bind->ai_addrlen))
+		{
+			goto fail;
+		}
 	}
 
-	offset += zbx_snprintf(sql + offset, sizeof(sql) - offset, " order by dcheckid");
+	if (0 == connect(fd, ai->ai_addr, ai->ai_addrlen))
+	{
+		probe->state = ZBX_DISCOVERY_PROBE_CONNECTED;
+		goto fail;
+	}
+
+	if (EINPROGRESS == errno)
+		goto out;
+fail:
+	close(fd);
+	fd = -1;
+out:
+	if (NULL != ai_bind)
+		freeaddrinfo(ai_bind);
+
+	if (NULL != ai)
+		freeaddrinfo(ai);
+
+	return fd;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_probes_connect                                         *
+ *                                                                            *
+ * Purpose: check which TCP services accept connections, up to                *
+ *          DiscovererConcurrency connections are in progress at once         *
+ *                                                                            *
+ * Comments: The services that only need a connection are up when the        *
+ *           connection is established. The other services are queried later  *
+ *           with regular checks, but only if they accept connections.        *
+ *                                                                            *
+ ******************************************************************************/
+static void	discovery_probes_connect(zbx_discovery_probe_t *probes, int probes_num, const zbx_vector_ptr_t *checks,
+		const zbx_discovery_ip_t *ips)
+{
+	const char		*__function_name = "discovery_probes_connect";
+
+	zbx_discovery_probe_t	*probe, **active;
+	struct pollfd		*fds;
+	int			i, next = 0, active_num = 0, rc, err, connected = 0;
+	socklen_t		err_len;
+	double			*deadlines, now, wait;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	active = zbx_malloc(NULL, sizeof(zbx_discovery_probe_t *) * CONFIG_DISCOVERER_CONCURRENCY);
+	fds = zbx_malloc(NULL, sizeof(struct pollfd) * CONFIG_DISCOVERER_CONCURRENCY);
+	deadlines = zbx_malloc(NULL, sizeof(double) * CONFIG_DISCOVERER_CONCURRENCY);
+
+	while (1)
+	{
+		now = zbx_time();
+
+		for (; next < probes_num && active_num < CONFIG_DISCOVERER_CONCURRENCY; next++)
+		{
+			probe = &probes[next];
+
+			if (ZBX_DISCOVERY_PROBE_NEW != probe->state)
+				continue;
+
+			switch (DISCOVERY_PROBE_DCHECK(probe, checks)->type)
+			{
+				case SVC_ICMPPING:
+				case SVC_SNMPv1:
+				case SVC_SNMPv2c:
+				case SVC_SNMPv3:
+					continue;
+			}
+
+			probe->state = ZBX_DISCOVERY_PROBE_DONE;
+
+			if (-1 == (fds[active_num].fd = discovery_probe_connect(probe, ips[probe->ip_index].ip)))
+				continue;
+
+			fds[active_num].events = POLLOUT;
+			deadlines[active_num] = now + CONFIG_TIMEOUT;
+			active[active_num++] = probe;
+		}
+
+		if (0 == active_num)
+			break;
+
+		wait = CONFIG_TIMEOUT;
+
+		for (i = 0; i < active_num; i++)
+			wait = MIN(wait, deadlines[i] - now);
+
+		wait = MAX(wait, 0);
+
+		/* poll() has no limit on descriptor numbers unlike select() and FD_SETSIZE */
+		if (-1 == (rc = poll(fds, active_num, (int)(wait * 1000) + 1)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			/* the connections in progress are treated as failed */
+			zabbix_log(LOG_LEVEL_WARNING, "discovery: poll() failed: %s", zbx_strerror(errno));
+		}
+
+		now = zbx_time();
+
+		for (i = 0; i < active_num; i++)
+		{
+			if (0 < rc && 0 != fds[i].revents)
+			{
+				err_len = sizeof(err);
+
+				if (0 == getsockopt(fds[i].fd, SOL_SOCKET, SO_ERROR, &err, &err_len) && 0 == err)
+					active[i]->state = ZBX_DISCOVERY_PROBE_CONNECTED;
+			}
+			else if (now < deadlines[i] && -1 != rc)
+				continue;
+
+			close(fds[i].fd);
+
+			if (ZBX_DISCOVERY_PROBE_CONNECTED == active[i]->state)
+				connected++;
+
+			active_num--;
+			active[i] = active[active_num];
+			fds[i] = fds[active_num];
+			deadlines[i--] = deadlines[active_num];
+		}
+	}
+
+	for (i = 0; i < probes_num; i++)
+	{
+		if (ZBX_DISCOVERY_PROBE_CONNECTED != probes[i].state)
+			continue;
+
+		switch (DISCOVERY_PROBE_DCHECK(&probes[i], checks)->type)
+		{
+			case SVC_TCP:
+			case SVC_HTTP:
+				/* these services are up when connection is accepted */
+				probes[i].status = DOBJECT_STATUS_UP;
+				probes[i].state = ZBX_DISCOVERY_PROBE_DONE;
+				break;
+		}
+	}
+
+	zbx_free(deadlines);
+	zbx_free(fds);
+	zbx_free(active);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() connected:%d", __function_name, connected);
+}
+
+#ifdef HAVE_NETSNMP
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_probes_snmp                                            *
+ *                                                                            *
+ * Purpose: perform SNMP checks of many addresses at once                     *
+ *                                                                            *
+ * Comments: the checks that cannot be performed asynchronously are left for  *
+ *           regular processing                                               *
+ *                                                                            *
+ ******************************************************************************/
+static void	discovery_probes_snmp(zbx_discovery_probe_t *probes, int probes_num, const zbx_vector_ptr_t *checks,
+		zbx_discovery_ip_t *ips)
+{
+	zbx_discovery_probe_t	**batch_probes;
+	zbx_snmp_batch_t	*batches;
+	DC_ITEM			*items, *item;
+	AGENT_RESULT		*results;
+	int			*errcodes, i, j, batch_max, num = 0;
+	const DB_DCHECK		*dcheck;
+
+	batch_max = MIN(CONFIG_DISCOVERER_CONCURRENCY, ZBX_DISCOVERER_SNMP_HOSTS);
+
+	batch_probes = zbx_malloc(NULL, sizeof(zbx_discovery_probe_t *) * batch_max);
+	batches = zbx_malloc(NULL, sizeof(zbx_snmp_batch_t) * batch_max);
+	items = zbx_malloc(NULL, sizeof(DC_ITEM) * batch_max);
+	results = zbx_malloc(NULL, sizeof(AGENT_RESULT) * batch_max);
+	errcodes = zbx_malloc(NULL, sizeof(int) * batch_max);
+
+	for (i = 0; i <= probes_num; i++)
+	{
+		if (i < probes_num)
+		{
+			dcheck = DISCOVERY_PROBE_DCHECK(&probes[i], checks);
+
+			if (ZBX_DISCOVERY_PROBE_NEW != probes[i].state ||
+					(SVC_SNMPv1 != dcheck->type && SVC_SNMPv2c != dcheck->type))
+			{
+				continue;
+			}
+
+			item = &items[num];
+			memset(item, 0, sizeof(DC_ITEM));
+
+			strscpy(item->key_orig, dcheck->key_);
+			item->key = item->key_orig;
+			item->interface.useip = 1;
+			item->interface.addr = ips[probes[i].ip_index].ip;
+			item->interface.port = probes[i].port;
+			item->value_type = ITEM_VALUE_TYPE_STR;
+			item->type = (SVC_SNMPv1 == dcheck->type ? ITEM_TYPE_SNMPv1 : ITEM_TYPE_SNMPv2c);
+
+			discovery_snmp_item_init(item, dcheck);
+			errcodes[num] = SUCCEED;
+
+			if (SUCCEED != zbx_snmp_async_supported(item, &errcodes[num], 1))
+			{
+				discovery_snmp_item_clean(item);
+				continue;
+			}
+
+			init_result(&results[num]);
+
+			batches[num].items = item;
+			batches[num].results = &results[num];
+			batches[num].errcodes = &errcodes[num];
+			batches[num].num = 1;
+			batch_probes[num++] = &probes[i];
+
+			if (num < batch_max)
+				continue;
+		}
+
+		if (0 == num)
+			continue;
+
+		get_values_snmp_async(batches, num);
+
+		for (j = 0; j < num; j++)
+		{
+			if (SUCCEED == errcodes[j] && NULL != GET_STR_RESULT(&results[j]))
+			{
+				batch_probes[j]->status = DOBJECT_STATUS_UP;
+				batch_probes[j]->value = zbx_strdup(batch_probes[j]->value, results[j].str);
+			}
+			else if (ISSET_MSG(&results[j]))
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "discovery: item [%s] error: %s", items[j].key,
+						results[j].msg);
+			}
+
+			batch_probes[j]->state = ZBX_DISCOVERY_PROBE_DONE;
+
+			free_result(&results[j]);
+			discovery_snmp_item_clean(&items[j]);
+		}
+
+		num = 0;
+	}
+
+	zbx_free(errcodes);
+	zbx_free(results);
+	zbx_free(items);
+	zbx_free(batches);
+	zbx_free(batch_probes);
+}
+#endif	/* HAVE_NETSNMP */
+
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_get_known_ips                                          *
+ *                                                                            *
+ * Purpose: mark addresses that have services discovered by the rule          *
+ *                                                                            *
+ * Comments: the other addresses without services found up are not written   *
+ *           to database at all, as nothing would change there                *
+ *                                                                            *
+ ******************************************************************************/
+static void	discovery_get_known_ips(const DB_DRULE *drule, zbx_discovery_ip_t *ips, int ips_num)
+{
+	DB_RESULT	result;
+	DB_ROW		row;
+	const char	**values;
+	char		*sql = NULL;
+	size_t		sql_alloc = 0, sql_offset = 0;
+	int		i;
+
+	values = zbx_malloc(NULL, sizeof(char *) * ips_num);
+
+	for (i = 0; i < ips_num; i++)
+		values[i] = ips[i].ip;
+
+	zbx_snprintf_alloc(&sql, &sql_alloc, &sql_offset,
+			"select distinct ds.ip"
+			" from dhosts dh,dservices ds"
+			" where dh.dhostid=ds.dhostid"
+				" and dh.druleid=" ZBX_FS_UI64
+				" and",
+			drule->druleid);
+
+	DBadd_str_condition_alloc(&sql, &sql_alloc, &sql_offset, "ds.ip", values, ips_num);
 
 	result = DBselect("%s", sql);
 
 	while (NULL != (row = DBfetch(result)))
 	{
-		memset(&dcheck, 0, sizeof(dcheck));
-
-		ZBX_STR2UINT64(dcheck.dcheckid, row[0]);
-		dcheck.type = atoi(row[1]);
-		dcheck.key_ = row[2];
-		dcheck.snmp_community = row[3];
-		dcheck.snmpv3_securityname = row[4];
-		dcheck.snmpv3_securitylevel = (unsigned char)atoi(row[5]);
-		dcheck.snmpv3_authpassphrase = row[6];
-		dcheck.snmpv3_privpassphrase = row[7];
-		dcheck.snmpv3_authprotocol = (unsigned char)atoi(row[8]);
-		dcheck.snmpv3_privprotocol = (unsigned char)atoi(row[9]);
-		dcheck.ports = row[10];
-		dcheck.snmpv3_contextname = row[11];
-
-		process_check(drule, &dcheck, dhost, host_status, ip, dns, now);
+		for (i = 0; i < ips_num; i++)
+		{
+			if (0 == strcmp(ips[i].ip, row[0]))
+				ips[i].known = 1;
+		}
 	}
 	DBfree_result(result);
+
+	zbx_free(sql);
+	zbx_free(values);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: discovery_process_ips                                            *
+ *                                                                            *
+ * Purpose: perform all checks of discovery rule on a batch of addresses and  *
+ *          write the results in one transaction                              *
+ *                                                                            *
+ * Return value: SUCCEED - the batch was processed                            *
+ *               FAIL    - the discovery rule was deleted                     *
+ *                                                                            *
+ ******************************************************************************/
+static int	discovery_process_ips(DB_DRULE *drule, zbx_vector_ptr_t *checks, zbx_discovery_ip_t *ips, int ips_num)
+{
+	const char		*__function_name = "discovery_process_ips";
+
+	zbx_discovery_probe_t	*probes, *probe;
+	zbx_discovery_check_t	*check;
+	int			i, j, k, probes_num = 0, now, ret = SUCCEED;
+	char			*value = NULL;
+	size_t			value_alloc = 128;
+	DB_DHOST		dhost;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() addresses:%d first:'%s'", __function_name, ips_num, ips[0].ip);
+
+	for (i = 0; i < checks->values_num; i++)
+		probes_num += ((zbx_discovery_check_t *)checks->values[i])->ports_num;
+
+	probes = zbx_malloc(NULL, sizeof(zbx_discovery_probe_t) * probes_num * ips_num);
+	probes_num = 0;
+
+	/* probes are ordered by address and then in the order the results must be written */
+	for (i = 0; i < ips_num; i++)
+	{
+		ips[i].status = -1;
+		ips[i].known = 0;
+		*ips[i].dns = '\0';
+
+		for (j = 0; j < checks->values_num; j++)
+		{
+			check = (zbx_discovery_check_t *)checks->values[j];
+
+			for (k = 0; k < check->ports_num; k++)
+			{
+				probe = &probes[probes_num++];
+
+				probe->ip_index = i;
+				probe->check_index = j;
+				probe->port = check->ports[k];
+				probe->state = ZBX_DISCOVERY_PROBE_NEW;
+				probe->status = DOBJECT_STATUS_DOWN;
+				probe->value = NULL;
+			}
+		}
+	}
+
+	discovery_probes_ping(probes, probes_num, checks, ips, ips_num);
+	discovery_probes_connect(probes, probes_num, checks, ips);
+#ifdef HAVE_NETSNMP
+	discovery_probes_snmp(probes, probes_num, checks, ips);
+#endif
+	/* the remaining checks talk to services that accept connections or cannot be done asynchronously */
+
+	value = zbx_malloc(value, value_alloc);
+
+	for (i = 0; i < probes_num; i++)
+	{
+		probe = &probes[i];
+
+		if (ZBX_DISCOVERY_PROBE_DONE == probe->state)
+			continue;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() ip:'%s' port:%d", __function_name, ips[probe->ip_index].ip,
+				probe->port);
+
+		if (SUCCEED == discover_service(DISCOVERY_PROBE_DCHECK(probe, checks), ips[probe->ip_index].ip,
+				probe->port, &value, &value_alloc))
+		{
+			probe->status = DOBJECT_STATUS_UP;
+			probe->value = zbx_strdup(probe->value, value);
+		}
+	}
+
+	zbx_free(value);
+
+	for (i = 0; i < probes_num; i++)
+	{
+		/* update host status */
+		if (-1 == ips[probes[i].ip_index].status || DOBJECT_STATUS_UP == probes[i].status)
+			ips[probes[i].ip_index].status = probes[i].status;
+	}
+
+	if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+		discovery_get_known_ips(drule, ips, ips_num);
+
+	for (i = 0; i < ips_num; i++)
+	{
+		if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && DOBJECT_STATUS_UP != ips[i].status &&
+				0 == ips[i].known)
+		{
+			continue;
+		}
+
+		zbx_alarm_on(CONFIG_TIMEOUT);
+		zbx_gethost_by_ip(ips[i].ip, ips[i].dns, sizeof(ips[i].dns));
+		zbx_alarm_off();
+	}
+
+	now = time(NULL);
+
+	DBbegin();
+
+	if (SUCCEED != DBlock_druleid(drule->druleid))
+	{
+		DBrollback();
+
+		zabbix_log(LOG_LEVEL_DEBUG, "discovery rule '%s' was deleted during processing, stopping", drule->name);
+
+		ret = FAIL;
+		goto out;
+	}
+
+	for (i = 0; i < checks->values_num; i++)
+	{
+		check = (zbx_discovery_check_t *)checks->values[i];
+
+		if (0 == check->deleted && SUCCEED != DBlock_dcheckid(check->dcheck.dcheckid, drule->druleid))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "discovery check was deleted during processing, stopping");
+			check->deleted = 1;
+		}
+	}
+
+	for (i = 0, j = 0; i < ips_num; i++)
+	{
+		if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER) && DOBJECT_STATUS_UP != ips[i].status &&
+				0 == ips[i].known)
+		{
+			while (j < probes_num && i == probes[j].ip_index)
+				j++;
+
+			continue;
+		}
+
+		memset(&dhost, 0, sizeof(dhost));
+
+		for (; j < probes_num && i == probes[j].ip_index; j++)
+		{
+			probe = &probes[j];
+			check = (zbx_discovery_check_t *)checks->values[probe->check_index];
+
+			if (0 != check->deleted)
+				continue;
+
+			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+			{
+				discovery_update_service(drule, &check->dcheck, &dhost, ips[i].ip, ips[i].dns,
+						probe->port, probe->status, ZBX_NULL2EMPTY_STR(probe->value), now);
+			}
+			else if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY))
+			{
+				proxy_update_service(drule, &check->dcheck, ips[i].ip, ips[i].dns, probe->port,
+						probe->status, ZBX_NULL2EMPTY_STR(probe->value), now);
+			}
+		}
+
+		if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+			discovery_update_host(&dhost, ips[i].status, now);
+		else if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY))
+			proxy_update_host(drule, ips[i].ip, ips[i].dns, ips[i].status, now);
+	}
+
+	DBcommit();
+out:
+	for (i = 0; i < probes_num; i++)
+		zbx_free(probes[i].value);
+
+	zbx_free(probes);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return ret;
 }
 
 /******************************************************************************
@@ -460,19 +1116,31 @@ static void	process_checks(DB_DRULE *drule, DB_DHOST *dhost, int *host_status,
  *                                                                            *
  * Purpose: process single discovery rule                                     *
  *                                                                            *
+ * Comments: Addresses are processed in batches holding about                 *
+ *           DiscovererConcurrency checks, the checks of a batch are          *
+ *           performed concurrently.                                          *
+ *                                                                            *
  ******************************************************************************/
 static void	process_rule(DB_DRULE *drule)
 {
-	const char	*__function_name = "process_rule";
+	const char		*__function_name = "process_rule";
 
-	DB_DHOST	dhost;
-	int		host_status, now;
-	char		ip[INTERFACE_IP_LEN_MAX], *start, *comma, dns[INTERFACE_DNS_LEN_MAX];
-	int		ipaddress[8];
-	zbx_iprange_t	iprange;
+	char			*start, *comma;
+	int			ipaddress[8], probes_num, ips_max, ips_num = 0;
+	zbx_iprange_t		iprange;
+	zbx_vector_ptr_t	checks;
+	zbx_discovery_ip_t	*ips;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() rule:'%s' range:'%s'", __function_name, drule->name, drule->iprange);
 
+	zbx_vector_ptr_create(&checks);
+
+	if (0 == (probes_num = discovery_load_checks(drule, &checks)))
+		probes_num = 1;
+
+	ips_max = MAX(1, CONFIG_DISCOVERER_CONCURRENCY / probes_num);
+	ips = zbx_malloc(NULL, sizeof(zbx_discovery_ip_t) * ips_max);
+
 	for (start = drule->iprange; '\0' != *start;)
 	{
 		if (NULL != (comma = strchr(start, ',')))
@@ -505,54 +1173,32 @@ static void	process_rule(DB_DRULE *drule)
 
 		do
 		{
+			char	*ip = ips[ips_num].ip;
+			size_t	ip_len = sizeof(ips[ips_num].ip);
 #ifdef HAVE_IPV6
 			if (ZBX_IPRANGE_V6 == iprange.type)
 			{
-				zbx_snprintf(ip, sizeof(ip), "%x:%x:%x:%x:%x:%x:%x:%x", ipaddress[0], ipaddress[1],
+				zbx_snprintf(ip, ip_len, "%x:%x:%x:%x:%x:%x:%x:%x", ipaddress[0], ipaddress[1],
 						ipaddress[2], ipaddress[3], ipaddress[4], ipaddress[5], ipaddress[6],
 						ipaddress[7]);
 			}
 			else
 			{
 #endif
-				zbx_snprintf(ip, sizeof(ip), "%u.%u.%u.%u", ipaddress[0], ipaddress[1], ipaddress[2],
+				zbx_snprintf(ip, ip_len, "%u.%u.%u.%u", ipaddress[0], ipaddress[1], ipaddress[2],
 						ipaddress[3]);
 #ifdef HAVE_IPV6
 			}
 #endif
-			memset(&dhost, 0, sizeof(dhost));
-			host_status = -1;
-
-			now = time(NULL);
-
 			zabbix_log(LOG_LEVEL_DEBUG, "%s() ip:'%s'", __function_name, ip);
 
-			zbx_alarm_on(CONFIG_TIMEOUT);
-			zbx_gethost_by_ip(ip, dns, sizeof(dns));
-			zbx_alarm_off();
-
-			if (0 != drule->unique_dcheckid)
-				process_checks(drule, &dhost, &host_status, ip, dns, 1, now);
-			process_checks(drule, &dhost, &host_status, ip, dns, 0, now);
+			if (++ips_num < ips_max)
+				continue;
 
-			DBbegin();
-
-			if (SUCCEED != DBlock_druleid(drule->druleid))
-			{
-				DBrollback();
-
-				zabbix_log(LOG_LEVEL_DEBUG, "discovery rule '%s' was deleted during processing,"
-						" stopping", drule->name);
+			ips_num = 0;
 
+			if (SUCCEED != discovery_process_ips(drule, &checks, ips, ips_max))
 				goto out;
-			}
-
-			if (0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
-				discovery_update_host(&dhost, host_status, now);
-			else if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY))
-				proxy_update_host(drule, ip, dns, host_status, now);
-
-			DBcommit();
 		}
 		while (SUCCEED == iprange_next(&iprange, ipaddress));
 next:
@@ -564,7 +1210,15 @@ next:
 		else
 			break;
 	}
+
+	if (0 != ips_num)
+		discovery_process_ips(drule, &checks, ips, ips_num);
 out:
+	zbx_free(ips);
+
+	zbx_vector_ptr_clear_ext(&checks, (zbx_clean_func_t)discovery_check_free);
+	zbx_vector_ptr_destroy(&checks);
+
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
 
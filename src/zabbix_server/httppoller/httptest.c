@@ -46,7 +46,31 @@ typedef struct
 }
 zbx_httpstat_t;
 
+/* web scenario execution data */
+typedef struct
+{
+	DC_HOST			host;
+	zbx_httptest_t		httptest;
+	zbx_vector_ptr_t	steps;		/* DB_HTTPSTEP, the steps as stored in database */
+	int			step_num;	/* the index of the current step */
+	DB_HTTPSTEP		httpstep;	/* the current step with resolved macros and variables */
+	char			*err_str;
+	int			lastfailedstep;
+	double			speed_download;
+	int			speed_download_num;
+#ifdef HAVE_LIBCURL
+	CURL			*easyhandle;
+	struct curl_slist	*headers_slist;
+	char			*auth;
+	size_t			auth_alloc;
+	char			errbuf[CURL_ERROR_SIZE];
+	zbx_httppage_t		page;
+#endif
+}
+zbx_httptest_exec_t;
+
 extern int	CONFIG_HTTPPOLLER_FORKS;
+extern int	CONFIG_HTTPPOLLER_CONCURRENCY;
 extern char	*CONFIG_SOURCE_IP;
 
 #ifdef HAVE_LIBCURL
@@ -58,23 +82,23 @@ extern char	*CONFIG_SSL_KEY_LOCATION;
 #define ZBX_RETRIEVE_MODE_CONTENT	0
 #define ZBX_RETRIEVE_MODE_HEADERS	1
 
-static zbx_httppage_t	page;
+static CURLM	*multi_handle = NULL;
+static CURLSH	*share_handle = NULL;
 
 static size_t	WRITEFUNCTION2(void *ptr, size_t size, size_t nmemb, void *userdata)
 {
-	size_t	r_size = size * nmemb;
-
-	ZBX_UNUSED(userdata);
+	size_t		r_size = size * nmemb;
+	zbx_httppage_t	*page = (zbx_httppage_t *)userdata;
 
 	/* first piece of data */
-	if (NULL == page.data)
+	if (NULL == page->data)
 	{
-		page.allocated = MAX(8096, r_size);
-		page.offset = 0;
-		page.data = zbx_malloc(page.data, page.allocated);
+		page->allocated = MAX(8096, r_size);
+		page->offset = 0;
+		page->data = zbx_malloc(page->data, page->allocated);
 	}
 
-	zbx_strncpy_alloc(&page.data, &page.allocated, &page.offset, ptr, r_size);
+	zbx_strncpy_alloc(&page->data, &page->allocated, &page->offset, ptr, r_size);
 
 	return r_size;
 }
@@ -328,41 +352,114 @@ static void	add_headers(char *headers, struct curl_slist **headers_slist)
 
 /******************************************************************************
  *                                                                            *
- * Function: process_httptest                                                 *
+ * Function: httpstep_free                                                    *
  *                                                                            *
- * Purpose: process single scenario of http test                              *
+ * Purpose: free web scenario step loaded from database                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	httpstep_free(DB_HTTPSTEP *httpstep)
+{
+	zbx_free(httpstep->name);
+	zbx_free(httpstep->url);
+	zbx_free(httpstep->posts);
+	zbx_free(httpstep->required);
+	zbx_free(httpstep->status_codes);
+	zbx_free(httpstep->variables);
+	zbx_free(httpstep->headers);
+	zbx_free(httpstep);
+}
+
+/******************************************************************************
  *                                                                            *
- * Parameters:                                                                *
+ * Function: httptest_exec_create                                             *
  *                                                                            *
- * Return value:                                                              *
+ * Purpose: prepare web scenario for execution                                *
  *                                                                            *
- * Author: Alexei Vladishev                                                   *
+ * Parameters: row - [IN] the web scenario and its host from database         *
  *                                                                            *
- * Comments:                                                                  *
+ * Return value: the web scenario execution data                              *
  *                                                                            *
  ******************************************************************************/
-static void	process_httptest(DC_HOST *host, zbx_httptest_t *httptest)
+static zbx_httptest_exec_t	*httptest_exec_create(DB_ROW row)
 {
-	const char	*__function_name = "process_httptest";
+	DB_RESULT		result;
+	DB_ROW			step_row;
+	zbx_httptest_exec_t	*exec;
+	zbx_httptest_t		*httptest;
+	DC_HOST			*host;
+	DB_HTTPSTEP		*httpstep;
 
-	DB_RESULT	result;
-	DB_HTTPSTEP	httpstep;
-	char		*err_str = NULL;
-	int		lastfailedstep = 0;
-	zbx_timespec_t	ts;
-	double		speed_download = 0;
-	int		speed_download_num = 0;
-#ifdef HAVE_LIBCURL
-	DB_ROW		row;
-	zbx_httpstat_t	stat;
-	int		err;
-	char		*auth = NULL, errbuf[CURL_ERROR_SIZE];
-	size_t		auth_alloc = 0, auth_offset;
-	CURL            *easyhandle = NULL;
-#endif
+	exec = zbx_malloc(NULL, sizeof(zbx_httptest_exec_t));
+	memset(exec, 0, sizeof(zbx_httptest_exec_t));
+
+	host = &exec->host;
+	httptest = &exec->httptest;
+
+	ZBX_STR2UINT64(host->hostid, row[0]);
+	strscpy(host->host, row[1]);
+	strscpy(host->name, row[2]);
+
+	/* create macro cache to use in http test */
+	zbx_vector_ptr_pair_create(&httptest->macros);
+
+	ZBX_STR2UINT64(httptest->httptest.httptestid, row[3]);
+	httptest->httptest.name = zbx_strdup(NULL, row[4]);
+
+	httptest->httptest.variables = zbx_strdup(NULL, row[5]);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
+			&httptest->httptest.variables, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+
+	httptest->httptest.headers = zbx_strdup(NULL, row[6]);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
+			&httptest->httptest.headers, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+
+	httptest->httptest.agent = zbx_strdup(NULL, row[7]);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, &host->hostid, NULL, NULL, NULL,
+			&httptest->httptest.agent, MACRO_TYPE_COMMON, NULL, 0);
+
+	if (HTTPTEST_AUTH_NONE != (httptest->httptest.authentication = atoi(row[8])))
+	{
+		httptest->httptest.http_user = zbx_strdup(NULL, row[9]);
+		substitute_simple_macros(NULL, NULL, NULL, NULL, &host->hostid, NULL, NULL, NULL,
+				&httptest->httptest.http_user, MACRO_TYPE_COMMON, NULL, 0);
+
+		httptest->httptest.http_password = zbx_strdup(NULL, row[10]);
+		substitute_simple_macros(NULL, NULL, NULL, NULL, &host->hostid, NULL, NULL, NULL,
+				&httptest->httptest.http_password, MACRO_TYPE_COMMON, NULL, 0);
+	}
+
+	if ('\0' != *row[11])
+	{
+		httptest->httptest.http_proxy = zbx_strdup(NULL, row[11]);
+		substitute_simple_macros(NULL, NULL, NULL, NULL, &host->hostid, NULL, NULL, NULL,
+				&httptest->httptest.http_proxy, MACRO_TYPE_COMMON, NULL, 0);
+	}
+	else
+		httptest->httptest.http_proxy = NULL;
+
+	httptest->httptest.retries = atoi(row[12]);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() httptestid:" ZBX_FS_UI64 " name:'%s'",
-			__function_name, httptest->httptest.httptestid, httptest->httptest.name);
+	httptest->httptest.ssl_cert_file = zbx_strdup(NULL, row[13]);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
+			&httptest->httptest.ssl_cert_file, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+
+	httptest->httptest.ssl_key_file = zbx_strdup(NULL, row[14]);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
+			&httptest->httptest.ssl_key_file, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+
+	httptest->httptest.ssl_key_password = zbx_strdup(NULL, row[15]);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, &host->hostid, NULL, NULL, NULL,
+			&httptest->httptest.ssl_key_password, MACRO_TYPE_COMMON, NULL, 0);
+
+	httptest->httptest.verify_peer = atoi(row[16]);
+	httptest->httptest.verify_host = atoi(row[17]);
+
+	/* add httptest variables to the current test macro cache */
+	http_process_variables(httptest, httptest->httptest.variables, NULL, NULL);
+
+	/* steps are loaded at once, macros in them are resolved when the step is executed */
+
+	zbx_vector_ptr_create(&exec->steps);
 
 	result = DBselect(
 			"select httpstepid,no,name,url,timeout,posts,required,status_codes,variables,follow_redirects,"
@@ -372,47 +469,127 @@ static void	process_httptest(DC_HOST *host, zbx_httptest_t *httptest)
 			" order by no",
 			httptest->httptest.httptestid);
 
-	/* Explicitly initialize the name. If we compile without libCURL support, */
-	/* we avoid the potential usage of unititialized values. */
-	httpstep.name = NULL;
+	while (NULL != (step_row = DBfetch(result)))
+	{
+		httpstep = zbx_malloc(NULL, sizeof(DB_HTTPSTEP));
+
+		ZBX_STR2UINT64(httpstep->httpstepid, step_row[0]);
+		httpstep->httptestid = httptest->httptest.httptestid;
+		httpstep->no = atoi(step_row[1]);
+		httpstep->name = zbx_strdup(NULL, step_row[2]);
+		httpstep->url = zbx_strdup(NULL, step_row[3]);
+		httpstep->timeout = atoi(step_row[4]);
+		httpstep->posts = zbx_strdup(NULL, step_row[5]);
+		httpstep->required = zbx_strdup(NULL, step_row[6]);
+		httpstep->status_codes = zbx_strdup(NULL, step_row[7]);
+		httpstep->variables = zbx_strdup(NULL, step_row[8]);
+		httpstep->follow_redirects = atoi(step_row[9]);
+		httpstep->retrieve_mode = atoi(step_row[10]);
+		httpstep->headers = zbx_strdup(NULL, step_row[11]);
+
+		zbx_vector_ptr_append(&exec->steps, httpstep);
+	}
+	DBfree_result(result);
+
+	return exec;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_free                                               *
+ *                                                                            *
+ * Purpose: free web scenario execution data                                  *
+ *                                                                            *
+ ******************************************************************************/
+static void	httptest_exec_free(zbx_httptest_exec_t *exec)
+{
+	zbx_httptest_t	*httptest = &exec->httptest;
+
+	zbx_vector_ptr_clear_ext(&exec->steps, (zbx_clean_func_t)httpstep_free);
+	zbx_vector_ptr_destroy(&exec->steps);
+
+	zbx_free(httptest->httptest.ssl_key_password);
+	zbx_free(httptest->httptest.ssl_key_file);
+	zbx_free(httptest->httptest.ssl_cert_file);
+	zbx_free(httptest->httptest.http_proxy);
+
+	if (HTTPTEST_AUTH_NONE != httptest->httptest.authentication)
+	{
+		zbx_free(httptest->httptest.http_password);
+		zbx_free(httptest->httptest.http_user);
+	}
+	zbx_free(httptest->httptest.agent);
+	zbx_free(httptest->httptest.headers);
+	zbx_free(httptest->httptest.variables);
+	zbx_free(httptest->httptest.name);
+
+	/* destroy the macro cache used in this http test */
+	httptest_remove_macros(httptest);
+	zbx_vector_ptr_pair_destroy(&httptest->macros);
+
+	zbx_free(exec);
+}
 
 #ifdef HAVE_LIBCURL
-	if (NULL == (easyhandle = curl_easy_init()))
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_init_curl                                          *
+ *                                                                            *
+ * Purpose: create cURL easy handle with the web scenario wide options        *
+ *                                                                            *
+ * Return value: SUCCEED - the handle was created                             *
+ *               FAIL    - otherwise, the error is stored in scenario data    *
+ *                                                                            *
+ * Comments: the handle uses shared DNS cache and TLS sessions and is         *
+ *           executed by the multi handle, so its connections are kept in the *
+ *           multi handle connection cache and reused by the following runs   *
+ *                                                                            *
+ ******************************************************************************/
+static int	httptest_exec_init_curl(zbx_httptest_exec_t *exec)
+{
+	zbx_httptest_t	*httptest = &exec->httptest;
+	CURLcode	err;
+
+	if (NULL == multi_handle || NULL == (exec->easyhandle = curl_easy_init()))
 	{
-		err_str = zbx_strdup(err_str, "cannot initialize cURL library");
-		goto clean;
+		exec->err_str = zbx_strdup(exec->err_str, "cannot initialize cURL library");
+		return FAIL;
 	}
 
-	if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_PROXY, httptest->httptest.http_proxy)) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_COOKIEFILE, "")) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_USERAGENT, httptest->httptest.agent)) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_WRITEFUNCTION, WRITEFUNCTION2)) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_HEADERFUNCTION, HEADERFUNCTION2)) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_SSL_VERIFYPEER,
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_PROXY, httptest->httptest.http_proxy)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_COOKIEFILE, "")) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_USERAGENT,
+					httptest->httptest.agent)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_WRITEFUNCTION, WRITEFUNCTION2)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_WRITEDATA, &exec->page)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_HEADERFUNCTION, HEADERFUNCTION2)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_SSL_VERIFYPEER,
 					0 == httptest->httptest.verify_peer ? 0L : 1L)) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_SSL_VERIFYHOST,
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_SSL_VERIFYHOST,
 					0 == httptest->httptest.verify_host ? 0L : 2L)) ||
-			CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_ERRORBUFFER, errbuf)))
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_ERRORBUFFER, exec->errbuf)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_PRIVATE, exec)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_SHARE, share_handle)))
 	{
-		err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-		goto clean;
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		return FAIL;
 	}
 
 	if (NULL != CONFIG_SOURCE_IP)
 	{
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_INTERFACE, CONFIG_SOURCE_IP)))
+		if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_INTERFACE, CONFIG_SOURCE_IP)))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto clean;
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+			return FAIL;
 		}
 	}
 
 	if (0 != httptest->httptest.verify_peer && NULL != CONFIG_SSL_CA_LOCATION)
 	{
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_CAPATH, CONFIG_SSL_CA_LOCATION)))
+		if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_CAPATH, CONFIG_SSL_CA_LOCATION)))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto clean;
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+			return FAIL;
 		}
 	}
 
@@ -423,13 +600,13 @@ static void	process_httptest(DC_HOST *host, zbx_httptest_t *httptest)
 		file_name = zbx_dsprintf(NULL, "%s/%s", CONFIG_SSL_CERT_LOCATION, httptest->httptest.ssl_cert_file);
 		zabbix_log(LOG_LEVEL_DEBUG, "using SSL certificate file: '%s'", file_name);
 
-		err = curl_easy_setopt(easyhandle, CURLOPT_SSLCERT, file_name);
+		err = curl_easy_setopt(exec->easyhandle, CURLOPT_SSLCERT, file_name);
 		zbx_free(file_name);
 
-		if (CURLE_OK != err || CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_SSLCERTTYPE, "PEM")))
+		if (CURLE_OK != err || CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_SSLCERTTYPE, "PEM")))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto clean;
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+			return FAIL;
 		}
 	}
 
@@ -440,317 +617,536 @@ static void	process_httptest(DC_HOST *host, zbx_httptest_t *httptest)
 		file_name = zbx_dsprintf(NULL, "%s/%s", CONFIG_SSL_KEY_LOCATION, httptest->httptest.ssl_key_file);
 		zabbix_log(LOG_LEVEL_DEBUG, "using SSL private key file: '%s'", file_name);
 
-		err = curl_easy_setopt(easyhandle, CURLOPT_SSLKEY, file_name);
+		err = curl_easy_setopt(exec->easyhandle, CURLOPT_SSLKEY, file_name);
 		zbx_free(file_name);
 
-		if (CURLE_OK != err || CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_SSLKEYTYPE, "PEM")))
+		if (CURLE_OK != err || CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_SSLKEYTYPE, "PEM")))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto clean;
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+			return FAIL;
 		}
 	}
 
-	if ('\0' != httptest->httptest.ssl_key_password)
+	if ('\0' != *httptest->httptest.ssl_key_password)
 	{
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_KEYPASSWD,
+		if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_KEYPASSWD,
 				httptest->httptest.ssl_key_password)))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto clean;
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+			return FAIL;
 		}
 	}
 
-	while (NULL != (row = DBfetch(result)))
-	{
-		struct curl_slist	*headers_slist = NULL;
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_step_clean                                         *
+ *                                                                            *
+ * Purpose: free the current step data with resolved macros                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	httptest_exec_step_clean(zbx_httptest_exec_t *exec)
+{
+	curl_slist_free_all(exec->headers_slist);	/* must be called after the transfer is finished */
+	exec->headers_slist = NULL;
+
+	zbx_free(exec->httpstep.headers);
+	zbx_free(exec->httpstep.status_codes);
+	zbx_free(exec->httpstep.required);
+	zbx_free(exec->httpstep.posts);
+	zbx_free(exec->httpstep.url);
+}
 
-		/* NOTE: do not break or return from this block! */
-		/*       process_step_data() call is required! */
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_step_start                                         *
+ *                                                                            *
+ * Purpose: start transfer of the current web scenario step                   *
+ *                                                                            *
+ * Return value: SUCCEED - the transfer was added to the multi handle         *
+ *               FAIL    - the step failed, the scenario is finished          *
+ *                                                                            *
+ ******************************************************************************/
+static int	httptest_exec_step_start(zbx_httptest_exec_t *exec)
+{
+	const char	*__function_name = "httptest_exec_step_start";
 
-		ZBX_STR2UINT64(httpstep.httpstepid, row[0]);
-		httpstep.httptestid = httptest->httptest.httptestid;
-		httpstep.no = atoi(row[1]);
-		httpstep.name = row[2];
+	zbx_httptest_t	*httptest = &exec->httptest;
+	DB_HTTPSTEP	*httpstep = &exec->httpstep;
+	const DB_HTTPSTEP	*step = (const DB_HTTPSTEP *)exec->steps.values[exec->step_num];
+	CURLcode	err;
+	CURLMcode	merr;
 
-		httpstep.url = zbx_strdup(NULL, row[3]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
-				&httpstep.url, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+	*httpstep = *step;
 
-		httpstep.timeout = atoi(row[4]);
+	httpstep->url = zbx_strdup(NULL, step->url);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &exec->host, NULL, NULL,
+			&httpstep->url, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
 
-		httpstep.posts = zbx_strdup(NULL, row[5]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
-				&httpstep.posts, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+	httpstep->posts = zbx_strdup(NULL, step->posts);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &exec->host, NULL, NULL,
+			&httpstep->posts, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
 
-		httpstep.required = zbx_strdup(NULL, row[6]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
-				&httpstep.required, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+	httpstep->required = zbx_strdup(NULL, step->required);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &exec->host, NULL, NULL,
+			&httpstep->required, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
 
-		httpstep.status_codes = zbx_strdup(NULL, row[7]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, &host->hostid, NULL, NULL, NULL,
-				&httpstep.status_codes, MACRO_TYPE_COMMON, NULL, 0);
+	httpstep->status_codes = zbx_strdup(NULL, step->status_codes);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, &exec->host.hostid, NULL, NULL, NULL,
+			&httpstep->status_codes, MACRO_TYPE_COMMON, NULL, 0);
 
-		httpstep.variables = row[8];
-		httpstep.follow_redirects = atoi(row[9]);
-		httpstep.retrieve_mode = atoi(row[10]);
+	httpstep->headers = zbx_strdup(NULL, step->headers);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &exec->host, NULL, NULL,
+			&httpstep->headers, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
 
-		httpstep.headers = zbx_strdup(NULL, row[11]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, host, NULL, NULL,
-				&httpstep.headers, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
+	http_substitute_variables(httptest, &httpstep->url);
+	http_substitute_variables(httptest, &httpstep->posts);
 
-		memset(&stat, 0, sizeof(stat));
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() use step \"%s\"", __function_name, httpstep->name);
 
-		http_substitute_variables(httptest, &httpstep.url);
-		http_substitute_variables(httptest, &httpstep.posts);
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_POSTFIELDS, httpstep->posts)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		goto httpstep_error;
+	}
 
-		zabbix_log(LOG_LEVEL_DEBUG, "%s() use step \"%s\"", __function_name, httpstep.name);
+	if ('\0' != *httpstep->posts)
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() use post \"%s\"", __function_name, httpstep->posts);
 
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_POSTFIELDS, httpstep.posts)))
-		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto httpstep_error;
-		}
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_POST, '\0' != *httpstep->posts ? 1L : 0L)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		goto httpstep_error;
+	}
 
-		if ('\0' != *httpstep.posts)
-			zabbix_log(LOG_LEVEL_DEBUG, "%s() use post \"%s\"", __function_name, httpstep.posts);
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_FOLLOWLOCATION,
+			0 == httpstep->follow_redirects ? 0L : 1L)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		goto httpstep_error;
+	}
 
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_POST, '\0' != *httpstep.posts ? 1L : 0L)))
+	if (0 != httpstep->follow_redirects)
+	{
+		if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_MAXREDIRS, ZBX_CURLOPT_MAXREDIRS)))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
 			goto httpstep_error;
 		}
+	}
 
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_FOLLOWLOCATION,
-				0 == httpstep.follow_redirects ? 0L : 1L)))
-		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto httpstep_error;
-		}
+	http_substitute_variables(httptest, &httpstep->headers);
 
-		if (0 != httpstep.follow_redirects)
-		{
-			if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_MAXREDIRS, ZBX_CURLOPT_MAXREDIRS)))
-			{
-				err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-				goto httpstep_error;
-			}
-		}
+	/* headers defined in a step overwrite headers defined in scenario */
+	if ('\0' != *httpstep->headers)
+		add_headers(httpstep->headers, &exec->headers_slist);
+	else if ('\0' != *httptest->httptest.headers)
+		add_headers(httptest->httptest.headers, &exec->headers_slist);
+
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_HTTPHEADER, exec->headers_slist)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		goto httpstep_error;
+	}
+
+	/* enable/disable fetching the body */
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_NOBODY,
+			ZBX_RETRIEVE_MODE_HEADERS == httpstep->retrieve_mode ? 1L : 0L)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		goto httpstep_error;
+	}
 
-		http_substitute_variables(httptest, &httpstep.headers);
+	if (HTTPTEST_AUTH_NONE != httptest->httptest.authentication)
+	{
+		long	curlauth = 0;
+		size_t	auth_offset = 0;
 
-		/* headers defined in a step overwrite headers defined in scenario */
-		if ('\0' != *httpstep.headers)
-			add_headers(httpstep.headers, &headers_slist);
-		else if ('\0' != *httptest->httptest.headers)
-			add_headers(httptest->httptest.headers, &headers_slist);
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() setting HTTPAUTH [%d]",
+				__function_name, httptest->httptest.authentication);
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() setting USERPWD for authentication", __function_name);
 
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_HTTPHEADER, headers_slist)))
+		switch (httptest->httptest.authentication)
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto httpstep_error;
+			case HTTPTEST_AUTH_BASIC:
+				curlauth = CURLAUTH_BASIC;
+				break;
+			case HTTPTEST_AUTH_NTLM:
+				curlauth = CURLAUTH_NTLM;
+				break;
+			default:
+				THIS_SHOULD_NEVER_HAPPEN;
+				break;
 		}
 
-		/* enable/disable fetching the body */
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_NOBODY,
-				ZBX_RETRIEVE_MODE_HEADERS == httpstep.retrieve_mode ? 1L : 0L)))
+		zbx_snprintf_alloc(&exec->auth, &exec->auth_alloc, &auth_offset, "%s:%s",
+				httptest->httptest.http_user, httptest->httptest.http_password);
+
+		if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_HTTPAUTH, curlauth)) ||
+				CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_USERPWD, exec->auth)))
 		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
 			goto httpstep_error;
 		}
+	}
 
-		if (HTTPTEST_AUTH_NONE != httptest->httptest.authentication)
-		{
-			long	curlauth = 0;
+	zabbix_log(LOG_LEVEL_DEBUG, "%s() go to URL \"%s\"", __function_name, httpstep->url);
 
-			zabbix_log(LOG_LEVEL_DEBUG, "%s() setting HTTPAUTH [%d]",
-					__function_name, httptest->httptest.authentication);
-			zabbix_log(LOG_LEVEL_DEBUG, "%s() setting USERPWD for authentication", __function_name);
+	if (CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_TIMEOUT, (long)httpstep->timeout)) ||
+			CURLE_OK != (err = curl_easy_setopt(exec->easyhandle, CURLOPT_URL, httpstep->url)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		goto httpstep_error;
+	}
 
-			switch (httptest->httptest.authentication)
-			{
-				case HTTPTEST_AUTH_BASIC:
-					curlauth = CURLAUTH_BASIC;
-					break;
-				case HTTPTEST_AUTH_NTLM:
-					curlauth = CURLAUTH_NTLM;
-					break;
-				default:
-					THIS_SHOULD_NEVER_HAPPEN;
-					break;
-			}
+	memset(&exec->page, 0, sizeof(exec->page));
 
-			auth_offset = 0;
-			zbx_snprintf_alloc(&auth, &auth_alloc, &auth_offset, "%s:%s", httptest->httptest.http_user,
-					httptest->httptest.http_password);
+	if (CURLM_OK != (merr = curl_multi_add_handle(multi_handle, exec->easyhandle)))
+	{
+		exec->err_str = zbx_strdup(exec->err_str, curl_multi_strerror(merr));
+		goto httpstep_error;
+	}
 
-			if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_HTTPAUTH, curlauth)) ||
-					CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_USERPWD, auth)))
-			{
-				err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-				goto httpstep_error;
-			}
-		}
+	return SUCCEED;
+httpstep_error:
+	httptest_exec_step_clean(exec);
+	exec->lastfailedstep = httpstep->no;
 
-		zabbix_log(LOG_LEVEL_DEBUG, "%s() go to URL \"%s\"", __function_name, httpstep.url);
+	return FAIL;
+}
 
-		if (CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_TIMEOUT, (long)httpstep.timeout)) ||
-				CURLE_OK != (err = curl_easy_setopt(easyhandle, CURLOPT_URL, httpstep.url)))
-		{
-			err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			goto httpstep_error;
-		}
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_step_done                                          *
+ *                                                                            *
+ * Purpose: process finished transfer of the current web scenario step and    *
+ *          start the next transfer                                           *
+ *                                                                            *
+ * Parameters: exec - [IN] the web scenario execution data                    *
+ *             err  - [IN] the transfer result                                *
+ *                                                                            *
+ * Return value: SUCCEED - retry of the step or the next step was started     *
+ *               FAIL    - the scenario is finished                           *
+ *                                                                            *
+ * Comments: the easy handle must be removed from the multi handle            *
+ *                                                                            *
+ ******************************************************************************/
+static int	httptest_exec_step_done(zbx_httptest_exec_t *exec, CURLcode err)
+{
+	const char	*__function_name = "httptest_exec_step_done";
+
+	zbx_httptest_t	*httptest = &exec->httptest;
+	DB_HTTPSTEP	*httpstep = &exec->httpstep;
+	zbx_httpstat_t	stat;
+	zbx_timespec_t	ts;
+
+	/* NOTE: do not return before the step data is processed, */
+	/*       process_step_data() call is required!              */
+
+	if (CURLE_OK != err)
+	{
+		zbx_free(exec->page.data);
 
 		/* try to retrieve page several times depending on number of retries */
-		do
+		if (0 < --httptest->httptest.retries &&
+				CURLM_OK == curl_multi_add_handle(multi_handle, exec->easyhandle))
 		{
-			memset(&page, 0, sizeof(page));
+			return SUCCEED;
+		}
+	}
 
-			if (CURLE_OK == (err = curl_easy_perform(easyhandle)))
-				break;
+	memset(&stat, 0, sizeof(stat));
+
+	if (CURLE_OK == err)
+	{
+		zabbix_log(LOG_LEVEL_TRACE, "%s() page.data from %s:'%s'", __function_name, httpstep->url,
+				exec->page.data);
 
-			zbx_free(page.data);
+		/* first get the data that is needed even if step fails */
+		if (CURLE_OK != (err = curl_easy_getinfo(exec->easyhandle, CURLINFO_RESPONSE_CODE, &stat.rspcode)))
+		{
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		}
+		else if ('\0' != *httpstep->status_codes && FAIL == int_in_list(httpstep->status_codes, stat.rspcode))
+		{
+			exec->err_str = zbx_dsprintf(exec->err_str, "response code \"%ld\" did not match any of the"
+					" required status codes \"%s\"", stat.rspcode, httpstep->status_codes);
 		}
-		while (0 < --httptest->httptest.retries);
 
-		curl_slist_free_all(headers_slist);	/* must be called after curl_easy_perform() */
+		if (CURLE_OK != (err = curl_easy_getinfo(exec->easyhandle, CURLINFO_TOTAL_TIME, &stat.total_time)) &&
+				NULL == exec->err_str)
+		{
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		}
 
-		if (CURLE_OK == err)
+		if (CURLE_OK != (err = curl_easy_getinfo(exec->easyhandle, CURLINFO_SPEED_DOWNLOAD,
+				&stat.speed_download)) && NULL == exec->err_str)
 		{
-			zabbix_log(LOG_LEVEL_TRACE, "%s() page.data from %s:'%s'", __function_name, httpstep.url, page.data);
+			exec->err_str = zbx_strdup(exec->err_str, curl_easy_strerror(err));
+		}
+		else
+		{
+			exec->speed_download += stat.speed_download;
+			exec->speed_download_num++;
+		}
 
-			/* first get the data that is needed even if step fails */
-			if (CURLE_OK != (err = curl_easy_getinfo(easyhandle, CURLINFO_RESPONSE_CODE, &stat.rspcode)))
-			{
-				err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			}
-			else if ('\0' != *httpstep.status_codes &&
-					FAIL == int_in_list(httpstep.status_codes, stat.rspcode))
-			{
-				err_str = zbx_dsprintf(err_str, "response code \"%ld\" did not match any of the"
-						" required status codes \"%s\"", stat.rspcode, httpstep.status_codes);
-			}
+		if (ZBX_RETRIEVE_MODE_CONTENT == httpstep->retrieve_mode)
+		{
+			char	*var_err_str = NULL;
 
-			if (CURLE_OK != (err = curl_easy_getinfo(easyhandle, CURLINFO_TOTAL_TIME, &stat.total_time)) &&
-					NULL == err_str)
+			/* required pattern */
+			if (NULL == exec->err_str && '\0' != *httpstep->required &&
+					NULL == zbx_regexp_match(exec->page.data, httpstep->required, NULL))
 			{
-				err_str = zbx_strdup(err_str, curl_easy_strerror(err));
+				exec->err_str = zbx_dsprintf(exec->err_str, "required pattern \"%s\" was not found on %s",
+						httpstep->required, httpstep->url);
 			}
 
-			if (CURLE_OK != (err = curl_easy_getinfo(easyhandle, CURLINFO_SPEED_DOWNLOAD,
-					&stat.speed_download)) && NULL == err_str)
+			/* variables defined in scenario */
+			if (NULL == exec->err_str && FAIL == http_process_variables(httptest,
+					httptest->httptest.variables, exec->page.data, &var_err_str))
 			{
-				err_str = zbx_strdup(err_str, curl_easy_strerror(err));
-			}
-			else
-			{
-				speed_download += stat.speed_download;
-				speed_download_num++;
+				char	*variables;
+
+				variables = string_replace(httptest->httptest.variables, "\r\n", " ");
+				exec->err_str = zbx_dsprintf(exec->err_str, "error in scenario variables \"%s\": %s",
+						variables, var_err_str);
+
+				zbx_free(variables);
 			}
 
-			if (ZBX_RETRIEVE_MODE_CONTENT == httpstep.retrieve_mode)
+			/* variables defined in a step */
+			if (NULL == exec->err_str && FAIL == http_process_variables(httptest, httpstep->variables,
+					exec->page.data, &var_err_str))
 			{
-				char	*var_err_str = NULL;
-
-				/* required pattern */
-				if (NULL == err_str && '\0' != *httpstep.required && NULL == zbx_regexp_match(page.data,
-						httpstep.required, NULL))
-				{
-					err_str = zbx_dsprintf(err_str, "required pattern \"%s\" was not found on %s",
-							httpstep.required, httpstep.url);
-				}
-
-				/* variables defined in scenario */
-				if (NULL == err_str && FAIL == http_process_variables(httptest,
-						httptest->httptest.variables, page.data, &var_err_str))
-				{
-					char	*variables;
-
-					variables = string_replace(httptest->httptest.variables, "\r\n", " ");
-					err_str = zbx_dsprintf(err_str, "error in scenario variables \"%s\": %s",
-							variables, var_err_str);
-
-					zbx_free(variables);
-				}
-
-				/* variables defined in a step */
-				if (NULL == err_str && FAIL == http_process_variables(httptest, httpstep.variables,
-						page.data, &var_err_str))
-				{
-					char	*variables;
-
-					variables = string_replace(httpstep.variables, "\r\n", " ");
-					err_str = zbx_dsprintf(err_str, "error in step variables \"%s\": %s",
-							variables, var_err_str);
-
-					zbx_free(variables);
-				}
-
-				zbx_free(var_err_str);
-			}
+				char	*variables;
 
-			zbx_timespec(&ts);
-			process_step_data(httpstep.httpstepid, &stat, &ts);
+				variables = string_replace(httpstep->variables, "\r\n", " ");
+				exec->err_str = zbx_dsprintf(exec->err_str, "error in step variables \"%s\": %s",
+						variables, var_err_str);
 
-			zbx_free(page.data);
+				zbx_free(variables);
+			}
+
+			zbx_free(var_err_str);
 		}
-		else
-			err_str = zbx_dsprintf(err_str, "%s: %s", curl_easy_strerror(err), errbuf);
 
-httpstep_error:
-		zbx_free(httpstep.headers);
-		zbx_free(httpstep.status_codes);
-		zbx_free(httpstep.required);
-		zbx_free(httpstep.posts);
-		zbx_free(httpstep.url);
+		zbx_timespec(&ts);
+		process_step_data(httpstep->httpstepid, &stat, &ts);
 
-		if (NULL != err_str)
-		{
-			lastfailedstep = httpstep.no;
-			break;
-		}
+		zbx_free(exec->page.data);
 	}
+	else
+		exec->err_str = zbx_dsprintf(exec->err_str, "%s: %s", curl_easy_strerror(err), exec->errbuf);
 
-	zbx_free(auth);
-clean:
-	curl_easy_cleanup(easyhandle);
-#else
-	err_str = zbx_strdup(err_str, "cURL library is required for Web monitoring support");
+	httptest_exec_step_clean(exec);
+
+	if (NULL != exec->err_str)
+	{
+		exec->lastfailedstep = httpstep->no;
+		return FAIL;
+	}
+
+	if (++exec->step_num == exec->steps.values_num)
+		return FAIL;
+
+	return httptest_exec_step_start(exec);
+}
 #endif	/* HAVE_LIBCURL */
 
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_start                                              *
+ *                                                                            *
+ * Purpose: start execution of web scenario                                   *
+ *                                                                            *
+ * Return value: SUCCEED - the first step transfer was started                *
+ *               FAIL    - the scenario is finished                           *
+ *                                                                            *
+ ******************************************************************************/
+static int	httptest_exec_start(zbx_httptest_exec_t *exec)
+{
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() httptestid:" ZBX_FS_UI64 " name:'%s'", "httptest_exec_start",
+			exec->httptest.httptest.httptestid, exec->httptest.httptest.name);
+
+#ifdef HAVE_LIBCURL
+	if (SUCCEED != httptest_exec_init_curl(exec) || 0 == exec->steps.values_num)
+		return FAIL;
+
+	return httptest_exec_step_start(exec);
+#else
+	exec->err_str = zbx_strdup(exec->err_str, "cURL library is required for Web monitoring support");
+
+	return FAIL;
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_exec_finish                                             *
+ *                                                                            *
+ * Purpose: store web scenario results, schedule its next check and free the  *
+ *          execution data                                                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	httptest_exec_finish(zbx_httptest_exec_t *exec)
+{
+	const char	*__function_name = "httptest_exec_finish";
+
+	zbx_httptest_t	*httptest = &exec->httptest;
+	zbx_timespec_t	ts;
+
+#ifdef HAVE_LIBCURL
+	zbx_free(exec->auth);
+
+	if (NULL != exec->easyhandle)
+		curl_easy_cleanup(exec->easyhandle);
+#endif
 	zbx_timespec(&ts);
 
-	if (NULL != err_str)
+	if (NULL != exec->err_str)
 	{
-		if (0 == lastfailedstep)
+		if (0 == exec->lastfailedstep)
 		{
 			/* we are here either because cURL initialization failed */
 			/* or we have been compiled without cURL library */
 
-			lastfailedstep = 1;
+			exec->lastfailedstep = 1;
 		}
 
-		if (NULL != httpstep.name)
+		if (NULL != exec->httpstep.name)
 		{
 			zabbix_log(LOG_LEVEL_DEBUG, "cannot process step \"%s\" of web scenario \"%s\" on host \"%s\": %s",
-					httpstep.name, httptest->httptest.name, host->name, err_str);
+					exec->httpstep.name, httptest->httptest.name, exec->host.name, exec->err_str);
 		}
 	}
-	DBfree_result(result);
 
 	DBexecute("update httptest set nextcheck=%d+delay where httptestid=" ZBX_FS_UI64,
 			ts.sec, httptest->httptest.httptestid);
 
-	if (0 != speed_download_num)
-		speed_download /= speed_download_num;
+	if (0 != exec->speed_download_num)
+		exec->speed_download /= exec->speed_download_num;
 
-	process_test_data(httptest->httptest.httptestid, lastfailedstep, speed_download, err_str, &ts);
+	process_test_data(httptest->httptest.httptestid, exec->lastfailedstep, exec->speed_download, exec->err_str,
+			&ts);
 
-	zbx_free(err_str);
+	zbx_free(exec->err_str);
 
 	dc_flush_history();
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() httptestid:" ZBX_FS_UI64, __function_name,
+			httptest->httptest.httptestid);
+
+	httptest_exec_free(exec);
+}
+
+#ifdef HAVE_LIBCURL
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_multi_perform                                           *
+ *                                                                            *
+ * Purpose: perform transfers of the running web scenarios and process the    *
+ *          finished ones                                                     *
+ *                                                                            *
+ * Return value: the number of finished web scenarios                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	httptest_multi_perform(void)
+{
+	CURLMsg			*msg;
+	CURL			*easyhandle;
+	CURLcode		err;
+	char			*ptr;
+	int			running, msgs_left, finished = 0;
+
+	while (CURLM_CALL_MULTI_PERFORM == curl_multi_perform(multi_handle, &running))
+		;
+
+	while (NULL != (msg = curl_multi_info_read(multi_handle, &msgs_left)))
+	{
+		if (CURLMSG_DONE != msg->msg)
+			continue;
+
+		/* the message does not survive removal of the handle */
+		easyhandle = msg->easy_handle;
+		err = msg->data.result;
+
+		curl_multi_remove_handle(multi_handle, easyhandle);
+		curl_easy_getinfo(easyhandle, CURLINFO_PRIVATE, &ptr);
+
+		if (SUCCEED != httptest_exec_step_done((zbx_httptest_exec_t *)ptr, err))
+		{
+			httptest_exec_finish((zbx_httptest_exec_t *)ptr);
+			finished++;
+		}
+	}
+
+	return finished;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_multi_wait                                              *
+ *                                                                            *
+ * Purpose: wait for activity on the running transfers                        *
+ *                                                                            *
+ ******************************************************************************/
+static void	httptest_multi_wait(void)
+{
+#if 0x071c00 <= LIBCURL_VERSION_NUM	/* version 7.28.0 */
+	curl_multi_wait(multi_handle, NULL, 0, 1000, NULL);
+#else
+	fd_set		fdread, fdwrite, fdexcep;
+	int		maxfd = -1;
+	struct timeval	tv;
+
+	FD_ZERO(&fdread);
+	FD_ZERO(&fdwrite);
+	FD_ZERO(&fdexcep);
+
+	curl_multi_fdset(multi_handle, &fdread, &fdwrite, &fdexcep, &maxfd);
+
+	tv.tv_sec = 0;
+	tv.tv_usec = 100000;
+
+	select(maxfd + 1, &fdread, &fdwrite, &fdexcep, &tv);
+#endif
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: httptest_multi_init                                              *
+ *                                                                            *
+ * Purpose: create the multi handle and the share handle used by all web      *
+ *          scenarios of the process                                          *
+ *                                                                            *
+ * Comments: the handles live as long as the process, so connections, DNS     *
+ *           cache and TLS sessions survive between scenario runs; cookies    *
+ *           stay private to each scenario run                                *
+ *                                                                            *
+ ******************************************************************************/
+static void	httptest_multi_init(void)
+{
+	if (NULL == (share_handle = curl_share_init()) ||
+			CURLSHE_OK != curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS) ||
+			CURLSHE_OK != curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot initialize cURL share interface,"
+				" DNS cache and TLS sessions will not be reused");
+
+		if (NULL != share_handle)
+		{
+			curl_share_cleanup(share_handle);
+			share_handle = NULL;
+		}
+	}
+
+	if (NULL == (multi_handle = curl_multi_init()))
+		zabbix_log(LOG_LEVEL_WARNING, "cannot initialize cURL multi interface");
 }
+#endif	/* HAVE_LIBCURL */
 
 /******************************************************************************
  *                                                                            *
@@ -764,24 +1160,25 @@ clean:
  *                                                                            *
  * Author: Alexei Vladishev                                                   *
  *                                                                            *
- * Comments: always SUCCEED                                                   *
+ * Comments: up to CONFIG_HTTPPOLLER_CONCURRENCY scenarios are executed at    *
+ *           the same time, steps of each scenario are executed in order      *
  *                                                                            *
  ******************************************************************************/
 int	process_httptests(int httppoller_num, int now)
 {
-	const char	*__function_name = "process_httptests";
+	const char		*__function_name = "process_httptests";
 
-	DB_RESULT	result;
-	DB_ROW		row;
-	zbx_httptest_t	httptest;
-	DC_HOST		host;
-	int		httptests_count = 0;
+	DB_RESULT		result;
+	DB_ROW			row;
+	zbx_httptest_exec_t	*exec;
+	int			httptests_count = 0, running = 0, fetched = 0;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
-	/* create macro cache to use in http tests */
-	zbx_vector_ptr_pair_create(&httptest.macros);
-
+#ifdef HAVE_LIBCURL
+	if (NULL == multi_handle)
+		httptest_multi_init();
+#endif
 	result = DBselect(
 			"select h.hostid,h.host,h.name,t.httptestid,t.name,t.variables,t.headers,t.agent,"
 				"t.authentication,t.http_user,t.http_password,t.http_proxy,t.retries,t.ssl_cert_file,"
@@ -800,94 +1197,35 @@ int	process_httptests(int httppoller_num, int now)
 			HOST_STATUS_MONITORED,
 			HOST_MAINTENANCE_STATUS_OFF, MAINTENANCE_TYPE_NORMAL);
 
-	while (NULL != (row = DBfetch(result)))
+	for (;;)
 	{
-		ZBX_STR2UINT64(host.hostid, row[0]);
-		strscpy(host.host, row[1]);
-		strscpy(host.name, row[2]);
-
-		ZBX_STR2UINT64(httptest.httptest.httptestid, row[3]);
-		httptest.httptest.name = row[4];
-
-		httptest.httptest.variables = zbx_strdup(NULL, row[5]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &host, NULL, NULL,
-				&httptest.httptest.variables, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
-
-		httptest.httptest.headers = zbx_strdup(NULL, row[6]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &host, NULL, NULL,
-				&httptest.httptest.headers, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
-
-		httptest.httptest.agent = zbx_strdup(NULL, row[7]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, &host.hostid, NULL, NULL, NULL,
-				&httptest.httptest.agent, MACRO_TYPE_COMMON, NULL, 0);
-
-		if (HTTPTEST_AUTH_NONE != (httptest.httptest.authentication = atoi(row[8])))
+		while (0 == fetched && running < CONFIG_HTTPPOLLER_CONCURRENCY)
 		{
-			httptest.httptest.http_user = zbx_strdup(NULL, row[9]);
-			substitute_simple_macros(NULL, NULL, NULL, NULL, &host.hostid, NULL, NULL, NULL,
-					&httptest.httptest.http_user, MACRO_TYPE_COMMON, NULL, 0);
-
-			httptest.httptest.http_password = zbx_strdup(NULL, row[10]);
-			substitute_simple_macros(NULL, NULL, NULL, NULL, &host.hostid, NULL, NULL, NULL,
-					&httptest.httptest.http_password, MACRO_TYPE_COMMON, NULL, 0);
-		}
-
-		if ('\0' != *row[11])
-		{
-			httptest.httptest.http_proxy = zbx_strdup(NULL, row[11]);
-			substitute_simple_macros(NULL, NULL, NULL, NULL, &host.hostid, NULL, NULL, NULL,
-					&httptest.httptest.http_proxy, MACRO_TYPE_COMMON, NULL, 0);
-		}
-		else
-			httptest.httptest.http_proxy = NULL;
-
-		httptest.httptest.retries = atoi(row[12]);
-
-		httptest.httptest.ssl_cert_file = zbx_strdup(NULL, row[13]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &host, NULL, NULL,
-				&httptest.httptest.ssl_cert_file, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
-
-		httptest.httptest.ssl_key_file = zbx_strdup(NULL, row[14]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, &host, NULL, NULL,
-				&httptest.httptest.ssl_key_file, MACRO_TYPE_HTTPTEST_FIELD, NULL, 0);
-
-		httptest.httptest.ssl_key_password = zbx_strdup(NULL, row[15]);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, &host.hostid, NULL, NULL, NULL,
-				&httptest.httptest.ssl_key_password, MACRO_TYPE_COMMON, NULL, 0);
-
-		httptest.httptest.verify_peer = atoi(row[16]);
-		httptest.httptest.verify_host = atoi(row[17]);
-
-		/* add httptest variables to the current test macro cache */
-		http_process_variables(&httptest, httptest.httptest.variables, NULL, NULL);
-
-		process_httptest(&host, &httptest);
+			if (NULL == (row = DBfetch(result)))
+			{
+				fetched = 1;
+				break;
+			}
 
-		zbx_free(httptest.httptest.ssl_key_password);
-		zbx_free(httptest.httptest.ssl_key_file);
-		zbx_free(httptest.httptest.ssl_cert_file);
-		zbx_free(httptest.httptest.http_proxy);
+			exec = httptest_exec_create(row);
+			httptests_count++;	/* performance metric */
 
-		if (HTTPTEST_AUTH_NONE != httptest.httptest.authentication)
-		{
-			zbx_free(httptest.httptest.http_password);
-			zbx_free(httptest.httptest.http_user);
+			if (SUCCEED == httptest_exec_start(exec))
+				running++;
+			else
+				httptest_exec_finish(exec);
 		}
-		zbx_free(httptest.httptest.agent);
-		zbx_free(httptest.httptest.headers);
-		zbx_free(httptest.httptest.variables);
 
-		/* clear the macro cache used in this http test */
-		httptest_remove_macros(&httptest);
-
-		httptests_count++;	/* performance metric */
+		if (0 == running)
+			break;
+#ifdef HAVE_LIBCURL
+		if (0 != (running -= httptest_multi_perform()))
+			httptest_multi_wait();
+#endif
 	}
-	/* destroy the macro cache used in http tests */
-	zbx_vector_ptr_pair_destroy(&httptest.macros);
-
 	DBfree_result(result);
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() running:%d", __function_name, running);
 
 	return httptests_count;
 }
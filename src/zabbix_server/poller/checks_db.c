@@ -26,6 +26,227 @@
 
 #include "zbxodbc.h"
 
+extern int	CONFIG_ODBC_POOL_IDLE_TIMEOUT;
+extern int	CONFIG_ODBC_POOL_MAX_PER_DSN;
+
+/* pooled connection, the handle must be the first member so the pool can be accessed by handle */
+typedef struct
+{
+	ZBX_ODBC_DBH	dbh;
+	char		*dsn;
+	char		*username;
+	char		*password;
+	time_t		lastused;
+}
+zbx_odbc_conn_t;
+
+/* idle connections of this poller, the most recently used connection is the last */
+static zbx_vector_ptr_t	odbc_pool;
+static int		odbc_pool_created = 0;
+
+static void	db_odbc_conn_free(zbx_odbc_conn_t *conn)
+{
+	odbc_DBclose(&conn->dbh);
+	zbx_free(conn->dsn);
+	zbx_free(conn->username);
+	zbx_free(conn->password);
+	zbx_free(conn);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: db_odbc_connect                                                  *
+ *                                                                            *
+ * Purpose: takes a pooled connection to the data source or connects to it    *
+ *                                                                            *
+ * Parameters: dsn      - [IN] the data source name                           *
+ *             username - [IN] the database user                              *
+ *             password - [IN] the database password                          *
+ *             reused   - [OUT] SUCCEED if the connection comes from the pool *
+ *                                                                            *
+ * Return value: the connection handle or NULL if connection failed           *
+ *                                                                            *
+ ******************************************************************************/
+static ZBX_ODBC_DBH	*db_odbc_connect(char *dsn, char *username, char *password, int *reused)
+{
+	const char	*__function_name = "db_odbc_connect";
+
+	zbx_odbc_conn_t	*conn = NULL;
+	int		i;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() dsn:'%s' user:'%s'", __function_name, dsn, username);
+
+	if (0 == odbc_pool_created)
+	{
+		zbx_vector_ptr_create(&odbc_pool);
+		odbc_pool_created = 1;
+	}
+
+	zbx_odbc_pool_expire();
+
+	*reused = FAIL;
+
+	for (i = odbc_pool.values_num - 1; 0 <= i; i--)
+	{
+		conn = (zbx_odbc_conn_t *)odbc_pool.values[i];
+
+		if (0 != strcmp(conn->dsn, dsn) || 0 != strcmp(conn->username, username) ||
+				0 != strcmp(conn->password, password))
+		{
+			continue;
+		}
+
+		zbx_vector_ptr_remove(&odbc_pool, i);
+
+		if (SUCCEED == odbc_DBconnection_alive(&conn->dbh))
+		{
+			*reused = SUCCEED;
+			goto out;
+		}
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() dropping dead pooled connection", __function_name);
+		db_odbc_conn_free(conn);
+	}
+
+	conn = (zbx_odbc_conn_t *)zbx_malloc(NULL, sizeof(zbx_odbc_conn_t));
+
+	if (SUCCEED != odbc_DBconnect(&conn->dbh, dsn, username, password, CONFIG_TIMEOUT))
+	{
+		zbx_free(conn);
+		goto out;
+	}
+
+	conn->dsn = zbx_strdup(NULL, dsn);
+	conn->username = zbx_strdup(NULL, username);
+	conn->password = zbx_strdup(NULL, password);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() reused:%s", __function_name, zbx_result_string(*reused));
+
+	return NULL != conn ? &conn->dbh : NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: db_odbc_disconnect                                               *
+ *                                                                            *
+ * Purpose: returns the connection to the pool or closes it                   *
+ *                                                                            *
+ * Parameters: dbh - [IN] the connection handle                               *
+ *                                                                            *
+ * Comments: The connection is closed if pooling is disabled or the last      *
+ *           ODBC call reported a lost connection. If the data source already *
+ *           has the maximum number of idle connections, the least recently   *
+ *           used of them is closed.                                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	db_odbc_disconnect(ZBX_ODBC_DBH *dbh)
+{
+	zbx_odbc_conn_t	*conn = (zbx_odbc_conn_t *)dbh;
+	int		i, oldest = -1, num = 0;
+
+	if (0 == CONFIG_ODBC_POOL_IDLE_TIMEOUT || SUCCEED == odbc_DBconnection_lost())
+	{
+		db_odbc_conn_free(conn);
+		return;
+	}
+
+	for (i = 0; i < odbc_pool.values_num; i++)
+	{
+		if (0 != strcmp(((zbx_odbc_conn_t *)odbc_pool.values[i])->dsn, conn->dsn))
+			continue;
+
+		if (-1 == oldest)
+			oldest = i;
+
+		num++;
+	}
+
+	if (CONFIG_ODBC_POOL_MAX_PER_DSN <= num)
+	{
+		db_odbc_conn_free((zbx_odbc_conn_t *)odbc_pool.values[oldest]);
+		zbx_vector_ptr_remove(&odbc_pool, oldest);
+	}
+
+	conn->lastused = time(NULL);
+	zbx_vector_ptr_append(&odbc_pool, conn);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: db_odbc_query                                                    *
+ *                                                                            *
+ * Purpose: executes the item query on a pooled or new connection             *
+ *                                                                            *
+ * Parameters: item   - [IN] the database monitor item                        *
+ *             dsn    - [IN] the data source name                             *
+ *             result - [OUT] error message if the query failed               *
+ *                                                                            *
+ * Return value: the connection handle with the query result or NULL          *
+ *                                                                            *
+ * Comments: If a pooled connection turns out to be lost while executing the  *
+ *           query, the query is retried on another connection.               *
+ *                                                                            *
+ ******************************************************************************/
+static ZBX_ODBC_DBH	*db_odbc_query(DC_ITEM *item, char *dsn, AGENT_RESULT *result)
+{
+	ZBX_ODBC_DBH	*dbh;
+	int		reused;
+
+	while (NULL != (dbh = db_odbc_connect(dsn, item->username, item->password, &reused)))
+	{
+		if (NULL != odbc_DBselect(dbh, item->params))
+			return dbh;
+
+		if (SUCCEED != reused || SUCCEED != odbc_DBconnection_lost())
+			break;
+
+		zabbix_log(LOG_LEVEL_DEBUG, "pooled connection to ODBC DSN \"%s\" was lost, reconnecting", dsn);
+		db_odbc_disconnect(dbh);
+	}
+
+	SET_MSG_RESULT(result, zbx_strdup(NULL, get_last_odbc_strerror()));
+
+	if (NULL != dbh)
+		db_odbc_disconnect(dbh);
+
+	return NULL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_odbc_pool_expire                                             *
+ *                                                                            *
+ * Purpose: closes pooled connections that have been idle for too long        *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_odbc_pool_expire(void)
+{
+	time_t	now;
+	int	i;
+
+	if (0 == odbc_pool_created)
+		return;
+
+	now = time(NULL);
+
+	/* connections are appended when released, so the expired ones are at the beginning */
+	for (i = 0; i < odbc_pool.values_num; i++)
+	{
+		zbx_odbc_conn_t	*conn = (zbx_odbc_conn_t *)odbc_pool.values[i];
+
+		if (now - conn->lastused < CONFIG_ODBC_POOL_IDLE_TIMEOUT)
+			break;
+
+		db_odbc_conn_free(conn);
+	}
+
+	if (0 != i)
+	{
+		memmove(odbc_pool.values, odbc_pool.values + i, sizeof(void *) * (odbc_pool.values_num - i));
+		odbc_pool.values_num -= i;
+	}
+}
+
 static int	get_result_columns(ZBX_ODBC_DBH *dbh, char **buffer)
 {
 	int		ret = SUCCEED, i, j;
@@ -57,7 +278,7 @@ static int	db_odbc_discovery(DC_ITEM *item, AGENT_REQUEST *request, AGENT_RESULT
 	const char	*__function_name = "db_odbc_discovery";
 
 	int		ret = NOTSUPPORTED, i, j;
-	ZBX_ODBC_DBH	dbh;
+	ZBX_ODBC_DBH	*dbh;
 	ZBX_ODBC_ROW	row;
 	char		**columns, *p, macro[MAX_STRING_LEN];
 	struct zbx_json	json;
@@ -70,83 +291,75 @@ static int	db_odbc_discovery(DC_ITEM *item, AGENT_REQUEST *request, AGENT_RESULT
 		goto out;
 	}
 
-	if (SUCCEED != odbc_DBconnect(&dbh, request->params[1], item->username, item->password, CONFIG_TIMEOUT))
-	{
-		SET_MSG_RESULT(result, zbx_strdup(NULL, get_last_odbc_strerror()));
+	if (NULL == (dbh = db_odbc_query(item, request->params[1], result)))
 		goto out;
-	}
 
-	if (NULL != odbc_DBselect(&dbh, item->params))
+	columns = zbx_malloc(NULL, sizeof(char *) * dbh->col_num);
+
+	if (SUCCEED == get_result_columns(dbh, columns))
 	{
-		columns = zbx_malloc(NULL, sizeof(char *) * dbh.col_num);
+		for (i = 0; i < dbh->col_num; i++)
+			zabbix_log(LOG_LEVEL_DEBUG, "%s() column[%d]:'%s'", __function_name, i + 1, columns[i]);
 
-		if (SUCCEED == get_result_columns(&dbh, columns))
+		for (i = 0; i < dbh->col_num; i++)
 		{
-			for (i = 0; i < dbh.col_num; i++)
-				zabbix_log(LOG_LEVEL_DEBUG, "%s() column[%d]:'%s'", __function_name, i + 1, columns[i]);
-
-			for (i = 0; i < dbh.col_num; i++)
+			for (p = columns[i]; '\0' != *p; p++)
 			{
-				for (p = columns[i]; '\0' != *p; p++)
-				{
-					if (0 != isalpha((unsigned char)*p))
-						*p = toupper((unsigned char)*p);
-
-					if (SUCCEED != is_macro_char(*p))
-					{
-						SET_MSG_RESULT(result, zbx_dsprintf(NULL,
-								"Cannot convert column #%d name to macro.", i + 1));
-						goto clean;
-					}
-				}
+				if (0 != isalpha((unsigned char)*p))
+					*p = toupper((unsigned char)*p);
 
-				for (j = 0; j < i; j++)
+				if (SUCCEED != is_macro_char(*p))
 				{
-					if (0 == strcmp(columns[i], columns[j]))
-					{
-						SET_MSG_RESULT(result, zbx_dsprintf(NULL,
-								"Duplicate macro name: {#%s}.", columns[i]));
-						goto clean;
-					}
+					SET_MSG_RESULT(result, zbx_dsprintf(NULL,
+							"Cannot convert column #%d name to macro.", i + 1));
+					goto clean;
 				}
 			}
 
-			zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
-			zbx_json_addarray(&json, ZBX_PROTO_TAG_DATA);
-
-			while (NULL != (row = odbc_DBfetch(&dbh)))
+			for (j = 0; j < i; j++)
 			{
-				zbx_json_addobject(&json, NULL);
-
-				for (i = 0; i < dbh.col_num; i++)
+				if (0 == strcmp(columns[i], columns[j]))
 				{
-					zbx_snprintf(macro, MAX_STRING_LEN, "{#%s}", columns[i]);
-					zbx_json_addstring(&json, macro, row[i], ZBX_JSON_TYPE_STRING);
+					SET_MSG_RESULT(result, zbx_dsprintf(NULL,
+							"Duplicate macro name: {#%s}.", columns[i]));
+					goto clean;
 				}
+			}
+		}
+
+		zbx_json_init(&json, ZBX_JSON_STAT_BUF_LEN);
+		zbx_json_addarray(&json, ZBX_PROTO_TAG_DATA);
 
-				zbx_json_close(&json);
+		while (NULL != (row = odbc_DBfetch(dbh)))
+		{
+			zbx_json_addobject(&json, NULL);
+
+			for (i = 0; i < dbh->col_num; i++)
+			{
+				zbx_snprintf(macro, MAX_STRING_LEN, "{#%s}", columns[i]);
+				zbx_json_addstring(&json, macro, row[i], ZBX_JSON_TYPE_STRING);
 			}
 
 			zbx_json_close(&json);
+		}
 
-			SET_STR_RESULT(result, zbx_strdup(NULL, json.buffer));
+		zbx_json_close(&json);
 
-			zbx_json_free(&json);
+		SET_STR_RESULT(result, zbx_strdup(NULL, json.buffer));
 
-			ret = SUCCEED;
-clean:
-			for (i = 0; i < dbh.col_num; i++)
-				zbx_free(columns[i]);
-		}
-		else
-			SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot obtain column names."));
+		zbx_json_free(&json);
 
-		zbx_free(columns);
+		ret = SUCCEED;
+clean:
+		for (i = 0; i < dbh->col_num; i++)
+			zbx_free(columns[i]);
 	}
 	else
-		SET_MSG_RESULT(result, zbx_strdup(NULL, get_last_odbc_strerror()));
+		SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot obtain column names."));
+
+	zbx_free(columns);
 
-	odbc_DBclose(&dbh);
+	db_odbc_disconnect(dbh);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
 
@@ -158,7 +371,7 @@ static int	db_odbc_select(DC_ITEM *item, AGENT_REQUEST *request, AGENT_RESULT *r
 	const char	*__function_name = "db_odbc_select";
 
 	int		ret = NOTSUPPORTED;
-	ZBX_ODBC_DBH	dbh;
+	ZBX_ODBC_DBH	*dbh;
 	ZBX_ODBC_ROW	row;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() query:'%s'", __function_name, item->params);
@@ -169,39 +382,31 @@ static int	db_odbc_select(DC_ITEM *item, AGENT_REQUEST *request, AGENT_RESULT *r
 		goto out;
 	}
 
-	if (SUCCEED != odbc_DBconnect(&dbh, request->params[1], item->username, item->password, CONFIG_TIMEOUT))
-	{
-		SET_MSG_RESULT(result, zbx_strdup(NULL, get_last_odbc_strerror()));
+	if (NULL == (dbh = db_odbc_query(item, request->params[1], result)))
 		goto out;
-	}
 
-	if (NULL != odbc_DBselect(&dbh, item->params))
+	if (NULL != (row = odbc_DBfetch(dbh)))
 	{
-		if (NULL != (row = odbc_DBfetch(&dbh)))
+		if (NULL == row[0])
 		{
-			if (NULL == row[0])
-			{
-				SET_MSG_RESULT(result, zbx_strdup(NULL, "SQL query returned NULL value."));
-			}
-			else if (SUCCEED == set_result_type(result, item->value_type, item->data_type, row[0]))
-			{
-				ret = SUCCEED;
-			}
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "SQL query returned NULL value."));
 		}
-		else
+		else if (SUCCEED == set_result_type(result, item->value_type, item->data_type, row[0]))
 		{
-			const char	*last_error = get_last_odbc_strerror();
-
-			if ('\0' != *last_error)
-				SET_MSG_RESULT(result, zbx_strdup(NULL, last_error));
-			else
-				SET_MSG_RESULT(result, zbx_strdup(NULL, "SQL query returned empty result."));
+			ret = SUCCEED;
 		}
 	}
 	else
-		SET_MSG_RESULT(result, zbx_strdup(NULL, get_last_odbc_strerror()));
+	{
+		const char	*last_error = get_last_odbc_strerror();
+
+		if ('\0' != *last_error)
+			SET_MSG_RESULT(result, zbx_strdup(NULL, last_error));
+		else
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "SQL query returned empty result."));
+	}
 
-	odbc_DBclose(&dbh);
+	db_odbc_disconnect(dbh);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
 
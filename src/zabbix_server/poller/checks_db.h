@@ -27,6 +27,7 @@
 
 #ifdef HAVE_UNIXODBC
 int	get_value_db(DC_ITEM *item, AGENT_RESULT *result);
+void	zbx_odbc_pool_expire(void);
 #endif
 
 #endif
@@ -24,6 +24,7 @@
 #include "checks_external.h"
 
 extern char	*CONFIG_EXTERNALSCRIPTS;
+extern char	*CONFIG_EXTERNALSCRIPTS_PERSISTENT;
 
 /******************************************************************************
  *                                                                            *
@@ -46,7 +47,7 @@ int	get_value_external(DC_ITEM *item, AGENT_RESULT *result)
 
 	char		error[ITEM_ERROR_LEN_MAX], *cmd = NULL, *buf = NULL;
 	size_t		cmd_alloc = ZBX_KIBIBYTE, cmd_offset = 0;
-	int		i, ret = NOTSUPPORTED;
+	int		i, rc, ret = NOTSUPPORTED;
 	AGENT_REQUEST	request;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() key:'%s'", __function_name, item->key_orig);
@@ -68,19 +69,31 @@ int	get_value_external(DC_ITEM *item, AGENT_RESULT *result)
 		goto out;
 	}
 
-	for (i = 0; i < get_rparams_num(&request); i++)
+	if (NULL != CONFIG_EXTERNALSCRIPTS_PERSISTENT &&
+			SUCCEED == str_in_list(CONFIG_EXTERNALSCRIPTS_PERSISTENT, get_rkey(&request), ','))
 	{
-		const char	*param;
-		char		*param_esc;
+		/* persistent scripts receive the item key parameters over their stdin */
+		rc = zbx_execute_persistent(cmd, (const char **)request.params, get_rparams_num(&request), &buf, error,
+				sizeof(error), CONFIG_TIMEOUT);
+	}
+	else
+	{
+		for (i = 0; i < get_rparams_num(&request); i++)
+		{
+			const char	*param;
+			char		*param_esc;
+
+			param = get_rparam(&request, i);
 
-		param = get_rparam(&request, i);
+			param_esc = zbx_dyn_escape_string(param, "\"\\");
+			zbx_snprintf_alloc(&cmd, &cmd_alloc, &cmd_offset, " \"%s\"", param_esc);
+			zbx_free(param_esc);
+		}
 
-		param_esc = zbx_dyn_escape_string(param, "\"\\");
-		zbx_snprintf_alloc(&cmd, &cmd_alloc, &cmd_offset, " \"%s\"", param_esc);
-		zbx_free(param_esc);
+		rc = zbx_execute(cmd, &buf, error, sizeof(error), CONFIG_TIMEOUT);
 	}
 
-	if (SUCCEED == zbx_execute(cmd, &buf, error, sizeof(error), CONFIG_TIMEOUT))
+	if (SUCCEED == rc)
 	{
 		zbx_rtrim(buf, ZBX_WHITESPACE);
 
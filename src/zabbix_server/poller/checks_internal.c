@@ -22,14 +22,106 @@
 #include "checks_java.h"
 #include "log.h"
 #include "dbcache.h"
+#include "memalloc.h"
+#include "mutexs.h"
 #include "zbxself.h"
 #include "valuecache.h"
 #include "proxy.h"
+#include "checks_snmp.h"
 
 #include "../vmware/vmware.h"
 
 extern unsigned char	program_type;
 
+/******************************************************************************
+ *                                                                            *
+ * Function: get_memory_usage                                                 *
+ *                                                                            *
+ * Purpose: get memory used by cache structure                                *
+ *                                                                            *
+ * Parameters: cache     - [IN] the cache name (rcache, wcache, vcache or     *
+ *                              vmware)                                       *
+ *             structure - [IN] the cache structure name                      *
+ *             mode      - [IN] bytes, count or avg                           *
+ *             result    - [OUT] the item value                               *
+ *             error     - [OUT] the error message                            *
+ *                                                                            *
+ * Return value: SUCCEED - the value was retrieved successfully               *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_memory_usage(const char *cache, const char *structure, const char *mode, AGENT_RESULT *result,
+		char **error)
+{
+	zbx_vector_ptr_t	usage;
+	const zbx_mem_usage_t	*mem_usage;
+	int			ret = FAIL;
+
+	zbx_vector_ptr_create(&usage);
+
+	if (0 == strcmp(cache, "rcache"))
+	{
+		DCconfig_get_memory_usage(&usage);
+	}
+	else if (0 == strcmp(cache, "wcache"))
+	{
+		DCget_memory_usage(&usage);
+	}
+	else if (0 == strcmp(cache, "vcache") && 0 != (program_type & ZBX_PROGRAM_TYPE_SERVER))
+	{
+		if (SUCCEED != zbx_vc_get_memory_usage(&usage))
+		{
+			*error = zbx_strdup(*error, "Value cache is disabled.");
+			goto out;
+		}
+	}
+	else if (0 == strcmp(cache, "vmware"))
+	{
+		if (SUCCEED != zbx_vmware_get_memory_usage(&usage))
+		{
+			*error = zbx_dsprintf(*error, "No \"%s\" processes started.",
+					get_process_type_string(ZBX_PROCESS_TYPE_VMWARE));
+			goto out;
+		}
+	}
+	else
+	{
+		*error = zbx_strdup(*error, "Invalid second parameter.");
+		goto out;
+	}
+
+	if (NULL == structure || NULL == (mem_usage = zbx_mem_usage_search(&usage, structure)))
+	{
+		*error = zbx_strdup(*error, "Invalid third parameter.");
+		goto out;
+	}
+
+	if (NULL == mode || '\0' == *mode || 0 == strcmp(mode, "bytes"))
+	{
+		SET_UI64_RESULT(result, mem_usage->bytes);
+	}
+	else if (0 == strcmp(mode, "count"))
+	{
+		SET_UI64_RESULT(result, mem_usage->count);
+	}
+	else if (0 == strcmp(mode, "avg"))
+	{
+		SET_UI64_RESULT(result, 0 != mem_usage->count ? mem_usage->bytes / mem_usage->count : 0);
+	}
+	else
+	{
+		*error = zbx_strdup(*error, "Invalid fourth parameter.");
+		goto out;
+	}
+
+	ret = SUCCEED;
+out:
+	zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	zbx_vector_ptr_destroy(&usage);
+
+	return ret;
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: get_value_internal                                               *
@@ -338,6 +430,7 @@ int	get_value_internal(DC_ITEM *item, AGENT_RESULT *result)
 			case ZBX_PROCESS_TYPE_PROXYPOLLER:
 			case ZBX_PROCESS_TYPE_TIMER:
 			case ZBX_PROCESS_TYPE_TASKMANAGER:
+			case ZBX_PROCESS_TYPE_PREPROCESSOR:
 				if (0 == (program_type & ZBX_PROGRAM_TYPE_SERVER))
 					process_type = ZBX_PROCESS_TYPE_UNKNOWN;
 				break;
@@ -606,6 +699,79 @@ int	get_value_internal(DC_ITEM *item, AGENT_RESULT *result)
 			goto out;
 		}
 	}
+	else if (0 == strcmp(tmp, "snmpidx"))
+	{
+#ifdef HAVE_NETSNMP
+		zbx_snmpidx_stats_t	stats;
+
+		if (FAIL == zbx_snmpidx_get_statistics(&stats))
+		{
+			error = zbx_strdup(error, "SNMP index cache is not initialized.");
+			goto out;
+		}
+
+		if (2 > nparams || nparams > 3)
+		{
+			error = zbx_strdup(error, "Invalid number of parameters.");
+			goto out;
+		}
+
+		tmp = get_rparam(&request, 1);
+		if (NULL == (tmp1 = get_rparam(&request, 2)))
+			tmp1 = "";
+
+		if (0 == strcmp(tmp, "buffer"))
+		{
+			if (0 == strcmp(tmp1, "free"))
+				SET_UI64_RESULT(result, stats.free_size);
+			else if (0 == strcmp(tmp1, "pfree"))
+				SET_DBL_RESULT(result, (double)stats.free_size / stats.total_size * 100);
+			else if (0 == strcmp(tmp1, "total"))
+				SET_UI64_RESULT(result, stats.total_size);
+			else if (0 == strcmp(tmp1, "used"))
+				SET_UI64_RESULT(result, stats.total_size - stats.free_size);
+			else if (0 == strcmp(tmp1, "pused"))
+				SET_DBL_RESULT(result, (double)(stats.total_size - stats.free_size) /
+						stats.total_size * 100);
+			else
+			{
+				error = zbx_strdup(error, "Invalid third parameter.");
+				goto out;
+			}
+		}
+		else if (0 == strcmp(tmp, "cache"))
+		{
+			if (0 == strcmp(tmp1, "hits"))
+				SET_UI64_RESULT(result, stats.hits);
+			else if (0 == strcmp(tmp1, "requests"))
+				SET_UI64_RESULT(result, stats.hits + stats.misses);
+			else if (0 == strcmp(tmp1, "misses"))
+				SET_UI64_RESULT(result, stats.misses);
+			else if (0 == strcmp(tmp1, "phits"))
+			{
+				SET_DBL_RESULT(result, 0 == stats.hits + stats.misses ? 0 :
+						(double)stats.hits / (stats.hits + stats.misses) * 100);
+			}
+			else if (0 == strcmp(tmp1, "stale"))
+				SET_UI64_RESULT(result, stats.stale);
+			else if (0 == strcmp(tmp1, "walks"))
+				SET_UI64_RESULT(result, stats.walks);
+			else
+			{
+				error = zbx_strdup(error, "Invalid third parameter.");
+				goto out;
+			}
+		}
+		else
+		{
+			error = zbx_strdup(error, "Invalid second parameter.");
+			goto out;
+		}
+#else
+		error = zbx_strdup(error, "Support for SNMP checks was not compiled in.");
+		goto out;
+#endif
+	}
 	else if (0 == strcmp(tmp, "proxy_history"))
 	{
 		if (0 == (program_type & ZBX_PROGRAM_TYPE_PROXY))
@@ -675,6 +841,91 @@ int	get_value_internal(DC_ITEM *item, AGENT_RESULT *result)
 			goto out;
 		}
 	}
+	else if (0 == strcmp(tmp, "memory"))		/* zabbix[memory,<cache>,<structure>,<mode>] */
+	{
+		if (3 > nparams || nparams > 4)
+		{
+			error = zbx_strdup(error, "Invalid number of parameters.");
+			goto out;
+		}
+
+		if (SUCCEED != get_memory_usage(get_rparam(&request, 1), get_rparam(&request, 2),
+				get_rparam(&request, 3), result, &error))
+		{
+			goto out;
+		}
+	}
+	else if (0 == strcmp(tmp, "latency"))		/* zabbix[latency,<stage>,<mode>] */
+	{
+		unsigned char	stage, mode;
+		double		value, percentile = 0;
+
+		if (2 > nparams || nparams > 3)
+		{
+			error = zbx_strdup(error, "Invalid number of parameters.");
+			goto out;
+		}
+
+		if (ZBX_LATENCY_STAGE_UNKNOWN == (stage = get_latency_stage_by_name(get_rparam(&request, 1))))
+		{
+			error = zbx_strdup(error, "Invalid second parameter.");
+			goto out;
+		}
+
+		if (NULL == (tmp = get_rparam(&request, 2)) || '\0' == *tmp || 0 == strcmp(tmp, "avg"))
+			mode = ZBX_LATENCY_MODE_AVG;
+		else if (0 == strcmp(tmp, "max"))
+			mode = ZBX_LATENCY_MODE_MAX;
+		else if (0 == strcmp(tmp, "count"))
+			mode = ZBX_LATENCY_MODE_COUNT;
+		else if ('p' == *tmp && SUCCEED == is_double(tmp + 1) && 0 < (percentile = atof(tmp + 1)) &&
+				100 >= percentile)
+		{
+			mode = ZBX_LATENCY_MODE_PERCENTILE;
+		}
+		else
+		{
+			error = zbx_strdup(error, "Invalid third parameter.");
+			goto out;
+		}
+
+		get_latency_stats(stage, mode, percentile, &value);
+
+		if (ZBX_LATENCY_MODE_COUNT == mode)
+			SET_UI64_RESULT(result, (zbx_uint64_t)value);
+		else
+			SET_DBL_RESULT(result, value);
+	}
+	else if (0 == strcmp(tmp, "lock"))		/* zabbix[lock,<name>,<mode>] */
+	{
+		zbx_mutex_stats_t	stats;
+
+		if (2 > nparams || nparams > 3)
+		{
+			error = zbx_strdup(error, "Invalid number of parameters.");
+			goto out;
+		}
+
+		if (SUCCEED != zbx_mutex_stats_get(get_rparam(&request, 1), &stats))
+		{
+			error = zbx_strdup(error, "Invalid second parameter.");
+			goto out;
+		}
+
+		if (NULL == (tmp = get_rparam(&request, 2)) || '\0' == *tmp || 0 == strcmp(tmp, "count"))
+			SET_UI64_RESULT(result, stats.locks);
+		else if (0 == strcmp(tmp, "contended"))
+			SET_UI64_RESULT(result, stats.contended);
+		else if (0 == strcmp(tmp, "wait"))
+			SET_DBL_RESULT(result, (double)stats.wait_time / 1000000);
+		else if (0 == strcmp(tmp, "hold_max"))
+			SET_DBL_RESULT(result, (double)stats.hold_max / 1000000);
+		else
+		{
+			error = zbx_strdup(error, "Invalid third parameter.");
+			goto out;
+		}
+	}
 	else
 	{
 		error = zbx_strdup(error, "Invalid first parameter.");
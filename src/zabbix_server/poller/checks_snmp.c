@@ -28,6 +28,12 @@
 #include "comms.h"
 #include "zbxalgo.h"
 #include "zbxjson.h"
+#include "memalloc.h"
+#include "mutexs.h"
+#include "ipc.h"
+
+extern char		*CONFIG_FILE;
+extern zbx_uint64_t	CONFIG_SNMP_INDEX_CACHE_SIZE;
 
 /*
  * SNMP Dynamic Index Cache
@@ -37,8 +43,7 @@
  * -----------
  *
  * Zabbix caches the whole index table for the particular OID separately based on:
- *   * IP address;
- *   * port;
+ *   * interface;
  *   * community string (SNMPv2c);
  *   * context, security name (SNMPv3).
  *
@@ -65,11 +70,17 @@
  * Implementation
  * --------------
  *
- * The cache is implemented using hash tables. In ERD:
+ * The cache is implemented using hash tables in shared memory, so all pollers use the same indexes. In ERD:
  * zbx_snmpidx_main_key_t -------------------------------------------0< zbx_snmpidx_mapping_t
- * (OID, host, <v2c: community|v3: (context, security name)>)           (index, value)
+ * (OID, interface, <v2c: community|v3: (context, security name)>)      (index, value)
+ *
+ * The index table is walked into local memory and replaces the cached table at once. The time of the last walk is
+ * kept with the table, so a value that is missing from a table walked less than ZBX_SNMPIDX_WALK_DELAY seconds ago
+ * does not cause another walk. When the cache runs out of memory it is cleared.
  */
 
+#define ZBX_SNMPIDX_WALK_DELAY	SEC_PER_MIN
+
 /******************************************************************************
  *                                                                            *
  * This is zbx_snmp_walk() callback function prototype.                       *
@@ -85,12 +96,12 @@ typedef void (zbx_snmp_walk_cb_func)(void *arg, const char *oid, const char *ind
 
 typedef struct
 {
-	char		*addr;
-	unsigned short	port;
+	zbx_uint64_t	interfaceid;
 	char		*oid;
 	char		*community_context;	/* community (SNMPv1 or v2c) or contextName (SNMPv3) */
 	char		*security_name;		/* only SNMPv3, empty string in case of other versions */
-	zbx_hashset_t	*mappings;
+	int		walked;			/* the time the OID table was last walked */
+	zbx_hashset_t	mappings;
 }
 zbx_snmpidx_main_key_t;
 
@@ -101,7 +112,41 @@ typedef struct
 }
 zbx_snmpidx_mapping_t;
 
-static zbx_hashset_t	snmpidx;		/* Dynamic Index Cache */
+typedef struct
+{
+	zbx_hashset_t	main_keys;
+
+	zbx_uint64_t	hits;
+	zbx_uint64_t	misses;
+	zbx_uint64_t	stale;
+	zbx_uint64_t	walks;
+}
+zbx_snmpidx_t;
+
+static zbx_snmpidx_t	*snmpidx = NULL;	/* Dynamic Index Cache */
+static zbx_mem_info_t	*snmpidx_mem = NULL;
+static ZBX_MUTEX	snmpidx_lock = ZBX_MUTEX_NULL;
+
+ZBX_MEM_FUNC_IMPL(__snmpidx, snmpidx_mem)
+
+static char	*__snmpidx_strdup(const char *str)
+{
+	char	*ptr;
+	size_t	len;
+
+	len = strlen(str) + 1;
+
+	if (NULL != (ptr = __snmpidx_mem_malloc_func(NULL, len)))
+		memcpy(ptr, str, len);
+
+	return ptr;
+}
+
+static void	__snmpidx_strfree(char *str)
+{
+	if (NULL != str)
+		__snmpidx_mem_free_func(str);
+}
 
 static zbx_hash_t	__snmpidx_main_key_hash(const void *data)
 {
@@ -109,8 +154,7 @@ static zbx_hash_t	__snmpidx_main_key_hash(const void *data)
 
 	zbx_hash_t			hash;
 
-	hash = ZBX_DEFAULT_STRING_HASH_FUNC(main_key->addr);
-	hash = ZBX_DEFAULT_STRING_HASH_ALGO(&main_key->port, sizeof(main_key->port), hash);
+	hash = ZBX_DEFAULT_UINT64_HASH_FUNC(&main_key->interfaceid);
 	hash = ZBX_DEFAULT_STRING_HASH_ALGO(main_key->oid, strlen(main_key->oid), hash);
 	hash = ZBX_DEFAULT_STRING_HASH_ALGO(main_key->community_context, strlen(main_key->community_context), hash);
 	hash = ZBX_DEFAULT_STRING_HASH_ALGO(main_key->security_name, strlen(main_key->security_name), hash);
@@ -125,10 +169,7 @@ static int	__snmpidx_main_key_compare(const void *d1, const void *d2)
 
 	int				ret;
 
-	if (0 != (ret = strcmp(main_key1->addr, main_key2->addr)))
-		return ret;
-
-	ZBX_RETURN_IF_NOT_EQUAL(main_key1->port, main_key2->port);
+	ZBX_RETURN_IF_NOT_EQUAL(main_key1->interfaceid, main_key2->interfaceid);
 
 	if (0 != (ret = strcmp(main_key1->community_context, main_key2->community_context)))
 		return ret;
@@ -143,12 +184,10 @@ static void	__snmpidx_main_key_clean(void *data)
 {
 	zbx_snmpidx_main_key_t	*main_key = (zbx_snmpidx_main_key_t *)data;
 
-	zbx_free(main_key->addr);
-	zbx_free(main_key->oid);
-	zbx_free(main_key->community_context);
-	zbx_free(main_key->security_name);
-	zbx_hashset_destroy(main_key->mappings);
-	zbx_free(main_key->mappings);
+	__snmpidx_strfree(main_key->oid);
+	__snmpidx_strfree(main_key->community_context);
+	__snmpidx_strfree(main_key->security_name);
+	zbx_hashset_destroy(&main_key->mappings);
 }
 
 static zbx_hash_t	__snmpidx_mapping_hash(const void *data)
@@ -170,8 +209,106 @@ static void	__snmpidx_mapping_clean(void *data)
 {
 	zbx_snmpidx_mapping_t	*mapping = (zbx_snmpidx_mapping_t *)data;
 
-	zbx_free(mapping->value);
-	zbx_free(mapping->index);
+	__snmpidx_strfree(mapping->value);
+	__snmpidx_strfree(mapping->index);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmpidx_init                                                 *
+ *                                                                            *
+ * Purpose: initializes SNMP dynamic index cache                              *
+ *                                                                            *
+ * Comments: This function must be called before worker processes are forked.*
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_snmpidx_init(void)
+{
+	const char	*__function_name = "zbx_snmpidx_init";
+
+	key_t		shm_key;
+	zbx_uint64_t	size_reserved;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	zbx_mutex_create(&snmpidx_lock, ZBX_MUTEX_SNMPIDX);
+
+	if (-1 == (shm_key = zbx_ftok(CONFIG_FILE, ZBX_IPC_SNMPIDX_ID)))
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot create IPC key for SNMP index cache");
+		exit(EXIT_FAILURE);
+	}
+
+	size_reserved = zbx_mem_required_size(1, "SNMP index cache size", "SNMPIndexCacheSize");
+
+	CONFIG_SNMP_INDEX_CACHE_SIZE -= size_reserved;
+
+	zbx_mem_create(&snmpidx_mem, shm_key, ZBX_NO_MUTEX, CONFIG_SNMP_INDEX_CACHE_SIZE, "SNMP index cache size",
+			"SNMPIndexCacheSize", 1);
+
+	snmpidx = __snmpidx_mem_malloc_func(NULL, sizeof(zbx_snmpidx_t));
+	memset(snmpidx, 0, sizeof(zbx_snmpidx_t));
+
+	zbx_hashset_create_ext(&snmpidx->main_keys, 100, __snmpidx_main_key_hash, __snmpidx_main_key_compare,
+			__snmpidx_main_key_clean, __snmpidx_mem_malloc_func, __snmpidx_mem_realloc_func,
+			__snmpidx_mem_free_func);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmpidx_destroy                                              *
+ *                                                                            *
+ * Purpose: destroys SNMP dynamic index cache                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_snmpidx_destroy(void)
+{
+	const char	*__function_name = "zbx_snmpidx_destroy";
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	if (NULL != snmpidx)
+	{
+		zbx_mem_destroy(snmpidx_mem);
+		snmpidx = NULL;
+		zbx_mutex_destroy(&snmpidx_lock);
+	}
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmpidx_get_statistics                                       *
+ *                                                                            *
+ * Purpose: retrieves usage statistics of SNMP dynamic index cache            *
+ *                                                                            *
+ * Parameters: stats - [OUT] the cache usage statistics                       *
+ *                                                                            *
+ * Return value: SUCCEED - the statistics were retrieved successfully         *
+ *               FAIL    - the cache is not initialized                       *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_snmpidx_get_statistics(zbx_snmpidx_stats_t *stats)
+{
+	if (NULL == snmpidx)
+		return FAIL;
+
+	zbx_mutex_lock(&snmpidx_lock);
+
+	stats->hits = snmpidx->hits;
+	stats->misses = snmpidx->misses;
+	stats->stale = snmpidx->stale;
+	stats->walks = snmpidx->walks;
+
+	stats->total_size = snmpidx_mem->total_size;
+	stats->free_size = snmpidx_mem->free_size;
+
+	zbx_mutex_unlock(&snmpidx_lock);
+
+	return SUCCEED;
 }
 
 static char	*get_item_community_context(const DC_ITEM *item)
@@ -193,6 +330,15 @@ static char	*get_item_security_name(const DC_ITEM *item)
 	return "";
 }
 
+static void	snmpidx_main_key_init(zbx_snmpidx_main_key_t *main_key, const DC_ITEM *item, const char *oid)
+{
+	main_key->interfaceid = item->interface.interfaceid;
+	main_key->oid = (char *)oid;
+
+	main_key->community_context = get_item_community_context(item);
+	main_key->security_name = get_item_security_name(item);
+}
+
 /******************************************************************************
  *                                                                            *
  * Function: cache_get_snmp_index                                             *
@@ -200,13 +346,15 @@ static char	*get_item_security_name(const DC_ITEM *item)
  * Purpose: retrieve index that matches value from the relevant index cache   *
  *                                                                            *
  * Parameters: item      - [IN] configuration of Zabbix item, contains        *
- *                              IP address, port, community string, context,  *
+ *                              interface, community string, context,         *
  *                              security name                                 *
  *             oid       - [IN] OID of the table which contains the indexes   *
  *             value     - [IN] value for which to look up the index          *
  *             idx       - [IN/OUT] destination pointer for the               *
  *                                  heap-(re)allocated index                  *
  *             idx_alloc - [IN/OUT] size of the (re)allocated index           *
+ *             walked    - [OUT] the time the table was last walked, 0 if the *
+ *                               table is not cached                          *
  *                                                                            *
  * Return value: FAIL    - dynamic index cache is empty or cache does not     *
  *                         contain index matching the value                   *
@@ -215,7 +363,8 @@ static char	*get_item_security_name(const DC_ITEM *item)
  *                         heap-(re)allocated idx                             *
  *                                                                            *
  ******************************************************************************/
-static int	cache_get_snmp_index(const DC_ITEM *item, const char *oid, const char *value, char **idx, size_t *idx_alloc)
+static int	cache_get_snmp_index(const DC_ITEM *item, const char *oid, const char *value, char **idx, size_t *idx_alloc,
+		int *walked)
 {
 	const char		*__function_name = "cache_get_snmp_index";
 
@@ -226,137 +375,182 @@ static int	cache_get_snmp_index(const DC_ITEM *item, const char *oid, const char
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() oid:'%s' value:'%s'", __function_name, oid, value);
 
-	if (NULL == snmpidx.slots)
+	*walked = 0;
+
+	if (NULL == snmpidx)
 		goto end;
 
-	main_key_local.addr = item->interface.addr;
-	main_key_local.port = item->interface.port;
-	main_key_local.oid = (char *)oid;
+	snmpidx_main_key_init(&main_key_local, item, oid);
 
-	main_key_local.community_context = get_item_community_context(item);
-	main_key_local.security_name = get_item_security_name(item);
+	zbx_mutex_lock(&snmpidx_lock);
 
-	if (NULL == (main_key = zbx_hashset_search(&snmpidx, &main_key_local)))
-		goto end;
+	if (NULL != (main_key = zbx_hashset_search(&snmpidx->main_keys, &main_key_local)))
+	{
+		*walked = main_key->walked;
 
-	if (NULL == (mapping = zbx_hashset_search(main_key->mappings, &value)))
-		goto end;
+		if (NULL != (mapping = zbx_hashset_search(&main_key->mappings, &value)))
+		{
+			zbx_strcpy_alloc(idx, idx_alloc, &idx_offset, mapping->index);
+			ret = SUCCEED;
+		}
+	}
 
-	zbx_strcpy_alloc(idx, idx_alloc, &idx_offset, mapping->index);
-	ret = SUCCEED;
+	if (SUCCEED == ret)
+		snmpidx->hits++;
+	else
+		snmpidx->misses++;
+
+	zbx_mutex_unlock(&snmpidx_lock);
 end:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s idx:'%s'", __function_name, zbx_result_string(ret),
-			SUCCEED == ret ? *idx : "");
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s idx:'%s' walked:%d", __function_name, zbx_result_string(ret),
+			SUCCEED == ret ? *idx : "", *walked);
 
 	return ret;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: cache_put_snmp_index                                             *
- *                                                                            *
- * Purpose: store the index-value pair in the relevant index cache            *
+ * Function: cache_stale_snmp_index                                           *
  *                                                                            *
- * Parameters: item      - [IN] configuration of Zabbix item, contains        *
- *                              IP address, port, community string, context,  *
- *                              security name                                 *
- *             oid       - [IN] OID of the table which contains the indexes   *
- *             index     - [IN] index part of the index-value pair            *
- *             value     - [IN] value part of the index-value pair            *
+ * Purpose: account cached indexes that did not pass verification            *
  *                                                                            *
  ******************************************************************************/
-static void	cache_put_snmp_index(const DC_ITEM *item, const char *oid, const char *index, const char *value)
+static void	cache_stale_snmp_index(int num)
 {
-	const char		*__function_name = "cache_put_snmp_index";
+	if (NULL == snmpidx || 0 == num)
+		return;
 
-	zbx_snmpidx_main_key_t	*main_key, main_key_local;
-	zbx_snmpidx_mapping_t	*mapping, mapping_local;
+	zbx_mutex_lock(&snmpidx_lock);
+	snmpidx->stale += num;
+	zbx_mutex_unlock(&snmpidx_lock);
+}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() oid:'%s' index:'%s' value:'%s'", __function_name, oid, index, value);
+/******************************************************************************
+ *                                                                            *
+ * Function: snmpidx_set_subtree                                              *
+ *                                                                            *
+ * Purpose: replace the cached index table with the walked one                *
+ *                                                                            *
+ * Parameters: main_key_local - [IN] the table key                            *
+ *             mappings       - [IN] the index (first) and value (second)     *
+ *                                   pairs in the walk order                  *
+ *             now            - [IN] the time of the walk                     *
+ *                                                                            *
+ * Return value: SUCCEED - the table was cached                               *
+ *               FAIL    - out of cache memory, the table is partially cached *
+ *                                                                            *
+ * Comments: the cache must be locked                                         *
+ *                                                                            *
+ ******************************************************************************/
+static int	snmpidx_set_subtree(const zbx_snmpidx_main_key_t *main_key_local, const zbx_vector_ptr_pair_t *mappings,
+		int now)
+{
+	zbx_snmpidx_main_key_t	*main_key, main_key_new;
+	zbx_snmpidx_mapping_t	*mapping, mapping_local;
+	char			*index;
+	int			i;
 
-	if (NULL == snmpidx.slots)
+	if (NULL == (main_key = zbx_hashset_search(&snmpidx->main_keys, main_key_local)))
 	{
-		zbx_hashset_create_ext(&snmpidx, 100,
-				__snmpidx_main_key_hash, __snmpidx_main_key_compare, __snmpidx_main_key_clean,
-				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
-	}
+		main_key_new.interfaceid = main_key_local->interfaceid;
+		main_key_new.oid = __snmpidx_strdup(main_key_local->oid);
+		main_key_new.community_context = __snmpidx_strdup(main_key_local->community_context);
+		main_key_new.security_name = __snmpidx_strdup(main_key_local->security_name);
+		main_key_new.walked = 0;
 
-	main_key_local.addr = item->interface.addr;
-	main_key_local.port = item->interface.port;
-	main_key_local.oid = (char *)oid;
+		zbx_hashset_create_ext(&main_key_new.mappings, 0, __snmpidx_mapping_hash, __snmpidx_mapping_compare,
+				__snmpidx_mapping_clean, __snmpidx_mem_malloc_func, __snmpidx_mem_realloc_func,
+				__snmpidx_mem_free_func);
+
+		if (NULL == main_key_new.oid || NULL == main_key_new.community_context ||
+				NULL == main_key_new.security_name || NULL == (main_key = zbx_hashset_insert(
+				&snmpidx->main_keys, &main_key_new, sizeof(main_key_new))))
+		{
+			__snmpidx_main_key_clean(&main_key_new);
+			return FAIL;
+		}
+	}
+	else
+		zbx_hashset_clear(&main_key->mappings);
 
-	main_key_local.community_context = get_item_community_context(item);
-	main_key_local.security_name = get_item_security_name(item);
+	main_key->walked = now;
 
-	if (NULL == (main_key = zbx_hashset_search(&snmpidx, &main_key_local)))
+	for (i = 0; i < mappings->values_num; i++)
 	{
-		main_key_local.addr = zbx_strdup(NULL, item->interface.addr);
-		main_key_local.oid = zbx_strdup(NULL, oid);
-
-		main_key_local.community_context = zbx_strdup(NULL, get_item_community_context(item));
-		main_key_local.security_name = zbx_strdup(NULL, get_item_security_name(item));
+		const char	*value = (const char *)mappings->values[i].second;
 
-		main_key_local.mappings = zbx_malloc(NULL, sizeof(zbx_hashset_t));
-		zbx_hashset_create_ext(main_key_local.mappings, 100,
-				__snmpidx_mapping_hash, __snmpidx_mapping_compare, __snmpidx_mapping_clean,
-				ZBX_DEFAULT_MEM_MALLOC_FUNC, ZBX_DEFAULT_MEM_REALLOC_FUNC, ZBX_DEFAULT_MEM_FREE_FUNC);
+		if (NULL == (index = __snmpidx_strdup((const char *)mappings->values[i].first)))
+			return FAIL;
 
-		main_key = zbx_hashset_insert(&snmpidx, &main_key_local, sizeof(main_key_local));
-	}
+		if (NULL != (mapping = zbx_hashset_search(&main_key->mappings, &value)))
+		{
+			__snmpidx_mem_free_func(mapping->index);
+			mapping->index = index;
+			continue;
+		}
 
-	if (NULL == (mapping = zbx_hashset_search(main_key->mappings, &value)))
-	{
-		mapping_local.value = zbx_strdup(NULL, value);
-		mapping_local.index = zbx_strdup(NULL, index);
+		mapping_local.index = index;
 
-		zbx_hashset_insert(main_key->mappings, &mapping_local, sizeof(mapping_local));
-	}
-	else if (0 != strcmp(mapping->index, index))
-	{
-		zbx_free(mapping->index);
-		mapping->index = zbx_strdup(NULL, index);
+		if (NULL == (mapping_local.value = __snmpidx_strdup(value)) ||
+				NULL == zbx_hashset_insert(&main_key->mappings, &mapping_local, sizeof(mapping_local)))
+		{
+			__snmpidx_mapping_clean(&mapping_local);
+			return FAIL;
+		}
 	}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+	return SUCCEED;
 }
 
 /******************************************************************************
  *                                                                            *
- * Function: cache_del_snmp_index_subtree                                     *
+ * Function: cache_set_snmp_index_subtree                                     *
  *                                                                            *
- * Purpose: delete index-value mappings from the specified index cache        *
+ * Purpose: store the walked index table in the relevant index cache          *
  *                                                                            *
  * Parameters: item      - [IN] configuration of Zabbix item, contains        *
- *                              IP address, port, community string, context,  *
+ *                              interface, community string, context,         *
  *                              security name                                 *
  *             oid       - [IN] OID of the table which contains the indexes   *
- *                                                                            *
- * Comments: does nothing if the index cache is empty or if it does not       *
- *           contain the cache for the specified OID                          *
+ *             mappings  - [IN] the index (first) and value (second) pairs    *
+ *                              in the walk order                             *
  *                                                                            *
  ******************************************************************************/
-static void	cache_del_snmp_index_subtree(const DC_ITEM *item, const char *oid)
+static void	cache_set_snmp_index_subtree(const DC_ITEM *item, const char *oid,
+		const zbx_vector_ptr_pair_t *mappings)
 {
-	const char		*__function_name = "cache_del_snmp_index_subtree";
+	const char		*__function_name = "cache_set_snmp_index_subtree";
 
-	zbx_snmpidx_main_key_t	*main_key, main_key_local;
+	zbx_snmpidx_main_key_t	main_key_local;
+	int			now;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s() oid:'%s'", __function_name, oid);
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() oid:'%s' num:%d", __function_name, oid, mappings->values_num);
 
-	if (NULL == snmpidx.slots)
+	if (NULL == snmpidx)
 		goto end;
 
-	main_key_local.addr = item->interface.addr;
-	main_key_local.port = item->interface.port;
-	main_key_local.oid = (char *)oid;
+	snmpidx_main_key_init(&main_key_local, item, oid);
+	now = (int)time(NULL);
 
-	main_key_local.community_context = get_item_community_context(item);
-	main_key_local.security_name = get_item_security_name(item);
+	zbx_mutex_lock(&snmpidx_lock);
 
-	if (NULL == (main_key = zbx_hashset_search(&snmpidx, &main_key_local)))
-		goto end;
+	snmpidx->walks++;
+
+	if (SUCCEED != snmpidx_set_subtree(&main_key_local, mappings, now))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "SNMP index cache is full, clearing it");
+		zbx_hashset_clear(&snmpidx->main_keys);
+
+		if (SUCCEED != snmpidx_set_subtree(&main_key_local, mappings, now))
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "cannot cache %d indexes of \"%s\" on \"%s\":"
+					" increase SNMPIndexCacheSize configuration parameter",
+					mappings->values_num, oid, item->interface.addr);
+			zbx_hashset_clear(&snmpidx->main_keys);
+		}
+	}
 
-	zbx_hashset_clear(main_key->mappings);
+	zbx_mutex_unlock(&snmpidx_lock);
 end:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
@@ -418,18 +612,33 @@ static int	zbx_get_snmp_response_error(const struct snmp_session *ss, const DC_I
 	return ret;
 }
 
-static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *error, size_t max_error_len)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_init_session                                            *
+ *                                                                            *
+ * Purpose: fill SNMP session structure with the item interface settings      *
+ *                                                                            *
+ * Parameters: item          - [IN] the item to take settings from            *
+ *             session       - [OUT] the session structure                    *
+ *             addr          - [OUT] buffer for the peer name, must stay      *
+ *                                   valid until the session is opened        *
+ *             addr_len      - [IN] the peer name buffer size                 *
+ *             error         - [OUT] the error message                        *
+ *             max_error_len - [IN] the error message buffer size             *
+ *                                                                            *
+ * Return value: SUCCEED - the session structure was initialized              *
+ *               FAIL    - otherwise                                          *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_snmp_init_session(const DC_ITEM *item, struct snmp_session *session, char *addr, size_t addr_len,
+		char *error, size_t max_error_len)
 {
-	const char		*__function_name = "zbx_snmp_open_session";
-	struct snmp_session	session, *ss = NULL;
-	char			addr[128];
+	int	ret = FAIL;
 #ifdef HAVE_IPV6
-	int			family;
+	int	family;
 #endif
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
-
-	snmp_sess_init(&session);
+	snmp_sess_init(session);
 
 	/* Allow using sub-OIDs higher than MAX_INT, like in 'snmpwalk -Ir'. */
 	/* Disables the validation of varbind values against the MIB definition for the relevant OID. */
@@ -443,20 +652,20 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 	switch (item->type)
 	{
 		case ITEM_TYPE_SNMPv1:
-			session.version = SNMP_VERSION_1;
+			session->version = SNMP_VERSION_1;
 			break;
 		case ITEM_TYPE_SNMPv2c:
-			session.version = SNMP_VERSION_2c;
+			session->version = SNMP_VERSION_2c;
 			break;
 		case ITEM_TYPE_SNMPv3:
-			session.version = SNMP_VERSION_3;
+			session->version = SNMP_VERSION_3;
 			break;
 		default:
 			THIS_SHOULD_NEVER_HAPPEN;
 			break;
 	}
 
-	session.timeout = CONFIG_TIMEOUT * 1000 * 1000;	/* timeout of one attempt in microseconds */
+	session->timeout = CONFIG_TIMEOUT * 1000 * 1000;	/* timeout of one attempt in microseconds */
 							/* (net-snmp default = 1 second) */
 
 #ifdef HAVE_IPV6
@@ -465,62 +674,62 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 
 	if (PF_INET == family)
 	{
-		zbx_snprintf(addr, sizeof(addr), "%s:%hu", item->interface.addr, item->interface.port);
+		zbx_snprintf(addr, addr_len, "%s:%hu", item->interface.addr, item->interface.port);
 	}
 	else
 	{
 		if (item->interface.useip)
-			zbx_snprintf(addr, sizeof(addr), "udp6:[%s]:%hu", item->interface.addr, item->interface.port);
+			zbx_snprintf(addr, addr_len, "udp6:[%s]:%hu", item->interface.addr, item->interface.port);
 		else
-			zbx_snprintf(addr, sizeof(addr), "udp6:%s:%hu", item->interface.addr, item->interface.port);
+			zbx_snprintf(addr, addr_len, "udp6:%s:%hu", item->interface.addr, item->interface.port);
 	}
 #else
-	zbx_snprintf(addr, sizeof(addr), "%s:%hu", item->interface.addr, item->interface.port);
+	zbx_snprintf(addr, addr_len, "%s:%hu", item->interface.addr, item->interface.port);
 #endif
-	session.peername = addr;
+	session->peername = addr;
 
 	/* remote_port is no longer used in latest versions of Net-SNMP */
-	session.remote_port = item->interface.port;
+	session->remote_port = item->interface.port;
 
-	if (SNMP_VERSION_1 == session.version || SNMP_VERSION_2c == session.version)
+	if (SNMP_VERSION_1 == session->version || SNMP_VERSION_2c == session->version)
 	{
-		session.community = (u_char *)item->snmp_community;
-		session.community_len = strlen((void *)session.community);
-		zabbix_log(LOG_LEVEL_DEBUG, "SNMP [%s@%s]", session.community, session.peername);
+		session->community = (u_char *)item->snmp_community;
+		session->community_len = strlen((void *)session->community);
+		zabbix_log(LOG_LEVEL_DEBUG, "SNMP [%s@%s]", session->community, session->peername);
 	}
-	else if (SNMP_VERSION_3 == session.version)
+	else if (SNMP_VERSION_3 == session->version)
 	{
 		/* set the SNMPv3 user name */
-		session.securityName = item->snmpv3_securityname;
-		session.securityNameLen = strlen(session.securityName);
+		session->securityName = item->snmpv3_securityname;
+		session->securityNameLen = strlen(session->securityName);
 
 		/* set the SNMPv3 context if specified */
 		if ('\0' != *item->snmpv3_contextname)
 		{
-			session.contextName = item->snmpv3_contextname;
-			session.contextNameLen = strlen(session.contextName);
+			session->contextName = item->snmpv3_contextname;
+			session->contextNameLen = strlen(session->contextName);
 		}
 
 		/* set the security level to authenticated, but not encrypted */
 		switch (item->snmpv3_securitylevel)
 		{
 			case ITEM_SNMPV3_SECURITYLEVEL_NOAUTHNOPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_NOAUTH;
+				session->securityLevel = SNMP_SEC_LEVEL_NOAUTH;
 				break;
 			case ITEM_SNMPV3_SECURITYLEVEL_AUTHNOPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
+				session->securityLevel = SNMP_SEC_LEVEL_AUTHNOPRIV;
 
 				switch (item->snmpv3_authprotocol)
 				{
 					case ITEM_SNMPV3_AUTHPROTOCOL_MD5:
 						/* set the authentication protocol to MD5 */
-						session.securityAuthProto = usmHMACMD5AuthProtocol;
-						session.securityAuthProtoLen = USM_AUTH_PROTO_MD5_LEN;
+						session->securityAuthProto = usmHMACMD5AuthProtocol;
+						session->securityAuthProtoLen = USM_AUTH_PROTO_MD5_LEN;
 						break;
 					case ITEM_SNMPV3_AUTHPROTOCOL_SHA:
 						/* set the authentication protocol to SHA */
-						session.securityAuthProto = usmHMACSHA1AuthProtocol;
-						session.securityAuthProtoLen = USM_AUTH_PROTO_SHA_LEN;
+						session->securityAuthProto = usmHMACSHA1AuthProtocol;
+						session->securityAuthProtoLen = USM_AUTH_PROTO_SHA_LEN;
 						break;
 					default:
 						zbx_snprintf(error, max_error_len,
@@ -529,12 +738,12 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 						goto end;
 				}
 
-				session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+				session->securityAuthKeyLen = USM_AUTH_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
-						strlen(item->snmpv3_authpassphrase), session.securityAuthKey,
-						&session.securityAuthKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
+						strlen(item->snmpv3_authpassphrase), session->securityAuthKey,
+						&session->securityAuthKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from authentication pass phrase",
 							max_error_len);
@@ -542,19 +751,19 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 				}
 				break;
 			case ITEM_SNMPV3_SECURITYLEVEL_AUTHPRIV:
-				session.securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
+				session->securityLevel = SNMP_SEC_LEVEL_AUTHPRIV;
 
 				switch (item->snmpv3_authprotocol)
 				{
 					case ITEM_SNMPV3_AUTHPROTOCOL_MD5:
 						/* set the authentication protocol to MD5 */
-						session.securityAuthProto = usmHMACMD5AuthProtocol;
-						session.securityAuthProtoLen = USM_AUTH_PROTO_MD5_LEN;
+						session->securityAuthProto = usmHMACMD5AuthProtocol;
+						session->securityAuthProtoLen = USM_AUTH_PROTO_MD5_LEN;
 						break;
 					case ITEM_SNMPV3_AUTHPROTOCOL_SHA:
 						/* set the authentication protocol to SHA */
-						session.securityAuthProto = usmHMACSHA1AuthProtocol;
-						session.securityAuthProtoLen = USM_AUTH_PROTO_SHA_LEN;
+						session->securityAuthProto = usmHMACSHA1AuthProtocol;
+						session->securityAuthProtoLen = USM_AUTH_PROTO_SHA_LEN;
 						break;
 					default:
 						zbx_snprintf(error, max_error_len,
@@ -563,12 +772,12 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 						goto end;
 				}
 
-				session.securityAuthKeyLen = USM_AUTH_KU_LEN;
+				session->securityAuthKeyLen = USM_AUTH_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
-						strlen(item->snmpv3_authpassphrase), session.securityAuthKey,
-						&session.securityAuthKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_authpassphrase,
+						strlen(item->snmpv3_authpassphrase), session->securityAuthKey,
+						&session->securityAuthKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from authentication pass phrase",
 							max_error_len);
@@ -579,13 +788,13 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 				{
 					case ITEM_SNMPV3_PRIVPROTOCOL_DES:
 						/* set the privacy protocol to DES */
-						session.securityPrivProto = usmDESPrivProtocol;
-						session.securityPrivProtoLen = USM_PRIV_PROTO_DES_LEN;
+						session->securityPrivProto = usmDESPrivProtocol;
+						session->securityPrivProtoLen = USM_PRIV_PROTO_DES_LEN;
 						break;
 					case ITEM_SNMPV3_PRIVPROTOCOL_AES:
 						/* set the privacy protocol to AES */
-						session.securityPrivProto = usmAESPrivProtocol;
-						session.securityPrivProtoLen = USM_PRIV_PROTO_AES_LEN;
+						session->securityPrivProto = usmAESPrivProtocol;
+						session->securityPrivProtoLen = USM_PRIV_PROTO_AES_LEN;
 						break;
 					default:
 						zbx_snprintf(error, max_error_len,
@@ -594,12 +803,12 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 						goto end;
 				}
 
-				session.securityPrivKeyLen = USM_PRIV_KU_LEN;
+				session->securityPrivKeyLen = USM_PRIV_KU_LEN;
 
-				if (SNMPERR_SUCCESS != generate_Ku(session.securityAuthProto,
-						session.securityAuthProtoLen, (u_char *)item->snmpv3_privpassphrase,
-						strlen(item->snmpv3_privpassphrase), session.securityPrivKey,
-						&session.securityPrivKeyLen))
+				if (SNMPERR_SUCCESS != generate_Ku(session->securityAuthProto,
+						session->securityAuthProtoLen, (u_char *)item->snmpv3_privpassphrase,
+						strlen(item->snmpv3_privpassphrase), session->securityPrivKey,
+						&session->securityPrivKeyLen))
 				{
 					zbx_strlcpy(error, "Error generating Ku from privacy pass phrase",
 							max_error_len);
@@ -608,7 +817,7 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 				break;
 		}
 
-		zabbix_log(LOG_LEVEL_DEBUG, "SNMPv3 [%s@%s]", session.securityName, session.peername);
+		zabbix_log(LOG_LEVEL_DEBUG, "SNMPv3 [%s@%s]", session->securityName, session->peername);
 	}
 
 #ifdef HAVE_NETSNMP_SESSION_LOCALNAME
@@ -621,10 +830,26 @@ static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *err
 		static char	localname[64];
 
 		zbx_snprintf(localname, sizeof(localname), "%s:0", CONFIG_SOURCE_IP);
-		session.localname = localname;
+		session->localname = localname;
 	}
 #endif
 
+	ret = SUCCEED;
+end:
+	return ret;
+}
+
+static struct snmp_session	*zbx_snmp_open_session(const DC_ITEM *item, char *error, size_t max_error_len)
+{
+	const char		*__function_name = "zbx_snmp_open_session";
+	struct snmp_session	session, *ss = NULL;
+	char			addr[128];
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	if (SUCCEED != zbx_snmp_init_session(item, &session, addr, sizeof(addr), error, max_error_len))
+		goto end;
+
 	SOCK_STARTUP;
 
 	if (NULL == (ss = snmp_open(&session)))
@@ -1236,6 +1461,15 @@ static int	zbx_snmp_walk(struct snmp_session *ss, const DC_ITEM *item, const cha
 
 		if (*max_succeed < num_vars)
 			*max_succeed = num_vars;
+
+		/* The whole response was used, so request more variables next time, but stay below the smallest */
+		/* request size that has failed. The growth rate is the same as in the suggested request size.   */
+
+		if (SNMP_BULK_ENABLED == bulk && 1 == running && num_vars == max_vars && max_vars < *min_fail - 1)
+		{
+			max_vars = MIN(MAX(max_vars * 3 / 2, max_vars + 1), *min_fail - 1);
+			level = 0;
+		}
 next:
 		if (NULL != response)
 			snmp_free_pdu(response);
@@ -1249,6 +1483,120 @@ out:
 	return ret;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_set_response_values                                     *
+ *                                                                            *
+ * Purpose: check that variable bindings of GET response match the request    *
+ *          and store the received values                                     *
+ *                                                                            *
+ * Parameters: response    - [IN] the response PDU                            *
+ *             items       - [IN] the requested items                         *
+ *             results     - [OUT] the item values                            *
+ *             errcodes    - [IN/OUT] the item error codes                    *
+ *             query_and_ignore_type - [IN] see zbx_snmp_get_values()         *
+ *             mapping     - [IN] indexes of items in the request variable    *
+ *                                bindings                                    *
+ *             mapping_num - [IN] the number of variable bindings requested   *
+ *             parsed_oids, parsed_oid_lens - [IN] the requested OIDs         *
+ *             error       - [OUT] the error message                          *
+ *             max_error_len - [IN] the error message buffer size             *
+ *                                                                            *
+ * Return value: SUCCEED      - the response was processed                    *
+ *               FAIL         - the response does not match the request, it   *
+ *                              should be repeated with fewer variables       *
+ *               NOTSUPPORTED - invalid response to a single variable request *
+ *                                                                            *
+ ******************************************************************************/
+static int	zbx_snmp_set_response_values(const struct snmp_pdu *response, const DC_ITEM *items,
+		AGENT_RESULT *results, int *errcodes, const unsigned char *query_and_ignore_type, const int *mapping,
+		int mapping_num, oid parsed_oids[][MAX_OID_LEN], const size_t *parsed_oid_lens, char *error,
+		size_t max_error_len)
+{
+	int			i, j, ret = SUCCEED;
+	struct variable_list	*var;
+
+	for (i = 0, var = response->variables;; i++, var = var->next_variable)
+	{
+		/* check that response variable binding matches the request variable binding */
+
+		if (i == mapping_num)
+		{
+			if (NULL != var)
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+						" too many variable bindings", items[0].host.host);
+
+				if (1 != mapping_num)
+					return FAIL;
+
+				zbx_strlcpy(error, "Invalid SNMP response: too many variable bindings.",
+						max_error_len);
+
+				ret = NOTSUPPORTED;
+			}
+
+			break;
+		}
+
+		if (NULL == var)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+					" too few variable bindings", items[0].host.host);
+
+			if (1 != mapping_num)
+				return FAIL;
+
+			zbx_strlcpy(error, "Invalid SNMP response: too few variable bindings.", max_error_len);
+
+			ret = NOTSUPPORTED;
+			break;
+		}
+
+		j = mapping[i];
+
+		if (parsed_oid_lens[j] != var->name_length ||
+				0 != memcmp(parsed_oids[j], var->name, parsed_oid_lens[j] * sizeof(oid)))
+		{
+			char	sent_oid[ITEM_SNMP_OID_LEN_MAX], received_oid[ITEM_SNMP_OID_LEN_MAX];
+
+			zbx_snmp_dump_oid(sent_oid, sizeof(sent_oid), parsed_oids[j], parsed_oid_lens[j]);
+			zbx_snmp_dump_oid(received_oid, sizeof(received_oid), var->name, var->name_length);
+
+			if (1 != mapping_num)
+			{
+				zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+						" variable bindings that do not match the request:"
+						" sent \"%s\", received \"%s\"",
+						items[0].host.host, sent_oid, received_oid);
+
+				return FAIL;
+			}
+			else
+			{
+				zabbix_log(LOG_LEVEL_DEBUG, "SNMP response from host \"%s\" contains"
+						" variable bindings that do not match the request:"
+						" sent \"%s\", received \"%s\"",
+						items[0].host.host, sent_oid, received_oid);
+			}
+		}
+
+		/* process received data */
+
+		if (NULL != query_and_ignore_type && 1 == query_and_ignore_type[j])
+		{
+			(void)zbx_snmp_set_result(var, ITEM_VALUE_TYPE_STR, 0, &results[j]);
+		}
+		else
+		{
+			errcodes[j] = zbx_snmp_set_result(var, items[j].value_type, items[j].data_type,
+					&results[j]);
+		}
+	}
+
+	return ret;
+}
+
 static int	zbx_snmp_get_values(struct snmp_session *ss, const DC_ITEM *items, char oids[][ITEM_SNMP_OID_LEN_MAX],
 		AGENT_RESULT *results, int *errcodes, unsigned char *query_and_ignore_type, int num, int level,
 		char *error, size_t max_error_len, int *max_succeed, int *min_fail)
@@ -1260,7 +1608,6 @@ static int	zbx_snmp_get_values(struct snmp_session *ss, const DC_ITEM *items, ch
 	oid			parsed_oids[MAX_SNMP_ITEMS][MAX_OID_LEN];
 	size_t			parsed_oid_lens[MAX_SNMP_ITEMS];
 	struct snmp_pdu		*pdu, *response;
-	struct variable_list	*var;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s() num:%d level:%d", __function_name, num, level);
 
@@ -1315,110 +1662,40 @@ retry:
 
 	if (STAT_SUCCESS == status && SNMP_ERR_NOERROR == response->errstat)
 	{
-		for (i = 0, var = response->variables;; i++, var = var->next_variable)
+		if (FAIL == (ret = zbx_snmp_set_response_values(response, items, results, errcodes,
+				query_and_ignore_type, mapping, mapping_num, parsed_oids, parsed_oid_lens, error,
+				max_error_len)))
 		{
-			/* check that response variable binding matches the request variable binding */
+			ret = SUCCEED;
+			goto halve;	/* give device a chance to handle a smaller request */
+		}
 
-			if (i == mapping_num)
-			{
-				if (NULL != var)
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
-							" too many variable bindings", items[0].host.host);
+		if (SUCCEED == ret)
+		{
+			if (*max_succeed < mapping_num)
+				*max_succeed = mapping_num;
+		}
+		else if (1 < mapping_num)
+		{
+			if (*min_fail > mapping_num)
+				*min_fail = mapping_num;
+		}
+	}
+	else if (STAT_SUCCESS == status && SNMP_ERR_NOSUCHNAME == response->errstat && 0 != response->errindex)
+	{
+		/* If a request PDU contains a bad variable, the specified behavior is different between SNMPv1 and */
+		/* later versions. In SNMPv1, the whole PDU is rejected and "response->errindex" is set to indicate */
+		/* the bad variable. In SNMPv2 and later, the SNMP agent processes the PDU by filling values for the */
+		/* known variables and marking unknown variables individually in the variable binding list. However, */
+		/* SNMPv2 allows SNMPv1 behavior, too. So regardless of the SNMP version used, if we get this error, */
+		/* then we fix the PDU by removing the bad variable and retry the request. */
 
-					if (1 != mapping_num)	/* give device a chance to handle a smaller request */
-						goto halve;
+		i = response->errindex - 1;
 
-					zbx_strlcpy(error, "Invalid SNMP response: too many variable bindings.",
-							max_error_len);
-
-					ret = NOTSUPPORTED;
-				}
-
-				break;
-			}
-
-			if (NULL == var)
-			{
-				zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
-						" too few variable bindings", items[0].host.host);
-
-				if (1 != mapping_num)	/* give device a chance to handle a smaller request */
-					goto halve;
-
-				zbx_strlcpy(error, "Invalid SNMP response: too few variable bindings.", max_error_len);
-
-				ret = NOTSUPPORTED;
-				break;
-			}
-
-			j = mapping[i];
-
-			if (parsed_oid_lens[j] != var->name_length ||
-					0 != memcmp(parsed_oids[j], var->name, parsed_oid_lens[j] * sizeof(oid)))
-			{
-				char	sent_oid[ITEM_SNMP_OID_LEN_MAX], received_oid[ITEM_SNMP_OID_LEN_MAX];
-
-				zbx_snmp_dump_oid(sent_oid, sizeof(sent_oid), parsed_oids[j], parsed_oid_lens[j]);
-				zbx_snmp_dump_oid(received_oid, sizeof(received_oid), var->name, var->name_length);
-
-				if (1 != mapping_num)
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
-							" variable bindings that do not match the request:"
-							" sent \"%s\", received \"%s\"",
-							items[0].host.host, sent_oid, received_oid);
-
-					goto halve;	/* give device a chance to handle a smaller request */
-				}
-				else
-				{
-					zabbix_log(LOG_LEVEL_DEBUG, "SNMP response from host \"%s\" contains"
-							" variable bindings that do not match the request:"
-							" sent \"%s\", received \"%s\"",
-							items[0].host.host, sent_oid, received_oid);
-				}
-			}
-
-			/* process received data */
-
-			if (NULL != query_and_ignore_type && 1 == query_and_ignore_type[j])
-			{
-				(void)zbx_snmp_set_result(var, ITEM_VALUE_TYPE_STR, 0, &results[j]);
-			}
-			else
-			{
-				errcodes[j] = zbx_snmp_set_result(var, items[j].value_type, items[j].data_type,
-						&results[j]);
-			}
-		}
-
-		if (SUCCEED == ret)
-		{
-			if (*max_succeed < mapping_num)
-				*max_succeed = mapping_num;
-		}
-		else if (1 < mapping_num)
-		{
-			if (*min_fail > mapping_num)
-				*min_fail = mapping_num;
-		}
-	}
-	else if (STAT_SUCCESS == status && SNMP_ERR_NOSUCHNAME == response->errstat && 0 != response->errindex)
-	{
-		/* If a request PDU contains a bad variable, the specified behavior is different between SNMPv1 and */
-		/* later versions. In SNMPv1, the whole PDU is rejected and "response->errindex" is set to indicate */
-		/* the bad variable. In SNMPv2 and later, the SNMP agent processes the PDU by filling values for the */
-		/* known variables and marking unknown variables individually in the variable binding list. However, */
-		/* SNMPv2 allows SNMPv1 behavior, too. So regardless of the SNMP version used, if we get this error, */
-		/* then we fix the PDU by removing the bad variable and retry the request. */
-
-		i = response->errindex - 1;
-
-		if (0 > i || i >= mapping_num)
-		{
-			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
-					" an out of bounds error index: %ld", items[0].host.host, response->errindex);
+		if (0 > i || i >= mapping_num)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+					" an out of bounds error index: %ld", items[0].host.host, response->errindex);
 
 			zbx_strlcpy(error, "Invalid SNMP response: error index out of bounds.", max_error_len);
 
@@ -1828,30 +2105,78 @@ out:
 	return ret;
 }
 
-static void	zbx_snmp_walk_cache_cb(void *arg, const char *oid, const char *index, const char *value)
+static void	zbx_snmp_walk_index_cb(void *arg, const char *oid, const char *index, const char *value)
 {
-	cache_put_snmp_index((const DC_ITEM *)arg, oid, index, value);
+	zbx_ptr_pair_t	pair;
+
+	pair.first = zbx_strdup(NULL, index);
+	pair.second = zbx_strdup(NULL, value);
+
+	zbx_vector_ptr_pair_append((zbx_vector_ptr_pair_t *)arg, pair);
 }
 
-static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *items, AGENT_RESULT *results,
-		int *errcodes, int num, char *error, size_t max_error_len, int *max_succeed, int *min_fail, int bulk)
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_find_index                                              *
+ *                                                                            *
+ * Purpose: find index of the value in the walked index table                 *
+ *                                                                            *
+ * Comments: the last index wins if several rows have the same value, as it   *
+ *           does in the index cache                                          *
+ *                                                                            *
+ ******************************************************************************/
+static const char	*zbx_snmp_find_index(const zbx_vector_ptr_pair_t *mappings, const char *value)
 {
-	const char	*__function_name = "zbx_snmp_process_dynamic";
+	int	i;
 
-	int		i, j, k, ret;
-	int		to_walk[MAX_SNMP_ITEMS], to_walk_num = 0;
-	int		to_verify[MAX_SNMP_ITEMS], to_verify_num = 0;
-	char		to_verify_oids[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
-	unsigned char	query_and_ignore_type[MAX_SNMP_ITEMS];
-	char		index_oids[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
-	char		index_values[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
-	char		oids_translated[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
-	char		*idx = NULL, *pl;
-	size_t		idx_alloc = 32;
+	for (i = mappings->values_num - 1; 0 <= i; i--)
+	{
+		if (0 == strcmp((const char *)mappings->values[i].second, value))
+			return (const char *)mappings->values[i].first;
+	}
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+	return NULL;
+}
+
+static void	zbx_snmp_mappings_clear(zbx_vector_ptr_pair_t *mappings)
+{
+	int	i;
+
+	for (i = 0; i < mappings->values_num; i++)
+	{
+		zbx_free(mappings->values[i].first);
+		zbx_free(mappings->values[i].second);
+	}
+
+	zbx_vector_ptr_pair_clear(mappings);
+}
+
+static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *items, AGENT_RESULT *results,
+		int *errcodes, int num, char *error, size_t max_error_len, int *max_succeed, int *min_fail, int max_vars,
+		int bulk)
+{
+	const char		*__function_name = "zbx_snmp_process_dynamic";
+
+	int			i, j, k, ret, walked, now, stale_num = 0;
+	int			to_walk[MAX_SNMP_ITEMS], to_walk_num = 0;
+	int			to_verify[MAX_SNMP_ITEMS], to_verify_num = 0;
+	char			to_verify_oids[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
+	unsigned char		query_and_ignore_type[MAX_SNMP_ITEMS];
+	char			index_oids[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
+	char			index_values[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
+	char			oids_translated[MAX_SNMP_ITEMS][ITEM_SNMP_OID_LEN_MAX];
+	char			walk_oid[ITEM_SNMP_OID_LEN_MAX];
+	char			*idx = NULL, *pl;
+	const char		*index;
+	size_t			idx_alloc = 32;
+	zbx_vector_ptr_pair_t	mappings;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() max_vars:%d", __function_name, max_vars);
 
 	idx = zbx_malloc(idx, idx_alloc);
+	zbx_vector_ptr_pair_create(&mappings);
+
+	now = (int)time(NULL);
 
 	/* perform initial item validation */
 
@@ -1884,13 +2209,22 @@ static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *item
 
 		zbx_snmp_translate(oids_translated[i], index_oids[i], sizeof(oids_translated[i]));
 
-		if (SUCCEED == cache_get_snmp_index(&items[i], oids_translated[i], index_values[i], &idx, &idx_alloc))
+		if (SUCCEED == cache_get_snmp_index(&items[i], oids_translated[i], index_values[i], &idx, &idx_alloc,
+				&walked))
 		{
 			zbx_snprintf(to_verify_oids[i], sizeof(to_verify_oids[i]), "%s.%s", oids_translated[i], idx);
 
 			to_verify[to_verify_num++] = i;
 			query_and_ignore_type[i] = 1;
 		}
+		else if (0 != walked && now < walked + ZBX_SNMPIDX_WALK_DELAY)
+		{
+			/* the table has just been walked, possibly by another poller, and the value was not there */
+
+			SET_MSG_RESULT(&results[i], zbx_dsprintf(NULL, "Cannot find index of \"%s\" in \"%s\".",
+					index_values[i], index_oids[i]));
+			errcodes[i] = NOTSUPPORTED;
+		}
 		else
 		{
 			to_walk[to_walk_num++] = i;
@@ -1918,6 +2252,7 @@ static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *item
 			if (NULL == GET_STR_RESULT(&results[j]) || 0 != strcmp(results[j].str, index_values[j]))
 			{
 				to_walk[to_walk_num++] = j;
+				stale_num++;
 			}
 			else
 			{
@@ -1938,90 +2273,76 @@ static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *item
 
 			free_result(&results[j]);
 		}
+
+		cache_stale_snmp_index(stale_num);
 	}
 
-	/* walk OID trees to build index cache for cache misses */
+	/* walk OID trees to build index cache for cache misses, each tree is walked once for all its items */
 
-	if (0 != to_walk_num)
+	for (i = 0; i < to_walk_num; i++)
 	{
-		for (i = 0; i < to_walk_num; i++)
-		{
-			int	errcode;
+		int	errcode;
 
-			j = to_walk[i];
+		if (-1 == (j = to_walk[i]))
+			continue;
 
-			/* see whether this OID tree was already walked for another item */
+		zbx_strlcpy(walk_oid, oids_translated[j], sizeof(walk_oid));
 
-			for (k = 0; k < i; k++)
-			{
-				if (0 == strcmp(oids_translated[to_walk[k]], oids_translated[j]))
-					break;
-			}
+		errcode = zbx_snmp_walk(ss, &items[j], walk_oid, error, max_error_len, max_succeed, min_fail, max_vars,
+				bulk, zbx_snmp_walk_index_cb, (void *)&mappings);
 
-			if (k != i)
-				continue;
+		if (NETWORK_ERROR == errcode)
+		{
+			/* consider a network error as relating to all items passed to */
+			/* this function, including those we did not just try to walk for */
 
-			/* walk */
+			ret = NETWORK_ERROR;
+			goto exit;
+		}
 
-			cache_del_snmp_index_subtree(&items[j], oids_translated[j]);
+		if (SUCCEED == errcode)
+			cache_set_snmp_index_subtree(&items[j], walk_oid, &mappings);
 
-			errcode = zbx_snmp_walk(ss, &items[j], oids_translated[j], error, max_error_len, max_succeed,
-					min_fail, num, bulk, zbx_snmp_walk_cache_cb, (void *)&items[j]);
+		for (k = i; k < to_walk_num; k++)
+		{
+			int	l;
 
-			if (NETWORK_ERROR == errcode)
-			{
-				/* consider a network error as relating to all items passed to */
-				/* this function, including those we did not just try to walk for */
+			if (-1 == (l = to_walk[k]) || 0 != strcmp(oids_translated[l], walk_oid))
+				continue;
 
-				ret = NETWORK_ERROR;
-				goto exit;
-			}
+			to_walk[k] = -1;
 
-			if (CONFIG_ERROR == errcode || NOTSUPPORTED == errcode)
+			if (SUCCEED != errcode)
 			{
 				/* consider a configuration or "not supported" error as */
 				/* relating only to the items we have just tried to walk for */
 
-				for (k = i; k < to_walk_num; k++)
-				{
-					if (0 == strcmp(oids_translated[to_walk[k]], oids_translated[j]))
-					{
-						SET_MSG_RESULT(&results[to_walk[k]], zbx_strdup(NULL, error));
-						errcodes[to_walk[k]] = errcode;
-					}
-				}
+				SET_MSG_RESULT(&results[l], zbx_strdup(NULL, error));
+				errcodes[l] = errcode;
 			}
-		}
-
-		for (i = 0; i < to_walk_num; i++)
-		{
-			j = to_walk[i];
-
-			if (SUCCEED != errcodes[j])
-				continue;
-
-			if (SUCCEED == cache_get_snmp_index(&items[j], oids_translated[j], index_values[j], &idx,
-						&idx_alloc))
+			else if (NULL != (index = zbx_snmp_find_index(&mappings, index_values[l])))
 			{
 				/* ready to construct the final OID with index */
 
-				pl = strchr(items[j].snmp_oid, '[');
+				pl = strchr(items[l].snmp_oid, '[');
 
 				*pl = '\0';
-				zbx_snmp_translate(oids_translated[j], items[j].snmp_oid, sizeof(oids_translated[j]));
+				zbx_snmp_translate(oids_translated[l], items[l].snmp_oid, sizeof(oids_translated[l]));
 				*pl = '[';
 
-				zbx_strlcat(oids_translated[j], ".", sizeof(oids_translated[j]));
-				zbx_strlcat(oids_translated[j], idx, sizeof(oids_translated[j]));
+				zbx_strlcat(oids_translated[l], ".", sizeof(oids_translated[l]));
+				zbx_strlcat(oids_translated[l], index, sizeof(oids_translated[l]));
 			}
 			else
 			{
-				SET_MSG_RESULT(&results[j], zbx_dsprintf(NULL,
+				SET_MSG_RESULT(&results[l], zbx_dsprintf(NULL,
 						"Cannot find index of \"%s\" in \"%s\".",
-						index_values[j], index_oids[j]));
-				errcodes[j] = NOTSUPPORTED;
+						index_values[l], index_oids[l]));
+				errcodes[l] = NOTSUPPORTED;
 			}
 		}
+
+		zbx_snmp_mappings_clear(&mappings);
 	}
 
 	/* query values based on the indices verified and/or determined above */
@@ -2029,6 +2350,8 @@ static int	zbx_snmp_process_dynamic(struct snmp_session *ss, const DC_ITEM *item
 	ret = zbx_snmp_get_values(ss, items, oids_translated, results, errcodes, NULL, num, 0, error, max_error_len,
 			max_succeed, min_fail);
 exit:
+	zbx_snmp_mappings_clear(&mappings);
+	zbx_vector_ptr_pair_destroy(&mappings);
 	zbx_free(idx);
 
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
@@ -2070,6 +2393,589 @@ static int	zbx_snmp_process_standard(struct snmp_session *ss, const DC_ITEM *ite
 	return ret;
 }
 
+/*
+ * Asynchronous SNMP polling
+ * =========================
+ *
+ * Items of several hosts are queried from a single poller at once. Each host gets its own Net-SNMP session
+ * opened with the single session API and has at most one GET request in flight. Responses of all sessions are
+ * waited for with one select() call, so a host that does not respond only delays its own items.
+ *
+ * The requests follow the same adaptive batching as zbx_snmp_get_values(). All items of a host are requested
+ * at once first, on "tooBig", timeout or mismatching response the request is split in halves and then into
+ * single item requests. Pending requests of a host are kept in a stack so that they are sent in the same order
+ * as synchronous recursion would send them.
+ *
+ * Only SNMPv1 and SNMPv2c items with plain OIDs are queried asynchronously. Opening an SNMPv3 session probes
+ * the engine ID synchronously, and dynamic index and discovery items require walks, so these items are still
+ * processed by get_values_snmp().
+ */
+
+typedef struct
+{
+	int	start;
+	int	num;
+	int	level;
+}
+zbx_snmp_async_request_t;
+
+typedef struct
+{
+	const DC_ITEM			*items;
+	AGENT_RESULT			*results;
+	int				*errcodes;
+	int				num;
+
+	/* the first supported item, used as a reference */
+	int				first;
+
+	void				*sessp;
+
+	/* parsed item OIDs, indexed by item */
+	oid				(*parsed_oids)[MAX_OID_LEN];
+	size_t				*parsed_oid_lens;
+
+	/* stack of requests waiting to be sent */
+	zbx_snmp_async_request_t	requests[MAX_SNMP_ITEMS + 1];
+	int				requests_num;
+
+	/* the request in flight */
+	zbx_snmp_async_request_t	request;
+	int				mapping[MAX_SNMP_ITEMS];
+	int				mapping_num;
+
+	/* STAT_* of the request in flight, -1 while waiting for response */
+	int				status;
+	struct snmp_pdu			*response;
+
+	int				max_succeed;
+	int				min_fail;
+
+	/* SUCCEED - the host is being polled or polling succeeded, error code otherwise */
+	int				err;
+	unsigned char			done;
+	char				error[MAX_STRING_LEN];
+}
+zbx_snmp_async_host_t;
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_async_supported                                         *
+ *                                                                            *
+ * Purpose: check if items of a host can be queried asynchronously            *
+ *                                                                            *
+ * Parameters: items    - [IN] the items of a single host interface           *
+ *             errcodes - [IN] the item error codes                           *
+ *             num      - [IN] the number of items                            *
+ *                                                                            *
+ * Return value: SUCCEED - the items can be passed to get_values_snmp_async() *
+ *               FAIL    - the items must be passed to get_values_snmp()      *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_snmp_async_supported(const DC_ITEM *items, const int *errcodes, int num)
+{
+	int	j;
+
+	for (j = 0; j < num; j++)
+	{
+		if (SUCCEED == errcodes[j])
+			break;
+	}
+
+	if (j == num)
+		return FAIL;
+
+	if (ITEM_TYPE_SNMPv1 != items[j].type && ITEM_TYPE_SNMPv2c != items[j].type)
+		return FAIL;
+
+	if (0 != (ZBX_FLAG_DISCOVERY_RULE & items[j].flags) || 0 == strncmp(items[j].snmp_oid, "discovery[", 10))
+		return FAIL;
+
+	if (NULL != strchr(items[j].snmp_oid, '['))
+		return FAIL;
+
+	return SUCCEED;
+}
+
+static int	zbx_snmp_async_cb(int operation, struct snmp_session *sp, int reqid, struct snmp_pdu *pdu, void *magic)
+{
+	zbx_snmp_async_host_t	*host = (zbx_snmp_async_host_t *)magic;
+
+	ZBX_UNUSED(sp);
+	ZBX_UNUSED(reqid);
+
+	if (NETSNMP_CALLBACK_OP_RECEIVED_MESSAGE == operation)
+	{
+		/* the PDU is freed by the library when the callback returns */
+		if (NULL != (host->response = snmp_clone_pdu(pdu)))
+			host->status = STAT_SUCCESS;
+		else
+			host->status = STAT_ERROR;
+	}
+	else if (NETSNMP_CALLBACK_OP_TIMED_OUT == operation)
+		host->status = STAT_TIMEOUT;
+	else
+		host->status = STAT_ERROR;
+
+	return 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_async_fail                                              *
+ *                                                                            *
+ * Purpose: stop polling the host and set error to its remaining items        *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_async_fail(zbx_snmp_async_host_t *host, int err)
+{
+	int	i;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "getting SNMP values failed: %s", host->error);
+
+	for (i = host->first; i < host->num; i++)
+	{
+		if (SUCCEED != host->errcodes[i])
+			continue;
+
+		SET_MSG_RESULT(&host->results[i], zbx_strdup(NULL, host->error));
+		host->errcodes[i] = err;
+	}
+
+	host->err = err;
+	host->done = 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_async_open                                              *
+ *                                                                            *
+ * Purpose: open SNMP session for the host and parse its OIDs                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_async_open(zbx_snmp_async_host_t *host)
+{
+	struct snmp_session	session;
+	char			addr[128], oid_translated[ITEM_SNMP_OID_LEN_MAX];
+	int			i;
+
+	host->max_succeed = 0;
+	host->min_fail = MAX_SNMP_ITEMS + 1;
+	host->status = -1;
+	host->err = SUCCEED;
+
+	for (host->first = 0; host->first < host->num; host->first++)
+	{
+		if (SUCCEED == host->errcodes[host->first])
+			break;
+	}
+
+	if (host->first == host->num)
+	{
+		host->done = 1;
+		return;
+	}
+
+	if (SUCCEED != zbx_snmp_init_session(&host->items[host->first], &session, addr, sizeof(addr), host->error,
+			sizeof(host->error)))
+	{
+		zbx_snmp_async_fail(host, NETWORK_ERROR);
+		return;
+	}
+
+	SOCK_STARTUP;
+
+	if (NULL == (host->sessp = snmp_sess_open(&session)))
+	{
+		SOCK_CLEANUP;
+
+		zbx_strlcpy(host->error, "Cannot open SNMP session", sizeof(host->error));
+		zbx_snmp_async_fail(host, NETWORK_ERROR);
+		return;
+	}
+
+	host->parsed_oids = zbx_malloc(NULL, sizeof(*host->parsed_oids) * host->num);
+	host->parsed_oid_lens = zbx_malloc(NULL, sizeof(size_t) * host->num);
+
+	for (i = host->first; i < host->num; i++)
+	{
+		if (SUCCEED != host->errcodes[i])
+			continue;
+
+		if (0 != num_key_param(host->items[i].snmp_oid))
+		{
+			SET_MSG_RESULT(&host->results[i], zbx_dsprintf(NULL, "OID \"%s\" contains unsupported"
+					" parameters.", host->items[i].snmp_oid));
+			host->errcodes[i] = CONFIG_ERROR;
+			continue;
+		}
+
+		zbx_snmp_translate(oid_translated, host->items[i].snmp_oid, sizeof(oid_translated));
+
+		host->parsed_oid_lens[i] = MAX_OID_LEN;
+
+		if (NULL == snmp_parse_oid(oid_translated, host->parsed_oids[i], &host->parsed_oid_lens[i]))
+		{
+			SET_MSG_RESULT(&host->results[i], zbx_dsprintf(NULL, "snmp_parse_oid(): cannot parse OID"
+					" \"%s\".", oid_translated));
+			host->errcodes[i] = CONFIG_ERROR;
+		}
+	}
+
+	host->requests[0].start = host->first;
+	host->requests[0].num = host->num - host->first;
+	host->requests[0].level = 0;
+	host->requests_num = 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_async_split                                             *
+ *                                                                            *
+ * Purpose: replace the failed request with smaller ones                      *
+ *                                                                            *
+ * Comments: see zbx_snmp_get_values() for the explanation                    *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_async_split(zbx_snmp_async_host_t *host)
+{
+	zbx_snmp_async_request_t	*request = &host->request;
+	int				i;
+
+	if (host->min_fail > host->mapping_num)
+		host->min_fail = host->mapping_num;
+
+	if (0 == request->level)
+	{
+		/* halve the number of items, the first half is popped first */
+
+		host->requests[host->requests_num].start = request->start + request->num / 2;
+		host->requests[host->requests_num].num = request->num - request->num / 2;
+		host->requests[host->requests_num++].level = 1;
+
+		host->requests[host->requests_num].start = request->start;
+		host->requests[host->requests_num].num = request->num / 2;
+		host->requests[host->requests_num++].level = 1;
+	}
+	else if (1 == request->level)
+	{
+		/* resort to querying items one by one */
+
+		for (i = request->start + request->num - 1; i >= request->start; i--)
+		{
+			host->requests[host->requests_num].start = i;
+			host->requests[host->requests_num].num = 1;
+			host->requests[host->requests_num++].level = 2;
+		}
+	}
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_async_send                                              *
+ *                                                                            *
+ * Purpose: send the next pending request of the host                         *
+ *                                                                            *
+ * Comments: The host is marked as done if there are no more requests.        *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_async_send(zbx_snmp_async_host_t *host)
+{
+	struct snmp_session	*ss;
+	struct snmp_pdu		*pdu;
+	int			i;
+
+	ss = snmp_sess_session(host->sessp);
+
+	while (0 < host->requests_num)
+	{
+		host->request = host->requests[--host->requests_num];
+		host->mapping_num = 0;
+
+		if (NULL == (pdu = snmp_pdu_create(SNMP_MSG_GET)))
+		{
+			zbx_strlcpy(host->error, "snmp_pdu_create(): cannot create PDU object.", sizeof(host->error));
+			zbx_snmp_async_fail(host, CONFIG_ERROR);
+			return;
+		}
+
+		for (i = host->request.start; i < host->request.start + host->request.num; i++)
+		{
+			if (SUCCEED != host->errcodes[i])
+				continue;
+
+			if (NULL == snmp_add_null_var(pdu, host->parsed_oids[i], host->parsed_oid_lens[i]))
+			{
+				SET_MSG_RESULT(&host->results[i], zbx_strdup(NULL,
+						"snmp_add_null_var(): cannot add null variable."));
+				host->errcodes[i] = CONFIG_ERROR;
+				continue;
+			}
+
+			host->mapping[host->mapping_num++] = i;
+		}
+
+		if (0 == host->mapping_num)
+		{
+			snmp_free_pdu(pdu);
+			continue;
+		}
+
+		ss->retries = (1 == host->mapping_num && 0 == host->request.level ? 1 : 0);
+		host->status = -1;
+
+		if (0 != snmp_sess_async_send(host->sessp, pdu, zbx_snmp_async_cb, host))
+			return;
+
+		snmp_free_pdu(pdu);
+
+		/* the request is too long to be sent, see zbx_snmp_get_values() */
+		if (1 < host->mapping_num && SNMPERR_TOO_LONG == ss->s_snmp_errno)
+		{
+			zbx_snmp_async_split(host);
+			continue;
+		}
+
+		zbx_snmp_async_fail(host, zbx_get_snmp_response_error(ss, &host->items[host->first].interface,
+				STAT_ERROR, NULL, host->error, sizeof(host->error)));
+		return;
+	}
+
+	host->done = 1;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_snmp_async_process                                           *
+ *                                                                            *
+ * Purpose: process response to the request in flight and send the next one   *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_snmp_async_process(zbx_snmp_async_host_t *host)
+{
+	const char		*__function_name = "zbx_snmp_async_process";
+
+	struct snmp_session	*ss;
+	struct snmp_pdu		*response = host->response;
+	int			i, j, ret, status = host->status;
+
+	ss = snmp_sess_session(host->sessp);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() host:'%s' status:%d s_snmp_errno:%d errstat:%ld mapping_num:%d",
+			__function_name, host->items[host->first].host.host, status, ss->s_snmp_errno,
+			NULL == response ? (long)-1 : response->errstat, host->mapping_num);
+
+	host->response = NULL;
+	host->status = -1;
+
+	if (STAT_SUCCESS == status && SNMP_ERR_NOERROR == response->errstat)
+	{
+		ret = zbx_snmp_set_response_values(response, host->items, host->results, host->errcodes, NULL,
+				host->mapping, host->mapping_num, host->parsed_oids, host->parsed_oid_lens, host->error,
+				sizeof(host->error));
+
+		if (SUCCEED == ret)
+		{
+			if (host->max_succeed < host->mapping_num)
+				host->max_succeed = host->mapping_num;
+		}
+		else if (FAIL == ret)
+		{
+			/* give device a chance to handle a smaller request */
+			zbx_snmp_async_split(host);
+		}
+		else
+		{
+			zbx_snmp_async_fail(host, ret);
+			goto out;
+		}
+	}
+	else if (STAT_SUCCESS == status && SNMP_ERR_NOSUCHNAME == response->errstat && 0 != response->errindex)
+	{
+		/* remove the bad variable and repeat the request, see zbx_snmp_get_values() */
+
+		i = response->errindex - 1;
+
+		if (0 > i || i >= host->mapping_num)
+		{
+			zabbix_log(LOG_LEVEL_WARNING, "SNMP response from host \"%s\" contains"
+					" an out of bounds error index: %ld", host->items[host->first].host.host,
+					response->errindex);
+
+			zbx_strlcpy(host->error, "Invalid SNMP response: error index out of bounds.",
+					sizeof(host->error));
+			zbx_snmp_async_fail(host, NOTSUPPORTED);
+			goto out;
+		}
+
+		j = host->mapping[i];
+
+		host->errcodes[j] = zbx_get_snmp_response_error(ss, &host->items[host->first].interface, status,
+				response, host->error, sizeof(host->error));
+		SET_MSG_RESULT(&host->results[j], zbx_strdup(NULL, host->error));
+		*host->error = '\0';
+
+		if (1 < host->mapping_num)
+			host->requests[host->requests_num++] = host->request;
+	}
+	else if (1 < host->mapping_num &&
+			((STAT_SUCCESS == status && SNMP_ERR_TOOBIG == response->errstat) || STAT_TIMEOUT == status ||
+			(STAT_ERROR == status && SNMPERR_TOO_LONG == ss->s_snmp_errno)))
+	{
+		zbx_snmp_async_split(host);
+	}
+	else
+	{
+		zbx_snmp_async_fail(host, zbx_get_snmp_response_error(ss, &host->items[host->first].interface, status,
+				response, host->error, sizeof(host->error)));
+		goto out;
+	}
+
+	zbx_snmp_async_send(host);
+out:
+	if (NULL != response)
+		snmp_free_pdu(response);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() done:%d", __function_name, (int)host->done);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_values_snmp_async                                            *
+ *                                                                            *
+ * Purpose: retrieve values of SNMP items of several hosts concurrently       *
+ *                                                                            *
+ * Parameters: batches     - [IN/OUT] items of each host interface            *
+ *             batches_num - [IN] the number of batches                       *
+ *                                                                            *
+ * Comments: Batches must be accepted by zbx_snmp_async_supported().          *
+ *                                                                            *
+ ******************************************************************************/
+void	get_values_snmp_async(zbx_snmp_batch_t *batches, int batches_num)
+{
+	const char		*__function_name = "get_values_snmp_async";
+
+	zbx_snmp_async_host_t	*hosts, *host;
+	int			i, active = 0, numfds, block, ret;
+	fd_set			fdset;
+	struct timeval		timeout;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s() hosts:%d", __function_name, batches_num);
+
+	hosts = zbx_malloc(NULL, sizeof(zbx_snmp_async_host_t) * batches_num);
+	memset(hosts, 0, sizeof(zbx_snmp_async_host_t) * batches_num);
+
+	for (i = 0; i < batches_num; i++)
+	{
+		host = &hosts[i];
+
+		host->items = batches[i].items;
+		host->results = batches[i].results;
+		host->errcodes = batches[i].errcodes;
+		host->num = batches[i].num;
+
+		zbx_snmp_async_open(host);
+
+		if (0 == host->done)
+			zbx_snmp_async_send(host);
+
+		if (0 == host->done)
+			active++;
+	}
+
+	while (0 < active)
+	{
+		numfds = 0;
+		block = 1;
+		timeout.tv_sec = 1;
+		timeout.tv_usec = 0;
+		FD_ZERO(&fdset);
+
+		for (i = 0; i < batches_num; i++)
+		{
+			if (0 == hosts[i].done)
+				snmp_sess_select_info(hosts[i].sessp, &numfds, &fdset, &timeout, &block);
+		}
+
+		if (1 == block)
+		{
+			/* no session has requests with a timeout, should not happen */
+			timeout.tv_sec = 1;
+			timeout.tv_usec = 0;
+		}
+
+		if (-1 == (ret = select(numfds, &fdset, NULL, NULL, &timeout)))
+		{
+			if (EINTR == errno)
+				continue;
+
+			zabbix_log(LOG_LEVEL_WARNING, "%s() select() failed: %s", __function_name,
+					zbx_strerror(errno));
+
+			for (i = 0; i < batches_num; i++)
+			{
+				if (0 != hosts[i].done)
+					continue;
+
+				zbx_snprintf(hosts[i].error, sizeof(hosts[i].error), "Cannot wait for SNMP response:"
+						" %s", zbx_strerror(errno));
+				zbx_snmp_async_fail(&hosts[i], NETWORK_ERROR);
+			}
+
+			break;
+		}
+
+		for (i = 0; i < batches_num; i++)
+		{
+			host = &hosts[i];
+
+			if (0 != host->done)
+				continue;
+
+			if (0 < ret)
+				snmp_sess_read(host->sessp, &fdset);
+
+			if (-1 == host->status)
+				snmp_sess_timeout(host->sessp);
+
+			if (-1 == host->status)
+				continue;
+
+			zbx_snmp_async_process(host);
+
+			if (0 != host->done)
+				active--;
+		}
+	}
+
+	for (i = 0; i < batches_num; i++)
+	{
+		host = &hosts[i];
+
+		if (NULL != host->sessp)
+		{
+			snmp_sess_close(host->sessp);
+			SOCK_CLEANUP;
+		}
+
+		zbx_free(host->parsed_oids);
+		zbx_free(host->parsed_oid_lens);
+
+		if (host->first == host->num)
+			continue;
+
+		if (SUCCEED == host->err && (0 != host->max_succeed || MAX_SNMP_ITEMS + 1 != host->min_fail))
+		{
+			DCconfig_update_interface_snmp_stats(host->items[host->first].interface.interfaceid,
+					host->max_succeed, host->min_fail);
+		}
+	}
+
+	zbx_free(hosts);
+
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+}
+
 int	get_value_snmp(const DC_ITEM *item, AGENT_RESULT *result)
 {
 	int	errcode = SUCCEED;
@@ -2117,10 +3023,12 @@ void	get_values_snmp(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes,
 	}
 	else if (NULL != strchr(items[j].snmp_oid, '['))
 	{
-		(void)DCconfig_get_suggested_snmp_vars(items[j].interface.interfaceid, &bulk);
+		int	max_vars;
+
+		max_vars = DCconfig_get_suggested_snmp_vars(items[j].interface.interfaceid, &bulk);
 
 		err = zbx_snmp_process_dynamic(ss, items + j, results + j, errcodes + j, num - j, error, sizeof(error),
-				&max_succeed, &min_fail, bulk);
+				&max_succeed, &min_fail, max_vars, bulk);
 	}
 	else
 	{
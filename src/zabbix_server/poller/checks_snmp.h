@@ -29,9 +29,37 @@ extern char	*CONFIG_SOURCE_IP;
 extern int	CONFIG_TIMEOUT;
 
 #ifdef HAVE_NETSNMP
+typedef struct
+{
+	DC_ITEM		*items;
+	AGENT_RESULT	*results;
+	int		*errcodes;
+	int		num;
+}
+zbx_snmp_batch_t;
+
+/* the dynamic index cache statistics */
+typedef struct
+{
+	zbx_uint64_t	hits;
+	zbx_uint64_t	misses;
+	zbx_uint64_t	stale;		/* cached indexes that failed verification on the device */
+	zbx_uint64_t	walks;
+
+	zbx_uint64_t	total_size;
+	zbx_uint64_t	free_size;
+}
+zbx_snmpidx_stats_t;
+
+void	zbx_snmpidx_init(void);
+void	zbx_snmpidx_destroy(void);
+int	zbx_snmpidx_get_statistics(zbx_snmpidx_stats_t *stats);
+
 void	zbx_init_snmp(void);
 int	get_value_snmp(const DC_ITEM *item, AGENT_RESULT *result);
 void	get_values_snmp(const DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num);
+int	zbx_snmp_async_supported(const DC_ITEM *items, const int *errcodes, int num);
+void	get_values_snmp_async(zbx_snmp_batch_t *batches, int batches_num);
 #endif
 
 #endif
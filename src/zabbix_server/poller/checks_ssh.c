@@ -25,9 +25,36 @@
 
 #include "comms.h"
 #include "log.h"
+#include "zbxself.h"
 
 #define SSH_RUN_KEY	"ssh.run"
 
+/* maximum number of idle sessions kept by a poller */
+#define SSH_SESSIONS_MAX	64
+
+extern unsigned char	process_type;
+extern int		CONFIG_REMOTE_SESSION_IDLE_TIMEOUT;
+
+/* authenticated SSH connection that can be reused by checks with the same connection parameters */
+typedef struct
+{
+	zbx_socket_t	s;
+	LIBSSH2_SESSION	*session;
+	char		*addr;
+	unsigned short	port;
+	unsigned char	authtype;
+	char		*username;
+	char		*password;
+	char		*publickey;
+	char		*privatekey;
+	time_t		lastused;
+}
+zbx_ssh_session_t;
+
+/* idle sessions of this poller, the most recently used session is the last */
+static zbx_vector_ptr_t	ssh_sessions;
+static int		ssh_sessions_created = 0;
+
 static const char	*password;
 
 static void	kbd_callback(const char *name, int name_len, const char *instruction,
@@ -76,22 +103,45 @@ static int	waitsocket(int socket_fd, LIBSSH2_SESSION *session)
 	return rc;
 }
 
-/* example ssh.run["ls /"] */
-static int	ssh_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
+static void	ssh_session_free(zbx_ssh_session_t *sess)
 {
-	const char	*__function_name = "ssh_run";
-	zbx_socket_t	s;
-	LIBSSH2_SESSION	*session;
-	LIBSSH2_CHANNEL	*channel;
-	int		auth_pw = 0, rc, ret = NOTSUPPORTED,
-			exitcode, bytecount = 0;
-	char		buffer[MAX_BUFFER_LEN], buf[16], *userauthlist,
-			*publickey = NULL, *privatekey = NULL, *ssherr, *output;
-	size_t		sz;
+	libssh2_session_disconnect(sess->session, "Normal Shutdown");
+	libssh2_session_free(sess->session);
+	zbx_tcp_close(&sess->s);
+
+	zbx_free(sess->addr);
+	zbx_free(sess->username);
+	zbx_free(sess->password);
+	zbx_free(sess->publickey);
+	zbx_free(sess->privatekey);
+	zbx_free(sess);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ssh_session_connect                                              *
+ *                                                                            *
+ * Purpose: connects to the SSH server of the item and authenticates          *
+ *                                                                            *
+ * Parameters: item   - [IN] the SSH item                                     *
+ *             result - [OUT] error message if connection failed              *
+ *                                                                            *
+ * Return value: the authenticated session or NULL                            *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_ssh_session_t	*ssh_session_connect(DC_ITEM *item, AGENT_RESULT *result)
+{
+	const char		*__function_name = "ssh_session_connect";
+	zbx_ssh_session_t	*sess;
+	LIBSSH2_SESSION		*session;
+	int			auth_pw = 0, rc, ret = FAIL;
+	char			*userauthlist, *publickey = NULL, *privatekey = NULL, *ssherr;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
-	if (FAIL == zbx_tcp_connect(&s, CONFIG_SOURCE_IP, item->interface.addr, item->interface.port, 0,
+	sess = (zbx_ssh_session_t *)zbx_malloc(NULL, sizeof(zbx_ssh_session_t));
+
+	if (FAIL == zbx_tcp_connect(&sess->s, CONFIG_SOURCE_IP, item->interface.addr, item->interface.port, 0,
 			ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot connect to SSH server: %s", zbx_socket_strerror()));
@@ -110,7 +160,7 @@ static int	ssh_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
 
 	/* Create a session instance and start it up. This will trade welcome */
 	/* banners, exchange keys, and setup crypto, compression, and MAC layers */
-	if (0 != libssh2_session_startup(session, s.socket))
+	if (0 != libssh2_session_startup(session, sess->s.socket))
 	{
 		libssh2_session_last_error(session, &ssherr, NULL, 0);
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot establish SSH session: %s", ssherr));
@@ -227,19 +277,242 @@ static int	ssh_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
 			break;
 	}
 
+	sess->session = session;
+	sess->addr = zbx_strdup(NULL, item->interface.addr);
+	sess->port = item->interface.port;
+	sess->authtype = item->authtype;
+	sess->username = zbx_strdup(NULL, item->username);
+	sess->password = zbx_strdup(NULL, item->password);
+	sess->publickey = zbx_strdup(NULL, item->publickey);
+	sess->privatekey = zbx_strdup(NULL, item->privatekey);
+
+	ret = SUCCEED;
+	goto close;
+
+session_close:
+	libssh2_session_disconnect(session, "Normal Shutdown");
+
+session_free:
+	libssh2_session_free(session);
+
+tcp_close:
+	zbx_tcp_close(&sess->s);
+
+close:
+	if (SUCCEED != ret)
+		zbx_free(sess);
+
+	zbx_free(publickey);
+	zbx_free(privatekey);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
+
+	return sess;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ssh_session_idle                                                 *
+ *                                                                            *
+ * Purpose: checks that the server has not closed an idle session             *
+ *                                                                            *
+ * Return value: SUCCEED - the connection is open                             *
+ *               FAIL    - the server closed the connection                   *
+ *                                                                            *
+ * Comments: Pending data (e.g. keepalive messages) is left for libssh2.      *
+ *                                                                            *
+ ******************************************************************************/
+static int	ssh_session_idle(zbx_ssh_session_t *sess)
+{
+	struct timeval	tv = {0, 0};
+	fd_set		fd;
+	char		c;
+
+	FD_ZERO(&fd);
+	FD_SET(sess->s.socket, &fd);
+
+	if (0 == select(sess->s.socket + 1, &fd, NULL, NULL, &tv))
+		return SUCCEED;
+
+	if (0 < recv(sess->s.socket, &c, 1, MSG_PEEK))
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ssh_session_get                                                  *
+ *                                                                            *
+ * Purpose: takes an idle session with the connection parameters of the item  *
+ *          or connects a new one                                             *
+ *                                                                            *
+ * Parameters: item   - [IN] the SSH item                                     *
+ *             result - [OUT] error message if connection failed              *
+ *             reused - [OUT] SUCCEED if the session was idle                 *
+ *                                                                            *
+ * Return value: the authenticated session or NULL                            *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_ssh_session_t	*ssh_session_get(DC_ITEM *item, AGENT_RESULT *result, int *reused)
+{
+	zbx_ssh_session_t	*sess;
+	int			i;
+
+	if (0 == ssh_sessions_created)
+	{
+		zbx_vector_ptr_create(&ssh_sessions);
+		ssh_sessions_created = 1;
+	}
+
+	zbx_ssh_sessions_expire();
+
+	*reused = FAIL;
+
+	for (i = ssh_sessions.values_num - 1; 0 <= i; i--)
+	{
+		sess = (zbx_ssh_session_t *)ssh_sessions.values[i];
+
+		if (sess->port != item->interface.port || sess->authtype != item->authtype ||
+				0 != strcmp(sess->addr, item->interface.addr) ||
+				0 != strcmp(sess->username, item->username) ||
+				0 != strcmp(sess->password, item->password) ||
+				0 != strcmp(sess->publickey, item->publickey) ||
+				0 != strcmp(sess->privatekey, item->privatekey))
+		{
+			continue;
+		}
+
+		zbx_vector_ptr_remove(&ssh_sessions, i);
+
+		if (SUCCEED == ssh_session_idle(sess))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "reusing SSH session to [%s]:%hu", sess->addr, sess->port);
+			*reused = SUCCEED;
+			return sess;
+		}
+
+		ssh_session_free(sess);
+	}
+
+	return ssh_session_connect(item, result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: ssh_session_release                                              *
+ *                                                                            *
+ * Purpose: keeps the session for the next checks or closes it                *
+ *                                                                            *
+ * Comments: Sessions are kept by pollers only, other processes run SSH       *
+ *           commands too rarely to benefit from it.                          *
+ *                                                                            *
+ ******************************************************************************/
+static void	ssh_session_release(zbx_ssh_session_t *sess)
+{
+	if (0 == CONFIG_REMOTE_SESSION_IDLE_TIMEOUT || (ZBX_PROCESS_TYPE_POLLER != process_type &&
+			ZBX_PROCESS_TYPE_UNREACHABLE != process_type))
+	{
+		ssh_session_free(sess);
+		return;
+	}
+
+	if (SSH_SESSIONS_MAX <= ssh_sessions.values_num)
+	{
+		ssh_session_free((zbx_ssh_session_t *)ssh_sessions.values[0]);
+		zbx_vector_ptr_remove(&ssh_sessions, 0);
+	}
+
+	sess->lastused = time(NULL);
+	zbx_vector_ptr_append(&ssh_sessions, sess);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_ssh_sessions_expire                                          *
+ *                                                                            *
+ * Purpose: closes sessions that have been idle for too long                  *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_ssh_sessions_expire(void)
+{
+	time_t	now;
+	int	i;
+
+	if (0 == ssh_sessions_created)
+		return;
+
+	now = time(NULL);
+
+	/* sessions are appended when released, so the expired ones are at the beginning */
+	for (i = 0; i < ssh_sessions.values_num; i++)
+	{
+		zbx_ssh_session_t	*sess = (zbx_ssh_session_t *)ssh_sessions.values[i];
+
+		if (now - sess->lastused < CONFIG_REMOTE_SESSION_IDLE_TIMEOUT)
+			break;
+
+		ssh_session_free(sess);
+	}
+
+	if (0 != i)
+	{
+		memmove(ssh_sessions.values, ssh_sessions.values + i, sizeof(void *) * (ssh_sessions.values_num - i));
+		ssh_sessions.values_num -= i;
+	}
+}
+
+static LIBSSH2_CHANNEL	*ssh_channel_open(zbx_ssh_session_t *sess)
+{
+	LIBSSH2_CHANNEL	*channel;
+
 	/* exec non-blocking on the remove host */
-	while (NULL == (channel = libssh2_channel_open_session(session)))
+	while (NULL == (channel = libssh2_channel_open_session(sess->session)))
 	{
-		switch (libssh2_session_last_error(session, NULL, NULL, 0))
+		switch (libssh2_session_last_error(sess->session, NULL, NULL, 0))
 		{
 			/* marked for non-blocking I/O but the call would block. */
 			case LIBSSH2_ERROR_EAGAIN:
-				waitsocket(s.socket, session);
+				waitsocket(sess->s.socket, sess->session);
 				continue;
 			default:
-				SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot establish generic session channel"));
-				goto session_close;
+				return NULL;
+		}
+	}
+
+	return channel;
+}
+
+/* example ssh.run["ls /"] */
+static int	ssh_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
+{
+	const char		*__function_name = "ssh_run";
+	zbx_ssh_session_t	*sess;
+	LIBSSH2_CHANNEL		*channel;
+	int			rc, ret = NOTSUPPORTED, exitcode, bytecount = 0, reused;
+	char			buffer[MAX_BUFFER_LEN], buf[16], *ssherr, *output;
+	size_t			sz;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	/* a reused session may have been dropped by the server without closing the connection */
+	for (;;)
+	{
+		if (NULL == (sess = ssh_session_get(item, result, &reused)))
+			goto close;
+
+		if (NULL != (channel = ssh_channel_open(sess)))
+			break;
+
+		ssh_session_free(sess);
+
+		if (SUCCEED != reused)
+		{
+			SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot establish generic session channel"));
+			goto close;
 		}
+
+		zabbix_log(LOG_LEVEL_DEBUG, "%s() cannot open channel on reused session, reconnecting",
+				__function_name);
 	}
 
 	dos2unix(item->params);	/* CR+LF (Windows) => LF (Unix) */
@@ -249,7 +522,7 @@ static int	ssh_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
 		switch (rc)
 		{
 			case LIBSSH2_ERROR_EAGAIN:
-				waitsocket(s.socket, session);
+				waitsocket(sess->s.socket, sess->session);
 				continue;
 			default:
 				SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot request a shell"));
@@ -280,7 +553,7 @@ static int	ssh_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
 		 * this condition
 		 */
 		if (LIBSSH2_ERROR_EAGAIN == rc)
-			waitsocket(s.socket, session);
+			waitsocket(sess->s.socket, sess->session);
 		else if (rc < 0)
 		{
 			SET_MSG_RESULT(result, zbx_strdup(NULL, "Cannot read data from SSH server"));
@@ -303,11 +576,11 @@ channel_close:
 	/* close an active data channel */
 	exitcode = 127;
 	while (LIBSSH2_ERROR_EAGAIN == (rc = libssh2_channel_close(channel)))
-		waitsocket(s.socket, session);
+		waitsocket(sess->s.socket, sess->session);
 
 	if (0 != rc)
 	{
-		libssh2_session_last_error(session, &ssherr, NULL, 0);
+		libssh2_session_last_error(sess->session, &ssherr, NULL, 0);
 		zabbix_log(LOG_LEVEL_WARNING, "%s() cannot close generic session channel: %s", __function_name, ssherr);
 	}
 	else
@@ -318,18 +591,12 @@ channel_close:
 	libssh2_channel_free(channel);
 	channel = NULL;
 
-session_close:
-	libssh2_session_disconnect(session, "Normal Shutdown");
-
-session_free:
-	libssh2_session_free(session);
-
-tcp_close:
-	zbx_tcp_close(&s);
-
+	/* the session is only kept if the channel was closed cleanly */
+	if (0 == rc)
+		ssh_session_release(sess);
+	else
+		ssh_session_free(sess);
 close:
-	zbx_free(publickey);
-	zbx_free(privatekey);
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
 
 	return ret;
@@ -30,6 +30,7 @@ extern char	*CONFIG_SOURCE_IP;
 extern char	*CONFIG_SSH_KEY_LOCATION;
 
 int	get_value_ssh(DC_ITEM *item, AGENT_RESULT *result);
+void	zbx_ssh_sessions_expire(void);
 #endif	/* HAVE_SSH2 */
 
 #endif
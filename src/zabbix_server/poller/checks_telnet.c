@@ -22,41 +22,248 @@
 #include "telnet.h"
 #include "comms.h"
 #include "log.h"
+#include "zbxself.h"
 
 #define TELNET_RUN_KEY	"telnet.run"
 
-/*
- * Example: telnet.run["ls /"]
- */
-static int	telnet_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
+/* maximum number of idle sessions kept by a poller */
+#define TELNET_SESSIONS_MAX	64
+
+extern unsigned char	process_type;
+extern int		CONFIG_REMOTE_SESSION_IDLE_TIMEOUT;
+extern int		CONFIG_TELNET_SESSION_REUSE;
+
+/* logged in TELNET connection that can be reused by checks with the same connection parameters */
+typedef struct
 {
-	const char	*__function_name = "telnet_run";
 	zbx_socket_t	s;
-	int		ret = NOTSUPPORTED, flags;
+	char		prompt_char;
+	char		*addr;
+	unsigned short	port;
+	char		*username;
+	char		*password;
+	time_t		lastused;
+}
+zbx_telnet_session_t;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+/* idle sessions of this poller, the most recently used session is the last */
+static zbx_vector_ptr_t	telnet_sessions;
+static int		telnet_sessions_created = 0;
+
+static void	telnet_session_free(zbx_telnet_session_t *sess)
+{
+	zbx_tcp_close(&sess->s);
+	zbx_free(sess->addr);
+	zbx_free(sess->username);
+	zbx_free(sess->password);
+	zbx_free(sess);
+}
 
-	if (FAIL == zbx_tcp_connect(&s, CONFIG_SOURCE_IP, item->interface.addr, item->interface.port, 0,
+static zbx_telnet_session_t	*telnet_session_connect(DC_ITEM *item, AGENT_RESULT *result)
+{
+	zbx_telnet_session_t	*sess;
+	int			flags;
+
+	sess = (zbx_telnet_session_t *)zbx_malloc(NULL, sizeof(zbx_telnet_session_t));
+
+	if (FAIL == zbx_tcp_connect(&sess->s, CONFIG_SOURCE_IP, item->interface.addr, item->interface.port, 0,
 			ZBX_TCP_SEC_UNENCRYPTED, NULL, NULL))
 	{
 		SET_MSG_RESULT(result, zbx_dsprintf(NULL, "Cannot connect to TELNET server: %s",
 				zbx_socket_strerror()));
-		goto close;
+		zbx_free(sess);
+		return NULL;
 	}
 
-	flags = fcntl(s.socket, F_GETFL);
+	flags = fcntl(sess->s.socket, F_GETFL);
 	if (0 == (flags & O_NONBLOCK))
-		fcntl(s.socket, F_SETFL, flags | O_NONBLOCK);
+		fcntl(sess->s.socket, F_SETFL, flags | O_NONBLOCK);
+
+	sess->prompt_char = '\0';
+
+	if (FAIL == telnet_login(sess->s.socket, item->username, item->password, &sess->prompt_char, result))
+	{
+		zbx_tcp_close(&sess->s);
+		zbx_free(sess);
+		return NULL;
+	}
+
+	sess->addr = zbx_strdup(NULL, item->interface.addr);
+	sess->port = item->interface.port;
+	sess->username = zbx_strdup(NULL, item->username);
+	sess->password = zbx_strdup(NULL, item->password);
+
+	return sess;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: telnet_session_idle                                              *
+ *                                                                            *
+ * Purpose: checks that nothing was received on an idle session               *
+ *                                                                            *
+ * Return value: SUCCEED - the session can be reused                          *
+ *               FAIL    - the connection was closed or the server sent       *
+ *                         something (e.g. an idle logout message) that would *
+ *                         mix with the output of the next command            *
+ *                                                                            *
+ ******************************************************************************/
+static int	telnet_session_idle(zbx_telnet_session_t *sess)
+{
+	struct timeval	tv = {0, 0};
+	fd_set		fd;
+
+	FD_ZERO(&fd);
+	FD_SET(sess->s.socket, &fd);
+
+	if (0 == select(sess->s.socket + 1, &fd, NULL, NULL, &tv))
+		return SUCCEED;
+
+	return FAIL;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: telnet_session_get                                               *
+ *                                                                            *
+ * Purpose: takes an idle session with the connection parameters of the item  *
+ *          or logs in a new one                                              *
+ *                                                                            *
+ * Parameters: item   - [IN] the TELNET item                                  *
+ *             result - [OUT] error message if login failed                   *
+ *                                                                            *
+ * Return value: the logged in session or NULL                                *
+ *                                                                            *
+ ******************************************************************************/
+static zbx_telnet_session_t	*telnet_session_get(DC_ITEM *item, AGENT_RESULT *result)
+{
+	zbx_telnet_session_t	*sess;
+	int			i;
+
+	if (0 == telnet_sessions_created)
+	{
+		zbx_vector_ptr_create(&telnet_sessions);
+		telnet_sessions_created = 1;
+	}
+
+	zbx_telnet_sessions_expire();
+
+	for (i = telnet_sessions.values_num - 1; 0 <= i; i--)
+	{
+		sess = (zbx_telnet_session_t *)telnet_sessions.values[i];
+
+		if (sess->port != item->interface.port || 0 != strcmp(sess->addr, item->interface.addr) ||
+				0 != strcmp(sess->username, item->username) ||
+				0 != strcmp(sess->password, item->password))
+		{
+			continue;
+		}
+
+		zbx_vector_ptr_remove(&telnet_sessions, i);
+
+		if (SUCCEED == telnet_session_idle(sess))
+		{
+			zabbix_log(LOG_LEVEL_DEBUG, "reusing TELNET session to [%s]:%hu", sess->addr, sess->port);
+			return sess;
+		}
+
+		telnet_session_free(sess);
+	}
+
+	return telnet_session_connect(item, result);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: telnet_session_release                                           *
+ *                                                                            *
+ * Purpose: keeps the session for the next checks or closes it                *
+ *                                                                            *
+ * Comments: Sessions are kept by pollers only, other processes run TELNET    *
+ *           commands too rarely to benefit from it. Reuse is disabled by     *
+ *           default, because the commands of different items run in the      *
+ *           same shell and see the shell state changed by each other.        *
+ *                                                                            *
+ ******************************************************************************/
+static void	telnet_session_release(zbx_telnet_session_t *sess)
+{
+	if (0 == CONFIG_TELNET_SESSION_REUSE || 0 == CONFIG_REMOTE_SESSION_IDLE_TIMEOUT ||
+			(ZBX_PROCESS_TYPE_POLLER != process_type && ZBX_PROCESS_TYPE_UNREACHABLE != process_type))
+	{
+		telnet_session_free(sess);
+		return;
+	}
+
+	if (TELNET_SESSIONS_MAX <= telnet_sessions.values_num)
+	{
+		telnet_session_free((zbx_telnet_session_t *)telnet_sessions.values[0]);
+		zbx_vector_ptr_remove(&telnet_sessions, 0);
+	}
+
+	sess->lastused = time(NULL);
+	zbx_vector_ptr_append(&telnet_sessions, sess);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_telnet_sessions_expire                                       *
+ *                                                                            *
+ * Purpose: closes sessions that have been idle for too long                  *
+ *                                                                            *
+ ******************************************************************************/
+void	zbx_telnet_sessions_expire(void)
+{
+	time_t	now;
+	int	i;
+
+	if (0 == telnet_sessions_created)
+		return;
+
+	now = time(NULL);
+
+	/* sessions are appended when released, so the expired ones are at the beginning */
+	for (i = 0; i < telnet_sessions.values_num; i++)
+	{
+		zbx_telnet_session_t	*sess = (zbx_telnet_session_t *)telnet_sessions.values[i];
 
-	if (FAIL == telnet_login(s.socket, item->username, item->password, result))
-		goto tcp_close;
+		if (now - sess->lastused < CONFIG_REMOTE_SESSION_IDLE_TIMEOUT)
+			break;
+
+		telnet_session_free(sess);
+	}
+
+	if (0 != i)
+	{
+		memmove(telnet_sessions.values, telnet_sessions.values + i,
+				sizeof(void *) * (telnet_sessions.values_num - i));
+		telnet_sessions.values_num -= i;
+	}
+}
+
+/*
+ * Example: telnet.run["ls /"]
+ */
+static int	telnet_run(DC_ITEM *item, AGENT_RESULT *result, const char *encoding)
+{
+	const char		*__function_name = "telnet_run";
+	zbx_telnet_session_t	*sess;
+	int			ret = NOTSUPPORTED;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	if (NULL == (sess = telnet_session_get(item, result)))
+		goto close;
+
+	/* the shell state after a failed command is unknown, such sessions are not reused */
+	if (FAIL == telnet_execute(sess->s.socket, item->params, sess->prompt_char, result, encoding))
+	{
+		telnet_session_free(sess);
+		goto close;
+	}
 
-	if (FAIL == telnet_execute(s.socket, item->params, result, encoding))
-		goto tcp_close;
+	telnet_session_release(sess);
 
 	ret = SUCCEED;
-tcp_close:
-	zbx_tcp_close(&s);
 close:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%s", __function_name, zbx_result_string(ret));
 
@@ -27,5 +27,6 @@
 extern char	*CONFIG_SOURCE_IP;
 
 int	get_value_telnet(DC_ITEM *item, AGENT_RESULT *result);
+void	zbx_telnet_sessions_expire(void);
 
 #endif
@@ -46,6 +46,7 @@
 
 extern unsigned char	process_type, program_type;
 extern int		server_num, process_num;
+extern int		CONFIG_SNMP_ASYNC_HOSTS;
 
 /******************************************************************************
  *                                                                            *
@@ -353,42 +354,21 @@ static int	get_value(DC_ITEM *item, AGENT_RESULT *result, zbx_vector_ptr_t *add_
 
 /******************************************************************************
  *                                                                            *
- * Function: get_values                                                       *
- *                                                                            *
- * Purpose: retrieve values of metrics from monitored hosts                   *
+ * Function: prepare_items                                                    *
  *                                                                            *
- * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ * Purpose: expand macros in the item parameters                              *
  *                                                                            *
- * Return value: number of items processed                                    *
- *                                                                            *
- * Author: Alexei Vladishev                                                   *
- *                                                                            *
- * Comments: processes single item at a time except for Java, SNMP items,     *
- *           see DCconfig_get_poller_items()                                  *
+ * Parameters: items    - [IN/OUT] the items                                  *
+ *             results  - [OUT] the item results                              *
+ *             errcodes - [OUT] the item error codes                          *
+ *             num      - [IN] the number of items                            *
  *                                                                            *
  ******************************************************************************/
-static int	get_values(unsigned char poller_type, int *nextcheck)
+static void	prepare_items(DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num)
 {
-	const char		*__function_name = "get_values";
-	DC_ITEM			items[MAX_POLLER_ITEMS];
-	AGENT_RESULT		results[MAX_POLLER_ITEMS];
-	int			errcodes[MAX_POLLER_ITEMS];
-	zbx_timespec_t		timespec;
-	char			*port = NULL, error[ITEM_ERROR_LEN_MAX];
-	int			i, num, last_available = HOST_AVAILABLE_UNKNOWN;
-	zbx_vector_ptr_t	add_results;
-
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
-
-	num = DCconfig_get_poller_items(poller_type, items);
+	char	*port = NULL, error[ITEM_ERROR_LEN_MAX];
+	int	i;
 
-	if (0 == num)
-	{
-		*nextcheck = DCconfig_get_poller_nextcheck(poller_type);
-		goto exit;
-	}
-
-	/* prepare items */
 	for (i = 0; i < num; i++)
 	{
 		init_result(&results[i]);
@@ -484,16 +464,32 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 	}
 
 	zbx_free(port);
+}
 
-	zbx_vector_ptr_create(&add_results);
-
-	/* retrieve item values */
+/******************************************************************************
+ *                                                                            *
+ * Function: retrieve_values                                                  *
+ *                                                                            *
+ * Purpose: retrieve values of the items from monitored host                  *
+ *                                                                            *
+ * Parameters: items       - [IN] the items                                   *
+ *             results     - [OUT] the item results                           *
+ *             errcodes    - [IN/OUT] the item error codes                    *
+ *             num         - [IN] the number of items                         *
+ *             add_results - [OUT] additional results (vmware.eventlog)       *
+ *                                                                            *
+ ******************************************************************************/
+static void	retrieve_values(DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num,
+		zbx_vector_ptr_t *add_results)
+{
 	if (SUCCEED == is_snmp_type(items[0].type))
 	{
 #ifdef HAVE_NETSNMP
 		/* SNMP checks use their own timeouts */
 		get_values_snmp(items, results, errcodes, num);
 #else
+		int	i;
+
 		for (i = 0; i < num; i++)
 		{
 			if (SUCCEED != errcodes[i])
@@ -513,14 +509,35 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 	else if (1 == num)
 	{
 		if (SUCCEED == errcodes[0])
-			errcodes[0] = get_value(&items[0], &results[0], &add_results);
+			errcodes[0] = get_value(&items[0], &results[0], add_results);
 	}
 	else
 		THIS_SHOULD_NEVER_HAPPEN;
+}
 
-	zbx_timespec(&timespec);
+/******************************************************************************
+ *                                                                            *
+ * Function: process_values                                                   *
+ *                                                                            *
+ * Purpose: update host availability, add the item values to history cache    *
+ *          and return the items to poller queue                              *
+ *                                                                            *
+ * Parameters: items       - [IN] the items of a single host                  *
+ *             results     - [IN] the item results                            *
+ *             errcodes    - [IN] the item error codes                        *
+ *             num         - [IN] the number of items                         *
+ *             add_results - [IN] additional results (vmware.eventlog)        *
+ *             timespec    - [IN] the value timestamp                         *
+ *             poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             nextcheck   - [OUT] the next scheduled check                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	process_values(DC_ITEM *items, AGENT_RESULT *results, int *errcodes, int num,
+		const zbx_vector_ptr_t *add_results, zbx_timespec_t *timespec, unsigned char poller_type,
+		int *nextcheck)
+{
+	int	i, last_available = HOST_AVAILABLE_UNKNOWN;
 
-	/* process item values */
 	for (i = 0; i < num; i++)
 	{
 		zbx_uint64_t	lastlogsize, *plastlogsize = NULL;
@@ -532,7 +549,7 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 			case AGENT_ERROR:
 				if (HOST_AVAILABLE_TRUE != last_available)
 				{
-					activate_host(&items[i], &timespec);
+					activate_host(&items[i], timespec);
 					last_available = HOST_AVAILABLE_TRUE;
 				}
 				break;
@@ -541,7 +558,7 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 			case TIMEOUT_ERROR:
 				if (HOST_AVAILABLE_FALSE != last_available)
 				{
-					deactivate_host(&items[i], &timespec, results[i].msg);
+					deactivate_host(&items[i], timespec, results[i].msg);
 					last_available = HOST_AVAILABLE_FALSE;
 				}
 				break;
@@ -563,22 +580,22 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 			if (0 != ISSET_TEXT(&results[i]))
 				zbx_rtrim(results[i].text, ZBX_WHITESPACE);
 
-			if (0 == add_results.values_num)
+			if (0 == add_results->values_num)
 			{
 				items[i].state = ITEM_STATE_NORMAL;
 				dc_add_history(items[i].itemid, items[i].value_type, items[i].flags, &results[i],
-						&timespec, items[i].state, NULL);
+						timespec, items[i].state, NULL);
 			}
 			else
 			{
 				/* vmware.eventlog item returns vector of AGENT_RESULT representing events */
 
 				int		j;
-				zbx_timespec_t	ts_tmp = timespec;
+				zbx_timespec_t	ts_tmp = *timespec;
 
-				for (j = 0; j < add_results.values_num; j++)
+				for (j = 0; j < add_results->values_num; j++)
 				{
-					AGENT_RESULT	*add_result = add_results.values[j];
+					AGENT_RESULT	*add_result = add_results->values[j];
 
 					if (ISSET_MSG(add_result))
 					{
@@ -611,11 +628,11 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 		else if (NOTSUPPORTED == errcodes[i] || AGENT_ERROR == errcodes[i] || CONFIG_ERROR == errcodes[i])
 		{
 			items[i].state = ITEM_STATE_NOTSUPPORTED;
-			dc_add_history(items[i].itemid, items[i].value_type, items[i].flags, NULL, &timespec,
+			dc_add_history(items[i].itemid, items[i].value_type, items[i].flags, NULL, timespec,
 					items[i].state, results[i].msg);
 		}
 
-		DCpoller_requeue_items(&items[i].itemid, &items[i].state, &timespec.sec, plastlogsize, NULL,
+		DCpoller_requeue_items(&items[i].itemid, &items[i].state, &timespec->sec, plastlogsize, NULL,
 				&errcodes[i], 1, poller_type, nextcheck);
 
 		zbx_free(items[i].key);
@@ -649,11 +666,183 @@ static int	get_values(unsigned char poller_type, int *nextcheck)
 		free_result(&results[i]);
 	}
 
+	DCconfig_clean_items(items, NULL, num);
+}
+
+#ifdef HAVE_NETSNMP
+/******************************************************************************
+ *                                                                            *
+ * Function: get_values_snmp_hosts                                            *
+ *                                                                            *
+ * Purpose: retrieve SNMP values of several hosts asynchronously              *
+ *                                                                            *
+ * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *             items       - [IN/OUT] the prepared items of the first host    *
+ *             results     - [OUT] the item results of the first host         *
+ *             errcodes    - [IN/OUT] the item error codes of the first host  *
+ *             num         - [IN] the number of items of the first host       *
+ *             nextcheck   - [OUT] the next scheduled check                   *
+ *                                                                            *
+ * Return value: number of items processed                                    *
+ *                                                                            *
+ * Comments: Takes items of up to SNMPAsyncHosts hosts from the poller queue  *
+ *           and polls them at once. Items of the host that cannot be polled  *
+ *           asynchronously stop the collection and are polled after the      *
+ *           others, in a regular way.                                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_values_snmp_hosts(unsigned char poller_type, DC_ITEM *items, AGENT_RESULT *results,
+		int *errcodes, int num, int *nextcheck)
+{
+	const char		*__function_name = "get_values_snmp_hosts";
+
+	zbx_snmp_batch_t	*batches, *batch, last = {NULL, NULL, NULL, 0};
+	int			i, batches_num = 1, total = num;
+	DC_ITEM			*batch_items;
+	zbx_timespec_t		timespec;
+	zbx_vector_ptr_t	add_results;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	batches = zbx_malloc(NULL, sizeof(zbx_snmp_batch_t) * CONFIG_SNMP_ASYNC_HOSTS);
+
+	batches[0].items = items;
+	batches[0].results = results;
+	batches[0].errcodes = errcodes;
+	batches[0].num = num;
+
+	while (batches_num < CONFIG_SNMP_ASYNC_HOSTS)
+	{
+		batch_items = zbx_malloc(NULL, sizeof(DC_ITEM) * MAX_POLLER_ITEMS);
+
+		if (0 == (num = DCconfig_get_poller_items(poller_type, batch_items)))
+		{
+			zbx_free(batch_items);
+			break;
+		}
+
+		batch = &batches[batches_num];
+		batch->items = zbx_realloc(batch_items, sizeof(DC_ITEM) * num);
+		batch->results = zbx_malloc(NULL, sizeof(AGENT_RESULT) * num);
+		batch->errcodes = zbx_malloc(NULL, sizeof(int) * num);
+		batch->num = num;
+		total += num;
+
+		prepare_items(batch->items, batch->results, batch->errcodes, num);
+
+		if (SUCCEED != zbx_snmp_async_supported(batch->items, batch->errcodes, num))
+		{
+			last = *batch;
+			break;
+		}
+
+		batches_num++;
+	}
+
+	get_values_snmp_async(batches, batches_num);
+
+	zbx_timespec(&timespec);
+
+	zbx_vector_ptr_create(&add_results);
+
+	for (i = 0; i < batches_num; i++)
+	{
+		batch = &batches[i];
+
+		process_values(batch->items, batch->results, batch->errcodes, batch->num, &add_results,
+				&timespec, poller_type, nextcheck);
+
+		if (0 == i)
+			continue;
+
+		zbx_free(batch->items);
+		zbx_free(batch->results);
+		zbx_free(batch->errcodes);
+	}
+
+	if (0 != last.num)
+	{
+		retrieve_values(last.items, last.results, last.errcodes, last.num, &add_results);
+
+		zbx_timespec(&timespec);
+
+		process_values(last.items, last.results, last.errcodes, last.num, &add_results,
+				&timespec, poller_type, nextcheck);
+
+		zbx_free(last.items);
+		zbx_free(last.results);
+		zbx_free(last.errcodes);
+	}
+
 	zbx_vector_ptr_clear_ext(&add_results, (zbx_mem_free_func_t)free_result_ptr);
 	zbx_vector_ptr_destroy(&add_results);
 
-	DCconfig_clean_items(items, NULL, num);
+	zbx_free(batches);
 
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s() hosts:%d items:%d", __function_name, batches_num, total);
+
+	return total;
+}
+#endif
+
+/******************************************************************************
+ *                                                                            *
+ * Function: get_values                                                       *
+ *                                                                            *
+ * Purpose: retrieve values of metrics from monitored hosts                   *
+ *                                                                            *
+ * Parameters: poller_type - [IN] poller type (ZBX_POLLER_TYPE_...)           *
+ *                                                                            *
+ * Return value: number of items processed                                    *
+ *                                                                            *
+ * Author: Alexei Vladishev                                                   *
+ *                                                                            *
+ * Comments: processes single item at a time except for Java, SNMP items,     *
+ *           see DCconfig_get_poller_items()                                  *
+ *                                                                            *
+ ******************************************************************************/
+static int	get_values(unsigned char poller_type, int *nextcheck)
+{
+	const char		*__function_name = "get_values";
+	DC_ITEM			items[MAX_POLLER_ITEMS];
+	AGENT_RESULT		results[MAX_POLLER_ITEMS];
+	int			errcodes[MAX_POLLER_ITEMS];
+	zbx_timespec_t		timespec;
+	int			num;
+	zbx_vector_ptr_t	add_results;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	num = DCconfig_get_poller_items(poller_type, items);
+
+	if (0 == num)
+	{
+		*nextcheck = DCconfig_get_poller_nextcheck(poller_type);
+		goto exit;
+	}
+
+	prepare_items(items, results, errcodes, num);
+
+#ifdef HAVE_NETSNMP
+	if (0 != CONFIG_SNMP_ASYNC_HOSTS && SUCCEED == zbx_snmp_async_supported(items, errcodes, num))
+	{
+		num = get_values_snmp_hosts(poller_type, items, results, errcodes, num, nextcheck);
+		goto flush;
+	}
+#endif
+	zbx_vector_ptr_create(&add_results);
+
+	retrieve_values(items, results, errcodes, num, &add_results);
+
+	zbx_timespec(&timespec);
+
+	process_values(items, results, errcodes, num, &add_results, &timespec, poller_type, nextcheck);
+
+	zbx_vector_ptr_clear_ext(&add_results, (zbx_mem_free_func_t)free_result_ptr);
+	zbx_vector_ptr_destroy(&add_results);
+#ifdef HAVE_NETSNMP
+flush:
+#endif
 	dc_flush_history();
 exit:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%d", __function_name, num);
@@ -714,6 +903,16 @@ ZBX_THREAD_ENTRY(poller_thread, args)
 			zbx_delete_inactive_ipmi_hosts(last_ipmi_host_check);
 		}
 #endif
+		if (ZBX_POLLER_TYPE_NORMAL == poller_type || ZBX_POLLER_TYPE_UNREACHABLE == poller_type)
+		{
+#ifdef HAVE_UNIXODBC
+			zbx_odbc_pool_expire();
+#endif
+#ifdef HAVE_SSH2
+			zbx_ssh_sessions_expire();
+#endif
+			zbx_telnet_sessions_expire();
+		}
 		sleeptime = calculate_sleeptime(nextcheck, POLLER_DELAY);
 
 		if (0 != sleeptime || STAT_INTERVAL <= time(NULL) - last_stat_time)
@@ -0,0 +1,94 @@
+/*
+** Zabbix
+** Copyright (C) 2001-2017 Zabbix SIA
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program; if not, write to the Free Software
+** Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+**/
+
+#include "common.h"
+
+#include "log.h"
+#include "daemon.h"
+#include "zbxself.h"
+
+#include "dbcache.h"
+#include "preprocessor.h"
+
+extern unsigned char	process_type, program_type;
+extern int		server_num, process_num;
+
+/* the maximum time to wait for new values after the preprocessing queue was emptied, in seconds, */
+/* the worker is woken up earlier when values are queued                                          */
+#define ZBX_PREPROCESSOR_WAIT	1
+
+/******************************************************************************
+ *                                                                            *
+ * Function: preprocessor_thread                                              *
+ *                                                                            *
+ * Purpose: applies delta and multiplier to the values of the items routed to *
+ *          this worker and passes them to history syncers                    *
+ *                                                                            *
+ * Comments: never returns                                                    *
+ *                                                                            *
+ ******************************************************************************/
+ZBX_THREAD_ENTRY(preprocessor_thread, args)
+{
+	int		values_num, left_num = 0, total_num = 0;
+	double		sec, total_sec = 0.0;
+	time_t		last_stat_time;
+
+	process_type = ((zbx_thread_args_t *)args)->process_type;
+	server_num = ((zbx_thread_args_t *)args)->server_num;
+	process_num = ((zbx_thread_args_t *)args)->process_num;
+
+	zabbix_log(LOG_LEVEL_INFORMATION, "%s #%d started [%s #%d]", get_program_type_string(program_type),
+			server_num, get_process_type_string(process_type), process_num);
+
+#define STAT_INTERVAL	5	/* if a process is busy and does not sleep then update status not faster than */
+				/* once in STAT_INTERVAL seconds */
+
+	zbx_setproctitle("%s #%d started", get_process_type_string(process_type), process_num);
+	last_stat_time = time(NULL);
+
+	for (;;)
+	{
+		zbx_handle_log();
+
+		sec = zbx_time();
+		left_num = DCpreprocess_history(process_num - 1, &values_num);
+		total_num += values_num;
+		total_sec += zbx_time() - sec;
+
+		if (STAT_INTERVAL <= time(NULL) - last_stat_time)
+		{
+			zbx_setproctitle("%s #%d [preprocessed %d values in " ZBX_FS_DBL " sec, %d values queued]",
+					get_process_type_string(process_type), process_num, total_num, total_sec,
+					left_num);
+
+			total_num = 0;
+			total_sec = 0.0;
+			last_stat_time = time(NULL);
+		}
+
+		if (0 == left_num)
+		{
+			update_selfmon_counter(ZBX_PROCESS_STATE_IDLE);
+			DCpreprocess_wait(process_num - 1, ZBX_PREPROCESSOR_WAIT);
+			update_selfmon_counter(ZBX_PROCESS_STATE_BUSY);
+		}
+	}
+
+#undef STAT_INTERVAL
+}
@@ -33,6 +33,7 @@
 
 extern unsigned char	process_type, program_type;
 extern int		server_num, process_num;
+extern int		CONFIG_PROXYPOLLER_CONCURRENCY;
 
 static int	connect_to_proxy(DC_PROXY *proxy, zbx_socket_t *sock, int timeout)
 {
@@ -160,265 +161,952 @@ static int	get_data_from_proxy(DC_PROXY *proxy, const char *request, char **data
 	return ret;
 }
 
+/* maximum number of history, discovery or auto registration batches pulled from a proxy in one go, */
+/* the rest of its backlog is pulled after the other proxies waiting for the poller                    */
+#define ZBX_PROXY_BATCHES_MAX	10
+
+/* how long a poller keeps taking more proxies before returning to its main loop, in seconds */
+#define ZBX_PROXYPOLLER_ROUND_TIME	5
+
+#define ZBX_PROXY_HEADER_LEN	(ZBX_TCP_HEADER_LEN + sizeof(zbx_uint64_t))
+
+typedef enum
+{
+	ZBX_PROXY_STEP_CONFIG_DIGEST = 0,
+	ZBX_PROXY_STEP_CONFIG,
+	ZBX_PROXY_STEP_HOST_AVAILABILITY,
+	ZBX_PROXY_STEP_HISTORY,
+	ZBX_PROXY_STEP_DISCOVERY,
+	ZBX_PROXY_STEP_AUTOREG,
+	ZBX_PROXY_STEP_DONE
+}
+zbx_proxy_step_t;
+
+/* state of the request being exchanged with a proxy */
+typedef enum
+{
+	ZBX_PROXY_EXCHANGE_NONE = 0,
+	ZBX_PROXY_EXCHANGE_CONNECTING,
+	ZBX_PROXY_EXCHANGE_SENDING,
+	ZBX_PROXY_EXCHANGE_RECEIVING,
+	ZBX_PROXY_EXCHANGE_RESPONDING
+}
+zbx_proxy_exchange_t;
+
+typedef struct
+{
+	DC_PROXY		proxy;
+	zbx_proxy_step_t	step;
+	zbx_proxy_exchange_t	exchange;
+	int			fd;
+	double			deadline;
+	zbx_timespec_t		ts;		/* when the connection of the current request was established */
+	char			*out;		/* the request or response being sent */
+	size_t			out_len;
+	size_t			out_offset;
+	char			*in;		/* the message being received */
+	size_t			in_alloc;
+	size_t			in_offset;
+	size_t			in_len;		/* the expected message length, 0 until the header is received */
+	char			*data;		/* received data, processed while the next request is in flight */
+	zbx_proxy_step_t	data_step;
+	zbx_timespec_t		data_ts;
+	int			batches;	/* batches pulled in the current step */
+	char			*config_digest;	/* digests of proxy configuration copy */
+	unsigned char		config_delta;	/* only configuration changes were sent */
+	time_t			last_access;
+	unsigned char		update_nextcheck;
+}
+zbx_proxy_poll_t;
+
+static const char	*proxy_step_string(zbx_proxy_step_t step)
+{
+	switch (step)
+	{
+		case ZBX_PROXY_STEP_CONFIG_DIGEST:
+			return "configuration digest";
+		case ZBX_PROXY_STEP_CONFIG:
+			return "configuration";
+		case ZBX_PROXY_STEP_HOST_AVAILABILITY:
+			return "host availability";
+		case ZBX_PROXY_STEP_HISTORY:
+			return "history";
+		case ZBX_PROXY_STEP_DISCOVERY:
+			return "discovery";
+		case ZBX_PROXY_STEP_AUTOREG:
+			return "auto registration";
+		default:
+			return "unknown";
+	}
+}
+
+static const char	*proxy_step_request(zbx_proxy_step_t step)
+{
+	switch (step)
+	{
+		case ZBX_PROXY_STEP_CONFIG_DIGEST:
+			return ZBX_PROTO_VALUE_PROXY_CONFIG_DIGEST;
+		case ZBX_PROXY_STEP_HOST_AVAILABILITY:
+			return ZBX_PROTO_VALUE_HOST_AVAILABILITY;
+		case ZBX_PROXY_STEP_HISTORY:
+			return ZBX_PROTO_VALUE_HISTORY_DATA;
+		case ZBX_PROXY_STEP_DISCOVERY:
+			return ZBX_PROTO_VALUE_DISCOVERY_DATA;
+		case ZBX_PROXY_STEP_AUTOREG:
+			return ZBX_PROTO_VALUE_AUTO_REGISTRATION_DATA;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+			return "";
+	}
+}
+
+static void	proxy_poll_close(zbx_proxy_poll_t *poll)
+{
+	if (-1 != poll->fd)
+	{
+		close(poll->fd);
+		poll->fd = -1;
+	}
+
+	poll->exchange = ZBX_PROXY_EXCHANGE_NONE;
+	zbx_free(poll->out);
+}
+
 /******************************************************************************
  *                                                                            *
- * Function: process_proxy                                                    *
+ * Function: proxy_poll_message                                               *
  *                                                                            *
- * Purpose: retrieve values of metrics from monitored hosts                   *
+ * Purpose: prepares a message with Zabbix protocol header to be sent         *
  *                                                                            *
- * Parameters:                                                                *
+ ******************************************************************************/
+static void	proxy_poll_message(zbx_proxy_poll_t *poll, const char *data)
+{
+	size_t		len;
+	zbx_uint64_t	len64_le;
+
+	len = strlen(data);
+	len64_le = zbx_htole_uint64((zbx_uint64_t)len);
+
+	poll->out_len = ZBX_TCP_HEADER_LEN + sizeof(len64_le) + len;
+	poll->out = (char *)zbx_realloc(poll->out, poll->out_len);
+	poll->out_offset = 0;
+
+	memcpy(poll->out, ZBX_TCP_HEADER, ZBX_TCP_HEADER_LEN);
+	memcpy(poll->out + ZBX_TCP_HEADER_LEN, &len64_le, sizeof(len64_le));
+	memcpy(poll->out + ZBX_TCP_HEADER_LEN + sizeof(len64_le), data, len);
+}
+
+/******************************************************************************
  *                                                                            *
- * Return value:                                                              *
+ * Function: proxy_poll_connect                                               *
  *                                                                            *
- * Author: Alexei Vladishev                                                   *
+ * Purpose: starts non-blocking connection to the proxy                       *
  *                                                                            *
- * Comments:                                                                  *
+ * Return value: SUCCEED - the connection is in progress                      *
+ *               FAIL    - the connection failed, the error is logged         *
  *                                                                            *
  ******************************************************************************/
-static int	process_proxy(void)
+static int	proxy_poll_connect(zbx_proxy_poll_t *poll)
 {
-	const char		*__function_name = "process_proxy";
-	DC_PROXY		proxy;
-	int			num, i, ret;
-	struct zbx_json		j;
-	struct zbx_json_parse	jp, jp_data;
-	zbx_socket_t		s;
-	char			*answer = NULL, *port = NULL, *error = NULL;
-	time_t			now, last_access;
-	unsigned char		update_nextcheck;
-	zbx_timespec_t		ts;
+	struct addrinfo	hints, *ai = NULL, *ai_bind = NULL;
+	char		service[8];
+	const char	*error = NULL;
+	int		rc;
 
-	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = PF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
 
-	if (0 == (num = DCconfig_get_proxypoller_hosts(&proxy, 1)))
-		goto exit;
+	zbx_snprintf(service, sizeof(service), "%hu", poll->proxy.port);
 
-	now = time(NULL);
+	if (0 != (rc = getaddrinfo(poll->proxy.addr, service, &hints, &ai)))
+	{
+		error = gai_strerror(rc);
+		goto out;
+	}
 
-	zbx_json_init(&j, 512 * 1024);
+	if (-1 == (poll->fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol)))
+	{
+		error = zbx_strerror(errno);
+		goto out;
+	}
+
+	fcntl(poll->fd, F_SETFD, FD_CLOEXEC);
 
-	for (i = 0; i < num; i++)
+	if (FD_SETSIZE <= poll->fd)
 	{
-		update_nextcheck = 0;
-		last_access = 0;
+		error = "too many open files";
+		goto out;
+	}
 
-		if (proxy.proxy_config_nextcheck <= now)
-			update_nextcheck |= ZBX_PROXY_CONFIG_NEXTCHECK;
-		if (proxy.proxy_data_nextcheck <= now)
-			update_nextcheck |= ZBX_PROXY_DATA_NEXTCHECK;
+	if (-1 == fcntl(poll->fd, F_SETFL, O_NONBLOCK | fcntl(poll->fd, F_GETFL)))
+	{
+		error = zbx_strerror(errno);
+		goto out;
+	}
 
-		proxy.addr = proxy.addr_orig;
+	if (NULL != CONFIG_SOURCE_IP)
+	{
+		hints.ai_family = ai->ai_family;
 
-		port = zbx_strdup(port, proxy.port_orig);
-		substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-				&port, MACRO_TYPE_COMMON, NULL, 0);
-		if (FAIL == is_ushort(port, &proxy.port))
+		if (0 != getaddrinfo(CONFIG_SOURCE_IP, NULL, &hints, &ai_bind) ||
+				0 != bind(poll->fd, ai_bind->ai_addr, ai_bind->ai_addrlen))
 		{
-			zabbix_log(LOG_LEVEL_ERR, "invalid proxy \"%s\" port: \"%s\"", proxy.host, port);
-			goto network_error;
+			error = "cannot bind to source address";
+			goto out;
 		}
+	}
+
+	if (0 != connect(poll->fd, ai->ai_addr, ai->ai_addrlen) && EINPROGRESS != errno)
+		error = zbx_strerror(errno);
+out:
+	if (NULL != ai_bind)
+		freeaddrinfo(ai_bind);
+
+	if (NULL != ai)
+		freeaddrinfo(ai);
+
+	if (NULL != error)
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot connect to proxy \"%s\": %s", poll->proxy.host, error);
+		proxy_poll_close(poll);
+
+		return FAIL;
+	}
+
+	poll->exchange = ZBX_PROXY_EXCHANGE_CONNECTING;
+	poll->deadline = zbx_time() + CONFIG_TRAPPER_TIMEOUT;
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_process_data                                          *
+ *                                                                            *
+ * Purpose: processes the data received from proxy                            *
+ *                                                                            *
+ * Return value: SUCCEED - the data was processed                             *
+ *               FAIL    - the proxy returned invalid data                    *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_poll_process_data(zbx_proxy_poll_t *poll)
+{
+	struct zbx_json_parse	jp;
+	char			*error = NULL;
+	int			ret = FAIL;
+
+	if (NULL == poll->data)
+		return SUCCEED;
+
+	zbx_json_open(poll->data, &jp);
+
+	switch (poll->data_step)
+	{
+		case ZBX_PROXY_STEP_HOST_AVAILABILITY:
+			ret = process_host_availability(&jp, &error);
+			break;
+		case ZBX_PROXY_STEP_HISTORY:
+			ret = process_hist_data(NULL, &jp, poll->proxy.hostid, &poll->data_ts, &error);
+			break;
+		case ZBX_PROXY_STEP_DISCOVERY:
+			ret = process_dhis_data(&jp, &error);
+			break;
+		case ZBX_PROXY_STEP_AUTOREG:
+			ret = process_areg_data(&jp, poll->proxy.hostid, &error);
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+	}
+
+	if (SUCCEED != ret)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid %s data: %s", poll->proxy.host,
+				poll->proxy.addr, proxy_step_string(poll->data_step), error);
+		zbx_free(error);
+	}
+
+	zbx_free(poll->data);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_config_data                                           *
+ *                                                                            *
+ * Purpose: prepares configuration data for the proxy                         *
+ *                                                                            *
+ * Comments: Only the changes are sent if the proxy reported digests of its   *
+ *           configuration copy, the whole configuration otherwise.           *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_poll_config_data(zbx_proxy_poll_t *poll, struct zbx_json *j)
+{
+	struct zbx_json_parse	jp, jp_digest, *pjp_digest = NULL;
+	char			*error = NULL;
+	int			ret;
 
-		if (proxy.proxy_config_nextcheck <= now)
+	if (NULL != poll->config_digest && SUCCEED == zbx_json_open(poll->config_digest, &jp) &&
+			SUCCEED == zbx_json_brackets_by_name(&jp, ZBX_PROTO_TAG_CONFIG_DIGEST, &jp_digest))
+	{
+		pjp_digest = &jp_digest;
+	}
+
+	poll->config_delta = (NULL != pjp_digest ? 1 : 0);
+
+	zbx_json_init(j, 512 * 1024);
+
+	zbx_json_addstring(j, ZBX_PROTO_TAG_REQUEST, ZBX_PROTO_VALUE_PROXY_CONFIG, ZBX_JSON_TYPE_STRING);
+	zbx_json_addobject(j, ZBX_PROTO_TAG_DATA);
+
+	if (SUCCEED != (ret = get_proxyconfig_data(poll->proxy.hostid, pjp_digest, j, &error)))
+	{
+		zabbix_log(LOG_LEVEL_ERR, "cannot collect configuration data for proxy \"%s\": %s",
+				poll->proxy.host, error);
+		zbx_free(error);
+		zbx_json_free(j);
+	}
+	else
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "sending configuration %s to proxy \"%s\" at \"%s\", datalen "
+				ZBX_FS_SIZE_T, 0 != poll->config_delta ? "changes" : "data", poll->proxy.host,
+				poll->proxy.addr, (zbx_fs_size_t)j->buffer_size);
+	}
+
+	zbx_free(poll->config_digest);
+
+	return ret;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_next                                                  *
+ *                                                                            *
+ * Purpose: starts the next request to the proxy                              *
+ *                                                                            *
+ * Comments: Requests to proxies with encrypted connections are exchanged     *
+ *           synchronously later, in proxy_poll_exchange_tls().               *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_poll_next(zbx_proxy_poll_t *poll, zbx_proxy_step_t step)
+{
+	struct zbx_json	j;
+
+	if (step != poll->step)
+		poll->batches = 0;
+
+	poll->step = step;
+
+	if (ZBX_PROXY_STEP_DONE == step || ZBX_TCP_SEC_UNENCRYPTED != poll->proxy.tls_connect)
+		return;
+
+	if (ZBX_PROXY_STEP_CONFIG == step)
+	{
+		if (SUCCEED != proxy_poll_config_data(poll, &j))
 		{
-			zbx_json_clean(&j);
+			poll->step = ZBX_PROXY_STEP_DONE;
+			return;
+		}
+	}
+	else
+	{
+		zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+		zbx_json_addstring(&j, "request", proxy_step_request(step), ZBX_JSON_TYPE_STRING);
+	}
 
-			zbx_json_addstring(&j, ZBX_PROTO_TAG_REQUEST,
-					ZBX_PROTO_VALUE_PROXY_CONFIG, ZBX_JSON_TYPE_STRING);
-			zbx_json_addobject(&j, ZBX_PROTO_TAG_DATA);
+	proxy_poll_message(poll, j.buffer);
+	zbx_json_free(&j);
 
-			if (SUCCEED != (ret = get_proxyconfig_data(proxy.hostid, &j, &error)))
-			{
-				zabbix_log(LOG_LEVEL_ERR, "cannot collect configuration data for proxy \"%s\": %s",
-						proxy.host, error);
+	poll->in_offset = 0;
+	poll->in_len = 0;
 
-				goto network_error;
-			}
+	if (SUCCEED != proxy_poll_connect(poll))
+		poll->step = ZBX_PROXY_STEP_DONE;
+}
 
-			if (SUCCEED == (ret = connect_to_proxy(&proxy, &s, CONFIG_TRAPPER_TIMEOUT)))
-			{
-				zabbix_log(LOG_LEVEL_WARNING, "sending configuration data to proxy \"%s\" at \"%s\","
-						" datalen " ZBX_FS_SIZE_T,
-						proxy.host, s.peer, (zbx_fs_size_t)j.buffer_size);
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_received                                              *
+ *                                                                            *
+ * Purpose: checks the data received from proxy and starts the next request   *
+ *                                                                            *
+ * Parameters: poll - [IN] the proxy poll                                     *
+ *             data - [IN] the received data, the ownership is taken          *
+ *                                                                            *
+ * Comments: The data of a batch is processed while the request for the next  *
+ *           batch is sent and the proxy prepares it.                         *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_poll_received(zbx_proxy_poll_t *poll, char *data)
+{
+	struct zbx_json_parse	jp, jp_data;
+	zbx_proxy_step_t	step = poll->step, next_step;
 
-				if (SUCCEED == (ret = send_data_to_proxy(&proxy, &s, j.buffer)))
-				{
-					if (SUCCEED != (ret = zbx_recv_response(&s, 0, &error)))
-					{
-						zabbix_log(LOG_LEVEL_WARNING, "cannot send configuration data to proxy"
-								" \"%s\" at \"%s\": %s", proxy.host, s.peer, error);
-					}
-				}
+	/* the whole configuration is sent if the digest is not valid */
+	if (ZBX_PROXY_STEP_CONFIG_DIGEST == step)
+	{
+		poll->last_access = time(NULL);
+		poll->config_digest = data;
+		proxy_poll_next(poll, ZBX_PROXY_STEP_CONFIG);
+		return;
+	}
 
-				disconnect_proxy(&s);
-			}
+	if ('\0' == *data)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no %s data: check allowed connection"
+				" types and access rights", poll->proxy.host, poll->proxy.addr,
+				proxy_step_string(step));
+		goto fail;
+	}
+
+	if (SUCCEED != zbx_json_open(data, &jp))
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid %s data: %s", poll->proxy.host,
+				poll->proxy.addr, proxy_step_string(step), zbx_json_strerror());
+		goto fail;
+	}
+
+	poll->last_access = time(NULL);
+
+	next_step = (zbx_proxy_step_t)(step + 1);
+
+	if (ZBX_PROXY_STEP_HOST_AVAILABILITY != step && SUCCEED == zbx_json_brackets_by_name(&jp, ZBX_PROTO_TAG_DATA,
+			&jp_data) && ZBX_MAX_HRECORDS <= zbx_json_count(&jp_data))
+	{
+		if (ZBX_PROXY_BATCHES_MAX > ++poll->batches)
+			next_step = step;
+		else
+			poll->update_nextcheck = (poll->update_nextcheck & ~ZBX_PROXY_DATA_NEXTCHECK) |
+					ZBX_PROXY_DATA_BACKLOG;
+	}
+
+	/* data of the previous batch must be processed first */
+	if (SUCCEED != proxy_poll_process_data(poll))
+		goto fail;
+
+	poll->data = data;
+	poll->data_step = step;
+	poll->data_ts = poll->ts;
+
+	proxy_poll_next(poll, next_step);
+
+	return;
+fail:
+	zbx_free(data);
+	poll->step = ZBX_PROXY_STEP_DONE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_config_sent                                           *
+ *                                                                            *
+ * Purpose: checks the proxy response to configuration data                   *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_poll_config_sent(zbx_proxy_poll_t *poll, const char *response)
+{
+	struct zbx_json_parse	jp;
+	char			value[16], *info = NULL, *error = NULL;
+	size_t			info_alloc = 0;
+
+	if ('\0' == *response)
+		error = zbx_strdup(error, "empty string received");
+	else if (SUCCEED != zbx_json_open(response, &jp))
+		error = zbx_strdup(error, zbx_json_strerror());
+	else if (SUCCEED != zbx_json_value_by_name(&jp, ZBX_PROTO_TAG_RESPONSE, value, sizeof(value)))
+		error = zbx_strdup(error, "no \"" ZBX_PROTO_TAG_RESPONSE "\" tag");
+	else if (0 != strcmp(value, ZBX_PROTO_VALUE_SUCCESS))
+	{
+		if (SUCCEED == zbx_json_value_by_name_dyn(&jp, ZBX_PROTO_TAG_INFO, &info, &info_alloc))
+			error = zbx_strdup(error, info);
+		else
+			error = zbx_dsprintf(error, "negative response \"%s\"", value);
+
+		zbx_free(info);
+	}
 
-			if (SUCCEED != ret)
-				goto network_error;
+	if (NULL != error)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot send configuration %s to proxy \"%s\" at \"%s\": %s",
+				0 != poll->config_delta ? "changes" : "data", poll->proxy.host, poll->proxy.addr,
+				error);
+		zbx_free(error);
+
+		/* the proxy requests the whole configuration after it failed to apply the changes */
+		if (0 != poll->config_delta)
+			proxy_poll_next(poll, ZBX_PROXY_STEP_CONFIG);
+		else
+			poll->step = ZBX_PROXY_STEP_DONE;
+
+		return;
+	}
+
+	poll->last_access = time(NULL);
+
+	proxy_poll_next(poll, 0 != (poll->update_nextcheck & ZBX_PROXY_DATA_NEXTCHECK) ?
+			ZBX_PROXY_STEP_HOST_AVAILABILITY : ZBX_PROXY_STEP_DONE);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_exchange_tls                                          *
+ *                                                                            *
+ * Purpose: exchanges the current request with a proxy over an encrypted      *
+ *          connection                                                        *
+ *                                                                            *
+ * Comments: TLS handshake and records are handled by blocking socket         *
+ *           functions, such requests block the other proxies of the poller.  *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_poll_exchange_tls(zbx_proxy_poll_t *poll)
+{
+	struct zbx_json	j;
+	zbx_socket_t	s;
+	char		*answer = NULL, *error = NULL;
+	int		ret;
 
-			last_access = time(NULL);
+	if (ZBX_PROXY_STEP_CONFIG != poll->step)
+	{
+		if (SUCCEED == get_data_from_proxy(&poll->proxy, proxy_step_request(poll->step), &answer, &poll->ts))
+		{
+			proxy_poll_received(poll, answer);
+			return;
 		}
 
-		if (proxy.proxy_data_nextcheck <= now)
+		zbx_free(answer);
+
+		/* proxies of older versions do not report configuration digest */
+		if (ZBX_PROXY_STEP_CONFIG_DIGEST == poll->step)
+			proxy_poll_next(poll, ZBX_PROXY_STEP_CONFIG);
+		else
+			poll->step = ZBX_PROXY_STEP_DONE;
+
+		return;
+	}
+
+	if (SUCCEED != proxy_poll_config_data(poll, &j))
+	{
+		poll->step = ZBX_PROXY_STEP_DONE;
+		return;
+	}
+
+	if (SUCCEED == (ret = connect_to_proxy(&poll->proxy, &s, CONFIG_TRAPPER_TIMEOUT)))
+	{
+		if (SUCCEED == (ret = send_data_to_proxy(&poll->proxy, &s, j.buffer)))
 		{
-			if (SUCCEED == get_data_from_proxy(&proxy,
-					ZBX_PROTO_VALUE_HOST_AVAILABILITY, &answer, NULL))
+			if (SUCCEED != (ret = zbx_recv_response(&s, 0, &error)))
 			{
-				if ('\0' == *answer)
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no host"
-							" availability data: check allowed connection types and"
-							" access rights", proxy.host, proxy.addr);
-					goto network_error;
-				}
+				zabbix_log(LOG_LEVEL_WARNING, "cannot send configuration %s to proxy \"%s\" at"
+						" \"%s\": %s", 0 != poll->config_delta ? "changes" : "data",
+						poll->proxy.host, s.peer, error);
+			}
+		}
 
-				if (SUCCEED != zbx_json_open(answer, &jp))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" host availability data: %s", proxy.host, proxy.addr,
-							zbx_json_strerror());
-					goto network_error;
-				}
+		disconnect_proxy(&s);
+	}
 
-				last_access = time(NULL);
+	zbx_free(error);
+	zbx_json_free(&j);
 
-				if (SUCCEED != process_host_availability(&jp, &error))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" host availability data: %s", proxy.host, proxy.addr, error);
-					goto network_error;
-				}
+	if (SUCCEED != ret)
+	{
+		/* the proxy requests the whole configuration after it failed to apply the changes */
+		if (NETWORK_ERROR != ret && 0 != poll->config_delta)
+			proxy_poll_next(poll, ZBX_PROXY_STEP_CONFIG);
+		else
+			poll->step = ZBX_PROXY_STEP_DONE;
+
+		return;
+	}
+
+	poll->last_access = time(NULL);
+
+	proxy_poll_next(poll, 0 != (poll->update_nextcheck & ZBX_PROXY_DATA_NEXTCHECK) ?
+			ZBX_PROXY_STEP_HOST_AVAILABILITY : ZBX_PROXY_STEP_DONE);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_read                                                  *
+ *                                                                            *
+ * Purpose: reads the available part of proxy message                         *
+ *                                                                            *
+ * Return value: SUCCEED       - the whole message has been received, it      *
+ *                               follows the header in the input buffer       *
+ *               FAIL          - more data is expected                        *
+ *               NETWORK_ERROR - the connection failed                        *
+ *                                                                            *
+ ******************************************************************************/
+static int	proxy_poll_read(zbx_proxy_poll_t *poll)
+{
+	zbx_uint64_t	len64_le;
+	size_t		expected;
+	ssize_t		n;
+
+	expected = (0 != poll->in_len ? poll->in_len : ZBX_PROXY_HEADER_LEN);
+
+	if (poll->in_alloc < expected + 1)
+	{
+		poll->in_alloc = expected + 1;
+		poll->in = (char *)zbx_realloc(poll->in, poll->in_alloc);
+	}
+
+	if (-1 == (n = read(poll->fd, poll->in + poll->in_offset, expected - poll->in_offset)))
+		return EAGAIN == errno || EINTR == errno ? FAIL : NETWORK_ERROR;
+
+	if (0 == n)
+	{
+		errno = ECONNRESET;
+		return NETWORK_ERROR;
+	}
+
+	poll->in_offset += (size_t)n;
+
+	if (0 == poll->in_len && ZBX_PROXY_HEADER_LEN == poll->in_offset)
+	{
+		if (0 != strncmp(poll->in, ZBX_TCP_HEADER, ZBX_TCP_HEADER_LEN))
+		{
+			errno = EPROTO;
+			return NETWORK_ERROR;
+		}
+
+		memcpy(&len64_le, poll->in + ZBX_TCP_HEADER_LEN, sizeof(len64_le));
+
+		if (ZBX_MAX_RECV_DATA_SIZE < (len64_le = zbx_letoh_uint64(len64_le)))
+		{
+			errno = EMSGSIZE;
+			return NETWORK_ERROR;
+		}
+
+		poll->in_len = ZBX_PROXY_HEADER_LEN + (size_t)len64_le;
+	}
+
+	if (0 == poll->in_len || poll->in_offset < poll->in_len)
+		return FAIL;
+
+	poll->in[poll->in_offset] = '\0';
+
+	return SUCCEED;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_io                                                    *
+ *                                                                            *
+ * Purpose: advances the request exchange after the proxy connection became   *
+ *          ready for reading or writing                                      *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_poll_io(zbx_proxy_poll_t *poll)
+{
+	const char	*action = "obtain data from";
+	char		*data;
+	ssize_t		n;
+	int		err, ret;
+	socklen_t	err_len;
+
+	switch (poll->exchange)
+	{
+		case ZBX_PROXY_EXCHANGE_CONNECTING:
+			err_len = sizeof(err);
+
+			if (0 != getsockopt(poll->fd, SOL_SOCKET, SO_ERROR, &err, &err_len))
+				err = errno;
+
+			if (0 != err)
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot connect to proxy \"%s\": %s", poll->proxy.host,
+						zbx_strerror(err));
+				goto fail;
 			}
-			else
-				goto network_error;
-retry_history:
-			if (SUCCEED == get_data_from_proxy(&proxy,
-					ZBX_PROTO_VALUE_HISTORY_DATA, &answer, &ts))
+
+			zbx_timespec(&poll->ts);
+			poll->exchange = ZBX_PROXY_EXCHANGE_SENDING;
+			break;
+		case ZBX_PROXY_EXCHANGE_SENDING:
+		case ZBX_PROXY_EXCHANGE_RESPONDING:
+			if (-1 == (n = write(poll->fd, poll->out + poll->out_offset, poll->out_len - poll->out_offset)))
 			{
-				if ('\0' == *answer)
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no history"
-							" data: check allowed connection types and access rights",
-							proxy.host, proxy.addr);
-					goto network_error;
-				}
+				if (EAGAIN == errno || EINTR == errno)
+					break;
 
-				if (SUCCEED != zbx_json_open(answer, &jp))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" history data: %s", proxy.host, proxy.addr, zbx_json_strerror());
-					goto network_error;
-				}
+				action = "send data to";
+				goto error;
+			}
 
-				last_access = time(NULL);
+			if (poll->out_len != (poll->out_offset += (size_t)n))
+				break;
 
-				if (SUCCEED != process_hist_data(NULL, &jp, proxy.hostid, &ts, &error))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" history data: %s", proxy.host, proxy.addr, error);
-					goto network_error;
-				}
+			if (ZBX_PROXY_EXCHANGE_SENDING == poll->exchange)
+			{
+				poll->exchange = ZBX_PROXY_EXCHANGE_RECEIVING;
+				break;
+			}
 
-				if (SUCCEED == zbx_json_brackets_by_name(&jp, ZBX_PROTO_TAG_DATA, &jp_data))
-				{
-					if (ZBX_MAX_HRECORDS <= zbx_json_count(&jp_data))
-						goto retry_history;
-				}
+			/* the proxy has been told that the data was received */
+			data = zbx_strdup(NULL, poll->in + ZBX_PROXY_HEADER_LEN);
+			proxy_poll_close(poll);
+			proxy_poll_received(poll, data);
+			break;
+		case ZBX_PROXY_EXCHANGE_RECEIVING:
+			if (FAIL == (ret = proxy_poll_read(poll)))
+				break;
+
+			if (NETWORK_ERROR == ret)
+				goto error;
+
+			zabbix_log(LOG_LEVEL_DEBUG, "obtained data from proxy \"%s\": [%s]", poll->proxy.host,
+					poll->in + ZBX_PROXY_HEADER_LEN);
+
+			if (ZBX_PROXY_STEP_CONFIG == poll->step)
+			{
+				proxy_poll_close(poll);
+				proxy_poll_config_sent(poll, poll->in + ZBX_PROXY_HEADER_LEN);
+				break;
 			}
-			else
-				goto network_error;
-retry_dhistory:
-			if (SUCCEED == get_data_from_proxy(&proxy,
-					ZBX_PROTO_VALUE_DISCOVERY_DATA, &answer, NULL))
+
+			proxy_poll_message(poll, "{\"" ZBX_PROTO_TAG_RESPONSE "\":\"" ZBX_PROTO_VALUE_SUCCESS "\"}");
+			poll->exchange = ZBX_PROXY_EXCHANGE_RESPONDING;
+			break;
+		default:
+			THIS_SHOULD_NEVER_HAPPEN;
+	}
+
+	return;
+error:
+	/* proxies of older versions do not report configuration digest and close the connection */
+	if (ZBX_PROXY_STEP_CONFIG_DIGEST == poll->step)
+	{
+		zabbix_log(LOG_LEVEL_DEBUG, "cannot obtain configuration digest from proxy \"%s\": %s, sending"
+				" whole configuration", poll->proxy.host, zbx_strerror(errno));
+		proxy_poll_close(poll);
+		proxy_poll_next(poll, ZBX_PROXY_STEP_CONFIG);
+		return;
+	}
+
+	zabbix_log(LOG_LEVEL_ERR, "cannot %s proxy \"%s\": %s", action, poll->proxy.host, zbx_strerror(errno));
+fail:
+	proxy_poll_close(poll);
+	poll->step = ZBX_PROXY_STEP_DONE;
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: proxy_poll_start                                                 *
+ *                                                                            *
+ * Purpose: starts polling of a passive proxy                                 *
+ *                                                                            *
+ ******************************************************************************/
+static void	proxy_poll_start(zbx_proxy_poll_t *poll)
+{
+	char	*port = NULL;
+	time_t	now;
+
+	now = time(NULL);
+
+	poll->fd = -1;
+	poll->exchange = ZBX_PROXY_EXCHANGE_NONE;
+	poll->out = NULL;
+	poll->in = NULL;
+	poll->in_alloc = 0;
+	poll->data = NULL;
+	poll->batches = 0;
+	poll->config_digest = NULL;
+	poll->config_delta = 0;
+	poll->last_access = 0;
+	poll->update_nextcheck = 0;
+	poll->step = ZBX_PROXY_STEP_DONE;
+
+	if (poll->proxy.proxy_config_nextcheck <= now)
+		poll->update_nextcheck |= ZBX_PROXY_CONFIG_NEXTCHECK;
+	if (poll->proxy.proxy_data_nextcheck <= now)
+		poll->update_nextcheck |= ZBX_PROXY_DATA_NEXTCHECK;
+
+	poll->proxy.addr = poll->proxy.addr_orig;
+
+	port = zbx_strdup(port, poll->proxy.port_orig);
+	substitute_simple_macros(NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+			&port, MACRO_TYPE_COMMON, NULL, 0);
+
+	if (FAIL == is_ushort(port, &poll->proxy.port))
+		zabbix_log(LOG_LEVEL_ERR, "invalid proxy \"%s\" port: \"%s\"", poll->proxy.host, port);
+	else if (0 != (poll->update_nextcheck & ZBX_PROXY_CONFIG_NEXTCHECK))
+		proxy_poll_next(poll, ZBX_PROXY_STEP_CONFIG_DIGEST);
+	else if (0 != (poll->update_nextcheck & ZBX_PROXY_DATA_NEXTCHECK))
+		proxy_poll_next(poll, ZBX_PROXY_STEP_HOST_AVAILABILITY);
+
+	zbx_free(port);
+}
+
+static void	proxy_poll_finish(zbx_proxy_poll_t *poll)
+{
+	proxy_poll_close(poll);
+	proxy_poll_process_data(poll);
+
+	if (0 != poll->last_access)
+	{
+		DBbegin();
+		update_proxy_lastaccess(poll->proxy.hostid, poll->last_access);
+		DBcommit();
+	}
+
+	DCrequeue_proxy(poll->proxy.hostid, poll->update_nextcheck);
+
+	zbx_free(poll->config_digest);
+	zbx_free(poll->in);
+}
+
+/******************************************************************************
+ *                                                                            *
+ * Function: process_proxies                                                  *
+ *                                                                            *
+ * Purpose: exchange configuration and data with passive proxies              *
+ *                                                                            *
+ * Return value: the number of polled proxies                                 *
+ *                                                                            *
+ * Comments: Up to ProxyPollerConcurrency proxies are polled at once with     *
+ *           non-blocking connections. A proxy that has more backlog than     *
+ *           ZBX_PROXY_BATCHES_MAX batches is requeued after the others.      *
+ *                                                                            *
+ ******************************************************************************/
+static int	process_proxies(void)
+{
+	const char		*__function_name = "process_proxies";
+
+	zbx_proxy_poll_t	*polls, *poll;
+	int			i, num = 0, polls_num = 0, max_fd, rc, more = SUCCEED;
+	double			now, wait, started;
+	fd_set			fdr, fdw;
+	struct timeval		tv;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	polls = (zbx_proxy_poll_t *)zbx_malloc(NULL, sizeof(zbx_proxy_poll_t) * CONFIG_PROXYPOLLER_CONCURRENCY);
+	started = zbx_time();
+
+	for (;;)
+	{
+		/* take more proxies while there are free slots, but return to the main loop now and then */
+		while (SUCCEED == more && polls_num < CONFIG_PROXYPOLLER_CONCURRENCY)
+		{
+			poll = &polls[polls_num];
+
+			if (ZBX_PROXYPOLLER_ROUND_TIME <= zbx_time() - started ||
+					0 == DCconfig_get_proxypoller_hosts(&poll->proxy, 1))
 			{
-				if ('\0' == *answer)
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no discovery"
-							" data: check allowed connection types and access rights",
-							proxy.host, proxy.addr);
-					goto network_error;
-				}
+				more = FAIL;
+				break;
+			}
 
-				if (SUCCEED != zbx_json_open(answer, &jp))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" discovery data: %s", proxy.host, proxy.addr,
-							zbx_json_strerror());
-					goto network_error;
-				}
+			proxy_poll_start(poll);
+			polls_num++;
+			num++;
+		}
 
-				last_access = time(NULL);
+		FD_ZERO(&fdr);
+		FD_ZERO(&fdw);
+		max_fd = -1;
+		now = zbx_time();
+		wait = CONFIG_TRAPPER_TIMEOUT;
 
-				if (SUCCEED != process_dhis_data(&jp, &error))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" discovery data: %s", proxy.host, proxy.addr, error);
-					goto network_error;
-				}
+		for (i = 0; i < polls_num; i++)
+		{
+			poll = &polls[i];
 
-				if (SUCCEED == zbx_json_brackets_by_name(&jp, ZBX_PROTO_TAG_DATA, &jp_data))
-				{
-					if (ZBX_MAX_HRECORDS <= zbx_json_count(&jp_data))
-						goto retry_dhistory;
-				}
+			/* encrypted connections are handled synchronously */
+			if (ZBX_PROXY_STEP_DONE != poll->step && ZBX_TCP_SEC_UNENCRYPTED != poll->proxy.tls_connect)
+			{
+				if (SUCCEED == proxy_poll_process_data(poll))
+					proxy_poll_exchange_tls(poll);
+				else
+					poll->step = ZBX_PROXY_STEP_DONE;
+
+				continue;
 			}
-			else
-				goto network_error;
-retry_autoreg_host:
-			if (SUCCEED == get_data_from_proxy(&proxy,
-					ZBX_PROTO_VALUE_AUTO_REGISTRATION_DATA, &answer, NULL))
+
+			/* process the received data while the proxy prepares the next batch */
+			if (NULL != poll->data && ZBX_PROXY_EXCHANGE_CONNECTING != poll->exchange &&
+					ZBX_PROXY_EXCHANGE_SENDING != poll->exchange)
 			{
-				if ('\0' == *answer)
+				if (SUCCEED != proxy_poll_process_data(poll))
 				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned no auto"
-							" registration data: check allowed connection types and"
-							" access rights", proxy.host, proxy.addr);
-					goto network_error;
+					proxy_poll_close(poll);
+					poll->step = ZBX_PROXY_STEP_DONE;
 				}
 
-				if (SUCCEED != zbx_json_open(answer, &jp))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" auto registration data: %s", proxy.host, proxy.addr,
-							zbx_json_strerror());
-					goto network_error;
-				}
+				now = zbx_time();
+			}
 
-				last_access = time(NULL);
+			if (ZBX_PROXY_EXCHANGE_NONE == poll->exchange)
+			{
+				if (ZBX_PROXY_STEP_DONE != poll->step)
+					THIS_SHOULD_NEVER_HAPPEN;
 
-				if (SUCCEED != process_areg_data(&jp, proxy.hostid, &error))
-				{
-					zabbix_log(LOG_LEVEL_WARNING, "proxy \"%s\" at \"%s\" returned invalid"
-							" auto registration data: %s", proxy.host, proxy.addr, error);
-					goto network_error;
-				}
+				proxy_poll_finish(poll);
 
-				if (SUCCEED == zbx_json_brackets_by_name(&jp, ZBX_PROTO_TAG_DATA, &jp_data))
+				if (i != --polls_num)
 				{
-					if (ZBX_MAX_HRECORDS <= zbx_json_count(&jp_data))
-						goto retry_autoreg_host;
+					polls[i] = polls[polls_num];
+					polls[i].proxy.addr = polls[i].proxy.addr_orig;
 				}
+
+				i--;
+				continue;
 			}
+
+			if (poll->deadline <= now)
+			{
+				zabbix_log(LOG_LEVEL_ERR, "cannot exchange data with proxy \"%s\": timed out",
+						poll->proxy.host);
+				proxy_poll_close(poll);
+				poll->step = ZBX_PROXY_STEP_DONE;
+				i--;
+				continue;
+			}
+
+			if (ZBX_PROXY_EXCHANGE_RECEIVING == poll->exchange)
+				FD_SET(poll->fd, &fdr);
 			else
-				goto network_error;
+				FD_SET(poll->fd, &fdw);
+
+			max_fd = MAX(max_fd, poll->fd);
+			wait = MIN(wait, poll->deadline - now);
 		}
-network_error:
-		if (0 != last_access)
+
+		if (0 == polls_num && FAIL == more)
+			break;
+
+		if (-1 == max_fd)
+			continue;
+
+		wait = MAX(wait, 0);
+		tv.tv_sec = (int)wait;
+		tv.tv_usec = (int)((wait - tv.tv_sec) * 1000000);
+
+		if (-1 == (rc = select(max_fd + 1, &fdr, &fdw, NULL, &tv)))
 		{
-			DBbegin();
-			update_proxy_lastaccess(proxy.hostid, last_access);
-			DBcommit();
+			if (EINTR != errno)
+				zabbix_log(LOG_LEVEL_WARNING, "%s() select() failed: %s", __function_name,
+						zbx_strerror(errno));
+			continue;
 		}
 
-		DCrequeue_proxy(proxy.hostid, update_nextcheck);
+		for (i = 0; i < polls_num && 0 < rc; i++)
+		{
+			poll = &polls[i];
+
+			if (-1 == poll->fd || (0 == FD_ISSET(poll->fd, &fdr) && 0 == FD_ISSET(poll->fd, &fdw)))
+				continue;
+
+			rc--;
+			proxy_poll_io(poll);
+		}
 	}
 
-	zbx_free(answer);
-	zbx_free(port);
-	zbx_free(error);
+	zbx_free(polls);
 
-	zbx_json_free(&j);
-exit:
-	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s():%d", __function_name, num);
 
 	return num;
 }
@@ -459,7 +1147,7 @@ ZBX_THREAD_ENTRY(proxypoller_thread, args)
 		}
 
 		sec = zbx_time();
-		processed += process_proxy();
+		processed += process_proxies();
 		total_sec += zbx_time() - sec;
 
 		nextcheck = DCconfig_get_proxypoller_nextcheck();
@@ -27,6 +27,7 @@
 #include "log.h"
 #include "zbxgetopt.h"
 #include "mutexs.h"
+#include "memalloc.h"
 
 #include "sysinfo.h"
 #include "zbxmodules.h"
@@ -34,6 +35,7 @@
 
 #include "zbxnix.h"
 #include "daemon.h"
+#include "sighandler.h"
 #include "zbxself.h"
 #include "../libs/zbxnix/control.h"
 
@@ -46,6 +48,7 @@
 #include "pinger/pinger.h"
 #include "poller/poller.h"
 #include "poller/checks_ipmi.h"
+#include "poller/checks_snmp.h"
 #include "timer/timer.h"
 #include "trapper/trapper.h"
 #include "snmptrapper/snmptrapper.h"
@@ -55,6 +58,7 @@
 #include "selfmon/selfmon.h"
 #include "vmware/vmware.h"
 #include "taskmanager/taskmanager.h"
+#include "preprocessor/preprocessor.h"
 #include "events.h"
 #include "valuecache.h"
 #include "setproctitle.h"
@@ -85,6 +89,10 @@ const char	*help_message[] = {
 	"    Runtime control options:",
 	"      " ZBX_CONFIG_CACHE_RELOAD "        Reload configuration cache",
 	"      " ZBX_HOUSEKEEPER_EXECUTE "        Execute the housekeeper",
+	"      " ZBX_MEMORY_REPORT "              Write cache memory usage report to log file",
+	"      " ZBX_LATENCY_REPORT "             Write value processing latency report to log",
+	"                                 file",
+	"      " ZBX_LOCK_REPORT "                Write lock contention report to log file",
 	"      " ZBX_LOG_LEVEL_INCREASE "=target  Increase log level, affects all processes if",
 	"                                 target is not specified",
 	"      " ZBX_LOG_LEVEL_DECREASE "=target  Decrease log level, affects all processes if",
@@ -128,11 +136,17 @@ int		server_num		= 0;
 
 int	CONFIG_ALERTER_FORKS		= 1;
 int	CONFIG_DISCOVERER_FORKS		= 1;
+int	CONFIG_DISCOVERER_CONCURRENCY	= 256;
+int	CONFIG_ODBC_POOL_IDLE_TIMEOUT	= 60;
+int	CONFIG_ODBC_POOL_MAX_PER_DSN	= 4;
+int	CONFIG_REMOTE_SESSION_IDLE_TIMEOUT	= 60;
+int	CONFIG_TELNET_SESSION_REUSE	= 0;
 int	CONFIG_HOUSEKEEPER_FORKS	= 1;
 int	CONFIG_PINGER_FORKS		= 1;
 int	CONFIG_POLLER_FORKS		= 5;
 int	CONFIG_UNREACHABLE_POLLER_FORKS	= 1;
 int	CONFIG_HTTPPOLLER_FORKS		= 1;
+int	CONFIG_HTTPPOLLER_CONCURRENCY	= 16;
 int	CONFIG_IPMIPOLLER_FORKS		= 0;
 int	CONFIG_TIMER_FORKS		= 1;
 int	CONFIG_TRAPPER_FORKS		= 5;
@@ -147,6 +161,7 @@ int	CONFIG_COLLECTOR_FORKS		= 0;
 int	CONFIG_PASSIVE_FORKS		= 0;
 int	CONFIG_ACTIVE_FORKS		= 0;
 int	CONFIG_TASKMANAGER_FORKS	= 1;
+int	CONFIG_PREPROCESSOR_FORKS	= 3;
 
 int	CONFIG_LISTEN_PORT		= ZBX_DEFAULT_SERVER_PORT;
 char	*CONFIG_LISTEN_IP		= NULL;
@@ -160,6 +175,7 @@ int	CONFIG_HISTSYNCER_FORKS		= 4;
 int	CONFIG_HISTSYNCER_FREQUENCY	= 1;
 int	CONFIG_CONFSYNCER_FORKS		= 1;
 int	CONFIG_CONFSYNCER_FREQUENCY	= 60;
+char	*CONFIG_CACHE_SNAPSHOT_FILE	= NULL;
 
 int	CONFIG_VMWARE_FORKS		= 0;
 int	CONFIG_VMWARE_FREQUENCY		= 60;
@@ -172,6 +188,11 @@ zbx_uint64_t	CONFIG_HISTORY_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_TRENDS_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_VALUE_CACHE_SIZE		= 8 * ZBX_MEBIBYTE;
 zbx_uint64_t	CONFIG_VMWARE_CACHE_SIZE	= 8 * ZBX_MEBIBYTE;
+zbx_uint64_t	CONFIG_SNMP_INDEX_CACHE_SIZE	= 4 * ZBX_MEBIBYTE;
+
+int	CONFIG_HUGE_PAGES		= 0;
+
+int	CONFIG_SNMP_ASYNC_HOSTS		= 0;
 
 int	CONFIG_UNREACHABLE_PERIOD	= 45;
 int	CONFIG_UNREACHABLE_DELAY	= 15;
@@ -179,6 +200,7 @@ int	CONFIG_UNAVAILABLE_DELAY	= 60;
 int	CONFIG_LOG_LEVEL		= LOG_LEVEL_WARNING;
 char	*CONFIG_ALERT_SCRIPTS_PATH	= NULL;
 char	*CONFIG_EXTERNALSCRIPTS		= NULL;
+char	*CONFIG_EXTERNALSCRIPTS_PERSISTENT	= NULL;
 char	*CONFIG_TMPDIR			= NULL;
 char	*CONFIG_FPING_LOCATION		= NULL;
 char	*CONFIG_FPING6_LOCATION		= NULL;
@@ -205,6 +227,7 @@ int	CONFIG_LOG_SLOW_QUERIES		= 0;	/* ms; 0 - disable */
 int	CONFIG_SERVER_STARTUP_TIME	= 0;	/* zabbix server startup time */
 
 int	CONFIG_PROXYPOLLER_FORKS	= 1;	/* parameters for passive proxies */
+int	CONFIG_PROXYPOLLER_CONCURRENCY	= 16;
 
 /* how often Zabbix server sends configuration data to proxy, in seconds */
 int	CONFIG_PROXYCONFIG_FREQUENCY	= SEC_PER_HOUR;
@@ -350,6 +373,11 @@ int	get_process_info_by_thread(int local_server_num, unsigned char *local_proces
 		*local_process_type = ZBX_PROCESS_TYPE_TASKMANAGER;
 		*local_process_num = local_server_num - server_count + CONFIG_TASKMANAGER_FORKS;
 	}
+	else if (local_server_num <= (server_count += CONFIG_PREPROCESSOR_FORKS))
+	{
+		*local_process_type = ZBX_PROCESS_TYPE_PREPROCESSOR;
+		*local_process_num = local_server_num - server_count + CONFIG_PREPROCESSOR_FORKS;
+	}
 	else
 		return FAIL;
 
@@ -501,16 +529,26 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			MANDATORY,	MIN,			MAX */
 		{"StartDBSyncers",		&CONFIG_HISTSYNCER_FORKS,		TYPE_INT,
 			PARM_OPT,	1,			100},
+		{"StartPreprocessors",		&CONFIG_PREPROCESSOR_FORKS,		TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{"StartDiscoverers",		&CONFIG_DISCOVERER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			250},
+		{"DiscovererConcurrency",	&CONFIG_DISCOVERER_CONCURRENCY,		TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{"StartHTTPPollers",		&CONFIG_HTTPPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"HTTPPollerConcurrency",	&CONFIG_HTTPPOLLER_CONCURRENCY,		TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{"StartPingers",		&CONFIG_PINGER_FORKS,			TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"StartPollers",		&CONFIG_POLLER_FORKS,			TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"StartPollersUnreachable",	&CONFIG_UNREACHABLE_POLLER_FORKS,	TYPE_INT,
 			PARM_OPT,	0,			1000},
+		{"SNMPAsyncHosts",		&CONFIG_SNMP_ASYNC_HOSTS,		TYPE_INT,
+			PARM_OPT,	0,			256},
+		{"SNMPIndexCacheSize",		&CONFIG_SNMP_INDEX_CACHE_SIZE,		TYPE_UINT64,
+			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"StartIPMIPollers",		&CONFIG_IPMIPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			1000},
 		{"StartTimers",			&CONFIG_TIMER_FORKS,			TYPE_INT,
@@ -535,12 +573,16 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"HistoryIndexCacheSize",	&CONFIG_HISTORY_INDEX_CACHE_SIZE,	TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
+		{"HugePages",			&CONFIG_HUGE_PAGES,			TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"TrendCacheSize",		&CONFIG_TRENDS_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	128 * ZBX_KIBIBYTE,	__UINT64_C(2) * ZBX_GIBIBYTE},
 		{"ValueCacheSize",		&CONFIG_VALUE_CACHE_SIZE,		TYPE_UINT64,
 			PARM_OPT,	0,			__UINT64_C(64) * ZBX_GIBIBYTE},
 		{"CacheUpdateFrequency",	&CONFIG_CONFSYNCER_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	1,			SEC_PER_HOUR},
+		{"CacheSnapshotFile",		&CONFIG_CACHE_SNAPSHOT_FILE,		TYPE_STRING,
+			PARM_OPT,	0,			0},
 		{"HousekeepingFrequency",	&CONFIG_HOUSEKEEPING_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	0,			24},
 		{"MaxHousekeeperDelete",	&CONFIG_MAX_HOUSEKEEPER_DELETE,		TYPE_INT,
@@ -555,6 +597,14 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"Timeout",			&CONFIG_TIMEOUT,			TYPE_INT,
 			PARM_OPT,	1,			30},
+		{"ODBCPoolIdleTimeout",		&CONFIG_ODBC_POOL_IDLE_TIMEOUT,		TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR},
+		{"ODBCPoolMaxPerDSN",		&CONFIG_ODBC_POOL_MAX_PER_DSN,		TYPE_INT,
+			PARM_OPT,	1,			100},
+		{"RemoteSessionIdleTimeout",	&CONFIG_REMOTE_SESSION_IDLE_TIMEOUT,	TYPE_INT,
+			PARM_OPT,	0,			SEC_PER_HOUR},
+		{"TelnetSessionReuse",		&CONFIG_TELNET_SESSION_REUSE,		TYPE_INT,
+			PARM_OPT,	0,			1},
 		{"TrapperTimeout",		&CONFIG_TRAPPER_TIMEOUT,		TYPE_INT,
 			PARM_OPT,	1,			300},
 		{"UnreachablePeriod",		&CONFIG_UNREACHABLE_PERIOD,		TYPE_INT,
@@ -583,6 +633,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			0},
 		{"ExternalScripts",		&CONFIG_EXTERNALSCRIPTS,		TYPE_STRING,
 			PARM_OPT,	0,			0},
+		{"PersistentExternalScripts",	&CONFIG_EXTERNALSCRIPTS_PERSISTENT,	TYPE_STRING_LIST,
+			PARM_OPT,	0,			0},
 		{"DBHost",			&CONFIG_DBHOST,				TYPE_STRING,
 			PARM_OPT,	0,			0},
 		{"DBName",			&CONFIG_DBNAME,				TYPE_STRING,
@@ -603,6 +655,8 @@ static void	zbx_load_config(ZBX_TASK_EX *task)
 			PARM_OPT,	0,			3600000},
 		{"StartProxyPollers",		&CONFIG_PROXYPOLLER_FORKS,		TYPE_INT,
 			PARM_OPT,	0,			250},
+		{"ProxyPollerConcurrency",	&CONFIG_PROXYPOLLER_CONCURRENCY,	TYPE_INT,
+			PARM_OPT,	1,			1000},
 		{"ProxyConfigFrequency",	&CONFIG_PROXYCONFIG_FREQUENCY,		TYPE_INT,
 			PARM_OPT,	1,			SEC_PER_WEEK},
 		{"ProxyDataFrequency",		&CONFIG_PROXYDATA_FREQUENCY,		TYPE_INT,
@@ -766,10 +820,45 @@ int	main(int argc, char **argv)
 	return daemon_start(CONFIG_ALLOW_ROOT, CONFIG_USER, t.flags);
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_memory_report                                                *
+ *                                                                            *
+ * Purpose: write cache memory usage report to log file                       *
+ *                                                                            *
+ ******************************************************************************/
+static void	zbx_memory_report(void)
+{
+	zbx_vector_ptr_t	usage;
+
+	zbx_vector_ptr_create(&usage);
+
+	DCconfig_log_memory_usage();
+
+	DCget_memory_usage(&usage);
+	zbx_mem_usage_log("history cache", &usage);
+	zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	DClog_memory_stats();
+
+	if (SUCCEED == zbx_vc_get_memory_usage(&usage))
+	{
+		zbx_mem_usage_log("value cache", &usage);
+		zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	}
+
+	if (SUCCEED == zbx_vmware_get_memory_usage(&usage))
+	{
+		zbx_mem_usage_log("vmware cache", &usage);
+		zbx_vector_ptr_clear_ext(&usage, zbx_ptr_free);
+	}
+
+	zbx_vector_ptr_destroy(&usage);
+}
+
 int	MAIN_ZABBIX_ENTRY(int flags)
 {
 	zbx_socket_t	listen_sock;
-	int		i, db_type;
+	int		i, db_type, rtc_pending;
 
 	if (0 != (flags & ZBX_TASK_FLAG_FOREGROUND))
 	{
@@ -864,6 +953,12 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 
 	zbx_free_config();
 
+	if (SUCCEED != zbx_mutex_stats_init())
+	{
+		zabbix_log(LOG_LEVEL_CRIT, "cannot initialize lock statistics, exiting...");
+		exit(EXIT_FAILURE);
+	}
+
 	init_database_cache();
 	init_configuration_cache();
 	init_selfmon_collector();
@@ -872,6 +967,11 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 	if (0 != CONFIG_VMWARE_FORKS)
 		zbx_vmware_init();
 
+#ifdef HAVE_NETSNMP
+	/* initialize SNMP dynamic index cache */
+	zbx_snmpidx_init();
+#endif
+
 	/* initialize history value cache */
 	zbx_vc_init();
 
@@ -901,8 +1001,10 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 
 	DCload_config();
 
-	/* make initial configuration sync before worker processes are forked */
-	DCsync_configuration();
+	/* make initial configuration sync before worker processes are forked, */
+	/* the configuration cache snapshot saved at shutdown is used if available */
+	if (NULL == CONFIG_CACHE_SNAPSHOT_FILE || SUCCEED != DCconfig_snapshot_load(CONFIG_CACHE_SNAPSHOT_FILE))
+		DCsync_configuration();
 
 	DBclose();
 
@@ -912,7 +1014,7 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 			+ CONFIG_HTTPPOLLER_FORKS + CONFIG_DISCOVERER_FORKS + CONFIG_HISTSYNCER_FORKS
 			+ CONFIG_ESCALATOR_FORKS + CONFIG_IPMIPOLLER_FORKS + CONFIG_JAVAPOLLER_FORKS
 			+ CONFIG_SNMPTRAPPER_FORKS + CONFIG_PROXYPOLLER_FORKS + CONFIG_SELFMON_FORKS
-			+ CONFIG_VMWARE_FORKS + CONFIG_TASKMANAGER_FORKS;
+			+ CONFIG_VMWARE_FORKS + CONFIG_TASKMANAGER_FORKS + CONFIG_PREPROCESSOR_FORKS;
 	threads = zbx_calloc(threads, threads_num, sizeof(pid_t));
 
 	if (0 != CONFIG_TRAPPER_FORKS)
@@ -1014,6 +1116,9 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 			case ZBX_PROCESS_TYPE_TASKMANAGER:
 				threads[i] = zbx_thread_start(taskmanager_thread, &thread_args);
 				break;
+			case ZBX_PROCESS_TYPE_PREPROCESSOR:
+				threads[i] = zbx_thread_start(preprocessor_thread, &thread_args);
+				break;
 		}
 	}
 
@@ -1024,6 +1129,17 @@ int	MAIN_ZABBIX_ENTRY(int flags)
 			zabbix_log(LOG_LEVEL_ERR, "failed to wait on child processes: %s", zbx_strerror(errno));
 			break;
 		}
+
+		rtc_pending = zbx_rtc_get_pending();
+
+		if (0 != (rtc_pending & ZBX_RTC_PENDING(ZBX_RTC_MEMORY_REPORT)))
+			zbx_memory_report();
+
+		if (0 != (rtc_pending & ZBX_RTC_PENDING(ZBX_RTC_LATENCY_REPORT)))
+			log_latency_stats();
+
+		if (0 != (rtc_pending & ZBX_RTC_PENDING(ZBX_RTC_LOCK_REPORT)))
+			zbx_mutex_stats_log();
 	}
 
 	/* all exiting child processes should be caught by signal handlers */
@@ -1073,6 +1189,10 @@ void	zbx_on_exit(void)
 
 	DBclose();
 
+	/* the configuration cache might be left inconsistent by a crashed child process */
+	if (NULL != CONFIG_CACHE_SNAPSHOT_FILE && SUCCEED != zbx_sig_child_died())
+		DCconfig_snapshot_save(CONFIG_CACHE_SNAPSHOT_FILE);
+
 	free_configuration_cache();
 
 	/* free history value cache */
@@ -1092,6 +1212,11 @@ void	zbx_on_exit(void)
 	if (0 != CONFIG_VMWARE_FORKS)
 		zbx_vmware_destroy();
 
+#ifdef HAVE_NETSNMP
+	/* free SNMP dynamic index cache */
+	zbx_snmpidx_destroy();
+#endif
+
 	free_selfmon_collector();
 
 	zbx_uninitialize_events();
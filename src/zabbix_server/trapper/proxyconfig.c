@@ -37,10 +37,11 @@
  ******************************************************************************/
 void	send_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp)
 {
-	const char	*__function_name = "send_proxyconfig";
-	zbx_uint64_t	proxy_hostid;
-	char		host[HOST_HOST_LEN_MAX], *error = NULL;
-	struct zbx_json	j;
+	const char		*__function_name = "send_proxyconfig";
+	zbx_uint64_t		proxy_hostid;
+	char			host[HOST_HOST_LEN_MAX], *error = NULL;
+	struct zbx_json		j;
+	struct zbx_json_parse	jp_digest, *pjp_digest = NULL;
 
 	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
 
@@ -56,7 +57,11 @@ void	send_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp)
 
 	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
 
-	if (SUCCEED != get_proxyconfig_data(proxy_hostid, &j, &error))
+	/* proxy reports digests of its configuration copy to receive only the changes */
+	if (SUCCEED == zbx_json_brackets_by_name(jp, ZBX_PROTO_TAG_CONFIG_DIGEST, &jp_digest))
+		pjp_digest = &jp_digest;
+
+	if (SUCCEED != get_proxyconfig_data(proxy_hostid, pjp_digest, &j, &error))
 	{
 		zbx_send_response(sock, FAIL, error, CONFIG_TIMEOUT);
 		zabbix_log(LOG_LEVEL_WARNING, "cannot collect configuration data for proxy \"%s\" at \"%s\": %s",
@@ -109,8 +114,50 @@ void	recv_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp)
 	if (SUCCEED != check_access_passive_proxy(sock, ZBX_SEND_RESPONSE, "configuration update"))
 		goto out;
 
-	process_proxyconfig(&jp_data);
+	ret = process_proxyconfig(&jp_data);
 	zbx_send_response(sock, ret, NULL, CONFIG_TIMEOUT);
 out:
 	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
 }
+
+/******************************************************************************
+ *                                                                            *
+ * Function: send_proxyconfig_digest                                          *
+ *                                                                            *
+ * Purpose: send digests of local configuration copy to server, so that only  *
+ *          the changes are sent with the next configuration update           *
+ *          (passive proxies)                                                 *
+ *                                                                            *
+ ******************************************************************************/
+void	send_proxyconfig_digest(zbx_socket_t *sock)
+{
+	const char	*__function_name = "send_proxyconfig_digest";
+
+	struct zbx_json	j;
+	char		*error = NULL;
+
+	zabbix_log(LOG_LEVEL_DEBUG, "In %s()", __function_name);
+
+	if (SUCCEED != check_access_passive_proxy(sock, ZBX_DO_NOT_SEND_RESPONSE, "configuration digest request"))
+		goto out;
+
+	zbx_json_init(&j, ZBX_JSON_STAT_BUF_LEN);
+
+	get_proxyconfig_digest(&j);
+
+	if (SUCCEED != zbx_tcp_send_to(sock, j.buffer, CONFIG_TIMEOUT))
+		error = zbx_strdup(error, zbx_socket_strerror());
+	else
+		zbx_recv_response(sock, CONFIG_TIMEOUT, &error);
+
+	if (NULL != error)
+	{
+		zabbix_log(LOG_LEVEL_WARNING, "cannot send configuration digest to server at \"%s\": %s",
+				sock->peer, error);
+	}
+
+	zbx_json_free(&j);
+	zbx_free(error);
+out:
+	zabbix_log(LOG_LEVEL_DEBUG, "End of %s()", __function_name);
+}
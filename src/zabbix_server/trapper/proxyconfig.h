@@ -28,5 +28,6 @@ extern int	CONFIG_TRAPPER_TIMEOUT;
 
 void	send_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp);
 void	recv_proxyconfig(zbx_socket_t *sock, struct zbx_json_parse *jp);
+void	send_proxyconfig_digest(zbx_socket_t *sock);
 
 #endif
@@ -557,6 +557,11 @@ static int	process_trap(zbx_socket_t *sock, char *s, zbx_timespec_t *ts)
 					active_passive_misconfig(sock);
 				}
 			}
+			else if (0 == strcmp(value, ZBX_PROTO_VALUE_PROXY_CONFIG_DIGEST))
+			{
+				if (0 != (program_type & ZBX_PROGRAM_TYPE_PROXY_PASSIVE))
+					send_proxyconfig_digest(sock);
+			}
 			else if (0 == strcmp(value, ZBX_PROTO_VALUE_AGENT_DATA) ||
 					0 == strcmp(value, ZBX_PROTO_VALUE_SENDER_DATA))
 			{
@@ -4798,6 +4798,74 @@ int	zbx_vmware_get_statistics(zbx_vmware_stats_t *stats)
 	return SUCCEED;
 }
 
+/******************************************************************************
+ *                                                                            *
+ * Function: zbx_vmware_get_memory_usage                                      *
+ *                                                                            *
+ * Purpose: get memory used by vmware cache structures                        *
+ *                                                                            *
+ * Parameters: usage - [OUT] the memory usage vector                          *
+ *                                                                            *
+ * Return value: SUCCEED - the memory usage was retrieved                     *
+ *               FAIL    - the vmware cache is not initialized                *
+ *                                                                            *
+ * Comments: The memory used by strings and performance counter values is     *
+ *           reported as "other".                                             *
+ *                                                                            *
+ ******************************************************************************/
+int	zbx_vmware_get_memory_usage(zbx_vector_ptr_t *usage)
+{
+#if defined(HAVE_LIBXML2) && defined(HAVE_LIBCURL)
+	zbx_uint64_t		counters_num = 0, counters_size = 0, entities_num = 0, entities_size = 0, hvs_num = 0,
+				hvs_size = 0, vms_num = 0, events_num = 0;
+	zbx_hashset_iter_t	iter;
+	zbx_vmware_hv_t		*hv;
+	int			i;
+
+	if (NULL == vmware_mem)
+		return FAIL;
+
+	zbx_vmware_lock();
+
+	for (i = 0; i < vmware->services.values_num; i++)
+	{
+		zbx_vmware_service_t	*service = (zbx_vmware_service_t *)vmware->services.values[i];
+
+		counters_num += service->counters.num_data;
+		counters_size += zbx_mem_hashset_size(vmware_mem, &service->counters, sizeof(zbx_vmware_counter_t));
+		entities_num += service->entities.num_data;
+		entities_size += zbx_mem_hashset_size(vmware_mem, &service->entities, sizeof(zbx_vmware_perf_entity_t));
+
+		if (NULL == service->data)
+			continue;
+
+		hvs_num += service->data->hvs.num_data;
+		hvs_size += zbx_mem_hashset_size(vmware_mem, &service->data->hvs, sizeof(zbx_vmware_hv_t));
+		events_num += service->data->events.values_num;
+
+		zbx_hashset_iter_reset(&service->data->hvs, &iter);
+
+		while (NULL != (hv = (zbx_vmware_hv_t *)zbx_hashset_iter_next(&iter)))
+			vms_num += hv->vms.values_num;
+	}
+
+	zbx_mem_usage_add(usage, "services", vmware->services.values_num,
+			vmware->services.values_num * zbx_mem_chunk_size(vmware_mem, sizeof(zbx_vmware_service_t)));
+	zbx_mem_usage_add(usage, "counters", counters_num, counters_size);
+	zbx_mem_usage_add(usage, "entities", entities_num, entities_size);
+	zbx_mem_usage_add(usage, "hypervisors", hvs_num, hvs_size);
+	zbx_mem_usage_add(usage, "vms", vms_num, vms_num * zbx_mem_chunk_size(vmware_mem, sizeof(zbx_vmware_vm_t)));
+	zbx_mem_usage_add(usage, "events", events_num, events_num * zbx_mem_chunk_size(vmware_mem, sizeof(zbx_vmware_event_t)));
+	zbx_mem_usage_add_other(usage, zbx_mem_used_size(vmware_mem));
+
+	zbx_vmware_unlock();
+
+	return SUCCEED;
+#else
+	return FAIL;
+#endif
+}
+
 #if defined(HAVE_LIBXML2) && defined(HAVE_LIBCURL)
 
 /*
@@ -231,6 +231,7 @@ void	zbx_vmware_lock(void);
 void	zbx_vmware_unlock(void);
 
 int	zbx_vmware_get_statistics(zbx_vmware_stats_t *stats);
+int	zbx_vmware_get_memory_usage(zbx_vector_ptr_t *usage);
 
 #if defined(HAVE_LIBXML2) && defined(HAVE_LIBCURL)
 